@@ -9,6 +9,7 @@ DEFINES += MAKE_DB_LIBRARY
 TEMPLATE = lib
 
 SOURCES = \
+  dbArena.cc \
   dbArray.cc \
   dbBox.cc \
   dbBoxConvert.cc \
@@ -25,6 +26,7 @@ SOURCES = \
   dbClipboard.cc \
   dbClipboardData.cc \
   dbClip.cc \
+  dbDeepShapeStore.cc \
   dbDXF.cc \
   dbDXFReader.cc \
   dbDXFWriter.cc \
@@ -44,16 +46,19 @@ SOURCES = \
   dbGDS2Writer.cc \
   dbGlyphs.cc \
   dbHershey.cc \
+  dbHierProcessor.cc \
   dbInstances.cc \
   dbInstElement.cc \
   dbLayerMapping.cc \
   dbLayerProperties.cc \
   dbLayout.cc \
+  dbLayoutCache.cc \
   dbLayoutContextHandler.cc \
   dbLayoutDiff.cc \
   dbLayoutQuery.cc \
   dbLayoutStateModel.cc \
   dbLayoutUtils.cc \
+  dbLazyCellLoader.cc \
   dbLibrary.cc \
   dbLibraryManager.cc \
   dbLibraryProxy.cc \
@@ -102,6 +107,7 @@ SOURCES = \
   gsiDeclDbBox.cc \
   gsiDeclDbCell.cc \
   gsiDeclDbCellMapping.cc \
+  gsiDeclDbDeepShapeStore.cc \
   gsiDeclDbEdge.cc \
   gsiDeclDbEdgePair.cc \
   gsiDeclDbEdgePairs.cc \
@@ -132,6 +138,7 @@ SOURCES = \
   gsiDeclDbGlyphs.cc \
 
 HEADERS = \
+  dbArena.h \
   dbArray.h \
   dbBoxConvert.h \
   dbBox.h \
@@ -148,6 +155,8 @@ HEADERS = \
   dbClipboardData.h \
   dbClipboard.h \
   dbClip.h \
+  dbContentHash.h \
+  dbDeepShapeStore.h \
   dbDXF.h \
   dbDXFReader.h \
   dbDXFWriter.h \
@@ -168,16 +177,19 @@ HEADERS = \
   dbHash.h \
   dbHersheyFont.h \
   dbHershey.h \
+  dbHierProcessor.h \
   dbInstances.h \
   dbInstElement.h \
   dbLayer.h \
   dbLayerMapping.h \
   dbLayerProperties.h \
   dbLayoutDiff.h \
+  dbLayoutCache.h \
   dbLayout.h \
   dbLayoutQuery.h \
   dbLayoutStateModel.h \
   dbLayoutUtils.h \
+  dbLazyCellLoader.h \
   dbLibrary.h \
   dbLibraryManager.h \
   dbLibraryProxy.h \
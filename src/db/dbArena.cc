@@ -0,0 +1,219 @@
+
+/*
+
+  KLayout Layout Viewer
+  Copyright (C) 2006-2017 Matthias Koefferlein
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+
+#include "dbArena.h"
+#include "dbMemStatistics.h"
+#include "tlAssert.h"
+
+#include <QMutex>
+
+#include <cstdlib>
+#include <algorithm>
+#include <new>
+
+namespace db
+{
+
+//  protects the chunk lists and counters of all arenas
+static QMutex s_arena_lock;
+
+namespace
+{
+
+inline size_t align8 (size_t n)
+{
+  return (n + 7) & ~size_t (7);
+}
+
+/**
+ *  @brief The header in front of each block
+ */
+struct BlockHeader
+{
+  void *chunk;
+  size_t size;
+};
+
+}
+
+/**
+ *  @brief The header of a chunk
+ *
+ *  The blocks follow the header in the same memory block.
+ */
+struct Arena::Chunk
+{
+  Arena *arena;
+  Chunk *prev, *next;
+  size_t size;
+  size_t live;
+  char *ptr, *end;
+
+  char *begin ()
+  {
+    return (char *) this + align8 (sizeof (Chunk));
+  }
+};
+
+Arena::Arena (size_t chunk_size)
+  : m_chunk_size (chunk_size), mp_chunks (0), mp_current (0), m_used (0), m_reserved (0), m_chunks (0)
+{
+  //  .. nothing yet ..
+}
+
+Arena::~Arena ()
+{
+  QMutexLocker locker (&s_arena_lock);
+
+  Chunk *c = mp_chunks;
+  while (c) {
+    Chunk *next = c->next;
+    if (c->live == 0) {
+      std::free (c);
+    } else {
+      //  the chunk is released when its last block is freed
+      c->arena = 0;
+      c->prev = c->next = 0;
+    }
+    c = next;
+  }
+}
+
+Arena::Chunk *
+Arena::new_chunk (size_t n)
+{
+  size_t size = align8 (sizeof (Chunk)) + n;
+  Chunk *c = (Chunk *) std::malloc (size);
+  if (! c) {
+    throw std::bad_alloc ();
+  }
+
+  c->arena = this;
+  c->prev = 0;
+  c->next = mp_chunks;
+  if (mp_chunks) {
+    mp_chunks->prev = c;
+  }
+  mp_chunks = c;
+
+  c->size = size;
+  c->live = 0;
+  c->ptr = c->begin ();
+  c->end = c->ptr + n;
+
+  m_reserved += size;
+  ++m_chunks;
+
+  return c;
+}
+
+void
+Arena::release_chunk (Chunk *c)
+{
+  if (c->prev) {
+    c->prev->next = c->next;
+  } else {
+    mp_chunks = c->next;
+  }
+  if (c->next) {
+    c->next->prev = c->prev;
+  }
+
+  m_reserved -= c->size;
+  --m_chunks;
+
+  std::free (c);
+}
+
+void *
+Arena::allocate (size_t n)
+{
+  size_t nn = align8 (n) + align8 (sizeof (BlockHeader));
+
+  QMutexLocker locker (&s_arena_lock);
+
+  Chunk *c = 0;
+  if (nn > m_chunk_size / 4) {
+    //  large blocks get a chunk of their own
+    c = new_chunk (nn);
+  } else {
+    if (! mp_current || size_t (mp_current->end - mp_current->ptr) < nn) {
+      if (mp_current && mp_current->live == 0) {
+        mp_current->ptr = mp_current->begin ();
+      } else {
+        mp_current = new_chunk (std::max (m_chunk_size, nn));
+      }
+    }
+    c = mp_current;
+  }
+
+  BlockHeader *h = (BlockHeader *) c->ptr;
+  h->chunk = c;
+  h->size = nn;
+  c->ptr += nn;
+  ++c->live;
+
+  m_used += nn;
+
+  return (char *) h + align8 (sizeof (BlockHeader));
+}
+
+void
+Arena::free (void *p)
+{
+  if (! p) {
+    return;
+  }
+
+  BlockHeader *h = (BlockHeader *) ((char *) p - align8 (sizeof (BlockHeader)));
+
+  QMutexLocker locker (&s_arena_lock);
+
+  Chunk *c = (Chunk *) h->chunk;
+  tl_assert (c->live > 0);
+
+  Arena *arena = c->arena;
+  if (arena) {
+    arena->m_used -= h->size;
+  }
+
+  if (--c->live == 0) {
+    if (! arena) {
+      std::free (c);
+    } else if (c == arena->mp_current) {
+      c->ptr = c->begin ();
+    } else {
+      arena->release_chunk (c);
+    }
+  }
+}
+
+void
+Arena::collect_mem_stat (db::MemStatistics &m) const
+{
+  QMutexLocker locker (&s_arena_lock);
+  m.arena (sizeof (*this) + m_reserved - m_used, sizeof (*this));
+}
+
+}
+
@@ -0,0 +1,135 @@
+
+/*
+
+  KLayout Layout Viewer
+  Copyright (C) 2006-2017 Matthias Koefferlein
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+
+
+#ifndef HDR_dbArena
+#define HDR_dbArena
+
+#include "dbCommon.h"
+
+#include <cstddef>
+
+namespace db
+{
+
+class MemStatistics;
+
+/**
+ *  @brief An arena allocator
+ *
+ *  The arena hands out memory blocks from large chunks. Allocation is a simple
+ *  pointer increment. Each chunk counts the blocks allocated from it which are
+ *  still alive. A chunk is released once all its blocks have been freed, so
+ *  freeing a large number of blocks is a bulk operation.
+ *
+ *  Blocks may outlive the arena: when the arena is destroyed, the chunks which
+ *  still hold live blocks are detached from it and released when their last block
+ *  is freed.
+ *
+ *  Blocks are aligned to 8 bytes. Allocating and freeing blocks is thread safe:
+ *  since blocks may be freed after their chunk has been detached, a single lock
+ *  protects the bookkeeping of all arenas.
+ */
+class DB_PUBLIC Arena
+{
+public:
+  /**
+   *  @brief The default chunk size in bytes
+   */
+  static const size_t default_chunk_size = 1024 * 1024;
+
+  /**
+   *  @brief Creates an arena with the given chunk size
+   *
+   *  Blocks larger than a quarter of the chunk size get a chunk of their own.
+   */
+  Arena (size_t chunk_size = default_chunk_size);
+
+  /**
+   *  @brief Destructor
+   */
+  ~Arena ();
+
+  /**
+   *  @brief Allocates a block of n bytes
+   */
+  void *allocate (size_t n);
+
+  /**
+   *  @brief Frees a block allocated by any arena
+   *
+   *  Null pointers are allowed.
+   */
+  static void free (void *p);
+
+  /**
+   *  @brief Gets the number of bytes in live blocks
+   */
+  size_t used () const
+  {
+    return m_used;
+  }
+
+  /**
+   *  @brief Gets the number of bytes held in chunks
+   */
+  size_t reserved () const
+  {
+    return m_reserved;
+  }
+
+  /**
+   *  @brief Gets the number of chunks
+   */
+  size_t chunks () const
+  {
+    return m_chunks;
+  }
+
+  /**
+   *  @brief Collects the memory statistics
+   *
+   *  The blocks are reported by their owners. This method reports the
+   *  memory held by the arena beyond the live blocks.
+   */
+  void collect_mem_stat (db::MemStatistics &m) const;
+
+private:
+  struct Chunk;
+  friend struct Chunk;
+
+  size_t m_chunk_size;
+  Chunk *mp_chunks, *mp_current;
+  size_t m_used, m_reserved, m_chunks;
+
+  Arena (const Arena &);
+  Arena &operator= (const Arena &);
+
+  Chunk *new_chunk (size_t n);
+  void release_chunk (Chunk *chunk);
+};
+
+}
+
+#endif
+
@@ -35,6 +35,7 @@
 #include <set>
 #include <functional>
 #include <memory>
+#include <algorithm>
 
 namespace db
 {
@@ -389,6 +390,229 @@ private:
   std::string m_progress_desc;
 };
 
+/**
+ *  @brief A receiver adaptor for the bands of the partitioned box scanner
+ *
+ *  This adaptor forwards only the events owned by the band to the actual receiver. 
+ *  An interaction is owned by the band which contains the larger bottom coordinate of 
+ *  the two boxes. A "finish" event is owned by the band which contains the bottom 
+ *  coordinate of the box. Empty boxes are owned by the first band.
+ */
+template <class Rec, class BoxConvert, class Obj, class Prop>
+class bs_band_receiver
+{
+public:
+  typedef typename BoxConvert::box_type box_type;
+  typedef typename box_type::coord_type coord_type;
+
+  bs_band_receiver (Rec &rec, const BoxConvert &bc, bool first, bool last, coord_type lower, coord_type upper)
+    : mp_rec (&rec), m_bc (bc), m_first (first), m_last (last), m_lower (lower), m_upper (upper)
+  {
+    //  .. nothing yet ..
+  }
+
+  void finish (const Obj *obj, const Prop &prop)
+  {
+    box_type b = m_bc (*obj);
+    if (b.empty () ? m_first : owns (b.bottom ())) {
+      mp_rec->finish (obj, prop);
+    }
+  }
+
+  void add (const Obj *o1, const Prop &p1, const Obj *o2, const Prop &p2)
+  {
+    if (owns (std::max (m_bc (*o1).bottom (), m_bc (*o2).bottom ()))) {
+      mp_rec->add (o1, p1, o2, p2);
+    }
+  }
+
+private:
+  Rec *mp_rec;
+  BoxConvert m_bc;
+  bool m_first, m_last;
+  coord_type m_lower, m_upper;
+
+  bool owns (coord_type y) const
+  {
+    return (m_first || y >= m_lower) && (m_last || y < m_upper);
+  }
+};
+
+/**
+ *  @brief A box scanner which splits the objects into horizontal bands
+ *
+ *  The partitioned box scanner distributes the objects over bands along the sweep axis (y). 
+ *  The bands overlap by the enlargement, so each interaction is found within a single band. 
+ *  Interactions found in more than one band are reported only by the band owning them. 
+ *  Hence the bands can be scanned independently, for example by different threads, 
+ *  each one delivering its events to a receiver of its own.
+ *
+ *  The same interactions are reported as by the plain box scanner. As the events are 
+ *  distributed over the receivers, this scheme is suitable only for receivers which do 
+ *  not rely on the finish event being sent after all interactions of an object.
+ *
+ *  Usage is: insert the objects, call "partition" and then "process_band" for each band.
+ *  "process_band" may be called from different threads for different bands.
+ */
+template <class Obj, class Prop>
+class partitioned_box_scanner 
+{
+public:
+  typedef Obj object_type;
+  typedef Prop property_type;
+  typedef std::vector<std::pair<const Obj *, Prop> > container_type;
+  typedef typename container_type::iterator iterator_type;
+
+  /**
+   *  @brief Default ctor
+   */
+  partitioned_box_scanner ()
+  {
+    //  .. nothing yet ..
+  }
+
+  /**
+   *  @brief Reserve for n elements
+   */
+  void reserve (size_t n)
+  {
+    m_pp.reserve (n);
+  }
+
+  /**
+   *  @brief Clears the container
+   */
+  void clear ()
+  {
+    m_pp.clear ();
+    m_bands.clear ();
+    m_limits.clear ();
+  }
+
+  /**
+   *  @brief Inserts a new object into the scanner
+   *
+   *  See box_scanner::insert for details.
+   */
+  void insert (const Obj *obj, const Prop &prop)
+  {
+    m_pp.push_back (std::make_pair (obj, prop));
+  }
+
+  /**
+   *  @brief Gets the number of objects
+   */
+  size_t size () const
+  {
+    return m_pp.size ();
+  }
+
+  /**
+   *  @brief Distributes the objects over at most n bands
+   *
+   *  The band limits are chosen such that each band owns roughly the same number of objects.
+   *  The enlargement must be the same than the one used for "process_band".
+   */
+  template <class BoxConvert>
+  void partition (size_t n, typename BoxConvert::box_type::coord_type enl, const BoxConvert &bc = BoxConvert ())
+  {
+    typedef typename BoxConvert::box_type box_type;
+    typedef typename box_type::coord_type coord_type;
+    typedef bs_side_compare_func<BoxConvert, Obj, Prop, box_bottom<box_type> > bottom_side_compare_func;
+
+    m_bands.clear ();
+    m_limits.clear ();
+
+    //  empty boxes do not interact and go to the first band
+    iterator_type ne = std::partition (m_pp.begin (), m_pp.end (), bs_is_empty_func<BoxConvert> (bc));
+    std::sort (ne, m_pp.end (), bottom_side_compare_func (bc));
+
+    size_t nne = m_pp.end () - ne;
+    for (size_t i = 1; i < n && nne > 0; ++i) {
+      const Obj *l = (ne + (i * nne) / n)->first;
+      if (m_limits.empty () || bc (*m_limits.back ()).bottom () < bc (*l).bottom ()) {
+        m_limits.push_back (l);
+      }
+    }
+
+    std::vector<coord_type> limits;
+    limits.reserve (m_limits.size ());
+    for (typename std::vector<const Obj *>::const_iterator l = m_limits.begin (); l != m_limits.end (); ++l) {
+      limits.push_back (bc (*(*l)).bottom ());
+    }
+
+    m_bands.resize (m_limits.size () + 1);
+
+    for (iterator_type i = m_pp.begin (); i != ne; ++i) {
+      m_bands.front ().insert (i->first, i->second);
+    }
+
+    for (iterator_type i = ne; i != m_pp.end (); ++i) {
+      box_type b = bc (*i->first);
+      //  an object is scanned in the band containing its bottom coordinate and in the bands above 
+      //  which it reaches with the enlargement
+      size_t k = std::upper_bound (limits.begin (), limits.end (), b.bottom ()) - limits.begin ();
+      do {
+        m_bands [k].insert (i->first, i->second);
+        ++k;
+      } while (k < m_bands.size () && b.top () + enl > limits [k - 1]);
+    }
+  }
+
+  /**
+   *  @brief Gets the number of bands
+   *
+   *  This value is available after "partition" has been called.
+   */
+  size_t bands () const
+  {
+    return m_bands.size ();
+  }
+
+  /**
+   *  @brief Derives the interactions within the given band
+   *
+   *  The interactions owned by this band are reported to the receiver. For the 
+   *  description of the other arguments see box_scanner::process.
+   */
+  template <class Rec, class BoxConvert>
+  void process_band (size_t n, Rec &rec, typename BoxConvert::box_type::coord_type enl, const BoxConvert &bc = BoxConvert ())
+  {
+    typedef typename BoxConvert::box_type::coord_type coord_type;
+
+    bool first = (n == 0);
+    bool last = (n + 1 == m_bands.size ());
+    coord_type lower = first ? coord_type (0) : bc (*m_limits [n - 1]).bottom ();
+    coord_type upper = last ? coord_type (0) : bc (*m_limits [n]).bottom ();
+
+    bs_band_receiver<Rec, BoxConvert, Obj, Prop> band_rec (rec, bc, first, last, lower, upper);
+    m_bands [n].process (band_rec, enl, bc);
+  }
+
+private:
+  container_type m_pp;
+  std::vector<box_scanner<Obj, Prop> > m_bands;
+  std::vector<const Obj *> m_limits;
+
+  template <class BoxConvert>
+  struct bs_is_empty_func
+    : std::unary_function<std::pair<const Obj *, Prop>, bool> 
+  {
+    bs_is_empty_func (const BoxConvert &bc)
+      : m_bc (bc)
+    {
+      //  .. nothing yet ..
+    }
+
+    bool operator() (const std::pair<const Obj *, Prop> &a) const
+    {
+      return m_bc (*a.first).empty ();
+    }
+
+    BoxConvert m_bc;
+  };
+};
+
 /**
  *  @brief A cluster template that stores properties
  *
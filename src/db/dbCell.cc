@@ -23,6 +23,7 @@
 
 #include "dbCell.h"
 #include "dbLayout.h"
+#include "dbLazyCellLoader.h"
 #include "dbManager.h"
 #include "dbBox.h"
 #include "dbPCellVariant.h"
@@ -89,7 +90,7 @@ Cell::box_type Cell::ms_empty_box = Cell::box_type ();
 
 Cell::Cell (cell_index_type ci, db::Layout &l) 
   : db::Object (l.manager ()), 
-    m_cell_index (ci), mp_layout (&l), m_instances (this), m_prop_id (0), m_hier_levels (0), m_bbox_needs_update (false), m_ghost_cell (false), 
+    m_cell_index (ci), mp_layout (&l), m_instances (this), m_prop_id (0), m_hier_levels (0), m_bbox_needs_update (false), m_ghost_cell (false), m_lazy (0),
     mp_last (0), mp_next (0)
 {
   //  .. nothing yet 
@@ -98,7 +99,7 @@ Cell::Cell (cell_index_type ci, db::Layout &l)
 Cell::Cell (const Cell &d)
   : db::Object (d), 
     gsi::ObjectBase (),
-    mp_layout (d.mp_layout), m_instances (this), m_prop_id (d.m_prop_id), m_hier_levels (d.m_hier_levels),
+    mp_layout (d.mp_layout), m_instances (this), m_prop_id (d.m_prop_id), m_hier_levels (d.m_hier_levels), m_lazy (0),
     mp_last (0), mp_next (0)
 {
   m_cell_index = d.m_cell_index;
@@ -115,6 +116,11 @@ Cell::operator= (const Cell &d)
 
     invalidate_hier ();
 
+    //  copies receive the shapes, not the lazy state
+    if (d.is_lazy ()) {
+      d.load_lazy ();
+    }
+
     clear_shapes_no_invalidate ();
     for (shapes_map::const_iterator s = d.m_shapes_map.begin (); s != d.m_shapes_map.end (); ++s) {
       shapes (s->first) = s->second;
@@ -134,6 +140,10 @@ Cell::operator= (const Cell &d)
 
 Cell::~Cell ()
 {
+  //  don't load the shapes just for deleting them
+  if (is_lazy ()) {
+    mp_layout->lazy_cell_loader ()->discard (*this);
+  }
   clear_shapes ();
 }
 
@@ -148,6 +158,19 @@ Cell::clone (db::Layout &layout) const
 unsigned int
 Cell::layers () const
 {
+  //  Lazy cells report the layers without loading the shapes. While the cell is lazy, 
+  //  the shapes map may be filled by the loader in a different thread, so it is not used.
+  if (is_lazy ()) {
+    const box_map &bb = mp_layout->lazy_cell_loader ()->shape_bboxes (m_cell_index);
+    if (bb.empty ()) {
+      return 0;
+    } else {
+      box_map::const_iterator b = bb.end ();
+      --b;
+      return b->first + 1;
+    }
+  }
+
   if (m_shapes_map.empty ()) {
     return 0;
   } else {
@@ -160,7 +183,7 @@ Cell::layers () const
 bool
 Cell::empty () const
 {
-  if (! m_instances.empty ()) {
+  if (! m_instances.empty () || is_lazy ()) {
     return false;
   }
 
@@ -176,6 +199,10 @@ Cell::empty () const
 void 
 Cell::clear (unsigned int index)
 {
+  if (is_lazy ()) {
+    load_lazy ();
+  }
+
   shapes_map::iterator s = m_shapes_map.find(index);
   if (s != m_shapes_map.end() && ! s->second.empty ()) {
     mp_layout->invalidate_bboxes (index);  //  HINT: must come before the change is done!
@@ -187,6 +214,10 @@ Cell::clear (unsigned int index)
 Cell::shapes_type &
 Cell::shapes (unsigned int index) 
 {
+  if (is_lazy ()) {
+    load_lazy ();
+  }
+
   shapes_map::iterator s = m_shapes_map.find(index);
   if (s == m_shapes_map.end()) {
     s = m_shapes_map.insert (std::make_pair(index, shapes_type (0, this, mp_layout ? mp_layout->is_editable () : true))).first;
@@ -198,6 +229,10 @@ Cell::shapes (unsigned int index)
 const Cell::shapes_type &
 Cell::shapes (unsigned int index) const
 {
+  if (is_lazy ()) {
+    load_lazy ();
+  }
+
   shapes_map::const_iterator s = m_shapes_map.find(index);
   if (s != m_shapes_map.end()) {
     return s->second;
@@ -223,6 +258,17 @@ Cell::index_of_shapes (const Cell::shapes_type *shapes) const
   return std::numeric_limits<unsigned int>::max ();
 }
 
+unsigned int
+Cell::index_of_shapes (const Cell::shapes_type *shapes, unsigned int hint) const
+{
+  shapes_map::const_iterator s = m_shapes_map.find (hint);
+  if (s != m_shapes_map.end () && &s->second == shapes) {
+    return hint;
+  } else {
+    return index_of_shapes (shapes);
+  }
+}
+
 void
 Cell::clear_shapes ()
 {
@@ -300,6 +346,26 @@ Cell::update_bbox (unsigned int layers)
     
   }
 
+  //  lazy cells contribute the bboxes of the shapes not loaded yet
+  if (is_lazy ()) {
+
+    const box_map &bb = mp_layout->lazy_cell_loader ()->shape_bboxes (m_cell_index);
+    for (box_map::const_iterator sb = bb.begin (); sb != bb.end (); ++sb) {
+
+      if (! sb->second.empty ()) {
+        m_bbox += sb->second;
+        box_map::iterator b = m_bboxes.find (sb->first);
+        if (b == m_bboxes.end ()) {
+           m_bboxes.insert (*sb);
+        } else {
+           b->second += sb->second;
+        }
+      }
+
+    }
+
+  }
+
   //  update the bboxes of the shapes lists
   for (shapes_map::iterator s = m_shapes_map.begin (); s != m_shapes_map.end (); ++s) {
 
@@ -379,6 +445,14 @@ Cell::sort_shapes ()
   }
 }
 
+void 
+Cell::pack_shapes (db::Arena *arena)
+{
+  for (shapes_map::iterator s = m_shapes_map.begin (); s != m_shapes_map.end (); ++s) {
+    s->second.pack (arena);
+  }
+}
+
 void
 Cell::prop_id (db::properties_id_type id) 
 {
@@ -609,6 +683,16 @@ Cell::collect_mem_stat (db::MemStatistics &m) const
 void 
 Cell::clear_shapes_no_invalidate ()
 {
+  if (is_lazy ()) {
+    if (manager () && manager ()->transacting ()) {
+      //  load the shapes first, so clearing them can be undone
+      load_lazy ();
+    } else {
+      //  the shapes not loaded yet are dropped (synchronized with loads from other threads)
+      mp_layout->lazy_cell_loader ()->discard (*this);
+    }
+  }
+
   //  Hint: we can't simply clear the map because of the undo stack
   for (shapes_map::iterator s = m_shapes_map.begin (); s != m_shapes_map.end (); ++s) {
     s->second.clear ();
@@ -616,6 +700,13 @@ Cell::clear_shapes_no_invalidate ()
   m_bbox_needs_update = true;
 }
 
+void
+Cell::load_lazy () const
+{
+  tl_assert (mp_layout->lazy_cell_loader () != 0);
+  mp_layout->lazy_cell_loader ()->load (*mp_layout, m_cell_index);
+}
+
 unsigned int 
 Cell::count_hier_levels () const
 {
@@ -42,6 +42,8 @@
 #include "tlAlgorithm.h"
 #include "gsi.h"
 
+#include <QAtomicInt>
+
 #include <map>
 #include <set>
 
@@ -57,6 +59,9 @@ template <class Coord> class generic_repository;
 class Layout;
 class Library;
 class ImportLayerMapping;
+class LazyCellLoader;
+class Arena;
+class CellUpdateOp;
 
 /**
  *  @brief The cell object
@@ -101,6 +106,8 @@ public:
   friend class db::cell_list_iterator<Cell>;
   friend class db::cell_list_const_iterator<Cell>;
   friend class db::Instances;
+  friend class db::LazyCellLoader;
+  friend class db::CellUpdateOp;
 
   /**
    *  @brief The destructor
@@ -160,6 +167,14 @@ public:
    */
   unsigned int index_of_shapes (const shapes_type *shapes) const;
 
+  /**
+   *  @brief Gets the index of a given shapes array using a hint
+   *
+   *  If the hint is the index of the shapes container, this method is fast. Otherwise
+   *  it falls back to the linear search of the other version.
+   */
+  unsigned int index_of_shapes (const shapes_type *shapes, unsigned int hint) const;
+
   /**
    *  @brief Clear all shapes in the cell
    */
@@ -315,6 +330,9 @@ public:
   template <class Trans>
   void transform_into (const Trans &t)
   {
+    if (is_lazy ()) {
+      load_lazy ();
+    }
     m_instances.transform_into (t);
     for (typename shapes_map::iterator s = m_shapes_map.begin (); s != m_shapes_map.end (); ++s) {
       if (! s->second.empty ()) {
@@ -482,6 +500,13 @@ public:
    */
   void sort_shapes ();
 
+  /**
+   *  @brief Sorts and packs the shapes lists
+   *
+   *  See db::Shapes::pack for a description of packing and the arena.
+   */
+  void pack_shapes (db::Arena *arena = 0);
+
   /**
    *  @brief Retrieve the bounding box of the cell
    *
@@ -854,6 +879,22 @@ public:
     m_ghost_cell = g;
   }
 
+  /**
+   *  @brief Returns a value indicating whether the cell is a lazy cell
+   *
+   *  The shapes of a lazy cell have not been loaded yet. They are loaded
+   *  through the layout's lazy cell loader when they are accessed for the 
+   *  first time. The bounding boxes of lazy cells are available without
+   *  loading the shapes. See db::LazyCellLoader for details.
+   *
+   *  This method may be called from any thread: once it returns false, the shapes
+   *  loaded by another thread are visible to the calling thread.
+   */
+  bool is_lazy () const
+  {
+    return m_lazy.fetchAndAddAcquire (0) != 0;
+  }
+
   /**
    *  @brief Returns a value indicating whether the cell is empty
    *
@@ -952,6 +993,10 @@ private:
   unsigned int m_hier_levels : 29;
   bool m_bbox_needs_update : 1;
   bool m_ghost_cell : 1;
+  //  NOTE: the lazy flag is not a bit field since it is reset by the loader, which may run in a
+  //  different thread. Setting it with release and reading it with acquire semantics makes sure
+  //  the loaded shapes are visible once the flag is reset.
+  mutable QAtomicInt m_lazy;
 
   static box_type ms_empty_box;
 
@@ -961,6 +1006,9 @@ private:
   //  clear the shapes without telling the graph
   void clear_shapes_no_invalidate ();
 
+  //  loads the shapes of a lazy cell
+  void load_lazy () const;
+
   //  helper function for computing the number of hierarchy levels
   //  must be called bottom-up
   unsigned int count_hier_levels () const;
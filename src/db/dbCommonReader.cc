@@ -24,10 +24,23 @@
 
 #include "dbCommonReader.h"
 #include "dbStream.h"
+#include "tlString.h"
+
+#include <cstdlib>
 
 namespace db
 {
 
+// ---------------------------------------------------------------
+//  CommonReaderOptions implementation
+
+std::string
+CommonReaderOptions::default_layout_cache_dir ()
+{
+  const char *env = getenv ("KLAYOUT_LAYOUT_CACHE");
+  return env ? tl::system_to_string (env) : std::string ();
+}
+
 // ---------------------------------------------------------------
 //  Common format declaration
 
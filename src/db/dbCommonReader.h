@@ -44,7 +44,9 @@ public:
   CommonReaderOptions ()
     : create_other_layers (true),
       enable_text_objects (true),
-      enable_properties (true)
+      enable_properties (true),
+      lazy_loading (false),
+      layout_cache_dir (default_layout_cache_dir ())
   {
     //  .. nothing yet ..
   }
@@ -83,6 +85,35 @@ public:
    */
   bool enable_properties;
 
+  /**
+   *  @brief A flag indicating whether to load the shapes of the cells on demand
+   *
+   *  If this flag is set to true, the reader only keeps the hierarchy and the 
+   *  bounding boxes of the cells. The shapes are read from the file when a cell's
+   *  shapes are accessed for the first time. This requires the file to stay 
+   *  available. Readers may fall back to normal reading, e.g. for compressed
+   *  files or streams which cannot be reopened.
+   */
+  bool lazy_loading;
+
+  /**
+   *  @brief The directory of the persistent layout cache
+   *
+   *  If a cache directory is given, layouts are stored in the cache after they have been
+   *  read and taken from there when the same file is read again with the same options
+   *  (see db::LayoutCache). An empty string disables the cache.
+   *  The default is taken from the KLAYOUT_LAYOUT_CACHE environment variable.
+   */
+  std::string layout_cache_dir;
+
+  /**
+   *  @brief Gets the default layout cache directory
+   *
+   *  This is the value of the KLAYOUT_LAYOUT_CACHE environment variable or an empty string
+   *  if the variable is not set.
+   */
+  static std::string default_layout_cache_dir ();
+
   /** 
    *  @brief Implementation of FormatSpecificReaderOptions
    */
@@ -0,0 +1,161 @@
+
+/*
+
+  KLayout Layout Viewer
+  Copyright (C) 2006-2017 Matthias Koefferlein
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+
+
+#ifndef HDR_dbContentHash
+#define HDR_dbContentHash
+
+#include "dbTypes.h"
+#include "dbPoint.h"
+#include "dbVector.h"
+#include "dbPolygon.h"
+#include "dbTrans.h"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+namespace db
+{
+
+/**
+ *  @brief Mixes the bits of a 64 bit value (the MurmurHash3 finalizer)
+ */
+inline uint64_t
+hash_mix (uint64_t h)
+{
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+/**
+ *  @brief An ordered 64 bit hash over a sequence of values
+ *
+ *  In contrast to the hash functions from dbHash.h, this hash is intended to identify
+ *  content: the values are mixed thoroughly, so two different objects are very unlikely
+ *  to produce the same hash. Order-independent hashes of object sets can be formed by
+ *  summing up the hash values of the objects.
+ */
+class ContentHash
+{
+public:
+  ContentHash ()
+    : m_h (0)
+  {
+    //  .. nothing yet ..
+  }
+
+  void add (uint64_t v)
+  {
+    m_h = hash_mix (m_h ^ hash_mix (v + 0x9e3779b97f4a7c15ULL));
+  }
+
+  void add (const db::Point &p)
+  {
+    add (uint64_t (int64_t (p.x ())));
+    add (uint64_t (int64_t (p.y ())));
+  }
+
+  void add (const db::Vector &v)
+  {
+    add (uint64_t (int64_t (v.x ())));
+    add (uint64_t (int64_t (v.y ())));
+  }
+
+  void add (double d)
+  {
+    //  The value is hashed exactly: compares with a tolerance consider values equal which
+    //  are very close, so any rounding here would map some different values to the same hash.
+    //  Values which are equal within the tolerance merely produce different hashes.
+    if (d == 0.0) {
+      d = 0.0;  //  normalizes -0.0
+    }
+    uint64_t v = 0;
+    memcpy (&v, &d, std::min (sizeof (v), sizeof (d)));
+    add (v);
+  }
+
+  void add (const char *s)
+  {
+    //  FNV-1a
+    uint64_t h = 14695981039346656037ULL;
+    for ( ; *s; ++s) {
+      h ^= (unsigned char) *s;
+      h *= 1099511628211ULL;
+    }
+    add (h);
+  }
+
+  void add (const db::ICplxTrans &t)
+  {
+    add (t.mcos ());
+    add (t.msin ());
+    add (t.mag ());
+    add (uint64_t (t.is_mirror ()));
+    //  the displacement is taken unrounded
+    db::DVector d = db::DCplxTrans (t).disp ();
+    add (d.x ());
+    add (d.y ());
+  }
+
+  uint64_t value () const
+  {
+    return m_h;
+  }
+
+private:
+  uint64_t m_h;
+};
+
+/**
+ *  @brief Computes a content hash for a polygon
+ *
+ *  The hash is formed from the set of edges, so it does not depend on the
+ *  start point of the contours.
+ */
+inline uint64_t
+polygon_content_hash (const db::Polygon &poly)
+{
+  uint64_t eh = 0;
+  for (db::Polygon::polygon_edge_iterator e = poly.begin_edge (); !e.at_end (); ++e) {
+    ContentHash h;
+    h.add ((*e).p1 ());
+    h.add ((*e).p2 ());
+    eh += h.value ();
+  }
+
+  ContentHash h;
+  h.add (uint64_t (poly.holes ()));
+  h.add (uint64_t (poly.vertices ()));
+  h.add (eh);
+  return h.value ();
+}
+
+}
+
+#endif
+
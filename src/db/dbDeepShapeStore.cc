@@ -0,0 +1,285 @@
+
+/*
+
+  KLayout Layout Viewer
+  Copyright (C) 2006-2017 Matthias Koefferlein
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+
+#include "dbDeepShapeStore.h"
+#include "tlUtils.h"
+
+namespace db
+{
+
+// ----------------------------------------------------------------------------------
+//  DeepLayer implementation
+
+DeepLayer::DeepLayer ()
+  : mp_store (), m_layout_index (0), m_layer (0)
+{
+  //  .. nothing yet ..
+}
+
+DeepLayer::DeepLayer (DeepShapeStore *store, unsigned int layout_index, unsigned int layer)
+  : mp_store (store), m_layout_index (layout_index), m_layer (layer)
+{
+  if (store) {
+    store->add_ref (m_layout_index, m_layer);
+  }
+}
+
+DeepLayer::DeepLayer (const DeepLayer &other)
+  : mp_store (other.mp_store), m_layout_index (other.m_layout_index), m_layer (other.m_layer)
+{
+  if (mp_store.get ()) {
+    mp_store->add_ref (m_layout_index, m_layer);
+  }
+}
+
+DeepLayer &
+DeepLayer::operator= (const DeepLayer &other)
+{
+  if (this != &other) {
+    DeepLayer tmp (other);
+    swap (tmp);
+  }
+  return *this;
+}
+
+DeepLayer::~DeepLayer ()
+{
+  reset ();
+}
+
+void
+DeepLayer::reset ()
+{
+  if (mp_store.get ()) {
+    mp_store->remove_ref (m_layout_index, m_layer);
+  }
+  mp_store.reset (0);
+  m_layout_index = 0;
+  m_layer = 0;
+}
+
+void
+DeepLayer::swap (DeepLayer &other)
+{
+  //  NOTE: tl::weak_ptr does not offer swap, hence we do it the explicit way
+  tl::weak_ptr<DeepShapeStore> s (other.mp_store);
+  other.mp_store = mp_store;
+  mp_store = s;
+  std::swap (m_layout_index, other.m_layout_index);
+  std::swap (m_layer, other.m_layer);
+}
+
+db::Layout &
+DeepLayer::layout () const
+{
+  tl_assert (is_valid ());
+  return store ()->layout (m_layout_index);
+}
+
+db::Cell &
+DeepLayer::initial_cell () const
+{
+  tl_assert (is_valid ());
+  return layout ().cell (store ()->initial_cell (m_layout_index));
+}
+
+DeepLayer
+DeepLayer::derived () const
+{
+  tl_assert (is_valid ());
+  return DeepLayer (store (), m_layout_index, store ()->new_layer (m_layout_index));
+}
+
+db::RecursiveShapeIterator
+DeepLayer::iter () const
+{
+  tl_assert (is_valid ());
+  return db::RecursiveShapeIterator (layout (), initial_cell (), m_layer);
+}
+
+// ----------------------------------------------------------------------------------
+//  DeepShapeStore implementation
+
+DeepShapeStore::LayoutHolder::LayoutHolder ()
+  : layout (new db::Layout ()), top_cell (0), has_complex_instances (false)
+{
+  //  .. nothing yet ..
+}
+
+DeepShapeStore::LayoutHolder::~LayoutHolder ()
+{
+  delete layout;
+  layout = 0;
+}
+
+DeepShapeStore::DeepShapeStore ()
+{
+  //  .. nothing yet ..
+}
+
+DeepShapeStore::~DeepShapeStore ()
+{
+  for (std::vector<LayoutHolder *>::const_iterator l = m_layouts.begin (); l != m_layouts.end (); ++l) {
+    delete *l;
+  }
+  m_layouts.clear ();
+}
+
+bool
+DeepShapeStore::is_valid_layout_source (const db::RecursiveShapeIterator &si)
+{
+  return si.layout () != 0 && si.top_cell () != 0 &&
+         si.region () == db::Box::world () && ! si.has_complex_region () &&
+         si.min_depth () <= 0 && si.max_depth () == std::numeric_limits<int>::max () &&
+         ! si.has_cell_selection () && si.shape_property_selector () == 0;
+}
+
+size_t
+DeepShapeStore::layers () const
+{
+  size_t n = 0;
+  for (std::vector<LayoutHolder *>::const_iterator l = m_layouts.begin (); l != m_layouts.end (); ++l) {
+    n += (*l)->layer_refs.size ();
+  }
+  return n;
+}
+
+unsigned int
+DeepShapeStore::layout_for_source (const db::Layout &layout, const db::Cell &top)
+{
+  source_key_type key (&layout, top.cell_index ());
+  std::map<source_key_type, unsigned int>::const_iterator lm = m_layout_map.find (key);
+  if (lm != m_layout_map.end ()) {
+    return lm->second;
+  }
+
+  unsigned int index = (unsigned int) m_layouts.size ();
+  m_layouts.push_back (new LayoutHolder ());
+  m_layout_map.insert (std::make_pair (key, index));
+
+  LayoutHolder &holder = *m_layouts.back ();
+  db::Layout &target = *holder.layout;
+  target.dbu (layout.dbu ());
+
+  //  replicate the cell tree below the top cell
+  std::set<db::cell_index_type> called;
+  top.collect_called_cells (called);
+  called.insert (top.cell_index ());
+
+  for (std::set<db::cell_index_type>::const_iterator c = called.begin (); c != called.end (); ++c) {
+    holder.cell_map.insert (std::make_pair (*c, target.add_cell (layout.cell_name (*c))));
+  }
+
+  holder.top_cell = holder.cell_map [top.cell_index ()];
+
+  tl::map_map<db::cell_index_type> im (holder.cell_map);
+  tl::const_map<db::properties_id_type> pm (0);
+
+  for (std::set<db::cell_index_type>::const_iterator c = called.begin (); c != called.end (); ++c) {
+    const db::Cell &source_cell = layout.cell (*c);
+    db::Cell &target_cell = target.cell (holder.cell_map [*c]);
+    for (db::Cell::const_iterator i = source_cell.begin (); ! i.at_end (); ++i) {
+      if (i->cell_inst ().is_complex ()) {
+        holder.has_complex_instances = true;
+      }
+      target_cell.insert (*i, im, pm);
+    }
+  }
+
+  return index;
+}
+
+DeepLayer
+DeepShapeStore::create_polygon_layer (const db::RecursiveShapeIterator &si)
+{
+  tl_assert (is_valid_layout_source (si));
+
+  const db::Layout &source = *si.layout ();
+  unsigned int layout_index = layout_for_source (source, *si.top_cell ());
+  LayoutHolder &holder = *m_layouts [layout_index];
+
+  DeepLayer dl (this, layout_index, new_layer (layout_index));
+
+  std::vector<unsigned int> layers;
+  if (si.multiple_layers ()) {
+    layers = si.layers ();
+  } else {
+    layers.push_back (si.layer ());
+  }
+
+  unsigned int flags = si.shape_flags () & (db::ShapeIterator::Polygons | db::ShapeIterator::Boxes | db::ShapeIterator::Paths);
+
+  db::Polygon poly;
+  for (std::map<db::cell_index_type, db::cell_index_type>::const_iterator cm = holder.cell_map.begin (); cm != holder.cell_map.end (); ++cm) {
+
+    const db::Cell &source_cell = source.cell (cm->first);
+    db::Shapes &target_shapes = holder.layout->cell (cm->second).shapes (dl.layer ());
+
+    for (std::vector<unsigned int>::const_iterator l = layers.begin (); l != layers.end (); ++l) {
+      if (source.is_valid_layer (*l)) {
+        for (db::ShapeIterator s = source_cell.shapes (*l).begin (flags); ! s.at_end (); ++s) {
+          s->polygon (poly);
+          target_shapes.insert (poly);
+        }
+      }
+    }
+
+  }
+
+  return dl;
+}
+
+unsigned int
+DeepShapeStore::new_layer (unsigned int layout)
+{
+  tl_assert (layout < m_layouts.size ());
+  LayoutHolder &holder = *m_layouts [layout];
+  unsigned int layer = holder.layout->insert_layer ();
+  holder.layer_refs [layer] = 0;
+  return layer;
+}
+
+void
+DeepShapeStore::add_ref (unsigned int layout, unsigned int layer)
+{
+  tl_assert (layout < m_layouts.size ());
+  m_layouts [layout]->layer_refs [layer] += 1;
+}
+
+void
+DeepShapeStore::remove_ref (unsigned int layout, unsigned int layer)
+{
+  tl_assert (layout < m_layouts.size ());
+  LayoutHolder &holder = *m_layouts [layout];
+
+  std::map<unsigned int, size_t>::iterator r = holder.layer_refs.find (layer);
+  tl_assert (r != holder.layer_refs.end () && r->second > 0);
+
+  if (--r->second == 0) {
+    holder.layer_refs.erase (r);
+    holder.layout->delete_layer (layer);
+  }
+}
+
+}
+
@@ -0,0 +1,296 @@
+
+/*
+
+  KLayout Layout Viewer
+  Copyright (C) 2006-2017 Matthias Koefferlein
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+
+#ifndef HDR_dbDeepShapeStore
+#define HDR_dbDeepShapeStore
+
+#include "dbCommon.h"
+
+#include "dbLayout.h"
+#include "dbRecursiveShapeIterator.h"
+#include "tlObject.h"
+#include "tlTypeTraits.h"
+#include "gsiObject.h"
+
+#include <map>
+#include <vector>
+
+namespace db
+{
+
+class DeepShapeStore;
+
+/**
+ *  @brief Represents a shape layer inside a deep shape store
+ *
+ *  A deep layer is a handle to a layer inside one of the working layouts of a
+ *  DeepShapeStore. The layer is reference counted: when the last handle to a
+ *  layer is released, the layer is removed from the store.
+ */
+class DB_PUBLIC DeepLayer
+{
+public:
+  /**
+   *  @brief Default constructor: creates an invalid deep layer
+   */
+  DeepLayer ();
+
+  /**
+   *  @brief Copy constructor
+   */
+  DeepLayer (const DeepLayer &other);
+
+  /**
+   *  @brief Assignment
+   */
+  DeepLayer &operator= (const DeepLayer &other);
+
+  /**
+   *  @brief Destructor
+   */
+  ~DeepLayer ();
+
+  /**
+   *  @brief Returns true, if the deep layer is valid (refers to a store)
+   */
+  bool is_valid () const
+  {
+    return mp_store.get () != 0;
+  }
+
+  /**
+   *  @brief Releases the layer
+   *
+   *  After this method has been called, the layer is invalid.
+   */
+  void reset ();
+
+  /**
+   *  @brief Swaps two deep layers
+   */
+  void swap (DeepLayer &other);
+
+  /**
+   *  @brief Returns true, if both layers live inside the same working layout of the same store
+   *
+   *  Only layers inside the same working layout can be combined hierarchically.
+   */
+  bool is_compatible (const DeepLayer &other) const
+  {
+    return is_valid () && mp_store.get () == other.mp_store.get () && m_layout_index == other.m_layout_index;
+  }
+
+  /**
+   *  @brief Gets the store the layer lives in
+   */
+  DeepShapeStore *store () const
+  {
+    return const_cast<DeepShapeStore *> (mp_store.get ());
+  }
+
+  /**
+   *  @brief Gets the index of the working layout inside the store
+   */
+  unsigned int layout_index () const
+  {
+    return m_layout_index;
+  }
+
+  /**
+   *  @brief Gets the layer index inside the working layout
+   */
+  unsigned int layer () const
+  {
+    return m_layer;
+  }
+
+  /**
+   *  @brief Gets the working layout
+   */
+  db::Layout &layout () const;
+
+  /**
+   *  @brief Gets the top cell of the working layout
+   */
+  db::Cell &initial_cell () const;
+
+  /**
+   *  @brief Creates a new, empty layer inside the same working layout
+   */
+  DeepLayer derived () const;
+
+  /**
+   *  @brief Creates a recursive shape iterator delivering the shapes of this layer
+   */
+  db::RecursiveShapeIterator iter () const;
+
+private:
+  friend class DeepShapeStore;
+
+  DeepLayer (DeepShapeStore *store, unsigned int layout_index, unsigned int layer);
+
+  tl::weak_ptr<DeepShapeStore> mp_store;
+  unsigned int m_layout_index;
+  unsigned int m_layer;
+};
+
+/**
+ *  @brief A store for hierarchical ("deep") shape layers
+ *
+ *  The deep shape store keeps working copies of layout hierarchies. For each
+ *  source hierarchy (a layout plus a top cell) one working layout is created
+ *  which replicates the cell tree below the top cell. Shape layers taken from
+ *  the source hierarchy are copied into the respective cells of the working
+ *  layout without flattening. Hierarchical operations (see db::HierarchicalProcessor)
+ *  use these layers as input and deliver their results as new layers of the
+ *  same working layout.
+ *
+ *  Regions made from recursive shape iterators with a deep shape store are
+ *  "deep regions". The store must be kept alive as long as deep regions made
+ *  from it are used.
+ */
+class DB_PUBLIC DeepShapeStore
+  : public tl::Object, public gsi::ObjectBase
+{
+public:
+  /**
+   *  @brief The constructor
+   */
+  DeepShapeStore ();
+
+  /**
+   *  @brief The destructor
+   */
+  ~DeepShapeStore ();
+
+  /**
+   *  @brief Returns true, if the given recursive shape iterator can be turned into a deep layer
+   *
+   *  Iterators with a region or complex region, depth limits, cell selections
+   *  or property selectors cannot be represented hierarchically. In addition, the
+   *  iterator needs to be based on a layout.
+   */
+  static bool is_valid_layout_source (const db::RecursiveShapeIterator &si);
+
+  /**
+   *  @brief Creates a deep polygon layer from the given recursive shape iterator
+   *
+   *  The boxes, polygons and paths delivered by the iterator are copied into the
+   *  working layout as polygons. The hierarchy is maintained. The iterator must
+   *  be a valid layout source (see is_valid_layout_source).
+   */
+  DeepLayer create_polygon_layer (const db::RecursiveShapeIterator &si);
+
+  /**
+   *  @brief Gets the number of working layouts
+   */
+  unsigned int layouts () const
+  {
+    return (unsigned int) m_layouts.size ();
+  }
+
+  /**
+   *  @brief Gets the working layout with the given index
+   */
+  db::Layout &layout (unsigned int n)
+  {
+    return *m_layouts [n]->layout;
+  }
+
+  /**
+   *  @brief Gets the working layout with the given index (const version)
+   */
+  const db::Layout &layout (unsigned int n) const
+  {
+    return *m_layouts [n]->layout;
+  }
+
+  /**
+   *  @brief Gets the top cell index of the working layout with the given index
+   */
+  db::cell_index_type initial_cell (unsigned int n) const
+  {
+    return m_layouts [n]->top_cell;
+  }
+
+  /**
+   *  @brief Returns true, if the working layout with the given index has complex instances
+   *
+   *  Complex instances are such with arbitrary angles or magnification. Operations
+   *  which are not invariant against such transformations (i.e. sizing) cannot be
+   *  performed hierarchically on such layouts.
+   */
+  bool has_complex_instances (unsigned int n) const
+  {
+    return m_layouts [n]->has_complex_instances;
+  }
+
+  /**
+   *  @brief Gets the number of layers currently held in the store
+   */
+  size_t layers () const;
+
+private:
+  friend class DeepLayer;
+
+  struct LayoutHolder
+  {
+    LayoutHolder ();
+    ~LayoutHolder ();
+
+    db::Layout *layout;
+    db::cell_index_type top_cell;
+    bool has_complex_instances;
+    std::map<db::cell_index_type, db::cell_index_type> cell_map;
+    std::map<unsigned int, size_t> layer_refs;
+  };
+
+  typedef std::pair<const db::Layout *, db::cell_index_type> source_key_type;
+
+  std::vector<LayoutHolder *> m_layouts;
+  std::map<source_key_type, unsigned int> m_layout_map;
+
+  DeepShapeStore (const DeepShapeStore &);
+  DeepShapeStore &operator= (const DeepShapeStore &);
+
+  unsigned int layout_for_source (const db::Layout &layout, const db::Cell &top);
+  void add_ref (unsigned int layout, unsigned int layer);
+  void remove_ref (unsigned int layout, unsigned int layer);
+  unsigned int new_layer (unsigned int layout);
+};
+
+}
+
+namespace tl
+{
+
+//  type traits for DeepShapeStore
+template <>
+struct type_traits<db::DeepShapeStore> : public type_traits<void> {
+  typedef tl::false_tag has_copy_constructor;
+};
+
+}
+
+#endif
+
@@ -27,6 +27,7 @@
 #include "dbLayout.h"
 #include "tlTimer.h"
 #include "tlProgress.h"
+#include "tlThreadedWorkers.h"
 #include "gsi.h"
 
 #include <vector>
@@ -954,7 +955,7 @@ BooleanOp2::compare_ns () const
 //  EdgeProcessor implementation
 
 EdgeProcessor::EdgeProcessor (bool report_progress, const std::string &progress_desc)
-  : m_report_progress (report_progress), m_progress_desc (progress_desc)
+  : m_report_progress (report_progress), m_progress_desc (progress_desc), m_threads (0)
 {
   mp_work_edges = new std::vector <WorkEdge> ();
   mp_cpvector = new std::vector <CutPoints> ();
@@ -985,6 +986,12 @@ EdgeProcessor::enable_progress (const std::string &progress_desc)
   m_progress_desc = progress_desc;
 }
 
+void 
+EdgeProcessor::set_threads (size_t n)
+{
+  m_threads = n;
+}
+
 void 
 EdgeProcessor::reserve (size_t n)
 {
@@ -1495,255 +1502,42 @@ get_intersections_per_band_any (std::vector <CutPoints> &cutpoints, std::vector
   }
 }
 
-void 
-EdgeProcessor::process (db::EdgeSink &es, EdgeEvaluatorBase &op)
+/**
+ *  @brief Runs the scan line evaluation (step 4 of the edge processor) on the given edges
+ *
+ *  The edges must be free of intersections and sorted by their lower y coordinate.
+ *  The scan lines start at "y" and continue up to (but excluding) "y_stop". Edges
+ *  starting below "y" are considered to be inside the scan line already. This way,
+ *  a horizontal stripe of the full edge set can be evaluated separately.
+ */
+static void
+process_scanlines (std::vector <WorkEdge> &edges, db::EdgeSink &es, EdgeEvaluatorBase &op, bool prefer_touch, bool selects_edges, db::Coord y, db::Coord y_stop, tl::AbsoluteProgress *progress, size_t todo_from, size_t todo_to)
 {
-  tl::SelfTimer timer (tl::verbosity () >= 31, "EdgeProcessor: process");
-
-  bool prefer_touch = op.prefer_touch (); 
-  bool selects_edges = op.selects_edges (); 
-  
-  db::Coord y;
-  std::vector <WorkEdge>::iterator future;
-
-  //  step 1: preparation
-
-  if (mp_work_edges->empty ()) {
-    es.start ();
-    es.flush ();
-    return;
-  }
-
-  mp_cpvector->clear ();
-
-  property_type n_props = 0;
-  for (std::vector <WorkEdge>::iterator e = mp_work_edges->begin (); e != mp_work_edges->end (); ++e) {
-    if (e->prop > n_props) {
-      n_props = e->prop;
-    }
-  }
-  ++n_props;
-
-  size_t todo_max = 1000000;
-
-  std::auto_ptr<tl::AbsoluteProgress> progress (0);
-  if (m_report_progress) {
-    if (m_progress_desc.empty ()) {
-      progress.reset (new tl::AbsoluteProgress (tl::to_string (QObject::tr ("Processing")), 1000));
-    } else {
-      progress.reset (new tl::AbsoluteProgress (m_progress_desc, 1000));
-    }
-    progress->set_format (tl::to_string (QObject::tr ("%.0f%%")));
-    progress->set_unit (todo_max / 100);
-  }
-
-  size_t todo_next = 0;
-  size_t todo = todo_next;
-  todo_next += (todo_max - todo) / 5;
-
-
-  //  step 2: find intersections
-  std::sort (mp_work_edges->begin (), mp_work_edges->end (), edge_ymin_compare<db::Coord> ());
-
-  y = edge_ymin ((*mp_work_edges) [0]);
-  future = mp_work_edges->begin ();
-
-  for (std::vector <WorkEdge>::iterator current = mp_work_edges->begin (); current != mp_work_edges->end (); ) {
-
-    if (m_report_progress) {
-      double p = double (std::distance (mp_work_edges->begin (), current)) / double (mp_work_edges->size ());
-      progress->set (size_t (double (todo_next - todo) * p) + todo);
-    }
-
-    size_t n = std::distance (current, future);
-    db::Coord yy = y;
-
-    //  Use as many scanlines as to fetch approx. 50% new edges into the scanline (this
-    //  is an empirically determined factor)
-    do {
-
-      while (future != mp_work_edges->end () && edge_ymin (*future) <= yy) {
-        ++future;
-      }
-
-      if (future != mp_work_edges->end ()) {
-        yy = edge_ymin (*future);
-      } else {
-        yy = std::numeric_limits <db::Coord>::max ();
-      }
-
-    } while (future != mp_work_edges->end () && std::distance (current, future) < long (n + n / 2));
-
-    bool is90 = true;
-
-    if (current != future) {
-
-      for (std::vector <WorkEdge>::iterator c = current; c != future && is90; ++c) {
-        if (c->dx () != 0 && c->dy () != 0) {
-          is90 = false;
-        }
-      }
-
-      if (is90) {
-        get_intersections_per_band_90 (*mp_cpvector, current, future, y, yy, selects_edges);
-      } else {
-        get_intersections_per_band_any (*mp_cpvector, current, future, y, yy, selects_edges);
-      }
-
-    }
-
-    y = yy;
-    for (std::vector <WorkEdge>::iterator c = current; c != future; ++c) {
-      //  Hint: we have to keep the edges ending a y (the new lower band limit) in the all angle case because these edges
-      //  may receive cutpoints because the enter the -0.5DBU region below the band
-      if ((!is90 && edge_ymax (*c) < y) || (is90 && edge_ymax (*c) <= y)) {
-        if (current != c) {
-          std::swap (*current, *c);
-        }
-        ++current;
-      }
-    }
-    
-  }
-
-  //  step 3: create new edges from the ones with cutpoints
-  //
-  //  Hint: when we create the edges from the cutpoints we use the projection to sort the cutpoints along the
-  //  edge. However, we have some freedom to connect the points which we use to avoid "z" configurations which could
-  //  create new intersections in a 1x1 pixel box.
-  
-  todo = todo_next;
-  todo_next += (todo_max - todo) / 5;
-
-  size_t n_work = mp_work_edges->size ();
-  size_t nw = 0;
-  for (size_t n = 0; n < n_work; ++n) {
-
-    if (m_report_progress) {
-      double p = double (n) / double (n_work);
-      progress->set (size_t (double (todo_next - todo) * p) + todo);
-    }
-
-    WorkEdge &ew = (*mp_work_edges) [n];
-
-    CutPoints *cut_points = ew.data ? & ((*mp_cpvector) [ew.data - 1]) : 0;
-    ew.data = 0;
-
-    if (ew.dy () == 0 && ! selects_edges) {
-
-      //  don't care about horizontal edges 
-
-    } else if (cut_points) {
-
-      if (cut_points->has_cutpoints && ! cut_points->cut_points.empty ()) {
-
-        db::Edge e = ew;
-        property_type p = ew.prop;
-        std::sort (cut_points->cut_points.begin (), cut_points->cut_points.end (), ProjectionCompare (e));
-
-        db::Point pll = e.p1 ();
-        db::Point pl = e.p1 ();
-
-        for (std::vector <db::Point>::iterator cp = cut_points->cut_points.begin (); cp != cut_points->cut_points.end (); ++cp) {
-          if (*cp != pl) {
-            WorkEdge ne = WorkEdge (db::Edge (pl, *cp), p);
-            if (pl.y () == pll.y () && ne.p2 ().x () != pl.x () && ne.p2 ().x () == pll.x ()) {
-              ne = db::Edge (pll, ne.p2 ());
-            } else if (pl.x () == pll.x () && ne.p2 ().y () != pl.y () && ne.p2 ().y () == pll.y ()) {
-              ne = db::Edge (ne.p1 (), pll);
-            } else {
-              pll = pl;
-            }
-            pl = *cp;
-            if (selects_edges || ne.dy () != 0) {
-              if (nw <= n) {
-                (*mp_work_edges) [nw++] = ne;
-              } else {
-                mp_work_edges->push_back (ne);
-              }
-            }
-          }
-        }
-
-        if (cut_points->cut_points.back () != e.p2 ()) {
-          WorkEdge ne = WorkEdge (db::Edge (pl, e.p2 ()), p);
-          if (pl.y () == pll.y () && ne.p2 ().x () != pl.x () && ne.p2 ().x () == pll.x ()) {
-            ne = db::Edge (pll, ne.p2 ());
-          } else if (pl.x () == pll.x () && ne.p2 ().y () != pl.y () && ne.p2 ().y () == pll.y ()) {
-            ne = db::Edge (ne.p1 (), pll);
-          }
-          if (selects_edges || ne.dy () != 0) {
-            if (nw <= n) {
-              (*mp_work_edges) [nw++] = ne;
-            } else {
-              mp_work_edges->push_back (ne);
-            }
-          }
-        }
-
-      } else {
-
-        if (nw < n) {
-          (*mp_work_edges) [nw] = (*mp_work_edges) [n];
-        }
-        ++nw;
-
-      }
-
-    } else {
-
-      if (nw < n) {
-        (*mp_work_edges) [nw] = (*mp_work_edges) [n];
-      }
-      ++nw;
-
-    }
-
-  }
+  size_t skip_unit = 1;
 
-  if (nw != n_work) {
-    mp_work_edges->erase (mp_work_edges->begin () + nw, mp_work_edges->begin () + n_work);
+  //  edges starting below the first scan line enter the scan line right away
+  std::vector <WorkEdge>::iterator future = edges.begin ();
+  while (future != edges.end () && edge_ymin (*future) < y) {
+    ++future;
   }
+  std::sort (edges.begin (), future, EdgeXAtYCompare2 (y));
 
-#ifdef DEBUG_EDGE_PROCESSOR
-  printf ("Output edges:\n");
-  for (std::vector <WorkEdge>::iterator c1 = mp_work_edges->begin (); c1 != mp_work_edges->end (); ++c1) { 
-    printf ("%s\n", c1->to_string().c_str ()); 
-  } 
-#endif
-
-
-  tl::SelfTimer timer2 (tl::verbosity () >= 41, "EdgeProcessor: production");
-
-  //  step 4: compute the result edges 
-  
-  es.start (); // call this as late as possible. This way, input containers can be identical with output containers ("clear" is done after the input is read)
-
-  op.reset ();
-  op.reserve (n_props);
-
-  std::sort (mp_work_edges->begin (), mp_work_edges->end (), edge_ymin_compare<db::Coord> ());
+  for (std::vector <WorkEdge>::iterator current = edges.begin (); current != edges.end () && y < y_stop; ) {
 
-  y = edge_ymin ((*mp_work_edges) [0]);
-  size_t skip_unit = 1;
-
-  future = mp_work_edges->begin ();
-  for (std::vector <WorkEdge>::iterator current = mp_work_edges->begin (); current != mp_work_edges->end (); ) {
-
-    if (m_report_progress) {
-      double p = double (std::distance (mp_work_edges->begin (), current)) / double (mp_work_edges->size ());
-      progress->set (size_t (double (todo_max - todo_next) * p) + todo_next);
+    if (progress) {
+      double p = double (std::distance (edges.begin (), current)) / double (edges.size ());
+      progress->set (size_t (double (todo_to - todo_from) * p) + todo_from);
     }
 
     std::vector <WorkEdge>::iterator f0 = future;
-    while (future != mp_work_edges->end () && edge_ymin (*future) <= y) {
+    while (future != edges.end () && edge_ymin (*future) <= y) {
       tl_assert (future->data == 0); // HINT: for development
       ++future;
     }
     std::sort (f0, future, EdgeXAtYCompare2 (y));
 
     db::Coord yy = std::numeric_limits <db::Coord>::max ();
-    if (future != mp_work_edges->end ()) {
+    if (future != edges.end ()) {
       yy = edge_ymin (*future);
     }
     for (std::vector <WorkEdge>::const_iterator c = current; c != future; ++c) {
@@ -1822,7 +1616,7 @@ EdgeProcessor::process (db::EdgeSink &es, EdgeEvaluatorBase &op)
             //  treat all edges crossing the scanline in a certain point
             for (std::vector <WorkEdge>::iterator cc = c; cc != f; ) {
 
-              std::vector <WorkEdge>::iterator e = mp_work_edges->end ();
+              std::vector <WorkEdge>::iterator e = edges.end ();
 
               int pn = 0, ps = 0;
 
@@ -1851,7 +1645,7 @@ EdgeProcessor::process (db::EdgeSink &es, EdgeEvaluatorBase &op)
 
                 if (cc->dy () != 0) {
 
-                  if (e == mp_work_edges->end () && edge_ymax (*cc) > y) {
+                  if (e == edges.end () && edge_ymax (*cc) > y) {
                     e = cc;
                   }
                   
@@ -1920,7 +1714,7 @@ EdgeProcessor::process (db::EdgeSink &es, EdgeEvaluatorBase &op)
 
               }
 
-              if (e != mp_work_edges->end ()) {
+              if (e != edges.end ()) {
 
                 db::Edge edge (*e);
 
@@ -2020,9 +1814,644 @@ EdgeProcessor::process (db::EdgeSink &es, EdgeEvaluatorBase &op)
     es.end_scanline (ysl);
 
   }
+}
+
+// -------------------------------------------------------------------------------
+//  Multi-threaded scan line evaluation
+
+/**
+ *  @brief An edge sink recording the events of a scan line stripe
+ *
+ *  The events are replayed into the actual sink in the order of the stripes.
+ *  Hence the actual sink receives the same sequence of scan lines than in the
+ *  single-threaded case.
+ *
+ *  Events are recorded starting from the scan line at "y_start". Scan lines 
+ *  before are used to establish the state of the evaluation only.
+ */
+class ScanlineRecorder
+  : public db::EdgeSink
+{
+public:
+  ScanlineRecorder ()
+    : m_y_start (0), m_recording (false)
+  {
+    //  .. nothing yet ..
+  }
 
+  void set_y_start (db::Coord y_start)
+  {
+    m_y_start = y_start;
+  }
+
+  virtual void put (const db::Edge &e)
+  {
+    if (m_recording) {
+      m_events.push_back (Event (Put, e));
+    }
+  }
+
+  virtual void crossing_edge (const db::Edge &e)
+  {
+    if (m_recording) {
+      m_events.push_back (Event (CrossingEdge, e));
+    }
+  }
+
+  virtual void skip_n (size_t n)
+  {
+    if (m_recording) {
+      m_events.push_back (Event (SkipN, db::Edge (), n));
+    }
+  }
+
+  virtual void begin_scanline (db::Coord y)
+  {
+    m_recording = (y >= m_y_start);
+    if (m_recording) {
+      m_events.push_back (Event (BeginScanline, db::Edge (), 0, y));
+    }
+  }
+
+  virtual void end_scanline (db::Coord y)
+  {
+    if (m_recording) {
+      m_events.push_back (Event (EndScanline, db::Edge (), 0, y));
+    }
+  }
+
+  void replay (db::EdgeSink &es) const
+  {
+    for (std::vector<Event>::const_iterator e = m_events.begin (); e != m_events.end (); ++e) {
+      switch (e->type) {
+      case Put:
+        es.put (e->edge);
+        break;
+      case CrossingEdge:
+        es.crossing_edge (e->edge);
+        break;
+      case SkipN:
+        es.skip_n (e->n);
+        break;
+      case BeginScanline:
+        es.begin_scanline (e->y);
+        break;
+      case EndScanline:
+        es.end_scanline (e->y);
+        break;
+      }
+    }
+  }
+
+private:
+  enum EventType { Put, CrossingEdge, SkipN, BeginScanline, EndScanline };
+
+  struct Event
+  {
+    Event (EventType t, const db::Edge &e, size_t _n = 0, db::Coord _y = 0)
+      : type (t), edge (e), n (_n), y (_y)
+    { }
+
+    EventType type;
+    db::Edge edge;
+    size_t n;
+    db::Coord y;
+  };
+
+  std::vector<Event> m_events;
+  db::Coord m_y_start;
+  bool m_recording;
+};
+
+/**
+ *  @brief Compares the start point of an edge with a y coordinate
+ */
+struct WorkEdgeStartsBelow
+{
+  bool operator() (const WorkEdge &e, db::Coord y) const
+  {
+    return edge_ymin (e) < y;
+  }
+};
+
+class ScanlineStripeJob
+  : public tl::JobBase
+{
+public:
+  ScanlineStripeJob (int nworkers, const std::vector <WorkEdge> &edges, const EdgeEvaluatorBase &op, size_t n_props, bool prefer_touch, bool selects_edges, size_t n_stripes)
+    : tl::JobBase (nworkers), 
+      mp_edges (&edges), mp_op (&op), m_n_props (n_props), m_prefer_touch (prefer_touch), m_selects_edges (selects_edges),
+      m_recorders (n_stripes), m_carried_edges (n_stripes), m_stripes_done (0)
+  {
+    //  .. nothing yet ..
+  }
+
+  const std::vector <WorkEdge> &edges () const
+  {
+    return *mp_edges;
+  }
+
+  const EdgeEvaluatorBase &op () const
+  {
+    return *mp_op;
+  }
+
+  size_t n_props () const
+  {
+    return m_n_props;
+  }
+
+  bool prefer_touch () const
+  {
+    return m_prefer_touch;
+  }
+
+  bool selects_edges () const
+  {
+    return m_selects_edges;
+  }
+
+  ScanlineRecorder &recorder (size_t stripe)
+  {
+    return m_recorders [stripe];
+  }
+
+  std::vector<size_t> &carried_edges (size_t stripe)
+  {
+    return m_carried_edges [stripe];
+  }
+
+  void stripe_done ()
+  {
+    QMutexLocker locker (&m_mutex);
+    ++m_stripes_done;
+  }
+
+  size_t stripes_done ()
+  {
+    QMutexLocker locker (&m_mutex);
+    return m_stripes_done;
+  }
+
+  virtual tl::Worker *create_worker ();
+
+private:
+  const std::vector <WorkEdge> *mp_edges;
+  const EdgeEvaluatorBase *mp_op;
+  size_t m_n_props;
+  bool m_prefer_touch, m_selects_edges;
+  std::vector<ScanlineRecorder> m_recorders;
+  std::vector<std::vector<size_t> > m_carried_edges;
+  size_t m_stripes_done;
+  QMutex m_mutex;
+};
+
+class ScanlineStripeTask
+  : public tl::Task
+{
+public:
+  ScanlineStripeTask (size_t stripe, db::Coord y_prev, db::Coord y, db::Coord y_stop)
+    : m_stripe (stripe), m_y_prev (y_prev), m_y (y), m_y_stop (y_stop)
+  {
+    //  .. nothing yet ..
+  }
+
+  size_t stripe () const
+  {
+    return m_stripe;
+  }
+
+  db::Coord y_prev () const
+  {
+    return m_y_prev;
+  }
+
+  db::Coord y () const
+  {
+    return m_y;
+  }
+
+  db::Coord y_stop () const
+  {
+    return m_y_stop;
+  }
+
+private:
+  size_t m_stripe;
+  db::Coord m_y_prev, m_y, m_y_stop;
+};
+
+class ScanlineStripeWorker
+  : public tl::Worker
+{
+public:
+  ScanlineStripeWorker (ScanlineStripeJob *job)
+    : tl::Worker (), mp_job (job)
+  {
+    //  .. nothing yet ..
+  }
+
+  void perform_task (tl::Task *task) 
+  {
+    ScanlineStripeTask *stripe_task = dynamic_cast <ScanlineStripeTask *> (task);
+    if (stripe_task) {
+      do_perform (stripe_task);
+      mp_job->stripe_done ();
+    }
+  }
+
+private:
+  ScanlineStripeJob *mp_job;
+
+  void do_perform (const ScanlineStripeTask *task)
+  {
+    //  The evaluation starts one scan line before the stripe. This scan line is not 
+    //  delivered but establishes the same state (specifically the intervals which can be 
+    //  skipped) as in the single-threaded case. Hence, the output of the stripe is 
+    //  identical to the output of the single-threaded algorithm.
+    //  Collect the edges which are present in the stripe: all edges starting below and not 
+    //  ending below the first scan line (collected by the job) and all edges starting inside 
+    //  the stripe. The latter form a range of the edges sorted by their start points. This 
+    //  way, the edges are taken in the same order than in the single-threaded case.
+    const std::vector <WorkEdge> &all_edges = mp_job->edges ();
+    const std::vector <size_t> &carried = mp_job->carried_edges (task->stripe ());
+
+    std::vector <WorkEdge>::const_iterator from = std::lower_bound (all_edges.begin (), all_edges.end (), task->y_prev (), WorkEdgeStartsBelow ());
+    std::vector <WorkEdge>::const_iterator to = std::lower_bound (from, all_edges.end (), task->y_stop (), WorkEdgeStartsBelow ());
+
+    std::vector <WorkEdge> edges;
+    edges.reserve (carried.size () + (to - from));
+    for (std::vector <size_t>::const_iterator i = carried.begin (); i != carried.end (); ++i) {
+      edges.push_back (all_edges [*i]);
+    }
+    edges.insert (edges.end (), from, to);
+
+    if (edges.empty ()) {
+      return;
+    }
+
+    std::auto_ptr<EdgeEvaluatorBase> op (mp_job->op ().clone ());
+    op->reset ();
+    op->reserve (mp_job->n_props ());
+
+    ScanlineRecorder &recorder = mp_job->recorder (task->stripe ());
+    recorder.set_y_start (task->y ());
+
+    process_scanlines (edges, recorder, *op, mp_job->prefer_touch (), mp_job->selects_edges (), task->y_prev (), task->y_stop (), 0, 0, 0);
+  }
+};
+
+tl::Worker *
+ScanlineStripeJob::create_worker ()
+{
+  return new ScanlineStripeWorker (this);
+}
+
+void 
+EdgeProcessor::process (db::EdgeSink &es, EdgeEvaluatorBase &op)
+{
+  tl::SelfTimer timer (tl::verbosity () >= 31, "EdgeProcessor: process");
+
+  bool prefer_touch = op.prefer_touch (); 
+  bool selects_edges = op.selects_edges (); 
+  
+  db::Coord y;
+  std::vector <WorkEdge>::iterator future;
+
+  //  step 1: preparation
+
+  if (mp_work_edges->empty ()) {
+    es.start ();
+    es.flush ();
+    return;
+  }
+
+  mp_cpvector->clear ();
+
+  property_type n_props = 0;
+  for (std::vector <WorkEdge>::iterator e = mp_work_edges->begin (); e != mp_work_edges->end (); ++e) {
+    if (e->prop > n_props) {
+      n_props = e->prop;
+    }
+  }
+  ++n_props;
+
+  size_t todo_max = 1000000;
+
+  std::auto_ptr<tl::AbsoluteProgress> progress (0);
+  if (m_report_progress) {
+    if (m_progress_desc.empty ()) {
+      progress.reset (new tl::AbsoluteProgress (tl::to_string (QObject::tr ("Processing")), 1000));
+    } else {
+      progress.reset (new tl::AbsoluteProgress (m_progress_desc, 1000));
+    }
+    progress->set_format (tl::to_string (QObject::tr ("%.0f%%")));
+    progress->set_unit (todo_max / 100);
+  }
+
+  size_t todo_next = 0;
+  size_t todo = todo_next;
+  todo_next += (todo_max - todo) / 5;
+
+
+  //  step 2: find intersections
+  std::sort (mp_work_edges->begin (), mp_work_edges->end (), edge_ymin_compare<db::Coord> ());
+
+  y = edge_ymin ((*mp_work_edges) [0]);
+  future = mp_work_edges->begin ();
+
+  for (std::vector <WorkEdge>::iterator current = mp_work_edges->begin (); current != mp_work_edges->end (); ) {
+
+    if (m_report_progress) {
+      double p = double (std::distance (mp_work_edges->begin (), current)) / double (mp_work_edges->size ());
+      progress->set (size_t (double (todo_next - todo) * p) + todo);
+    }
+
+    size_t n = std::distance (current, future);
+    db::Coord yy = y;
+
+    //  Use as many scanlines as to fetch approx. 50% new edges into the scanline (this
+    //  is an empirically determined factor)
+    do {
+
+      while (future != mp_work_edges->end () && edge_ymin (*future) <= yy) {
+        ++future;
+      }
+
+      if (future != mp_work_edges->end ()) {
+        yy = edge_ymin (*future);
+      } else {
+        yy = std::numeric_limits <db::Coord>::max ();
+      }
+
+    } while (future != mp_work_edges->end () && std::distance (current, future) < long (n + n / 2));
+
+    bool is90 = true;
+
+    if (current != future) {
+
+      for (std::vector <WorkEdge>::iterator c = current; c != future && is90; ++c) {
+        if (c->dx () != 0 && c->dy () != 0) {
+          is90 = false;
+        }
+      }
+
+      if (is90) {
+        get_intersections_per_band_90 (*mp_cpvector, current, future, y, yy, selects_edges);
+      } else {
+        get_intersections_per_band_any (*mp_cpvector, current, future, y, yy, selects_edges);
+      }
+
+    }
+
+    y = yy;
+    for (std::vector <WorkEdge>::iterator c = current; c != future; ++c) {
+      //  Hint: we have to keep the edges ending a y (the new lower band limit) in the all angle case because these edges
+      //  may receive cutpoints because the enter the -0.5DBU region below the band
+      if ((!is90 && edge_ymax (*c) < y) || (is90 && edge_ymax (*c) <= y)) {
+        if (current != c) {
+          std::swap (*current, *c);
+        }
+        ++current;
+      }
+    }
+    
+  }
+
+  //  step 3: create new edges from the ones with cutpoints
+  //
+  //  Hint: when we create the edges from the cutpoints we use the projection to sort the cutpoints along the
+  //  edge. However, we have some freedom to connect the points which we use to avoid "z" configurations which could
+  //  create new intersections in a 1x1 pixel box.
+  
+  todo = todo_next;
+  todo_next += (todo_max - todo) / 5;
+
+  size_t n_work = mp_work_edges->size ();
+  size_t nw = 0;
+  for (size_t n = 0; n < n_work; ++n) {
+
+    if (m_report_progress) {
+      double p = double (n) / double (n_work);
+      progress->set (size_t (double (todo_next - todo) * p) + todo);
+    }
+
+    WorkEdge &ew = (*mp_work_edges) [n];
+
+    CutPoints *cut_points = ew.data ? & ((*mp_cpvector) [ew.data - 1]) : 0;
+    ew.data = 0;
+
+    if (ew.dy () == 0 && ! selects_edges) {
+
+      //  don't care about horizontal edges 
+
+    } else if (cut_points) {
+
+      if (cut_points->has_cutpoints && ! cut_points->cut_points.empty ()) {
+
+        db::Edge e = ew;
+        property_type p = ew.prop;
+        std::sort (cut_points->cut_points.begin (), cut_points->cut_points.end (), ProjectionCompare (e));
+
+        db::Point pll = e.p1 ();
+        db::Point pl = e.p1 ();
+
+        for (std::vector <db::Point>::iterator cp = cut_points->cut_points.begin (); cp != cut_points->cut_points.end (); ++cp) {
+          if (*cp != pl) {
+            WorkEdge ne = WorkEdge (db::Edge (pl, *cp), p);
+            if (pl.y () == pll.y () && ne.p2 ().x () != pl.x () && ne.p2 ().x () == pll.x ()) {
+              ne = db::Edge (pll, ne.p2 ());
+            } else if (pl.x () == pll.x () && ne.p2 ().y () != pl.y () && ne.p2 ().y () == pll.y ()) {
+              ne = db::Edge (ne.p1 (), pll);
+            } else {
+              pll = pl;
+            }
+            pl = *cp;
+            if (selects_edges || ne.dy () != 0) {
+              if (nw <= n) {
+                (*mp_work_edges) [nw++] = ne;
+              } else {
+                mp_work_edges->push_back (ne);
+              }
+            }
+          }
+        }
+
+        if (cut_points->cut_points.back () != e.p2 ()) {
+          WorkEdge ne = WorkEdge (db::Edge (pl, e.p2 ()), p);
+          if (pl.y () == pll.y () && ne.p2 ().x () != pl.x () && ne.p2 ().x () == pll.x ()) {
+            ne = db::Edge (pll, ne.p2 ());
+          } else if (pl.x () == pll.x () && ne.p2 ().y () != pl.y () && ne.p2 ().y () == pll.y ()) {
+            ne = db::Edge (ne.p1 (), pll);
+          }
+          if (selects_edges || ne.dy () != 0) {
+            if (nw <= n) {
+              (*mp_work_edges) [nw++] = ne;
+            } else {
+              mp_work_edges->push_back (ne);
+            }
+          }
+        }
+
+      } else {
+
+        if (nw < n) {
+          (*mp_work_edges) [nw] = (*mp_work_edges) [n];
+        }
+        ++nw;
+
+      }
+
+    } else {
+
+      if (nw < n) {
+        (*mp_work_edges) [nw] = (*mp_work_edges) [n];
+      }
+      ++nw;
+
+    }
+
+  }
+
+  if (nw != n_work) {
+    mp_work_edges->erase (mp_work_edges->begin () + nw, mp_work_edges->begin () + n_work);
+  }
+
+#ifdef DEBUG_EDGE_PROCESSOR
+  printf ("Output edges:\n");
+  for (std::vector <WorkEdge>::iterator c1 = mp_work_edges->begin (); c1 != mp_work_edges->end (); ++c1) { 
+    printf ("%s\n", c1->to_string().c_str ()); 
+  } 
+#endif
+
+
+  tl::SelfTimer timer2 (tl::verbosity () >= 41, "EdgeProcessor: production");
+
+  //  step 4: compute the result edges 
+
+  std::sort (mp_work_edges->begin (), mp_work_edges->end (), edge_ymin_compare<db::Coord> ());
+
+  if (m_threads > 0 && process_in_stripes (es, op, n_props, progress.get (), todo_next, todo_max)) {
+    return;
+  }
+
+  es.start (); // call this as late as possible. This way, input containers can be identical with output containers ("clear" is done after the input is read)
+
+  op.reset ();
+  op.reserve (n_props);
+
+  if (! mp_work_edges->empty ()) {
+    process_scanlines (*mp_work_edges, es, op, prefer_touch, selects_edges, edge_ymin ((*mp_work_edges) [0]), std::numeric_limits <db::Coord>::max (), progress.get (), todo_next, todo_max);
+  }
+
+  es.flush ();
+
+}
+
+bool
+EdgeProcessor::process_in_stripes (db::EdgeSink &es, EdgeEvaluatorBase &op, property_type n_props, tl::AbsoluteProgress *progress, size_t todo_from, size_t todo_to)
+{
+  //  Below this number of edges per stripe, multi-threading does not pay off
+  const size_t min_edges_per_stripe = 1000;
+
+  //  Use more stripes than threads for a better balancing of the load
+  size_t n_stripes = std::min (m_threads * 4, mp_work_edges->size () / min_edges_per_stripe);
+  if (n_stripes < 2) {
+    return false;
+  }
+
+  //  evaluators which cannot be cloned need to run single-threaded
+  std::auto_ptr<EdgeEvaluatorBase> op_copy (op.clone ());
+  if (! op_copy.get ()) {
+    return false;
+  }
+
+  tl::SelfTimer timer (tl::verbosity () >= 41, "EdgeProcessor: multi-threaded production");
+
+  //  The stripe borders are placed at the start points of edges which are scan line
+  //  positions of the single-threaded algorithm too. Each stripe receives roughly the
+  //  same number of edges starting inside it.
+  std::vector<db::Coord> borders;
+  borders.push_back (edge_ymin (mp_work_edges->front ()));
+  for (size_t i = 1; i < n_stripes; ++i) {
+    db::Coord yb = edge_ymin ((*mp_work_edges) [(mp_work_edges->size () * i) / n_stripes]);
+    if (yb > borders.back ()) {
+      borders.push_back (yb);
+    }
+  }
+  borders.push_back (std::numeric_limits <db::Coord>::max ());
+
+  if (borders.size () < 3) {
+    return false;
+  }
+
+  n_stripes = borders.size () - 1;
+
+  //  Determine the scan line preceding each stripe border. As all edge end points are 
+  //  scan line positions, this is the last end point below the border.
+  std::vector<db::Coord> borders_prev (n_stripes, std::numeric_limits <db::Coord>::min ());
+  borders_prev [0] = borders [0];
+  for (std::vector <WorkEdge>::const_iterator e = mp_work_edges->begin (); e != mp_work_edges->end (); ++e) {
+    db::Coord ye[] = { edge_ymin (*e), edge_ymax (*e) };
+    for (unsigned int i = 0; i < 2; ++i) {
+      std::vector<db::Coord>::const_iterator b = std::upper_bound (borders.begin () + 1, borders.end () - 1, ye [i]);
+      if (b != borders.end () - 1) {
+        db::Coord &yp = borders_prev [b - borders.begin ()];
+        yp = std::max (yp, ye [i]);
+      }
+    }
+  }
+
+  ScanlineStripeJob job (int (m_threads), *mp_work_edges, *op_copy, n_props, op.prefer_touch (), op.selects_edges (), n_stripes);
+
+  //  Collect the edges starting below the scan line preceding a stripe and reaching into the stripe.
+  //  The preceding scan lines increase with the stripe index, so an edge is carried into a range of stripes.
+  //  The edges starting inside a stripe are taken by the stripe's task from the sorted edges directly.
+  for (size_t i = 0; i < mp_work_edges->size (); ++i) {
+    const WorkEdge &e = (*mp_work_edges) [i];
+    std::vector<db::Coord>::iterator b1 = std::upper_bound (borders_prev.begin (), borders_prev.end (), edge_ymin (e));
+    std::vector<db::Coord>::iterator b2 = std::upper_bound (b1, borders_prev.end (), edge_ymax (e));
+    for (std::vector<db::Coord>::iterator b = b1; b != b2; ++b) {
+      job.carried_edges (b - borders_prev.begin ()).push_back (i);
+    }
+  }
+
+  for (size_t i = 0; i < n_stripes; ++i) {
+    job.schedule (new ScanlineStripeTask (i, borders_prev [i], borders [i], borders [i + 1]));
+  }
+
+  try {
+
+    job.start ();
+    while (job.is_running ()) {
+      //  This may throw an exception, if the cancel button has been pressed.
+      if (progress) {
+        progress->set (size_t (double (todo_to - todo_from) * double (job.stripes_done ()) / double (n_stripes)) + todo_from);
+      }
+      job.wait (100);
+    }
+
+  } catch (tl::BreakException &ex) {
+    job.terminate ();
+    throw ex;
+  } catch (tl::Exception &ex) {
+    job.terminate ();
+    throw ex;
+  }
+
+  if (job.has_error ()) {
+    throw tl::Exception (tl::to_string (QObject::tr ("Errors occured during processing. First error message says:\n")) + job.error_messages ().front ());
+  }
+
+  //  deliver the scan lines of all stripes in the original order: this way, 
+  //  the polygons are stitched at the stripe borders by the receiver.
+  es.start ();
+  for (size_t i = 0; i < n_stripes; ++i) {
+    job.recorder (i).replay (es);
+  }
   es.flush ();
 
+  return true;
 }
 
 void
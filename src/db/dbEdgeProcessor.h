@@ -34,6 +34,11 @@
 #include <vector>
 #include <set>
 
+namespace tl
+{
+  class AbsoluteProgress;
+}
+
 namespace db
 {
 
@@ -192,6 +197,11 @@ private:
  *  At the beginning of the scan line, the "reset" method is called to bring the
  *  evaluator into a defined state. Each edge has an integer property that can be
  *  used to distinguish edges from different polygons or layers.
+ *
+ *  Evaluators which do not carry state from one scan line to the next can provide
+ *  a copy of themselves through "clone". This enables the multi-threaded mode of 
+ *  the edge processor. Evaluators which do not implement "clone" are always
+ *  run single-threaded.
  */
 class DB_PUBLIC EdgeEvaluatorBase
 {
@@ -209,6 +219,7 @@ public:
   virtual bool is_reset () const { return false; }
   virtual bool prefer_touch () const { return false; }
   virtual bool selects_edges () const { return false; }
+  virtual EdgeEvaluatorBase *clone () const { return 0; }
 };
 
 /**
@@ -374,6 +385,11 @@ public:
     return (m_wc_n == 0 && m_wc_s == 0);
   }
 
+  virtual EdgeEvaluatorBase *clone () const
+  {
+    return new GenericMerge<F> (*this);
+  }
+
 private:
   int m_wc_n, m_wc_s;
   F m_function;
@@ -458,6 +474,7 @@ public:
   virtual int edge (bool north, bool enter, property_type p);
   virtual int compare_ns () const;
   virtual bool is_reset () const { return m_zeroes == m_wcv_n.size () + m_wcv_s.size (); }
+  virtual EdgeEvaluatorBase *clone () const { return new BooleanOp (*this); }
 
 protected:
   template <class InsideFunc> bool result (int wca, int wcb, const InsideFunc &inside_a, const InsideFunc &inside_b) const;
@@ -501,6 +518,7 @@ public:
   virtual bool is_reset () const;
   virtual bool prefer_touch () const;
   virtual bool selects_edges () const;
+  virtual EdgeEvaluatorBase *clone () const { return new EdgePolygonOp (*this); }
 
 private:
   bool m_outside, m_include_touching;
@@ -530,6 +548,7 @@ public:
 
   virtual int edge (bool north, bool enter, property_type p);
   virtual int compare_ns () const;
+  virtual EdgeEvaluatorBase *clone () const { return new BooleanOp2 (*this); }
 
 private:
   int m_wc_mode_a, m_wc_mode_b;
@@ -560,6 +579,7 @@ public:
   virtual int edge (bool north, bool enter, property_type p);
   virtual int compare_ns () const;
   virtual bool is_reset () const { return m_zeroes == m_wcv_n.size () + m_wcv_s.size (); }
+  virtual EdgeEvaluatorBase *clone () const { return new MergeOp (*this); }
 
 private:
   int m_wc_n, m_wc_s;
@@ -605,6 +625,25 @@ public:
    */
   void disable_progress ();
 
+  /**
+   *  @brief Specifies the number of threads to use
+   *
+   *  If a value larger than 0 is given, the scan line evaluation is split into
+   *  horizontal stripes which are processed in parallel by the given number of 
+   *  threads. The results are identical to the single-threaded mode.
+   *  Only evaluators supporting "clone" can be run in multi-threaded mode.
+   *  A value of 0 (the default) will run the processor single-threaded.
+   */
+  void set_threads (size_t n);
+
+  /**
+   *  @brief Gets the number of threads used
+   */
+  size_t threads () const
+  {
+    return m_threads;
+  }
+
   /**
    *  @brief Reserve space for at least n edges
    */
@@ -942,6 +981,9 @@ private:
   std::vector <CutPoints> *mp_cpvector;
   bool m_report_progress;
   std::string m_progress_desc;
+  size_t m_threads;
+
+  bool process_in_stripes (db::EdgeSink &es, EdgeEvaluatorBase &op, property_type n_props, tl::AbsoluteProgress *progress, size_t todo_from, size_t todo_to);
 
   static size_t count_edges (const db::Polygon &q) 
   {
@@ -30,9 +30,141 @@
 #include "tlString.h"
 #include "tlClassRegistry.h"
 
+#include <memory>
+#include <cstring>
+
 namespace db
 {
 
+// ---------------------------------------------------------------
+//  GDS2LazyCellLoader
+
+/**
+ *  @brief The loader for the lazy cells of a GDS2 file
+ *
+ *  The loader maps the file again and reads the cells from the positions 
+ *  recorded by the reader. Before a cell is read, the loader checks whether 
+ *  the file has been modified in the meantime. The file must not be modified 
+ *  while a cell is being loaded.
+ */
+class GDS2LazyCellLoader
+  : public db::LazyCellLoader
+{
+public:
+  /**
+   *  @brief Creates a loader for the file the given stream reads from
+   *
+   *  Returns 0 if the stream's data cannot be mapped again, i.e. because it is
+   *  not a plain file.
+   */
+  static GDS2LazyCellLoader *create (const tl::InputStream &stream, const GDS2ReaderOptions &options, const CommonReaderOptions &common_options)
+  {
+    size_t length = 0;
+    const char *data = stream.mapped_block (length);
+    if (! data || stream.is_inflating ()) {
+      return 0;
+    }
+
+    try {
+
+      std::auto_ptr<GDS2LazyCellLoader> loader (new GDS2LazyCellLoader (stream.absolute_path (), options, common_options));
+
+      //  make sure we see the same file: the file must not have been modified since the stream was opened
+      size_t loader_length = 0;
+      const char *loader_data = loader->mp_stream->mapped_block (loader_length);
+      if (! loader_data || stream.source_modified () || loader_length != length || memcmp (loader_data, data, std::min (length, size_t (65536))) != 0) {
+        return 0;
+      }
+
+      return loader.release ();
+
+    } catch (tl::Exception &) {
+      return 0;
+    }
+  }
+
+  ~GDS2LazyCellLoader ()
+  {
+    delete mp_stream;
+    mp_stream = 0;
+  }
+
+  void add_cell (db::Layout &layout, db::cell_index_type cell_index, size_t pos, const box_map &bboxes)
+  {
+    m_positions [cell_index].push_back (pos);
+    make_lazy (layout, cell_index, bboxes);
+  }
+
+  bool has_cells () const
+  {
+    return ! m_positions.empty ();
+  }
+
+  void set_layer_map (const LayerMap &layer_map, double dbuu)
+  {
+    m_layer_map = layer_map;
+    m_dbuu = dbuu;
+  }
+
+protected:
+  virtual void read_cell (db::Layout &layout, db::cell_index_type cell_index)
+  {
+    std::map<db::cell_index_type, std::vector<size_t> >::const_iterator p = m_positions.find (cell_index);
+    if (p == m_positions.end () || ! mp_stream) {
+      return;
+    }
+
+    //  accessing the mapped file after it has been truncated would crash
+    if (mp_stream->source_modified ()) {
+      throw tl::Exception (tl::to_string (QObject::tr ("File has been modified since it was read - cannot load cell shapes: ")) + source ());
+    }
+
+    //  read the shapes into the scratch layout first, so loading does not modify the layout's repositories
+    db::Layout &scratch = scratch_layout (layout);
+    db::Cell &target = scratch.cell (scratch.add_cell ());
+
+    try {
+
+      GDS2Reader reader (*mp_stream);
+      for (std::vector<size_t>::const_iterator pos = p->second.begin (); pos != p->second.end (); ++pos) {
+        reader.read_lazy_cell (layout, cell_index, target, *pos, m_options, m_common_options, m_layer_map, m_dbuu);
+      }
+
+      db::Cell &cell = layout.cell (cell_index);
+      for (unsigned int l = 0; l < target.layers (); ++l) {
+        install_shapes (cell, l, target.shapes (l));
+      }
+
+    } catch (...) {
+      scratch.delete_cell (target.cell_index ());
+      throw;
+    }
+
+    scratch.delete_cell (target.cell_index ());
+  }
+
+  virtual void release_source ()
+  {
+    //  unmaps the file
+    delete mp_stream;
+    mp_stream = 0;
+  }
+
+private:
+  tl::InputStream *mp_stream;
+  GDS2ReaderOptions m_options;
+  CommonReaderOptions m_common_options;
+  LayerMap m_layer_map;
+  double m_dbuu;
+  std::map<db::cell_index_type, std::vector<size_t> > m_positions;
+
+  GDS2LazyCellLoader (const std::string &path, const GDS2ReaderOptions &options, const CommonReaderOptions &common_options)
+    : db::LazyCellLoader (path), mp_stream (0), m_options (options), m_common_options (common_options), m_dbuu (1.0)
+  {
+    mp_stream = new tl::InputStream (path);
+  }
+};
+
 // ---------------------------------------------------------------
 //  GDS2Reader
 
@@ -43,7 +175,8 @@ GDS2Reader::GDS2Reader (tl::InputStream &s)
     m_recptr (0),
     mp_rec_buf (0),
     m_stored_rec (0),
-    m_progress (tl::to_string (QObject::tr ("Reading GDS2 file")), 10000)
+    m_progress (tl::to_string (QObject::tr ("Reading GDS2 file")), 10000),
+    mp_lazy_loader (0)
 {
   m_progress.set_format (tl::to_string (QObject::tr ("%.0f MB")));
   m_progress.set_unit (1024 * 1024);
@@ -64,7 +197,71 @@ GDS2Reader::read (db::Layout &layout, const db::LoadLayoutOptions &options)
   --m_recnum;
   m_reclen = 0;
 
-  return basic_read (layout, m_common_options.layer_map, m_common_options.create_other_layers, m_common_options.enable_text_objects, m_common_options.enable_properties, m_options.allow_multi_xy_records, m_options.box_mode);
+  //  Lazy loading requires a loader which can map the file again. Only one loader 
+  //  per layout is supported, so the shapes are read directly when reading into 
+  //  a layout with lazy cells from another file.
+  mp_lazy_loader = 0;
+  if (m_common_options.lazy_loading && ! layout.lazy_cell_loader ()) {
+    mp_lazy_loader = GDS2LazyCellLoader::create (m_stream, m_options, m_common_options);
+  }
+
+  if (! mp_lazy_loader) {
+    set_lazy (false);
+    return basic_read (layout, m_common_options.layer_map, m_common_options.create_other_layers, m_common_options.enable_text_objects, m_common_options.enable_properties, m_options.allow_multi_xy_records, m_options.box_mode);
+  }
+
+  //  the loader needs to be installed before the layout is updated the first time
+  layout.set_lazy_cell_loader (mp_lazy_loader);
+  set_lazy (true);
+
+  try {
+    basic_read (layout, m_common_options.layer_map, m_common_options.create_other_layers, m_common_options.enable_text_objects, m_common_options.enable_properties, m_options.allow_multi_xy_records, m_options.box_mode);
+  } catch (...) {
+    mp_lazy_loader->set_layer_map (layer_map (), dbuu ());
+    mp_lazy_loader = 0;
+    throw;
+  }
+
+  mp_lazy_loader->set_layer_map (layer_map (), dbuu ());
+  if (! mp_lazy_loader->has_cells ()) {
+    layout.set_lazy_cell_loader (0);
+  }
+  mp_lazy_loader = 0;
+
+  return layer_map ();
+}
+
+void
+GDS2Reader::read_lazy_cell (db::Layout &layout, db::cell_index_type cell_index, db::Cell &target, size_t pos, const GDS2ReaderOptions &options, const CommonReaderOptions &common_options, const LayerMap &layer_map, double dbuu)
+{
+  m_options = options;
+  m_common_options = common_options;
+
+  m_stored_rec = 0;
+  m_recnum = 0;
+  --m_recnum;
+  m_reclen = 0;
+
+  m_stream.reset ();
+  if (pos > 0 && ! m_stream.get (pos)) {
+    error (tl::to_string (QObject::tr ("Unexpected end-of-file")));
+  }
+
+  GDS2ReaderBase::read_lazy_cell (layout, cell_index, target, layer_map, m_common_options.enable_text_objects, m_common_options.enable_properties, m_options.allow_multi_xy_records, m_options.box_mode, dbuu);
+}
+
+size_t
+GDS2Reader::stream_pos () const
+{
+  return m_stream.pos ();
+}
+
+void
+GDS2Reader::register_lazy_cell (db::Layout &layout, db::cell_index_type cell_index, size_t pos, const db::LazyCellLoader::box_map &bboxes)
+{
+  if (mp_lazy_loader) {
+    mp_lazy_loader->add_cell (layout, cell_index, pos, bboxes);
+  }
 }
 
 const LayerMap &
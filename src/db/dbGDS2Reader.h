@@ -40,6 +40,8 @@
 namespace db
 {
 
+class GDS2LazyCellLoader;
+
 /**
  *  @brief Structure that holds the GDS2 specific options for the reader
  */
@@ -169,6 +171,16 @@ public:
    */
   virtual const char *format () const { return "GDS2"; }
 
+  /**
+   *  @brief Reads the shapes of a lazy cell
+   *
+   *  This method is used by the lazy cell loader. "pos" is the position of the 
+   *  cell's content in the stream. The shapes are read into "target".
+   *  "layer_map" is the layer map and "dbuu" the database unit in user units 
+   *  from reading the file.
+   */
+  void read_lazy_cell (db::Layout &layout, db::cell_index_type cell_index, db::Cell &target, size_t pos, const GDS2ReaderOptions &options, const CommonReaderOptions &common_options, const LayerMap &layer_map, double dbuu);
+
 private:
   tl::InputStream &m_stream;
   size_t m_recnum;
@@ -180,6 +192,7 @@ private:
   db::GDS2ReaderOptions m_options;
   db::CommonReaderOptions m_common_options;
   tl::AbsoluteProgress m_progress;
+  GDS2LazyCellLoader *mp_lazy_loader;
 
   virtual void error (const std::string &txt);
   virtual void warn (const std::string &txt);
@@ -195,6 +208,8 @@ private:
   virtual void get_time (unsigned int *mod_time, unsigned int *access_time);
   virtual GDS2XY *get_xy_data (unsigned int &length);
   virtual void progress_checkpoint ();
+  virtual size_t stream_pos () const;
+  virtual void register_lazy_cell (db::Layout &layout, db::cell_index_type cell_index, size_t pos, const db::LazyCellLoader::box_map &bboxes);
 };
 
 }
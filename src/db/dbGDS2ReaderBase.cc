@@ -73,7 +73,9 @@ GDS2ReaderBase::GDS2ReaderBase ()
     m_read_texts (true),
     m_read_properties (true),
     m_allow_multi_xy_records (false),
-    m_box_mode (0)
+    m_box_mode (0),
+    m_lazy (false),
+    mp_lazy_bboxes (0)
 {
   // .. nothing yet ..
 }
@@ -235,6 +237,7 @@ GDS2ReaderBase::do_read (db::Layout &layout)
 {
   m_cellname = "";
   m_libname = "";
+  mp_lazy_bboxes = 0;
 
   //  read header
   if (get_record () != sHEADER) {
@@ -370,6 +373,16 @@ GDS2ReaderBase::do_read (db::Layout &layout)
           cell = 0;
         }
       }
+
+      //  In lazy mode, the shapes are not kept: only their per-layer bounding boxes are computed.
+      //  The shapes are read again when the cell is loaded.
+      db::LazyCellLoader::box_map lazy_bboxes;
+      size_t lazy_pos = 0;
+      mp_lazy_bboxes = 0;
+      if (m_lazy && cell) {
+        lazy_pos = stream_pos ();
+        mp_lazy_bboxes = &lazy_bboxes;
+      }
       
       long attr = 0;
       db::PropertiesRepository::properties_set cell_properties;
@@ -447,6 +460,14 @@ GDS2ReaderBase::do_read (db::Layout &layout)
         cell->prop_id (layout.properties_repository ().properties_id (cell_properties));
       }
 
+      //  turn the cell into a lazy cell if it has shapes
+      if (mp_lazy_bboxes) {
+        mp_lazy_bboxes = 0;
+        if (! lazy_bboxes.empty ()) {
+          register_lazy_cell (layout, cell_index, lazy_pos, lazy_bboxes);
+        }
+      }
+
     }
 
     m_cellname = "";
@@ -460,6 +481,67 @@ GDS2ReaderBase::do_read (db::Layout &layout)
   }
 }
 
+void
+GDS2ReaderBase::read_lazy_cell (db::Layout &layout, db::cell_index_type cell_index, db::Cell &target, const LayerMap &layer_map, bool enable_text_objects, bool enable_properties, bool allow_multi_xy_records, unsigned int box_mode, double dbuu)
+{
+  m_layer_map = layer_map;
+  m_read_texts = enable_text_objects;
+  m_read_properties = enable_properties;
+
+  m_allow_multi_xy_records = allow_multi_xy_records;
+  m_box_mode = box_mode;
+  m_dbuu = dbuu;
+
+  //  all layers have been created already
+  m_create_layers = false;
+  mp_lazy_bboxes = 0;
+
+  m_cellname = layout.cell_name (cell_index);
+
+  short rec_id = 0;
+  while ((rec_id = get_record ()) != sENDSTR) {
+
+    progress_checkpoint ();
+
+    if (rec_id == sPROPATTR || rec_id == sPROPVALUE) {
+
+      //  cell properties are present already
+
+    } else if (rec_id == sBOUNDARY) {
+
+      read_boundary (layout, target, false);
+
+    } else if (rec_id == sPATH) {
+
+      read_path (layout, target);
+
+    } else if (rec_id == sTEXT) {
+
+      read_text (layout, target);
+
+    } else if (rec_id == sBOX && m_box_mode == 1) {
+
+      read_box (layout, target);
+
+    } else if (rec_id == sBOX && m_box_mode == 2) {
+
+      read_boundary (layout, target, true);
+
+    } else if (rec_id == sSREF || rec_id == sAREF || rec_id == sBOX || rec_id == sNODE) {
+
+      //  instances are present already, boxes are ignored (the index pass has checked the
+      //  box mode) and NODE records are ignored.
+      while (get_record () != sENDEL) { }
+
+    } else {
+      error (tl::to_string (QObject::tr ("Invalid record or data type")));
+    }
+
+  }
+
+  m_cellname = "";
+}
+
 void
 GDS2ReaderBase::read_context_info_cell ()
 {
@@ -588,7 +670,9 @@ GDS2ReaderBase::read_boundary (db::Layout &layout, db::Cell &cell, bool from_box
       }
 
       std::pair<bool, db::properties_id_type> pp = finish_element (layout.properties_repository ());
-      if (pp.first) {
+      if (mp_lazy_bboxes) {
+        (*mp_lazy_bboxes) [ll.second] += db::Box (p1, p2);
+      } else if (pp.first) {
         cell.shapes (ll.second).insert (db::BoxWithProperties (db::Box (p1, p2), pp.second));
       } else {
         cell.shapes (ll.second).insert (db::Box (p1, p2));
@@ -647,10 +731,12 @@ GDS2ReaderBase::read_boundary (db::Layout &layout, db::Cell &cell, bool from_box
       } else {
         //  this will copy the polyon:
         std::pair<bool, db::properties_id_type> pp = finish_element (layout.properties_repository ());
-        if (pp.first) {
-          cell.shapes (ll.second).insert (db::SimplePolygonRefWithProperties (db::SimplePolygonRef (poly, layout.shape_repository ()), pp.second));
+        if (mp_lazy_bboxes) {
+          (*mp_lazy_bboxes) [ll.second] += poly.box ();
+        } else if (pp.first) {
+          cell.shapes (ll.second).insert (db::SimplePolygonRefWithProperties (db::SimplePolygonRef (poly, cell.layout ()->shape_repository ()), pp.second));
         } else {
-          cell.shapes (ll.second).insert (db::SimplePolygonRef (poly, layout.shape_repository ()));
+          cell.shapes (ll.second).insert (db::SimplePolygonRef (poly, cell.layout ()->shape_repository ()));
         }
       }
 
@@ -751,10 +837,12 @@ GDS2ReaderBase::read_path (db::Layout &layout, db::Cell &cell)
         warn (tl::to_string (QObject::tr ("PATH with less than two points encountered - interpretation may be different in other tools")));
       }
       std::pair<bool, db::properties_id_type> pp = finish_element (layout.properties_repository ());
-      if (pp.first) {
-        cell.shapes (ll.second).insert (db::PathRefWithProperties (db::PathRef (path, layout.shape_repository ()), pp.second));
+      if (mp_lazy_bboxes) {
+        (*mp_lazy_bboxes) [ll.second] += path.box ();
+      } else if (pp.first) {
+        cell.shapes (ll.second).insert (db::PathRefWithProperties (db::PathRef (path, cell.layout ()->shape_repository ()), pp.second));
       } else {
-        cell.shapes (ll.second).insert (db::PathRef (path, layout.shape_repository ()));
+        cell.shapes (ll.second).insert (db::PathRef (path, cell.layout ()->shape_repository ()));
       }
     }
 
@@ -877,10 +965,12 @@ GDS2ReaderBase::read_text (db::Layout &layout, db::Cell &cell)
     db::Text text (get_string (), t, size, font, ha, va);
 
     std::pair<bool, db::properties_id_type> pp = finish_element (layout.properties_repository ());
-    if (pp.first) {
-      cell.shapes (ll.second).insert (db::TextRefWithProperties (db::TextRef (text, layout.shape_repository ()), pp.second));
+    if (mp_lazy_bboxes) {
+      (*mp_lazy_bboxes) [ll.second] += text.box ();
+    } else if (pp.first) {
+      cell.shapes (ll.second).insert (db::TextRefWithProperties (db::TextRef (text, cell.layout ()->shape_repository ()), pp.second));
     } else {
-      cell.shapes (ll.second).insert (db::TextRef (text, layout.shape_repository ()));
+      cell.shapes (ll.second).insert (db::TextRef (text, cell.layout ()->shape_repository ()));
     }
 
   } else {
@@ -925,7 +1015,9 @@ GDS2ReaderBase::read_box (db::Layout &layout, db::Cell &cell)
 
     std::pair<bool, db::properties_id_type> pp = finish_element (layout.properties_repository ());
     if (! box.empty ()) {
-      if (pp.first) {
+      if (mp_lazy_bboxes) {
+        (*mp_lazy_bboxes) [ll.second] += box;
+      } else if (pp.first) {
         cell.shapes (ll.second).insert (db::BoxWithProperties (box, pp.second));
       } else {
         cell.shapes (ll.second).insert (box);
@@ -32,6 +32,7 @@
 
 #include "dbLayout.h"
 #include "dbReader.h"
+#include "dbLazyCellLoader.h"
 #include "tlStream.h"
 #include "dbStreamLayers.h"
 
@@ -90,11 +91,53 @@ protected:
    */
   const LayerMap &basic_read (db::Layout &layout, const LayerMap &layer_map, bool create_other_layers, bool enable_text_objects, bool enable_properties, bool allow_multi_xy_records, unsigned int box_mode);
 
+  /**
+   *  @brief Reads the shapes of a lazy cell
+   *
+   *  The stream is expected to be positioned after the STRNAME record of the cell.
+   *  The shapes are read into "target" up to the ENDSTR record. Instances and cell
+   *  properties are skipped since they are present in the layout already. The shape
+   *  references are created in the target's layout while the property IDs refer to 
+   *  "layout".
+   *  The parameters are the same than for basic_read. "layer_map" is the layer map
+   *  delivered by basic_read and "dbuu" the database unit in user units found
+   *  while reading the file.
+   *
+   *  @param layout The layout that holds the cell
+   *  @param cell_index The index of the lazy cell
+   *  @param target The cell into which to read the shapes
+   */
+  void read_lazy_cell (db::Layout &layout, db::cell_index_type cell_index, db::Cell &target, const LayerMap &layer_map, bool enable_text_objects, bool enable_properties, bool allow_multi_xy_records, unsigned int box_mode, double dbuu);
+
+  /**
+   *  @brief Enables lazy loading for basic_read
+   *
+   *  In lazy mode, basic_read does not keep the shapes of the cells. Instead, it
+   *  computes the per-layer bounding boxes of the shapes and calls "register_lazy_cell" 
+   *  for every cell with shapes. The properties of the shapes are registered in the 
+   *  layout already, so loading the cells later does not need to modify the layout's 
+   *  properties repository.
+   */
+  void set_lazy (bool f)
+  {
+    m_lazy = f;
+  }
+
   /**
    *  @brief Accessor method to the current cellname
    */
   const tl::string &cellname () const { return m_cellname; }
 
+  /**
+   *  @brief Accessor method to the layer map (valid after basic_read)
+   */
+  const LayerMap &layer_map () const { return m_layer_map; }
+
+  /**
+   *  @brief Accessor method to the database unit in user units (valid after basic_read)
+   */
+  double dbuu () const { return m_dbuu; }
+
 private:
   friend class GDS2ReaderLayerMapping;
 
@@ -107,6 +150,8 @@ private:
   bool m_read_properties;
   bool m_allow_multi_xy_records;
   unsigned int m_box_mode;
+  bool m_lazy;
+  db::LazyCellLoader::box_map *mp_lazy_bboxes;
   std::map <tl::string, std::vector<std::string> > m_context_info;
 
   void read_context_info_cell ();
@@ -136,6 +181,12 @@ private:
   virtual void get_time (unsigned int *mod_time, unsigned int *access_time) = 0;
   virtual GDS2XY *get_xy_data (unsigned int &xy_length) = 0;
   virtual void progress_checkpoint () = 0;
+
+  //  only required for readers supporting lazy mode: 
+  //  "stream_pos" delivers the position after the last record read and
+  //  "register_lazy_cell" receives the lazy cells with their per-layer shape bounding boxes
+  virtual size_t stream_pos () const { return 0; }
+  virtual void register_lazy_cell (db::Layout & /*layout*/, db::cell_index_type /*cell_index*/, size_t /*pos*/, const db::LazyCellLoader::box_map & /*bboxes*/) { }
 };
 
 }
@@ -39,10 +39,32 @@ namespace db
 //  GDS2Writer implementation
 
 GDS2Writer::GDS2Writer ()
-  : mp_stream (0), m_progress (tl::to_string (QObject::tr ("Writing GDS2 file")), 10000)
+  : mp_stream (0), mp_progress (new tl::AbsoluteProgress (tl::to_string (QObject::tr ("Writing GDS2 file")), 10000))
 {
-  m_progress.set_format (tl::to_string (QObject::tr ("%.0f MB")));
-  m_progress.set_unit (1024 * 1024);
+  mp_progress->set_format (tl::to_string (QObject::tr ("%.0f MB")));
+  mp_progress->set_unit (1024 * 1024);
+}
+
+GDS2Writer::GDS2Writer (bool with_progress)
+  : mp_stream (0)
+{
+  if (with_progress) {
+    mp_progress.reset (new tl::AbsoluteProgress (tl::to_string (QObject::tr ("Writing GDS2 file")), 10000));
+    mp_progress->set_format (tl::to_string (QObject::tr ("%.0f MB")));
+    mp_progress->set_unit (1024 * 1024);
+  }
+}
+
+GDS2WriterBase *
+GDS2Writer::create_cell_writer () const
+{
+  return new GDS2Writer (false);
+}
+
+void 
+GDS2Writer::write_bytes (const char *b, size_t n)
+{
+  mp_stream->put (b, n);
 }
 
 inline void 
@@ -147,7 +169,9 @@ GDS2Writer::write_string (const std::string &t)
 void 
 GDS2Writer::progress_checkpoint ()
 {
-  m_progress.set (mp_stream->pos ());
+  if (mp_progress.get ()) {
+    mp_progress->set (mp_stream->pos ());
+  }
 }
 
 } // namespace db
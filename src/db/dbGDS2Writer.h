@@ -28,6 +28,8 @@
 #include "dbWriterTools.h"
 #include "tlProgress.h"
 
+#include <memory>
+
 namespace db
 {
 
@@ -108,9 +110,22 @@ protected:
    */
   void progress_checkpoint ();
 
+  /**
+   *  @brief Write a block of bytes
+   */
+  void write_bytes (const char *b, size_t n);
+
+  /**
+   *  @brief Creates a writer for encoding cells in a separate thread
+   */
+  GDS2WriterBase *create_cell_writer () const;
+
 private:
   tl::OutputStream *mp_stream;
-  tl::AbsoluteProgress m_progress;
+  std::auto_ptr<tl::AbsoluteProgress> mp_progress;
+
+  //  creates a writer without progress reporting
+  GDS2Writer (bool with_progress);
 };
 
 } // namespace db
@@ -32,16 +32,211 @@
 #include "dbClip.h"
 #include "dbSaveLayoutOptions.h"
 #include "dbPolygonGenerators.h"
+#include "tlThreadedWorkers.h"
+
+#include <QMutex>
+#include <QWaitCondition>
 
 #include <stdio.h>
 #include <errno.h>
 #include <time.h>
 
 #include <limits>
+#include <list>
+#include <memory>
 
 namespace db
 {
 
+// ------------------------------------------------------------------
+//  Cell-parallel encoding
+
+/**
+ *  @brief The encoded form of a cell
+ */
+struct GDS2CellChunk
+{
+  GDS2CellChunk (db::cell_index_type _cell)
+    : cell (_cell), done (false)
+  {
+    //  .. nothing yet ..
+  }
+
+  db::cell_index_type cell;
+  bool done;
+  std::string error;
+  tl::OutputMemoryStream data;
+};
+
+class GDS2CellEncoderTask
+  : public tl::Task
+{
+public:
+  GDS2CellEncoderTask (GDS2CellChunk *chunk)
+    : mp_chunk (chunk)
+  {
+    //  .. nothing yet ..
+  }
+
+  GDS2CellChunk *chunk () const
+  {
+    return mp_chunk;
+  }
+
+private:
+  GDS2CellChunk *mp_chunk;
+};
+
+/**
+ *  @brief The cell encoder
+ *
+ *  This object encodes the cells into memory buffers using a number of threads.
+ *  Each thread uses a cell writer provided by the GDS2 writer. Only the writing thread
+ *  manipulates the chunk list. The encoder threads access the chunks through their
+ *  tasks and report completion through the "done" flag.
+ */
+class GDS2CellEncoder
+  : public tl::JobBase
+{
+public:
+  GDS2CellEncoder (int nworkers, const GDS2WriterBase *writer, const db::Layout &layout, const GDS2WriterBase::CellParameters &parameters)
+    : tl::JobBase (nworkers), mp_writer (writer), mp_layout (&layout), m_parameters (parameters)
+  {
+    //  .. nothing yet ..
+  }
+
+  ~GDS2CellEncoder ()
+  {
+    //  stop the workers before the chunks are deleted
+    terminate ();
+
+    for (std::list<GDS2CellChunk *>::const_iterator c = m_chunks.begin (); c != m_chunks.end (); ++c) {
+      delete *c;
+    }
+    m_chunks.clear ();
+  }
+
+  void add (db::cell_index_type cell)
+  {
+    GDS2CellChunk *chunk = new GDS2CellChunk (cell);
+    m_chunks.push_back (chunk);
+
+    schedule (new GDS2CellEncoderTask (chunk));
+    if (! is_running ()) {
+      start ();
+    }
+  }
+
+  /**
+   *  @brief Writes the encoded cells in the order they were added
+   *
+   *  If "all" is true, this method waits until all cells are written. Otherwise it writes the
+   *  cells available and waits only if too many cells are pending.
+   */
+  void flush (GDS2WriterBase *writer, bool all)
+  {
+    while (! m_chunks.empty ()) {
+
+      bool wait = all || m_chunks.size () > size_t (4 * num_workers ());
+
+      GDS2CellChunk *chunk = m_chunks.front ();
+
+      {
+        QMutexLocker locker (&m_chunks_lock);
+        while (wait && ! chunk->done) {
+          m_chunks_condition.wait (&m_chunks_lock);
+        }
+        if (! chunk->done) {
+          break;
+        }
+      }
+
+      if (! chunk->error.empty ()) {
+        throw tl::Exception (chunk->error);
+      }
+
+      if (chunk->data.size () > 0) {
+        writer->write_bytes (chunk->data.data (), chunk->data.size ());
+      }
+
+      m_chunks.pop_front ();
+      delete chunk;
+
+      writer->progress_checkpoint ();
+
+    }
+  }
+
+  void encode (GDS2WriterBase *cell_writer, GDS2CellChunk *chunk)
+  {
+    std::string error;
+
+    try {
+      tl::OutputStream stream (chunk->data);
+      cell_writer->set_stream (stream);
+      cell_writer->write_cell (*mp_layout, chunk->cell, m_parameters);
+    } catch (tl::Exception &ex) {
+      error = ex.msg ();
+    } catch (std::exception &ex) {
+      error = ex.what ();
+    } catch (...) {
+      error = tl::to_string (QObject::tr ("Unspecific error"));
+    }
+
+    QMutexLocker locker (&m_chunks_lock);
+    chunk->error = error;
+    chunk->done = true;
+    m_chunks_condition.wakeAll ();
+  }
+
+  GDS2WriterBase *create_cell_writer () const
+  {
+    GDS2WriterBase *cell_writer = mp_writer->create_cell_writer ();
+    tl_assert (cell_writer != 0);
+    cell_writer->m_cell_name_map = mp_writer->m_cell_name_map;
+    return cell_writer;
+  }
+
+  virtual tl::Worker *create_worker ();
+
+private:
+  const GDS2WriterBase *mp_writer;
+  const db::Layout *mp_layout;
+  GDS2WriterBase::CellParameters m_parameters;
+  std::list<GDS2CellChunk *> m_chunks;
+  QMutex m_chunks_lock;
+  QWaitCondition m_chunks_condition;
+};
+
+class GDS2CellEncoderWorker
+  : public tl::Worker
+{
+public:
+  GDS2CellEncoderWorker (GDS2CellEncoder *encoder)
+    : tl::Worker (), mp_encoder (encoder), mp_cell_writer (encoder->create_cell_writer ())
+  {
+    //  .. nothing yet ..
+  }
+
+  void perform_task (tl::Task *task)
+  {
+    GDS2CellEncoderTask *cell_task = dynamic_cast<GDS2CellEncoderTask *> (task);
+    if (cell_task) {
+      mp_encoder->encode (mp_cell_writer.get (), cell_task->chunk ());
+    }
+  }
+
+private:
+  GDS2CellEncoder *mp_encoder;
+  std::auto_ptr<GDS2WriterBase> mp_cell_writer;
+};
+
+tl::Worker *
+GDS2CellEncoder::create_worker ()
+{
+  return new GDS2CellEncoderWorker (this);
+}
+
 // ------------------------------------------------------------------
 //  GDS2WriterBase implementation
 
@@ -50,6 +245,14 @@ GDS2WriterBase::GDS2WriterBase ()
   // .. nothing yet ..
 }
 
+void
+GDS2WriterBase::write_bytes (const char *b, size_t n)
+{
+  for (size_t i = 0; i < n; ++i) {
+    write_byte ((unsigned char) b [i]);
+  }
+}
+
 static int safe_scale (double sf, int value)
 {
   double i = floor (sf * value + 0.5);
@@ -247,6 +450,29 @@ GDS2WriterBase::write (db::Layout &layout, tl::OutputStream &stream, const db::S
 
   //  body
 
+  CellParameters parameters;
+  parameters.sf = sf;
+  parameters.dbu = dbu;
+  for (unsigned int i = 0; i < 6; ++i) {
+    parameters.time_data [i] = time_data [i];
+  }
+  parameters.multi_xy = multi_xy;
+  parameters.max_vertex_count = max_vertex_count;
+  parameters.no_zero_length_paths = no_zero_length_paths;
+  parameters.write_cell_properties = gds2_options.write_cell_properties;
+  parameters.keep_instances = options.keep_instances ();
+  parameters.cell_set = &cell_set;
+  parameters.layers = &layers;
+
+  //  with threads, the cells are encoded in parallel if the writer supports that
+  std::auto_ptr<GDS2CellEncoder> encoder;
+  if (gds2_options.threads > 0) {
+    std::auto_ptr<GDS2WriterBase> cell_writer (create_cell_writer ());
+    if (cell_writer.get ()) {
+      encoder.reset (new GDS2CellEncoder (int (gds2_options.threads), this, layout, parameters));
+    }
+  }
+
   for (std::vector<db::cell_index_type>::const_iterator cell = cells.begin (); cell != cells.end (); ++cell) {
 
     progress_checkpoint ();
@@ -257,89 +483,106 @@ GDS2WriterBase::write (db::Layout &layout, tl::OutputStream &stream, const db::S
     //  also don't write proxy cells which are not employed
     if ((! cref.is_ghost_cell () || ! cref.empty ()) && (! cref.is_proxy () || ! cref.is_top ())) {
 
-      //  cell header 
+      if (encoder.get ()) {
+        encoder->add (*cell);
+        encoder->flush (this, false);
+      } else {
+        write_cell (layout, *cell, parameters);
+      }
 
-      write_record_size (4 + 12 * 2);
-      write_record (sBGNSTR);
-      write_time (time_data);
-      write_time (time_data);
+    }
 
-      write_string_record (sSTRNAME, m_cell_name_map.cell_name (*cell));
+  }
 
-      //  cell body 
+  if (encoder.get ()) {
+    encoder->flush (this, true);
+  }
 
-      if (gds2_options.write_cell_properties && cref.prop_id () != 0) {
-        write_properties (layout, cref.prop_id ());
-      }
+  write_record_size (4);
+  write_record (sENDLIB);
 
-      //  instances
-      
-      for (db::Cell::const_iterator inst = cref.begin (); ! inst.at_end (); ++inst) {
+  progress_checkpoint ();
+}
 
-        //  write only instances to selected cells
-        if (options.keep_instances () || cell_set.find (inst->cell_index ()) != cell_set.end ()) {
+void
+GDS2WriterBase::write_cell (const db::Layout &layout, db::cell_index_type ci, const CellParameters &p)
+{
+  const db::Cell &cref (layout.cell (ci));
 
-          progress_checkpoint ();
-          write_inst (sf, *inst, true /*normalize*/, layout, inst->prop_id ());
+  //  cell header 
 
-        }
+  write_record_size (4 + 12 * 2);
+  write_record (sBGNSTR);
+  write_time (p.time_data);
+  write_time (p.time_data);
 
-      }
+  write_string_record (sSTRNAME, m_cell_name_map.cell_name (ci));
 
-      //  shapes
+  //  cell body 
 
-      for (std::vector <std::pair <unsigned int, db::LayerProperties> >::const_iterator l = layers.begin (); l != layers.end (); ++l) {
-   
-        if (layout.is_valid_layer (l->first)) {
-
-          int layer = l->second.layer;
-          int datatype = l->second.datatype;
-
-          db::ShapeIterator shape (cref.shapes (l->first).begin (db::ShapeIterator::Boxes | db::ShapeIterator::Polygons | db::ShapeIterator::Edges | db::ShapeIterator::Paths | db::ShapeIterator::Texts));
-          while (! shape.at_end ()) {
-
-            progress_checkpoint ();
-
-            if (shape->is_text ()) {
-              write_text (layer, datatype, sf, dbu, *shape, layout, shape->prop_id ());
-            } else if (shape->is_polygon ()) {
-              write_polygon (layer, datatype, sf, *shape, multi_xy, max_vertex_count, layout, shape->prop_id ());
-            } else if (shape->is_edge ()) {
-              write_edge (layer, datatype, sf, *shape, layout, shape->prop_id ());
-            } else if (shape->is_path ()) {
-              if (no_zero_length_paths && (shape->path_length () - shape->path_extensions ().first - shape->path_extensions ().second) == 0) {
-                //  eliminate the zero-width path
-                db::Polygon poly;
-                shape->polygon (poly);
-                write_polygon (layer, datatype, sf, poly, multi_xy, max_vertex_count, layout, shape->prop_id (), false);
-              } else {
-                write_path (layer, datatype, sf, *shape, layout, shape->prop_id ());
-              }
-            } else if (shape->is_box ()) {
-              write_box (layer, datatype, sf, *shape, layout, shape->prop_id ());
-            }
-
-            ++shape;
+  if (p.write_cell_properties && cref.prop_id () != 0) {
+    write_properties (layout, cref.prop_id ());
+  }
 
-          }
+  //  instances
+  
+  for (db::Cell::const_iterator inst = cref.begin (); ! inst.at_end (); ++inst) {
 
-        }
+    //  write only instances to selected cells
+    if (p.keep_instances || p.cell_set->find (inst->cell_index ()) != p.cell_set->end ()) {
 
-      }
+      progress_checkpoint ();
+      write_inst (p.sf, *inst, true /*normalize*/, layout, inst->prop_id ());
+
+    }
 
-      //  end of cell
+  }
 
-      write_record_size (4);
-      write_record (sENDSTR);
+  //  shapes
+
+  for (std::vector <std::pair <unsigned int, db::LayerProperties> >::const_iterator l = p.layers->begin (); l != p.layers->end (); ++l) {
+   
+    if (layout.is_valid_layer (l->first)) {
+
+      int layer = l->second.layer;
+      int datatype = l->second.datatype;
+
+      db::ShapeIterator shape (cref.shapes (l->first).begin (db::ShapeIterator::Boxes | db::ShapeIterator::Polygons | db::ShapeIterator::Edges | db::ShapeIterator::Paths | db::ShapeIterator::Texts));
+      while (! shape.at_end ()) {
+
+        progress_checkpoint ();
+
+        if (shape->is_text ()) {
+          write_text (layer, datatype, p.sf, p.dbu, *shape, layout, shape->prop_id ());
+        } else if (shape->is_polygon ()) {
+          write_polygon (layer, datatype, p.sf, *shape, p.multi_xy, p.max_vertex_count, layout, shape->prop_id ());
+        } else if (shape->is_edge ()) {
+          write_edge (layer, datatype, p.sf, *shape, layout, shape->prop_id ());
+        } else if (shape->is_path ()) {
+          if (p.no_zero_length_paths && (shape->path_length () - shape->path_extensions ().first - shape->path_extensions ().second) == 0) {
+            //  eliminate the zero-width path
+            db::Polygon poly;
+            shape->polygon (poly);
+            write_polygon (layer, datatype, p.sf, poly, p.multi_xy, p.max_vertex_count, layout, shape->prop_id (), false);
+          } else {
+            write_path (layer, datatype, p.sf, *shape, layout, shape->prop_id ());
+          }
+        } else if (shape->is_box ()) {
+          write_box (layer, datatype, p.sf, *shape, layout, shape->prop_id ());
+        }
+
+        ++shape;
+
+      }
 
     }
 
   }
 
-  write_record_size (4);
-  write_record (sENDLIB);
+  //  end of cell
 
-  progress_checkpoint ();
+  write_record_size (4);
+  write_record (sENDSTR);
 }
 
 void
@@ -38,6 +38,7 @@ namespace db
 
 class Layout;
 class SaveLayoutOptions;
+class GDS2CellEncoder;
 
 /**
  *  @brief Structure that holds the GDS2 specific options for the Writer
@@ -58,7 +59,8 @@ public:
       user_units (1.0),
       write_timestamps (true),
       write_cell_properties (false),
-      write_file_properties (false)
+      write_file_properties (false),
+      threads (0)
   {
     //  .. nothing yet ..
   }
@@ -127,6 +129,16 @@ public:
    */
   bool write_file_properties;
 
+  /**
+   *  @brief The number of threads used for encoding the cells
+   *
+   *  If non-zero, the cells are encoded into memory buffers by the given number of
+   *  threads and the buffers are written in the order of the cells. The output is
+   *  identical to the one produced without threads. 0 means the cells are written
+   *  by the writing thread.
+   */
+  unsigned int threads;
+
   /** 
    *  @brief Implementation of FormatSpecificWriterOptions
    */
@@ -219,6 +231,25 @@ protected:
    */
   virtual void progress_checkpoint () = 0;
 
+  /**
+   *  @brief Write a block of bytes
+   *
+   *  The default implementation writes the bytes one by one.
+   */
+  virtual void write_bytes (const char *b, size_t n);
+
+  /**
+   *  @brief Creates a writer for encoding cells in a separate thread
+   *
+   *  The cell writer must deliver the same output for a cell than this writer.
+   *  The stream is set with "set_stream". The default implementation returns 0 
+   *  which means that the cells are always written by the writing thread.
+   */
+  virtual GDS2WriterBase *create_cell_writer () const
+  {
+    return 0;
+  }
+
   /**
    *  @brief Write a string plus record
    */
@@ -265,9 +296,28 @@ protected:
   void finish (const db::Layout &layout, db::properties_id_type prop_id);
 
 private:
+  friend class GDS2CellEncoder;
+
+  /**
+   *  @brief The parameters for writing a cell
+   */
+  struct CellParameters
+  {
+    double sf, dbu;
+    short time_data [6];
+    bool multi_xy;
+    size_t max_vertex_count;
+    bool no_zero_length_paths;
+    bool write_cell_properties;
+    bool keep_instances;
+    const std::set <db::cell_index_type> *cell_set;
+    const std::vector <std::pair <unsigned int, db::LayerProperties> > *layers;
+  };
+
   db::WriterCellNameMap m_cell_name_map;
 
   void write_properties (const db::Layout &layout, db::properties_id_type prop_id);
+  void write_cell (const db::Layout &layout, db::cell_index_type ci, const CellParameters &p);
 };
 
 } // namespace db
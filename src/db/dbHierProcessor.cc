@@ -0,0 +1,528 @@
+
+/*
+
+  KLayout Layout Viewer
+  Copyright (C) 2006-2017 Matthias Koefferlein
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+
+#include "dbHierProcessor.h"
+#include "dbEdgeProcessor.h"
+#include "dbPolygonGenerators.h"
+#include "dbRecursiveShapeIterator.h"
+#include "dbBoxConvert.h"
+#include "dbClip.h"
+#include "tlProgress.h"
+#include "tlInternational.h"
+
+#include <set>
+#include <algorithm>
+#include <memory>
+
+namespace db
+{
+
+static const unsigned int polygon_shape_flags = db::ShapeIterator::Polygons | db::ShapeIterator::Boxes | db::ShapeIterator::Paths;
+
+// ---------------------------------------------------------------------------------------------
+//  BoolAndOrNotLocalOperation implementation
+
+BoolAndOrNotLocalOperation::BoolAndOrNotLocalOperation (bool is_and)
+  : m_is_and (is_and)
+{
+  //  .. nothing yet ..
+}
+
+void
+BoolAndOrNotLocalOperation::compute_local (const std::vector<db::Polygon> &subjects, const std::vector<db::Polygon> &intruders, std::vector<db::Polygon> &result) const
+{
+  if (subjects.empty ()) {
+    return;
+  }
+
+  db::EdgeProcessor ep;
+
+  if (intruders.empty ()) {
+    if (! m_is_and) {
+      ep.merge (subjects, result, 0, false /*don't resolve holes*/, false /*max. coherence*/);
+    }
+  } else {
+    ep.boolean (subjects, intruders, result, m_is_and ? db::BooleanOp::And : db::BooleanOp::ANotB, false /*don't resolve holes*/, false /*max. coherence*/);
+  }
+}
+
+db::Coord
+BoolAndOrNotLocalOperation::dist () const
+{
+  //  touching is sufficient
+  return 0;
+}
+
+std::string
+BoolAndOrNotLocalOperation::description () const
+{
+  return m_is_and ? tl::to_string (QObject::tr ("AND operation")) : tl::to_string (QObject::tr ("NOT operation"));
+}
+
+// ---------------------------------------------------------------------------------------------
+//  SizingLocalOperation implementation
+
+SizingLocalOperation::SizingLocalOperation (db::Coord dx, db::Coord dy, unsigned int mode)
+  : m_dx (dx), m_dy (dy), m_mode (mode)
+{
+  //  .. nothing yet ..
+}
+
+db::Coord
+SizingLocalOperation::reach () const
+{
+  //  The maximum distance by which a corner can be shifted depends on the cutoff angle
+  //  selected by the mode (see SizingPolygonFilter): 1/cos(a/2) for the cutoff angle a.
+  static const db::Coord factors [] = { 2, 2, 2, 3, 10, 115 };
+  db::Coord f = factors [std::min (m_mode, (unsigned int) (sizeof (factors) / sizeof (factors [0]) - 1))];
+  return f * std::max (std::abs (m_dx), std::abs (m_dy)) + 1;
+}
+
+void
+SizingLocalOperation::compute_local (const std::vector<db::Polygon> &subjects, const std::vector<db::Polygon> &intruders, std::vector<db::Polygon> &result) const
+{
+  if (subjects.empty ()) {
+    return;
+  }
+
+  //  merge subjects and intruders and size the merged polygons
+
+  db::EdgeProcessor ep;
+
+  size_t n = 0;
+  for (std::vector<db::Polygon>::const_iterator p = subjects.begin (); p != subjects.end (); ++p) {
+    n += p->vertices ();
+  }
+  for (std::vector<db::Polygon>::const_iterator p = intruders.begin (); p != intruders.end (); ++p) {
+    n += p->vertices ();
+  }
+  ep.reserve (n);
+
+  for (std::vector<db::Polygon>::const_iterator p = subjects.begin (); p != subjects.end (); ++p) {
+    ep.insert (*p, 0);
+  }
+  for (std::vector<db::Polygon>::const_iterator p = intruders.begin (); p != intruders.end (); ++p) {
+    ep.insert (*p, 0);
+  }
+
+  std::vector<db::Polygon> sized;
+
+  db::PolygonContainer pc (sized);
+  db::PolygonGenerator pg2 (pc, false /*don't resolve holes*/, true /*min. coherence*/);
+  db::SizingPolygonFilter siz (pg2, m_dx, m_dy, m_mode);
+  db::PolygonGenerator pg (siz, false /*don't resolve holes*/, false /*min. coherence*/);
+  db::MergeOp op (0);
+  ep.process (pg, op);
+
+  //  confine the result to the area the subjects are responsible for: that is
+  //  the neighborhood of the subjects up to the reach of the sizing. The intruders
+  //  have been collected such that the result is exact within this area.
+
+  db::Coord r = reach ();
+
+  std::vector<db::Polygon> owned;
+  owned.reserve (subjects.size ());
+  for (std::vector<db::Polygon>::const_iterator p = subjects.begin (); p != subjects.end (); ++p) {
+    owned.push_back (db::Polygon (p->box ().enlarged (db::Vector (r, r))));
+  }
+
+  ep.boolean (sized, owned, result, db::BooleanOp::And, false /*don't resolve holes*/, false /*max. coherence*/);
+}
+
+db::Coord
+SizingLocalOperation::dist () const
+{
+  //  the result is computed within "reach" of the subjects and depends on the shapes
+  //  within "reach" of this area
+  return 2 * reach ();
+}
+
+std::string
+SizingLocalOperation::description () const
+{
+  return tl::to_string (QObject::tr ("Sizing operation"));
+}
+
+// ---------------------------------------------------------------------------------------------
+//  HierarchicalProcessor implementation
+
+HierarchicalProcessor::HierarchicalProcessor (db::Layout *layout, db::Cell *top)
+  : mp_layout (layout), mp_top (top), m_report_progress (false)
+{
+  //  .. nothing yet ..
+}
+
+void
+HierarchicalProcessor::enable_progress (const std::string &progress_desc)
+{
+  m_report_progress = true;
+  m_progress_desc = progress_desc;
+}
+
+void
+HierarchicalProcessor::disable_progress ()
+{
+  m_report_progress = false;
+}
+
+void
+HierarchicalProcessor::run (const LocalOperation &op, unsigned int subject_layer, unsigned int intruder_layer, unsigned int output_layer)
+{
+  mp_layout->update ();
+
+  std::set<db::cell_index_type> called;
+  mp_top->collect_called_cells (called);
+  called.insert (mp_top->cell_index ());
+
+  std::auto_ptr<tl::RelativeProgress> progress;
+  if (m_report_progress) {
+    progress.reset (new tl::RelativeProgress (m_progress_desc.empty () ? op.description () : m_progress_desc, called.size () * 2, 1));
+  }
+
+  //  Step 1: collect the contexts top-down. The top cell has a single, empty context.
+
+  std::map<db::cell_index_type, std::vector<CellContext> > contexts;
+  std::map<db::cell_index_type, context_map_type> pending_contexts;
+
+  contexts [mp_top->cell_index ()].push_back (CellContext ());
+
+  for (db::Layout::top_down_const_iterator c = mp_layout->begin_top_down (); c != mp_layout->end_top_down (); ++c) {
+
+    if (called.find (*c) == called.end ()) {
+      continue;
+    }
+
+    if (progress.get ()) {
+      ++*progress;
+    }
+
+    std::vector<CellContext> &cv = contexts [*c];
+
+    std::map<db::cell_index_type, context_map_type>::iterator pc = pending_contexts.find (*c);
+    if (pc != pending_contexts.end ()) {
+      cv.reserve (pc->second.size ());
+      for (context_map_type::const_iterator i = pc->second.begin (); i != pc->second.end (); ++i) {
+        cv.push_back (CellContext ());
+        cv.back ().intruders = i->first;
+        cv.back ().users = i->second;
+      }
+      pending_contexts.erase (pc);
+    }
+
+    if (! cv.empty ()) {
+      compute_contexts (op, mp_layout->cell (*c), cv, subject_layer, intruder_layer, pending_contexts);
+    }
+
+  }
+
+  //  Step 2: compute the results bottom-up. The part common to all contexts stays in the cell,
+  //  the context-specific remainders are pushed into the parents' contexts.
+
+  std::map<db::cell_index_type, std::vector<std::vector<db::Polygon> > > pushed;
+
+  for (db::Layout::bottom_up_const_iterator c = mp_layout->begin_bottom_up (); c != mp_layout->end_bottom_up (); ++c) {
+
+    if (called.find (*c) == called.end ()) {
+      continue;
+    }
+
+    if (progress.get ()) {
+      ++*progress;
+    }
+
+    std::map<db::cell_index_type, std::vector<CellContext> >::const_iterator cc = contexts.find (*c);
+    if (cc == contexts.end () || cc->second.empty ()) {
+      continue;
+    }
+
+    const std::vector<CellContext> &cv = cc->second;
+    db::Cell &cell = mp_layout->cell (*c);
+
+    std::vector<std::vector<db::Polygon> > results;
+    compute_results (op, cell, cv, results, subject_layer, intruder_layer);
+
+    std::map<db::cell_index_type, std::vector<std::vector<db::Polygon> > >::iterator p = pushed.find (*c);
+    if (p != pushed.end ()) {
+      for (size_t k = 0; k < p->second.size () && k < results.size (); ++k) {
+        results [k].insert (results [k].end (), p->second [k].begin (), p->second [k].end ());
+      }
+      pushed.erase (p);
+    }
+
+    //  group the contexts by identical results
+    std::map<std::vector<db::Polygon>, std::vector<size_t> > result_groups;
+    for (size_t k = 0; k < results.size (); ++k) {
+      std::sort (results [k].begin (), results [k].end ());
+      result_groups [results [k]].push_back (k);
+    }
+    results.clear ();
+
+    std::vector<db::Polygon> common;
+
+    if (result_groups.size () == 1) {
+
+      common = result_groups.begin ()->first;
+
+    } else {
+
+      db::EdgeProcessor ep;
+
+      std::map<std::vector<db::Polygon>, std::vector<size_t> >::const_iterator g = result_groups.begin ();
+      common = g->first;
+      for (++g; g != result_groups.end () && ! common.empty (); ++g) {
+        ep.boolean (common, g->first, common, db::BooleanOp::And, false /*don't resolve holes*/, false /*max. coherence*/);
+      }
+
+      std::vector<db::Polygon> remaining;
+
+      for (g = result_groups.begin (); g != result_groups.end (); ++g) {
+
+        remaining.clear ();
+        if (common.empty ()) {
+          remaining = g->first;
+        } else if (! g->first.empty ()) {
+          ep.boolean (g->first, common, remaining, db::BooleanOp::ANotB, false /*don't resolve holes*/, false /*max. coherence*/);
+        }
+
+        if (remaining.empty ()) {
+          continue;
+        }
+
+        for (std::vector<size_t>::const_iterator k = g->second.begin (); k != g->second.end (); ++k) {
+
+          for (std::vector<ContextUser>::const_iterator u = cv [*k].users.begin (); u != cv [*k].users.end (); ++u) {
+
+            std::vector<std::vector<db::Polygon> > &pv = pushed [u->parent];
+            if (pv.size () <= u->parent_context) {
+              pv.resize (contexts [u->parent].size ());
+            }
+
+            std::vector<db::Polygon> &target = pv [u->parent_context];
+            for (std::vector<db::Polygon>::const_iterator r = remaining.begin (); r != remaining.end (); ++r) {
+              target.push_back (r->transformed (u->trans));
+            }
+
+          }
+
+        }
+
+      }
+
+    }
+
+    db::Shapes &out = cell.shapes (output_layer);
+    for (std::vector<db::Polygon>::const_iterator r = common.begin (); r != common.end (); ++r) {
+      out.insert (*r);
+    }
+
+  }
+}
+
+/**
+ *  @brief Selects the intruders relevant for a child cell, clips them to the box and transforms them into the child
+ *
+ *  Intruders are relevant if they are within "dist" of any subject shape from the child's
+ *  subtree. "trans" is the transformation from the parent into the child.
+ */
+static void
+select_intruders (const std::vector<db::Polygon> &in, const db::Layout &layout, const db::Cell &child, unsigned int subject_layer, db::Coord dist, const db::Box &box, const db::ICplxTrans &trans, std::vector<db::Polygon> &out)
+{
+  std::vector<db::Polygon> clipped;
+
+  for (std::vector<db::Polygon>::const_iterator p = in.begin (); p != in.end (); ++p) {
+
+    if (! p->box ().touches (box)) {
+      continue;
+    }
+
+    db::RecursiveShapeIterator si (layout, child, subject_layer, p->box ().transformed (trans).enlarged (db::Vector (dist, dist)));
+    si.shape_flags (polygon_shape_flags);
+    if (si.at_end ()) {
+      continue;
+    }
+
+    if (p->box ().inside (box)) {
+      out.push_back (p->transformed (trans));
+    } else if (p->box ().overlaps (box)) {
+      clipped.clear ();
+      db::clip_poly (*p, box, clipped, false /*don't resolve holes*/);
+      for (std::vector<db::Polygon>::const_iterator c = clipped.begin (); c != clipped.end (); ++c) {
+        out.push_back (c->transformed (trans));
+      }
+    }
+
+  }
+}
+
+void
+HierarchicalProcessor::compute_contexts (const LocalOperation &op, const db::Cell &cell, const std::vector<CellContext> &contexts, unsigned int subject_layer, unsigned int intruder_layer, std::map<db::cell_index_type, context_map_type> &child_contexts) const
+{
+  db::Coord d = op.dist ();
+
+  std::vector<db::Polygon> intruders, local_base, key;
+
+  for (db::Cell::const_iterator i = cell.begin (); ! i.at_end (); ++i) {
+
+    db::cell_index_type ci = i->cell_index ();
+    const db::Cell &child = mp_layout->cell (ci);
+    const db::Box &cbox = child.bbox (subject_layer);
+    if (cbox.empty ()) {
+      continue;
+    }
+
+    context_map_type &cm = child_contexts [ci];
+    const db::CellInstArray &arr = i->cell_inst ();
+
+    for (db::CellInstArray::iterator a = arr.begin (); ! a.at_end (); ++a) {
+
+      db::ICplxTrans t = arr.complex_trans (*a);
+      db::ICplxTrans ti = t.inverted ();
+      db::Box rbox = cbox.transformed (t).enlarged (db::Vector (d, d));
+
+      //  the intruders from this cell and the siblings of the instance
+      intruders.clear ();
+      collect_intruders (cell, rbox, *i, t, intruder_layer, intruders);
+
+      local_base.clear ();
+      select_intruders (intruders, *mp_layout, child, subject_layer, d, rbox, ti, local_base);
+
+      for (size_t k = 0; k < contexts.size (); ++k) {
+
+        //  the intruders from the context of this cell
+        key = local_base;
+        select_intruders (contexts [k].intruders, *mp_layout, child, subject_layer, d, rbox, ti, key);
+        std::sort (key.begin (), key.end ());
+
+        cm [key].push_back (ContextUser (cell.cell_index (), k, t));
+
+      }
+
+    }
+
+  }
+}
+
+void
+HierarchicalProcessor::collect_intruders (const db::Cell &cell, const db::Box &region, const db::Instance &exclude_inst, const db::ICplxTrans &exclude_trans, unsigned int intruder_layer, std::vector<db::Polygon> &intruders) const
+{
+  for (db::ShapeIterator s = cell.shapes (intruder_layer).begin_touching (region, polygon_shape_flags); ! s.at_end (); ++s) {
+    intruders.push_back (db::Polygon ());
+    s->polygon (intruders.back ());
+  }
+
+  db::box_convert<db::CellInst> bc (*mp_layout, intruder_layer);
+
+  for (db::Cell::touching_iterator j = cell.begin_touching (region); ! j.at_end (); ++j) {
+
+    const db::Cell &child = mp_layout->cell (j->cell_index ());
+    if (child.bbox (intruder_layer).empty ()) {
+      continue;
+    }
+
+    const db::CellInstArray &arr = j->cell_inst ();
+
+    for (db::CellInstArray::iterator m = arr.begin_touching (region, bc); ! m.at_end (); ++m) {
+
+      db::ICplxTrans t = arr.complex_trans (*m);
+      if (*j == exclude_inst && t == exclude_trans) {
+        continue;
+      }
+
+      db::RecursiveShapeIterator si (*mp_layout, child, intruder_layer, region.transformed (t.inverted ()));
+      si.shape_flags (polygon_shape_flags);
+
+      db::Polygon poly;
+      for ( ; ! si.at_end (); ++si) {
+        si->polygon (poly);
+        intruders.push_back (poly.transformed (t * si.trans ()));
+      }
+
+    }
+
+  }
+}
+
+void
+HierarchicalProcessor::compute_results (const LocalOperation &op, db::Cell &cell, const std::vector<CellContext> &contexts, std::vector<std::vector<db::Polygon> > &results, unsigned int subject_layer, unsigned int intruder_layer) const
+{
+  results.clear ();
+  results.resize (contexts.size ());
+
+  std::vector<db::Polygon> subjects;
+  db::Box sbox;
+
+  for (db::ShapeIterator s = cell.shapes (subject_layer).begin (polygon_shape_flags); ! s.at_end (); ++s) {
+    subjects.push_back (db::Polygon ());
+    s->polygon (subjects.back ());
+    sbox += subjects.back ().box ();
+  }
+
+  if (subjects.empty ()) {
+    return;
+  }
+
+  db::Coord d = op.dist ();
+  db::Box ibox = sbox.enlarged (db::Vector (d, d));
+
+  //  the intruders from the cell's subtree
+  std::vector<db::Polygon> base;
+
+  db::RecursiveShapeIterator si (*mp_layout, cell, intruder_layer, ibox);
+  si.shape_flags (polygon_shape_flags);
+
+  db::Polygon poly;
+  for ( ; ! si.at_end (); ++si) {
+    si->polygon (poly);
+    base.push_back (poly.transformed (si.trans ()));
+  }
+
+  //  the results for contexts not adding intruders are all the same
+  bool has_plain_result = false;
+  std::vector<db::Polygon> plain_result;
+
+  std::vector<db::Polygon> intruders;
+
+  for (size_t k = 0; k < contexts.size (); ++k) {
+
+    intruders = base;
+    for (std::vector<db::Polygon>::const_iterator p = contexts [k].intruders.begin (); p != contexts [k].intruders.end (); ++p) {
+      if (p->box ().touches (ibox)) {
+        intruders.push_back (*p);
+      }
+    }
+
+    if (intruders.size () == base.size ()) {
+      if (! has_plain_result) {
+        op.compute_local (subjects, intruders, plain_result);
+        has_plain_result = true;
+      }
+      results [k] = plain_result;
+    } else {
+      op.compute_local (subjects, intruders, results [k]);
+    }
+
+  }
+}
+
+}
+
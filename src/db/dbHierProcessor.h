@@ -0,0 +1,204 @@
+
+/*
+
+  KLayout Layout Viewer
+  Copyright (C) 2006-2017 Matthias Koefferlein
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+
+#ifndef HDR_dbHierProcessor
+#define HDR_dbHierProcessor
+
+#include "dbCommon.h"
+
+#include "dbLayout.h"
+#include "dbPolygon.h"
+#include "dbTrans.h"
+
+#include <map>
+#include <vector>
+#include <string>
+
+namespace db
+{
+
+/**
+ *  @brief The local operation run by the hierarchical processor
+ *
+ *  A local operation computes a result from the "subject" polygons of a cell
+ *  and the "intruder" polygons interacting with them. The intruders are
+ *  collected from the cell itself, from the cell's child cells and from the
+ *  context the cell is instantiated in.
+ *
+ *  The result of the operation is expected to depend on the subjects and on
+ *  intruders within "dist" of the subjects' bounding box only. The union of the
+ *  results over any decomposition of the subjects needs to be identical to the
+ *  result computed from all subjects together.
+ */
+class DB_PUBLIC LocalOperation
+{
+public:
+  LocalOperation () { }
+  virtual ~LocalOperation () { }
+
+  /**
+   *  @brief Computes the result for the given subjects and intruders
+   */
+  virtual void compute_local (const std::vector<db::Polygon> &subjects, const std::vector<db::Polygon> &intruders, std::vector<db::Polygon> &result) const = 0;
+
+  /**
+   *  @brief Gets the interaction distance
+   *
+   *  Intruders farther away than this distance from the bounding box of the
+   *  subjects are not considered.
+   */
+  virtual db::Coord dist () const = 0;
+
+  /**
+   *  @brief Gets a description text (used for progress reporting)
+   */
+  virtual std::string description () const = 0;
+};
+
+/**
+ *  @brief The AND or NOT operation as a local operation
+ *
+ *  The subjects are the first operand, the intruders the second.
+ */
+class DB_PUBLIC BoolAndOrNotLocalOperation
+  : public LocalOperation
+{
+public:
+  BoolAndOrNotLocalOperation (bool is_and);
+
+  virtual void compute_local (const std::vector<db::Polygon> &subjects, const std::vector<db::Polygon> &intruders, std::vector<db::Polygon> &result) const;
+  virtual db::Coord dist () const;
+  virtual std::string description () const;
+
+private:
+  bool m_is_and;
+};
+
+/**
+ *  @brief The merged sizing as a local operation
+ *
+ *  The subjects and intruders are taken from the same layer. The subjects are
+ *  sized together with the intruders in their vicinity and the result is
+ *  confined to the part which is owned by the subjects.
+ */
+class DB_PUBLIC SizingLocalOperation
+  : public LocalOperation
+{
+public:
+  SizingLocalOperation (db::Coord dx, db::Coord dy, unsigned int mode);
+
+  virtual void compute_local (const std::vector<db::Polygon> &subjects, const std::vector<db::Polygon> &intruders, std::vector<db::Polygon> &result) const;
+  virtual db::Coord dist () const;
+  virtual std::string description () const;
+
+private:
+  db::Coord m_dx, m_dy;
+  unsigned int m_mode;
+
+  db::Coord reach () const;
+};
+
+/**
+ *  @brief The hierarchical processor
+ *
+ *  The hierarchical processor runs a local operation on a cell tree without
+ *  flattening it. Each cell's local subject shapes are computed against the
+ *  intruders from the cell's subtree and from the contexts the cell is
+ *  instantiated in. A context is formed by the intruder shapes from parent
+ *  cells and sibling instances that interact with the cell.
+ *
+ *  For every cell, the part of the result which is common to all contexts is
+ *  stored in the cell itself. Context-specific remainders are propagated into
+ *  the parent cells. Hence, cells which are instantiated in identical
+ *  surroundings (or without interactions) are computed once and the hierarchy
+ *  is maintained. Only where interactions require it, results get moved up in
+ *  the hierarchy.
+ *
+ *  The output is not merged across cell boundaries, i.e. result polygons
+ *  from different cells may touch or overlap.
+ */
+class DB_PUBLIC HierarchicalProcessor
+{
+public:
+  /**
+   *  @brief Constructor
+   *
+   *  @param layout The layout to work on
+   *  @param top The top cell of the tree to process
+   */
+  HierarchicalProcessor (db::Layout *layout, db::Cell *top);
+
+  /**
+   *  @brief Enable progress reporting
+   */
+  void enable_progress (const std::string &progress_desc = std::string ());
+
+  /**
+   *  @brief Disable progress reporting
+   */
+  void disable_progress ();
+
+  /**
+   *  @brief Runs the given operation
+   *
+   *  @param op The local operation to run
+   *  @param subject_layer The layer from which to take the subjects
+   *  @param intruder_layer The layer from which to take the intruders (can be the same as subject_layer)
+   *  @param output_layer The layer where the results are stored
+   */
+  void run (const LocalOperation &op, unsigned int subject_layer, unsigned int intruder_layer, unsigned int output_layer);
+
+private:
+  struct ContextUser
+  {
+    ContextUser (db::cell_index_type p, size_t pc, const db::ICplxTrans &t)
+      : parent (p), parent_context (pc), trans (t)
+    { }
+
+    db::cell_index_type parent;
+    size_t parent_context;
+    db::ICplxTrans trans;
+  };
+
+  struct CellContext
+  {
+    std::vector<db::Polygon> intruders;
+    std::vector<ContextUser> users;
+  };
+
+  typedef std::map<std::vector<db::Polygon>, std::vector<ContextUser> > context_map_type;
+
+  db::Layout *mp_layout;
+  db::Cell *mp_top;
+  bool m_report_progress;
+  std::string m_progress_desc;
+
+  void compute_contexts (const LocalOperation &op, const db::Cell &cell, const std::vector<CellContext> &contexts, unsigned int subject_layer, unsigned int intruder_layer, std::map<db::cell_index_type, context_map_type> &child_contexts) const;
+  void collect_intruders (const db::Cell &cell, const db::Box &region, const db::Instance &exclude_inst, const db::ICplxTrans &exclude_trans, unsigned int intruder_layer, std::vector<db::Polygon> &intruders) const;
+  void compute_results (const LocalOperation &op, db::Cell &cell, const std::vector<CellContext> &contexts, std::vector<std::vector<db::Polygon> > &results, unsigned int subject_layer, unsigned int intruder_layer) const;
+};
+
+}
+
+#endif
+
@@ -31,11 +31,15 @@
 #include "dbLibraryProxy.h"
 #include "dbLibraryManager.h"
 #include "dbLibrary.h"
+#include "dbLazyCellLoader.h"
 #include "tlTimer.h"
 #include "tlLog.h"
 #include "tlInternational.h"
 #include "tlProgress.h"
 #include "tlAssert.h"
+#include "tlThreadedWorkers.h"
+
+#include <memory>
 
 
 namespace db
@@ -255,6 +259,8 @@ LayerIterator::operator*() const
 
 Layout::Layout (db::Manager *manager)
   : db::Object (manager),
+    m_use_arena (true),
+    m_shapes_packed (false),
     m_cells_size (0),
     m_invalid (0),
     m_top_cells (0),
@@ -263,13 +269,20 @@ Layout::Layout (db::Manager *manager)
     m_properties_repository (this),
     m_guiding_shape_layer (-1),
     m_waste_layer (-1),
-    m_editable (db::default_editable_mode ())
+    m_editable (db::default_editable_mode ()),
+    mp_lazy_cell_loader (0),
+    m_update_threads (0),
+    m_record_changes (false),
+    m_change_serial (0),
+    m_change_log_serial (0)
 {
   // .. nothing yet ..
 }
 
 Layout::Layout (bool editable, db::Manager *manager)
   : db::Object (manager),
+    m_use_arena (true),
+    m_shapes_packed (false),
     m_cells_size (0),
     m_invalid (0),
     m_top_cells (0),
@@ -278,7 +291,12 @@ Layout::Layout (bool editable, db::Manager *manager)
     m_properties_repository (this),
     m_guiding_shape_layer (-1),
     m_waste_layer (-1),
-    m_editable (editable)
+    m_editable (editable),
+    mp_lazy_cell_loader (0),
+    m_update_threads (0),
+    m_record_changes (false),
+    m_change_serial (0),
+    m_change_log_serial (0)
 {
   // .. nothing yet ..
 }
@@ -287,6 +305,8 @@ Layout::Layout (const db::Layout &layout)
   : db::Object (layout),
     db::LayoutStateModel (),
     gsi::ObjectBase (),
+    m_use_arena (true),
+    m_shapes_packed (false),
     m_cells_size (0),
     m_invalid (0),
     m_top_cells (0),
@@ -295,7 +315,12 @@ Layout::Layout (const db::Layout &layout)
     m_properties_repository (this),
     m_guiding_shape_layer (-1),
     m_waste_layer (-1),
-    m_editable (layout.m_editable)
+    m_editable (layout.m_editable),
+    mp_lazy_cell_loader (0),
+    m_update_threads (0),
+    m_record_changes (false),
+    m_change_serial (0),
+    m_change_log_serial (0)
 {
   *this = layout;
 }
@@ -311,6 +336,31 @@ Layout::~Layout ()
   clear ();
 }
 
+void
+Layout::set_lazy_cell_loader (db::LazyCellLoader *loader)
+{
+  if (loader != mp_lazy_cell_loader) {
+    delete mp_lazy_cell_loader;
+    mp_lazy_cell_loader = loader;
+  }
+}
+
+void
+Layout::load_lazy_cells ()
+{
+  if (mp_lazy_cell_loader) {
+    mp_lazy_cell_loader->load_all (*this);
+  }
+}
+
+void
+Layout::load_lazy_cells (const std::string &path)
+{
+  if (mp_lazy_cell_loader && mp_lazy_cell_loader->reads_from (path)) {
+    mp_lazy_cell_loader->load_all (*this);
+  }
+}
+
 void
 Layout::dbu (double d)
 {
@@ -328,11 +378,18 @@ Layout::clear ()
 {
   invalidate_hier ();
 
+  if (m_record_changes) {
+    discard_changes ();
+  }
+
   m_free_cell_indices.clear ();
   m_cells.clear ();
   m_cells_size = 0;
   m_cell_ptrs.clear ();
 
+  //  the loader is deleted after the cells since these may refer to it
+  set_lazy_cell_loader (0);
+
   m_top_down_list.clear ();
 
   m_free_indices.clear ();
@@ -357,6 +414,7 @@ Layout::clear ()
   m_pcells.clear ();
   m_pcell_ids.clear ();
 
+  m_shapes_packed = false;
   m_guiding_shape_layer = -1;
   m_waste_layer = -1;
 
@@ -461,6 +519,7 @@ Layout::collect_mem_stat (db::MemStatistics &m) const
   m.shapes_cache (m_shape_repository);
   m.shapes_cache (m_array_repository);
   m.layout_info (m_meta_info);
+  m_arena.collect_mem_stat (m);
 }
 
 void
@@ -1164,6 +1223,19 @@ Layout::allocate_new_cell ()
   return new_index;
 }
 
+void
+Layout::pack_shapes ()
+{
+  update ();
+
+  db::Arena *arena = m_use_arena ? &m_arena : 0;
+  for (iterator c = begin (); c != end (); ++c) {
+    c->pack_shapes (arena);
+  }
+
+  m_shapes_packed = true;
+}
+
 void
 Layout::cleanup ()
 {
@@ -1268,6 +1340,192 @@ Layout::update () const
   }
 }
 
+// -----------------------------------------------------------------
+//  Implementation of the cell update job
+
+/**
+ *  @brief The per-cell part of the layout update
+ *
+ *  This operation updates the bounding box of a cell and sorts the shape and 
+ *  instance trees. It requires the child cells to be updated before. The operation
+ *  only modifies the cell itself, so it can be applied to the cells of one hierarchy 
+ *  level concurrently.
+ */
+class CellUpdateOp
+{
+public:
+  CellUpdateOp (db::Layout &layout, bool update_bboxes, bool sort_insts, const std::vector<char> &dirty_parents, std::vector<char> &bbox_changed)
+    : mp_layout (&layout), m_update_bboxes (update_bboxes), m_sort_insts (sort_insts), mp_dirty_parents (&dirty_parents), mp_bbox_changed (&bbox_changed)
+  {
+    //  .. nothing yet ..
+  }
+
+  void operator() (db::cell_index_type ci, unsigned int layers) const
+  {
+    db::Cell &cp = mp_layout->cell (ci);
+    bool dirty = (*mp_dirty_parents) [ci] != 0;
+
+    if (m_update_bboxes) {
+      if (cp.is_shape_bbox_dirty () || dirty) {
+        (*mp_bbox_changed) [ci] = cp.update_bbox (layers);
+      }
+      cp.sort_shapes ();
+    }
+
+    //  sort the instance trees now, since we have computed the bboxes
+    if (m_sort_insts || dirty) {
+      cp.sort_inst_tree ();
+    }
+  }
+
+private:
+  db::Layout *mp_layout;
+  bool m_update_bboxes, m_sort_insts;
+  const std::vector<char> *mp_dirty_parents;
+  std::vector<char> *mp_bbox_changed;
+};
+
+namespace
+{
+
+class CellUpdateTask
+  : public tl::Task
+{
+public:
+  CellUpdateTask (const db::cell_index_type *from, const db::cell_index_type *to)
+    : mp_from (from), mp_to (to)
+  {
+    //  .. nothing yet ..
+  }
+
+  const db::cell_index_type *from () const
+  {
+    return mp_from;
+  }
+
+  const db::cell_index_type *to () const
+  {
+    return mp_to;
+  }
+
+private:
+  const db::cell_index_type *mp_from, *mp_to;
+};
+
+class CellUpdateJob
+  : public tl::JobBase
+{
+public:
+  CellUpdateJob (int nworkers, const CellUpdateOp &op)
+    : tl::JobBase (nworkers), m_op (op), m_layers (0), m_cells_done (0)
+  {
+    //  .. nothing yet ..
+  }
+
+  /**
+   *  @brief Updates the given cells in parallel
+   *
+   *  The progress is advanced while the job is running. If the progress 
+   *  throws an exception (i.e. because the operation was cancelled), the job
+   *  is terminated.
+   */
+  void run (const std::vector<db::cell_index_type> &cells, unsigned int layers, tl::RelativeProgress &progress, size_t progress_pos)
+  {
+    m_layers = layers;
+    m_cells_done = 0;
+
+    //  a few chunks per worker provide some load balancing at a small overhead
+    size_t chunk = std::max (size_t (1), cells.size () / size_t (num_workers () * 8));
+    const db::cell_index_type *c = &cells.front ();
+    const db::cell_index_type *cend = c + cells.size ();
+    while (c != cend) {
+      const db::cell_index_type *cnext = c + std::min (chunk, size_t (cend - c));
+      schedule (new CellUpdateTask (c, cnext));
+      c = cnext;
+    }
+
+    try {
+
+      start ();
+      while (is_running ()) {
+        progress.set (progress_pos + cells_done ());
+        wait (100);
+      }
+
+    } catch (...) {
+      terminate ();
+      throw;
+    }
+
+    if (has_error ()) {
+      throw tl::Exception (tl::to_string (QObject::tr ("Errors occured during layout update. First error message says:\n")) + error_messages ().front ());
+    }
+  }
+
+  const CellUpdateOp &op () const
+  {
+    return m_op;
+  }
+
+  unsigned int layers () const
+  {
+    return m_layers;
+  }
+
+  void cells_done (size_t n)
+  {
+    QMutexLocker locker (&m_mutex);
+    m_cells_done += n;
+  }
+
+  size_t cells_done ()
+  {
+    QMutexLocker locker (&m_mutex);
+    return m_cells_done;
+  }
+
+  virtual tl::Worker *create_worker ();
+
+private:
+  CellUpdateOp m_op;
+  unsigned int m_layers;
+  size_t m_cells_done;
+  QMutex m_mutex;
+};
+
+class CellUpdateWorker
+  : public tl::Worker
+{
+public:
+  CellUpdateWorker (CellUpdateJob *job)
+    : tl::Worker (), mp_job (job)
+  {
+    //  .. nothing yet ..
+  }
+
+  void perform_task (tl::Task *task) 
+  {
+    CellUpdateTask *update_task = dynamic_cast <CellUpdateTask *> (task);
+    if (update_task) {
+      for (const db::cell_index_type *c = update_task->from (); c != update_task->to (); ++c) {
+        mp_job->op () (*c, mp_job->layers ());
+      }
+      mp_job->cells_done (update_task->to () - update_task->from ());
+    }
+  }
+
+private:
+  CellUpdateJob *mp_job;
+};
+
+tl::Worker *
+CellUpdateJob::create_worker ()
+{
+  return new CellUpdateWorker (this);
+}
+
+}
+
 void 
 Layout::do_update ()
 {
@@ -1282,7 +1540,8 @@ Layout::do_update ()
 
     //  if the hierarchy has been changed so far, update
     //  the hierarchy management informations
-    if (hier_dirty ()) {
+    bool sort_insts = hier_dirty ();
+    if (sort_insts) {
       {
         tl::SelfTimer timer (tl::verbosity () >= 31, "Updating relations");
         pr->set_desc (tl::to_string (QObject::tr ("Updating relations")));
@@ -1295,67 +1554,87 @@ Layout::do_update ()
       }
     }
 
-    //  KLUDGE: a boolean vector (with size as determined by number of cells)
-    //  would probably be much faster!
-    std::set<cell_index_type> dirty_parents;
-
     //  if something on the bboxes (either on shape level or on 
     //  cell bbox level - i.e. by child instances) has been changed,
     //  update the bbox informations. In addition sort the shapes
     //  lists of region queries, since they might have changed once
     //  the bboxes are dirty.
-    if (bboxes_dirty ()) {
+    bool update_bboxes = bboxes_dirty ();
 
-      {
-        tl::SelfTimer timer (tl::verbosity () >= 31, "Updating bounding boxes");
-        unsigned int layers = 0;
-        pr->set (0);
-        pr->set_desc (tl::to_string (QObject::tr ("Updating bounding boxes")));
-        for (bottom_up_iterator c = begin_bottom_up (); c != end_bottom_up (); ++c) {
-          ++*pr;
-          cell_type &cp (cell (*c));
-          if (cp.is_shape_bbox_dirty () || dirty_parents.find (*c) != dirty_parents.end ()) {
-            if (cp.update_bbox (layers)) {
-              //  the bounding box has changed - need to insert parents into "dirty parents" list
-              for (cell_type::parent_cell_iterator p = cp.begin_parent_cells (); p != cp.end_parent_cells (); ++p) {
-                dirty_parents.insert (*p);
-              }
-            } 
-          }
-          if (cp.layers () > layers) {
-            layers = cp.layers ();
-          }
+    if (update_bboxes || sort_insts) {
+
+      tl::SelfTimer timer (tl::verbosity () >= 31, "Updating bounding boxes and sorting");
+      pr->set (0);
+      pr->set_desc (tl::to_string (QObject::tr ("Updating bounding boxes and sorting")));
+
+      //  group the cells by hierarchy level: the cells of one level don't depend on each other
+      //  and can be processed in any order once the levels below have been processed.
+      std::vector<unsigned int> cell_levels (m_cell_ptrs.size (), 0);
+      std::vector<std::vector<cell_index_type> > levels;
+      for (bottom_up_iterator c = begin_bottom_up (); c != end_bottom_up (); ++c) {
+        unsigned int l = 0;
+        for (cell_type::child_cell_iterator cc = cell (*c).begin_child_cells (); ! cc.at_end (); ++cc) {
+          l = std::max (l, cell_levels [*cc] + 1);
+        }
+        cell_levels [*c] = l;
+        if (levels.size () <= l) {
+          levels.resize (l + 1);
         }
+        levels [l].push_back (*c);
       }
 
-      {
-        tl::SelfTimer timer (tl::verbosity () >= 31, "Sorting shapes");
-        pr->set (0);
-        pr->set_desc (tl::to_string (QObject::tr ("Sorting shapes")));
-        for (bottom_up_iterator c = begin_bottom_up (); c != end_bottom_up (); ++c) {
-          ++*pr;
-          cell_type &cp (cell (*c));
-          cp.sort_shapes ();
+      std::vector<char> dirty_parents (m_cell_ptrs.size (), 0);
+      std::vector<char> bbox_changed (m_cell_ptrs.size (), 0);
+      CellUpdateOp op (*this, update_bboxes, sort_insts, dirty_parents, bbox_changed);
+
+      std::auto_ptr<CellUpdateJob> job;
+      if (m_update_threads > 0) {
+
+        job.reset (new CellUpdateJob (int (m_update_threads), op));
+
+        //  path references compute their bounding boxes on demand. Paths are shared between 
+        //  cells, so we compute the boxes in advance.
+        if (update_bboxes) {
+          const db::repository<db::Path> &paths = m_shape_repository.repository (db::object_tag<db::Path> ());
+          for (db::repository<db::Path>::iterator p = paths.begin (); p != paths.end (); ++p) {
+            p->box ();
+          }
         }
+
       }
-    }
 
-    //  sort the instance trees now, since we have computed the bboxes
-    if (hier_dirty () || ! dirty_parents.empty ()) {
-      tl::SelfTimer timer (tl::verbosity () >= 31, "Sorting instances");
-      size_t layers = 0;
-      pr->set (0);
-      pr->set_desc (tl::to_string (QObject::tr ("Sorting instances")));
-      for (bottom_up_iterator c = begin_bottom_up (); c != end_bottom_up (); ++c) {
-        ++*pr;
-        cell_type &cp (cell (*c));
-        if (hier_dirty () || dirty_parents.find (*c) != dirty_parents.end ()) {
-          cp.sort_inst_tree ();
+      //  "layers" is the number of layers the child cells have shapes on
+      unsigned int layers = 0;
+      size_t cells_done = 0;
+
+      for (std::vector<std::vector<cell_index_type> >::const_iterator l = levels.begin (); l != levels.end (); ++l) {
+
+        if (job.get () && l->size () > 1) {
+          job->run (*l, layers, *pr, cells_done);
+        } else {
+          for (std::vector<cell_index_type>::const_iterator c = l->begin (); c != l->end (); ++c) {
+            pr->set (cells_done + (c - l->begin ()) + 1);
+            op (*c, layers);
+          }
         }
-        if (cp.layers () > layers) {
-          layers = cp.layers ();
+
+        cells_done += l->size ();
+
+        for (std::vector<cell_index_type>::const_iterator c = l->begin (); c != l->end (); ++c) {
+          const cell_type &cp = cell (*c);
+          if (bbox_changed [*c]) {
+            //  the bounding box has changed - need to mark the parents as "dirty parents"
+            for (cell_type::parent_cell_iterator p = cp.begin_parent_cells (); p != cp.end_parent_cells (); ++p) {
+              dirty_parents [*p] = 1;
+            }
+          }
+          if (cp.layers () > layers) {
+            layers = cp.layers ();
+          }
         }
+
       }
+
     }
 
   } catch (...) {
@@ -1366,6 +1645,78 @@ Layout::do_update ()
   delete pr;
 }
 
+/**
+ *  @brief The maximum number of change regions kept in the change log
+ *
+ *  If more changes are made, the log is discarded and the changes are no longer known in detail.
+ */
+static const size_t max_change_log_size = 10000;
+
+void
+Layout::set_record_changes (bool f)
+{
+  if (f != m_record_changes) {
+    m_record_changes = f;
+    discard_changes ();
+  }
+}
+
+void
+Layout::register_change (db::cell_index_type ci, unsigned int layer, const db::Box &box)
+{
+  if (! m_record_changes || box.empty ()) {
+    return;
+  }
+
+  QMutexLocker locker (&m_change_lock);
+
+  if (under_construction () || box == db::Box::world () || m_change_log.size () >= max_change_log_size) {
+    do_discard_changes ();
+  } else {
+    ++m_change_serial;
+    m_change_log.push_back (LayoutChangeRegion (ci, layer, box));
+  }
+}
+
+void
+Layout::discard_changes ()
+{
+  QMutexLocker locker (&m_change_lock);
+  do_discard_changes ();
+}
+
+void
+Layout::do_discard_changes ()
+{
+  ++m_change_serial;
+  m_change_log_serial = m_change_serial;
+  m_change_log.clear ();
+}
+
+size_t
+Layout::change_serial () const
+{
+  QMutexLocker locker (&m_change_lock);
+  return m_change_serial;
+}
+
+bool
+Layout::changed_regions (size_t since, std::vector<db::LayoutChangeRegion> &regions) const
+{
+  if (! m_record_changes || under_construction ()) {
+    return false;
+  }
+
+  QMutexLocker locker (&m_change_lock);
+
+  if (since < m_change_log_serial || since > m_change_serial) {
+    return false;
+  }
+
+  regions.insert (regions.end (), m_change_log.begin () + (since - m_change_log_serial), m_change_log.end ());
+  return true;
+}
+
 void
 Layout::clear_meta ()
 {
@@ -34,11 +34,14 @@
 #include "dbLayoutStateModel.h"
 #include "dbLayerProperties.h"
 #include "dbMetaInfo.h"
+#include "dbArena.h"
 #include "tlException.h"
 #include "tlVector.h"
 #include "tlString.h"
 #include "gsi.h"
 
+#include <QMutex>
+
 #include <cstring>
 #include <map>
 #include <string>
@@ -58,6 +61,7 @@ class Library;
 class LibraryProxy;
 class CellMapping;
 class LayerMapping;
+class LazyCellLoader;
 
 template <class Coord> class generic_repository;
 typedef generic_repository<db::Coord> GenericRepository;
@@ -445,6 +449,38 @@ public:
   virtual std::pair <bool, unsigned int> map_layer (const LayerProperties &lprops) = 0;
 };
 
+/**
+ *  @brief Describes a region in which the shapes of a cell have changed
+ *
+ *  See db::Layout::changed_regions for details.
+ */
+struct DB_PUBLIC LayoutChangeRegion
+{
+  /**
+   *  @brief Creates a change region object
+   */
+  LayoutChangeRegion (db::cell_index_type ci, unsigned int l, const db::Box &b)
+    : cell_index (ci), layer (l), box (b)
+  {
+    //  .. nothing yet ..
+  }
+
+  /**
+   *  @brief The index of the cell which has changed
+   */
+  db::cell_index_type cell_index;
+
+  /**
+   *  @brief The layer on which the shapes have changed
+   */
+  unsigned int layer;
+
+  /**
+   *  @brief The region of the change in the coordinate system of the cell
+   */
+  db::Box box;
+};
+
 /**
  *  @brief The layout object
  *
@@ -1390,6 +1426,28 @@ public:
    */
   void cleanup ();
 
+  /**
+   *  @brief Packs the shapes of all cells
+   *
+   *  This method updates the layout and packs the shapes lists of all cells
+   *  (see db::Shapes::pack). Packing reduces the memory footprint and improves
+   *  the memory locality of region queries. It is intended for layouts which 
+   *  are mostly read, i.e. after a layout has been loaded. Editing the shapes 
+   *  will unpack the respective layers again. Cells loaded lazily later on are 
+   *  packed when their shapes are installed (see "shapes_packed").
+   */
+  void pack_shapes ();
+
+  /**
+   *  @brief Gets a value indicating whether the shapes have been packed
+   *
+   *  This flag is set by "pack_shapes" and reset by "clear".
+   */
+  bool shapes_packed () const
+  {
+    return m_shapes_packed;
+  }
+
   /**
    *  @brief Implementation of the undo operations
    */
@@ -1493,6 +1551,10 @@ public:
     if (m_invalid > 0) {
       --m_invalid;
       if (! m_invalid) {
+        //  changes made under construction are not recorded individually
+        if (m_record_changes) {
+          discard_changes ();
+        }
         update ();
       }
     }
@@ -1578,6 +1640,157 @@ public:
    */
   const std::string &meta_info_value (const std::string &name) const;
 
+  /**
+   *  @brief Installs the loader for lazy cells
+   *
+   *  The layout takes over the ownership of the loader. A previous loader is deleted.
+   *  This method is intended to be used by readers which support lazy loading. 
+   *  See db::LazyCellLoader for details.
+   */
+  void set_lazy_cell_loader (db::LazyCellLoader *loader);
+
+  /**
+   *  @brief Gets the loader for lazy cells
+   *
+   *  This method returns 0 if no loader is installed.
+   */
+  db::LazyCellLoader *lazy_cell_loader () const
+  {
+    return mp_lazy_cell_loader;
+  }
+
+  /**
+   *  @brief Loads the shapes of all lazy cells
+   *
+   *  After this method has been called, the file the lazy cells are read from is released.
+   */
+  void load_lazy_cells ();
+
+  /**
+   *  @brief Loads the shapes of all lazy cells if they are read from the given file
+   *
+   *  This method must be called before the given file is overwritten, i.e. when the layout
+   *  is saved to the file it was read from. Otherwise the shapes not loaded yet are lost.
+   */
+  void load_lazy_cells (const std::string &path);
+
+  /**
+   *  @brief Sets the number of threads to use for updating the layout
+   *
+   *  With a value larger than 0, the bounding boxes are computed and the shape and instance
+   *  trees are sorted by the given number of threads in parallel. The cells of one hierarchy
+   *  level are processed concurrently. The result is identical to the single-threaded update.
+   *  A value of 0 (the default) will update the layout in the calling thread.
+   *  This setting is not copied with the layout.
+   */
+  void set_update_threads (unsigned int n)
+  {
+    m_update_threads = n;
+  }
+
+  /**
+   *  @brief Gets the number of threads to use for updating the layout
+   */
+  unsigned int update_threads () const
+  {
+    return m_update_threads;
+  }
+
+  /**
+   *  @brief Enables or disables the recording of change regions
+   *
+   *  If recording is enabled, the shape containers of the layout report the regions in which
+   *  shapes are inserted, deleted or modified (see "changed_regions"). This allows observers to
+   *  update their state incrementally. Recording is disabled by default and the setting is not
+   *  copied with the layout.
+   */
+  void set_record_changes (bool f);
+
+  /**
+   *  @brief Enables or disables the arena for packed shapes
+   *
+   *  If the arena is enabled, "pack_shapes" allocates the buffers for the packed
+   *  layers from an arena owned by the layout. This reduces the number of memory blocks 
+   *  and releasing the layout becomes a bulk operation. The arena is enabled by default.
+   *  The setting is not copied with the layout.
+   */
+  void set_use_arena (bool f)
+  {
+    m_use_arena = f;
+  }
+
+  /**
+   *  @brief Gets a value indicating whether the arena is enabled
+   */
+  bool use_arena () const
+  {
+    return m_use_arena;
+  }
+
+  /**
+   *  @brief Gets the arena for packed shapes
+   */
+  const db::Arena &arena () const
+  {
+    return m_arena;
+  }
+
+  /**
+   *  @brief Gets the arena for packed shapes (non-const version)
+   */
+  db::Arena &arena ()
+  {
+    return m_arena;
+  }
+
+  /**
+   *  @brief Gets a value indicating whether change regions are recorded currently
+   *
+   *  Changes are not recorded individually while the layout is under construction.
+   */
+  bool records_changes () const
+  {
+    return m_record_changes && ! under_construction ();
+  }
+
+  /**
+   *  @brief Registers a change region
+   *
+   *  This method is called by the shape containers before the shapes on the given layer
+   *  of the given cell change inside the given box. A world box indicates that the region
+   *  of the change is not known.
+   *  The change log is protected by a lock, so this method may be called while other threads
+   *  ask for the changed regions.
+   */
+  void register_change (db::cell_index_type ci, unsigned int layer, const db::Box &box);
+
+  /**
+   *  @brief Discards the recorded change regions
+   *
+   *  After this method has been called, "changed_regions" will report that the changes
+   *  are not known for any state before this call.
+   */
+  void discard_changes ();
+
+  /**
+   *  @brief Gets a serial number representing the current change state
+   *
+   *  Use this number with "changed_regions" to obtain the changes made after this state.
+   */
+  size_t change_serial () const;
+
+  /**
+   *  @brief Gets the regions which changed after the state given by the serial number
+   *
+   *  The regions are appended to "regions". Boxes reported for the same cell and layer may overlap.
+   *  This method returns false if the changes are not known in detail. This happens if recording
+   *  was not enabled, too many changes have been made, the region of a change is not known or the
+   *  layout is under construction. In that case, the caller must assume that everything has changed.
+   *  Changes of the hierarchy are not reported as regions - observers are informed about these
+   *  through the "hier_changed" event.
+   */
+  bool changed_regions (size_t since, std::vector<db::LayoutChangeRegion> &regions) const;
+
 protected:
   /**
    *  @brief Establish the graph's internals according to the dirty flags
@@ -1593,6 +1806,10 @@ protected:
 private:
   enum LayerState { Normal, Free, Special };
 
+  //  NOTE: the arena is declared first, so it is destroyed after the cells
+  db::Arena m_arena;
+  bool m_use_arena;
+  bool m_shapes_packed;
   cell_list m_cells;
   size_t m_cells_size;
   cell_ptr_vector m_cell_ptrs;
@@ -1618,6 +1835,12 @@ private:
   int m_waste_layer;
   bool m_editable;
   meta_info m_meta_info;
+  db::LazyCellLoader *mp_lazy_cell_loader;
+  unsigned int m_update_threads;
+  bool m_record_changes;
+  size_t m_change_serial, m_change_log_serial;
+  std::vector<LayoutChangeRegion> m_change_log;
+  mutable QMutex m_change_lock;
 
   /**
    *  @brief Sort the cells topologically
@@ -1641,6 +1864,11 @@ private:
    */
   void register_cell_name (const char *name, cell_index_type ci);
 
+  /**
+   *  @brief Discards the change log (must be called with the change lock held)
+   */
+  void do_discard_changes ();
+
   /**
    *  @brief Allocate a cell index for a new cell
    */
@@ -0,0 +1,1301 @@
+
+/*
+
+  KLayout Layout Viewer
+  Copyright (C) 2006-2017 Matthias Koefferlein
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+
+#include "dbLayoutCache.h"
+#include "dbLayout.h"
+#include "dbStreamLayers.h"
+#include "dbLoadLayoutOptions.h"
+#include "dbCommonReader.h"
+#include "dbGDS2Reader.h"
+#include "dbOASISReader.h"
+#include "tlStream.h"
+#include "tlLog.h"
+#include "tlString.h"
+#include "tlInternational.h"
+
+#include <QFileInfo>
+#include <QDateTime>
+#include <QFile>
+#include <QDir>
+
+#include <cstdlib>
+#include <cstring>
+
+#if defined(_WIN32)
+#  include <process.h>
+#else
+#  include <unistd.h>
+#endif
+
+namespace db
+{
+
+// ---------------------------------------------------------------
+//  The cache file format
+//
+//  All numbers are little-endian fixed-size integers or IEEE doubles. The file starts
+//  with the magic bytes and the format version, followed by the stamp string.
+//  The layout follows in this order: database unit, properties, layers, cells (names),
+//  cell contents (instances and shapes per layer), layer map and the end magic.
+//  Shapes are written in the order of the shape containers. Objects held in the
+//  shape repository (for shape references and shape arrays) are written once and
+//  referred to by their sequence number later.
+
+static const char cache_magic [] = "KLAYOUT-CACHE\0\0\0";
+static const size_t cache_magic_size = 16;
+static const uint32_t cache_version = 1;
+
+static const unsigned char tag_end = 0;
+static const unsigned char tag_with_properties = 0x80;
+
+static size_t s_hits = 0;
+
+// ---------------------------------------------------------------
+//  CacheWriter definition and implementation
+
+namespace
+{
+
+class CacheWriter
+{
+public:
+  CacheWriter (tl::OutputStream &stream)
+    : m_stream (stream)
+  {
+    //  .. nothing yet ..
+  }
+
+  void put_bytes (const char *b, size_t n)
+  {
+    m_stream.put (b, n);
+  }
+
+  void put_byte (unsigned char c)
+  {
+    m_stream.put ((const char *) &c, 1);
+  }
+
+  void put_uint32 (uint32_t v)
+  {
+    char b [4];
+    for (unsigned int i = 0; i < 4; ++i) {
+      b [i] = char (v & 0xff);
+      v >>= 8;
+    }
+    m_stream.put (b, 4);
+  }
+
+  void put_uint64 (uint64_t v)
+  {
+    char b [8];
+    for (unsigned int i = 0; i < 8; ++i) {
+      b [i] = char (v & 0xff);
+      v >>= 8;
+    }
+    m_stream.put (b, 8);
+  }
+
+  void put_int32 (int32_t v)
+  {
+    put_uint32 (uint32_t (v));
+  }
+
+  void put_double (double d)
+  {
+    uint64_t v = 0;
+    memcpy (&v, &d, sizeof (v));
+    put_uint64 (v);
+  }
+
+  void put_string (const std::string &s)
+  {
+    put_uint64 (s.size ());
+    m_stream.put (s.c_str (), s.size ());
+  }
+
+  void put_vector (const db::Vector &v)
+  {
+    put_int32 (v.x ());
+    put_int32 (v.y ());
+  }
+
+  void put_point (const db::Point &p)
+  {
+    put_int32 (p.x ());
+    put_int32 (p.y ());
+  }
+
+  template <class Iter>
+  void put_points (Iter from, Iter to, size_t n)
+  {
+    put_uint64 (n);
+    for (Iter p = from; p != to; ++p) {
+      put_point (*p);
+    }
+  }
+
+  void put_variant (const tl::Variant &v)
+  {
+    if (v.is_nil ()) {
+      put_byte (0);
+    } else if (v.is_bool ()) {
+      put_byte (1);
+      put_byte (v.to_bool () ? 1 : 0);
+    } else if (v.is_long ()) {
+      put_byte (2);
+      put_uint64 (uint64_t (v.to_longlong ()));
+    } else if (v.is_ulong ()) {
+      put_byte (3);
+      put_uint64 (uint64_t (v.to_ulonglong ()));
+    } else if (v.is_longlong ()) {
+      put_byte (4);
+      put_uint64 (uint64_t (v.to_longlong ()));
+    } else if (v.is_ulonglong ()) {
+      put_byte (5);
+      put_uint64 (uint64_t (v.to_ulonglong ()));
+    } else if (v.is_double ()) {
+      put_byte (6);
+      put_double (v.to_double ());
+    } else if (v.is_a_string ()) {
+      put_byte (7);
+      put_string (v.to_string ());
+    } else if (v.is_list ()) {
+      put_byte (9);
+      put_uint32 (uint32_t (v.get_list ().size ()));
+      for (tl::Variant::const_iterator i = v.begin (); i != v.end (); ++i) {
+        put_variant (*i);
+      }
+    } else {
+      put_byte (8);
+      put_string (v.to_parsable_string ());
+    }
+  }
+
+  void put_trans (const db::UnitTrans &)
+  {
+    //  .. nothing to write ..
+  }
+
+  void put_trans (const db::Disp &t)
+  {
+    put_vector (t.disp ());
+  }
+
+  void put_trans (const db::Trans &t)
+  {
+    put_byte ((unsigned char) t.rot ());
+    put_vector (t.disp ());
+  }
+
+  void put_object (const db::Box &b)
+  {
+    put_int32 (b.left ());
+    put_int32 (b.bottom ());
+    put_int32 (b.right ());
+    put_int32 (b.top ());
+  }
+
+  void put_object (const db::ShortBox &b)
+  {
+    put_int32 (b.left ());
+    put_int32 (b.bottom ());
+    put_int32 (b.right ());
+    put_int32 (b.top ());
+  }
+
+  void put_object (const db::Edge &e)
+  {
+    put_point (e.p1 ());
+    put_point (e.p2 ());
+  }
+
+  void put_object (const db::Polygon &p)
+  {
+    put_uint32 (p.holes ());
+    put_points (p.begin_hull (), p.end_hull (), p.hull ().size ());
+    for (unsigned int h = 0; h < p.holes (); ++h) {
+      put_points (p.begin_hole (h), p.end_hole (h), p.hole (h).size ());
+    }
+  }
+
+  void put_object (const db::SimplePolygon &p)
+  {
+    put_points (p.begin_hull (), p.end_hull (), p.hull ().size ());
+  }
+
+  void put_object (const db::Path &p)
+  {
+    put_int32 (p.width ());
+    put_int32 (p.bgn_ext ());
+    put_int32 (p.end_ext ());
+    put_byte (p.round () ? 1 : 0);
+    put_points (p.begin (), p.end (), p.points ());
+  }
+
+  void put_object (const db::Text &t)
+  {
+    put_string (t.string ());
+    put_trans (t.trans ());
+    put_int32 (t.size ());
+    put_int32 (int32_t (t.font ()));
+    put_int32 (int32_t (t.halign ()));
+    put_int32 (int32_t (t.valign ()));
+  }
+
+  /**
+   *  @brief Writes an object held in the shape repository
+   *
+   *  Such objects are written once. Later references only write the sequence number.
+   */
+  template <class Obj>
+  void put_shared_object (const Obj &obj)
+  {
+    std::map<const void *, uint64_t>::const_iterator i = m_shared_objects.find ((const void *) &obj);
+    if (i != m_shared_objects.end ()) {
+      put_uint64 (i->second);
+    } else {
+      uint64_t id = m_shared_objects.size ();
+      m_shared_objects.insert (std::make_pair ((const void *) &obj, id));
+      put_uint64 (id);
+      put_object (obj);
+    }
+  }
+
+  template <class Obj, class Trans>
+  void put_array_base (const db::array<Obj, Trans> &a)
+  {
+    db::Vector va, vb;
+    unsigned long na = 0, nb = 0;
+    std::vector<db::Vector> pts;
+
+    unsigned char kind = 0;
+    if (a.is_regular_array (va, vb, na, nb)) {
+      kind = 1;
+    } else if (a.is_iterated_array (&pts)) {
+      kind = 2;
+    }
+
+    bool complex = a.is_complex ();
+    put_byte (kind | (complex ? 4 : 0));
+
+    put_trans (a.front ());
+
+    if (complex) {
+      db::ICplxTrans ct = a.complex_trans ();
+      put_double (ct.rcos ());
+      put_double (ct.mag ());
+    }
+
+    if (kind == 1) {
+      put_vector (va);
+      put_vector (vb);
+      put_uint64 (na);
+      put_uint64 (nb);
+    } else if (kind == 2) {
+      put_uint64 (pts.size ());
+      for (std::vector<db::Vector>::const_iterator p = pts.begin (); p != pts.end (); ++p) {
+        put_vector (*p);
+      }
+    }
+  }
+
+private:
+  tl::OutputStream &m_stream;
+  std::map<const void *, uint64_t> m_shared_objects;
+};
+
+// ---------------------------------------------------------------
+//  CacheReader definition and implementation
+
+class CacheReader
+{
+public:
+  CacheReader (tl::InputStream &stream, db::Layout &layout)
+    : m_stream (stream), mp_layout (&layout)
+  {
+    //  .. nothing yet ..
+  }
+
+  const char *get_bytes (size_t n)
+  {
+    const char *b = m_stream.get (n);
+    if (! b) {
+      throw tl::Exception (tl::to_string (QObject::tr ("Unexpected end of file in layout cache file")));
+    }
+    return b;
+  }
+
+  unsigned char get_byte ()
+  {
+    return (unsigned char) *get_bytes (1);
+  }
+
+  uint32_t get_uint32 ()
+  {
+    const unsigned char *b = (const unsigned char *) get_bytes (4);
+    uint32_t v = 0;
+    for (unsigned int i = 4; i > 0; --i) {
+      v = (v << 8) | b [i - 1];
+    }
+    return v;
+  }
+
+  uint64_t get_uint64 ()
+  {
+    const unsigned char *b = (const unsigned char *) get_bytes (8);
+    uint64_t v = 0;
+    for (unsigned int i = 8; i > 0; --i) {
+      v = (v << 8) | b [i - 1];
+    }
+    return v;
+  }
+
+  int32_t get_int32 ()
+  {
+    return int32_t (get_uint32 ());
+  }
+
+  double get_double ()
+  {
+    uint64_t v = get_uint64 ();
+    double d = 0.0;
+    memcpy (&d, &v, sizeof (d));
+    return d;
+  }
+
+  std::string get_string ()
+  {
+    size_t n = size_t (get_uint64 ());
+    if (n == 0) {
+      return std::string ();
+    } else {
+      return std::string (get_bytes (n), n);
+    }
+  }
+
+  db::Vector get_vector ()
+  {
+    db::Coord x = get_int32 ();
+    db::Coord y = get_int32 ();
+    return db::Vector (x, y);
+  }
+
+  db::Point get_point ()
+  {
+    db::Coord x = get_int32 ();
+    db::Coord y = get_int32 ();
+    return db::Point (x, y);
+  }
+
+  void get_points (std::vector<db::Point> &pts)
+  {
+    size_t n = size_t (get_uint64 ());
+    pts.clear ();
+    pts.reserve (n);
+    for (size_t i = 0; i < n; ++i) {
+      pts.push_back (get_point ());
+    }
+  }
+
+  tl::Variant get_variant ()
+  {
+    unsigned char t = get_byte ();
+    if (t == 0) {
+      return tl::Variant ();
+    } else if (t == 1) {
+      return tl::Variant (get_byte () != 0);
+    } else if (t == 2) {
+      return tl::Variant (long (int64_t (get_uint64 ())));
+    } else if (t == 3) {
+      return tl::Variant ((unsigned long) get_uint64 ());
+    } else if (t == 4) {
+      return tl::Variant ((long long) int64_t (get_uint64 ()));
+    } else if (t == 5) {
+      return tl::Variant ((unsigned long long) get_uint64 ());
+    } else if (t == 6) {
+      return tl::Variant (get_double ());
+    } else if (t == 7) {
+      return tl::Variant (get_string ());
+    } else if (t == 8) {
+      std::string s = get_string ();
+      tl::Variant v;
+      tl::Extractor ex (s.c_str ());
+      ex.read (v);
+      return v;
+    } else if (t == 9) {
+      std::vector<tl::Variant> list;
+      list.resize (get_uint32 ());
+      for (std::vector<tl::Variant>::iterator i = list.begin (); i != list.end (); ++i) {
+        *i = get_variant ();
+      }
+      return tl::Variant (list.begin (), list.end ());
+    } else {
+      throw tl::Exception (tl::to_string (QObject::tr ("Invalid value type in layout cache file")));
+    }
+  }
+
+  void get_trans (db::UnitTrans &)
+  {
+    //  .. nothing to read ..
+  }
+
+  void get_trans (db::Disp &t)
+  {
+    t = db::Disp (get_vector ());
+  }
+
+  void get_trans (db::Trans &t)
+  {
+    int rot = get_byte ();
+    t = db::Trans (rot, get_vector ());
+  }
+
+  void get_object (db::Box &b)
+  {
+    db::Coord l = get_int32 ();
+    db::Coord bt = get_int32 ();
+    db::Coord r = get_int32 ();
+    db::Coord t = get_int32 ();
+    b = db::Box (l, bt, r, t);
+  }
+
+  void get_object (db::ShortBox &b)
+  {
+    db::Coord l = get_int32 ();
+    db::Coord bt = get_int32 ();
+    db::Coord r = get_int32 ();
+    db::Coord t = get_int32 ();
+    b = db::ShortBox (l, bt, r, t);
+  }
+
+  void get_object (db::Edge &e)
+  {
+    db::Point p1 = get_point ();
+    db::Point p2 = get_point ();
+    e = db::Edge (p1, p2);
+  }
+
+  void get_object (db::Polygon &p)
+  {
+    unsigned int holes = get_uint32 ();
+    get_points (m_points);
+    p.assign_hull (m_points.begin (), m_points.end (), false /*don't compress*/);
+    for (unsigned int h = 0; h < holes; ++h) {
+      get_points (m_points);
+      p.insert_hole (m_points.begin (), m_points.end (), false /*don't compress*/);
+    }
+  }
+
+  void get_object (db::SimplePolygon &p)
+  {
+    get_points (m_points);
+    p.assign_hull (m_points.begin (), m_points.end (), false /*don't compress*/);
+  }
+
+  void get_object (db::Path &p)
+  {
+    db::Coord w = get_int32 ();
+    db::Coord bgn_ext = get_int32 ();
+    db::Coord end_ext = get_int32 ();
+    bool round = (get_byte () != 0);
+    get_points (m_points);
+    p = db::Path (m_points.begin (), m_points.end (), w, bgn_ext, end_ext, round);
+  }
+
+  void get_object (db::Text &t)
+  {
+    std::string s = get_string ();
+    db::Trans tr;
+    get_trans (tr);
+    db::Coord size = get_int32 ();
+    db::Font font = db::Font (get_int32 ());
+    db::HAlign halign = db::HAlign (get_int32 ());
+    db::VAlign valign = db::VAlign (get_int32 ());
+    t = db::Text (s, tr, size, font, halign, valign);
+  }
+
+  /**
+   *  @brief Reads an object held in the shape repository (see CacheWriter::put_shared_object)
+   */
+  template <class Obj>
+  const Obj *get_shared_object ()
+  {
+    std::vector<const void *> &objects = m_shared_objects;
+
+    uint64_t id = get_uint64 ();
+    if (id < objects.size ()) {
+      return (const Obj *) objects [id];
+    } else if (id > objects.size ()) {
+      throw tl::Exception (tl::to_string (QObject::tr ("Invalid object reference in layout cache file")));
+    }
+
+    Obj obj;
+    get_object (obj);
+    const Obj *ptr = mp_layout->shape_repository ().repository (typename Obj::tag ()).insert (obj);
+    objects.push_back ((const void *) ptr);
+    return ptr;
+  }
+
+  /**
+   *  @brief Reads the transformation and array delegate of an array
+   *
+   *  The delegate is placed in the layout's array repository if "shared" is true.
+   */
+  template <class Obj, class Trans>
+  db::array<Obj, Trans> get_array (const Obj &obj, bool shared)
+  {
+    typedef db::array<Obj, Trans> array_type;
+
+    unsigned char kind = get_byte ();
+    bool complex = (kind & 4) != 0;
+    kind &= 3;
+
+    Trans tr;
+    get_trans (tr);
+
+    double acos = 1.0, mag = 1.0;
+    if (complex) {
+      acos = get_double ();
+      mag = get_double ();
+    }
+
+    db::basic_array<db::Coord> *base = 0;
+
+    if (kind == 1) {
+
+      db::Vector va = get_vector ();
+      db::Vector vb = get_vector ();
+      unsigned long na = (unsigned long) get_uint64 ();
+      unsigned long nb = (unsigned long) get_uint64 ();
+
+      if (complex) {
+        base = new db::regular_complex_array<db::Coord> (acos, mag, va, vb, na, nb);
+      } else {
+        base = new db::regular_array<db::Coord> (va, vb, na, nb);
+      }
+
+    } else if (kind == 2) {
+
+      size_t n = size_t (get_uint64 ());
+      std::vector<db::Vector> pts;
+      pts.reserve (n);
+      for (size_t i = 0; i < n; ++i) {
+        pts.push_back (get_vector ());
+      }
+
+      if (complex) {
+        db::iterated_complex_array<db::Coord> *iter_array = new db::iterated_complex_array<db::Coord> (acos, mag, pts.begin (), pts.end ());
+        iter_array->sort ();
+        base = iter_array;
+      } else {
+        db::iterated_array<db::Coord> *iter_array = new db::iterated_array<db::Coord> (pts.begin (), pts.end ());
+        iter_array->sort ();
+        base = iter_array;
+      }
+
+    } else if (complex) {
+      base = new db::single_complex_inst<db::Coord> (acos, mag);
+    }
+
+    if (base && shared) {
+      db::basic_array<db::Coord> *rep_base = mp_layout->array_repository ().insert (*base);
+      delete base;
+      base = rep_base;
+    }
+
+    return array_type (obj, tr, base);
+  }
+
+private:
+  tl::InputStream &m_stream;
+  db::Layout *mp_layout;
+  std::vector<db::Point> m_points;
+  std::vector<const void *> m_shared_objects;
+};
+
+}
+
+// ---------------------------------------------------------------
+//  Utilities
+
+static std::string
+options_key (const std::string &format, const db::LoadLayoutOptions &options)
+{
+  std::string key;
+
+  const db::CommonReaderOptions &common_options = options.get_options<db::CommonReaderOptions> ();
+
+  key += "create_other_layers=" + tl::to_string (common_options.create_other_layers);
+  key += ",enable_text_objects=" + tl::to_string (common_options.enable_text_objects);
+  key += ",enable_properties=" + tl::to_string (common_options.enable_properties);
+
+  std::vector<unsigned int> layers = common_options.layer_map.get_layers ();
+  for (std::vector<unsigned int>::const_iterator l = layers.begin (); l != layers.end (); ++l) {
+    key += ",layer" + tl::to_string (*l) + "=" + tl::to_quoted_string (common_options.layer_map.mapping_str (*l));
+  }
+
+  if (format == "GDS2") {
+    const db::GDS2ReaderOptions &gds2_options = options.get_options<db::GDS2ReaderOptions> ();
+    key += ",box_mode=" + tl::to_string (gds2_options.box_mode);
+    key += ",allow_big_records=" + tl::to_string (gds2_options.allow_big_records);
+    key += ",allow_multi_xy_records=" + tl::to_string (gds2_options.allow_multi_xy_records);
+  } else if (format == "OASIS") {
+    //  NOTE: the number of threads does not change the result
+    const db::OASISReaderOptions &oasis_options = options.get_options<db::OASISReaderOptions> ();
+    key += ",read_all_properties=" + tl::to_string (oasis_options.read_all_properties);
+    key += ",expect_strict_mode=" + tl::to_string (oasis_options.expect_strict_mode);
+  }
+
+  return key;
+}
+
+static long
+current_process_id ()
+{
+#if defined(_WIN32)
+  return long (_getpid ());
+#else
+  return long (getpid ());
+#endif
+}
+
+static std::string
+hash_string (const std::string &s)
+{
+  //  FNV-1a - the cache file name only needs to be well distributed. The stamp
+  //  inside the file makes the final decision.
+  uint64_t h = 14695981039346656037ULL;
+  for (std::string::const_iterator c = s.begin (); c != s.end (); ++c) {
+    h ^= (unsigned char) *c;
+    h *= 1099511628211ULL;
+  }
+
+  std::string r;
+  for (unsigned int i = 0; i < 16; ++i) {
+    r += "0123456789abcdef" [(h >> (60 - i * 4)) & 0xf];
+  }
+  return r;
+}
+
+// ---------------------------------------------------------------
+//  LayoutCache implementation
+
+LayoutCache::LayoutCache (const tl::InputStream &stream, const std::string &format, const db::LoadLayoutOptions &options, bool editable)
+{
+  m_directory = options.get_options<db::CommonReaderOptions> ().layout_cache_dir;
+  if (m_directory.empty ()) {
+    return;
+  }
+
+  //  GDS2 and OASIS readers only depend on the options we know about
+  if (format != "GDS2" && format != "OASIS") {
+    return;
+  }
+
+  //  lazy loading keeps a reference to the file, hence there is nothing to cache
+  if (options.get_options<db::CommonReaderOptions> ().lazy_loading) {
+    return;
+  }
+
+  std::string path = stream.absolute_path ();
+  if (path.empty ()) {
+    return;
+  }
+
+  QFileInfo fi (tl::to_qstring (path));
+  if (! fi.exists () || ! fi.isFile ()) {
+    return;
+  }
+
+  std::string key = format;
+  key += "\n";
+  key += editable ? "editable" : "viewer";
+  key += "\n";
+  key += options_key (format, options);
+
+  m_stamp = path;
+  m_stamp += "\n";
+  m_stamp += tl::to_string (fi.size ());
+  m_stamp += "\n";
+  m_stamp += tl::to_string (fi.lastModified ().toMSecsSinceEpoch ());
+  m_stamp += "\n";
+  m_stamp += key;
+
+  //  NOTE: the modification time is not part of the file name, so a new version
+  //  of the source file replaces the cache entry
+  m_cache_file = tl::to_string (QDir (tl::to_qstring (m_directory)).filePath (tl::to_qstring (hash_string (path + "\n" + key) + ".klc")));
+}
+
+bool
+LayoutCache::fetch (db::Layout &layout, db::LayerMap &layer_map) const
+{
+  if (! is_valid () || ! QFileInfo (tl::to_qstring (m_cache_file)).exists ()) {
+    return false;
+  }
+
+  try {
+
+    tl::InputStream stream (m_cache_file);
+    if (read (stream, layout, layer_map, m_stamp)) {
+      ++s_hits;
+      if (tl::verbosity () >= 20) {
+        tl::info << "Layout taken from cache: " << m_cache_file;
+      }
+      return true;
+    }
+
+    return false;
+
+  } catch (tl::Exception &ex) {
+    tl::warn << tl::to_string (QObject::tr ("Unable to read layout cache file ")) << m_cache_file << ": " << ex.msg ();
+  } catch (std::exception &ex) {
+    tl::warn << tl::to_string (QObject::tr ("Unable to read layout cache file ")) << m_cache_file << ": " << ex.what ();
+  } catch (...) {
+    tl::warn << tl::to_string (QObject::tr ("Unable to read layout cache file ")) << m_cache_file;
+  }
+
+  //  a failed attempt must not leave a partial layout behind
+  layout.clear ();
+  layer_map = db::LayerMap ();
+
+  return false;
+}
+
+void
+LayoutCache::store (const db::Layout &layout, const db::LayerMap &layer_map) const
+{
+  if (! is_valid () || ! can_cache (layout)) {
+    return;
+  }
+
+  //  write to a temporary file first, so readers never see a partial file. The name of
+  //  the temporary file is unique, so concurrent writers do not interfere.
+  std::string tmp_file = m_cache_file + "." + tl::to_string (current_process_id ()) + "." + tl::to_string (size_t (this)) + ".tmp";
+
+  try {
+
+    if (! QDir ().mkpath (tl::to_qstring (m_directory))) {
+      throw tl::Exception (tl::to_string (QObject::tr ("Unable to create cache directory ")) + m_directory);
+    }
+
+    {
+      tl::OutputStream stream (tmp_file, tl::OutputStream::OM_Plain);
+      write (stream, layout, layer_map, m_stamp);
+    }
+
+    QFile::remove (tl::to_qstring (m_cache_file));
+    if (! QFile::rename (tl::to_qstring (tmp_file), tl::to_qstring (m_cache_file))) {
+      throw tl::Exception (tl::to_string (QObject::tr ("Unable to rename temporary file")));
+    }
+
+  } catch (tl::Exception &ex) {
+    tl::warn << tl::to_string (QObject::tr ("Unable to write layout cache file ")) << m_cache_file << ": " << ex.msg ();
+    QFile::remove (tl::to_qstring (tmp_file));
+  } catch (std::exception &ex) {
+    tl::warn << tl::to_string (QObject::tr ("Unable to write layout cache file ")) << m_cache_file << ": " << ex.what ();
+    QFile::remove (tl::to_qstring (tmp_file));
+  } catch (...) {
+    tl::warn << tl::to_string (QObject::tr ("Unable to write layout cache file ")) << m_cache_file;
+    QFile::remove (tl::to_qstring (tmp_file));
+  }
+}
+
+size_t
+LayoutCache::hits ()
+{
+  return s_hits;
+}
+
+bool
+LayoutCache::can_cache (const db::Layout &layout)
+{
+  for (db::Layout::const_iterator c = layout.begin (); c != layout.end (); ++c) {
+    if (c->is_proxy ()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <class Ref>
+static void
+write_shape_ref (CacheWriter &writer, const Ref *ref)
+{
+  writer.put_shared_object (ref->obj ());
+  writer.put_trans (ref->trans ());
+}
+
+template <class Array>
+static void
+write_shape_ptr_array (CacheWriter &writer, const Array *a)
+{
+  writer.put_shared_object (a->object ().obj ());
+  writer.put_array_base (*a);
+}
+
+template <class Array>
+static void
+write_shape_array (CacheWriter &writer, const Array *a)
+{
+  writer.put_object (a->object ());
+  writer.put_array_base (*a);
+}
+
+static void
+write_shapes (CacheWriter &writer, const db::Shapes &shapes)
+{
+  for (db::ShapeIterator s = shapes.begin (db::ShapeIterator::All); ! s.at_end (); ) {
+
+    bool array = s.in_array ();
+    db::Shape::object_type t = s->type ();
+    if (array) {
+      //  the array member types follow the array types
+      t = db::Shape::object_type (int (t) - 1);
+    }
+
+    writer.put_byte ((unsigned char) t | (s->has_prop_id () ? tag_with_properties : 0));
+    if (s->has_prop_id ()) {
+      writer.put_uint64 (s->prop_id ());
+    }
+
+    switch (t) {
+    case db::Shape::Polygon:
+      writer.put_object (*s->basic_ptr (db::Shape::polygon_type::tag ()));
+      break;
+    case db::Shape::PolygonRef:
+      write_shape_ref (writer, s->basic_ptr (db::Shape::polygon_ref_type::tag ()));
+      break;
+    case db::Shape::PolygonPtrArray:
+      write_shape_ptr_array (writer, s->basic_ptr (db::Shape::polygon_ptr_array_type::tag ()));
+      break;
+    case db::Shape::SimplePolygon:
+      writer.put_object (*s->basic_ptr (db::Shape::simple_polygon_type::tag ()));
+      break;
+    case db::Shape::SimplePolygonRef:
+      write_shape_ref (writer, s->basic_ptr (db::Shape::simple_polygon_ref_type::tag ()));
+      break;
+    case db::Shape::SimplePolygonPtrArray:
+      write_shape_ptr_array (writer, s->basic_ptr (db::Shape::simple_polygon_ptr_array_type::tag ()));
+      break;
+    case db::Shape::Edge:
+      writer.put_object (*s->basic_ptr (db::Shape::edge_type::tag ()));
+      break;
+    case db::Shape::Path:
+      writer.put_object (*s->basic_ptr (db::Shape::path_type::tag ()));
+      break;
+    case db::Shape::PathRef:
+      write_shape_ref (writer, s->basic_ptr (db::Shape::path_ref_type::tag ()));
+      break;
+    case db::Shape::PathPtrArray:
+      write_shape_ptr_array (writer, s->basic_ptr (db::Shape::path_ptr_array_type::tag ()));
+      break;
+    case db::Shape::Box:
+      writer.put_object (*s->basic_ptr (db::Shape::box_type::tag ()));
+      break;
+    case db::Shape::BoxArray:
+      write_shape_array (writer, s->basic_ptr (db::Shape::box_array_type::tag ()));
+      break;
+    case db::Shape::ShortBox:
+      writer.put_object (*s->basic_ptr (db::Shape::short_box_type::tag ()));
+      break;
+    case db::Shape::ShortBoxArray:
+      write_shape_array (writer, s->basic_ptr (db::Shape::short_box_array_type::tag ()));
+      break;
+    case db::Shape::Text:
+      writer.put_object (*s->basic_ptr (db::Shape::text_type::tag ()));
+      break;
+    case db::Shape::TextRef:
+      write_shape_ref (writer, s->basic_ptr (db::Shape::text_ref_type::tag ()));
+      break;
+    case db::Shape::TextPtrArray:
+      write_shape_ptr_array (writer, s->basic_ptr (db::Shape::text_ptr_array_type::tag ()));
+      break;
+    default:
+      throw tl::Exception (tl::to_string (QObject::tr ("Shape type cannot be stored in the layout cache")));
+    }
+
+    if (array) {
+      s.finish_array ();
+    } else {
+      ++s;
+    }
+
+  }
+
+  writer.put_byte (tag_end);
+}
+
+void
+LayoutCache::write (tl::OutputStream &stream, const db::Layout &layout, const db::LayerMap &layer_map, const std::string &stamp)
+{
+  CacheWriter writer (stream);
+
+  writer.put_bytes (cache_magic, cache_magic_size);
+  writer.put_uint32 (cache_version);
+  writer.put_string (stamp);
+
+  writer.put_double (layout.dbu ());
+
+  //  properties
+  const db::PropertiesRepository &prep = layout.properties_repository ();
+  for (db::PropertiesRepository::iterator p = prep.begin (); p != prep.end (); ++p) {
+    writer.put_byte (1);
+    writer.put_uint64 (p->first);
+    writer.put_uint64 (p->second.size ());
+    for (db::PropertiesRepository::properties_set::const_iterator pp = p->second.begin (); pp != p->second.end (); ++pp) {
+      writer.put_variant (prep.prop_name (pp->first));
+      writer.put_variant (pp->second);
+    }
+  }
+  writer.put_byte (tag_end);
+
+  writer.put_uint64 (layout.prop_id ());
+
+  //  layers
+  for (db::Layout::layer_iterator l = layout.begin_layers (); l != layout.end_layers (); ++l) {
+    writer.put_byte (1);
+    writer.put_uint32 ((*l).first);
+    writer.put_string ((*l).second->name);
+    writer.put_int32 ((*l).second->layer);
+    writer.put_int32 ((*l).second->datatype);
+  }
+  writer.put_byte (tag_end);
+
+  //  cells
+  for (db::Layout::const_iterator c = layout.begin (); c != layout.end (); ++c) {
+    writer.put_byte (1);
+    writer.put_uint32 (c->cell_index ());
+    writer.put_string (layout.cell_name (c->cell_index ()));
+    writer.put_byte (c->is_ghost_cell () ? 1 : 0);
+    writer.put_uint64 (c->prop_id ());
+  }
+  writer.put_byte (tag_end);
+
+  //  cell contents
+  for (db::Layout::const_iterator c = layout.begin (); c != layout.end (); ++c) {
+
+    for (db::Cell::const_iterator i = c->begin (); ! i.at_end (); ++i) {
+      writer.put_byte (i->has_prop_id () ? tag_with_properties : 1);
+      if (i->has_prop_id ()) {
+        writer.put_uint64 (i->prop_id ());
+      }
+      const db::CellInstArray &inst = i->cell_inst ();
+      writer.put_uint32 (inst.object ().cell_index ());
+      writer.put_array_base (inst);
+    }
+    writer.put_byte (tag_end);
+
+    for (db::Layout::layer_iterator l = layout.begin_layers (); l != layout.end_layers (); ++l) {
+      const db::Shapes &shapes = c->shapes ((*l).first);
+      if (! shapes.empty ()) {
+        writer.put_byte (1);
+        writer.put_uint32 ((*l).first);
+        write_shapes (writer, shapes);
+      }
+    }
+    writer.put_byte (tag_end);
+
+  }
+
+  //  layer map
+  std::vector<unsigned int> lm_layers = layer_map.get_layers ();
+  for (std::vector<unsigned int>::const_iterator l = lm_layers.begin (); l != lm_layers.end (); ++l) {
+    writer.put_byte (1);
+    writer.put_uint32 (*l);
+    writer.put_string (layer_map.mapping_str (*l));
+  }
+  writer.put_byte (tag_end);
+
+  writer.put_bytes (cache_magic, cache_magic_size);
+}
+
+template <class Sh>
+static void
+insert_shape (db::Shapes &shapes, const Sh &sh, bool with_props, db::properties_id_type prop_id)
+{
+  if (with_props) {
+    shapes.insert (db::object_with_properties<Sh> (sh, prop_id));
+  } else {
+    shapes.insert (sh);
+  }
+}
+
+template <class Sh>
+static void
+read_shape (CacheReader &reader, db::Shapes &shapes, bool with_props, db::properties_id_type prop_id)
+{
+  Sh sh;
+  reader.get_object (sh);
+  insert_shape (shapes, sh, with_props, prop_id);
+}
+
+template <class Ref>
+static void
+read_shape_ref (CacheReader &reader, db::Shapes &shapes, bool with_props, db::properties_id_type prop_id)
+{
+  const typename Ref::shape_type *ptr = reader.get_shared_object<typename Ref::shape_type> ();
+  typename Ref::trans_type tr;
+  reader.get_trans (tr);
+  insert_shape (shapes, Ref (ptr, tr), with_props, prop_id);
+}
+
+template <class Array>
+static void
+read_shape_ptr_array (CacheReader &reader, db::Shapes &shapes, bool with_props, db::properties_id_type prop_id)
+{
+  typedef typename Array::object_type ptr_type;
+  const typename ptr_type::shape_type *ptr = reader.get_shared_object<typename ptr_type::shape_type> ();
+  Array a (reader.get_array<ptr_type, typename Array::trans_type> (ptr_type (ptr, db::UnitTrans ()), true));
+  insert_shape (shapes, a, with_props, prop_id);
+}
+
+template <class Array>
+static void
+read_shape_array (CacheReader &reader, db::Shapes &shapes, bool with_props, db::properties_id_type prop_id)
+{
+  typename Array::object_type obj;
+  reader.get_object (obj);
+  Array a (reader.get_array<typename Array::object_type, typename Array::trans_type> (obj, true));
+  insert_shape (shapes, a, with_props, prop_id);
+}
+
+static db::properties_id_type
+map_prop_id (const std::map<db::properties_id_type, db::properties_id_type> &prop_id_map, db::properties_id_type id)
+{
+  std::map<db::properties_id_type, db::properties_id_type>::const_iterator pm = prop_id_map.find (id);
+  if (pm == prop_id_map.end ()) {
+    throw tl::Exception (tl::to_string (QObject::tr ("Invalid properties ID in layout cache file")));
+  }
+  return pm->second;
+}
+
+static void
+read_shapes (CacheReader &reader, db::Shapes &shapes, const std::map<db::properties_id_type, db::properties_id_type> &prop_id_map)
+{
+  unsigned char tag;
+  while ((tag = reader.get_byte ()) != tag_end) {
+
+    bool with_props = (tag & tag_with_properties) != 0;
+    db::properties_id_type prop_id = 0;
+    if (with_props) {
+      prop_id = map_prop_id (prop_id_map, reader.get_uint64 ());
+    }
+
+    switch (db::Shape::object_type (tag & ~tag_with_properties)) {
+    case db::Shape::Polygon:
+      read_shape<db::Shape::polygon_type> (reader, shapes, with_props, prop_id);
+      break;
+    case db::Shape::PolygonRef:
+      read_shape_ref<db::Shape::polygon_ref_type> (reader, shapes, with_props, prop_id);
+      break;
+    case db::Shape::PolygonPtrArray:
+      read_shape_ptr_array<db::Shape::polygon_ptr_array_type> (reader, shapes, with_props, prop_id);
+      break;
+    case db::Shape::SimplePolygon:
+      read_shape<db::Shape::simple_polygon_type> (reader, shapes, with_props, prop_id);
+      break;
+    case db::Shape::SimplePolygonRef:
+      read_shape_ref<db::Shape::simple_polygon_ref_type> (reader, shapes, with_props, prop_id);
+      break;
+    case db::Shape::SimplePolygonPtrArray:
+      read_shape_ptr_array<db::Shape::simple_polygon_ptr_array_type> (reader, shapes, with_props, prop_id);
+      break;
+    case db::Shape::Edge:
+      read_shape<db::Shape::edge_type> (reader, shapes, with_props, prop_id);
+      break;
+    case db::Shape::Path:
+      read_shape<db::Shape::path_type> (reader, shapes, with_props, prop_id);
+      break;
+    case db::Shape::PathRef:
+      read_shape_ref<db::Shape::path_ref_type> (reader, shapes, with_props, prop_id);
+      break;
+    case db::Shape::PathPtrArray:
+      read_shape_ptr_array<db::Shape::path_ptr_array_type> (reader, shapes, with_props, prop_id);
+      break;
+    case db::Shape::Box:
+      read_shape<db::Shape::box_type> (reader, shapes, with_props, prop_id);
+      break;
+    case db::Shape::BoxArray:
+      read_shape_array<db::Shape::box_array_type> (reader, shapes, with_props, prop_id);
+      break;
+    case db::Shape::ShortBox:
+      read_shape<db::Shape::short_box_type> (reader, shapes, with_props, prop_id);
+      break;
+    case db::Shape::ShortBoxArray:
+      read_shape_array<db::Shape::short_box_array_type> (reader, shapes, with_props, prop_id);
+      break;
+    case db::Shape::Text:
+      read_shape<db::Shape::text_type> (reader, shapes, with_props, prop_id);
+      break;
+    case db::Shape::TextRef:
+      read_shape_ref<db::Shape::text_ref_type> (reader, shapes, with_props, prop_id);
+      break;
+    case db::Shape::TextPtrArray:
+      read_shape_ptr_array<db::Shape::text_ptr_array_type> (reader, shapes, with_props, prop_id);
+      break;
+    default:
+      throw tl::Exception (tl::to_string (QObject::tr ("Invalid shape type in layout cache file")));
+    }
+
+  }
+}
+
+static void
+read_layout (CacheReader &reader, db::Layout &layout, db::LayerMap &layer_map)
+{
+  layout.dbu (reader.get_double ());
+
+  //  properties
+  std::map<db::properties_id_type, db::properties_id_type> prop_id_map;
+  prop_id_map.insert (std::make_pair (db::properties_id_type (0), db::properties_id_type (0)));
+
+  db::PropertiesRepository &prep = layout.properties_repository ();
+  while (reader.get_byte () != tag_end) {
+    db::properties_id_type id = reader.get_uint64 ();
+    size_t n = size_t (reader.get_uint64 ());
+    db::PropertiesRepository::properties_set props;
+    for (size_t i = 0; i < n; ++i) {
+      db::property_names_id_type name_id = prep.prop_name_id (reader.get_variant ());
+      props.insert (std::make_pair (name_id, reader.get_variant ()));
+    }
+    prop_id_map [id] = prep.properties_id (props);
+  }
+
+  layout.prop_id (map_prop_id (prop_id_map, reader.get_uint64 ()));
+
+  //  layers
+  std::set<unsigned int> layers;
+  while (reader.get_byte () != tag_end) {
+    unsigned int index = reader.get_uint32 ();
+    db::LayerProperties lp;
+    lp.name = reader.get_string ();
+    lp.layer = reader.get_int32 ();
+    lp.datatype = reader.get_int32 ();
+    if (! layers.insert (index).second) {
+      throw tl::Exception (tl::to_string (QObject::tr ("Duplicate layer in layout cache file")));
+    }
+    layout.insert_layer (index, lp);
+  }
+
+  //  cells
+  std::vector<db::cell_index_type> cells;
+  std::map<db::cell_index_type, db::cell_index_type> cell_index_map;
+  while (reader.get_byte () != tag_end) {
+    db::cell_index_type ci = reader.get_uint32 ();
+    std::string name = reader.get_string ();
+    db::cell_index_type new_ci = layout.add_cell (name.c_str ());
+    db::Cell &cell = layout.cell (new_ci);
+    cell.set_ghost_cell (reader.get_byte () != 0);
+    cell.prop_id (map_prop_id (prop_id_map, reader.get_uint64 ()));
+    cell_index_map [ci] = new_ci;
+    cells.push_back (new_ci);
+  }
+
+  //  cell contents
+  std::vector<db::CellInstArray> instances;
+  std::vector<db::CellInstArrayWithProperties> instances_with_props;
+
+  for (std::vector<db::cell_index_type>::const_iterator c = cells.begin (); c != cells.end (); ++c) {
+
+    db::Cell &cell = layout.cell (*c);
+
+    instances.clear ();
+    instances_with_props.clear ();
+
+    unsigned char tag;
+    while ((tag = reader.get_byte ()) != tag_end) {
+
+      db::properties_id_type prop_id = 0;
+      if (tag == tag_with_properties) {
+        prop_id = map_prop_id (prop_id_map, reader.get_uint64 ());
+      }
+
+      std::map<db::cell_index_type, db::cell_index_type>::const_iterator cm = cell_index_map.find (reader.get_uint32 ());
+      if (cm == cell_index_map.end ()) {
+        throw tl::Exception (tl::to_string (QObject::tr ("Invalid cell reference in layout cache file")));
+      }
+
+      db::CellInstArray inst (reader.get_array<db::CellInst, db::Trans> (db::CellInst (cm->second), false));
+      if (tag == tag_with_properties) {
+        instances_with_props.push_back (db::CellInstArrayWithProperties (inst, prop_id));
+      } else {
+        instances.push_back (inst);
+      }
+
+    }
+
+    cell.insert (instances.begin (), instances.end ());
+    cell.insert (instances_with_props.begin (), instances_with_props.end ());
+
+    while (reader.get_byte () != tag_end) {
+      unsigned int l = reader.get_uint32 ();
+      if (layers.find (l) == layers.end ()) {
+        throw tl::Exception (tl::to_string (QObject::tr ("Invalid layer in layout cache file")));
+      }
+      read_shapes (reader, cell.shapes (l), prop_id_map);
+    }
+
+  }
+
+  //  layer map
+  layer_map = db::LayerMap ();
+  while (reader.get_byte () != tag_end) {
+    unsigned int l = reader.get_uint32 ();
+    layer_map.map_expr (reader.get_string (), l);
+  }
+
+  if (memcmp (reader.get_bytes (cache_magic_size), cache_magic, cache_magic_size) != 0) {
+    throw tl::Exception (tl::to_string (QObject::tr ("Layout cache file is corrupt")));
+  }
+}
+
+bool
+LayoutCache::read (tl::InputStream &stream, db::Layout &layout, db::LayerMap &layer_map, const std::string &stamp)
+{
+  CacheReader reader (stream, layout);
+
+  const char *magic = stream.get (cache_magic_size);
+  if (! magic || memcmp (magic, cache_magic, cache_magic_size) != 0) {
+    return false;
+  }
+  if (reader.get_uint32 () != cache_version) {
+    return false;
+  }
+  if (reader.get_string () != stamp) {
+    return false;
+  }
+
+  layout.start_changes ();
+  try {
+    read_layout (reader, layout, layer_map);
+    layout.end_changes ();
+  } catch (...) {
+    layout.end_changes ();
+    throw;
+  }
+
+  return true;
+}
+
+}
+
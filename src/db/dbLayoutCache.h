@@ -0,0 +1,171 @@
+
+/*
+
+  KLayout Layout Viewer
+  Copyright (C) 2006-2017 Matthias Koefferlein
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+
+#ifndef HDR_dbLayoutCache
+#define HDR_dbLayoutCache
+
+#include "dbCommon.h"
+
+#include <string>
+
+namespace tl
+{
+  class InputStream;
+  class OutputStream;
+}
+
+namespace db
+{
+
+class Layout;
+class LayerMap;
+class LoadLayoutOptions;
+
+/**
+ *  @brief A persistent cache for layouts read from files
+ *
+ *  The cache stores a layout after it has been read from a file in a compact binary
+ *  format in the cache directory. When the same file is read again with the same options,
+ *  the layout is taken from the cache instead of parsing the file again.
+ *
+ *  A cache entry is identified by the absolute path of the source file and the reader
+ *  options. It is valid as long as the file's size and modification time do not change.
+ *  A stale entry is replaced when the file is read again.
+ *
+ *  The cache is enabled by setting a cache directory in the reader options
+ *  (db::CommonReaderOptions::layout_cache_dir). The default directory is taken
+ *  from the KLAYOUT_LAYOUT_CACHE environment variable.
+ *
+ *  The cache is employed by db::Reader. Only GDS2 and OASIS files are cached, and
+ *  only if they are read into an empty layout. Layouts with library or PCell proxies
+ *  are not cached.
+ *
+ *  Usage:
+ *
+ *  @code
+ *  db::LayoutCache cache (stream, format, options, layout.is_editable ());
+ *  if (cache.is_valid () && cache.fetch (layout, layer_map)) {
+ *    //  layout and layer_map are read from the cache
+ *  } else {
+ *    //  read the layout, then:
+ *    cache.store (layout, layer_map);
+ *  }
+ *  @endcode
+ */
+class DB_PUBLIC LayoutCache
+{
+public:
+  /**
+   *  @brief Creates a cache accessor for the given stream
+   *
+   *  @param stream The stream from which the layout is read
+   *  @param format The format name as delivered by the reader
+   *  @param options The options with which the layout is read
+   *  @param editable The editable mode of the target layout
+   *
+   *  If the stream, format or options do not allow caching or the cache is disabled,
+   *  "is_valid" will return false.
+   */
+  LayoutCache (const tl::InputStream &stream, const std::string &format, const db::LoadLayoutOptions &options, bool editable);
+
+  /**
+   *  @brief Returns true, if the layout can be cached
+   */
+  bool is_valid () const
+  {
+    return ! m_cache_file.empty ();
+  }
+
+  /**
+   *  @brief Gets the path of the cache file
+   */
+  const std::string &cache_file () const
+  {
+    return m_cache_file;
+  }
+
+  /**
+   *  @brief Reads the layout from the cache
+   *
+   *  @return True, if the layout was taken from the cache
+   *
+   *  The layout must be empty. If the cache entry is missing, stale or corrupt, this method
+   *  returns false and leaves the layout empty.
+   */
+  bool fetch (db::Layout &layout, db::LayerMap &layer_map) const;
+
+  /**
+   *  @brief Stores the layout in the cache
+   *
+   *  Errors are reported as warnings. A layout which cannot be cached is silently skipped.
+   */
+  void store (const db::Layout &layout, const db::LayerMap &layer_map) const;
+
+  /**
+   *  @brief Gets the cache directory
+   *
+   *  The directory is taken from the reader options (see db::CommonReaderOptions::layout_cache_dir).
+   */
+  const std::string &directory () const
+  {
+    return m_directory;
+  }
+
+  /**
+   *  @brief Gets the number of layouts taken from the cache so far
+   */
+  static size_t hits ();
+
+  /**
+   *  @brief Writes a layout to the given stream in the cache format
+   *
+   *  @param stamp A string that identifies the source of the layout
+   *
+   *  Throws an exception if the layout cannot be represented in the cache.
+   */
+  static void write (tl::OutputStream &stream, const db::Layout &layout, const db::LayerMap &layer_map, const std::string &stamp);
+
+  /**
+   *  @brief Reads a layout from a stream in the cache format
+   *
+   *  @return False, if the stream does not carry the given stamp or is not a cache stream
+   *
+   *  The layout must be empty. Throws an exception if the stream is corrupt.
+   */
+  static bool read (tl::InputStream &stream, db::Layout &layout, db::LayerMap &layer_map, const std::string &stamp);
+
+  /**
+   *  @brief Returns true, if the given layout can be stored in the cache
+   */
+  static bool can_cache (const db::Layout &layout);
+
+private:
+  std::string m_directory;
+  std::string m_cache_file;
+  std::string m_stamp;
+};
+
+}
+
+#endif
+
@@ -26,8 +26,13 @@
 #include "dbCellMapping.h"
 #include "dbFuzzyCellMapping.h"
 #include "dbLayoutUtils.h"
+#include "dbContentHash.h"
 #include "tlLog.h"
 #include "tlExceptions.h"
+#include "tlThreadedWorkers.h"
+
+#include <QMutex>
+#include <QThread>
 
 namespace db
 {
@@ -552,6 +557,23 @@ collect_boxes (const db::Layout &, const db::Cell *c, unsigned int layer, unsign
   }
 }
 
+static void
+normalize_text (db::Text &text, unsigned int flags)
+{
+  if (flags & layout_diff::f_no_text_details) {
+    text.font (db::NoFont);
+    text.halign (db::NoHAlign);
+    text.valign (db::NoVAlign);
+  }
+
+  if (flags & layout_diff::f_no_text_orientation) {
+    db::Text::trans_type tt (text.trans ());
+    tt = db::Text::trans_type (tt.disp ());
+    text.trans (tt);
+    text.size (0);
+  }
+}
+
 static void
 collect_texts (const db::Layout &, const db::Cell *c, unsigned int layer, unsigned int flags, std::vector< std::pair<db::Text, db::properties_id_type> > &shapes, PropertyMapper &pn)
 {
@@ -570,18 +592,7 @@ collect_texts (const db::Layout &, const db::Cell *c, unsigned int layer, unsign
     //  layouts.
     shapes.back ().first.string (shapes.back ().first.string ());
 
-    if (flags & layout_diff::f_no_text_details) {
-      shapes.back ().first.font (db::NoFont);
-      shapes.back ().first.halign (db::NoHAlign);
-      shapes.back ().first.valign (db::NoVAlign);
-    }
-
-    if (flags & layout_diff::f_no_text_orientation) {
-      db::Text::trans_type tt (shapes.back ().first.trans ());
-      tt = db::Text::trans_type (tt.disp ());
-      shapes.back ().first.trans (tt);
-      shapes.back ().first.size (0);
-    }
+    normalize_text (shapes.back ().first, flags);
 
   }
 }
@@ -601,6 +612,427 @@ collect_paths (const db::Layout &, const db::Cell *c, unsigned int layer, unsign
   }
 }
 
+// -------------------------------------------------------------------------------
+//  Content hashes
+//
+//  Before the cells are compared in detail, a content hash is computed for the
+//  instances and for each layer of each cell. The hashes are order-independent
+//  and use the same normalization as the compare. If the hashes of both sides
+//  are equal, the detailed compare is skipped.
+//
+//  The hashes only need to include everything the compare looks at: if they
+//  are more specific, equal content may produce different hashes which just
+//  means the detailed compare is done.
+
+typedef std::map<db::properties_id_type, uint64_t> property_hash_map;
+
+/**
+ *  @brief Adds a property name or value to a hash
+ *
+ *  The type is included, so the string "1" and the number 1 produce different hashes.
+ *  Floating-point values are hashed exactly rather than through their string
+ *  representation which is not precise.
+ */
+static void
+add_variant (ContentHash &h, const tl::Variant &v)
+{
+  h.add (uint64_t (v.type_code ()));
+
+  if (v.is_double ()) {
+    h.add (v.to_double ());
+  } else if (v.is_list ()) {
+    h.add (uint64_t (v.get_list ().size ()));
+    for (tl::Variant::const_iterator i = v.begin (); i != v.end (); ++i) {
+      add_variant (h, *i);
+    }
+  } else if (v.is_array ()) {
+    h.add (uint64_t (v.array_size ()));
+    for (tl::Variant::const_array_iterator i = v.begin_array (); i != v.end_array (); ++i) {
+      add_variant (h, i->first);
+      add_variant (h, i->second);
+    }
+  } else if (! v.is_nil ()) {
+    h.add (v.to_string ());
+  }
+}
+
+/**
+ *  @brief Computes the hashes of the property sets of a layout
+ *
+ *  The hashes are based on the names and values rather than the ids, so they
+ *  can be compared between layouts.
+ */
+static void
+collect_property_hashes (const db::Layout &l, property_hash_map &hashes)
+{
+  const db::PropertiesRepository &rep = l.properties_repository ();
+  for (db::PropertiesRepository::iterator p = rep.begin (); p != rep.end (); ++p) {
+    uint64_t h = 0;
+    for (db::PropertiesRepository::properties_set::const_iterator i = p->second.begin (); i != p->second.end (); ++i) {
+      ContentHash nv;
+      add_variant (nv, rep.prop_name (i->first));
+      add_variant (nv, i->second);
+      h += nv.value ();
+    }
+    hashes.insert (std::make_pair (p->first, h));
+  }
+}
+
+static uint64_t
+property_hash (db::properties_id_type prop_id, unsigned int flags, const property_hash_map &hashes)
+{
+  if (prop_id == 0 || (flags & layout_diff::f_no_properties) != 0) {
+    return 0;
+  }
+  property_hash_map::const_iterator h = hashes.find (prop_id);
+  return h != hashes.end () ? h->second : 0;
+}
+
+/**
+ *  @brief Computes the hash of the instances of a cell
+ *
+ *  This function follows the normalization of collect_insts. Instances of cells
+ *  which are not common cells are not hashed - "unmapped" is set to true if
+ *  such instances are present.
+ */
+static uint64_t
+hash_insts (const db::Cell *cell, unsigned int flags, const std::map <db::cell_index_type, db::cell_index_type> &cci, const property_hash_map &prop_hashes, bool &unmapped)
+{
+  uint64_t h = 0;
+  unmapped = false;
+
+  for (db::Cell::const_iterator i = cell->begin (); !i.at_end (); ++i) {
+
+    std::map <db::cell_index_type, db::cell_index_type>::const_iterator ccii = cci.find (i->cell_index ());
+    if (ccii == cci.end ()) {
+      unmapped = true;
+      continue;
+    }
+
+    uint64_t ph = property_hash (i->prop_id (), flags, prop_hashes);
+
+    db::Vector a, b;
+    unsigned long amax, bmax;
+    if ((flags & layout_diff::f_flatten_array_insts) == 0 && i->is_regular_array (a, b, amax, bmax) && (amax > 1 || bmax > 1)) {
+
+      if (amax == 1) {
+        a = db::Vector ();
+      }
+      if (bmax == 1) {
+        b = db::Vector ();
+      }
+      if (b < a) {
+        std::swap (a, b);
+        std::swap (amax, bmax);
+      }
+
+      ContentHash ih;
+      ih.add (uint64_t (ccii->second));
+      ih.add (i->complex_trans ());
+      ih.add (a);
+      ih.add (b);
+      ih.add (uint64_t (amax));
+      ih.add (uint64_t (bmax));
+      ih.add (ph);
+      h += ih.value ();
+
+    } else {
+      for (db::CellInstArray::iterator ai = i->begin (); ! ai.at_end (); ++ai) {
+        ContentHash ih;
+        ih.add (uint64_t (ccii->second));
+        ih.add (i->complex_trans (*ai));
+        ih.add (ph);
+        h += ih.value ();
+      }
+    }
+
+  }
+
+  return h;
+}
+
+/**
+ *  @brief Computes the hash of the shapes of a cell on one layer
+ *
+ *  This function follows the normalization of the collect_... functions.
+ */
+static uint64_t
+hash_shapes (const db::Cell *c, unsigned int layer, unsigned int flags, const property_hash_map &prop_hashes)
+{
+  uint64_t h = 0;
+  const db::Shapes &shapes = c->shapes (layer);
+
+  for (db::ShapeIterator s = shapes.begin (db::ShapeIterator::Polygons | ((flags & db::layout_diff::f_paths_as_polygons) ? db::ShapeIterator::Paths : 0) | ((flags & db::layout_diff::f_boxes_as_polygons) ? db::ShapeIterator::Boxes : 0)); !s.at_end (); ++s) {
+    db::Polygon poly;
+    s->polygon (poly);
+    ContentHash sh;
+    sh.add (uint64_t (1));
+    sh.add (polygon_content_hash (poly));
+    sh.add (property_hash (s->prop_id (), flags, prop_hashes));
+    h += sh.value ();
+  }
+
+  if (! (flags & db::layout_diff::f_paths_as_polygons)) {
+    for (db::ShapeIterator s = shapes.begin (db::ShapeIterator::Paths); !s.at_end (); ++s) {
+      db::Path path;
+      s->path (path);
+      ContentHash sh;
+      sh.add (uint64_t (2));
+      sh.add (uint64_t (int64_t (path.width ())));
+      sh.add (uint64_t (int64_t (path.bgn_ext ())));
+      sh.add (uint64_t (int64_t (path.end_ext ())));
+      sh.add (uint64_t (path.round ()));
+      for (db::Path::iterator p = path.begin (); p != path.end (); ++p) {
+        sh.add (*p);
+      }
+      sh.add (property_hash (s->prop_id (), flags, prop_hashes));
+      h += sh.value ();
+    }
+  }
+
+  for (db::ShapeIterator s = shapes.begin (db::ShapeIterator::Texts); !s.at_end (); ++s) {
+    db::Text text;
+    s->text (text);
+    normalize_text (text, flags);
+    ContentHash sh;
+    sh.add (uint64_t (3));
+    sh.add (text.string ());
+    sh.add (uint64_t (text.trans ().rot ()));
+    sh.add (text.trans ().disp ());
+    sh.add (uint64_t (int64_t (text.size ())));
+    sh.add (property_hash (s->prop_id (), flags, prop_hashes));
+    h += sh.value ();
+  }
+
+  if (! (flags & db::layout_diff::f_boxes_as_polygons)) {
+    for (db::ShapeIterator s = shapes.begin (db::ShapeIterator::Boxes); !s.at_end (); ++s) {
+      db::Box box;
+      s->box (box);
+      ContentHash sh;
+      sh.add (uint64_t (4));
+      sh.add (box.p1 ());
+      sh.add (box.p2 ());
+      sh.add (property_hash (s->prop_id (), flags, prop_hashes));
+      h += sh.value ();
+    }
+  }
+
+  for (db::ShapeIterator s = shapes.begin (db::ShapeIterator::Edges); !s.at_end (); ++s) {
+    db::Edge edge;
+    s->edge (edge);
+    ContentHash sh;
+    sh.add (uint64_t (5));
+    sh.add (edge.p1 ());
+    sh.add (edge.p2 ());
+    sh.add (property_hash (s->prop_id (), flags, prop_hashes));
+    h += sh.value ();
+  }
+
+  return h;
+}
+
+/**
+ *  @brief The result of the hash compare for one pair of common cells
+ */
+struct CellHashCompare
+{
+  CellHashCompare ()
+    : insts_differ (true)
+  {
+    //  .. nothing yet ..
+  }
+
+  //  true, if the instances need to be compared in detail
+  bool insts_differ;
+  //  the indexes of the common layers which need to be compared in detail (sorted)
+  std::vector<unsigned int> layers_differ;
+};
+
+//  The number of cells hashed in one task
+const size_t cells_per_hash_task = 16;
+
+/**
+ *  @brief A job computing and comparing the content hashes of the common cells
+ */
+class CellHashJob
+  : public tl::JobBase
+{
+public:
+  typedef std::vector<std::pair<bool, unsigned int> > layer_index_list;
+
+  CellHashJob (int nworkers, 
+               const db::Layout &a, const std::vector<db::cell_index_type> &cells_a, const std::map <db::cell_index_type, db::cell_index_type> &cci_a, const layer_index_list &layers_a, 
+               const db::Layout &b, const std::vector<db::cell_index_type> &cells_b, const std::map <db::cell_index_type, db::cell_index_type> &cci_b, const layer_index_list &layers_b, 
+               unsigned int flags)
+    : tl::JobBase (nworkers), 
+      mp_a (&a), mp_cells_a (&cells_a), mp_cci_a (&cci_a), mp_layers_a (&layers_a), 
+      mp_b (&b), mp_cells_b (&cells_b), mp_cci_b (&cci_b), mp_layers_b (&layers_b), 
+      m_flags (flags), m_done (0)
+  {
+    //  .. nothing yet ..
+  }
+
+  /**
+   *  @brief Computes the hash compare results for all common cells
+   */
+  void run (std::vector<CellHashCompare> &results, tl::RelativeProgress *progress)
+  {
+    m_prop_hashes_a.clear ();
+    m_prop_hashes_b.clear ();
+    if (! (m_flags & layout_diff::f_no_properties)) {
+      collect_property_hashes (*mp_a, m_prop_hashes_a);
+      collect_property_hashes (*mp_b, m_prop_hashes_b);
+    }
+
+    results.clear ();
+    results.resize (mp_cells_a->size ());
+    mp_results = &results;
+
+    m_done = 0;
+    for (size_t i = 0; i < results.size (); i += cells_per_hash_task) {
+      schedule (new CellHashTask (i, std::min (results.size (), i + cells_per_hash_task)));
+    }
+
+    try {
+
+      start ();
+      while (is_running ()) {
+        //  This may throw an exception, if the cancel button has been pressed.
+        if (progress) {
+          progress->set (done ());
+        }
+        wait (100);
+      }
+
+    } catch (tl::BreakException &ex) {
+      terminate ();
+      throw ex;
+    } catch (tl::Exception &ex) {
+      terminate ();
+      throw ex;
+    }
+
+    if (has_error ()) {
+      throw tl::Exception (tl::to_string (QObject::tr ("Errors occured during processing. First error message says:\n")) + error_messages ().front ());
+    }
+  }
+
+  void process (size_t from, size_t to)
+  {
+    for (size_t cci = from; cci < to; ++cci) {
+
+      const db::Cell *cell_a = &mp_a->cell ((*mp_cells_a) [cci]);
+      const db::Cell *cell_b = &mp_b->cell ((*mp_cells_b) [cci]);
+
+      CellHashCompare &r = (*mp_results) [cci];
+
+      bool unmapped_a = false, unmapped_b = false;
+      uint64_t ih_a = hash_insts (cell_a, m_flags, *mp_cci_a, m_prop_hashes_a, unmapped_a);
+      uint64_t ih_b = hash_insts (cell_b, m_flags, *mp_cci_b, m_prop_hashes_b, unmapped_b);
+      r.insts_differ = (unmapped_a || unmapped_b || ih_a != ih_b);
+
+      for (unsigned int l = 0; l < (unsigned int) mp_layers_a->size (); ++l) {
+        uint64_t h_a = (*mp_layers_a) [l].first ? hash_shapes (cell_a, (*mp_layers_a) [l].second, m_flags, m_prop_hashes_a) : 0;
+        uint64_t h_b = (*mp_layers_b) [l].first ? hash_shapes (cell_b, (*mp_layers_b) [l].second, m_flags, m_prop_hashes_b) : 0;
+        if (h_a != h_b) {
+          r.layers_differ.push_back (l);
+        }
+      }
+
+    }
+
+    QMutexLocker locker (&m_mutex);
+    m_done += to - from;
+  }
+
+  size_t done ()
+  {
+    QMutexLocker locker (&m_mutex);
+    return m_done;
+  }
+
+  virtual tl::Worker *create_worker ();
+
+private:
+  class CellHashTask
+    : public tl::Task
+  {
+  public:
+    CellHashTask (size_t from, size_t to)
+      : m_from (from), m_to (to)
+    {
+      //  .. nothing yet ..
+    }
+
+    size_t from () const
+    {
+      return m_from;
+    }
+
+    size_t to () const
+    {
+      return m_to;
+    }
+
+  private:
+    size_t m_from, m_to;
+  };
+
+  friend class CellHashWorker;
+
+  const db::Layout *mp_a;
+  const std::vector<db::cell_index_type> *mp_cells_a;
+  const std::map <db::cell_index_type, db::cell_index_type> *mp_cci_a;
+  const layer_index_list *mp_layers_a;
+  const db::Layout *mp_b;
+  const std::vector<db::cell_index_type> *mp_cells_b;
+  const std::map <db::cell_index_type, db::cell_index_type> *mp_cci_b;
+  const layer_index_list *mp_layers_b;
+  unsigned int m_flags;
+  property_hash_map m_prop_hashes_a, m_prop_hashes_b;
+  std::vector<CellHashCompare> *mp_results;
+  size_t m_done;
+  QMutex m_mutex;
+};
+
+class CellHashWorker
+  : public tl::Worker
+{
+public:
+  CellHashWorker (CellHashJob *job)
+    : tl::Worker (), mp_job (job)
+  {
+    //  .. nothing yet ..
+  }
+
+  void perform_task (tl::Task *task)
+  {
+    CellHashJob::CellHashTask *hash_task = dynamic_cast<CellHashJob::CellHashTask *> (task);
+    if (hash_task) {
+      mp_job->process (hash_task->from (), hash_task->to ());
+    }
+  }
+
+private:
+  CellHashJob *mp_job;
+};
+
+tl::Worker *
+CellHashJob::create_worker ()
+{
+  return new CellHashWorker (this);
+}
+
+/**
+ *  @brief Gets the number of threads to use for the hash computation
+ */
+static int
+hash_threads ()
+{
+  int n = QThread::idealThreadCount ();
+  return n > 1 ? n : 0;
+}
+
 static bool
 do_compare_layouts (const db::Layout &a, const db::Cell *top_a, const db::Layout &b, const db::Cell *top_b, unsigned int flags, db::Coord tolerance, DifferenceReceiver &r)
 {
@@ -809,6 +1241,33 @@ do_compare_layouts (const db::Layout &a, const db::Cell *top_a, const db::Layout
   }
 
 
+  //  compute the content hashes: cells and layers with identical hashes are not compared in detail
+
+  if (tl::verbosity () >= 20) {
+    tl::info << "Layout diff - computing content hashes";
+  }
+
+  CellHashJob::layer_index_list layer_indexes_a, layer_indexes_b;
+  for (std::vector<db::LayerProperties>::const_iterator cl = common_layers.begin (); cl != common_layers.end (); ++cl) {
+    std::map<db::LayerProperties, unsigned int, db::LPLogicalLessFunc>::const_iterator la = layers_a.find (*cl);
+    layer_indexes_a.push_back (la != layers_a.end () ? std::make_pair (true, la->second) : std::make_pair (false, 0u));
+    std::map<db::LayerProperties, unsigned int, db::LPLogicalLessFunc>::const_iterator lb = layers_b.find (*cl);
+    layer_indexes_b.push_back (lb != layers_b.end () ? std::make_pair (true, lb->second) : std::make_pair (false, 0u));
+  }
+
+  std::vector<CellHashCompare> hash_compare;
+
+  {
+    //  establish the bounding boxes and shape trees before the cells are accessed concurrently
+    a.update ();
+    b.update ();
+
+    tl::RelativeProgress hash_progress (tl::to_string (QObject::tr ("Layout diff (hashing cells)")), common_cells.size (), 1);
+
+    CellHashJob hash_job (hash_threads (), a, common_cells_a, common_cell_indices_a, layer_indexes_a, b, common_cells_b, common_cell_indices_b, layer_indexes_b, flags);
+    hash_job.run (hash_compare, &hash_progress);
+  }
+
   tl::RelativeProgress progress (tl::to_string (QObject::tr ("Layout diff")), common_cells.size (), 1);
 
   //  compare cell by cell
@@ -849,45 +1308,52 @@ do_compare_layouts (const db::Layout &a, const db::Cell *top_a, const db::Layout
       r.bbox_differs (cell_a->bbox (), cell_b->bbox ());
     }
 
-    collect_insts (a, cell_a, flags, common_cell_indices_a, insts_a, prop_normalize_a);
-    collect_insts (b, cell_b, flags, common_cell_indices_b, insts_b, prop_normalize_b);
+    const CellHashCompare &hc = hash_compare [cci];
 
-    std::vector <db::CellInstArrayWithProperties> anotb;
-    std::set_difference (insts_a.begin (), insts_a.end (), insts_b.begin (), insts_b.end (), std::back_inserter (anotb));
+    //  compare instances (unless the hashes are identical)
 
-    rewrite_instances_to (anotb, flags, common_cells_a, prop_remap_to_a);
-    collect_insts_of_unmapped_cells (a, cell_a, flags, common_cell_indices_a, anotb);
+    if (hc.insts_differ) {
 
-    std::vector <db::CellInstArrayWithProperties> bnota;
-    std::set_difference (insts_b.begin (), insts_b.end (), insts_a.begin (), insts_a.end (), std::back_inserter (bnota));
+      collect_insts (a, cell_a, flags, common_cell_indices_a, insts_a, prop_normalize_a);
+      collect_insts (b, cell_b, flags, common_cell_indices_b, insts_b, prop_normalize_b);
 
-    rewrite_instances_to (bnota, flags, common_cells_b, prop_remap_to_b);
-    collect_insts_of_unmapped_cells (b, cell_b, flags, common_cell_indices_b, bnota);
+      std::vector <db::CellInstArrayWithProperties> anotb;
+      std::set_difference (insts_a.begin (), insts_a.end (), insts_b.begin (), insts_b.end (), std::back_inserter (anotb));
 
-    if (! anotb.empty () || ! bnota.empty ()) {
+      rewrite_instances_to (anotb, flags, common_cells_a, prop_remap_to_a);
+      collect_insts_of_unmapped_cells (a, cell_a, flags, common_cell_indices_a, anotb);
 
-      differs = true;
+      std::vector <db::CellInstArrayWithProperties> bnota;
+      std::set_difference (insts_b.begin (), insts_b.end (), insts_a.begin (), insts_a.end (), std::back_inserter (bnota));
 
-      if (flags & layout_diff::f_silent) {
-        return false;
-      }
+      rewrite_instances_to (bnota, flags, common_cells_b, prop_remap_to_b);
+      collect_insts_of_unmapped_cells (b, cell_b, flags, common_cell_indices_b, bnota);
 
-      r.begin_inst_differences ();
+      if (! anotb.empty () || ! bnota.empty ()) {
 
-      if (verbose) {
+        differs = true;
 
-        r.instances_in_a (insts_a, common_cells, n.properties_repository ());
-        r.instances_in_b (insts_b, common_cells, n.properties_repository ());
+        if (flags & layout_diff::f_silent) {
+          return false;
+        }
 
-        r.instances_in_a_only (anotb, a);
-        r.instances_in_b_only (bnota, b);
+        r.begin_inst_differences ();
 
-      }
+        if (verbose) {
 
-      r.end_inst_differences ();
+          r.instances_in_a (insts_a, common_cells, n.properties_repository ());
+          r.instances_in_b (insts_b, common_cells, n.properties_repository ());
 
-    }
+          r.instances_in_a_only (anotb, a);
+          r.instances_in_b_only (bnota, b);
 
+        }
+
+        r.end_inst_differences ();
+
+      }
+
+    }
 
     //  compare layer by layer
     
@@ -920,6 +1386,12 @@ do_compare_layouts (const db::Layout &a, const db::Cell *top_a, const db::Layout
         r.per_layer_bbox_differs (cell_a->bbox (layer_a), cell_b->bbox (layer_b));
       }
 
+      if (! std::binary_search (hc.layers_differ.begin (), hc.layers_differ.end (), (unsigned int) (cl - common_layers.begin ()))) {
+        //  identical content hashes: no need to compare the shapes
+        r.end_layer ();
+        continue;
+      }
+
       //  compare polygons
 
       polygons_a.clear();
@@ -161,6 +161,11 @@ bool DB_PUBLIC compare_layouts (const db::Layout &a, const db::Layout &b, unsign
  *  @param flags Flags to use for the comparison
  *  @param tolerance A coordinate tolerance to apply (0: exact match, 1: one DBU tolerance is allowed ...)
  *
+ *  Before the cells are compared in detail, order-independent content hashes of the instances and 
+ *  of the shapes per layer are computed for each cell in parallel. The instances or shapes of a cell
+ *  are compared in detail only if the hashes differ. Hence the detailed compare is only done for 
+ *  the parts which have changed.
+ *
  *  @return True, if the layouts are identical
  */
 bool DB_PUBLIC compare_layouts (const db::Layout &a, const db::Layout &b, unsigned int flags, db::Coord tolerance, DifferenceReceiver &r);
@@ -23,17 +23,19 @@
 
 #include "dbLayoutStateModel.h"
 
+#include <limits>
+
 namespace db 
 {
 
 LayoutStateModel::LayoutStateModel (bool busy)
-  : m_hier_dirty (false), m_bboxes_dirty (false), m_busy (busy)
+  : m_hier_dirty (false), m_bboxes_dirty (false), m_all_bboxes_dirty (false), m_busy (busy)
 {
   //  .. nothing yet ..
 }
 
 LayoutStateModel::LayoutStateModel (const LayoutStateModel &d)
-  : m_hier_dirty (d.m_hier_dirty), m_bboxes_dirty (d.m_bboxes_dirty), m_busy (d.m_busy)
+  : m_hier_dirty (d.m_hier_dirty), m_bboxes_dirty (d.m_bboxes_dirty), m_all_bboxes_dirty (d.m_all_bboxes_dirty), m_bboxes_dirty_layers (d.m_bboxes_dirty_layers), m_busy (d.m_busy)
 {
   //  .. nothing yet ..
 }
@@ -43,6 +45,8 @@ LayoutStateModel::operator= (const LayoutStateModel &d)
 {
   m_hier_dirty = d.m_hier_dirty;
   m_bboxes_dirty = d.m_bboxes_dirty;
+  m_all_bboxes_dirty = d.m_all_bboxes_dirty;
+  m_bboxes_dirty_layers = d.m_bboxes_dirty_layers;
   m_busy = d.m_busy;
   return *this;
 }
@@ -65,5 +69,31 @@ LayoutStateModel::do_invalidate_bboxes (unsigned int index)
   bboxes_changed_any_event ();
 }
 
+bool
+LayoutStateModel::bboxes_dirty (unsigned int index) const
+{
+  if (m_all_bboxes_dirty) {
+    return true;
+  } else if (index == std::numeric_limits<unsigned int>::max ()) {
+    return false;
+  } else {
+    return index < (unsigned int) m_bboxes_dirty_layers.size () && m_bboxes_dirty_layers [index];
+  }
+}
+
+void
+LayoutStateModel::set_bboxes_dirty (unsigned int index)
+{
+  if (index == std::numeric_limits<unsigned int>::max ()) {
+    m_all_bboxes_dirty = true;
+  } else {
+    if (index >= (unsigned int) m_bboxes_dirty_layers.size ()) {
+      m_bboxes_dirty_layers.resize (index + 1, false);
+    }
+    m_bboxes_dirty_layers [index] = true;
+  }
+  m_bboxes_dirty = true;
+}
+
 }
 
@@ -28,6 +28,8 @@
 
 #include "tlEvents.h"
 
+#include <vector>
+
 namespace db 
 {
 
@@ -99,12 +101,16 @@ public:
    *
    *  If the index is std::numeric_limits<unsigned int>::max, this method
    *  applies to all layers.
+   *
+   *  The "bboxes_changed" events are emitted once for every layer which
+   *  becomes invalid, so observers learn about every layer changed since
+   *  the last update.
    */
   void invalidate_bboxes (unsigned int index)
   {
-    if (! m_bboxes_dirty || m_busy) {
+    if (m_busy || ! bboxes_dirty (index)) {
       do_invalidate_bboxes (index);  //  must be called before the bboxes are invalidated (stopping of redraw thread requires this)
-      m_bboxes_dirty = true;
+      set_bboxes_dirty (index);
     }
   }
 
@@ -126,6 +132,8 @@ public:
     if (m_bboxes_dirty || m_hier_dirty) {
       do_update ();
       m_bboxes_dirty = false;
+      m_all_bboxes_dirty = false;
+      m_bboxes_dirty_layers.clear ();
       m_hier_dirty = false;
     }
   }
@@ -150,6 +158,15 @@ public:
     return m_bboxes_dirty;
   }
 
+  /**
+   *  @brief The "dirty bounding box" attribute for a specific layer
+   *
+   *  This attribute is true, if the bounding boxes on the given layer have changed since the last "update" call.
+   *  If the index is std::numeric_limits<unsigned int>::max, this method tells whether the bounding boxes
+   *  have been invalidated for all layers.
+   */
+  bool bboxes_dirty (unsigned int index) const;
+
   /**
    *  @brief Sets or resets busy mode
    *
@@ -212,10 +229,13 @@ public:
 private:
   bool m_hier_dirty;
   bool m_bboxes_dirty;
+  bool m_all_bboxes_dirty;
+  std::vector<bool> m_bboxes_dirty_layers;
   bool m_busy;
 
   void do_invalidate_hier ();
   void do_invalidate_bboxes (unsigned int index);
+  void set_bboxes_dirty (unsigned int index);
 };
 
 }
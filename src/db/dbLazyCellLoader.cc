@@ -0,0 +1,248 @@
+
+/*
+
+  KLayout Layout Viewer
+  Copyright (C) 2006-2017 Matthias Koefferlein
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+
+#include "dbLazyCellLoader.h"
+#include "dbLayout.h"
+#include "tlString.h"
+
+#include <QFileInfo>
+
+#include <limits>
+
+namespace db
+{
+
+// ---------------------------------------------------------------
+//  LazyCellLoader implementation
+
+LazyCellLoader::LazyCellLoader (const std::string &source)
+  : m_source (source), mp_scratch_layout (0), m_loaded (0), m_pending (0)
+{
+  //  .. nothing yet ..
+}
+
+LazyCellLoader::~LazyCellLoader ()
+{
+  delete mp_scratch_layout;
+  mp_scratch_layout = 0;
+}
+
+void
+LazyCellLoader::make_lazy (db::Layout &layout, db::cell_index_type ci, const box_map &bboxes)
+{
+  box_map &bb = m_bboxes [ci];
+  for (box_map::const_iterator b = bboxes.begin (); b != bboxes.end (); ++b) {
+    bb [b->first] += b->second;
+  }
+
+  db::Cell &cell = layout.cell (ci);
+
+  if (! cell.is_lazy ()) {
+
+    //  Shapes present already (i.e. from a previous file read into the same layout) are
+    //  included in the bounding boxes since the lazy cell reports its layers from those.
+    for (db::Cell::shapes_map::iterator s = cell.m_shapes_map.begin (); s != cell.m_shapes_map.end (); ++s) {
+      if (! s->second.empty ()) {
+        s->second.update_bbox ();
+        bb [s->first] += s->second.bbox ();
+      }
+    }
+
+    cell.m_lazy.fetchAndStoreOrdered (1);
+    ++m_pending;
+
+  }
+
+  cell.m_bbox_needs_update = true;
+
+  layout.invalidate_bboxes (std::numeric_limits<unsigned int>::max ());
+}
+
+const LazyCellLoader::box_map &
+LazyCellLoader::shape_bboxes (db::cell_index_type ci) const
+{
+  std::map<db::cell_index_type, box_map>::const_iterator bb = m_bboxes.find (ci);
+  if (bb != m_bboxes.end ()) {
+    return bb->second;
+  } else {
+    static const box_map empty_bboxes;
+    return empty_bboxes;
+  }
+}
+
+size_t
+LazyCellLoader::loaded_cells () const
+{
+  QMutexLocker locker (&m_lock);
+  return m_loaded;
+}
+
+bool
+LazyCellLoader::reads_from (const std::string &path) const
+{
+  QMutexLocker locker (&m_lock);
+  if (m_pending == 0) {
+    return false;
+  }
+
+  QString p = QFileInfo (tl::to_qstring (path)).canonicalFilePath ();
+  return ! p.isEmpty () && p == QFileInfo (tl::to_qstring (m_source)).canonicalFilePath ();
+}
+
+void
+LazyCellLoader::load (const db::Layout &layout, db::cell_index_type ci)
+{
+  QMutexLocker locker (&m_lock);
+
+  //  The layout is logically const: loading does not change the cell's content
+  do_load (const_cast<db::Layout &> (layout), ci);
+}
+
+void
+LazyCellLoader::discard (const db::Cell &cell)
+{
+  QMutexLocker locker (&m_lock);
+
+  if (cell.is_lazy ()) {
+    finish_load (const_cast<db::Cell &> (cell));
+  }
+}
+
+void
+LazyCellLoader::load_all (const db::Layout &layout)
+{
+  QMutexLocker locker (&m_lock);
+
+  db::Layout &l = const_cast<db::Layout &> (layout);
+  for (std::map<db::cell_index_type, box_map>::const_iterator c = m_bboxes.begin (); c != m_bboxes.end () && m_pending > 0; ++c) {
+    if (l.is_valid_cell_index (c->first)) {
+      do_load (l, c->first);
+    }
+  }
+
+  //  cells deleted or cleared before they have been loaded are not waited for 
+  if (m_pending > 0) {
+    m_pending = 0;
+    release_source ();
+  }
+}
+
+void
+LazyCellLoader::do_load (db::Layout &layout, db::cell_index_type ci)
+{
+  db::Cell &cell = layout.cell (ci);
+
+  //  the cell may have been loaded by another thread while we were waiting for the lock
+  if (! cell.is_lazy ()) {
+    return;
+  }
+
+  //  the source has been released already: the cell remains without shapes
+  if (m_pending == 0) {
+    cell.m_lazy.fetchAndStoreRelease (0);
+    return;
+  }
+
+  try {
+    read_cell (layout, ci);
+  } catch (...) {
+    //  don't try again - the cell will appear without shapes
+    finish_load (cell);
+    throw;
+  }
+
+  finish_load (cell);
+  ++m_loaded;
+}
+
+void
+LazyCellLoader::finish_load (db::Cell &cell)
+{
+  //  NOTE: the release semantics makes the shapes visible to other threads before
+  //  they see the cell as loaded
+  cell.m_lazy.fetchAndStoreRelease (0);
+
+  if (--m_pending == 0) {
+    release_source ();
+  }
+}
+
+db::Layout &
+LazyCellLoader::scratch_layout (const db::Layout &layout)
+{
+  if (! mp_scratch_layout) {
+    mp_scratch_layout = new db::Layout (layout.is_editable ());
+  }
+  return *mp_scratch_layout;
+}
+
+void
+LazyCellLoader::install_shapes (db::Cell &cell, unsigned int layer, const db::Shapes &source)
+{
+  if (source.empty ()) {
+    return;
+  }
+
+  tl_assert (source.layout () == mp_scratch_layout);
+
+  db::Layout &layout = *cell.layout ();
+
+  db::Cell::shapes_map::iterator s = cell.m_shapes_map.find (layer);
+  if (s == cell.m_shapes_map.end ()) {
+    s = cell.m_shapes_map.insert (std::make_pair (layer, db::Shapes (0, &cell, layout.is_editable ()))).first;
+  }
+
+  db::Shapes &shapes = s->second;
+
+  //  A dirty shapes container does not notify the layout of changes. This way,
+  //  loading does not disturb observers such as a drawing thread.
+  bool was_dirty = shapes.is_dirty ();
+  shapes.set_dirty (true);
+
+  if (shapes.empty ()) {
+    //  The shapes are taken over as they are: the references point into the scratch layout's 
+    //  repository and the property IDs refer to the layout already. Hence loading does not 
+    //  modify the layout's repositories which may be used by other threads.
+    for (tl::vector<db::LayerBase *>::const_iterator l = source.m_layers.begin (); l != source.m_layers.end (); ++l) {
+      shapes.m_layers.push_back ((*l)->clone (&shapes, 0));
+    }
+  } else {
+    //  shapes present before the cell was made lazy: translate into the layout's repositories
+    shapes.insert (source);
+  }
+
+  //  establish the sorted state for region queries unless the container needs
+  //  an update for other reasons
+  if (! was_dirty) {
+    shapes.update ();
+    //  cells loaded after the layout was packed are packed as well
+    if (layout.shapes_packed ()) {
+      shapes.pack (layout.use_arena () ? &layout.arena () : 0);
+    }
+  }
+
+  shapes.manager (cell.manager ());
+}
+
+}
+
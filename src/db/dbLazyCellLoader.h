@@ -0,0 +1,199 @@
+
+/*
+
+  KLayout Layout Viewer
+  Copyright (C) 2006-2017 Matthias Koefferlein
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+
+#ifndef HDR_dbLazyCellLoader
+#define HDR_dbLazyCellLoader
+
+#include "dbCommon.h"
+#include "dbTypes.h"
+#include "dbBox.h"
+
+#include <QMutex>
+
+#include <map>
+#include <string>
+
+namespace db
+{
+
+class Layout;
+class Cell;
+class Shapes;
+
+/**
+ *  @brief The loader for the shapes of lazy cells
+ *
+ *  A lazy cell is a cell whose shapes are not held in memory. Instead, the shapes
+ *  are read from the original file when they are accessed for the first time.
+ *  The per-layer bounding boxes of the shapes are known in advance, so the cell's
+ *  bounding box can be computed without loading the shapes.
+ *
+ *  Readers supporting lazy loading derive from this class and implement "read_cell".
+ *  The loader is installed in the layout with Layout::set_lazy_cell_loader and
+ *  the cells are turned into lazy cells with "make_lazy". The layout takes over the
+ *  ownership of the loader.
+ *
+ *  Loading may happen from different threads, i.e. from drawing or other worker threads
+ *  while other threads read the layout. Hence the loader serializes the loading of cells
+ *  and loading does not modify the layout's shared objects: the shapes are read into 
+ *  a scratch layout owned by the loader and installed in the lazy cell as they are. So 
+ *  the shape references point into the loader's repository. Property IDs need to be 
+ *  registered in the layout's properties repository while reading the file.
+ *
+ *  When all cells are loaded, the loader releases the file through "release_source". 
+ *  The file must not be modified as long as there are lazy cells. Use 
+ *  Layout::load_lazy_cells before a file is overwritten which may be the source of 
+ *  lazy cells. Loaders keeping the file mapped must check the file with 
+ *  tl::InputStream::source_modified before reading a cell and throw an exception 
+ *  if it was modified: reading a truncated mapped file would crash the program.
+ */
+class DB_PUBLIC LazyCellLoader
+{
+public:
+  typedef std::map<unsigned int, db::Box> box_map;
+
+  /**
+   *  @brief Constructor
+   *
+   *  @param source The path of the file the shapes are read from
+   */
+  LazyCellLoader (const std::string &source);
+
+  /**
+   *  @brief Destructor
+   */
+  virtual ~LazyCellLoader ();
+
+  /**
+   *  @brief Turns the given cell into a lazy cell
+   *
+   *  @param bboxes The per-layer bounding boxes of the shapes which will be delivered by "read_cell"
+   *
+   *  If the cell is a lazy cell already, the bounding boxes are added to the ones present already.
+   *  This method must not be called while other threads access the layout.
+   */
+  void make_lazy (db::Layout &layout, db::cell_index_type ci, const box_map &bboxes);
+
+  /**
+   *  @brief Loads the shapes of the given cell if it is a lazy cell
+   *
+   *  After the shapes have been loaded, the cell is no longer a lazy cell.
+   *  This method does not issue any change notification: the shapes are regarded
+   *  part of the cell already.
+   */
+  void load (const db::Layout &layout, db::cell_index_type ci);
+
+  /**
+   *  @brief Drops the shapes not loaded yet for the given cell
+   *
+   *  After this method, the cell is no longer a lazy cell and its shapes are not
+   *  loaded. This method is used when the cell is cleared or deleted. It synchronizes 
+   *  with loads running in other threads.
+   */
+  void discard (const db::Cell &cell);
+
+  /**
+   *  @brief Loads the shapes of all lazy cells
+   *
+   *  After this method has been called, the source file is released.
+   */
+  void load_all (const db::Layout &layout);
+
+  /**
+   *  @brief Gets the per-layer bounding boxes of the shapes of the given lazy cell
+   *
+   *  The bounding boxes are not modified after the file has been read, so this
+   *  method can be used from any thread.
+   */
+  const box_map &shape_bboxes (db::cell_index_type ci) const;
+
+  /**
+   *  @brief Gets the path of the file the shapes are read from
+   */
+  const std::string &source () const
+  {
+    return m_source;
+  }
+
+  /**
+   *  @brief Returns true, if the shapes are read from the given file and not all cells are loaded yet
+   */
+  bool reads_from (const std::string &path) const;
+
+  /**
+   *  @brief Gets the number of cells loaded so far
+   */
+  size_t loaded_cells () const;
+
+protected:
+  /**
+   *  @brief Reads the shapes of the given cell
+   *
+   *  Implementations read the shapes into a cell of the scratch layout (see "scratch_layout")
+   *  and deliver them by calling "install_shapes". This method is called with the 
+   *  loader's lock held.
+   */
+  virtual void read_cell (db::Layout &layout, db::cell_index_type ci) = 0;
+
+  /**
+   *  @brief Releases the source file 
+   *
+   *  This method is called when all cells have been loaded. "read_cell" is not called
+   *  after this method has been called.
+   */
+  virtual void release_source () { }
+
+  /**
+   *  @brief Gets the scratch layout
+   *
+   *  The scratch layout provides the repositories for the shapes loaded. It is
+   *  created on the first call with the editable mode of the given layout.
+   */
+  db::Layout &scratch_layout (const db::Layout &layout);
+
+  /**
+   *  @brief Installs the shapes for the given layer in the lazy cell
+   *
+   *  The source shapes must reside in the scratch layout. Their property IDs must refer to 
+   *  the cell's layout. The shapes are taken over as they are.
+   */
+  void install_shapes (db::Cell &cell, unsigned int layer, const db::Shapes &source);
+
+private:
+  mutable QMutex m_lock;
+  std::string m_source;
+  std::map<db::cell_index_type, box_map> m_bboxes;
+  db::Layout *mp_scratch_layout;
+  size_t m_loaded, m_pending;
+
+  void do_load (db::Layout &layout, db::cell_index_type ci);
+  void finish_load (db::Cell &cell);
+
+  LazyCellLoader (const LazyCellLoader &);
+  LazyCellLoader &operator= (const LazyCellLoader &);
+};
+
+}
+
+#endif
+
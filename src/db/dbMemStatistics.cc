@@ -57,6 +57,7 @@ MemStatistics::MemStatistics ()
   m_shapes_cache_used = m_shapes_cache_reqd = 0;
   m_shape_trees_used = m_shape_trees_reqd = 0;
   m_instances_used = m_instances_reqd = 0;
+  m_arena_used = m_arena_reqd = 0;
 }
 
 void 
@@ -70,8 +71,9 @@ MemStatistics::print () const
   tl::info << "  Shapes info    " << m_shapes_info_used << " (used) " << m_shapes_info_reqd << " (reqd) ";
   tl::info << "  Shapes cache   " << m_shapes_cache_used << " (used) " << m_shapes_cache_reqd << " (reqd) ";
   tl::info << "  Shape trees    " << m_shape_trees_used << " (used) " << m_shape_trees_reqd << " (reqd) ";
-  tl::info << "  Total          " << (m_layout_info_used + m_cell_info_used + m_instances_used + m_inst_trees_used + m_shapes_info_used + m_shapes_cache_used + m_shape_trees_used) << " (used) " 
-                                  << (m_layout_info_reqd + m_cell_info_reqd + m_instances_reqd + m_inst_trees_reqd + m_shapes_info_reqd + m_shapes_cache_reqd + m_shape_trees_reqd) << " (reqd) ";
+  tl::info << "  Arena          " << m_arena_used << " (used) " << m_arena_reqd << " (reqd) ";
+  tl::info << "  Total          " << (m_layout_info_used + m_cell_info_used + m_instances_used + m_inst_trees_used + m_shapes_info_used + m_shapes_cache_used + m_shape_trees_used + m_arena_used) << " (used) " 
+                                  << (m_layout_info_reqd + m_cell_info_reqd + m_instances_reqd + m_inst_trees_reqd + m_shapes_info_reqd + m_shapes_cache_reqd + m_shape_trees_reqd + m_arena_reqd) << " (reqd) ";
 }
 
 }
@@ -303,6 +303,12 @@ public:
     m_shape_trees_reqd += mem_reqd (x);
   }
 
+  void arena (size_t u, size_t r)
+  {
+    m_arena_used += u;
+    m_arena_reqd += r;
+  }
+
 private:
   size_t m_layout_info_used, m_layout_info_reqd;
   size_t m_cell_info_used, m_cell_info_reqd;
@@ -311,6 +317,7 @@ private:
   size_t m_shapes_cache_used, m_shapes_cache_reqd;
   size_t m_shape_trees_used, m_shape_trees_reqd;
   size_t m_instances_used, m_instances_reqd;
+  size_t m_arena_used, m_arena_reqd;
 };
 
 }
@@ -29,9 +29,18 @@
 #include "dbArray.h"
 #include "dbStatic.h"
 
+#include "dbLayoutUtils.h"
+
 #include "tlException.h"
 #include "tlString.h"
 #include "tlClassRegistry.h"
+#include "tlThreadedWorkers.h"
+
+#include <QMutex>
+#include <QWaitCondition>
+
+#include <memory>
+#include <algorithm>
 
 namespace db
 {
@@ -67,6 +76,432 @@ private:
   bool m_create;
 };
 
+// ---------------------------------------------------------------
+//  Parallel decoding of cells
+
+/**
+ *  @brief Holds a cell decoded by the parallel decoder
+ *
+ *  The cell is decoded into a private layout. The instances already refer to the
+ *  cells of the target layout. They are kept separately until the cell is merged.
+ */
+struct OASISDecodedCell
+{
+  enum State { Pending, Decoding, Done, Skipped };
+
+  OASISDecodedCell (size_t _pos, unsigned long _id)
+    : pos (_pos), id (_id), start_pos (0), end_pos (0), state (Pending), layout (0), cell_index (0), has_context (false)
+  {
+    //  .. nothing yet ..
+  }
+
+  void clear ()
+  {
+    //  clear the instances before the layout since they may refer to the layout's array repository
+    instances.clear ();
+    instances_with_props.clear ();
+    context_strings.clear ();
+    warnings.clear ();
+    delete layout;
+    layout = 0;
+  }
+
+  size_t pos;
+  unsigned long id;
+  size_t start_pos, end_pos;
+  State state;
+  db::Layout *layout;
+  db::cell_index_type cell_index;
+  tl::vector<db::CellInstArray> instances;
+  tl::vector<db::CellInstArrayWithProperties> instances_with_props;
+  bool has_context;
+  std::vector<std::string> context_strings;
+  std::vector<std::string> warnings;
+};
+
+/**
+ *  @brief The amount of file data per thread the decoder may be ahead of the main reader
+ *
+ *  This limits the memory occupied by cells decoded but not merged yet.
+ */
+const size_t decoder_window_per_thread = 32 * 1024 * 1024;
+
+/**
+ *  @brief The task for decoding one cell
+ */
+class OASISCellDecoderTask
+  : public tl::Task
+{
+public:
+  OASISCellDecoderTask (size_t index)
+    : m_index (index)
+  {
+    //  .. nothing yet ..
+  }
+
+  size_t index () const
+  {
+    return m_index;
+  }
+
+private:
+  size_t m_index;
+};
+
+/**
+ *  @brief The job decoding the cells of an OASIS file in parallel
+ *
+ *  The parallel decoder requires a strict-mode file with S_CELL_OFFSET properties
+ *  on the CELLNAME records. The name tables are read by a separate reader first. Then 
+ *  the workers decode the cells into private layouts while the main reader proceeds 
+ *  through the file. When the main reader arrives at a cell which has been decoded 
+ *  already, it merges the cell and skips the cell's records. Cells the workers did not 
+ *  get to yet and cells which cannot be decoded independently (i.e. because they 
+ *  contain forward references) are read by the main reader. Hence the result does
+ *  not depend on the timing of the workers.
+ */
+class OASISCellDecoderJob
+  : public tl::JobBase
+{
+public:
+  OASISCellDecoderJob (int nworkers, OASISReader *reader)
+    : tl::JobBase (nworkers),
+      mp_reader (reader), mp_data (0), m_length (0), m_editable (false), m_tables_layout (false),
+      m_window (decoder_window_per_thread * size_t (nworkers)), m_read_pos (0), m_shutdown (false)
+  {
+    //  .. nothing yet ..
+  }
+
+  ~OASISCellDecoderJob ()
+  {
+    {
+      QMutexLocker locker (&m_cells_lock);
+      m_shutdown = true;
+      m_cells_condition.wakeAll ();
+    }
+
+    terminate ();
+
+    for (std::vector<OASISDecodedCell>::iterator c = m_cells.begin (); c != m_cells.end (); ++c) {
+      c->clear ();
+    }
+  }
+
+  /**
+   *  @brief Reads the tables and the cell offsets and prepares the target layout
+   *
+   *  Returns false if the file cannot be decoded in parallel.
+   */
+  bool prepare (db::Layout &layout)
+  {
+    m_editable = layout.is_editable ();
+
+    mp_data = mp_reader->m_stream.mapped_block (m_length);
+    if (! mp_data) {
+      return false;
+    }
+
+    mp_tables_data.reset (new tl::InputMemoryStream (mp_data, m_length));
+    mp_tables_stream.reset (new tl::InputStream (*mp_tables_data));
+    mp_tables.reset (new OASISReader (*mp_tables_stream));
+
+    //  the table reader needs the special properties (S_CELL_OFFSET). It does not report 
+    //  warnings since the main reader will report them again.
+    OASISReader &tables = *mp_tables;
+    tables.m_read_all_properties = true;
+    tables.mp_warnings = &m_tables_warnings;
+
+    std::vector<std::pair<size_t, unsigned long> > cells;
+
+    try {
+      if (! tables.prescan (m_tables_layout, cells)) {
+        return false;
+      }
+    } catch (tl::BreakException &) {
+      throw;
+    } catch (tl::Exception &) {
+      //  errors will be reported by the main reader
+      return false;
+    }
+
+    //  Create the cells in the target layout, so the workers can refer to them 
+    for (std::vector<std::pair<size_t, unsigned long> >::const_iterator c = cells.begin (); c != cells.end (); ++c) {
+
+      const std::string &name = tables.m_cellnames [c->second];
+
+      db::cell_index_type cell_index;
+      std::pair<bool, db::cell_index_type> lc = layout.cell_by_name (name.c_str ());
+      if (lc.first) {
+        cell_index = lc.second;
+      } else {
+        cell_index = layout.add_cell (name.c_str ());
+        //  temporarily mark as "ghost cell" like cells which are referenced before they are defined
+        layout.cell (cell_index).set_ghost_cell (true);
+      }
+
+      mp_reader->m_cells_by_id.insert (std::make_pair (c->second, cell_index));
+      mp_reader->m_cells_by_name.insert (std::make_pair (name, cell_index));
+
+      m_index_by_id.insert (std::make_pair (c->second, m_cells.size ()));
+      m_cells.push_back (OASISDecodedCell (c->first, c->second));
+
+    }
+
+    //  take a snapshot for the workers
+    m_cells_by_id = mp_reader->m_cells_by_id;
+    m_cells_by_name = mp_reader->m_cells_by_name;
+
+    return true;
+  }
+
+  /**
+   *  @brief Starts decoding 
+   */
+  void run ()
+  {
+    for (size_t i = 0; i < m_cells.size (); ++i) {
+      schedule (new OASISCellDecoderTask (i));
+    }
+
+    start ();
+  }
+
+  /**
+   *  @brief Fetches the decoded cell with the given id for the main reader
+   *
+   *  "pos" is the main reader's position after the CELL record's id.
+   *  Returns 0 if the main reader has to read the cell itself.
+   */
+  OASISDecodedCell *fetch (unsigned long id, size_t pos)
+  {
+    std::map<unsigned long, size_t>::const_iterator i = m_index_by_id.find (id);
+    if (i == m_index_by_id.end ()) {
+      return 0;
+    }
+
+    QMutexLocker locker (&m_cells_lock);
+
+    OASISDecodedCell &dc = m_cells [i->second];
+
+    //  let the workers proceed
+    m_read_pos = dc.pos;
+    m_cells_condition.wakeAll ();
+
+    if (dc.state == OASISDecodedCell::Pending) {
+      //  no worker got to this cell yet
+      dc.state = OASISDecodedCell::Skipped;
+      return 0;
+    }
+
+    while (dc.state == OASISDecodedCell::Decoding) {
+      m_cells_condition.wait (&m_cells_lock);
+    }
+
+    if (dc.state == OASISDecodedCell::Done && dc.start_pos == pos) {
+      return &dc;
+    } else {
+      dc.clear ();
+      return 0;
+    }
+  }
+
+  /**
+   *  @brief Releases the memory of a cell after it has been merged
+   */
+  void release (OASISDecodedCell *dc)
+  {
+    dc->clear ();
+  }
+
+  /**
+   *  @brief Claims a cell for decoding by a worker
+   *
+   *  Returns false if the cell does not need to be decoded.
+   */
+  bool claim (size_t index)
+  {
+    QMutexLocker locker (&m_cells_lock);
+
+    OASISDecodedCell &dc = m_cells [index];
+
+    //  don't run too far ahead of the main reader
+    while (! m_shutdown && dc.state == OASISDecodedCell::Pending && dc.pos > m_read_pos + m_window) {
+      m_cells_condition.wait (&m_cells_lock);
+    }
+
+    if (m_shutdown || dc.state != OASISDecodedCell::Pending) {
+      return false;
+    }
+
+    dc.state = OASISDecodedCell::Decoding;
+    return true;
+  }
+
+  /**
+   *  @brief Indicates that a worker has finished a cell
+   */
+  void finish (size_t index, bool success)
+  {
+    QMutexLocker locker (&m_cells_lock);
+    m_cells [index].state = success ? OASISDecodedCell::Done : OASISDecodedCell::Skipped;
+    m_cells_condition.wakeAll ();
+  }
+
+  OASISDecodedCell &cell (size_t index)
+  {
+    return m_cells [index];
+  }
+
+  const char *data () const
+  {
+    return mp_data;
+  }
+
+  size_t length () const
+  {
+    return m_length;
+  }
+
+  bool editable () const
+  {
+    return m_editable;
+  }
+
+  const OASISReader &reader () const
+  {
+    return *mp_reader;
+  }
+
+  const OASISReader &tables () const
+  {
+    return *mp_tables;
+  }
+
+  const std::map <unsigned long, db::cell_index_type> &cells_by_id () const
+  {
+    return m_cells_by_id;
+  }
+
+  const std::map <std::string, db::cell_index_type> &cells_by_name () const
+  {
+    return m_cells_by_name;
+  }
+
+  virtual tl::Worker *create_worker ();
+
+private:
+  OASISReader *mp_reader;
+  const char *mp_data;
+  size_t m_length;
+  bool m_editable;
+  std::auto_ptr<tl::InputMemoryStream> mp_tables_data;
+  std::auto_ptr<tl::InputStream> mp_tables_stream;
+  std::auto_ptr<OASISReader> mp_tables;
+  db::Layout m_tables_layout;
+  std::vector<std::string> m_tables_warnings;
+  std::vector<OASISDecodedCell> m_cells;
+  std::map<unsigned long, size_t> m_index_by_id;
+  std::map <unsigned long, db::cell_index_type> m_cells_by_id;
+  std::map <std::string, db::cell_index_type> m_cells_by_name;
+  size_t m_window;
+  size_t m_read_pos;
+  bool m_shutdown;
+  QMutex m_cells_lock;
+  QWaitCondition m_cells_condition;
+};
+
+/**
+ *  @brief The worker decoding cells
+ *
+ *  Each worker employs an own reader on an own stream on the file data.
+ */
+class OASISCellDecoderWorker
+  : public tl::Worker
+{
+public:
+  OASISCellDecoderWorker (OASISCellDecoderJob *job)
+    : tl::Worker (), mp_job (job), m_data (job->data (), job->length ()), m_stream (m_data)
+  {
+    //  .. nothing yet ..
+  }
+
+  void perform_task (tl::Task *task)
+  {
+    OASISCellDecoderTask *cell_task = dynamic_cast <OASISCellDecoderTask *> (task);
+    if (cell_task && mp_job->claim (cell_task->index ())) {
+      bool success = decode (mp_job->cell (cell_task->index ()));
+      mp_job->finish (cell_task->index (), success);
+    }
+  }
+
+private:
+  OASISCellDecoderJob *mp_job;
+  tl::InputMemoryStream m_data;
+  tl::InputStream m_stream;
+  std::auto_ptr<OASISReader> mp_reader;
+
+  bool decode (OASISDecodedCell &dc)
+  {
+    try {
+
+      if (! mp_reader.get ()) {
+        //  NOTE: the reader is created inside the worker thread, so its progress 
+        //  object is not shown by the main thread's progress reporter
+        mp_reader.reset (new OASISReader (m_stream));
+        setup_reader ();
+      }
+
+      mp_reader->decode_cell (dc, mp_job->editable ());
+      return true;
+
+    } catch (...) {
+      //  the main reader will read this cell
+      dc.clear ();
+      setup_reader ();
+      return false;
+    }
+  }
+
+  void setup_reader ()
+  {
+    const OASISReader &main = mp_job->reader ();
+    const OASISReader &tables = mp_job->tables ();
+    OASISReader &reader = *mp_reader;
+
+    reader.set_warnings_as_errors (main.warnings_as_errors ());
+    reader.m_expect_strict_mode = main.m_expect_strict_mode;
+    reader.m_read_texts = main.m_read_texts;
+    reader.m_read_properties = main.m_read_properties;
+    reader.m_read_all_properties = main.m_read_all_properties;
+    //  all layers are created: the main reader will apply the layer mapping when merging the cell
+    reader.m_create_layers = true;
+
+    reader.m_dbu = tables.m_dbu;
+    reader.m_cellnames = tables.m_cellnames;
+    reader.m_textstrings = tables.m_textstrings;
+    reader.m_propstrings = tables.m_propstrings;
+    reader.m_propnames = tables.m_propnames;
+    reader.m_layernames = tables.m_layernames;
+
+    reader.m_cells_by_id = mp_job->cells_by_id ();
+    reader.m_cells_by_name = mp_job->cells_by_name ();
+
+    reader.m_forward_references.clear ();
+    reader.m_text_forward_references.clear ();
+    reader.m_propname_forward_references.clear ();
+    reader.m_propvalue_forward_references.clear ();
+
+    reader.mp_decoded_cell = 0;
+    reader.mp_warnings = 0;
+  }
+};
+
+tl::Worker *
+OASISCellDecoderJob::create_worker ()
+{
+  return new OASISCellDecoderWorker (this);
+}
+
 // ---------------------------------------------------------------
 //  OASISReader
 
@@ -75,6 +510,7 @@ OASISReader::OASISReader (tl::InputStream &s)
     m_progress (tl::to_string (QObject::tr ("Reading OASIS file")), 10000),
     m_dbu (0.001),
     m_expect_strict_mode (-1),
+    m_strict_tables (false),
     mm_repetition (this, "repetition"),
     mm_placement_cell (this, "placement-cell"),
     mm_placement_x (this, "playcement-x"),
@@ -106,7 +542,13 @@ OASISReader::OASISReader (tl::InputStream &s)
     m_read_properties (true),
     m_read_all_properties (false),
     m_s_gds_property_name_id (0),
-    m_klayout_context_property_name_id (0)
+    m_klayout_context_property_name_id (0),
+    m_cellname_id (0), m_textstring_id (0), m_propstring_id (0), m_propname_id (0),
+    m_cellname_id_mode (AnyId), m_textstring_id_mode (AnyId), m_propstring_id_mode (AnyId), m_propname_id_mode (AnyId),
+    m_threads (0),
+    mp_decoder_job (0),
+    mp_decoded_cell (0),
+    mp_warnings (0)
 {
   m_progress.set_format (tl::to_string (QObject::tr ("%.0f MB")));
   m_progress.set_unit (1024 * 1024);
@@ -131,6 +573,7 @@ OASISReader::read (db::Layout &layout, const db::LoadLayoutOptions &options)
   m_create_layers = common_options.create_other_layers;
   m_read_all_properties = oasis_options.read_all_properties;
   m_expect_strict_mode = oasis_options.expect_strict_mode;
+  m_threads = oasis_options.threads;
 
   layout.start_changes ();
   try {
@@ -508,6 +951,10 @@ OASISReader::warn (const std::string &msg)
 {
   if (warnings_as_errors ()) {
     error (msg);
+  } else if (mp_warnings) {
+    //  collect the warnings (i.e. for replaying them when a cell decoded in parallel is merged)
+    mp_warnings->push_back (msg + tl::to_string (QObject::tr (" (position=")) + tl::to_string (m_stream.pos ())
+                                + tl::to_string (QObject::tr (", cell=")) + m_cellname + ")");
   } else {
     // TODO: compress
     tl::warn << msg 
@@ -615,32 +1062,40 @@ OASISReader::read_offset_table ()
 {
   unsigned long of = 0;
 
+  //  the tables are strict if all flags are set
+  m_strict_tables = true;
+
   of = get_uint ();
   m_table_cellname = get_ulong ();
+  m_strict_tables = m_strict_tables && of != 0;
   if (m_table_cellname != 0 && m_expect_strict_mode >= 0 && ((of == 0) != (m_expect_strict_mode == 0))) {
     warn (tl::to_string (QObject::tr ("CELLNAME offset table has unexpected strict mode")));
   }
 
   of = get_uint ();
   m_table_textstring = get_ulong ();
+  m_strict_tables = m_strict_tables && of != 0;
   if (m_table_textstring != 0 && m_expect_strict_mode >= 0 && ((of == 0) != (m_expect_strict_mode == 0))) {
     warn (tl::to_string (QObject::tr ("TEXTSTRING offset table has unexpected strict mode")));
   }
 
   of = get_uint ();
   m_table_propname = get_ulong ();
+  m_strict_tables = m_strict_tables && of != 0;
   if (m_table_propname != 0 && m_expect_strict_mode >= 0 && ((of == 0) != (m_expect_strict_mode == 0))) {
     warn (tl::to_string (QObject::tr ("PROPNAME offset table has unexpected strict mode")));
   }
 
   of = get_uint ();
   m_table_propstring = get_ulong ();
+  m_strict_tables = m_strict_tables && of != 0;
   if (m_table_propstring != 0 && m_expect_strict_mode >= 0 && ((of == 0) != (m_expect_strict_mode == 0))) {
     warn (tl::to_string (QObject::tr ("PROPSTRING offset table has unexpected strict mode")));
   }
 
   of = get_uint ();
   m_table_layername = get_ulong ();
+  m_strict_tables = m_strict_tables && of != 0;
   if (m_table_layername != 0 && m_expect_strict_mode >= 0 && ((of == 0) != (m_expect_strict_mode == 0))) {
     warn (tl::to_string (QObject::tr ("LAYERNAME offset table has unexpected strict mode")));
   }
@@ -652,23 +1107,17 @@ OASISReader::read_offset_table ()
 
 static const char magic_bytes[] = { "%SEMI-OASIS\015\012" };
 
-void 
-OASISReader::do_read (db::Layout &layout)
+bool
+OASISReader::read_header (db::Layout &layout)
 {
-  tl::SelfTimer timer (tl::verbosity () >= 31, "File read");
-
   unsigned char r;
   char *mb;
 
-  //  prepare
-  m_s_gds_property_name_id = layout.properties_repository ().prop_name_id ("S_GDS_PROPERTY");
-  m_klayout_context_property_name_id = layout.properties_repository ().prop_name_id ("KLAYOUT_CONTEXT");
-
   //  read magic bytes
   mb = (char *) m_stream.get (sizeof (magic_bytes) - 1);
   if (! mb) {
     error (tl::to_string (QObject::tr ("File too short")));
-    return;
+    return false;
   }
   if (strncmp (mb, magic_bytes, sizeof (magic_bytes) - 1) != 0) {
     error (tl::to_string (QObject::tr ("Format error (missing magic bytes)")));
@@ -700,6 +1149,12 @@ OASISReader::do_read (db::Layout &layout)
     read_offset_table ();
   }
 
+  return table_offsets_at_end;
+}
+
+void
+OASISReader::reset_tables ()
+{
   //  reset the strict mode checking locations
   m_first_cellname = 0;
   m_first_propname = 0;
@@ -713,18 +1168,15 @@ OASISReader::do_read (db::Layout &layout)
   m_table_textstring = 0;
   m_table_layername = 0;
 
-  //  define the name id counters
-  unsigned long cellname_id = 0;
-  unsigned long textstring_id = 0;
-  unsigned long propstring_id = 0;
-  unsigned long propname_id = 0;
-
-  //  id mode (explicit or implicit)
-  enum id_mode { any, expl, impl };
-  id_mode cellname_id_mode = any;
-  id_mode textstring_id_mode = any;
-  id_mode propstring_id_mode = any;
-  id_mode propname_id_mode = any;
+  //  reset the name id counters and the id modes
+  m_cellname_id = 0;
+  m_textstring_id = 0;
+  m_propstring_id = 0;
+  m_propname_id = 0;
+  m_cellname_id_mode = AnyId;
+  m_textstring_id_mode = AnyId;
+  m_propstring_id_mode = AnyId;
+  m_propname_id_mode = AnyId;
 
   m_cellnames.clear ();
   m_cellname_properties.clear ();
@@ -740,14 +1192,198 @@ OASISReader::do_read (db::Layout &layout)
   m_instances.clear ();
   m_instances_with_props.clear ();
 
-  db::PropertiesRepository::properties_set layout_properties;
+  m_layout_properties.clear ();
+}
 
-  mark_start_table ();
+void
+OASISReader::flush_layout_properties (db::Layout &layout)
+{
+  if (! m_layout_properties.empty ()) {
+    layout.prop_id (layout.properties_repository ().properties_id (m_layout_properties));
+    m_layout_properties.clear ();
+  }
+}
+
+void 
+OASISReader::do_read (db::Layout &layout)
+{
+  tl::SelfTimer timer (tl::verbosity () >= 31, "File read");
+
+  char *mb;
+
+  //  prepare
+  m_s_gds_property_name_id = layout.properties_repository ().prop_name_id ("S_GDS_PROPERTY");
+  m_klayout_context_property_name_id = layout.properties_repository ().prop_name_id ("KLAYOUT_CONTEXT");
+
+  bool table_offsets_at_end = read_header (layout);
+
+  reset_tables ();
+
+  //  set up the parallel cell decoder if requested and possible
+  std::auto_ptr<OASISCellDecoderJob> decoder_job;
+  if (m_threads > 0 && m_stream.is_mapped ()) {
+    decoder_job.reset (new OASISCellDecoderJob (int (m_threads), this));
+    if (decoder_job->prepare (layout)) {
+      decoder_job->run ();
+    } else {
+      decoder_job.reset (0);
+    }
+  }
+
+  mp_decoder_job = decoder_job.get ();
+
+  try {
+    mark_start_table ();
+    read_records (layout, false);
+  } catch (...) {
+    mp_decoder_job = 0;
+    throw;
+  }
+
+  mp_decoder_job = 0;
+  decoder_job.reset (0);
+
+  flush_layout_properties (layout);
+
+  size_t pt = m_stream.pos ();
+
+  if (table_offsets_at_end) {
+    read_offset_table ();
+  }
+
+  //  read over tail and discard
+  mb = (char *) m_stream.get (pt + 254 - m_stream.pos ());
+  if (! mb) {
+    error (tl::to_string (QObject::tr ("Format error (too few bytes after END record)")));
+  }
+
+  //  check if there are no more bytes
+  mb = (char *) m_stream.get (254);
+  if (mb) {
+    error (tl::to_string (QObject::tr ("Format error (too many bytes after END record)")));
+  }
+
+  for (std::map <unsigned long, const db::StringRef *>::const_iterator fw = m_text_forward_references.begin (); fw != m_text_forward_references.end (); ++fw) {
+    std::map <unsigned long, std::string>::const_iterator ts = m_textstrings.find (fw->first);
+    if (ts == m_textstrings.end ()) {
+      error (tl::sprintf (tl::to_string (QObject::tr ("No text string defined for text string id %ld")), fw->first));
+    } else {
+      layout.string_repository ().change_string_ref (fw->second, ts->second);
+    }
+  }
+
+  //  all forward references to property names must be resolved
+  for (std::map <unsigned long, db::property_names_id_type>::const_iterator fw = m_propname_forward_references.begin (); fw != m_propname_forward_references.end (); ++fw) {
+    error (tl::sprintf (tl::to_string (QObject::tr ("No property name defined for property name id %ld")), fw->first));
+  }
+
+  //  all forward references to property value string id's must be resolved
+  for (std::set <unsigned long>::const_iterator fw = m_propvalue_forward_references.begin (); fw != m_propvalue_forward_references.end (); ++fw) {
+    error (tl::sprintf (tl::to_string (QObject::tr ("No property value defined for property value id %ld")), *fw));
+  }
+
+  for (std::map <unsigned long, db::cell_index_type>::const_iterator fw = m_forward_references.begin (); fw != m_forward_references.end (); ++fw) {
+
+    std::map <unsigned long, std::string>::const_iterator cn = m_cellnames.find (fw->first);
+    if (cn == m_cellnames.end ()) {
+
+      error (tl::sprintf (tl::to_string (QObject::tr ("No cellname defined for cell name id %ld")), fw->first));
+
+    } else {
+
+      std::pair<bool, db::cell_index_type> c = layout.cell_by_name (cn->second.c_str ()); 
+      if (c.first) {
+
+        //  needed, since we have disabled updates
+        layout.force_update ();
+
+        //  add-on reading of forward-referenced cell: need to copy the new cell to the original one plus 
+        //  change instances of the new cell and delete the new cell then.
+
+        const db::Cell &new_cell = layout.cell (fw->second);
+        db::Cell &org_cell = layout.cell (c.second);
+
+        //  copy over the instances
+        for (db::Cell::const_iterator i = new_cell.begin (); ! i.at_end (); ++i) {
+          org_cell.insert (*i);
+        }
+
+        //  copy over the shapes
+        for (unsigned int l = 0; l < layout.layers (); ++l) {
+          if (layout.is_valid_layer (l) && ! new_cell.shapes (l).empty ()) {
+            org_cell.shapes (l).insert (new_cell.shapes (l));
+          }
+        }
+
+        //  replace all instances of the new cell with the original one
+        std::vector<std::pair<db::cell_index_type, db::Instance> > parents;
+        for (db::Cell::parent_inst_iterator pi = new_cell.begin_parent_insts (); ! pi.at_end (); ++pi) {
+          parents.push_back (std::make_pair (pi->parent_cell_index (), pi->child_inst ()));
+        }
+
+        for (std::vector<std::pair<db::cell_index_type, db::Instance> >::const_iterator p = parents.begin (); p != parents.end (); ++p) {
+          db::CellInstArray ia = p->second.cell_inst ();
+          ia.object ().cell_index (org_cell.cell_index ());
+          layout.cell (p->first).replace (p->second, ia);
+        }
+
+        //  finally delete the new cell
+        layout.delete_cell (new_cell.cell_index ());
+
+      } else {
+        layout.rename_cell (fw->second, cn->second.c_str ());
+      }
+
+    }
+
+  }
+
+  //  attach the properties found in CELLNAME to the cells (which may have other properties)
+  for (std::map<unsigned long, db::properties_id_type>::const_iterator p = m_cellname_properties.begin (); p != m_cellname_properties.end (); ++p) {
+
+    std::map <unsigned long, db::cell_index_type>::const_iterator c = m_cells_by_id.find (p->first);
+    if (c != m_cells_by_id.end ()) {
+
+      db::PropertiesRepository::properties_set cnp = layout.properties_repository ().properties (p->second);
+
+      //  Merge existing properties with the ones from CELLNAME
+      db::Cell &cell = layout.cell (c->second);
+      if (cell.prop_id () != 0) {
+        db::PropertiesRepository::properties_set cp = layout.properties_repository ().properties (cell.prop_id ());
+        cnp.insert (cp.begin (), cp.end ());
+      }
+
+      cell.prop_id (layout.properties_repository ().properties_id (cnp));
+
+    }
+
+  }
+
+  //  Check the table offsets vs. real occurance
+  if (m_first_cellname != 0 && m_first_cellname != m_table_cellname && m_expect_strict_mode == 1) {
+    warn (tl::to_string (QObject::tr ("CELLNAME table offset does not match first occurance of CELLNAME in strict mode - %1 vs. %2").arg (m_table_cellname).arg (m_first_cellname)));
+  }
+  if (m_first_propname != 0 && m_first_propname != m_table_propname && m_expect_strict_mode == 1) {
+    warn (tl::to_string (QObject::tr ("PROPNAME table offset does not match first occurance of PROPNAME in strict mode - %1 vs. %2").arg (m_table_propname).arg (m_first_propname)));
+  }
+  if (m_first_propstring != 0 && m_first_propstring != m_table_propstring && m_expect_strict_mode == 1) {
+    warn (tl::to_string (QObject::tr ("PROPSTRING table offset does not match first occurance of PROPSTRING in strict mode - %1 vs. %2").arg (m_table_propstring).arg (m_first_propstring)));
+  }
+  if (m_first_layername != 0 && m_first_layername != m_table_layername && m_expect_strict_mode == 1) {
+    warn (tl::to_string (QObject::tr ("LAYERNAME table offset does not match first occurance of LAYERNAME in strict mode - %1 vs. %2").arg (m_table_layername).arg (m_first_layername)));
+  }
+  if (m_first_textstring != 0 && m_first_textstring != m_table_textstring && m_expect_strict_mode == 1) {
+    warn (tl::to_string (QObject::tr ("TEXTSTRING table offset does not match first occurance of TEXTSTRING in strict mode - %1 vs. %2").arg (m_table_textstring).arg (m_first_textstring)));
+  }
+}
 
+void
+OASISReader::read_records (db::Layout &layout, bool tables_only)
+{
   //  read next record
   while (true) {
 
-    r = get_byte ();
+    unsigned char r = get_byte ();
 
     if (r == 0 /*PAD*/) {
 
@@ -757,6 +1393,9 @@ OASISReader::do_read (db::Layout &layout)
     } else if (r == 2 /*END*/) {
 
       //  done
+      if (tables_only) {
+        m_stream.unget (1);
+      }
       break;
 
     } else if (r == 3 || r == 4 /*CELLNAME*/) {
@@ -769,27 +1408,24 @@ OASISReader::do_read (db::Layout &layout)
       m_in_table = InCELLNAME;
 
       //  there cannot be more file level properties .. store what we have
-      if (! layout_properties.empty ()) {
-        layout.prop_id (layout.properties_repository ().properties_id (layout_properties));
-        layout_properties.clear ();
-      }
+      flush_layout_properties (layout);
 
       //  read a cell name
       std::string name = get_str ();
 
       //  and the associated id
-      unsigned long id = cellname_id;
+      unsigned long id = m_cellname_id;
       if (r == 3) {
-        if (cellname_id_mode == expl) {
+        if (m_cellname_id_mode == ExplicitId) {
           error (tl::to_string (QObject::tr ("Explicit and implicit CELLNAME modes cannot be mixed")));
         }
-        cellname_id_mode = impl;
-        ++cellname_id;
+        m_cellname_id_mode = ImplicitId;
+        ++m_cellname_id;
       } else {
-        if (cellname_id_mode == impl) {
+        if (m_cellname_id_mode == ImplicitId) {
           error (tl::to_string (QObject::tr ("Explicit and implicit CELLNAME modes cannot be mixed")));
         }
-        cellname_id_mode = expl;
+        m_cellname_id_mode = ExplicitId;
         get (id);
       }
 
@@ -815,27 +1451,24 @@ OASISReader::do_read (db::Layout &layout)
 
 
       //  there cannot be more file level properties .. store what we have
-      if (! layout_properties.empty ()) {
-        layout.prop_id (layout.properties_repository ().properties_id (layout_properties));
-        layout_properties.clear ();
-      }
+      flush_layout_properties (layout);
 
       //  read a text string
       std::string name = get_str ();
 
       //  and the associated id
-      unsigned long id = textstring_id;
+      unsigned long id = m_textstring_id;
       if (r == 5) {
-        if (textstring_id_mode == expl) {
+        if (m_textstring_id_mode == ExplicitId) {
           error (tl::to_string (QObject::tr ("Explicit and implicit TEXTSTRING modes cannot be mixed")));
         }
-        textstring_id_mode = impl;
-        ++textstring_id;
+        m_textstring_id_mode = ImplicitId;
+        ++m_textstring_id;
       } else {
-        if (textstring_id_mode == impl) {
+        if (m_textstring_id_mode == ImplicitId) {
           error (tl::to_string (QObject::tr ("Explicit and implicit TEXTSTRING modes cannot be mixed")));
         }
-        textstring_id_mode = expl;
+        m_textstring_id_mode = ExplicitId;
         get (id);
       }
 
@@ -858,27 +1491,24 @@ OASISReader::do_read (db::Layout &layout)
       m_in_table = InPROPNAME;
 
       //  there cannot be more file level properties .. store what we have
-      if (! layout_properties.empty ()) {
-        layout.prop_id (layout.properties_repository ().properties_id (layout_properties));
-        layout_properties.clear ();
-      }
+      flush_layout_properties (layout);
 
       //  read a property name
       std::string name = get_str ();
 
       //  and the associated id
-      unsigned long id = propname_id;
+      unsigned long id = m_propname_id;
       if (r == 7) {
-        if (propname_id_mode == expl) {
+        if (m_propname_id_mode == ExplicitId) {
           error (tl::to_string (QObject::tr ("Explicit and implicit PROPNAME modes cannot be mixed")));
         }
-        propname_id_mode = impl;
-        ++propname_id;
+        m_propname_id_mode = ImplicitId;
+        ++m_propname_id;
       } else {
-        if (propname_id_mode == impl) {
+        if (m_propname_id_mode == ImplicitId) {
           error (tl::to_string (QObject::tr ("Explicit and implicit PROPNAME modes cannot be mixed")));
         }
-        propname_id_mode = expl;
+        m_propname_id_mode = ExplicitId;
         get (id);
       }
 
@@ -950,27 +1580,24 @@ OASISReader::do_read (db::Layout &layout)
       m_in_table = InPROPSTRING;
 
       //  there cannot be more file level properties .. store what we have
-      if (! layout_properties.empty ()) {
-        layout.prop_id (layout.properties_repository ().properties_id (layout_properties));
-        layout_properties.clear ();
-      }
+      flush_layout_properties (layout);
 
       //  read a property string
       std::string name = get_str ();
 
       //  and the associated id
-      unsigned long id = propstring_id;
+      unsigned long id = m_propstring_id;
       if (r == 9) {
-        if (propstring_id_mode == expl) {
+        if (m_propstring_id_mode == ExplicitId) {
           error (tl::to_string (QObject::tr ("Explicit and implicit PROPSTRING modes cannot be mixed")));
         }
-        propstring_id_mode = impl;
-        ++propstring_id;
+        m_propstring_id_mode = ImplicitId;
+        ++m_propstring_id;
       } else {
-        if (propstring_id_mode == impl) {
+        if (m_propstring_id_mode == ImplicitId) {
           error (tl::to_string (QObject::tr ("Explicit and implicit PROPSTRING modes cannot be mixed")));
         }
-        propstring_id_mode = expl;
+        m_propstring_id_mode = ExplicitId;
         get (id);
       }
 
@@ -1040,10 +1667,7 @@ OASISReader::do_read (db::Layout &layout)
       m_in_table = InLAYERNAME;
 
       //  there cannot be more file level properties .. store what we have
-      if (! layout_properties.empty ()) {
-        layout.prop_id (layout.properties_repository ().properties_id (layout_properties));
-        layout_properties.clear ();
-      }
+      flush_layout_properties (layout);
 
       //  read a layer name 
       std::string name = get_str ();
@@ -1118,17 +1742,14 @@ OASISReader::do_read (db::Layout &layout)
         read_properties (layout.properties_repository ());
       }
 
-      store_last_properties (layout.properties_repository (), layout_properties, true);
+      store_last_properties (layout.properties_repository (), m_layout_properties, true);
 
       mark_start_table ();
 
     } else if (r == 30 || r == 31 /*XNAME*/) {
 
       //  there cannot be more file level properties .. store what we have
-      if (! layout_properties.empty ()) {
-        layout.prop_id (layout.properties_repository ().properties_id (layout_properties));
-        layout_properties.clear ();
-      }
+      flush_layout_properties (layout);
 
       //  read a XNAME: it is simply ignored
       get_ulong ();
@@ -1144,20 +1765,22 @@ OASISReader::do_read (db::Layout &layout)
 
     } else if (r == 13 || r == 14 /*CELL*/) {
 
+      if (tables_only) {
+        m_stream.unget (1);
+        break;
+      }
+
       m_in_table = NotInTable;
 
       //  there cannot be more file level properties .. store what we have
-      if (! layout_properties.empty ()) {
-        layout.prop_id (layout.properties_repository ().properties_id (layout_properties));
-        layout_properties.clear ();
-      }
+      flush_layout_properties (layout);
 
       db::cell_index_type cell_index = 0;
+      unsigned long id = 0;
 
       //  read a cell
       if (r == 13) {
 
-        unsigned long id = 0;
         get (id);
         if (! m_defined_cells_by_id.insert (id).second) {
           error (tl::sprintf (tl::to_string (QObject::tr ("A cell with id %ld is defined already")), id));
@@ -1234,7 +1857,18 @@ OASISReader::do_read (db::Layout &layout)
       reset_modal_variables ();
       mark_start_table ();
 
-      do_read_cell (cell_index, layout);
+      //  take the cell from the parallel decoder if it has been decoded already
+      OASISDecodedCell *dc = 0;
+      if (mp_decoder_job && r == 13 && ! m_stream.is_inflating ()) {
+        dc = mp_decoder_job->fetch (id, m_stream.pos ());
+      }
+
+      if (dc) {
+        merge_decoded_cell (*dc, cell_index, layout);
+        mp_decoder_job->release (dc);
+      } else {
+        do_read_cell (cell_index, layout);
+      }
 
     } else if (r == 34 /*CBLOCK*/) {
 
@@ -1249,147 +1883,15 @@ OASISReader::do_read (db::Layout &layout)
       //  put the stream into deflating mode
       m_stream.inflate ();
 
+    } else if (tables_only) {
+      m_stream.unget (1);
+      break;
     } else {
       error (tl::sprintf (tl::to_string (QObject::tr ("Invalid record type on global level %d")), int (r)));
     }
 
   }
 
-  if (! layout_properties.empty ()) {
-    layout.prop_id (layout.properties_repository ().properties_id (layout_properties));
-    layout_properties.clear ();
-  }
-
-  size_t pt = m_stream.pos ();
-
-  if (table_offsets_at_end) {
-    read_offset_table ();
-  }
-
-  //  read over tail and discard
-  mb = (char *) m_stream.get (pt + 254 - m_stream.pos ());
-  if (! mb) {
-    error (tl::to_string (QObject::tr ("Format error (too few bytes after END record)")));
-  }
-
-  //  check if there are no more bytes
-  mb = (char *) m_stream.get (254);
-  if (mb) {
-    error (tl::to_string (QObject::tr ("Format error (too many bytes after END record)")));
-  }
-
-  for (std::map <unsigned long, const db::StringRef *>::const_iterator fw = m_text_forward_references.begin (); fw != m_text_forward_references.end (); ++fw) {
-    std::map <unsigned long, std::string>::const_iterator ts = m_textstrings.find (fw->first);
-    if (ts == m_textstrings.end ()) {
-      error (tl::sprintf (tl::to_string (QObject::tr ("No text string defined for text string id %ld")), fw->first));
-    } else {
-      layout.string_repository ().change_string_ref (fw->second, ts->second);
-    }
-  }
-
-  //  all forward references to property names must be resolved
-  for (std::map <unsigned long, db::property_names_id_type>::const_iterator fw = m_propname_forward_references.begin (); fw != m_propname_forward_references.end (); ++fw) {
-    error (tl::sprintf (tl::to_string (QObject::tr ("No property name defined for property name id %ld")), fw->first));
-  }
-
-  //  all forward references to property value string id's must be resolved
-  for (std::set <unsigned long>::const_iterator fw = m_propvalue_forward_references.begin (); fw != m_propvalue_forward_references.end (); ++fw) {
-    error (tl::sprintf (tl::to_string (QObject::tr ("No property value defined for property value id %ld")), *fw));
-  }
-
-  for (std::map <unsigned long, db::cell_index_type>::const_iterator fw = m_forward_references.begin (); fw != m_forward_references.end (); ++fw) {
-
-    std::map <unsigned long, std::string>::const_iterator cn = m_cellnames.find (fw->first);
-    if (cn == m_cellnames.end ()) {
-
-      error (tl::sprintf (tl::to_string (QObject::tr ("No cellname defined for cell name id %ld")), fw->first));
-
-    } else {
-
-      std::pair<bool, db::cell_index_type> c = layout.cell_by_name (cn->second.c_str ()); 
-      if (c.first) {
-
-        //  needed, since we have disabled updates
-        layout.force_update ();
-
-        //  add-on reading of forward-referenced cell: need to copy the new cell to the original one plus 
-        //  change instances of the new cell and delete the new cell then.
-
-        const db::Cell &new_cell = layout.cell (fw->second);
-        db::Cell &org_cell = layout.cell (c.second);
-
-        //  copy over the instances
-        for (db::Cell::const_iterator i = new_cell.begin (); ! i.at_end (); ++i) {
-          org_cell.insert (*i);
-        }
-
-        //  copy over the shapes
-        for (unsigned int l = 0; l < layout.layers (); ++l) {
-          if (layout.is_valid_layer (l) && ! new_cell.shapes (l).empty ()) {
-            org_cell.shapes (l).insert (new_cell.shapes (l));
-          }
-        }
-
-        //  replace all instances of the new cell with the original one
-        std::vector<std::pair<db::cell_index_type, db::Instance> > parents;
-        for (db::Cell::parent_inst_iterator pi = new_cell.begin_parent_insts (); ! pi.at_end (); ++pi) {
-          parents.push_back (std::make_pair (pi->parent_cell_index (), pi->child_inst ()));
-        }
-
-        for (std::vector<std::pair<db::cell_index_type, db::Instance> >::const_iterator p = parents.begin (); p != parents.end (); ++p) {
-          db::CellInstArray ia = p->second.cell_inst ();
-          ia.object ().cell_index (org_cell.cell_index ());
-          layout.cell (p->first).replace (p->second, ia);
-        }
-
-        //  finally delete the new cell
-        layout.delete_cell (new_cell.cell_index ());
-
-      } else {
-        layout.rename_cell (fw->second, cn->second.c_str ());
-      }
-
-    }
-
-  }
-
-  //  attach the properties found in CELLNAME to the cells (which may have other properties)
-  for (std::map<unsigned long, db::properties_id_type>::const_iterator p = m_cellname_properties.begin (); p != m_cellname_properties.end (); ++p) {
-
-    std::map <unsigned long, db::cell_index_type>::const_iterator c = m_cells_by_id.find (p->first);
-    if (c != m_cells_by_id.end ()) {
-
-      db::PropertiesRepository::properties_set cnp = layout.properties_repository ().properties (p->second);
-
-      //  Merge existing properties with the ones from CELLNAME
-      db::Cell &cell = layout.cell (c->second);
-      if (cell.prop_id () != 0) {
-        db::PropertiesRepository::properties_set cp = layout.properties_repository ().properties (cell.prop_id ());
-        cnp.insert (cp.begin (), cp.end ());
-      }
-
-      cell.prop_id (layout.properties_repository ().properties_id (cnp));
-
-    }
-
-  }
-
-  //  Check the table offsets vs. real occurance
-  if (m_first_cellname != 0 && m_first_cellname != m_table_cellname && m_expect_strict_mode == 1) {
-    warn (tl::to_string (QObject::tr ("CELLNAME table offset does not match first occurance of CELLNAME in strict mode - %1 vs. %2").arg (m_table_cellname).arg (m_first_cellname)));
-  }
-  if (m_first_propname != 0 && m_first_propname != m_table_propname && m_expect_strict_mode == 1) {
-    warn (tl::to_string (QObject::tr ("PROPNAME table offset does not match first occurance of PROPNAME in strict mode - %1 vs. %2").arg (m_table_propname).arg (m_first_propname)));
-  }
-  if (m_first_propstring != 0 && m_first_propstring != m_table_propstring && m_expect_strict_mode == 1) {
-    warn (tl::to_string (QObject::tr ("PROPSTRING table offset does not match first occurance of PROPSTRING in strict mode - %1 vs. %2").arg (m_table_propstring).arg (m_first_propstring)));
-  }
-  if (m_first_layername != 0 && m_first_layername != m_table_layername && m_expect_strict_mode == 1) {
-    warn (tl::to_string (QObject::tr ("LAYERNAME table offset does not match first occurance of LAYERNAME in strict mode - %1 vs. %2").arg (m_table_layername).arg (m_first_layername)));
-  }
-  if (m_first_textstring != 0 && m_first_textstring != m_table_textstring && m_expect_strict_mode == 1) {
-    warn (tl::to_string (QObject::tr ("TEXTSTRING table offset does not match first occurance of TEXTSTRING in strict mode - %1 vs. %2").arg (m_table_textstring).arg (m_first_textstring)));
-  }
 }
 
 void
@@ -3520,6 +4022,23 @@ OASISReader::do_read_cell (db::cell_index_type cell_index, db::Layout &layout)
     layout.cell (cell_index).prop_id (layout.properties_repository ().properties_id (cell_properties));
   }
 
+  if (mp_decoded_cell) {
+
+    //  When decoding in parallel, the instances refer to cells of the target layout and the proxy 
+    //  needs to be restored inside the target layout. Both is done when the cell is merged.
+    mp_decoded_cell->instances.swap (m_instances);
+    mp_decoded_cell->instances_with_props.swap (m_instances_with_props);
+    mp_decoded_cell->has_context = has_context;
+    mp_decoded_cell->context_strings.swap (context_strings);
+
+    m_instances.clear ();
+    m_instances_with_props.clear ();
+
+    m_cellname = "";
+    return;
+
+  }
+
   //  insert all instances collected (inserting them once is 
   //  more effective than doing this every time)
   if (! m_instances.empty ()) {
@@ -3543,5 +4062,210 @@ OASISReader::do_read_cell (db::cell_index_type cell_index, db::Layout &layout)
   m_cellname = "";
 }
 
+bool
+OASISReader::prescan (db::Layout &layout, std::vector<std::pair<size_t, unsigned long> > &cells)
+{
+  m_s_gds_property_name_id = layout.properties_repository ().prop_name_id ("S_GDS_PROPERTY");
+  m_klayout_context_property_name_id = layout.properties_repository ().prop_name_id ("KLAYOUT_CONTEXT");
+
+  m_strict_tables = false;
+
+  bool table_offsets_at_end = read_header (layout);
+  if (table_offsets_at_end) {
+
+    //  the END record is located 256 bytes before the end of the file
+    size_t length = 0;
+    m_stream.mapped_block (length);
+    if (length < 256) {
+      return false;
+    }
+
+    m_stream.reset ();
+    m_stream.get (length - 256);
+    if (get_byte () != 2 /*END*/) {
+      return false;
+    }
+
+    read_offset_table ();
+
+  }
+
+  //  the name tables need to be complete to decode the cells independently
+  if (! m_strict_tables || m_table_cellname == 0) {
+    return false;
+  }
+
+  std::vector<size_t> tables;
+  size_t table_offsets[] = { m_table_cellname, m_table_textstring, m_table_propname, m_table_propstring, m_table_layername };
+  for (unsigned int i = 0; i < sizeof (table_offsets) / sizeof (table_offsets [0]); ++i) {
+    if (table_offsets [i] != 0) {
+      tables.push_back (table_offsets [i]);
+    }
+  }
+
+  std::sort (tables.begin (), tables.end ());
+
+  reset_tables ();
+
+  //  read the tables: consecutive tables are read in one pass
+  size_t covered = 0;
+  for (std::vector<size_t>::const_iterator t = tables.begin (); t != tables.end (); ++t) {
+    if (*t >= covered) {
+      m_stream.reset ();
+      m_stream.get (*t);
+      mark_start_table ();
+      read_records (layout, true);
+      covered = m_stream.pos ();
+    }
+  }
+
+  //  collect the cell offsets from the S_CELL_OFFSET properties
+  std::pair<bool, db::property_names_id_type> cell_offset_name_id = layout.properties_repository ().get_id_of_name (tl::Variant ("S_CELL_OFFSET"));
+  if (! cell_offset_name_id.first) {
+    return false;
+  }
+
+  for (std::map<unsigned long, db::properties_id_type>::const_iterator p = m_cellname_properties.begin (); p != m_cellname_properties.end (); ++p) {
+
+    const db::PropertiesRepository::properties_set &props = layout.properties_repository ().properties (p->second);
+    db::PropertiesRepository::properties_set::const_iterator o = props.find (cell_offset_name_id.second);
+    if (o == props.end () || m_cellnames.find (p->first) == m_cellnames.end ()) {
+      continue;
+    }
+
+    size_t pos = o->second.to_ulong ();
+    if (pos == 0) {
+      continue;
+    }
+
+    //  check, whether the offset points to the CELL record
+    m_stream.reset ();
+    if (! m_stream.get (pos) || get_byte () != 13 /*CELL*/ || get_ulong () != p->first) {
+      return false;
+    }
+
+    cells.push_back (std::make_pair (pos, p->first));
+
+  }
+
+  std::sort (cells.begin (), cells.end ());
+
+  return ! cells.empty ();
+}
+
+void
+OASISReader::decode_cell (OASISDecodedCell &dc, bool editable)
+{
+  size_t n_cells_by_id = m_cells_by_id.size ();
+  size_t n_cells_by_name = m_cells_by_name.size ();
+
+  //  NOTE: the layout needs to have the same mode than the target layout, so the shapes are stored the same way
+  dc.layout = new db::Layout (editable);
+  dc.layout->dbu (m_dbu * 1e6);
+  dc.cell_index = dc.layout->add_cell (m_cellnames [dc.id].c_str ());
+
+  m_s_gds_property_name_id = dc.layout->properties_repository ().prop_name_id ("S_GDS_PROPERTY");
+  m_klayout_context_property_name_id = dc.layout->properties_repository ().prop_name_id ("KLAYOUT_CONTEXT");
+
+  m_layer_map = LayerMap ();
+  m_layers_created.clear ();
+
+  mp_decoded_cell = &dc;
+  mp_warnings = &dc.warnings;
+
+  m_stream.reset ();
+  m_stream.get (dc.pos);
+  if (get_byte () != 13 /*CELL*/ || get_ulong () != dc.id) {
+    error (tl::to_string (QObject::tr ("Cell offset does not point to the CELL record")));
+  }
+
+  dc.start_pos = m_stream.pos ();
+
+  reset_modal_variables ();
+  mark_start_table ();
+
+  do_read_cell (dc.cell_index, *dc.layout);
+
+  mp_decoded_cell = 0;
+  mp_warnings = 0;
+
+  //  The cell can only be merged if it does not need any information from outside
+  //  and if it does not end inside a CBLOCK.
+  if (! m_forward_references.empty () || ! m_text_forward_references.empty () || 
+      ! m_propname_forward_references.empty () || ! m_propvalue_forward_references.empty () ||
+      m_cells_by_id.size () != n_cells_by_id || m_cells_by_name.size () != n_cells_by_name) {
+    error (tl::to_string (QObject::tr ("Cell cannot be decoded independently")));
+  }
+
+  if (m_stream.is_inflating ()) {
+    error (tl::to_string (QObject::tr ("Cell does not end at a CBLOCK boundary")));
+  }
+
+  dc.end_pos = m_stream.pos ();
+}
+
+void
+OASISReader::merge_decoded_cell (OASISDecodedCell &dc, db::cell_index_type cell_index, db::Layout &layout)
+{
+  m_cellname = layout.cell_name (cell_index);
+
+  const db::Layout &source_layout = *dc.layout;
+  const db::Cell &source_cell = source_layout.cell (dc.cell_index);
+  db::Cell &cell = layout.cell (cell_index);
+
+  db::PropertyMapper pm (layout, source_layout);
+
+  //  The layers of the decoder's layout are created in the order they appear in the cell.
+  //  Hence this will create the layers in the same order than reading the cell directly.
+  for (unsigned int l = 0; l < source_layout.layers (); ++l) {
+    if (source_layout.is_valid_layer (l)) {
+      const db::LayerProperties &lp = source_layout.get_properties (l);
+      std::pair<bool, unsigned int> ll = open_dl (layout, LDPair (lp.layer, lp.datatype), m_create_layers);
+      if (ll.first && ! source_cell.shapes (l).empty ()) {
+        cell.shapes (ll.second).insert (source_cell.shapes (l), pm);
+      }
+    }
+  }
+
+  if (source_cell.prop_id () != 0) {
+    cell.prop_id (pm (source_cell.prop_id ()));
+  }
+
+  //  translate the instances into the target layout's array repository
+  if (! dc.instances.empty ()) {
+    m_instances.reserve (dc.instances.size ());
+    for (tl::vector<db::CellInstArray>::const_iterator i = dc.instances.begin (); i != dc.instances.end (); ++i) {
+      m_instances.push_back (db::CellInstArray (*i, &layout.array_repository ()));
+    }
+    cell.insert (m_instances.begin (), m_instances.end ());
+    m_instances.clear ();
+  }
+
+  if (! dc.instances_with_props.empty ()) {
+    m_instances_with_props.reserve (dc.instances_with_props.size ());
+    for (tl::vector<db::CellInstArrayWithProperties>::const_iterator i = dc.instances_with_props.begin (); i != dc.instances_with_props.end (); ++i) {
+      m_instances_with_props.push_back (db::CellInstArrayWithProperties (db::CellInstArray (*i, &layout.array_repository ()), pm (i->properties_id ())));
+    }
+    cell.insert (m_instances_with_props.begin (), m_instances_with_props.end ());
+    m_instances_with_props.clear ();
+  }
+
+  //  Restore proxy cell (link to PCell or Library)
+  if (dc.has_context) {
+    OASISReaderLayerMapping layer_mapping (this, &layout, m_create_layers);
+    layout.recover_proxy_as (cell_index, dc.context_strings.begin (), dc.context_strings.end (), &layer_mapping);
+  }
+
+  for (std::vector<std::string>::const_iterator w = dc.warnings.begin (); w != dc.warnings.end (); ++w) {
+    tl::warn << *w;
+  }
+
+  m_cellname = "";
+
+  //  skip the cell's records
+  m_stream.get (dc.end_pos - m_stream.pos ());
+  mark_start_table ();
+  m_progress.set (m_stream.pos ());
 }
 
+}
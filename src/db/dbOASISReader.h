@@ -44,6 +44,10 @@
 namespace db
 {
 
+class OASISCellDecoderJob;
+class OASISCellDecoderWorker;
+struct OASISDecodedCell;
+
 /**
  *  @brief Generic base class of OASIS reader exceptions
  */
@@ -67,7 +71,7 @@ public:
    *  @brief The constructor
    */
   OASISReaderOptions ()
-    : read_all_properties (false), expect_strict_mode (-1)
+    : read_all_properties (false), expect_strict_mode (-1), threads (0)
   {
     //  .. nothing yet ..
   }
@@ -94,6 +98,19 @@ public:
    */
   int expect_strict_mode;
 
+  /**
+   *  @brief The number of threads to use for decoding the cells
+   *
+   *  If a value larger than 0 is given and the file is a strict-mode file with
+   *  S_CELL_OFFSET properties on the CELLNAME records, the cells are decoded by the given 
+   *  number of threads in parallel and merged into the layout in file order.
+   *  Files which do not fulfil these requirements are read single-threaded.
+   *  Parallel decoding requires a file which can be mapped into memory (i.e. a plain
+   *  local file).
+   *  A value of 0 (the default) will read the file single-threaded.
+   */
+  unsigned int threads;
+
   /**
    *  @brief Implementation of FormatSpecificReaderOptions
    */
@@ -188,6 +205,8 @@ public:
 
 private:
   friend class OASISReaderLayerMapping;
+  friend class OASISCellDecoderJob;
+  friend class OASISCellDecoderWorker;
 
   enum TableMode
   {
@@ -212,6 +231,7 @@ private:
   size_t m_first_textstring;
   size_t m_first_layername;
   TableMode m_in_table;
+  bool m_strict_tables;
   size_t m_table_cellname;
   size_t m_table_propname;
   size_t m_table_propstring;
@@ -273,8 +293,25 @@ private:
   db::property_names_id_type m_s_gds_property_name_id;
   db::property_names_id_type m_klayout_context_property_name_id;
 
+  enum IdMode { AnyId, ExplicitId, ImplicitId };
+  unsigned long m_cellname_id, m_textstring_id, m_propstring_id, m_propname_id;
+  IdMode m_cellname_id_mode, m_textstring_id_mode, m_propstring_id_mode, m_propname_id_mode;
+  db::PropertiesRepository::properties_set m_layout_properties;
+
+  unsigned int m_threads;
+  OASISCellDecoderJob *mp_decoder_job;
+  OASISDecodedCell *mp_decoded_cell;
+  std::vector<std::string> *mp_warnings;
+
   void do_read (db::Layout &layout);
+  bool read_header (db::Layout &layout);
+  void reset_tables ();
+  void read_records (db::Layout &layout, bool tables_only);
+  void flush_layout_properties (db::Layout &layout);
   void do_read_cell (db::cell_index_type cell_index, db::Layout &layout);
+  bool prescan (db::Layout &layout, std::vector<std::pair<size_t, unsigned long> > &cells);
+  void decode_cell (OASISDecodedCell &dc, bool editable);
+  void merge_decoded_cell (OASISDecodedCell &dc, db::cell_index_type cell_index, db::Layout &layout);
 
   void do_read_placement (unsigned char r,
                           bool xy_absolute,
@@ -26,8 +26,14 @@
 
 #include "tlDeflate.h"
 #include "tlMath.h"
+#include "tlThreadedWorkers.h"
+
+#include <QMutex>
+#include <QWaitCondition>
 
 #include <math.h>
+#include <list>
+#include <memory>
 
 namespace db
 {
@@ -655,6 +661,305 @@ Compressor<Obj>::flush (db::OASISWriter *writer)
   }
 }
 
+// ---------------------------------------------------------------------------------
+//  Output pipeline
+
+/**
+ *  @brief Compresses the given data with RFC1951 deflate
+ */
+static void
+deflate_cblock (const tl::OutputMemoryStream &data, tl::OutputMemoryStream &compressed)
+{
+  tl::OutputStream deflated_stream (compressed);
+  tl::DeflateFilter deflate (deflated_stream);
+
+  deflate.put (data.data (), data.size ());
+  deflate.flush ();
+}
+
+/**
+ *  @brief A piece of output of the pipeline
+ *
+ *  A chunk is either raw data which is written as it is, the contents of a CBLOCK
+ *  which is compressed by one of the pipeline threads or a cell which is encoded by 
+ *  one of the pipeline threads. "positions" holds the variables receiving the stream 
+ *  positions of certain offsets inside raw chunks.
+ */
+struct OASISPipelineChunk
+{
+  enum chunk_type { Raw, CBlock, Cell };
+
+  OASISPipelineChunk (chunk_type _type, db::cell_index_type _cell = 0)
+    : type (_type), cell (_cell), done (_type == Raw)
+  {
+    //  .. nothing yet ..
+  }
+
+  chunk_type type;
+  db::cell_index_type cell;
+  bool done;
+  std::string error;
+  tl::OutputMemoryStream data;
+  tl::OutputMemoryStream compressed;
+  std::vector<std::pair<size_t *, size_t> > positions;
+};
+
+class OASISPipelineTask
+  : public tl::Task
+{
+public:
+  OASISPipelineTask (OASISPipelineChunk *chunk)
+    : mp_chunk (chunk)
+  {
+    //  .. nothing yet ..
+  }
+
+  OASISPipelineChunk *chunk () const
+  {
+    return mp_chunk;
+  }
+
+private:
+  OASISPipelineChunk *mp_chunk;
+};
+
+/**
+ *  @brief The output pipeline
+ *
+ *  This object keeps the output which is pending because of CBLOCKs not compressed yet
+ *  or cells not encoded yet. Only the writing thread manipulates the chunk list. The 
+ *  pipeline threads access the chunks through their tasks and report completion through 
+ *  the "done" flag.
+ *
+ *  Cells are encoded by cell writers which are created from the writer once the 
+ *  property and text string tables are established.
+ */
+class OASISWriterPipeline
+  : public tl::JobBase
+{
+public:
+  OASISWriterPipeline (int nworkers, const OASISWriter *writer)
+    : tl::JobBase (nworkers), mp_writer (writer), m_pending_bytes (0), m_pending_cells (0),
+      m_has_cell_parameters (false)
+  {
+    //  .. nothing yet ..
+  }
+
+  ~OASISWriterPipeline ()
+  {
+    //  stop the workers before the chunks are deleted
+    terminate ();
+
+    for (std::list<OASISPipelineChunk *>::const_iterator c = m_chunks.begin (); c != m_chunks.end (); ++c) {
+      delete *c;
+    }
+    m_chunks.clear ();
+  }
+
+  bool is_empty () const
+  {
+    return m_chunks.empty ();
+  }
+
+  size_t pending_bytes () const
+  {
+    return m_pending_bytes;
+  }
+
+  size_t pending_cells () const
+  {
+    return m_pending_cells;
+  }
+
+  void put (const char *b, size_t n)
+  {
+    raw_chunk ()->data.write (b, n);
+    m_pending_bytes += n;
+  }
+
+  void mark_position (size_t &pos)
+  {
+    OASISPipelineChunk *chunk = raw_chunk ();
+    chunk->positions.push_back (std::make_pair (&pos, chunk->data.size ()));
+  }
+
+  void add_cblock (tl::OutputMemoryStream &data)
+  {
+    OASISPipelineChunk *chunk = new OASISPipelineChunk (OASISPipelineChunk::CBlock);
+    chunk->data.swap (data);
+    m_chunks.push_back (chunk);
+    m_pending_bytes += chunk->data.size ();
+
+    schedule (new OASISPipelineTask (chunk));
+    if (! is_running ()) {
+      start ();
+    }
+  }
+
+  /**
+   *  @brief Sets the parameters for encoding cells
+   *
+   *  This method must be called before cells are added. The pipeline keeps copies
+   *  as the threads may still be busy when the writer leaves with an exception.
+   */
+  void set_cell_parameters (const std::set<db::cell_index_type> &cell_set, const std::vector<std::pair<unsigned int, db::LayerProperties> > &layers)
+  {
+    m_cell_set = cell_set;
+    m_layers = layers;
+    m_has_cell_parameters = true;
+  }
+
+  void add_cell (db::cell_index_type cell)
+  {
+    tl_assert (m_has_cell_parameters);
+
+    OASISPipelineChunk *chunk = new OASISPipelineChunk (OASISPipelineChunk::Cell, cell);
+    m_chunks.push_back (chunk);
+    ++m_pending_cells;
+
+    schedule (new OASISPipelineTask (chunk));
+    if (! is_running ()) {
+      start ();
+    }
+  }
+
+  /**
+   *  @brief Gets the first chunk if it is ready for output
+   *
+   *  If "wait" is true, this method waits until the chunk is compressed or encoded.
+   *  Otherwise 0 is returned if the chunk is not available yet.
+   */
+  OASISPipelineChunk *front (bool wait)
+  {
+    OASISPipelineChunk *chunk = m_chunks.front ();
+
+    QMutexLocker locker (&m_chunks_lock);
+    while (wait && ! chunk->done) {
+      m_chunks_condition.wait (&m_chunks_lock);
+    }
+
+    return chunk->done ? chunk : 0;
+  }
+
+  void pop_front ()
+  {
+    OASISPipelineChunk *chunk = m_chunks.front ();
+    m_chunks.pop_front ();
+    if (chunk->type == OASISPipelineChunk::Cell) {
+      --m_pending_cells;
+    } else {
+      m_pending_bytes -= chunk->data.size ();
+    }
+    delete chunk;
+  }
+
+  void compress (OASISPipelineChunk *chunk)
+  {
+    std::string error;
+
+    try {
+      deflate_cblock (chunk->data, chunk->compressed);
+    } catch (tl::Exception &ex) {
+      error = ex.msg ();
+    } catch (std::exception &ex) {
+      error = ex.what ();
+    } catch (...) {
+      error = tl::to_string (QObject::tr ("Unspecific error"));
+    }
+
+    done (chunk, error);
+  }
+
+  void encode (std::auto_ptr<OASISWriter> &cell_writer, OASISPipelineChunk *chunk)
+  {
+    std::string error;
+
+    try {
+      if (! cell_writer.get ()) {
+        cell_writer.reset (new OASISWriter (mp_writer));
+      }
+      tl::OutputStream stream (chunk->data);
+      cell_writer->encode_cell (stream, chunk->cell, m_cell_set, m_layers);
+    } catch (tl::Exception &ex) {
+      error = ex.msg ();
+    } catch (std::exception &ex) {
+      error = ex.what ();
+    } catch (...) {
+      error = tl::to_string (QObject::tr ("Unspecific error"));
+    }
+
+    done (chunk, error);
+  }
+
+  virtual tl::Worker *create_worker ();
+
+private:
+  const OASISWriter *mp_writer;
+  std::list<OASISPipelineChunk *> m_chunks;
+  size_t m_pending_bytes, m_pending_cells;
+  std::set<db::cell_index_type> m_cell_set;
+  std::vector<std::pair<unsigned int, db::LayerProperties> > m_layers;
+  bool m_has_cell_parameters;
+  QMutex m_chunks_lock;
+  QWaitCondition m_chunks_condition;
+
+  OASISPipelineChunk *raw_chunk ()
+  {
+    if (m_chunks.empty () || m_chunks.back ()->type != OASISPipelineChunk::Raw) {
+      m_chunks.push_back (new OASISPipelineChunk (OASISPipelineChunk::Raw));
+    }
+    return m_chunks.back ();
+  }
+
+  void done (OASISPipelineChunk *chunk, const std::string &error)
+  {
+    QMutexLocker locker (&m_chunks_lock);
+    chunk->error = error;
+    chunk->done = true;
+    m_chunks_condition.wakeAll ();
+  }
+};
+
+class OASISPipelineWorker
+  : public tl::Worker
+{
+public:
+  OASISPipelineWorker (OASISWriterPipeline *pipeline)
+    : tl::Worker (), mp_pipeline (pipeline)
+  {
+    //  .. nothing yet ..
+  }
+
+  void perform_task (tl::Task *task)
+  {
+    OASISPipelineTask *pipeline_task = dynamic_cast<OASISPipelineTask *> (task);
+    if (pipeline_task) {
+      if (pipeline_task->chunk ()->type == OASISPipelineChunk::Cell) {
+        mp_pipeline->encode (mp_cell_writer, pipeline_task->chunk ());
+      } else {
+        mp_pipeline->compress (pipeline_task->chunk ());
+      }
+    }
+  }
+
+private:
+  OASISWriterPipeline *mp_pipeline;
+  //  created on the first cell, so it sees the final tables
+  std::auto_ptr<OASISWriter> mp_cell_writer;
+};
+
+tl::Worker *
+OASISWriterPipeline::create_worker ()
+{
+  return new OASISPipelineWorker (this);
+}
+
+//  The maximum number of bytes kept in the pipeline before the writer waits for the pipeline threads
+const size_t max_pending_bytes = 64 * 1024 * 1024;
+
+//  The maximum number of cells per thread kept in the pipeline before the writer waits for the pipeline threads
+const size_t max_pending_cells_per_thread = 4;
+
 // ---------------------------------------------------------------------------------
 //  OASISWriter implementation
 
@@ -665,10 +970,44 @@ OASISWriter::OASISWriter ()
     mp_cell (0),
     m_layer (0), m_datatype (0),
     m_in_cblock (false),
-    m_progress (tl::to_string (QObject::tr ("Writing OASIS file")), 10000)
+    mp_pipeline (0),
+    m_flushing_pipeline (false),
+    m_propname_id (0),
+    m_propstring_id (0),
+    m_proptables_written (false)
+{
+  mp_progress.reset (new tl::AbsoluteProgress (tl::to_string (QObject::tr ("Writing OASIS file")), 10000));
+  mp_progress->set_format (tl::to_string (QObject::tr ("%.0f MB")));
+  mp_progress->set_unit (1024 * 1024);
+}
+
+OASISWriter::OASISWriter (const OASISWriter *parent)
+  : mp_stream (0),
+    m_sf (parent->m_sf),
+    mp_layout (parent->mp_layout),
+    mp_cell (0),
+    m_layer (0), m_datatype (0),
+    m_in_cblock (false),
+    mp_pipeline (0),
+    m_flushing_pipeline (false),
+    m_propname_id (parent->m_propname_id),
+    m_propstring_id (parent->m_propstring_id),
+    m_proptables_written (parent->m_proptables_written),
+    m_textstrings (parent->m_textstrings),
+    m_propnames (parent->m_propnames),
+    m_propstrings (parent->m_propstrings),
+    m_options (parent->m_options)
+{
+  //  a cell writer does not have a progress and compresses CBLOCKs itself
+  m_options.threads = 0;
+}
+
+void
+OASISWriter::progress_checkpoint ()
 {
-  m_progress.set_format (tl::to_string (QObject::tr ("%.0f MB")));
-  m_progress.set_unit (1024 * 1024);
+  if (mp_progress.get ()) {
+    mp_progress->set (mp_stream->pos ());
+  }
 }
 
 // 1M CBLOCK buffer size
@@ -684,7 +1023,7 @@ OASISWriter::write_record_id (char b)
     } 
     m_cblock_buffer.write ((const char *) &b, 1);
   } else {
-    mp_stream->put ((const char *) &b, 1);
+    put_bytes ((const char *) &b, 1);
   }
 }
 
@@ -694,7 +1033,7 @@ OASISWriter::write_byte (char b)
   if (m_in_cblock) {
     m_cblock_buffer.write ((const char *) &b, 1);
   } else {
-    mp_stream->put ((const char *) &b, 1);
+    put_bytes ((const char *) &b, 1);
   }
 }
 
@@ -703,6 +1042,17 @@ OASISWriter::write_bytes (const char *b, size_t n)
 {
   if (m_in_cblock) {
     m_cblock_buffer.write (b, n);
+  } else {
+    put_bytes (b, n);
+  }
+}
+
+void
+OASISWriter::put_bytes (const char *b, size_t n)
+{
+  //  while CBLOCKs are being compressed, the output is kept in the pipeline to maintain the order
+  if (mp_pipeline && ! m_flushing_pipeline && ! mp_pipeline->is_empty ()) {
+    mp_pipeline->put (b, n);
   } else {
     mp_stream->put (b, n);
   }
@@ -1061,40 +1411,116 @@ OASISWriter::end_cblock ()
 {
   tl_assert (m_in_cblock);
 
-  m_cblock_compressed.clear ();
-  tl::OutputStream deflated_stream (m_cblock_compressed);
-  tl::DeflateFilter deflate (deflated_stream);
+  m_in_cblock = false;
 
-  deflate.put (m_cblock_buffer.data (), m_cblock_buffer.size ());
-  deflate.flush ();
+  if (mp_pipeline) {
+
+    //  leave the compression to the pipeline threads
+    mp_pipeline->add_cblock (m_cblock_buffer);
+    flush_pipeline (false);
+
+  } else {
+
+    m_cblock_compressed.clear ();
+    deflate_cblock (m_cblock_buffer, m_cblock_compressed);
+
+    write_cblock (m_cblock_buffer, m_cblock_compressed);
+
+    m_cblock_compressed.clear ();
+
+  }
+
+  m_cblock_buffer.clear ();
+}
 
+void
+OASISWriter::write_cblock (const tl::OutputMemoryStream &data, const tl::OutputMemoryStream &compressed)
+{
   const size_t compression_overhead = 4;
-  m_in_cblock = false;
 
-  if (m_cblock_buffer.size () > m_cblock_compressed.size () + compression_overhead) {
+  if (data.size () > compressed.size () + compression_overhead) {
 
     write_byte (34);  // CBLOCK
 
     //  RFC1951 compression:
     write_byte (0); 
 
-    write (m_cblock_buffer.size ());
-    write (m_cblock_compressed.size ());
+    write (data.size ());
+    write (compressed.size ());
 
-    write_bytes (m_cblock_compressed.data (), m_cblock_compressed.size ());
+    write_bytes (compressed.data (), compressed.size ());
 
   } else {
-    write_bytes (m_cblock_buffer.data (), m_cblock_buffer.size ());
+    write_bytes (data.data (), data.size ());
   }
+}
 
-  m_cblock_buffer.clear ();
-  m_cblock_compressed.clear ();
+void
+OASISWriter::flush_pipeline (bool all)
+{
+  if (! mp_pipeline) {
+    return;
+  }
+
+  m_flushing_pipeline = true;
+
+  size_t max_pending_cells = max_pending_cells_per_thread * std::max ((unsigned int) 1, m_options.threads);
+
+  try {
+
+    while (! mp_pipeline->is_empty ()) {
+
+      //  wait for the pipeline threads if too much output is pending
+      bool wait = all || mp_pipeline->pending_bytes () > max_pending_bytes || mp_pipeline->pending_cells () > max_pending_cells;
+
+      OASISPipelineChunk *chunk = mp_pipeline->front (wait);
+      if (! chunk) {
+        break;
+      }
+
+      if (! chunk->error.empty ()) {
+        throw tl::Exception (chunk->error);
+      }
+
+      for (std::vector<std::pair<size_t *, size_t> >::const_iterator p = chunk->positions.begin (); p != chunk->positions.end (); ++p) {
+        *p->first = mp_stream->pos () + p->second;
+      }
+
+      if (chunk->type == OASISPipelineChunk::CBlock) {
+        write_cblock (chunk->data, chunk->compressed);
+      } else if (chunk->data.size () > 0) {
+        mp_stream->put (chunk->data.data (), chunk->data.size ());
+      }
+
+      mp_pipeline->pop_front ();
+
+    }
+
+    m_flushing_pipeline = false;
+
+  } catch (...) {
+    m_flushing_pipeline = false;
+    throw;
+  }
+}
+
+void
+OASISWriter::mark_position (size_t &pos)
+{
+  if (mp_pipeline && ! mp_pipeline->is_empty ()) {
+    //  the position is delivered when the pending output is written
+    mp_pipeline->mark_position (pos);
+  } else {
+    pos = mp_stream->pos ();
+  }
 }
 
 void 
 OASISWriter::begin_table (size_t &pos)
 {
   if (pos == 0) {
+    //  the table position needs to be known right now
+    flush_pipeline (true);
     pos = mp_stream->pos ();
     if (m_options.write_cblocks) {
       begin_cblock ();
@@ -1143,6 +1569,29 @@ OASISWriter::reset_modal_variables ()
 
 void 
 OASISWriter::write (db::Layout &layout, tl::OutputStream &stream, const db::SaveLayoutOptions &options)
+{
+  const OASISWriterOptions &oasis_options = options.get_options<OASISWriterOptions> ();
+
+  //  with threads, the cells are encoded and the CBLOCKs are compressed while the next cells are written
+  std::auto_ptr<OASISWriterPipeline> pipeline;
+  if (oasis_options.threads > 0) {
+    pipeline.reset (new OASISWriterPipeline (int (oasis_options.threads), this));
+  }
+
+  mp_pipeline = pipeline.get ();
+  m_flushing_pipeline = false;
+
+  try {
+    do_write (layout, stream, options);
+    mp_pipeline = 0;
+  } catch (...) {
+    mp_pipeline = 0;
+    throw;
+  }
+}
+
+void 
+OASISWriter::do_write (db::Layout &layout, tl::OutputStream &stream, const db::SaveLayoutOptions &options)
 {
   typedef db::coord_traits<db::Coord>::distance_type coord_distance_type;
 
@@ -1315,7 +1764,7 @@ OASISWriter::write (db::Layout &layout, tl::OutputStream &stream, const db::Save
           prop_ids_done.insert (inst->prop_id ());
           begin_table (propnames_table_pos);
           emit_propname_def (inst->prop_id ());
-          m_progress.set (mp_stream->pos ());
+          progress_checkpoint ();
         }
       }
 
@@ -1326,7 +1775,7 @@ OASISWriter::write (db::Layout &layout, tl::OutputStream &stream, const db::Save
             prop_ids_done.insert (shape->prop_id ());
             begin_table (propnames_table_pos);
             emit_propname_def (shape->prop_id ());
-            m_progress.set (mp_stream->pos ());
+            progress_checkpoint ();
           }
           shape.finish_array ();
         }
@@ -1394,7 +1843,7 @@ OASISWriter::write (db::Layout &layout, tl::OutputStream &stream, const db::Save
           prop_ids_done.insert (inst->prop_id ());
           begin_table (propstrings_table_pos);
           emit_propstring_def (inst->prop_id ());
-          m_progress.set (mp_stream->pos ());
+          progress_checkpoint ();
         }
       }
 
@@ -1405,7 +1854,7 @@ OASISWriter::write (db::Layout &layout, tl::OutputStream &stream, const db::Save
             prop_ids_done.insert (shape->prop_id ());
             begin_table (propstrings_table_pos);
             emit_propstring_def (shape->prop_id ());
-            m_progress.set (mp_stream->pos ());
+            progress_checkpoint ();
           }
           shape.finish_array ();
         }
@@ -1417,7 +1866,7 @@ OASISWriter::write (db::Layout &layout, tl::OutputStream &stream, const db::Save
     std::vector <std::string> context_prop_strings;
     for (std::vector<db::cell_index_type>::const_iterator cell = cells.begin (); cell != cells.end (); ++cell) {
 
-      m_progress.set (mp_stream->pos ());
+      progress_checkpoint ();
 
       const db::Cell &cref (layout.cell (*cell));
       if (cref.is_proxy () && ! cref.is_top ()) {
@@ -1520,7 +1969,7 @@ OASISWriter::write (db::Layout &layout, tl::OutputStream &stream, const db::Save
             write_record_id (5);
             write_astring (shape->text_string ());
             ++id;
-            m_progress.set (mp_stream->pos ());
+            progress_checkpoint ();
           }
           ++shape;
         }
@@ -1557,7 +2006,7 @@ OASISWriter::write (db::Layout &layout, tl::OutputStream &stream, const db::Save
         write_byte (3);
         write ((unsigned long) l->second.datatype);
 
-        m_progress.set (mp_stream->pos ());
+        progress_checkpoint ();
 
       }
 
@@ -1567,88 +2016,31 @@ OASISWriter::write (db::Layout &layout, tl::OutputStream &stream, const db::Save
 
   }
 
-  std::vector <std::string> context_prop_strings;
+  if (mp_pipeline) {
+    mp_pipeline->set_cell_parameters (cell_set, layers);
+  }
 
   for (std::vector<db::cell_index_type>::const_iterator cell = cells.begin (); cell != cells.end (); ++cell) {
 
-    m_progress.set (mp_stream->pos ());
+    progress_checkpoint ();
 
     //  cell body 
     const db::Cell &cref (layout.cell (*cell));
-    mp_cell = &cref;
 
     //  don't write ghost cells unless they are not empty (any more)
     //  also don't write proxy cells which are not employed
     if ((! cref.is_ghost_cell () || ! cref.empty ()) && (! cref.is_proxy () || ! cref.is_top ())) {
 
-      //  cell header 
-
-      cell_positions.insert (std::make_pair (*cell, mp_stream->pos ()));
-
-      write_record_id (13);  // CELL
-      write ((unsigned long) *cell);
-
-      reset_modal_variables ();
-
-      if (m_options.write_cblocks) {
-        begin_cblock ();
-      }
-
-      //  context information as property named KLAYOUT_CONTEXT
-      if (cref.is_proxy ()) {
-
-        context_prop_strings.clear ();
-
-        if (layout.get_context_info (*cell, context_prop_strings)) {
-
-          write_record_id (28);
-          write_byte (char (0xf6)); 
-          std::map <std::string, unsigned long>::const_iterator pni = m_propnames.find (klayout_context_name);
-          tl_assert (pni != m_propnames.end ());
-          write (pni->second);
-
-          write ((unsigned long) context_prop_strings.size ());
-
-          for (std::vector <std::string>::const_iterator c = context_prop_strings.begin (); c != context_prop_strings.end (); ++c) {
-            write_byte (14); // b-string by reference number
-            std::map <std::string, unsigned long>::const_iterator psi = m_propstrings.find (*c);
-            tl_assert (psi != m_propstrings.end ());
-            write (psi->second);
-          }
-
-          mm_last_property_name = klayout_context_name;
-          mm_last_property_is_sprop = false;
-          mm_last_value_list.reset ();
-
-        }
-
-      }
+      mark_position (cell_positions.insert (std::make_pair (*cell, size_t (0))).first->second);
 
-      if (cref.prop_id () != 0) {
-        write_props (cref.prop_id ());
-      }
-
-      //  instances
-      if (cref.cell_instances () > 0) {
-        write_insts (cell_set);
-      }
-
-      //  shapes
-      for (std::vector <std::pair <unsigned int, db::LayerProperties> >::const_iterator l = layers.begin (); l != layers.end (); ++l) {
-        const db::Shapes &shapes = cref.shapes (l->first);
-        if (! shapes.empty ()) {
-          write_shapes (l->second, shapes);
-          m_progress.set (mp_stream->pos ());
-        }
+      //  proxy cells are written by this thread since the context information is not thread safe
+      if (mp_pipeline && ! cref.is_proxy ()) {
+        mp_pipeline->add_cell (*cell);
+        flush_pipeline (false);
+      } else {
+        write_cell (*cell, cell_set, layers);
       }
 
-      //  end CBLOCK if required
-      if (m_options.write_cblocks) {
-        end_cblock ();
-      } 
-
-      //  end of cell
-
     }
 
   }
@@ -1717,6 +2109,8 @@ OASISWriter::write (db::Layout &layout, tl::OutputStream &stream, const db::Save
 
   //  END record
 
+  flush_pipeline (true);
+
   size_t end_record_pos = mp_stream->pos ();
 
   write_record_id (2);
@@ -1761,7 +2155,86 @@ OASISWriter::write (db::Layout &layout, tl::OutputStream &stream, const db::Save
   //  validation-scheme
   write_byte (0);
 
-  m_progress.set (mp_stream->pos ());
+  progress_checkpoint ();
+}
+
+void
+OASISWriter::write_cell (db::cell_index_type ci, const std::set <db::cell_index_type> &cell_set, const std::vector <std::pair <unsigned int, db::LayerProperties> > &layers)
+{
+  const db::Cell &cref (mp_layout->cell (ci));
+  mp_cell = &cref;
+
+  //  cell header 
+
+  write_record_id (13);  // CELL
+  write ((unsigned long) ci);
+
+  reset_modal_variables ();
+
+  if (m_options.write_cblocks) {
+    begin_cblock ();
+  }
+
+  //  context information as property named KLAYOUT_CONTEXT
+  if (cref.is_proxy ()) {
+
+    std::vector <std::string> context_prop_strings;
+
+    if (mp_layout->get_context_info (ci, context_prop_strings)) {
+
+      write_record_id (28);
+      write_byte (char (0xf6)); 
+      std::map <std::string, unsigned long>::const_iterator pni = m_propnames.find (klayout_context_name);
+      tl_assert (pni != m_propnames.end ());
+      write (pni->second);
+
+      write ((unsigned long) context_prop_strings.size ());
+
+      for (std::vector <std::string>::const_iterator c = context_prop_strings.begin (); c != context_prop_strings.end (); ++c) {
+        write_byte (14); // b-string by reference number
+        std::map <std::string, unsigned long>::const_iterator psi = m_propstrings.find (*c);
+        tl_assert (psi != m_propstrings.end ());
+        write (psi->second);
+      }
+
+      mm_last_property_name = klayout_context_name;
+      mm_last_property_is_sprop = false;
+      mm_last_value_list.reset ();
+
+    }
+
+  }
+
+  if (cref.prop_id () != 0) {
+    write_props (cref.prop_id ());
+  }
+
+  //  instances
+  if (cref.cell_instances () > 0) {
+    write_insts (cell_set);
+  }
+
+  //  shapes
+  for (std::vector <std::pair <unsigned int, db::LayerProperties> >::const_iterator l = layers.begin (); l != layers.end (); ++l) {
+    const db::Shapes &shapes = cref.shapes (l->first);
+    if (! shapes.empty ()) {
+      write_shapes (l->second, shapes);
+      progress_checkpoint ();
+    }
+  }
+
+  //  end CBLOCK if required
+  if (m_options.write_cblocks) {
+    end_cblock ();
+  } 
+}
+
+void
+OASISWriter::encode_cell (tl::OutputStream &stream, db::cell_index_type ci, const std::set <db::cell_index_type> &cell_set, const std::vector <std::pair <unsigned int, db::LayerProperties> > &layers)
+{
+  mp_stream = &stream;
+  write_cell (ci, cell_set, layers);
+  mp_stream = 0;
 }
 
 void 
@@ -1946,7 +2419,7 @@ OASISWriter::write_inst_with_rep (const db::CellInstArray &inst, db::properties_
 void
 OASISWriter::write (const db::CellInstArray &inst, db::properties_id_type prop_id, const db::Repetition &rep)
 {
-  m_progress.set (mp_stream->pos ());
+  progress_checkpoint ();
 
   db::Vector a, b;
   unsigned long amax, bmax;
@@ -2028,7 +2501,7 @@ OASISWriter::write_props (db::properties_id_type prop_id)
 
   for (db::PropertiesRepository::properties_set::const_iterator p = props.begin (); p != props.end (); ++p) {
 
-    m_progress.set (mp_stream->pos ());
+    progress_checkpoint ();
 
     const tl::Variant &name = mp_layout->properties_repository ().prop_name (p->first);
 
@@ -2281,7 +2754,7 @@ OASISWriter::write_pointlist (const std::vector<db::Vector> &pointlist, bool for
 void 
 OASISWriter::write (const db::Text &text, db::properties_id_type prop_id, const db::Repetition &rep)
 {
-  m_progress.set (mp_stream->pos ());
+  progress_checkpoint ();
 
   db::Trans trans = text.trans ();
   std::map <std::string, unsigned long>::const_iterator ts = m_textstrings.find (text.string ());
@@ -2344,7 +2817,7 @@ OASISWriter::write (const db::Text &text, db::properties_id_type prop_id, const
 void 
 OASISWriter::write (const db::SimplePolygon &polygon, db::properties_id_type prop_id, const db::Repetition &rep)
 {
-  m_progress.set (mp_stream->pos ());
+  progress_checkpoint ();
 
   //  TODO: how to deal with max vertex count?
  
@@ -2439,7 +2912,7 @@ OASISWriter::write (const db::Polygon &polygon, db::properties_id_type prop_id,
   
   } else {
 
-    m_progress.set (mp_stream->pos ());
+    progress_checkpoint ();
 
     //  TODO: how to deal with max vertex count?
    
@@ -2518,7 +2991,7 @@ OASISWriter::write (const db::Polygon &polygon, db::properties_id_type prop_id,
 void 
 OASISWriter::write (const db::Box &box, db::properties_id_type prop_id, const db::Repetition &rep)
 {
-  m_progress.set (mp_stream->pos ());
+  progress_checkpoint ();
 
   unsigned char info = 0x00;
   
@@ -2599,7 +3072,7 @@ OASISWriter::write (const db::Path &path, db::properties_id_type prop_id, const
     return;
   }
 
-  m_progress.set (mp_stream->pos ());
+  progress_checkpoint ();
 
   std::pair<db::Path::coord_type, db::Path::coord_type> ext (0, 0);
   //  for round paths, circles are placed to mimic the extensions
@@ -2873,7 +3346,7 @@ OASISWriter::write (const db::Path &path, db::properties_id_type prop_id, const
 void 
 OASISWriter::write (const db::Edge &edge, db::properties_id_type prop_id, const db::Repetition & /*rep*/)
 {
-  m_progress.set (mp_stream->pos ());
+  progress_checkpoint ();
 
   m_pointlist.reserve (1);
   m_pointlist.erase (m_pointlist.begin (), m_pointlist.end ());
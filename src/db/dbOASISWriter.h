@@ -33,6 +33,7 @@
 #include "tlStream.h"
 
 #include <string>
+#include <memory>
 
 namespace tl
 {
@@ -45,6 +46,7 @@ namespace db
 class Layout;
 class SaveLayoutOptions;
 class OASISWriter;
+class OASISWriterPipeline;
 
 /**
  *  @brief Structure that holds the OASIS specific options for the Writer
@@ -57,7 +59,7 @@ public:
    *  @brief The constructor
    */
   OASISWriterOptions ()
-    : compression_level (2), write_cblocks (false), strict_mode (false), recompress (false), write_std_properties (1), subst_char ("*")
+    : compression_level (2), write_cblocks (false), strict_mode (false), recompress (false), write_std_properties (1), subst_char ("*"), threads (0)
   {
     //  .. nothing yet ..
   }
@@ -112,6 +114,16 @@ public:
    */
   std::string subst_char;
 
+  /**
+   *  @brief The number of writer threads
+   *
+   *  If non-zero, the cells are encoded and the CBLOCK contents are compressed by the
+   *  given number of threads while the writer continues with the next cells. The output
+   *  is identical to the one produced without threads. 0 means everything is done by the
+   *  writing thread.
+   */
+  unsigned int threads;
+
   /** 
    *  @brief Implementation of FormatSpecificWriterOptions
    */
@@ -279,6 +291,8 @@ public:
   void write (const db::Polygon &polygon, db::properties_id_type prop_id, const db::Repetition &rep);
 
 private:
+  friend class OASISWriterPipeline;
+
   tl::OutputStream *mp_stream;
   double m_sf;
   const db::Layout *mp_layout;
@@ -289,6 +303,8 @@ private:
   tl::OutputMemoryStream m_cblock_buffer;
   tl::OutputMemoryStream m_cblock_compressed;
   bool m_in_cblock;
+  OASISWriterPipeline *mp_pipeline;
+  bool m_flushing_pipeline;
   unsigned long m_propname_id;
   unsigned long m_propstring_id;
   bool m_proptables_written;
@@ -326,7 +342,9 @@ private:
   modal_variable<property_value_list> mm_last_value_list;
 
   OASISWriterOptions m_options;
-  tl::AbsoluteProgress m_progress;
+  std::auto_ptr<tl::AbsoluteProgress> mp_progress;
+
+  OASISWriter (const OASISWriter *parent);
 
   void write_record_id (char b);
   void write_byte (char b);
@@ -370,8 +388,16 @@ private:
 
   void write (const Repetition &rep);
 
+  void do_write (db::Layout &layout, tl::OutputStream &stream, const db::SaveLayoutOptions &options);
   void begin_cblock ();
   void end_cblock ();
+  void write_cblock (const tl::OutputMemoryStream &data, const tl::OutputMemoryStream &compressed);
+  void flush_pipeline (bool all);
+  void progress_checkpoint ();
+  void write_cell (db::cell_index_type ci, const std::set <db::cell_index_type> &cell_set, const std::vector <std::pair <unsigned int, db::LayerProperties> > &layers);
+  void encode_cell (tl::OutputStream &stream, db::cell_index_type ci, const std::set <db::cell_index_type> &cell_set, const std::vector <std::pair <unsigned int, db::LayerProperties> > &layers);
+  void mark_position (size_t &pos);
+  void put_bytes (const char *b, size_t n);
 
   void begin_table (size_t &pos);
   void end_table (size_t pos);
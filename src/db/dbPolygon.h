@@ -138,7 +138,7 @@ public:
       mp_points = 0;
     } else {
       point_type *p = new point_type [m_size];
-      point_type *pp = (point_type *) ((size_t) d.mp_points & ~3);
+      point_type *pp = (point_type *) ((size_t) d.mp_points & ~7);
       mp_points = (point_type *)((size_t) p | ((size_t) d.mp_points & 3));
       for (unsigned int i = 0; i < m_size; ++i) {
         p[i] = pp[i];
@@ -603,7 +603,7 @@ public:
    */
   polygon_contour<C> &move (const vector_type &d)
   {
-    point_type *p = (point_type *) ((size_t) mp_points & ~3);
+    point_type *p = (point_type *) ((size_t) mp_points & ~7);
     for (size_type i = 0; i < m_size; ++i, ++p) {
       *p += d;
     }
@@ -729,9 +729,10 @@ public:
     if (m_size < 2) {
       return false;
     }
-    point_type pl = mp_points [m_size - 1];
+    const point_type *pts = (const point_type *) ((size_t) mp_points & ~7);
+    point_type pl = pts [m_size - 1];
     for (size_t i = 0; i < m_size; ++i) {
-      point_type p = mp_points [i];
+      point_type p = pts [i];
       if (! coord_traits::equals (p.x (), pl.x ()) && ! coord_traits::equals (p.y (), pl.y ())) {
         return false;
       }
@@ -800,7 +801,7 @@ public:
   point_type operator[] (size_type index) const
   {
     size_t f = (size_t) mp_points;
-    point_type *pts = (point_type *) (f & ~3);
+    point_type *pts = (point_type *) (f & ~7);
     if ((f & 1) != 0) {
       if ((index & 1) != 0) {
         if ((f & 2) != 0) {
@@ -853,7 +854,7 @@ public:
   size_t hash () const
   {
     size_t h = ((size_t) mp_points & 3);
-    point_type *p = (point_type *) ((size_t) mp_points & ~3);
+    point_type *p = (point_type *) ((size_t) mp_points & ~7);
     for (size_type i = 0; i < m_size; ++i, ++p) {
       h = (h << 4) ^ (h >> 4) ^ size_t (p->x ());
       h = (h << 4) ^ (h >> 4) ^ size_t (p->y ());
@@ -872,7 +873,7 @@ public:
   box_type bbox () const
   {
     box_type box;
-    point_type *p = (point_type *) ((size_t) mp_points & ~3);
+    point_type *p = (point_type *) ((size_t) mp_points & ~7);
     for (size_type i = 0; i < m_size; ++i, ++p) {
       box += *p;
     }
@@ -946,24 +947,82 @@ public:
     std::swap (mp_points, d.mp_points);
   }
 
+  /**
+   *  @brief Gets the number of points actually stored
+   *
+   *  For compressed (manhattan) contours, this is half the number of points.
+   */
+  size_type raw_size () const
+  {
+    return m_size;
+  }
+
+  /**
+   *  @brief Returns true, if the points are stored in an external buffer (see pack)
+   */
+  bool is_packed () const
+  {
+    return ((size_t) mp_points & 4) != 0;
+  }
+
+  /**
+   *  @brief Moves the points into an external buffer
+   *
+   *  After this operation, the contour refers to the points stored in the buffer and 
+   *  does not own them any longer. The buffer must provide space for raw_size () points and
+   *  must stay valid until the contour is released or unpacked. "buffer" is advanced 
+   *  behind the points stored. The buffer must be aligned to 8 bytes at least.
+   *  Copies of a packed contour own their points.
+   */
+  void pack (point_type *&buffer)
+  {
+    point_type *p = (point_type *) ((size_t) mp_points & ~7);
+    if (p && ! is_packed ()) {
+      tl_assert (((size_t) buffer & 7) == 0);
+      for (size_type i = 0; i < m_size; ++i) {
+        buffer [i] = p [i];
+      }
+      delete [] p;
+      mp_points = (point_type *) ((size_t) buffer | ((size_t) mp_points & 3) | 4);
+      buffer += m_size;
+    }
+  }
+
+  /**
+   *  @brief Moves the points from an external buffer into storage owned by the contour
+   */
+  void unpack ()
+  {
+    if (is_packed ()) {
+      point_type *pp = (point_type *) ((size_t) mp_points & ~7);
+      point_type *p = new point_type [m_size];
+      for (size_type i = 0; i < m_size; ++i) {
+        p [i] = pp [i];
+      }
+      mp_points = (point_type *) ((size_t) p | ((size_t) mp_points & 3));
+    }
+  }
+
   size_t mem_used () const
   {
-    return sizeof (polygon_contour) + sizeof (point_type) * m_size;
+    return sizeof (polygon_contour) + (is_packed () ? 0 : sizeof (point_type) * m_size);
   }
 
   size_t mem_reqd () const
   {
-    return sizeof (polygon_contour) + sizeof (point_type) * m_size;
+    return sizeof (polygon_contour) + (is_packed () ? 0 : sizeof (point_type) * m_size);
   }
 
 private:
+  //  The lower bits of the point pointer are used as flags: bit 0 indicates a compressed
+  //  manhattan contour, bit 1 a hole and bit 2 points stored in an external buffer.
   point_type *mp_points;
   size_type m_size;
 
   void release ()
   {
-    point_type *p = (point_type *) ((size_t) mp_points & ~3);
-    if (p) {
+    point_type *p = (point_type *) ((size_t) mp_points & ~7);
+    if (p && ! is_packed ()) {
       delete [] p;
     }
     mp_points = 0;
@@ -2162,6 +2221,40 @@ public:
     return copy;
   }
 
+  /**
+   *  @brief Gets the number of points required to pack the polygon (see pack)
+   */
+  size_t pack_size () const
+  {
+    size_t n = 0;
+    for (typename contour_list_type::const_iterator c = m_ctrs.begin (); c != m_ctrs.end (); ++c) {
+      n += c->raw_size ();
+    }
+    return n;
+  }
+
+  /**
+   *  @brief Moves the points of the contours into an external buffer
+   *
+   *  See polygon_contour::pack for details.
+   */
+  void pack (point_type *&buffer)
+  {
+    for (typename contour_list_type::iterator c = m_ctrs.begin (); c != m_ctrs.end (); ++c) {
+      c->pack (buffer);
+    }
+  }
+
+  /**
+   *  @brief Moves the points of the contours back from an external buffer
+   */
+  void unpack ()
+  {
+    for (typename contour_list_type::iterator c = m_ctrs.begin (); c != m_ctrs.end (); ++c) {
+      c->unpack ();
+    }
+  }
+
   size_t mem_used () const
   {
     return sizeof (m_bbox) + db::mem_used (m_ctrs);
@@ -2798,6 +2891,32 @@ public:
     return m_hull.size ();
   }
 
+  /**
+   *  @brief Gets the number of points required to pack the polygon (see pack)
+   */
+  size_t pack_size () const
+  {
+    return m_hull.raw_size ();
+  }
+
+  /**
+   *  @brief Moves the points of the hull into an external buffer
+   *
+   *  See polygon_contour::pack for details.
+   */
+  void pack (point_type *&buffer)
+  {
+    m_hull.pack (buffer);
+  }
+
+  /**
+   *  @brief Moves the points of the hull back from an external buffer
+   */
+  void unpack ()
+  {
+    m_hull.unpack ();
+  }
+
   size_t mem_used () const
   {
     return sizeof (m_bbox) + db::mem_used (m_hull);
@@ -23,6 +23,8 @@
 
 #include "dbReader.h"
 #include "dbStream.h"
+#include "dbLayoutCache.h"
+#include "dbLayout.h"
 #include "tlClassRegistry.h"
 
 namespace db
@@ -74,5 +76,39 @@ Reader::~Reader ()
   }
 }
 
+const db::LayerMap &
+Reader::read (db::Layout &layout, const db::LoadLayoutOptions &options)
+{
+  return read_cached (layout, &options);
+}
+
+const db::LayerMap &
+Reader::read (db::Layout &layout)
+{
+  return read_cached (layout, 0);
+}
+
+const db::LayerMap &
+Reader::read_cached (db::Layout &layout, const db::LoadLayoutOptions *options)
+{
+  //  the cache holds layouts read into an empty layout only
+  if (layout.begin () != layout.end () || layout.layers () > 0) {
+    return options ? mp_actual_reader->read (layout, *options) : mp_actual_reader->read (layout);
+  }
+
+  db::LayoutCache cache (m_stream, format (), options ? *options : db::LoadLayoutOptions (), layout.is_editable ());
+  if (! cache.is_valid ()) {
+    return options ? mp_actual_reader->read (layout, *options) : mp_actual_reader->read (layout);
+  }
+
+  if (cache.fetch (layout, m_cached_layer_map)) {
+    return m_cached_layer_map;
+  }
+
+  const db::LayerMap &lm = options ? mp_actual_reader->read (layout, *options) : mp_actual_reader->read (layout);
+  cache.store (layout, lm);
+  return lm;
+}
+
 }
 
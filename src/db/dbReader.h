@@ -122,13 +122,13 @@ public:
    *  new layers. The returned map will contain all layers, the passed
    *  ones and the newly created ones.
    *
+   *  If a layout cache directory is configured (see db::LayoutCache), the layout
+   *  may be taken from the cache instead of reading the stream.
+   *
    *  @param layout The layout object to write to
    *  @param options The LayerMap object
    */
-  const db::LayerMap &read (db::Layout &layout, const db::LoadLayoutOptions &options) 
-  {
-    return mp_actual_reader->read (layout, options);
-  }
+  const db::LayerMap &read (db::Layout &layout, const db::LoadLayoutOptions &options);
 
   /** 
    *  @brief The basic read method (without mapping)
@@ -143,10 +143,7 @@ public:
    *  @param layout The layout object to write to
    *  @return The LayerMap object
    */
-  const db::LayerMap &read (db::Layout &layout)
-  {
-    return mp_actual_reader->read (layout);
-  }
+  const db::LayerMap &read (db::Layout &layout);
 
   /**
    *  @brief Returns a format describing the file format found
@@ -176,6 +173,9 @@ public:
 private:
   ReaderBase *mp_actual_reader;
   tl::InputStream &m_stream;
+  db::LayerMap m_cached_layer_map;
+
+  const db::LayerMap &read_cached (db::Layout &layout, const db::LoadLayoutOptions *options);
 };
 
 }
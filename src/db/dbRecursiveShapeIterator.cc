@@ -62,11 +62,9 @@ RecursiveShapeIterator &RecursiveShapeIterator::operator= (const RecursiveShapeI
       mp_complex_region.reset (0);
     }
 
-    m_box_convert = d.m_box_convert;
-
     m_inst = d.m_inst;
     m_inst_array = d.m_inst_array;
-    m_empty_cells_cache = d.m_empty_cells_cache;
+    m_cell_bbox_cache = d.m_cell_bbox_cache;
     m_layer = d.m_layer;
     mp_cell = d.mp_cell;
     m_current_layer = d.m_current_layer;
@@ -143,7 +141,6 @@ RecursiveShapeIterator::RecursiveShapeIterator (const shapes_type &shapes, const
 }
 
 RecursiveShapeIterator::RecursiveShapeIterator (const layout_type &layout, const cell_type &cell, unsigned int layer, const box_type &region, bool overlapping)
-  : m_box_convert (layout, layer)
 {
   m_layer = layer;
   m_has_layers = false;
@@ -156,7 +153,6 @@ RecursiveShapeIterator::RecursiveShapeIterator (const layout_type &layout, const
 }
 
 RecursiveShapeIterator::RecursiveShapeIterator (const layout_type &layout, const cell_type &cell, unsigned int layer, const region_type &region, bool overlapping)
-  : m_box_convert (layout, layer)
 {
   m_layer = layer;
   m_has_layers = false;
@@ -169,7 +165,6 @@ RecursiveShapeIterator::RecursiveShapeIterator (const layout_type &layout, const
 }
 
 RecursiveShapeIterator::RecursiveShapeIterator (const layout_type &layout, const cell_type &cell, unsigned int layer)
-  : m_box_convert (layout, layer)
 {
   m_layer = layer;
   m_has_layers = false;
@@ -182,7 +177,6 @@ RecursiveShapeIterator::RecursiveShapeIterator (const layout_type &layout, const
 }
 
 RecursiveShapeIterator::RecursiveShapeIterator (const layout_type &layout, const cell_type &cell, const std::vector<unsigned int> &layers, const box_type &region, bool overlapping)
-  : m_box_convert (layout)
 {
   m_layer = 0;
   m_layers = layers;
@@ -196,7 +190,6 @@ RecursiveShapeIterator::RecursiveShapeIterator (const layout_type &layout, const
 }
 
 RecursiveShapeIterator::RecursiveShapeIterator (const layout_type &layout, const cell_type &cell, const std::vector<unsigned int> &layers, const region_type &region, bool overlapping)
-  : m_box_convert (layout)
 {
   m_layer = 0;
   m_layers = layers;
@@ -210,7 +203,6 @@ RecursiveShapeIterator::RecursiveShapeIterator (const layout_type &layout, const
 }
 
 RecursiveShapeIterator::RecursiveShapeIterator (const layout_type &layout, const cell_type &cell, const std::vector<unsigned int> &layers)
-  : m_box_convert (layout)
 {
   m_layer = 0;
   m_layers = layers;
@@ -224,7 +216,6 @@ RecursiveShapeIterator::RecursiveShapeIterator (const layout_type &layout, const
 }
 
 RecursiveShapeIterator::RecursiveShapeIterator (const layout_type &layout, const cell_type &cell, const std::set<unsigned int> &layers, const box_type &region, bool overlapping)
-  : m_box_convert (layout)
 {
   m_layer = 0;
   m_layers.insert (m_layers.end (), layers.begin (), layers.end ());
@@ -238,7 +229,6 @@ RecursiveShapeIterator::RecursiveShapeIterator (const layout_type &layout, const
 }
 
 RecursiveShapeIterator::RecursiveShapeIterator (const layout_type &layout, const cell_type &cell, const std::set<unsigned int> &layers, const region_type &region, bool overlapping)
-  : m_box_convert (layout)
 {
   m_layer = 0;
   m_layers.insert (m_layers.end (), layers.begin (), layers.end ());
@@ -252,7 +242,6 @@ RecursiveShapeIterator::RecursiveShapeIterator (const layout_type &layout, const
 }
 
 RecursiveShapeIterator::RecursiveShapeIterator (const layout_type &layout, const cell_type &cell, const std::set<unsigned int> &layers)
-  : m_box_convert (layout)
 {
   m_layer = 0;
   m_layers.insert (m_layers.end (), layers.begin (), layers.end ());
@@ -393,8 +382,15 @@ RecursiveShapeIterator::validate () const
   m_shape = shape_iterator ();
   m_shape_quad_id = 0;
 
+  m_cell_bbox_cache.clear ();
+
   m_local_region_stack.clear ();
-  m_local_region_stack.push_back (m_region);
+  if (mp_top_cell && m_region != box_type::world ()) {
+    //  confine the region to the part where there is something on the selected layers
+    m_local_region_stack.push_back (m_region & cell_bbox (mp_top_cell->cell_index ()));
+  } else {
+    m_local_region_stack.push_back (m_region);
+  }
 
   m_local_complex_region_stack.clear ();
   if (mp_complex_region.get ()) {
@@ -588,9 +584,9 @@ RecursiveShapeIterator::skip_inst_iter_for_complex_region () const
       }
     }
 
-    //  skip insts outside the complex region
+    //  skip insts outside the complex region (considering the selected layers only)
     if (! m_inst.at_end ()) {
-      if (! is_outside_complex_region (m_inst->bbox ())) {
+      if (! cell_bbox (m_inst->cell_index ()).empty () && ! is_outside_complex_region (m_inst->cell_inst ().bbox (selected_layers_box_convert (this)))) {
         break;
       } else {
         ++m_inst;
@@ -636,30 +632,7 @@ RecursiveShapeIterator::next_shape () const
       if (! m_inst.at_end () && int (m_inst_iterators.size ()) < m_max_depth) {
 
         //  determine whether the cell is empty with respect to the layers specified
-        bool is_empty = false;
-        if (! m_has_layers) {
-
-          is_empty = mp_layout->cell (m_inst->cell_index ()).bbox (m_layer).empty ();
-
-        } else {
-
-          std::map<db::cell_index_type, bool>::const_iterator ec = m_empty_cells_cache.find (m_inst->cell_index ());
-          if (ec != m_empty_cells_cache.end ()) {
-
-            is_empty = ec->second;
-
-          } else {
-
-            is_empty = true;
-            for (std::vector<unsigned int>::const_iterator l = m_layers.begin (); l != m_layers.end () && is_empty; ++l) {
-              is_empty = mp_layout->cell (m_inst->cell_index ()).bbox (*l).empty ();
-            }
-
-            m_empty_cells_cache.insert (std::make_pair (m_inst->cell_index (), is_empty));
-
-          }
-
-        }
+        bool is_empty = cell_bbox (m_inst->cell_index ()).empty ();
 
         if (is_empty) {
 
@@ -712,10 +685,10 @@ RecursiveShapeIterator::down () const
   //  don't transform the world region, since transformation of that region might not work properly
   box_type new_region = box_type::world ();
 
-  //  compute the region inside the new cell
+  //  compute the region inside the new cell - only the part covered by the selected layers is relevant
   if (new_region != m_local_region_stack.front ()) {
     new_region = m_trans.inverted () * m_local_region_stack.front ();
-    new_region &= cell ()->bbox ();
+    new_region &= cell_bbox (cell_index ());
   }
   m_local_region_stack.push_back (new_region);
 
@@ -844,8 +817,8 @@ void
 RecursiveShapeIterator::new_inst () const
 {
   //  look for the next instance with a non-empty array iterator. The latter can be 
-  //  empty because we use a per-layer box converter for that case what we don't for the
-  //  touching instance iterator.
+  //  empty because we use a box converter for the selected layers for that case what 
+  //  we don't for the touching instance iterator (which is based on the full cell boxes).
   while (! m_inst.at_end ()) {
 
     //  skip instance quad if possible
@@ -857,7 +830,7 @@ RecursiveShapeIterator::new_inst () const
     }
 
     if (m_local_region_stack.back () != box_type::world ()) {
-      m_inst_array = m_inst->cell_inst ().begin_touching (m_local_region_stack.back (), m_box_convert);
+      m_inst_array = m_inst->cell_inst ().begin_touching (m_local_region_stack.back (), selected_layers_box_convert (this));
     } else {
       m_inst_array = m_inst->cell_inst ().begin (); 
     }
@@ -871,6 +844,28 @@ RecursiveShapeIterator::new_inst () const
   }
 }
 
+RecursiveShapeIterator::box_type
+RecursiveShapeIterator::cell_bbox (db::cell_index_type ci) const
+{
+  const db::Cell &c = mp_layout->cell (ci);
+  if (! m_has_layers) {
+    return c.bbox (m_layer);
+  }
+
+  std::map<db::cell_index_type, box_type>::const_iterator cb = m_cell_bbox_cache.find (ci);
+  if (cb != m_cell_bbox_cache.end ()) {
+    return cb->second;
+  }
+
+  box_type box;
+  for (std::vector<unsigned int>::const_iterator l = m_layers.begin (); l != m_layers.end (); ++l) {
+    box += c.bbox (*l);
+  }
+
+  m_cell_bbox_cache.insert (std::make_pair (ci, box));
+  return box;
+}
+
 bool
 RecursiveShapeIterator::is_outside_complex_region (const db::Box &box) const
 {
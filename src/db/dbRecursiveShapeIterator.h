@@ -426,6 +426,25 @@ public:
     }
   }
 
+  /**
+   *  @brief Gets the minimum hierarchy depth to search for
+   */
+  int min_depth () const
+  {
+    return m_min_depth;
+  }
+
+  /**
+   *  @brief Returns true, if a cell selection is present
+   *
+   *  A cell selection is present if select_cells, unselect_cells, select_all_cells
+   *  or unselect_all_cells has been used.
+   */
+  bool has_cell_selection () const
+  {
+    return ! m_start.empty () || ! m_stop.empty ();
+  }
+
   /**
    *  @brief Specify the shape selection flags
    *
@@ -440,6 +459,14 @@ public:
     }
   }
 
+  /**
+   *  @brief Gets the shape selection flags
+   */
+  unsigned int shape_flags () const
+  {
+    return m_shape_flags;
+  }
+
   /**
    *  @brief Specify the property selector
    *
@@ -455,6 +482,14 @@ public:
     }
   }
 
+  /**
+   *  @brief Gets the property selector
+   */
+  const shape_iterator::property_selector *shape_property_selector () const
+  {
+    return mp_shape_prop_sel;
+  }
+
   /**
    *  @brief Specify the inverse of the property selector
    *
@@ -650,11 +685,10 @@ private:
 
   box_type m_region;
   std::auto_ptr<region_type> mp_complex_region;
-  db::box_convert<db::CellInst> m_box_convert;
 
   mutable inst_iterator m_inst;
   mutable inst_array_iterator m_inst_array;
-  mutable std::map<db::cell_index_type, bool> m_empty_cells_cache;
+  mutable std::map<db::cell_index_type, box_type> m_cell_bbox_cache;
   mutable unsigned int m_layer;
   mutable const cell_type *mp_cell;
   mutable size_t m_current_layer;
@@ -686,6 +720,26 @@ private:
   void down () const;
 
   bool is_outside_complex_region (const db::Box &box) const;
+  box_type cell_bbox (db::cell_index_type ci) const;
+
+  /**
+   *  @brief A box converter delivering the bounding box of a cell instance on the selected layers
+   */
+  struct selected_layers_box_convert
+  {
+    selected_layers_box_convert (const RecursiveShapeIterator *iter)
+      : mp_iter (iter)
+    { }
+
+    box_type operator() (const db::CellInst &inst) const
+    {
+      return mp_iter->cell_bbox (inst.cell_index ());
+    }
+
+    const RecursiveShapeIterator *mp_iter;
+  };
+
+  friend struct selected_layers_box_convert;
 
   bool is_inactive () const
   {
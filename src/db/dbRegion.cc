@@ -31,8 +31,12 @@
 #include "dbBoxScanner.h"
 #include "dbClip.h"
 #include "dbPolygonTools.h"
+#include "dbHierProcessor.h"
 
 #include "tlVariant.h"
+#include "tlThreadedWorkers.h"
+
+#include <QMutex>
 
 #include <sstream>
 #include <set>
@@ -63,6 +67,37 @@ Region::Region (const RecursiveShapeIterator &si, const db::ICplxTrans &trans, b
   m_merged_semantics = merged_semantics;
 }
 
+Region::Region (const RecursiveShapeIterator &si, DeepShapeStore &dss)
+  : m_polygons (false), m_merged_polygons (false)
+{
+  init ();
+  if (DeepShapeStore::is_valid_layout_source (si)) {
+    m_deep_layer = dss.create_polygon_layer (si);
+    m_iter = m_deep_layer.iter ();
+  } else {
+    m_iter = si;
+  }
+  m_iter.reset ();
+  m_bbox_valid = false;
+  m_is_merged = false;
+}
+
+Region::Region (const RecursiveShapeIterator &si, DeepShapeStore &dss, const db::ICplxTrans &trans, bool merged_semantics)
+  : m_polygons (false), m_merged_polygons (false), m_iter_trans (trans)
+{
+  init ();
+  if (DeepShapeStore::is_valid_layout_source (si)) {
+    m_deep_layer = dss.create_polygon_layer (si);
+    m_iter = m_deep_layer.iter ();
+  } else {
+    m_iter = si;
+  }
+  m_iter.reset ();
+  m_bbox_valid = false;
+  m_is_merged = false;
+  m_merged_semantics = merged_semantics;
+}
+
 bool  
 Region::operator== (const db::Region &other) const
 {
@@ -330,6 +365,7 @@ Region::swap (Region &other)
   std::swap (m_merged_polygons_valid, other.m_merged_polygons_valid);
   std::swap (m_iter, other.m_iter);
   std::swap (m_iter_trans, other.m_iter_trans);
+  m_deep_layer.swap (other.m_deep_layer);
 }
 
 Region &
@@ -373,6 +409,7 @@ Region::merge (bool min_coherence, unsigned int min_wc)
     invalidate_cache ();
 
     db::EdgeProcessor ep (m_report_progress, m_progress_desc);
+    ep.set_threads (m_threads);
 
     //  count edges and reserve memory
     size_t n = 0;
@@ -428,6 +465,43 @@ Region::size (Region::coord_type dx, Region::coord_type dy, unsigned int mode)
     m_merged_polygons_valid = false;
     set_valid_polygons ();
 
+  } else if (is_deep () && dx == dy && m_iter_trans.is_ortho () && ! m_deep_layer.store ()->has_complex_instances (m_deep_layer.layout_index ())) {
+
+    //  Hierarchical case - isotropic sizing is invariant against the (simple) instance
+    //  transformations. The sizing value is given in the region's coordinates.
+    db::Coord d = m_iter_trans.inverted ().ctrans (dx);
+
+    if (m_merged_semantics) {
+
+      run_deep_operation (db::SizingLocalOperation (d, d, mode), *this);
+
+    } else {
+
+      db::DeepLayer dl = m_deep_layer.derived ();
+      db::Layout &layout = dl.layout ();
+
+      std::vector<db::Polygon> sized;
+      db::PolygonContainer pc (sized);
+      db::PolygonGenerator pg (pc, false, true);
+      db::SizingPolygonFilter sf (pg, d, d, mode);
+
+      db::Polygon poly;
+      for (db::Layout::iterator c = layout.begin (); c != layout.end (); ++c) {
+
+        sized.clear ();
+        for (db::ShapeIterator s = c->shapes (m_deep_layer.layer ()).begin (db::ShapeIterator::Polygons); ! s.at_end (); ++s) {
+          s->polygon (poly);
+          sf.put (poly);
+        }
+
+        c->shapes (dl.layer ()).insert (sized.begin (), sized.end ());
+
+      }
+
+      set_deep_layer (dl);
+
+    }
+
   } else if (! m_merged_semantics) {
 
     invalidate_cache ();
@@ -453,6 +527,7 @@ Region::size (Region::coord_type dx, Region::coord_type dy, unsigned int mode)
 
     //  Generic case - the size operation will merge first
     db::EdgeProcessor ep (m_report_progress, m_progress_desc);
+    ep.set_threads (m_threads);
 
     //  count edges and reserve memory
     size_t n = 0;
@@ -552,12 +627,18 @@ Region::operator&= (const Region &other)
     //  Result will be nothing
     clear ();
 
+  } else if (is_deep_compatible (other)) {
+
+    //  Hierarchical case
+    run_deep_operation (db::BoolAndOrNotLocalOperation (true), other);
+
   } else {
 
     invalidate_cache ();
 
     //  Generic case
     db::EdgeProcessor ep (m_report_progress, m_progress_desc);
+    ep.set_threads (m_threads);
 
     //  count edges and reserve memory
     size_t n = 0;
@@ -608,12 +689,18 @@ Region::operator-= (const Region &other)
 
     //  Nothing to do
 
+  } else if (is_deep_compatible (other)) {
+
+    //  Hierarchical case
+    run_deep_operation (db::BoolAndOrNotLocalOperation (false), other);
+
   } else {
 
     invalidate_cache ();
 
     //  Generic case
     db::EdgeProcessor ep (m_report_progress, m_progress_desc);
+    ep.set_threads (m_threads);
 
     //  count edges and reserve memory
     size_t n = 0;
@@ -665,12 +752,21 @@ Region::operator^= (const Region &other)
     //  Simplified handling for disjunct case
     *this |= other;
 
+  } else if (is_deep_compatible (other)) {
+
+    //  Hierarchical case: XOR is computed as (A-B)+(B-A)
+    Region b_not_a (other);
+    b_not_a.run_deep_operation (db::BoolAndOrNotLocalOperation (false), *this);
+    run_deep_operation (db::BoolAndOrNotLocalOperation (false), other);
+    *this += b_not_a;
+
   } else {
 
     invalidate_cache ();
 
     //  Generic case
     db::EdgeProcessor ep (m_report_progress, m_progress_desc);
+    ep.set_threads (m_threads);
 
     //  count edges and reserve memory
     size_t n = 0;
@@ -722,12 +818,19 @@ Region::operator|= (const Region &other)
     //  Simplified handling for disjunct case
     *this += other;
 
+  } else if (is_deep_compatible (other)) {
+
+    //  Hierarchical case: a hierarchical result is not merged across cells, hence
+    //  joining is sufficient in merged semantics
+    *this += other;
+
   } else {
 
     invalidate_cache ();
 
     //  Generic case
     db::EdgeProcessor ep (m_report_progress, m_progress_desc);
+    ep.set_threads (m_threads);
 
     //  count edges and reserve memory
     size_t n = 0;
@@ -768,7 +871,14 @@ Region::operator+= (const Region &other)
 {
   invalidate_cache ();
 
-  if (! has_valid_polygons ()) {
+  if (is_deep_compatible (other)) {
+
+    db::DeepLayer dl = m_deep_layer.derived ();
+    dl.layout ().copy_layer (m_deep_layer.layer (), dl.layer ());
+    dl.layout ().copy_layer (other.m_deep_layer.layer (), dl.layer ());
+    set_deep_layer (dl);
+
+  } else if (! has_valid_polygons ()) {
 
     m_polygons.clear ();
 
@@ -816,6 +926,7 @@ Region
 Region::selected_interacting_generic (const Region &other, int mode, bool touching, bool inverse) const
 {
   db::EdgeProcessor ep (m_report_progress, m_progress_desc);
+  ep.set_threads (m_threads);
 
   //  shortcut
   if (empty () || other.empty ()) {
@@ -877,6 +988,7 @@ Region::select_interacting_generic (const Region &other, int mode, bool touching
   }
 
   db::EdgeProcessor ep (m_report_progress, m_progress_desc);
+  ep.set_threads (m_threads);
 
   for (const_iterator p = other.begin (); ! p.at_end (); ++p) {
     if (p->box ().touches (bbox ())) {
@@ -1112,6 +1224,7 @@ void
 Region::init ()
 {
   m_report_progress = false;
+  m_threads = 0;
   m_bbox_valid = true;
   m_is_merged = true;
   m_merged_semantics = true;
@@ -1133,6 +1246,12 @@ Region::enable_progress (const std::string &progress_desc)
   m_progress_desc = progress_desc;
 }
 
+void 
+Region::set_threads (size_t n)
+{
+  m_threads = n;
+}
+
 void
 Region::invalidate_cache ()
 {
@@ -1173,6 +1292,7 @@ Region::ensure_valid_polygons () const
 
     //  set valid polygons
     m_iter = db::RecursiveShapeIterator ();
+    m_deep_layer.reset ();
 
   }
 }
@@ -1181,15 +1301,53 @@ void
 Region::set_valid_polygons ()
 {
   m_iter = db::RecursiveShapeIterator ();
+  m_deep_layer.reset ();
+}
+
+bool
+Region::is_deep_compatible (const Region &other) const
+{
+  return is_deep () && other.is_deep () && m_deep_layer.is_compatible (other.m_deep_layer) && m_iter_trans == other.m_iter_trans;
+}
+
+void
+Region::set_deep_layer (const db::DeepLayer &dl)
+{
+  invalidate_cache ();
+  m_polygons.clear ();
+  m_deep_layer = dl;
+  m_iter = dl.iter ();
+  m_is_merged = false;
+}
+
+void
+Region::run_deep_operation (const db::LocalOperation &op, const Region &other)
+{
+  db::DeepLayer dl = m_deep_layer.derived ();
+
+  db::HierarchicalProcessor proc (&dl.layout (), &dl.initial_cell ());
+  if (m_report_progress) {
+    proc.enable_progress (m_progress_desc);
+  }
+  proc.run (op, m_deep_layer.layer (), other.m_deep_layer.layer (), dl.layer ());
+
+  set_deep_layer (dl);
 }
 
 void 
 Region::ensure_bbox_valid () const
 {
   if (! m_bbox_valid) {
-    m_bbox = db::Box ();
-    for (const_iterator p = begin (); ! p.at_end (); ++p) {
-      m_bbox += p->box ();
+    if (is_deep ()) {
+      //  the hierarchical bounding box is cheap to compute
+      const db::Layout &layout = m_deep_layer.layout ();
+      layout.update ();
+      m_bbox = m_deep_layer.initial_cell ().bbox (m_deep_layer.layer ()).transformed (m_iter_trans);
+    } else {
+      m_bbox = db::Box ();
+      for (const_iterator p = begin (); ! p.at_end (); ++p) {
+        m_bbox += p->box ();
+      }
     }
     m_bbox_valid = true;
   }
@@ -1235,6 +1393,7 @@ Region::ensure_merged_polygons_valid () const
     m_merged_polygons.clear ();
 
     db::EdgeProcessor ep (m_report_progress, m_progress_desc);
+    ep.set_threads (m_threads);
 
     //  count edges and reserve memory
     size_t n = 0;
@@ -1330,6 +1489,7 @@ Region::clear ()
   m_merged_polygons_valid = true;
   m_iter = db::RecursiveShapeIterator ();
   m_iter_trans = db::ICplxTrans ();
+  m_deep_layer.reset ();
 }
 
 namespace {
@@ -1343,11 +1503,52 @@ class Edge2EdgeCheck
 public:
   Edge2EdgeCheck (const EdgeRelationFilter &check, EdgePairs &output, bool different_polygons, bool requires_different_layers)
     : mp_check (&check), mp_output (&output), m_requires_different_layers (requires_different_layers), m_different_polygons (different_polygons), 
-      m_pass (0)
+      m_pass (0), mp_master (0)
   {
     m_distance = check.distance ();
   }
 
+  /**
+   *  @brief Joins the violations found by another check in the first pass
+   *
+   *  This method is used to collect the results of checks running on different partitions.
+   */
+  void join (const Edge2EdgeCheck &other)
+  {
+    size_t offset = m_ep.size ();
+    m_ep.insert (m_ep.end (), other.m_ep.begin (), other.m_ep.end ());
+    for (std::multimap<std::pair<db::Edge, size_t>, size_t>::const_iterator i = other.m_e2ep.begin (); i != other.m_e2ep.end (); ++i) {
+      m_e2ep.insert (std::make_pair (i->first, i->second + offset));
+    }
+  }
+
+  /**
+   *  @brief Prepares this check for running the shielding pass on the violations of the master check
+   *
+   *  The master check must have been prepared for the shielding pass. It is not modified
+   *  by this check, so multiple checks can share the same master.
+   */
+  void prepare_shielding_pass (const Edge2EdgeCheck &master)
+  {
+    mp_master = &master;
+    m_pass = 1;
+    m_ep_discarded.clear ();
+    m_ep_discarded.resize (master.m_ep.size (), false);
+  }
+
+  /**
+   *  @brief Joins the discarded flags of a check prepared with "prepare_shielding_pass"
+   */
+  void join_discarded (const Edge2EdgeCheck &other)
+  {
+    tl_assert (other.m_ep_discarded.size () == m_ep_discarded.size ());
+    for (size_t i = 0; i < m_ep_discarded.size (); ++i) {
+      if (other.m_ep_discarded [i]) {
+        m_ep_discarded [i] = true;
+      }
+    }
+  }
+
   bool prepare_next_pass ()
   {
     ++m_pass;
@@ -1413,12 +1614,15 @@ public:
       //  EdgePair - because of "whole_edge" it may not reflect the part actually
       //  violating the distance.
       
+      const std::multimap<std::pair<db::Edge, size_t>, size_t> &e2ep = mp_master ? mp_master->m_e2ep : m_e2ep;
+      const std::vector<db::EdgePair> &eps = mp_master ? mp_master->m_ep : m_ep;
+
       std::vector<size_t> n1, n2;
 
       for (unsigned int p = 0; p < 2; ++p) {
 
         std::pair<db::Edge, size_t> k (*o1, p1);
-        for (std::multimap<std::pair<db::Edge, size_t>, size_t>::const_iterator i = m_e2ep.find (k); i != m_e2ep.end () && i->first == k; ++i) {
+        for (std::multimap<std::pair<db::Edge, size_t>, size_t>::const_iterator i = e2ep.find (k); i != e2ep.end () && i->first == k; ++i) {
           n1.push_back (i->second);
         }
 
@@ -1437,7 +1641,7 @@ public:
 
         for (std::vector<size_t>::const_iterator i = nn.begin (); i != nn.end (); ++i) {
           if (! m_ep_discarded [*i]) {
-            db::EdgePair ep = m_ep [*i].normalized ();
+            db::EdgePair ep = eps [*i].normalized ();
             if (db::Edge (ep.first ().p1 (), ep.second ().p2 ()).intersect (*o2) && 
                 db::Edge (ep.second ().p1 (), ep.first ().p2 ()).intersect (*o2)) {
               m_ep_discarded [*i] = true;
@@ -1505,6 +1709,7 @@ private:
   std::multimap<std::pair<db::Edge, size_t>, size_t> m_e2ep;
   std::vector<bool> m_ep_discarded;
   unsigned int m_pass;
+  const Edge2EdgeCheck *mp_master;
 };
 
 /**
@@ -1584,31 +1789,249 @@ private:
   std::vector<db::Edge> m_edges;
 };
 
+
+/**
+ *  @brief An interaction between two polygons or the end of the interactions of one polygon
+ *
+ *  For the latter ("finish"), the second polygon is 0.
+ */
+struct PolygonInteraction
+{
+  PolygonInteraction (const db::Polygon *_o1, size_t _p1, const db::Polygon *_o2, size_t _p2)
+    : o1 (_o1), p1 (_p1), o2 (_o2), p2 (_p2)
+  {
+    //  .. nothing yet ..
+  }
+
+  const db::Polygon *o1;
+  size_t p1;
+  const db::Polygon *o2;
+  size_t p2;
+};
+
+/**
+ *  @brief A receiver recording the interactions delivered by the polygon box scanner
+ */
+class PolygonInteractionRecorder
+  : public db::box_scanner_receiver<db::Polygon, size_t>
+{
+public:
+  PolygonInteractionRecorder (std::vector<PolygonInteraction> &interactions)
+    : mp_interactions (&interactions)
+  {
+    //  .. nothing yet ..
+  }
+
+  void finish (const db::Polygon *o, size_t p)
+  {
+    mp_interactions->push_back (PolygonInteraction (o, p, 0, 0));
+  }
+
+  void add (const db::Polygon *o1, size_t p1, const db::Polygon *o2, size_t p2)
+  {
+    mp_interactions->push_back (PolygonInteraction (o1, p1, o2, p2));
+  }
+
+private:
+  std::vector<PolygonInteraction> *mp_interactions;
+};
+
+/**
+ *  @brief A job running the polygon checks on slices of a list of interactions in multiple threads
+ *
+ *  Each slice has a check object of its own. Since the slices are contiguous, joining the 
+ *  results of the slices in order gives the same results in the same order as running
+ *  a single check over the whole list.
+ */
+class PolygonCheckJob
+  : public tl::JobBase
+{
+public:
+  typedef std::vector<PolygonInteraction> interaction_list_type;
+
+  PolygonCheckJob (int nworkers, const interaction_list_type *interactions)
+    : tl::JobBase (nworkers), mp_interactions (interactions), m_done (0)
+  {
+    //  .. nothing yet ..
+  }
+
+  /**
+   *  @brief Runs the checks, one for each slice
+   */
+  void run (std::vector<Edge2EdgeCheck> &checks, tl::RelativeProgress *progress)
+  {
+    m_checks.clear ();
+    for (std::vector<Edge2EdgeCheck>::iterator c = checks.begin (); c != checks.end (); ++c) {
+      m_checks.push_back (&*c);
+    }
+
+    m_done = 0;
+    for (size_t i = 0; i < m_checks.size (); ++i) {
+      schedule (new PolygonCheckTask (i));
+    }
+
+    try {
+
+      start ();
+      while (is_running ()) {
+        //  This may throw an exception, if the cancel button has been pressed.
+        if (progress) {
+          progress->set (done ());
+        }
+        wait (100);
+      }
+
+    } catch (tl::BreakException &ex) {
+      terminate ();
+      throw ex;
+    } catch (tl::Exception &ex) {
+      terminate ();
+      throw ex;
+    }
+
+    if (has_error ()) {
+      throw tl::Exception (tl::to_string (QObject::tr ("Errors occured during processing. First error message says:\n")) + error_messages ().front ());
+    }
+  }
+
+  void process (size_t n)
+  {
+    Poly2PolyCheck poly_check (*m_checks [n]);
+
+    size_t from = (n * mp_interactions->size ()) / m_checks.size ();
+    size_t to = ((n + 1) * mp_interactions->size ()) / m_checks.size ();
+    for (size_t i = from; i < to; ++i) {
+      const PolygonInteraction &pi = (*mp_interactions) [i];
+      if (pi.o2) {
+        poly_check.add (pi.o1, pi.p1, pi.o2, pi.p2);
+      } else {
+        poly_check.finish (pi.o1, pi.p1);
+      }
+    }
+
+    QMutexLocker locker (&m_mutex);
+    ++m_done;
+  }
+
+  size_t done ()
+  {
+    QMutexLocker locker (&m_mutex);
+    return m_done;
+  }
+
+  virtual tl::Worker *create_worker ();
+
+private:
+  class PolygonCheckTask
+    : public tl::Task
+  {
+  public:
+    PolygonCheckTask (size_t n)
+      : m_n (n)
+    {
+      //  .. nothing yet ..
+    }
+
+    size_t n () const
+    {
+      return m_n;
+    }
+
+  private:
+    size_t m_n;
+  };
+
+  friend class PolygonCheckWorker;
+
+  const interaction_list_type *mp_interactions;
+  std::vector<Edge2EdgeCheck *> m_checks;
+  size_t m_done;
+  QMutex m_mutex;
+};
+
+class PolygonCheckWorker
+  : public tl::Worker
+{
+public:
+  PolygonCheckWorker (PolygonCheckJob *job)
+    : tl::Worker (), mp_job (job)
+  {
+    //  .. nothing yet ..
+  }
+
+  void perform_task (tl::Task *task)
+  {
+    PolygonCheckJob::PolygonCheckTask *check_task = dynamic_cast<PolygonCheckJob::PolygonCheckTask *> (task);
+    if (check_task) {
+      mp_job->process (check_task->n ());
+    }
+  }
+
+private:
+  PolygonCheckJob *mp_job;
+};
+
+tl::Worker *
+PolygonCheckJob::create_worker ()
+{
+  return new PolygonCheckWorker (this);
 }
 
-EdgePairs 
-Region::run_check (db::edge_relation_type rel, bool different_polygons, const Region *other, db::Coord d, bool whole_edges, metrics_type metrics, double ignore_angle, distance_type min_projection, distance_type max_projection) const
+//  The number of slices per thread (more slices balance the load better)
+const size_t check_slices_per_thread = 4;
+
+/**
+ *  @brief Runs the check passes on slices of the given interactions
+ *
+ *  The first pass collects the violations per slice. The shielding pass needs all violations, 
+ *  so it starts when the first pass has finished on all slices.
+ */
+static void
+run_sliced_check (const PolygonCheckJob::interaction_list_type &interactions, Edge2EdgeCheck &edge_check, size_t threads, bool report_progress, const std::string &progress_desc)
 {
-  EdgePairs result;
+  size_t n = std::max (size_t (1), std::min (interactions.size (), threads * check_slices_per_thread));
 
-  db::box_scanner<db::Polygon, size_t> scanner (m_report_progress, m_progress_desc);
-  scanner.reserve (size () + (other ? other->size () : 0));
+  std::auto_ptr<tl::RelativeProgress> progress;
+  if (report_progress) {
+    progress.reset (new tl::RelativeProgress (progress_desc.empty () ? tl::to_string (QObject::tr ("Processing")) : progress_desc, n, 1));
+  }
 
-  ensure_valid_merged_polygons ();
-  size_t n = 0;
-  for (const_iterator p = begin_merged (); ! p.at_end (); ++p) {
-    scanner.insert (&*p, n); 
-    n += 2;
+  PolygonCheckJob job (int (threads), &interactions);
+
+  //  the slice checks are derived from the check before it runs the first pass
+  const Edge2EdgeCheck proto (edge_check);
+
+  {
+    std::vector<Edge2EdgeCheck> checks (n, proto);
+    job.run (checks, progress.get ());
+    for (std::vector<Edge2EdgeCheck>::const_iterator c = checks.begin (); c != checks.end (); ++c) {
+      edge_check.join (*c);
+    }
   }
 
-  if (other) {
-    other->ensure_valid_merged_polygons ();
-    n = 1;
-    for (const_iterator p = other->begin_merged (); ! p.at_end (); ++p) {
-      scanner.insert (&*p, n); 
-      n += 2;
+  if (edge_check.prepare_next_pass ()) {
+
+    std::vector<Edge2EdgeCheck> checks (n, proto);
+    for (std::vector<Edge2EdgeCheck>::iterator c = checks.begin (); c != checks.end (); ++c) {
+      c->prepare_shielding_pass (edge_check);
+    }
+
+    job.run (checks, progress.get ());
+    for (std::vector<Edge2EdgeCheck>::const_iterator c = checks.begin (); c != checks.end (); ++c) {
+      edge_check.join_discarded (*c);
     }
+
+    edge_check.prepare_next_pass ();
+
   }
+}
+
+}
+
+EdgePairs 
+Region::run_check (db::edge_relation_type rel, bool different_polygons, const Region *other, db::Coord d, bool whole_edges, metrics_type metrics, double ignore_angle, distance_type min_projection, distance_type max_projection) const
+{
+  EdgePairs result;
 
   EdgeRelationFilter check (rel, d, metrics);
   check.set_include_zero (other != 0);
@@ -1618,11 +2041,68 @@ Region::run_check (db::edge_relation_type rel, bool different_polygons, const Re
   check.set_max_projection (max_projection);
 
   Edge2EdgeCheck edge_check (check, result, different_polygons, other != 0);
-  Poly2PolyCheck poly_check (edge_check);
 
-  do {
-    scanner.process (poly_check, d, db::box_convert<db::Polygon> ());
-  } while (edge_check.prepare_next_pass ());
+  ensure_valid_merged_polygons ();
+  if (other) {
+    other->ensure_valid_merged_polygons ();
+  }
+
+  if (m_threads > 0) {
+
+    //  multi-threaded: the polygon scanner runs once and records the interactions. The edge checks
+    //  on the interactions, which take most of the time, run in parallel on slices of this list.
+    //  Joining the results of the slices in order gives the same edge pairs in the same order
+    //  as the single-threaded check.
+
+    db::box_scanner<db::Polygon, size_t> scanner (m_report_progress, m_progress_desc);
+    scanner.reserve (size () + (other ? other->size () : 0));
+
+    size_t n = 0;
+    for (const_iterator p = begin_merged (); ! p.at_end (); ++p) {
+      scanner.insert (&*p, n); 
+      n += 2;
+    }
+
+    if (other) {
+      n = 1;
+      for (const_iterator p = other->begin_merged (); ! p.at_end (); ++p) {
+        scanner.insert (&*p, n); 
+        n += 2;
+      }
+    }
+
+    PolygonCheckJob::interaction_list_type interactions;
+    PolygonInteractionRecorder recorder (interactions);
+    scanner.process (recorder, d, db::box_convert<db::Polygon> ());
+
+    run_sliced_check (interactions, edge_check, m_threads, m_report_progress, m_progress_desc);
+
+  } else {
+
+    db::box_scanner<db::Polygon, size_t> scanner (m_report_progress, m_progress_desc);
+    scanner.reserve (size () + (other ? other->size () : 0));
+
+    size_t n = 0;
+    for (const_iterator p = begin_merged (); ! p.at_end (); ++p) {
+      scanner.insert (&*p, n); 
+      n += 2;
+    }
+
+    if (other) {
+      n = 1;
+      for (const_iterator p = other->begin_merged (); ! p.at_end (); ++p) {
+        scanner.insert (&*p, n); 
+        n += 2;
+      }
+    }
+
+    Poly2PolyCheck poly_check (edge_check);
+
+    do {
+      scanner.process (poly_check, d, db::box_convert<db::Polygon> ());
+    } while (edge_check.prepare_next_pass ());
+
+  }
 
   return result;
 }
@@ -1639,15 +2119,37 @@ Region::run_single_polygon_check (db::edge_relation_type rel, db::Coord d, bool
   check.set_max_projection (max_projection);
 
   Edge2EdgeCheck edge_check (check, result, false, false);
-  Poly2PolyCheck poly_check (edge_check);
 
-  do {
+  if (m_threads > 0) {
+
+    //  multi-threaded: the polygons are independent, so they can be checked in slices
+
+    ensure_valid_merged_polygons ();
+
+    PolygonCheckJob::interaction_list_type interactions;
+    interactions.reserve (size ());
+
     size_t n = 0;
     for (const_iterator p = begin_merged (); ! p.at_end (); ++p) {
-      poly_check.finish (&*p, n); 
+      interactions.push_back (PolygonInteraction (&*p, n, 0, 0));
       n += 2;
     }
-  } while (edge_check.prepare_next_pass ());
+
+    run_sliced_check (interactions, edge_check, m_threads, m_report_progress, m_progress_desc);
+
+  } else {
+
+    Poly2PolyCheck poly_check (edge_check);
+
+    do {
+      size_t n = 0;
+      for (const_iterator p = begin_merged (); ! p.at_end (); ++p) {
+        poly_check.finish (&*p, n); 
+        n += 2;
+      }
+    } while (edge_check.prepare_next_pass ());
+
+  }
 
   return result;
 }
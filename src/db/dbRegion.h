@@ -38,11 +38,14 @@
 #include "dbEdges.h"
 #include "dbRecursiveShapeIterator.h"
 #include "dbEdgePairs.h"
+#include "dbDeepShapeStore.h"
 #include "tlString.h"
 #include "gsiObject.h"
 
 namespace db {
 
+class LocalOperation;
+
 /**
  *  @brief A perimeter filter for use with Region::filter or Region::filtered
  *
@@ -475,6 +478,25 @@ public:
    */
   Region (const RecursiveShapeIterator &si, const db::ICplxTrans &trans, bool merged_semantics = true);
 
+  /**
+   *  @brief Constructor from a RecursiveShapeIterator providing a deep representation
+   *
+   *  This version will create a hierarchical ("deep") region. The shapes delivered
+   *  by the iterator are copied into the deep shape store, maintaining the hierarchy.
+   *  Boolean operations and sizing on deep regions of the same store and origin will
+   *  be performed hierarchically (see is_deep). The deep shape store must be kept
+   *  alive as long as the region is used.
+   *
+   *  If the iterator cannot be represented hierarchically (i.e. because it has a
+   *  search region or depth limits), a normal region is created.
+   */
+  Region (const RecursiveShapeIterator &si, DeepShapeStore &dss);
+
+  /**
+   *  @brief Constructor from a RecursiveShapeIterator providing a deep representation with a transformation
+   */
+  Region (const RecursiveShapeIterator &si, DeepShapeStore &dss, const db::ICplxTrans &trans, bool merged_semantics = true);
+
   /**
    *  @brief Enable progress reporting
    *
@@ -487,6 +509,23 @@ public:
    */
   void disable_progress ();
 
+  /**
+   *  @brief Specifies the number of threads to use for merge, boolean, sizing and check operations
+   *
+   *  See db::EdgeProcessor::set_threads for details. The checks run the edge checks of the 
+   *  interacting polygons in parallel and deliver the same edge pairs in the same order as 
+   *  the single-threaded checks. A value of 0 (the default) means single-threaded operation.
+   */
+  void set_threads (size_t n);
+
+  /**
+   *  @brief Gets the number of threads used
+   */
+  size_t threads () const
+  {
+    return m_threads;
+  }
+
   /**
    *  @brief Iterator of the region
    *
@@ -730,6 +769,7 @@ public:
     m_merged_polygons.clear ();
     m_is_merged = m_merged_semantics;
     m_iter = db::RecursiveShapeIterator ();
+    m_deep_layer.reset ();
     return *this;
   }
 
@@ -1476,6 +1516,20 @@ public:
     return db::RecursiveShapeIterator (m_iter).at_end ();
   }
 
+  /**
+   *  @brief Returns true, if the region is a deep (hierarchical) region
+   *
+   *  Deep regions keep their polygons inside a DeepShapeStore. Boolean operations
+   *  and sizing between deep regions from the same store and origin will be
+   *  performed hierarchically. The results of such operations are deep regions
+   *  again. Deep results are not merged across cell boundaries. Other operations
+   *  will turn a deep region into a flat one.
+   */
+  bool is_deep () const
+  {
+    return m_deep_layer.is_valid () && ! has_valid_polygons ();
+  }
+
   /**
    *  @brief Ensures the region has valid polygons
    *
@@ -1524,10 +1578,15 @@ private:
   mutable bool m_merged_polygons_valid;
   mutable db::RecursiveShapeIterator m_iter;
   db::ICplxTrans m_iter_trans;
+  mutable db::DeepLayer m_deep_layer;
   bool m_report_progress;
   std::string m_progress_desc;
+  size_t m_threads;
 
   void init ();
+  bool is_deep_compatible (const Region &other) const;
+  void set_deep_layer (const db::DeepLayer &dl);
+  void run_deep_operation (const db::LocalOperation &op, const Region &other);
   void invalidate_cache ();
   void set_valid_polygons ();
   void ensure_bbox_valid () const;
@@ -178,6 +178,24 @@ public:
     m_processor.disable_progress ();
   }
 
+  /**
+   *  @brief Specifies the number of threads to use
+   *
+   *  See db::EdgeProcessor::set_threads for details.
+   */
+  void set_threads (size_t n)
+  {
+    m_processor.set_threads (n);
+  }
+
+  /**
+   *  @brief Gets the number of threads used
+   */
+  size_t threads () const
+  {
+    return m_processor.threads ();
+  }
+
   /**
    *  @brief Insert a shape without transformation
    */
@@ -191,17 +191,57 @@ Shapes::array_repository () const
 void
 Shapes::invalidate_state ()
 {
-  if (! is_dirty ()) {
-    set_dirty (true);
-    if (layout () && cell ()) {
-      unsigned int index = cell ()->index_of_shapes (this);
+  //  the region of the change is not known
+  invalidate_state (db::Box::world ());
+}
+
+void
+Shapes::invalidate_state (const db::Box &region)
+{
+  invalidate_state (&region, &region + 1);
+}
+
+void
+Shapes::invalidate_state (const db::Box *from, const db::Box *to)
+{
+  db::Layout *ly = layout ();
+
+  //  Loading a lazy cell does not change the appearance of the layout: the cell's bounding
+  //  boxes are known already. Hence such changes are not recorded.
+  bool record = ly && ly->records_changes () && ! cell ()->is_lazy ();
+
+  if (! is_dirty () || record) {
+
+    unsigned int index = std::numeric_limits<unsigned int>::max ();
+    if (ly) {
+      index = cell ()->index_of_shapes (this, m_index_hint);
+      m_index_hint = index;
+    }
+
+    if (! is_dirty ()) {
+      set_dirty (true);
       if (index != std::numeric_limits<unsigned int>::max ()) {
-        layout ()->invalidate_bboxes (index);
+        ly->invalidate_bboxes (index);
       }
     }
+
+    //  report the regions of the change to the layout
+    if (record && index != std::numeric_limits<unsigned int>::max ()) {
+      for (const db::Box *r = from; r != to; ++r) {
+        ly->register_change (cell ()->cell_index (), index, *r);
+      }
+    }
+
   }
 }
 
+bool
+Shapes::records_changes () const
+{
+  db::Layout *ly = layout ();
+  return ly && ly->records_changes ();
+}
+
 void  
 Shapes::swap (Shapes &d)
 {
@@ -858,12 +898,24 @@ void
 Shapes::clear ()
 {
   if (!m_layers.empty ()) {
+
+    if (records_changes ()) {
+      db::Box region;
+      for (tl::vector<LayerBase *>::const_iterator l = m_layers.begin (); l != m_layers.end (); ++l) {
+        (*l)->update_bbox ();
+        region += (*l)->bbox ();
+      }
+      invalidate_state (region);  //  HINT: must come before the change is done!
+    } else {
+      invalidate_state ();  //  HINT: must come before the change is done!
+    }
+
     for (tl::vector<LayerBase *>::const_iterator l = m_layers.begin (); l != m_layers.end (); ++l) {
       (*l)->clear (this, manager ());
       delete *l;
     }
-    invalidate_state ();  //  HINT: must come before the change is done!
     m_layers.clear ();
+
   }
 }
 
@@ -913,6 +965,13 @@ void Shapes::sort ()
   }
 }
 
+void Shapes::pack (db::Arena *arena) 
+{
+  for (tl::vector<LayerBase *>::const_iterator l = m_layers.begin (); l != m_layers.end (); ++l) {
+    (*l)->pack (arena);
+  }
+}
+
 void 
 Shapes::redo (db::Op *op)
 {
@@ -1023,7 +1082,7 @@ Shapes::replace_prop_id (const Sh *pos, db::properties_id_type prop_id)
     if (manager () && manager ()->transacting ()) {
       db::layer_op<Sh, db::stable_layer_tag>::queue_or_append (manager (), this, false /*not insert*/, *pos);
     }
-    invalidate_state ();  //  HINT: must come before the change is done!
+    invalidate_state_for (*pos);  //  HINT: must come before the change is done!
     ((Sh *) pos)->properties_id (prop_id);
     if (manager () && manager ()->transacting ()) {
       db::layer_op<Sh, db::stable_layer_tag>::queue_or_append (manager (), this, true /*insert*/, *pos);
@@ -1043,7 +1102,7 @@ Shapes::replace_prop_id_iter (typename db::object_tag<Sh>, const Iter &iter, db:
     db::layer_op<Sh, db::stable_layer_tag>::queue_or_append (manager (), this, false /*not insert*/, *iter);
   }
   db::object_with_properties <Sh> wp (*iter, prop_id);
-  invalidate_state ();  //  HINT: must come before the change is done!
+  invalidate_state_for (wp);  //  HINT: must come before the change is done!
   get_layer<Sh, db::stable_layer_tag> ().erase (iter); 
   if (manager () && manager ()->transacting ()) {
     db::layer_op<db::object_with_properties <Sh>, db::stable_layer_tag>::queue_or_append (manager (), this, true /*insert*/, wp);
@@ -1110,7 +1169,7 @@ Shapes::replace_member_with_props (typename db::object_tag<Sh> tag, const shape_
         db::layer_op<Sh, db::stable_layer_tag>::queue_or_append (manager (), this, false /*not insert*/, *ref.basic_ptr (tag));
       }
 
-      invalidate_state ();  //  HINT: must come before the change is done!
+      invalidate_state_for (*ref.basic_ptr (tag), sh);  //  HINT: must come before the change is done!
 
       get_layer<Sh, db::stable_layer_tag> ().replace (ref.basic_iter (tag), sh);
 
@@ -1134,7 +1193,7 @@ Shapes::replace_member_with_props (typename db::object_tag<Sh> tag, const shape_
         db::layer_op<Sh, db::stable_layer_tag>::queue_or_append (manager (), this, false /*not insert*/, *ref.basic_ptr (tag));
       }
 
-      invalidate_state ();  //  HINT: must come before the change is done!
+      invalidate_state_for (*ref.basic_ptr (tag), sh);  //  HINT: must come before the change is done!
 
       if (needs_translate (tag)) {
 
@@ -1162,7 +1221,7 @@ Shapes::replace_member_with_props (typename db::object_tag<Sh> tag, const shape_
         db::layer_op<db::object_with_properties<Sh>, db::stable_layer_tag>::queue_or_append (manager (), this, false /*not insert*/, *ref.basic_ptr (typename db::object_with_properties<Sh>::tag ()));
       }
 
-      invalidate_state ();  //  HINT: must come before the change is done!
+      invalidate_state_for<Sh> (*ref.basic_ptr (typename db::object_with_properties<Sh>::tag ()), sh);  //  HINT: must come before the change is done!
 
       db::object_with_properties<Sh> swp;
       swp.translate (db::object_with_properties<Sh> (sh, ref.prop_id ()), shape_repository (), array_repository ());
@@ -35,6 +35,8 @@
 #include "tlVector.h"
 #include "tlUtils.h"
 
+#include <limits>
+
 namespace db 
 {
 
@@ -48,6 +50,7 @@ template <class Coord> class generic_polygon_edge_iterator;
 template <class Coord> class generic_repository;
 typedef generic_repository<db::Coord> GenericRepository;
 class ArrayRepository;
+class Arena;
 
 /**
  *  @brief A generic shape iterator
@@ -447,6 +450,7 @@ public:
   virtual size_t size () const = 0;
   virtual bool empty () const = 0;
   virtual void sort () = 0;
+  virtual void pack (db::Arena *arena) = 0;
   virtual void clear (Shapes *target, db::Manager *manager) = 0;
   virtual LayerBase *clone (Shapes *target, db::Manager *manager) const = 0;
   virtual void translate_into (Shapes *target, GenericRepository &rep, ArrayRepository &array_rep) const = 0;
@@ -500,7 +504,7 @@ public:
    *  are created in editable mode to allow insertion and deletion of shapes by default.
    */
   Shapes ()
-    : db::Object (0), mp_cell (0)
+    : db::Object (0), mp_cell (0), m_index_hint (std::numeric_limits<unsigned int>::max ())
   {
     set_editable (true);
   }
@@ -513,7 +517,7 @@ public:
    *  or insert-once mode.
    */
   Shapes (bool editable)
-    : db::Object (0), mp_cell (0)
+    : db::Object (0), mp_cell (0), m_index_hint (std::numeric_limits<unsigned int>::max ())
   {
     set_editable (editable);
   }
@@ -529,7 +533,8 @@ public:
    */
   Shapes (db::Manager *manager, db::Cell *cell, bool editable) 
     : db::Object (manager), 
-      mp_cell (cell)
+      mp_cell (cell),
+      m_index_hint (std::numeric_limits<unsigned int>::max ())
   {
     set_dirty (false);
     set_editable (editable);
@@ -557,7 +562,8 @@ public:
    */
   Shapes (const Shapes &d) 
     : db::Object (d), 
-      mp_cell (d.mp_cell)  //  implicitly copies "dirty" and "editable" 
+      mp_cell (d.mp_cell),  //  implicitly copies "dirty" and "editable" 
+      m_index_hint (std::numeric_limits<unsigned int>::max ())
   {
     operator= (d);
   }
@@ -735,9 +741,9 @@ public:
           (*l)->deref_into (this, pm_delegate);
         }
       } else {
-        //  translate and transform into this
+        //  translate into this
         for (tl::vector<LayerBase *>::const_iterator l = d.m_layers.begin (); l != d.m_layers.end (); ++l) {
-          (*l)->transform_into (this, shape_repository (), array_repository (), pm_delegate);
+          (*l)->translate_into (this, shape_repository (), array_repository (), pm_delegate);
         }
       }
 
@@ -772,7 +778,7 @@ public:
         db::layer_op<Sh, db::unstable_layer_tag>::queue_or_append (manager (), this, true /*insert*/, sh);
       }
     }
-    invalidate_state ();  //  HINT: must come before the change is done!
+    invalidate_state_for (sh);  //  HINT: must come before the change is done!
     if (is_editable ()) {
       return shape_type (this, get_layer<Sh, db::stable_layer_tag> ().insert (sh));
     } else {
@@ -811,7 +817,7 @@ public:
       if (manager () && manager ()->transacting ()) {
         db::layer_op<db::array<Obj, Trans>, db::unstable_layer_tag>::queue_or_append (manager (), this, true /*insert*/, arr);
       }
-      invalidate_state ();  //  HINT: must come before the change is done!
+      invalidate_state_for_array (arr);  //  HINT: must come before the change is done!
       return shape_type (this, *get_layer<db::array<Obj, Trans>, db::unstable_layer_tag> ().insert (arr));
 
     }
@@ -848,7 +854,7 @@ public:
       if (manager () && manager ()->transacting ()) {
         db::layer_op< db::object_with_properties< db::array<Obj, Trans> >, db::unstable_layer_tag>::queue_or_append (manager (), this, true /*insert*/, arr);
       }
-      invalidate_state ();  //  HINT: must come before the change is done!
+      invalidate_state_for_array<db::array<Obj, Trans> > (arr);  //  HINT: must come before the change is done!
       return shape_type (this, *get_layer< db::object_with_properties< db::array<Obj, Trans> >, db::unstable_layer_tag> ().insert (arr));
 
     }
@@ -872,7 +878,7 @@ public:
         db::layer_op<value_type, db::unstable_layer_tag>::queue_or_append (manager (), this, true /*insert*/, from, to);
       }
     }
-    invalidate_state ();
+    invalidate_state_for_range<value_type> (from, to);
     if (is_editable ()) {
       get_layer<value_type, db::stable_layer_tag> ().insert (from, to);
     } else {
@@ -963,7 +969,7 @@ public:
     if (manager () && manager ()->transacting ()) {
       db::layer_op<typename Tag::object_type, StableTag>::queue_or_append (manager (), this, false /*not insert*/, *pos);
     }
-    invalidate_state ();  //  HINT: must come before the change is done!
+    invalidate_state_for (*pos);  //  HINT: must come before the change is done!
     get_layer<typename Tag::object_type, StableTag> ().erase (pos);
   }
 
@@ -1026,7 +1032,7 @@ public:
     if (manager () && manager ()->transacting ()) {
       db::layer_op<typename Tag::object_type, StableTag>::queue_or_append (manager (), this, false /*not insert*/, from, to);
     }
-    invalidate_state ();  //  HINT: must come before the change is done!
+    invalidate_state_for_range<typename Tag::object_type> (from, to);  //  HINT: must come before the change is done!
     get_layer<typename Tag::object_type, StableTag> ().erase (from, to);
   }
 
@@ -1052,7 +1058,7 @@ public:
     if (manager () && manager ()->transacting ()) {
       db::layer_op<typename Tag::object_type, StableTag>::queue_or_append (manager (), this, false /*not insert*/, first, last, true /*dummy*/);
     }
-    invalidate_state ();  //  HINT: must come before the change is done!
+    invalidate_state_for_positions<typename Tag::object_type> (first, last);  //  HINT: must come before the change is done!
     get_layer<typename Tag::object_type, StableTag> ().erase_positions (first, last);
   }
 
@@ -1165,6 +1171,16 @@ public:
    */
   void sort ();
 
+  /**
+   *  @brief Sorts and packs the trees
+   *
+   *  Packing moves the points of the polygons of each layer into a 
+   *  single buffer (see db::layer::pack). This is intended for collections 
+   *  which are mostly read. Any modification of a layer will unpack it again.
+   *  If an arena is given, the buffers are allocated from the arena.
+   */
+  void pack (db::Arena *arena = 0);
+
   /**
    *  @brief Clears the collection
    */
@@ -1426,13 +1442,87 @@ public:
 
 private:
   friend class ShapeIterator;
+  friend class LazyCellLoader;
 
   tl::vector<LayerBase *> m_layers;
   db::Cell *mp_cell;  //  HINT: contains "dirty" in bit 0 and "editable" in bit 1
+  unsigned int m_index_hint;  //  the layer index inside the cell as found last time
 
   void invalidate_state ();
+  void invalidate_state (const db::Box &region);
+  void invalidate_state (const db::Box *from, const db::Box *to);
+  bool records_changes () const;
   void do_insert (const Shapes &d);
 
+  //  invalidates the state and reports the region of the given object as changed
+  template <class Sh>
+  void invalidate_state_for (const Sh &sh)
+  {
+    if (records_changes ()) {
+      invalidate_state (db::box_convert<Sh> () (sh));
+    } else {
+      invalidate_state ();
+    }
+  }
+
+  //  invalidates the state and reports the regions of the given objects as changed (when replacing one by the other)
+  template <class Sh>
+  void invalidate_state_for (const Sh &sh1, const Sh &sh2)
+  {
+    if (records_changes ()) {
+      db::box_convert<Sh> bc;
+      db::Box regions [2] = { bc (sh1), bc (sh2) };
+      invalidate_state (regions, regions + 2);
+    } else {
+      invalidate_state ();
+    }
+  }
+
+  //  invalidates the state and reports the regions of the objects [from, to) as changed
+  template <class Sh, class Iter>
+  void invalidate_state_for_range (Iter from, Iter to)
+  {
+    if (records_changes ()) {
+      db::box_convert<Sh> bc;
+      std::vector<db::Box> regions;
+      for (Iter i = from; i != to; ++i) {
+        regions.push_back (bc (*i));
+      }
+      const db::Box *r = regions.empty () ? 0 : &regions.front ();
+      invalidate_state (r, r + regions.size ());
+    } else {
+      invalidate_state ();
+    }
+  }
+
+  //  invalidates the state and reports the regions of the objects at the positions *[from, to) as changed
+  template <class Sh, class Iter>
+  void invalidate_state_for_positions (Iter from, Iter to)
+  {
+    if (records_changes ()) {
+      db::box_convert<Sh> bc;
+      std::vector<db::Box> regions;
+      for (Iter i = from; i != to; ++i) {
+        regions.push_back (bc (**i));
+      }
+      const db::Box *r = regions.empty () ? 0 : &regions.front ();
+      invalidate_state (r, r + regions.size ());
+    } else {
+      invalidate_state ();
+    }
+  }
+
+  //  invalidates the state and reports the region of the given array as changed
+  template <class Array>
+  void invalidate_state_for_array (const Array &arr)
+  {
+    if (records_changes ()) {
+      invalidate_state (arr.bbox (db::box_convert<typename Array::object_type> ()));
+    } else {
+      invalidate_state ();
+    }
+  }
+
   //  extract dirty flag from mp_cell
   bool is_dirty () const 
   {
@@ -1545,7 +1635,7 @@ private:
     typedef db::object_with_properties<ResType> res_wp_type;
 
     //  expand arrays in editable mode
-    invalidate_state ();  //  HINT: must come before the change is done!
+    invalidate_state_for_array<Array> (arr);  //  HINT: must come before the change is done!
     db::layer<res_wp_type, db::stable_layer_tag> &l = get_layer<res_wp_type, db::stable_layer_tag> ();
     for (typename Array::iterator a = arr.begin (); ! a.at_end (); ++a) {
       res_wp_type obj_wp (*a * arr.object (), arr.properties_id ());
@@ -1560,7 +1650,7 @@ private:
   void insert_array_typeof (const ResType &, const Array &arr)
   {
     //  expand arrays in editable mode
-    invalidate_state ();  //  HINT: must come before the change is done!
+    invalidate_state_for_array (arr);  //  HINT: must come before the change is done!
     db::layer<ResType, db::stable_layer_tag> &l = get_layer<ResType, db::stable_layer_tag> ();
     for (typename Array::iterator a = arr.begin (); ! a.at_end (); ++a) {
       if (manager () && manager ()->transacting ()) {
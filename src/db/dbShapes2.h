@@ -141,6 +141,11 @@ public:
     m_layer.sort ();
   }
 
+  virtual void pack (db::Arena *arena) 
+  {
+    m_layer.pack (arena);
+  }
+
   virtual void clear (Shapes *target, db::Manager *manager);
   virtual LayerBase *clone (Shapes *target, db::Manager *manager) const;
   virtual void translate_into (Shapes *target, GenericRepository &rep, ArrayRepository &array_rep) const;
@@ -26,9 +26,12 @@
 #include "tlExpression.h"
 #include "tlProgress.h"
 #include "tlThreadedWorkers.h"
+#include "tlTimer.h"
 #include "gsiDecl.h"
 
 #include <cmath>
+#include <map>
+#include <algorithm>
 
 namespace db
 {
@@ -270,6 +273,220 @@ private:
   db::EdgePairs *mp_edge_pairs;
 };
 
+/**
+ *  @brief Estimates the cost of a tile from the number of input shapes inside the tile's region
+ *
+ *  The estimator employs the box trees of the input's cells: instances which are entirely inside
+ *  the region contribute the flat shape count of their cell, which is computed once per cell.
+ *  Only instances crossing the region's boundary are looked into.
+ */
+class TileCostEstimator
+{
+public:
+  TileCostEstimator (const db::RecursiveShapeIterator &iter)
+    : mp_iter (&iter), m_flags (iter.shape_flags ())
+  {
+    if (iter.multiple_layers ()) {
+      m_layers = iter.layers ();
+    } else {
+      m_layers.push_back (iter.layer ());
+    }
+  }
+
+  size_t cost (const db::Box &region)
+  {
+    if (region.empty ()) {
+      return 0;
+    }
+
+    if (! mp_iter->layout () || ! mp_iter->top_cell ()) {
+
+      //  no layout (i.e. shapes-based iterator): count the shapes
+      db::RecursiveShapeIterator iter (*mp_iter);
+      iter.confine_region (region);
+      size_t n = 0;
+      for ( ; ! iter.at_end (); ++iter) {
+        ++n;
+      }
+      return n;
+
+    } else {
+      return count (*mp_iter->top_cell (), region);
+    }
+  }
+
+private:
+  const db::RecursiveShapeIterator *mp_iter;
+  std::vector<unsigned int> m_layers;
+  unsigned int m_flags;
+  std::map<db::cell_index_type, size_t> m_flat_counts;
+
+  size_t count (const db::Cell &cell, const db::Box &region)
+  {
+    const db::Layout &layout = *mp_iter->layout ();
+
+    size_t n = 0;
+
+    for (std::vector<unsigned int>::const_iterator l = m_layers.begin (); l != m_layers.end (); ++l) {
+      if (layout.is_valid_layer (*l)) {
+        for (db::ShapeIterator s = cell.shapes (*l).begin_touching (region, m_flags); ! s.at_end (); ++s) {
+          ++n;
+        }
+      }
+    }
+
+    db::box_convert<db::CellInst> bc (layout);
+
+    for (db::Cell::touching_iterator i = cell.begin_touching (region); ! i.at_end (); ++i) {
+
+      const db::Cell &child = layout.cell (i->cell_index ());
+      db::Box child_box = child.bbox ();
+
+      for (db::CellInstArray::iterator a = i->cell_inst ().begin_touching (region, bc); ! a.at_end (); ++a) {
+        db::ICplxTrans t = i->complex_trans (*a);
+        if (child_box.transformed (t).inside (region)) {
+          n += flat_count (child);
+        } else {
+          n += count (child, region.transformed (t.inverted ()));
+        }
+      }
+
+    }
+
+    return n;
+  }
+
+  size_t flat_count (const db::Cell &cell)
+  {
+    std::map<db::cell_index_type, size_t>::const_iterator fc = m_flat_counts.find (cell.cell_index ());
+    if (fc != m_flat_counts.end ()) {
+      return fc->second;
+    }
+
+    const db::Layout &layout = *mp_iter->layout ();
+
+    size_t n = 0;
+
+    for (std::vector<unsigned int>::const_iterator l = m_layers.begin (); l != m_layers.end (); ++l) {
+      if (layout.is_valid_layer (*l)) {
+        for (db::ShapeIterator s = cell.shapes (*l).begin (m_flags); ! s.at_end (); ++s) {
+          ++n;
+        }
+      }
+    }
+
+    for (db::Cell::const_iterator i = cell.begin (); ! i.at_end (); ++i) {
+      n += flat_count (layout.cell (i->cell_index ())) * i->cell_inst ().size ();
+    }
+
+    m_flat_counts.insert (std::make_pair (cell.cell_index (), n));
+    return n;
+  }
+};
+
+/**
+ *  @brief Describes one tile (or sub-tile in adaptive mode) to be processed
+ */
+struct TileSpec
+{
+  TileSpec (const std::string &_desc, size_t _ix, size_t _iy, const db::DBox &_clip_box, size_t _sub_index = 0)
+    : desc (_desc), ix (_ix), iy (_iy), sub_index (_sub_index), clip_box (_clip_box), cost (0)
+  { }
+
+  bool operator< (const TileSpec &other) const
+  {
+    //  sorts by decreasing cost
+    return cost > other.cost;
+  }
+
+  std::string desc;
+  size_t ix, iy;
+  size_t sub_index;
+  db::DBox clip_box;
+  size_t cost;
+};
+
+/**
+ *  @brief Computes the estimated cost of a tile over all inputs of a tiling processor
+ */
+class TileCostModel
+{
+public:
+  TileCostModel (const TilingProcessor *proc)
+  {
+    for (std::vector<TilingProcessor::InputSpec>::const_iterator i = proc->begin_inputs (); i != proc->end_inputs (); ++i) {
+
+      double dbu = proc->dbu ();
+      if (proc->scale_to_dbu () && i->iter.layout ()) {
+        dbu = i->iter.layout ()->dbu ();
+      }
+
+      m_estimators.push_back (TileCostEstimator (i->iter));
+      m_to_dbu.push_back ((db::DCplxTrans (dbu) * db::DCplxTrans (i->trans)).inverted ());
+      m_regions.push_back (i->iter.region ());
+
+    }
+  }
+
+  /**
+   *  @brief Gets the estimated cost for the given region (in micron units)
+   */
+  size_t cost (const db::DBox &region)
+  {
+    size_t c = 0;
+    for (size_t i = 0; i < m_estimators.size (); ++i) {
+      db::Box region_dbu = db::Box (region.transformed (m_to_dbu [i]));
+      region_dbu &= m_regions [i];
+      c += m_estimators [i].cost (region_dbu);
+    }
+    return c;
+  }
+
+private:
+  std::vector<TileCostEstimator> m_estimators;
+  std::vector<db::DCplxTrans> m_to_dbu;
+  std::vector<db::Box> m_regions;
+};
+
+/**
+ *  @brief Splits a tile into sub-tiles recursively until the estimated cost is below the given limit
+ */
+static void
+split_tile (TileCostModel &cost_model, const TileSpec &tile, size_t max_cost, const db::DVector &border, double dbu, unsigned int level, std::vector<TileSpec> &tiles)
+{
+  //  the maximum number of levels (each level splits a tile into 2x2 sub-tiles)
+  const unsigned int max_levels = 4;
+  //  tiles with less shapes are not worth splitting
+  const size_t min_cost = 1000;
+
+  double w2 = dbu * floor (tile.clip_box.width () / (2.0 * dbu) + 1e-10);
+  double h2 = dbu * floor (tile.clip_box.height () / (2.0 * dbu) + 1e-10);
+
+  //  sub-tiles smaller than the border would spend most of the time on the border
+  if (tile.cost <= max_cost || tile.cost < min_cost || level >= max_levels || w2 < std::max (border.x (), dbu) || h2 < std::max (border.y (), dbu)) {
+    tiles.push_back (tile);
+    return;
+  }
+
+  const db::DBox &b = tile.clip_box;
+  double xm = b.left () + w2, ym = b.bottom () + h2;
+
+  db::DBox parts [] = {
+    db::DBox (b.left (), b.bottom (), xm, ym),
+    db::DBox (xm, b.bottom (), b.right (), ym),
+    db::DBox (b.left (), ym, xm, b.top ()),
+    db::DBox (xm, ym, b.right (), b.top ())
+  };
+
+  //  Sub-tiles keep the indexes of the original tile. They are told apart by the sub-index
+  //  which is formed from the path of the sub-tile like the description ("1.3" gives (1*4)+3).
+  for (unsigned int i = 0; i < sizeof (parts) / sizeof (parts [0]); ++i) {
+    TileSpec part (tile.desc + tl::sprintf (".%d", i + 1), tile.ix, tile.iy, parts [i], tile.sub_index * 4 + i + 1);
+    part.cost = cost_model.cost (parts [i].enlarged (border));
+    split_tile (cost_model, part, max_cost, border, dbu, level + 1, tiles);
+  }
+}
+
 class TilingProcessorJob
   : public tl::JobBase
 {
@@ -310,12 +527,25 @@ public:
     return mp_proc;
   }
 
+  void add_statistics (const TilingProcessor::TileStatistics &st)
+  {
+    QMutexLocker locker (&m_mutex);
+    m_statistics.push_back (st);
+  }
+
+  void get_statistics (std::vector<TilingProcessor::TileStatistics> &statistics)
+  {
+    QMutexLocker locker (&m_mutex);
+    statistics.swap (m_statistics);
+  }
+
   virtual tl::Worker *create_worker ();
 
 private:
   TilingProcessor *mp_proc;
   bool m_has_tiles;
   unsigned int m_progress;
+  std::vector<TilingProcessor::TileStatistics> m_statistics;
   QMutex m_mutex;
 };
 
@@ -323,8 +553,8 @@ class TilingProcessorTask
   : public tl::Task
 {
 public:
-  TilingProcessorTask (const std::string &tile_desc, size_t ix, size_t iy, const db::DBox &clip_box, const db::DBox &region, const std::string &script, size_t script_index)
-    : m_tile_desc (tile_desc), m_ix (ix), m_iy (iy), m_clip_box (clip_box), m_region (region), m_script (script), m_script_index (script_index)
+  TilingProcessorTask (const std::string &tile_desc, size_t ix, size_t iy, const db::DBox &clip_box, const db::DBox &region, const std::string &script, size_t script_index, size_t cost = 0, size_t sub_index = 0)
+    : m_tile_desc (tile_desc), m_ix (ix), m_iy (iy), m_sub_index (sub_index), m_clip_box (clip_box), m_region (region), m_script (script), m_script_index (script_index), m_cost (cost)
   {
     //  .. nothing yet ..
   }
@@ -349,6 +579,11 @@ public:
     return m_iy;
   }
   
+  size_t sub_index () const
+  {
+    return m_sub_index;
+  }
+
   const db::DBox &region () const
   {
     return m_region;
@@ -364,12 +599,19 @@ public:
     return m_script_index;
   }
 
+  size_t cost () const
+  {
+    return m_cost;
+  }
+
 private:
   std::string m_tile_desc;
   size_t m_ix, m_iy;
+  size_t m_sub_index;
   db::DBox m_clip_box, m_region;
   std::string m_script;
   size_t m_script_index;
+  size_t m_cost;
 };
 
 class TilingProcessorWorker
@@ -527,15 +769,35 @@ TilingProcessorWorker::do_perform (const TilingProcessorTask *tile_task)
   eval.define_function ("_count", new TilingProcessorCountFunction (mp_job->processor ()));
 
   if (tl::verbosity () >= (mp_job->has_tiles () ? 20 : 10)) {
-    tl::info << "TilingProcessor: script #" << (tile_task->script_index () + 1) << ", tile " << tile_task->tile_desc ();
+    if (mp_job->processor ()->adaptive () && mp_job->has_tiles ()) {
+      tl::info << "TilingProcessor: script #" << (tile_task->script_index () + 1) << ", tile " << tile_task->tile_desc () << " (estimated cost " << tile_task->cost () << ")";
+    } else {
+      tl::info << "TilingProcessor: script #" << (tile_task->script_index () + 1) << ", tile " << tile_task->tile_desc ();
+    }
   }
 
   tl::SelfTimer timer (tl::verbosity () >= (mp_job->has_tiles () ? 21 : 11), "Elapsed time");
 
+  tl::Timer tile_timer;
+  tile_timer.start ();
+
   tl::Expression ex;
   eval.parse (ex, tile_task->script ());
   ex.execute ();
 
+  tile_timer.stop ();
+
+  TilingProcessor::TileStatistics st;
+  st.desc = tile_task->tile_desc ();
+  st.ix = tile_task->ix ();
+  st.iy = tile_task->iy ();
+  st.sub_index = tile_task->sub_index ();
+  st.tile = tile_task->clip_box ();
+  st.script_index = tile_task->script_index ();
+  st.cost = tile_task->cost ();
+  st.seconds = tile_timer.sec_wall ();
+  mp_job->add_statistics (st);
+
   mp_job->next_progress ();
 }
 
@@ -555,7 +817,7 @@ TilingProcessor::TilingProcessor ()
     m_tile_origin_x (0.0), m_tile_origin_y (0.0),
     m_tile_origin_given (false),
     m_tile_bx (0.0), m_tile_by (0.0),
-    m_threads (0), m_dbu (0.001), m_dbu_specific (0.001), m_dbu_specific_set (false),
+    m_threads (0), m_adaptive (false), m_dbu (0.001), m_dbu_specific (0.001), m_dbu_specific_set (false),
     m_scale_to_dbu (true)
 {
   //  .. nothing yet ..
@@ -715,6 +977,26 @@ TilingProcessor::output (const std::string &name, db::Edges &edges)
   m_outputs.back ().receiver = new TileEdgesOutputReceiver (&edges);
 }
 
+void
+TilingProcessor::report_tile_statistics () const
+{
+  if (m_tile_statistics.empty ()) {
+    return;
+  }
+
+  double sum = 0.0;
+  std::vector<TileStatistics>::const_iterator slowest = m_tile_statistics.begin ();
+  for (std::vector<TileStatistics>::const_iterator t = m_tile_statistics.begin (); t != m_tile_statistics.end (); ++t) {
+    sum += t->seconds;
+    if (t->seconds > slowest->seconds) {
+      slowest = t;
+    }
+  }
+
+  tl::info << "TilingProcessor: " << m_tile_statistics.size () << " tile task(s), average time " << tl::sprintf ("%.3g", sum / double (m_tile_statistics.size ())) << "s, "
+           << "slowest: script #" << (slowest->script_index + 1) << ", tile " << slowest->desc << " with " << tl::sprintf ("%.3g", slowest->seconds) << "s";
+}
+
 tl::Variant
 TilingProcessor::receiver (const std::vector<tl::Variant> &args)
 {
@@ -819,7 +1101,10 @@ TilingProcessor::execute (const std::string &desc)
 
   TilingProcessorJob job (this, m_threads, has_tiles);
 
+  m_tile_statistics.clear ();
+
   double l = 0.0, b = 0.0;
+  size_t ntasks = 0;
 
   if (has_tiles) {
 
@@ -834,25 +1119,64 @@ TilingProcessor::execute (const std::string &desc)
       b = dbu () * floor (0.5 + (tot_box.center ().y () - ntiles_h * 0.5 * tile_height) / dbu () + 1e-10);
     }
 
-    //  create the TilingProcessor tasks
+    std::vector<TileSpec> tile_specs;
+
     for (size_t ix = 0; ix < ntiles_w; ++ix) {
 
       for (size_t iy = 0; iy < ntiles_h; ++iy) {
 
         db::DBox clip_box (l + ix * tile_width, b + iy * tile_height, l + (ix + 1) * tile_width, b + (iy + 1) * tile_height);
-        db::DBox region = clip_box.enlarged (db::DVector (m_tile_bx, m_tile_by));
-
         std::string tile_desc = tl::sprintf ("%d/%d,%d/%d", ix + 1, ntiles_w, iy + 1, ntiles_h);
 
-        size_t si = 0;
-        for (std::vector <std::string>::const_iterator s = m_scripts.begin (); s != m_scripts.end (); ++s, ++si) {
-          job.schedule (new TilingProcessorTask (tile_desc, ix, iy, clip_box, region, *s, si));
+        tile_specs.push_back (TileSpec (tile_desc, ix, iy, clip_box));
+
+      }
+
+    }
+
+    if (m_adaptive) {
+
+      tl::SelfTimer timer (tl::verbosity () >= 21, "Estimating tile costs");
+
+      db::DVector border (m_tile_bx, m_tile_by);
+      TileCostModel cost_model (this);
+
+      size_t total_cost = 0;
+      for (std::vector<TileSpec>::iterator t = tile_specs.begin (); t != tile_specs.end (); ++t) {
+        t->cost = cost_model.cost (t->clip_box.enlarged (border));
+        total_cost += t->cost;
+      }
+
+      //  With multiple threads, split the tiles which take a considerable share of the total cost.
+      //  Otherwise such tiles will determine the total run time.
+      if (m_threads > 0) {
+        size_t max_cost = total_cost / (m_threads * 4);
+        std::vector<TileSpec> split_tile_specs;
+        for (std::vector<TileSpec>::const_iterator t = tile_specs.begin (); t != tile_specs.end (); ++t) {
+          split_tile (cost_model, *t, max_cost, border, dbu (), 0, split_tile_specs);
         }
+        tile_specs.swap (split_tile_specs);
+      }
 
+      //  schedule the most expensive tiles first
+      std::stable_sort (tile_specs.begin (), tile_specs.end ());
+
+    }
+
+    //  create the TilingProcessor tasks
+    for (std::vector<TileSpec>::const_iterator t = tile_specs.begin (); t != tile_specs.end (); ++t) {
+
+      db::DBox region = t->clip_box.enlarged (db::DVector (m_tile_bx, m_tile_by));
+
+      size_t si = 0;
+      for (std::vector <std::string>::const_iterator s = m_scripts.begin (); s != m_scripts.end (); ++s, ++si) {
+        job.schedule (new TilingProcessorTask (t->desc, t->ix, t->iy, t->clip_box, region, *s, si, t->cost, t->sub_index));
       }
 
     }
 
+    ntasks = tile_specs.size () * m_scripts.size ();
+
   } else {
 
     ntiles_w = ntiles_h = 0;
@@ -866,8 +1190,7 @@ TilingProcessor::execute (const std::string &desc)
 
   //  TODO: there should be a general scheme of how thread-specific progress is merged
   //  into a global one ..
-  size_t todo_count = ntiles_w * ntiles_h * m_scripts.size ();
-  tl::RelativeProgress progress (desc, todo_count, 1);
+  tl::RelativeProgress progress (desc, ntasks, 1);
 
   try {
 
@@ -885,6 +1208,11 @@ TilingProcessor::execute (const std::string &desc)
         job.wait (100);
       }
 
+      job.get_statistics (m_tile_statistics);
+      if (has_tiles && tl::verbosity () >= 11) {
+        report_tile_statistics ();
+      }
+
       for (std::vector<OutputSpec>::const_iterator o = m_outputs.begin (); o != m_outputs.end (); ++o) {
         o->receiver->finish (!job.has_error ());
         o->receiver->set_processor (0);
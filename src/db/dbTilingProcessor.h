@@ -601,6 +601,96 @@ public:
     return m_threads;
   }
 
+  /**
+   *  @brief Enables or disables the adaptive mode
+   *
+   *  In adaptive mode, the cost of each tile is estimated from the number of input shapes 
+   *  inside the tile's region (including the border). The tiles are executed in the order of
+   *  decreasing cost, so expensive tiles are not left over for the end of the run. 
+   *  In addition, if multiple threads are used, tiles taking a large part of the total cost are 
+   *  split recursively into sub-tiles. Sub-tiles report the indexes of the original tile, hence
+   *  receivers may receive multiple outputs for the same tile indexes. The tile box delivered to
+   *  the receivers is the box of the sub-tile. The statistics tell the sub-tiles apart by the
+   *  sub-index (see TileStatistics).
+   */
+  void set_adaptive (bool f)
+  {
+    m_adaptive = f;
+  }
+
+  /**
+   *  @brief Gets a value indicating whether the adaptive mode is enabled
+   */
+  bool adaptive () const
+  {
+    return m_adaptive;
+  }
+
+  /**
+   *  @brief Describes the execution of a script on one tile
+   */
+  struct TileStatistics
+  {
+    TileStatistics ()
+      : ix (0), iy (0), sub_index (0), script_index (0), cost (0), seconds (0.0)
+    { }
+
+    /**
+     *  @brief The description of the tile (i.e. "2/4,1/4")
+     */
+    std::string desc;
+
+    /**
+     *  @brief The tile indexes
+     *
+     *  For sub-tiles in adaptive mode, these are the indexes of the original tile.
+     */
+    size_t ix, iy;
+
+    /**
+     *  @brief The sub-tile index
+     *
+     *  This index is 0 for tiles which have not been split. In adaptive mode, the sub-tiles
+     *  of a tile are numbered from 1 to 4 (lower left, lower right, upper left, upper right). 
+     *  The sub-tiles of a sub-tile with index n have the indexes n*4+1 to n*4+4. Hence
+     *  ix, iy and the sub-index identify a sub-tile uniquely.
+     */
+    size_t sub_index;
+
+    /**
+     *  @brief The tile box (in micron units)
+     *
+     *  For sub-tiles in adaptive mode, this is the box of the sub-tile.
+     */
+    db::DBox tile;
+
+    /**
+     *  @brief The index of the script executed
+     */
+    size_t script_index;
+
+    /**
+     *  @brief The estimated cost (the number of input shapes, adaptive mode only)
+     */
+    size_t cost;
+
+    /**
+     *  @brief The wall time spent for the script on this tile in seconds
+     */
+    double seconds;
+  };
+
+  /**
+   *  @brief Gets the statistics of the last execution
+   *
+   *  The statistics list has one entry per tile and script. The entries are given in the order 
+   *  of completion. The statistics can be used to optimize the tile size and border.
+   */
+  const std::vector<TileStatistics> &tile_statistics () const
+  {
+    return m_tile_statistics;
+  }
+
   /**
    *  @brief Queue a script for execution with "execute"
    *
@@ -618,6 +708,7 @@ public:
 
 private:
   friend class TilingProcessorWorker;
+  friend class TileCostModel;
   friend class TilingProcessorOutputFunction;
   friend class TilingProcessorReceiverFunction;
 
@@ -642,6 +733,7 @@ private:
   std::vector<InputSpec>::const_iterator end_inputs () const { return m_inputs.end (); }
 
   void put (size_t ix, size_t iy, const db::Box &tile, const std::vector<tl::Variant> &args);
+  void report_tile_statistics () const;
   tl::Variant receiver (const std::vector<tl::Variant> &args);
   tl::Eval &top_eval () { return m_top_eval; }
 
@@ -655,6 +747,8 @@ private:
   bool m_tile_origin_given;
   double m_tile_bx, m_tile_by;
   size_t m_threads;
+  bool m_adaptive;
+  std::vector<TileStatistics> m_tile_statistics;
   double m_dbu, m_dbu_specific;
   bool m_dbu_specific_set;
   bool m_scale_to_dbu;
@@ -1030,6 +1030,9 @@ write_simple (const db::Cell *cell, const std::string &filename)
   options.add_cell (cell->cell_index ());
   options.set_format_from_filename (filename);
 
+  //  the file may be the source of lazy cells - these need to be loaded before the file is overwritten
+  layout->load_lazy_cells (filename);
+
   db::Writer writer (options);
   tl::OutputStream stream (filename);
   writer.write (*layout, stream);
@@ -1047,6 +1050,9 @@ write_options (const db::Cell *cell, const std::string &filename, const db::Save
   options.clear_cells ();
   options.add_cell (cell->cell_index ());
 
+  //  the file may be the source of lazy cells - these need to be loaded before the file is overwritten
+  layout->load_lazy_cells (filename);
+
   db::Writer writer (options);
   tl::OutputStream stream (filename);
   writer.write (*layout, stream);
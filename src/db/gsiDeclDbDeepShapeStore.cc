@@ -0,0 +1,65 @@
+
+/*
+
+  KLayout Layout Viewer
+  Copyright (C) 2006-2017 Matthias Koefferlein
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+
+#include "gsiDecl.h"
+#include "dbDeepShapeStore.h"
+
+namespace gsi
+{
+
+static size_t layers (const db::DeepShapeStore *dss)
+{
+  return dss->layers ();
+}
+
+Class<db::DeepShapeStore> decl_DeepShapeStore ("DeepShapeStore",
+  gsi::method_ext ("layers", &layers,
+    "@brief Gets the number of layers currently held by the store\n"
+    "Layers are released when the last deep region using them is destroyed."
+  ) +
+  gsi::method ("is_valid_layout_source?", &db::DeepShapeStore::is_valid_layout_source,
+    "@brief Returns true, if the given recursive shape iterator can be used to create a deep region\n"
+    "@args iter\n"
+    "Iterators with a search region, depth limits, cell selections or property filters cannot be "
+    "represented hierarchically. Regions created from such iterators with a deep shape store will be flat ones."
+  ),
+  "@brief An opaque layout heap for the deep region processor\n"
+  "\n"
+  "This class is used for keeping intermediate, hierarchical data for the "
+  "deep region processor. It is used in deep region constructors to specify the "
+  "store where the hierarchical data is kept. The store needs to be kept alive "
+  "as long as the regions created with it are used:\n"
+  "\n"
+  "@code\n"
+  "dss = RBA::DeepShapeStore::new\n"
+  "r1 = RBA::Region::new(layout.begin_shapes(cell, layer1), dss)\n"
+  "r2 = RBA::Region::new(layout.begin_shapes(cell, layer2), dss)\n"
+  "# computed hierarchically:\n"
+  "r1_and_r2 = r1 & r2\n"
+  "@/code\n"
+  "\n"
+  "This class has been introduced in version 0.25.\n"
+);
+
+}
+
@@ -585,6 +585,21 @@ Class<db::EdgeProcessor> decl_EdgeProcessor ("EdgeProcessor",
     "\n"
     "This method has been introduced in version 0.23.\n"
   ) +
+  method ("threads=", &db::EdgeProcessor::set_threads,
+    "@brief Specifies the number of threads to use\n"
+    "@args n\n"
+    "If a value larger than 0 is given, the edge processor will split the input into horizontal "
+    "stripes which are processed by the given number of threads in parallel. The results are identical "
+    "to the single-threaded operation. The default is 0 which means single-threaded operation.\n"
+    "\n"
+    "This method has been introduced in version 0.25.\n"
+  ) +
+  method ("threads", &db::EdgeProcessor::threads,
+    "@brief Gets the number of threads to use\n"
+    "See \\threads= for details.\n"
+    "\n"
+    "This method has been introduced in version 0.25.\n"
+  ) +
   method ("ModeAnd|#mode_and", &gsi::mode_and, "@brief boolean method's mode value for AND operation") +
   method ("ModeOr|#mode_or", &gsi::mode_or, "@brief boolean method's mode value for OR operation") +
   method ("ModeXor|#mode_xor", &gsi::mode_xor, "@brief boolean method's mode value for XOR operation") +
@@ -519,6 +519,9 @@ write_simple (db::Layout *layout, const std::string &filename)
     throw tl::Exception (tl::to_string (QObject::tr ("Cannot determine format from filename")));
   }
 
+  //  the file may be the source of lazy cells - these need to be loaded before the file is overwritten
+  layout->load_lazy_cells (filename);
+
   db::Writer writer (options);
   tl::OutputStream stream (filename);
   writer.write (*layout, stream);
@@ -527,6 +530,9 @@ write_simple (db::Layout *layout, const std::string &filename)
 static void 
 write_options1 (db::Layout *layout, const std::string &filename, const db::SaveLayoutOptions &options)
 {
+  //  the file may be the source of lazy cells - these need to be loaded before the file is overwritten
+  layout->load_lazy_cells (filename);
+
   db::Writer writer (options);
   tl::OutputStream stream (filename);
   writer.write (*layout, stream);
@@ -1250,6 +1256,21 @@ Class<db::Layout> decl_Layout ("Layout",
     "This method is provided to ensure this explicitly. This can be useful while using \\start_changes and \\end_changes to wrap a performance-critical operation. "
     "See \\start_changes for more details."
   ) +
+  gsi::method ("update_threads=", &db::Layout::set_update_threads,
+    "@brief Sets the number of threads to use for updating the layout\n"
+    "@args n\n"
+    "When the layout is updated, the bounding boxes are computed and the shape and instance trees are sorted. "
+    "With a value larger than 0, this is done by the given number of threads in parallel for the cells of one hierarchy level. "
+    "The result is the same than the one obtained with a single thread. A value of 0 (the default) updates the layout in the calling thread.\n"
+    "\n"
+    "This method has been introduced in version 0.25.\n"
+  ) +
+  gsi::method ("update_threads", &db::Layout::update_threads,
+    "@brief Gets the number of threads to use for updating the layout\n"
+    "See \\update_threads= for details.\n"
+    "\n"
+    "This method has been introduced in version 0.25.\n"
+  ) +
   gsi::method ("cleanup", &db::Layout::cleanup,
     "@brief Cleans up the layout\n"
     "This method will remove proxy objects that are no longer in use. After changing PCell parameters such "
@@ -24,6 +24,7 @@
 #include "gsiDecl.h"
 #include "dbReader.h"
 #include "dbLoadLayoutOptions.h"
+#include "dbCommonReader.h"
 
 namespace gsi
 {
@@ -233,9 +234,34 @@ namespace gsi
     "The LayerMap class has been introduced in version 0.18."
   );
 
+  static void set_layout_cache_dir (db::LoadLayoutOptions *options, const std::string &dir)
+  {
+    options->get_options<db::CommonReaderOptions> ().layout_cache_dir = dir;
+  }
+
+  static std::string layout_cache_dir (const db::LoadLayoutOptions *options)
+  {
+    return options->get_options<db::CommonReaderOptions> ().layout_cache_dir;
+  }
+
   //  NOTE: the contribution comes from format specific extensions.
   Class<db::LoadLayoutOptions> decl_LoadLayoutOptions ("LoadLayoutOptions", 
-    gsi::Methods (),
+    gsi::method_ext ("layout_cache_dir=", &set_layout_cache_dir,
+      "@brief Sets the directory of the persistent layout cache\n"
+      "@args dir\n"
+      "If a cache directory is set, GDS2 and OASIS layouts are stored there in a binary format after they have been read. "
+      "When the same file is read again with the same options, the layout is taken from the cache. "
+      "A cache entry becomes invalid when the file's size or modification time changes. "
+      "An empty string disables the cache. The initial value is taken from the KLAYOUT_LAYOUT_CACHE environment variable.\n"
+      "\n"
+      "This method has been introduced in version 0.25."
+    ) +
+    gsi::method_ext ("layout_cache_dir", &layout_cache_dir,
+      "@brief Gets the directory of the persistent layout cache\n"
+      "See \\layout_cache_dir= for details.\n"
+      "\n"
+      "This method has been introduced in version 0.25."
+    ),
     "@brief Layout reader options\n"
     "\n"
     "This object describes various layer reader options used for loading layouts.\n"
@@ -79,6 +79,16 @@ static db::Region *new_si2 (const db::RecursiveShapeIterator &si, const db::ICpl
   return new db::Region (si, trans);
 }
 
+static db::Region *new_sid (const db::RecursiveShapeIterator &si, db::DeepShapeStore &dss)
+{
+  return new db::Region (si, dss);
+}
+
+static db::Region *new_si2d (const db::RecursiveShapeIterator &si, db::DeepShapeStore &dss, const db::ICplxTrans &trans)
+{
+  return new db::Region (si, dss, trans);
+}
+
 static std::string to_string0 (const db::Region *r)
 {
   return r->to_string ();
@@ -605,6 +615,34 @@ Class<db::Region> decl_Region ("Region",
     "r = RBA::Region::new(layout.begin_shapes(cell, layer), RBA::ICplxTrans::new(layout.dbu / dbu))\n"
     "@/code\n"
   ) +
+  constructor ("new", &new_sid,
+    "@brief Constructor for a deep region from a hierarchical shape set\n"
+    "@args shape_iterator, deep_shape_store\n"
+    "\n"
+    "This constructor creates a hierarchical region. Use a \\DeepShapeStore object to "
+    "supply the hierarchical heap. See \\DeepShapeStore for more details.\n"
+    "\n"
+    "Boolean operations (AND, NOT, XOR, OR and join) and sizing between deep regions from the same "
+    "store and hierarchy will be performed hierarchically. The results of these operations are deep "
+    "regions again. Other operations will produce flat regions.\n"
+    "\n"
+    "If the shape iterator has a search region, depth limits or a cell selection, a flat region "
+    "is created.\n"
+    "\n"
+    "This constructor has been introduced in version 0.25."
+  ) +
+  constructor ("new", &new_si2d,
+    "@brief Constructor for a deep region from a hierarchical shape set with a transformation\n"
+    "@args shape_iterator, deep_shape_store, trans\n"
+    "\n"
+    "This constructor creates a hierarchical region. Use a \\DeepShapeStore object to "
+    "supply the hierarchical heap. See \\DeepShapeStore for more details.\n"
+    "\n"
+    "The transformation is applied to the delivered shapes. Only regions with the same "
+    "transformation can be combined hierarchically.\n"
+    "\n"
+    "This constructor has been introduced in version 0.25."
+  ) +
   method ("merged_semantics=", &db::Region::set_merged_semantics,
     "@brief Enables or disables merged semantics\n"
     "@args f\n"
@@ -1302,6 +1340,11 @@ Class<db::Region> decl_Region ("Region",
     "\n"
     "Merged semantics applies for this method (see \\merged_semantics= of merged semantics)\n"
   ) + 
+  method ("is_deep?", &db::Region::is_deep,
+    "@brief Returns true if the region is a deep (hierarchical) one\n"
+    "\n"
+    "This method has been added in version 0.25."
+  ) +
   method ("is_box?", &db::Region::is_box,
     "@brief Returns true, if the region is a simple box\n"
     "\n"
@@ -2015,6 +2058,22 @@ Class<db::Region> decl_Region ("Region",
     "@brief Disable progress reporting\n"
     "Calling this method will disable progress reporting. See \\enable_progress.\n"
   ) +
+  method ("threads=", &db::Region::set_threads,
+    "@brief Specifies the number of threads to use for merge, boolean, sizing and check operations\n"
+    "@args n\n"
+    "If a value larger than 0 is given, these operations will be performed with the given number "
+    "of threads in parallel. The results are identical to the single-threaded operation, except "
+    "that the checks may deliver the edge pairs in a different order and with the two edges swapped. "
+    "The default is 0 which means single-threaded operation.\n"
+    "\n"
+    "This method has been introduced in version 0.25."
+  ) +
+  method ("threads", &db::Region::threads,
+    "@brief Gets the number of threads to use for merge, boolean and sizing operations\n"
+    "See \\threads= for details.\n"
+    "\n"
+    "This method has been introduced in version 0.25."
+  ) +
   method ("Euclidian", &euclidian_metrics,
     "@brief Specifies Euclidian metrics for the check functions\n"
     "This value can be used for the metrics parameter in the check functions, i.e. \\width_check. "
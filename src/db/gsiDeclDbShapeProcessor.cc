@@ -176,6 +176,18 @@ size_to_polygon2n (db::ShapeProcessor *processor, const std::vector<db::Shape> &
 
 
 Class<db::ShapeProcessor> decl_ShapeProcessor ("ShapeProcessor", 
+  method ("threads=", &db::ShapeProcessor::set_threads,
+    "@brief Specifies the number of threads to use\n"
+    "@args n\n"
+    "See \\EdgeProcessor#threads= for details. The default is 0 which means single-threaded operation.\n"
+    "\n"
+    "This method has been introduced in version 0.25.\n"
+  ) +
+  method ("threads", &db::ShapeProcessor::threads,
+    "@brief Gets the number of threads to use\n"
+    "\n"
+    "This method has been introduced in version 0.25.\n"
+  ) +
   method ("merge", (void (db::ShapeProcessor::*) (const db::Layout &, const db::Cell &, unsigned int, db::Shapes &, bool, unsigned int, bool, bool)) &db::ShapeProcessor::merge, 
     "@brief Merge the given shapes from a layout into a shapes container\n"
     "@args layout, cell, layer, out, hierarchical, min_wc, resolve_holes, min_coherence\n"
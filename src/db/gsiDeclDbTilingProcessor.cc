@@ -334,6 +334,22 @@ static void tp_input11 (db::TilingProcessor *proc, const std::string &name, cons
   proc->input (name, it.first, trans * it.second, false /*not as polygons*/, edges.merged_semantics ());
 }
 
+static std::vector<tl::Variant> tp_tile_statistics (const db::TilingProcessor *proc)
+{
+  std::vector<tl::Variant> res;
+  for (std::vector<db::TilingProcessor::TileStatistics>::const_iterator t = proc->tile_statistics ().begin (); t != proc->tile_statistics ().end (); ++t) {
+    res.push_back (tl::Variant::empty_list ());
+    res.back ().push (tl::Variant (t->ix));
+    res.back ().push (tl::Variant (t->iy));
+    res.back ().push (tl::Variant (t->sub_index));
+    res.back ().push (tl::Variant (t->tile));
+    res.back ().push (tl::Variant (t->script_index));
+    res.back ().push (tl::Variant (t->cost));
+    res.back ().push (tl::Variant (t->seconds));
+  }
+  return res;
+}
+
 Class<db::TilingProcessor> decl_TilingProcessor ("TilingProcessor", 
   method_ext ("input", &tp_input2,
     "@brief Specifies input for the tiling processor\n"
@@ -632,6 +648,35 @@ Class<db::TilingProcessor> decl_TilingProcessor ("TilingProcessor",
   method ("threads", &db::TilingProcessor::threads,
     "@brief Gets the number of threads to use\n"
   ) + 
+  method ("adaptive=", &db::TilingProcessor::set_adaptive,
+    "@brief Enables or disables the adaptive mode\n"
+    "@args f\n"
+    "\n"
+    "In adaptive mode, the cost of each tile is estimated from the number of input shapes inside the "
+    "tile (including the border). The tiles are executed in the order of decreasing cost. If multiple threads are used, "
+    "tiles taking a large share of the total cost are split into sub-tiles. Sub-tiles deliver the tile indexes "
+    "of the original tile to the receivers, hence receivers may receive multiple outputs per tile. The tile box "
+    "delivered to the receivers is the box of the sub-tile. \\tile_statistics tells the sub-tiles apart by a sub-index.\n"
+    "\n"
+    "This method has been introduced in version 0.25."
+  ) + 
+  method ("adaptive?", &db::TilingProcessor::adaptive,
+    "@brief Gets a value indicating whether the adaptive mode is enabled\n"
+    "See \\adaptive= for details about the adaptive mode.\n"
+    "\n"
+    "This method has been introduced in version 0.25."
+  ) + 
+  method_ext ("tile_statistics", &tp_tile_statistics,
+    "@brief Gets the statistics of the last execution\n"
+    "\n"
+    "This method delivers one entry per tile and script executed in the last run. The entries are "
+    "given in the order of completion. Each entry is an array with the tile's x and y index, the sub-tile index "
+    "(0 for tiles which have not been split, 1 to 4 for the first level of sub-tiles and n*4+1 to n*4+4 for the sub-tiles "
+    "of sub-tile n), the tile box (a \\DBox in micron units), the script index, the estimated cost (adaptive mode only) and the time spent "
+    "for the script on the tile in seconds. These figures can be used to optimize the tile size and border.\n"
+    "\n"
+    "This method has been introduced in version 0.25."
+  ) + 
   method ("queue", &db::TilingProcessor::queue,
     "@brief Queues a script for parallel execution\n"
     "@args script\n"
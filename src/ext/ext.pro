@@ -18,6 +18,7 @@ HEADERS += \
   extLEFDEFImportDialogs.h \
   extLEFDEFImporter.h \
   extLEFImporter.h \
+  extNetExtractor.h \
   extNetTracer.h \
   extNetTracerConfig.h \
   extNetTracerDialog.h \
@@ -26,6 +27,7 @@ HEADERS += \
   extRS274XReader.h \
   extStreamImportDialog.h \
   extStreamImporter.h \
+  extXOREngine.h \
   extXORToolDialog.h \
     extCommon.h \
     extForceLink.h
@@ -58,6 +60,7 @@ SOURCES += \
   extLEFDEFImportDialogs.cc \
   extLEFDEFImporter.cc \
   extLEFImporter.cc \
+  extNetExtractor.cc \
   extNetTracer.cc \
   extNetTracerConfig.cc \
   extNetTracerDialog.cc \
@@ -68,6 +71,7 @@ SOURCES += \
   extStreamImport.cc \
   extStreamImportDialog.cc \
   extStreamImporter.cc \
+  extXOREngine.cc \
   extXORPlugin.cc \
   extXORToolDialog.cc \
     extLEFDEFPlugin.cc
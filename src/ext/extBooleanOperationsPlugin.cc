@@ -31,10 +31,21 @@
 #include "dbShapeProcessor.h"
 
 #include <QApplication>
+#include <QThread>
 
 namespace ext
 {
 
+/**
+ *  @brief Gets the number of threads to use for the shape processor
+ */
+static size_t
+processor_threads ()
+{
+  int n = QThread::idealThreadCount ();
+  return n > 1 ? size_t (n) : 0;
+}
+
 class BooleanOperationsPlugin
   : public lay::Plugin
 {
@@ -159,6 +170,7 @@ public:
 
           //  flat mode
           db::ShapeProcessor p (true);
+          p.set_threads (processor_threads ());
           p.boolean (mp_view->cellview (m_boolean_cva)->layout (), *mp_view->cellview (m_boolean_cva).cell (), m_boolean_layera,
                      mp_view->cellview (m_boolean_cvb)->layout (), *mp_view->cellview (m_boolean_cvb).cell (), m_boolean_layerb,
                      mp_view->cellview (m_boolean_cvr).cell ()->shapes (m_boolean_layerr), op_mode, true, true, m_boolean_mincoh);
@@ -174,6 +186,7 @@ public:
 
           //  top cell only mode
           db::ShapeProcessor p (true);
+          p.set_threads (processor_threads ());
           p.boolean (mp_view->cellview (m_boolean_cva)->layout (), *mp_view->cellview (m_boolean_cva).cell (), m_boolean_layera,
                      mp_view->cellview (m_boolean_cvb)->layout (), *mp_view->cellview (m_boolean_cvb).cell (), m_boolean_layerb,
                      mp_view->cellview (m_boolean_cvr).cell ()->shapes (m_boolean_layerr), op_mode, false, true, m_boolean_mincoh);
@@ -186,6 +199,7 @@ public:
           called_cells.insert (mp_view->cellview (m_boolean_cva).cell_index ());
 
           db::ShapeProcessor p (true);
+          p.set_threads (processor_threads ());
           db::Layout &layout = mp_view->cellview (m_boolean_cva)->layout ();
           for (std::set<db::cell_index_type>::const_iterator c = called_cells.begin (); c != called_cells.end (); ++c) {
             db::Cell &cell = layout.cell (*c);
@@ -277,6 +291,7 @@ public:
 
           //  flat mode
           db::ShapeProcessor p (true);
+          p.set_threads (processor_threads ());
           p.merge (mp_view->cellview (m_boolean_cva)->layout (), *mp_view->cellview (m_boolean_cva).cell (), m_boolean_layera,
                    mp_view->cellview (m_boolean_cvr).cell ()->shapes (m_boolean_layerr), true, m_boolean_minwc, true, m_boolean_mincoh);
           
@@ -291,6 +306,7 @@ public:
 
           //  top cell only mode
           db::ShapeProcessor p (true);
+          p.set_threads (processor_threads ());
           p.merge (mp_view->cellview (m_boolean_cva)->layout (), *mp_view->cellview (m_boolean_cva).cell (), m_boolean_layera,
                    mp_view->cellview (m_boolean_cvr).cell ()->shapes (m_boolean_layerr), false, m_boolean_minwc, true, m_boolean_mincoh);
           
@@ -302,6 +318,7 @@ public:
           called_cells.insert (mp_view->cellview (m_boolean_cva).cell_index ());
 
           db::ShapeProcessor p (true);
+          p.set_threads (processor_threads ());
           db::Layout &layout = mp_view->cellview (m_boolean_cva)->layout ();
           for (std::set<db::cell_index_type>::const_iterator c = called_cells.begin (); c != called_cells.end (); ++c) {
             db::Cell &cell = layout.cell (*c);
@@ -396,6 +413,7 @@ public:
 
           //  flat mode
           db::ShapeProcessor p (true);
+          p.set_threads (processor_threads ());
           p.size (mp_view->cellview (m_boolean_cva)->layout (), *mp_view->cellview (m_boolean_cva).cell (), m_boolean_layera,
                   mp_view->cellview (m_boolean_cvr).cell ()->shapes (m_boolean_layerr), dx_int, dy_int, m_boolean_size_mode, true, true, m_boolean_mincoh);
           
@@ -410,6 +428,7 @@ public:
 
           //  top cell only mode
           db::ShapeProcessor p (true);
+          p.set_threads (processor_threads ());
           p.size (mp_view->cellview (m_boolean_cva)->layout (), *mp_view->cellview (m_boolean_cva).cell (), m_boolean_layera,
                   mp_view->cellview (m_boolean_cvr).cell ()->shapes (m_boolean_layerr), dx_int, dy_int, m_boolean_size_mode, false, true, m_boolean_mincoh);
           
@@ -421,6 +440,7 @@ public:
           called_cells.insert (mp_view->cellview (m_boolean_cva).cell_index ());
 
           db::ShapeProcessor p (true);
+          p.set_threads (processor_threads ());
           db::Layout &layout = mp_view->cellview (m_boolean_cva)->layout ();
           for (std::set<db::cell_index_type>::const_iterator c = called_cells.begin (); c != called_cells.end (); ++c) {
             db::Cell &cell = layout.cell (*c);
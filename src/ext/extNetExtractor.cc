@@ -0,0 +1,714 @@
+
+/*
+
+  KLayout Layout Viewer
+  Copyright (C) 2006-2017 Matthias Koefferlein
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+
+#include "extNetExtractor.h"
+
+#include "dbBoxScanner.h"
+#include "dbPolygonTools.h"
+#include "dbRecursiveShapeIterator.h"
+#include "tlLog.h"
+#include "tlProgress.h"
+#include "tlThreadedWorkers.h"
+#include "tlTimer.h"
+
+#include <QMutex>
+#include <QObject>
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+namespace ext
+{
+
+// -----------------------------------------------------------------------------------
+//  ExtractedNet implementation
+
+ExtractedNet::ExtractedNet ()
+{
+  //  .. nothing yet ..
+}
+
+// -----------------------------------------------------------------------------------
+//  The tile data
+
+/**
+ *  @brief A shape found inside a tile together with the logical layer it represents
+ */
+struct NetExtractorItem
+{
+  NetExtractorItem (const NetTracerShape &s, unsigned int ll, unsigned int d, bool c)
+    : shape (s), log_layer (ll), depth (d), computed (c)
+  {
+    if (! shape.shape ().is_text ()) {
+      shape.shape ().polygon (polygon);
+      polygon.transform (db::ICplxTrans (shape.trans ()));
+    }
+  }
+
+  bool is_text () const
+  {
+    return shape.shape ().is_text ();
+  }
+
+  NetTracerShape shape;
+  unsigned int log_layer;
+  unsigned int depth;
+  bool computed;
+  db::Polygon polygon;
+};
+
+struct NetExtractorItemBoxConverter
+{
+  typedef db::Box box_type;
+
+  db::Box operator() (const NetExtractorItem &item) const
+  {
+    return item.shape.bbox ();
+  }
+};
+
+/**
+ *  @brief Returns true, if two items are connected
+ *
+ *  Items are connected if they are on connected logical layers and interact geometrically.
+ *  Texts connect to shapes, but not to other texts.
+ */
+static bool
+items_connected (const NetExtractorItem &a, const NetExtractorItem &b, const NetTracerData &data)
+{
+  const std::set<unsigned int> &lc = data.log_connections (a.log_layer);
+  if (lc.find (b.log_layer) == lc.end ()) {
+    return false;
+  }
+
+  if (a.is_text ()) {
+    return ! b.is_text () && db::interact (b.polygon, a.shape.bbox ());
+  } else if (b.is_text ()) {
+    return db::interact (a.polygon, b.shape.bbox ());
+  } else {
+    return db::interact (a.polygon, b.polygon);
+  }
+}
+
+/**
+ *  @brief The results of one tile
+ */
+struct NetExtractorTile
+{
+  NetExtractorTile (const db::Box &b)
+    : box (b), heap (new NetTracerShapeHeap ())
+  {
+    //  .. nothing yet ..
+  }
+
+  db::Box box;
+  std::vector<NetExtractorItem> items;
+  std::vector<std::pair<size_t, size_t> > interactions;
+  NetTracerShapeHeap *heap;
+};
+
+/**
+ *  @brief A box scanner receiver collecting the connections between the items of a tile
+ */
+class NetExtractorTileReceiver
+  : public db::box_scanner_receiver<NetExtractorItem, size_t>
+{
+public:
+  NetExtractorTileReceiver (const NetTracerData &data, std::vector<std::pair<size_t, size_t> > &interactions)
+    : mp_data (&data), mp_interactions (&interactions)
+  {
+    //  .. nothing yet ..
+  }
+
+  void add (const NetExtractorItem *a, size_t pa, const NetExtractorItem *b, size_t pb)
+  {
+    if (items_connected (*a, *b, *mp_data)) {
+      mp_interactions->push_back (std::make_pair (pa, pb));
+    }
+  }
+
+private:
+  const NetTracerData *mp_data;
+  std::vector<std::pair<size_t, size_t> > *mp_interactions;
+};
+
+// -----------------------------------------------------------------------------------
+//  The extraction job
+
+class NetExtractorJob
+  : public tl::JobBase
+{
+public:
+  NetExtractorJob (int nworkers, const db::Layout &layout, const db::Cell &cell, const NetTracerData &data, std::vector<NetExtractorTile> &tiles)
+    : tl::JobBase (nworkers), mp_layout (&layout), mp_cell (&cell), mp_data (&data), mp_tiles (&tiles), m_done (0)
+  {
+    m_original_layers = data.original_layers ();
+    m_log_layers = data.log_layers ();
+
+    m_needs_booleans = false;
+    for (std::set<unsigned int>::const_iterator l = m_log_layers.begin (); l != m_log_layers.end (); ++l) {
+      if (! data.expression (*l).is_alias ()) {
+        m_needs_booleans = true;
+      }
+    }
+  }
+
+  void run (tl::RelativeProgress *progress)
+  {
+    m_done = 0;
+    for (size_t i = 0; i < mp_tiles->size (); ++i) {
+      schedule (new NetExtractorTask (i));
+    }
+
+    try {
+
+      start ();
+      while (is_running ()) {
+        //  This may throw an exception, if the cancel button has been pressed.
+        if (progress) {
+          progress->set (done ());
+        }
+        wait (100);
+      }
+
+    } catch (tl::BreakException &ex) {
+      terminate ();
+      throw ex;
+    } catch (tl::Exception &ex) {
+      terminate ();
+      throw ex;
+    }
+
+    if (has_error ()) {
+      throw tl::Exception (tl::to_string (QObject::tr ("Errors occured during processing. First error message says:\n")) + error_messages ().front ());
+    }
+  }
+
+  void process (size_t index, db::EdgeProcessor &ep)
+  {
+    NetExtractorTile &tile = (*mp_tiles) [index];
+
+    //  collect the original shapes inside the tile
+    std::map<unsigned int, std::vector<std::pair<NetTracerShape, unsigned int> > > originals;
+    std::set<std::pair<NetTracerShape, const NetTracerShape *> > input;
+
+    for (std::set<unsigned int>::const_iterator l = m_original_layers.begin (); l != m_original_layers.end (); ++l) {
+
+      if (! mp_layout->is_valid_layer (*l)) {
+        continue;
+      }
+
+      std::vector<std::pair<NetTracerShape, unsigned int> > &shapes = originals [*l];
+
+      db::RecursiveShapeIterator s (*mp_layout, *mp_cell, *l, tile.box, false);
+      s.shape_flags (db::ShapeIterator::Polygons | db::ShapeIterator::Paths | db::ShapeIterator::Boxes | db::ShapeIterator::Texts);
+      while (! s.at_end ()) {
+        shapes.push_back (std::make_pair (NetTracerShape (s.trans (), s.shape (), *l, s.cell_index ()), (unsigned int) s.depth ()));
+        if (m_needs_booleans) {
+          input.insert (std::make_pair (shapes.back ().first, (const NetTracerShape *) 0));
+        }
+        ++s;
+      }
+
+    }
+
+    //  form the items of the logical layers: computed layers are clipped at the tile boundary
+    std::vector<db::Polygon> mask;
+    mask.push_back (db::Polygon (tile.box));
+
+    for (std::set<unsigned int>::const_iterator l = m_log_layers.begin (); l != m_log_layers.end (); ++l) {
+
+      const NetTracerLayerExpression &expr = mp_data->expression (*l);
+
+      if (expr.is_alias ()) {
+
+        std::map<unsigned int, std::vector<std::pair<NetTracerShape, unsigned int> > >::const_iterator o = originals.find ((unsigned int) expr.alias_for ());
+        if (expr.alias_for () >= 0 && o != originals.end ()) {
+          for (std::vector<std::pair<NetTracerShape, unsigned int> >::const_iterator s = o->second.begin (); s != o->second.end (); ++s) {
+            tile.items.push_back (NetExtractorItem (s->first, *l, s->second, false));
+          }
+        }
+
+      } else {
+
+        std::set<std::pair<NetTracerShape, const NetTracerShape *> > output;
+        expr.compute_results (*l, mp_cell->cell_index (), &mask, input, 0, *tile.heap, output, *mp_data, ep);
+        for (std::set<std::pair<NetTracerShape, const NetTracerShape *> >::const_iterator s = output.begin (); s != output.end (); ++s) {
+          tile.items.push_back (NetExtractorItem (s->first, *l, 0, true));
+        }
+
+        //  texts on the source layers label the computed shapes they are placed on
+        std::set<unsigned int> ol = expr.original_layers ();
+        for (std::set<unsigned int>::const_iterator i = ol.begin (); i != ol.end (); ++i) {
+          std::map<unsigned int, std::vector<std::pair<NetTracerShape, unsigned int> > >::const_iterator o = originals.find (*i);
+          if (o != originals.end ()) {
+            for (std::vector<std::pair<NetTracerShape, unsigned int> >::const_iterator s = o->second.begin (); s != o->second.end (); ++s) {
+              if (s->first.shape ().is_text ()) {
+                tile.items.push_back (NetExtractorItem (s->first, *l, s->second, false));
+              }
+            }
+          }
+        }
+
+      }
+
+    }
+
+    //  determine the interactions
+    db::box_scanner<NetExtractorItem, size_t> scanner;
+    scanner.reserve (tile.items.size ());
+    for (size_t i = 0; i < tile.items.size (); ++i) {
+      scanner.insert (&tile.items [i], i);
+    }
+
+    NetExtractorTileReceiver rec (*mp_data, tile.interactions);
+    scanner.process (rec, 1 /*touching*/, NetExtractorItemBoxConverter ());
+
+    QMutexLocker locker (&m_mutex);
+    ++m_done;
+  }
+
+  size_t done ()
+  {
+    QMutexLocker locker (&m_mutex);
+    return m_done;
+  }
+
+  virtual tl::Worker *create_worker ();
+
+private:
+  class NetExtractorTask
+    : public tl::Task
+  {
+  public:
+    NetExtractorTask (size_t index)
+      : m_index (index)
+    {
+      //  .. nothing yet ..
+    }
+
+    size_t index () const
+    {
+      return m_index;
+    }
+
+  private:
+    size_t m_index;
+  };
+
+  friend class NetExtractorWorker;
+
+  const db::Layout *mp_layout;
+  const db::Cell *mp_cell;
+  const NetTracerData *mp_data;
+  std::vector<NetExtractorTile> *mp_tiles;
+  std::set<unsigned int> m_original_layers;
+  std::set<unsigned int> m_log_layers;
+  bool m_needs_booleans;
+  size_t m_done;
+  QMutex m_mutex;
+};
+
+class NetExtractorWorker
+  : public tl::Worker
+{
+public:
+  NetExtractorWorker (NetExtractorJob *job)
+    : tl::Worker (), mp_job (job)
+  {
+    //  .. nothing yet ..
+  }
+
+  void perform_task (tl::Task *task)
+  {
+    NetExtractorJob::NetExtractorTask *extractor_task = dynamic_cast<NetExtractorJob::NetExtractorTask *> (task);
+    if (extractor_task) {
+      mp_job->process (extractor_task->index (), m_ep);
+    }
+  }
+
+private:
+  NetExtractorJob *mp_job;
+  db::EdgeProcessor m_ep;
+};
+
+tl::Worker *
+NetExtractorJob::create_worker ()
+{
+  return new NetExtractorWorker (this);
+}
+
+// -----------------------------------------------------------------------------------
+//  Joining the tiles
+
+/**
+ *  @brief A union-find structure for the items of all tiles
+ */
+class NetExtractorClusters
+{
+public:
+  size_t add ()
+  {
+    m_parent.push_back (m_parent.size ());
+    return m_parent.size () - 1;
+  }
+
+  void join (size_t a, size_t b)
+  {
+    size_t ra = root (a), rb = root (b);
+    if (ra != rb) {
+      m_parent [std::max (ra, rb)] = std::min (ra, rb);
+    }
+  }
+
+  size_t root (size_t i)
+  {
+    while (m_parent [i] != i) {
+      m_parent [i] = m_parent [m_parent [i]];
+      i = m_parent [i];
+    }
+    return i;
+  }
+
+  size_t size () const
+  {
+    return m_parent.size ();
+  }
+
+private:
+  std::vector<size_t> m_parent;
+};
+
+/**
+ *  @brief A piece of a computed shape at a tile boundary
+ */
+struct NetExtractorSeamItem
+{
+  NetExtractorSeamItem (const NetExtractorItem *i, size_t t, size_t id)
+    : item (i), tile (t), global_id (id)
+  {
+    //  .. nothing yet ..
+  }
+
+  const NetExtractorItem *item;
+  size_t tile;
+  size_t global_id;
+};
+
+struct NetExtractorSeamItemBoxConverter
+{
+  typedef db::Box box_type;
+
+  db::Box operator() (const NetExtractorSeamItem &s) const
+  {
+    return s.item->shape.bbox ();
+  }
+};
+
+/**
+ *  @brief A box scanner receiver joining the pieces of computed shapes across the tile boundaries
+ */
+class NetExtractorSeamReceiver
+  : public db::box_scanner_receiver<NetExtractorSeamItem, size_t>
+{
+public:
+  NetExtractorSeamReceiver (const NetTracerData &data, NetExtractorClusters &clusters)
+    : mp_data (&data), mp_clusters (&clusters)
+  {
+    //  .. nothing yet ..
+  }
+
+  void add (const NetExtractorSeamItem *a, size_t, const NetExtractorSeamItem *b, size_t)
+  {
+    if (a->tile != b->tile && items_connected (*a->item, *b->item, *mp_data)) {
+      mp_clusters->join (a->global_id, b->global_id);
+    }
+  }
+
+private:
+  const NetTracerData *mp_data;
+  NetExtractorClusters *mp_clusters;
+};
+
+static bool
+net_less (const ExtractedNet &a, const ExtractedNet &b)
+{
+  if (a.bbox ().left () != b.bbox ().left ()) {
+    return a.bbox ().left () < b.bbox ().left ();
+  }
+  if (a.bbox ().bottom () != b.bbox ().bottom ()) {
+    return a.bbox ().bottom () < b.bbox ().bottom ();
+  }
+  if (a.bbox ().right () != b.bbox ().right ()) {
+    return a.bbox ().right () < b.bbox ().right ();
+  }
+  if (a.bbox ().top () != b.bbox ().top ()) {
+    return a.bbox ().top () < b.bbox ().top ();
+  }
+  return a.size () < b.size ();
+}
+
+// -----------------------------------------------------------------------------------
+//  NetExtractor implementation
+
+//  The minimum tile size in database units
+const db::Coord min_tile_size = 100;
+
+//  The maximum number of tiles
+const size_t max_tiles = 100000;
+
+NetExtractor::NetExtractor ()
+  : m_tile_size (1000.0), m_threads (0)
+{
+  //  .. nothing yet ..
+}
+
+NetExtractor::~NetExtractor ()
+{
+  clear ();
+}
+
+void
+NetExtractor::clear ()
+{
+  m_nets.clear ();
+  for (std::vector<NetTracerShapeHeap *>::const_iterator h = m_heaps.begin (); h != m_heaps.end (); ++h) {
+    delete *h;
+  }
+  m_heaps.clear ();
+}
+
+const ExtractedNet &
+NetExtractor::net (size_t index) const
+{
+  if (index >= m_nets.size ()) {
+    throw tl::Exception (tl::to_string (QObject::tr ("Invalid net index %lu (there are %lu nets)")), (unsigned long) index, (unsigned long) m_nets.size ());
+  }
+  return m_nets [index];
+}
+
+std::vector<size_t>
+NetExtractor::nets_with_label (const std::string &label) const
+{
+  std::vector<size_t> nets;
+  for (std::vector<ExtractedNet>::const_iterator n = m_nets.begin (); n != m_nets.end (); ++n) {
+    if (std::binary_search (n->labels ().begin (), n->labels ().end (), label)) {
+      nets.push_back (n - m_nets.begin ());
+    }
+  }
+  return nets;
+}
+
+void
+NetExtractor::extract (const db::Layout &layout, const db::Cell &cell, const NetTracerData &data)
+{
+  clear ();
+
+  tl::SelfTimer timer (tl::verbosity () >= 11, tl::to_string (QObject::tr ("Net extraction")));
+
+  //  the layout must not change its state while the workers iterate it
+  layout.update ();
+
+  std::set<unsigned int> original_layers = data.original_layers ();
+
+  db::Box bbox;
+  for (std::set<unsigned int>::const_iterator l = original_layers.begin (); l != original_layers.end (); ++l) {
+    if (layout.is_valid_layer (*l)) {
+      bbox += cell.bbox (*l);
+    }
+  }
+
+  if (bbox.empty ()) {
+    return;
+  }
+
+  //  form the tiles
+  std::vector<NetExtractorTile> tiles;
+
+  size_t ntiles_w = 1, ntiles_h = 1;
+  if (m_tile_size > 0.0) {
+
+    double nw = floor (bbox.width () * layout.dbu () / m_tile_size + 0.5);
+    double nh = floor (bbox.height () * layout.dbu () / m_tile_size + 0.5);
+
+    //  very small tile sizes are clamped: the tiles do not get smaller than min_tile_size
+    //  database units and there are not more than max_tiles tiles
+    nw = std::max (1.0, std::min (nw, double (bbox.width () / min_tile_size)));
+    nh = std::max (1.0, std::min (nh, double (bbox.height () / min_tile_size)));
+    if (nw * nh > double (max_tiles)) {
+      double f = sqrt (double (max_tiles) / (nw * nh));
+      nw = std::max (1.0, floor (nw * f));
+      nh = std::max (1.0, floor (nh * f));
+    }
+
+    ntiles_w = size_t (nw);
+    ntiles_h = size_t (nh);
+
+  }
+
+  db::Coord tile_width = bbox.width () / ntiles_w;
+  db::Coord tile_height = bbox.height () / ntiles_h;
+
+  tiles.reserve (ntiles_w * ntiles_h);
+  for (size_t nw = 0; nw < ntiles_w; ++nw) {
+    for (size_t nh = 0; nh < ntiles_h; ++nh) {
+      tiles.push_back (NetExtractorTile (db::Box (bbox.left () + nw * tile_width,
+                                                  bbox.bottom () + nh * tile_height,
+                                                  (nw == ntiles_w - 1) ? bbox.right () : bbox.left () + (nw + 1) * tile_width,
+                                                  (nh == ntiles_h - 1) ? bbox.top () : bbox.bottom () + (nh + 1) * tile_height)));
+    }
+  }
+
+  //  the heaps hold the computed shapes which are referred to by the nets
+  for (std::vector<NetExtractorTile>::const_iterator t = tiles.begin (); t != tiles.end (); ++t) {
+    m_heaps.push_back (t->heap);
+  }
+
+  {
+    tl::RelativeProgress progress (tl::to_string (QObject::tr ("Extracting nets")), tiles.size (), 1);
+    NetExtractorJob job (m_threads, layout, cell, data, tiles);
+    job.run (&progress);
+  }
+
+  //  join the items of all tiles: original shapes are identified by the shape, the computed
+  //  ones are unique per tile and are joined across the tile boundaries in the seam merge step
+  NetExtractorClusters clusters;
+  std::vector<const NetExtractorItem *> global_items;
+  std::map<NetTracerShape, size_t> shape_ids;
+  std::vector<NetExtractorSeamItem> seam_items;
+
+  for (size_t t = 0; t < tiles.size (); ++t) {
+
+    const NetExtractorTile &tile = tiles [t];
+
+    std::vector<size_t> ids;
+    ids.reserve (tile.items.size ());
+
+    for (std::vector<NetExtractorItem>::const_iterator i = tile.items.begin (); i != tile.items.end (); ++i) {
+
+      size_t id = 0;
+
+      if (i->computed) {
+
+        id = clusters.add ();
+        global_items.push_back (&*i);
+
+        const db::Box &b = i->shape.bbox ();
+        if (b.left () <= tile.box.left () || b.right () >= tile.box.right () || b.bottom () <= tile.box.bottom () || b.top () >= tile.box.top ()) {
+          seam_items.push_back (NetExtractorSeamItem (&*i, t, id));
+        }
+
+      } else {
+
+        std::map<NetTracerShape, size_t>::const_iterator s = shape_ids.find (i->shape);
+        if (s != shape_ids.end ()) {
+          id = s->second;
+        } else {
+          id = clusters.add ();
+          global_items.push_back (&*i);
+          shape_ids.insert (std::make_pair (i->shape, id));
+        }
+
+      }
+
+      ids.push_back (id);
+
+    }
+
+    for (std::vector<std::pair<size_t, size_t> >::const_iterator i = tile.interactions.begin (); i != tile.interactions.end (); ++i) {
+      clusters.join (ids [i->first], ids [i->second]);
+    }
+
+  }
+
+  if (tiles.size () > 1 && ! seam_items.empty ()) {
+
+    db::box_scanner<NetExtractorSeamItem, size_t> scanner;
+    scanner.reserve (seam_items.size ());
+    for (size_t i = 0; i < seam_items.size (); ++i) {
+      scanner.insert (&seam_items [i], i);
+    }
+
+    NetExtractorSeamReceiver rec (data, clusters);
+    scanner.process (rec, 1 /*touching*/, NetExtractorSeamItemBoxConverter ());
+
+  }
+
+  //  form the nets
+  std::vector<size_t> net_index (clusters.size (), std::numeric_limits<size_t>::max ());
+  std::vector<unsigned int> name_depth;
+
+  for (size_t id = 0; id < clusters.size (); ++id) {
+
+    size_t r = clusters.root (id);
+    if (net_index [r] == std::numeric_limits<size_t>::max ()) {
+      net_index [r] = m_nets.size ();
+      m_nets.push_back (ExtractedNet ());
+      name_depth.push_back (std::numeric_limits<unsigned int>::max ());
+    }
+
+    size_t n = net_index [r];
+    ExtractedNet &net = m_nets [n];
+    const NetExtractorItem *item = global_items [id];
+
+    net.m_shapes.push_back (item->shape);
+    net.m_bbox += item->shape.bbox ();
+
+    if (item->is_text ()) {
+      std::string text = item->shape.shape ().text_string ();
+      net.m_labels.push_back (text);
+      if (item->depth < name_depth [n] || (item->depth == name_depth [n] && text < net.m_name)) {
+        net.m_name = text;
+        name_depth [n] = item->depth;
+      }
+    }
+
+  }
+
+  //  texts not attached to a shape do not form a net
+  std::vector<ExtractedNet>::iterator w = m_nets.begin ();
+  for (std::vector<ExtractedNet>::iterator n = m_nets.begin (); n != m_nets.end (); ++n) {
+    if (n->m_labels.size () < n->m_shapes.size ()) {
+      std::sort (n->m_labels.begin (), n->m_labels.end ());
+      n->m_labels.erase (std::unique (n->m_labels.begin (), n->m_labels.end ()), n->m_labels.end ());
+      if (w != n) {
+        w->m_name.swap (n->m_name);
+        w->m_labels.swap (n->m_labels);
+        w->m_shapes.swap (n->m_shapes);
+        w->m_bbox = n->m_bbox;
+      }
+      ++w;
+    }
+  }
+  m_nets.erase (w, m_nets.end ());
+
+  std::stable_sort (m_nets.begin (), m_nets.end (), net_less);
+
+  if (tl::verbosity () >= 20) {
+    tl::info << "Net extraction delivered " << m_nets.size () << " net(s) from " << clusters.size () << " shape(s) in " << tiles.size () << " tile(s)";
+  }
+}
+
+}
+
@@ -0,0 +1,260 @@
+
+/*
+
+  KLayout Layout Viewer
+  Copyright (C) 2006-2017 Matthias Koefferlein
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+
+
+#ifndef HDR_extNetExtractor
+#define HDR_extNetExtractor
+
+#include "extCommon.h"
+#include "extNetTracer.h"
+#include "tlTypeTraits.h"
+
+#include <vector>
+#include <string>
+
+namespace ext
+{
+
+/**
+ *  @brief A net delivered by the net extractor
+ *
+ *  A net is a set of shapes (see NetTracerShape) which are connected according to the
+ *  connectivity rules of the NetTracerData object. Texts on the conductor layers which
+ *  are attached to one of the shapes are part of the net as well and deliver the labels.
+ */
+class EXT_PUBLIC ExtractedNet
+{
+public:
+  typedef std::vector<NetTracerShape>::const_iterator iterator;
+
+  /**
+   *  @brief Creates an empty net
+   */
+  ExtractedNet ();
+
+  /**
+   *  @brief Gets the name of the net
+   *
+   *  The name is taken from the text attached to the net which is closest to the top
+   *  of the hierarchy. If there are multiple such texts, the first one in alphabetical
+   *  order is taken. If there is no text, the name is empty.
+   */
+  const std::string &name () const
+  {
+    return m_name;
+  }
+
+  /**
+   *  @brief Gets the labels of the net
+   *
+   *  This is the sorted list of all distinct texts attached to the net. A net with
+   *  more than one label is a candidate for a short.
+   */
+  const std::vector<std::string> &labels () const
+  {
+    return m_labels;
+  }
+
+  /**
+   *  @brief Gets the bounding box of the net in the coordinate system of the top cell
+   */
+  const db::Box &bbox () const
+  {
+    return m_bbox;
+  }
+
+  /**
+   *  @brief Begin iterator for the shapes of the net
+   */
+  iterator begin () const
+  {
+    return m_shapes.begin ();
+  }
+
+  /**
+   *  @brief End iterator for the shapes of the net
+   */
+  iterator end () const
+  {
+    return m_shapes.end ();
+  }
+
+  /**
+   *  @brief Gets the number of shapes of the net
+   */
+  size_t size () const
+  {
+    return m_shapes.size ();
+  }
+
+private:
+  friend class NetExtractor;
+
+  std::string m_name;
+  std::vector<std::string> m_labels;
+  std::vector<NetTracerShape> m_shapes;
+  db::Box m_bbox;
+};
+
+/**
+ *  @brief The full-chip net extractor
+ *
+ *  While the net tracer follows a single net from a seed, the net extractor delivers all nets
+ *  of a cell at once. It uses the same connectivity description (NetTracerData) including the
+ *  computed layers.
+ *
+ *  The cell is divided into tiles which are processed in parallel. Inside each tile, the
+ *  shapes of all layers involved in connections are collected flat, the computed layers are
+ *  evaluated and clipped at the tile boundary and the interactions between shapes on connected
+ *  layers are determined with a box scanner. The nets are formed from these interactions
+ *  with a union-find over all tiles: original shapes reaching into several tiles join the nets
+ *  found in these tiles and the pieces of computed shapes which have been cut at the tile
+ *  boundaries are joined again in a seam merge step.
+ */
+class EXT_PUBLIC NetExtractor
+{
+public:
+  typedef std::vector<ExtractedNet>::const_iterator iterator;
+
+  /**
+   *  @brief Constructor
+   */
+  NetExtractor ();
+
+  /**
+   *  @brief Destructor
+   */
+  ~NetExtractor ();
+
+  /**
+   *  @brief Sets the tile size in micrometer units
+   *
+   *  0 disables tiling. The default tile size is 1000 micrometers. Very small tile sizes
+   *  are clamped: tiles are not smaller than 100 database units and the number of tiles
+   *  is limited to 100000.
+   */
+  void set_tile_size (double ts)
+  {
+    m_tile_size = ts;
+  }
+
+  /**
+   *  @brief Gets the tile size
+   */
+  double tile_size () const
+  {
+    return m_tile_size;
+  }
+
+  /**
+   *  @brief Sets the number of threads to use (0 for synchronous operation)
+   */
+  void set_threads (int n)
+  {
+    m_threads = n;
+  }
+
+  /**
+   *  @brief Gets the number of threads
+   */
+  int threads () const
+  {
+    return m_threads;
+  }
+
+  /**
+   *  @brief Extracts all nets of the given cell with the given connectivity
+   *
+   *  Shapes not participating in a connection are not considered. The nets are sorted by
+   *  the lower-left corner of their bounding box.
+   */
+  void extract (const db::Layout &layout, const db::Cell &cell, const NetTracerData &data);
+
+  /**
+   *  @brief Clears the nets
+   */
+  void clear ();
+
+  /**
+   *  @brief Begin iterator for the nets
+   */
+  iterator begin () const
+  {
+    return m_nets.begin ();
+  }
+
+  /**
+   *  @brief End iterator for the nets
+   */
+  iterator end () const
+  {
+    return m_nets.end ();
+  }
+
+  /**
+   *  @brief Gets the number of nets
+   */
+  size_t size () const
+  {
+    return m_nets.size ();
+  }
+
+  /**
+   *  @brief Gets the net with the given index
+   *
+   *  Throws an exception if the index is not valid.
+   */
+  const ExtractedNet &net (size_t index) const;
+
+  /**
+   *  @brief Gets the indexes of the nets carrying the given label
+   *
+   *  More than one net for a label indicates an open.
+   */
+  std::vector<size_t> nets_with_label (const std::string &label) const;
+
+private:
+  double m_tile_size;
+  int m_threads;
+  std::vector<ExtractedNet> m_nets;
+  std::vector<NetTracerShapeHeap *> m_heaps;
+
+  NetExtractor (const NetExtractor &);
+  NetExtractor &operator= (const NetExtractor &);
+};
+
+}
+
+namespace tl
+{
+
+//  type traits for NetExtractor
+template <>
+struct type_traits<ext::NetExtractor> : public type_traits<void> {
+  typedef tl::false_tag has_copy_constructor;
+};
+
+}
+
+#endif
+
@@ -30,6 +30,10 @@
 #include "layPlugin.h"
 #include "layLayoutView.h"
 #include "tlLog.h"
+#include "tlThreadedWorkers.h"
+#include "tlTimer.h"
+
+#include <QMutex>
 
 //  -O3 appears not to work properly for gcc 4.4.7 (RHEL 6)
 //  In that case, the net tracer function crashes.
@@ -213,6 +217,16 @@ NetTracerData::connections (unsigned int from_layer) const
   }
 } 
 
+std::set<unsigned int>
+NetTracerData::original_layers () const
+{
+  std::set <unsigned int> layers;
+  for (std::map <unsigned int, std::set <unsigned int> >::const_iterator g = m_connection_graph.begin (); g != m_connection_graph.end (); ++g) {
+    layers.insert (g->second.begin (), g->second.end ());
+  }
+  return layers;
+}
+
 std::set<unsigned int> 
 NetTracerData::log_layers_for (unsigned int original_layer) const
 {
@@ -237,6 +251,16 @@ NetTracerData::log_connections (unsigned int from_layer) const
   }
 }
 
+std::set<unsigned int>
+NetTracerData::log_layers () const
+{
+  std::set <unsigned int> layers;
+  for (std::map <unsigned int, std::set <unsigned int> >::const_iterator g = m_log_connection_graph.begin (); g != m_log_connection_graph.end (); ++g) {
+    layers.insert (g->first);
+  }
+  return layers;
+}
+
 int 
 NetTracerData::find_symbol (const std::string &symbol) const
 {
@@ -698,21 +722,374 @@ NetTracerLayerExpression::to_string () const
   return s;
 }
 
+// -----------------------------------------------------------------------------------
+//  NetTracerIndex implementation
+
+class NetTracerIndexJob
+  : public tl::JobBase
+{
+public:
+  NetTracerIndexJob (int nworkers, const db::Layout &layout, const db::Cell &cell)
+    : tl::JobBase (nworkers), mp_layout (&layout), mp_cell (&cell), m_done (0)
+  {
+    //  .. nothing yet ..
+  }
+
+  void process (unsigned int layer, NetTracerIndexTree &tree)
+  {
+    db::RecursiveShapeIterator s (*mp_layout, *mp_cell, layer);
+    s.shape_flags (db::ShapeIterator::Polygons | db::ShapeIterator::Paths | db::ShapeIterator::Boxes | db::ShapeIterator::Texts);
+    for ( ; ! s.at_end (); ++s) {
+      tree.insert (NetTracerIndexEntry (NetTracerShape (s.trans (), s.shape (), layer, s.cell_index ()), (unsigned int) s.depth ()));
+    }
+
+    tree.sort (NetTracerIndexEntryBoxConverter ());
+
+    QMutexLocker locker (&m_mutex);
+    ++m_done;
+  }
+
+  size_t done ()
+  {
+    QMutexLocker locker (&m_mutex);
+    return m_done;
+  }
+
+  virtual tl::Worker *create_worker ();
+
+  class NetTracerIndexTask
+    : public tl::Task
+  {
+  public:
+    NetTracerIndexTask (unsigned int layer, NetTracerIndexTree *tree)
+      : m_layer (layer), mp_tree (tree)
+    {
+      //  .. nothing yet ..
+    }
+
+    unsigned int layer () const
+    {
+      return m_layer;
+    }
+
+    NetTracerIndexTree *tree () const
+    {
+      return mp_tree;
+    }
+
+  private:
+    unsigned int m_layer;
+    NetTracerIndexTree *mp_tree;
+  };
+
+private:
+  const db::Layout *mp_layout;
+  const db::Cell *mp_cell;
+  size_t m_done;
+  QMutex m_mutex;
+};
+
+class NetTracerIndexWorker
+  : public tl::Worker
+{
+public:
+  NetTracerIndexWorker (NetTracerIndexJob *job)
+    : tl::Worker (), mp_job (job)
+  {
+    //  .. nothing yet ..
+  }
+
+  void perform_task (tl::Task *task)
+  {
+    NetTracerIndexJob::NetTracerIndexTask *index_task = dynamic_cast<NetTracerIndexJob::NetTracerIndexTask *> (task);
+    if (index_task) {
+      mp_job->process (index_task->layer (), *index_task->tree ());
+    }
+  }
+
+private:
+  NetTracerIndexJob *mp_job;
+};
+
+tl::Worker *
+NetTracerIndexJob::create_worker ()
+{
+  return new NetTracerIndexWorker (this);
+}
+
+NetTracerIndex::NetTracerIndex ()
+  : tl::Object (), mp_layout (0), m_cell_index (0)
+{
+  //  .. nothing yet ..
+}
+
+NetTracerIndex::NetTracerIndex (const NetTracerIndex & /*other*/)
+  : tl::Object (), mp_layout (0), m_cell_index (0)
+{
+  //  .. nothing yet ..
+}
+
+NetTracerIndex &
+NetTracerIndex::operator= (const NetTracerIndex &other)
+{
+  if (this != &other) {
+    clear ();
+  }
+  return *this;
+}
+
+void
+NetTracerIndex::clear ()
+{
+  detach_from_all_events ();
+  mp_layout = 0;
+  m_cell_index = 0;
+  m_trees.clear ();
+}
+
+void
+NetTracerIndex::layout_changed ()
+{
+  clear ();
+}
+
+void
+NetTracerIndex::layout_status_changed (gsi::ObjectBase::StatusEventType type)
+{
+  if (type == gsi::ObjectBase::ObjectDestroyed) {
+    clear ();
+  }
+}
+
+void
+NetTracerIndex::build (const db::Layout &layout, const db::Cell &cell, const std::set<unsigned int> &layers, int threads)
+{
+  clear ();
+
+  tl::SelfTimer timer (tl::verbosity () >= 11, tl::to_string (QObject::tr ("Building net tracer index")));
+
+  //  the layout must not change its state while the workers iterate it
+  layout.update ();
+
+  NetTracerIndexJob job (threads, layout, cell);
+  for (std::set<unsigned int>::const_iterator l = layers.begin (); l != layers.end (); ++l) {
+    if (layout.is_valid_layer (*l)) {
+      //  NOTE: the map entries are created before the workers start, so the trees stay at their place
+      NetTracerIndexTree &tree = m_trees.insert (std::make_pair (*l, NetTracerIndexTree ())).first->second;
+      job.schedule (new NetTracerIndexJob::NetTracerIndexTask (*l, &tree));
+    }
+  }
+
+  tl::RelativeProgress progress (tl::to_string (QObject::tr ("Building net tracer index")), m_trees.size (), 1);
+
+  try {
+
+    job.start ();
+    while (job.is_running ()) {
+      //  This may throw an exception, if the cancel button has been pressed.
+      progress.set (job.done ());
+      job.wait (100);
+    }
+
+  } catch (...) {
+    job.terminate ();
+    m_trees.clear ();
+    throw;
+  }
+
+  if (job.has_error ()) {
+    m_trees.clear ();
+    throw tl::Exception (tl::to_string (QObject::tr ("Errors occured during processing. First error message says:\n")) + job.error_messages ().front ());
+  }
+
+  //  any change of the layout invalidates the index. This includes the destruction of the layout:
+  //  the layout's destructor clears the layout which issues a hier_changed_event (the hierarchy
+  //  was updated above, so it is not dirty). In addition, we listen for the destruction of the
+  //  layout explicitly if there are script clients attached already.
+  //  NOTE: we must not create the status event ourselves - this would interfere with the
+  //  keep/release protocol between the layout and its script clients.
+  db::Layout &nc_layout = const_cast<db::Layout &> (layout);
+  nc_layout.hier_changed_event.add (this, &NetTracerIndex::layout_changed);
+  nc_layout.bboxes_changed_any_event.add (this, &NetTracerIndex::layout_changed);
+  if (nc_layout.has_status_changed_event ()) {
+    nc_layout.status_changed_event ().add (this, &NetTracerIndex::layout_status_changed);
+  }
+
+  mp_layout = &layout;
+  m_cell_index = cell.cell_index ();
+
+  if (tl::verbosity () >= 20) {
+    tl::info << "Net tracer index built with " << size () << " shapes on " << m_trees.size () << " layer(s)";
+  }
+}
+
+bool
+NetTracerIndex::covers (const db::Layout &layout, const db::Cell &cell, const std::set<unsigned int> &layers) const
+{
+  if (mp_layout != &layout || m_cell_index != cell.cell_index ()) {
+    return false;
+  }
+
+  for (std::set<unsigned int>::const_iterator l = layers.begin (); l != layers.end (); ++l) {
+    if (layout.is_valid_layer (*l) && m_trees.find (*l) == m_trees.end ()) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+const NetTracerIndexTree &
+NetTracerIndex::tree (unsigned int layer) const
+{
+  std::map<unsigned int, NetTracerIndexTree>::const_iterator t = m_trees.find (layer);
+  if (t != m_trees.end ()) {
+    return t->second;
+  } else {
+    //  layers which did not exist when the index was built
+    static NetTracerIndexTree empty;
+    return empty;
+  }
+}
+
+void
+NetTracerIndex::trees (const std::set<unsigned int> &layers, NetTracerIndexTrees &trees) const
+{
+  trees.clear ();
+  trees.reserve (layers.size ());
+  for (std::set<unsigned int>::const_iterator l = layers.begin (); l != layers.end (); ++l) {
+    trees.push_back (&tree (*l));
+  }
+}
+
+size_t
+NetTracerIndex::size () const
+{
+  size_t n = 0;
+  for (std::map<unsigned int, NetTracerIndexTree>::const_iterator t = m_trees.begin (); t != m_trees.end (); ++t) {
+    n += t->second.size ();
+  }
+  return n;
+}
+
+// -----------------------------------------------------------------------------------
+//  A helper class delivering the shapes touching a box on a set of layers
+
+/**
+ *  @brief Iterates over the shapes touching a box
+ *
+ *  The shapes are taken from the connectivity index if one is given. Otherwise they are
+ *  taken from the layout through a recursive shape iterator.
+ */
+class NetShapeIterator
+{
+public:
+  NetShapeIterator (const db::Layout &layout, const db::Cell &cell, const NetTracerIndexTrees *trees, const std::set<unsigned int> &layers, const db::Box &box)
+    : mp_trees (trees), m_box (box), m_layer (0)
+  {
+    if (mp_trees) {
+      if (! mp_trees->empty ()) {
+        m_touching = (*mp_trees) [0]->begin_touching (m_box, NetTracerIndexEntryBoxConverter ());
+        next_layer ();
+      }
+    } else {
+      m_iter = db::RecursiveShapeIterator (layout, cell, layers, box);
+      fetch ();
+    }
+  }
+
+  bool at_end () const
+  {
+    if (mp_trees) {
+      return m_layer >= mp_trees->size ();
+    } else {
+      return m_iter.at_end ();
+    }
+  }
+
+  void operator++ ()
+  {
+    if (mp_trees) {
+      ++m_touching;
+      next_layer ();
+    } else {
+      ++m_iter;
+      fetch ();
+    }
+  }
+
+  const NetTracerShape &shape () const
+  {
+    if (mp_trees) {
+      return m_touching->shape;
+    } else {
+      return m_shape;
+    }
+  }
+
+  unsigned int depth () const
+  {
+    if (mp_trees) {
+      return m_touching->depth;
+    } else {
+      return (unsigned int) m_iter.depth ();
+    }
+  }
+
+private:
+  const NetTracerIndexTrees *mp_trees;
+  db::Box m_box;
+  size_t m_layer;
+  NetTracerIndexTree::touching_iterator m_touching;
+  db::RecursiveShapeIterator m_iter;
+  NetTracerShape m_shape;
+
+  void next_layer ()
+  {
+    while (m_touching.at_end ()) {
+      if (++m_layer >= mp_trees->size ()) {
+        break;
+      }
+      m_touching = (*mp_trees) [m_layer]->begin_touching (m_box, NetTracerIndexEntryBoxConverter ());
+    }
+  }
+
+  void fetch ()
+  {
+    if (! m_iter.at_end ()) {
+      m_shape = NetTracerShape (m_iter.trans (), m_iter.shape (), m_iter.layer (), m_iter.cell_index ());
+    }
+  }
+};
+
 // -----------------------------------------------------------------------------------
 //  NetTracer implementation
 
 NetTracer::NetTracer ()
-  : mp_layout (0), mp_cell (0), mp_progress (0), m_name_hier_depth (-1), m_incomplete (false)
+  : mp_layout (0), mp_cell (0), mp_progress (0), m_name_hier_depth (-1), m_incomplete (false), m_use_index (true), m_index_threads (0)
 {
   //  .. nothing yet ..
 }
 
+void
+NetTracer::set_use_index (bool f)
+{
+  m_use_index = f;
+  if (! f) {
+    m_index.clear ();
+    m_seed_trees.clear ();
+  }
+}
+
 void 
 NetTracer::clear ()
 {
   m_shapes_graph.clear ();
   m_shapes_found.clear ();
   m_shape_heap.clear ();
+  m_name.clear ();
+  m_name_hier_depth = -1;
+  m_incomplete = false;
 }
 
 std::string
@@ -799,10 +1176,11 @@ NetTracer::compute_results_for_next_iteration (const std::vector <const NetTrace
   m_ep.simple_merge (secondary_seed_polygons, secondary_seed_hull, false);
 
   const std::set<unsigned int> &connected_layers = data.connections (seed_layer);
+  const NetTracerSeedTrees *st = seed_trees (seed_layer);
 
   //  collect all shapes related to that seed hull
   for (std::vector <db::Polygon>::const_iterator s = secondary_seed_hull.begin (); s != secondary_seed_hull.end (); ++s) {
-    determine_interactions (*s, 0, connected_layers, current);
+    determine_interactions (*s, 0, connected_layers, st ? &st->connected : 0, current);
   }
 
 #if 0 
@@ -842,6 +1220,15 @@ NetTracer::trace (const db::Layout &layout, const db::Cell &cell, const NetTrace
   m_shapes_graph.clear ();
   m_shapes_found.clear ();
 
+  m_seed_trees.clear ();
+  if (m_use_index) {
+    std::set<unsigned int> layers = data.original_layers ();
+    if (! m_index.covers (layout, cell, layers)) {
+      m_index.build (layout, cell, layers, m_index_threads);
+    }
+    resolve_seed_trees (data);
+  }
+
   try {
 
     tl::AbsoluteProgress progress (tl::to_string (QObject::tr ("Tracing Net")), 1);
@@ -966,6 +1353,9 @@ NetTracer::trace (const db::Layout &layout, const db::Cell &cell, const NetTrace
       const std::pair <std::set <unsigned int>, std::set <unsigned int> > &bb = data.requires_booleans (seed_layer);
       const std::set<unsigned int> &connected_layers_with_booleans = bb.second;
       const std::set<unsigned int> &connected_layers_without_booleans = bb.first;
+      const NetTracerSeedTrees *st = seed_trees (seed_layer);
+      const NetTracerIndexTrees *trees_with_booleans = st ? &st->with_booleans : 0;
+      const NetTracerIndexTrees *trees_without_booleans = st ? &st->without_booleans : 0;
 
       if (! connected_layers_with_booleans.empty ()) {
 
@@ -982,22 +1372,22 @@ NetTracer::trace (const db::Layout &layout, const db::Cell &cell, const NetTrace
           if (c->shape ().is_box ()) {
 
             if (c->trans ().is_ortho ()) {
-              determine_interactions (c->bbox (), c /*do not do seed assignment*/, connected_layers_with_booleans, new_entries);
+              determine_interactions (c->bbox (), c /*do not do seed assignment*/, connected_layers_with_booleans, trees_with_booleans, new_entries);
             } else {
               db::Polygon box_poly (c->shape ().box ());
               box_poly.transform (db::ICplxTrans (c->trans ()));
-              determine_interactions (box_poly, c /*do not do seed assignment*/, connected_layers_with_booleans, new_entries);
+              determine_interactions (box_poly, c /*do not do seed assignment*/, connected_layers_with_booleans, trees_with_booleans, new_entries);
             }
 
           } else if (c->shape ().is_polygon () || c->shape ().is_path ()) {
             db::Polygon p;
             c->shape ().polygon (p);
             p.transform (db::ICplxTrans (c->trans ()));
-            determine_interactions (p, c /*do not do seed assignment*/, connected_layers_with_booleans, new_entries);
+            determine_interactions (p, c /*do not do seed assignment*/, connected_layers_with_booleans, trees_with_booleans, new_entries);
           }
 
         } else if (! new_seeds.empty ()) {
-          determine_interactions (new_seeds, combined_box, connected_layers_with_booleans, new_entries, true /*do not do seed assignment*/);
+          determine_interactions (new_seeds, combined_box, connected_layers_with_booleans, trees_with_booleans, new_entries, true /*do not do seed assignment*/);
         }
 
         std::set <unsigned int> computed_layers;
@@ -1023,22 +1413,22 @@ NetTracer::trace (const db::Layout &layout, const db::Cell &cell, const NetTrace
           if (c->shape ().is_box ()) {
 
             if (c->trans ().is_ortho ()) {
-              determine_interactions (c->bbox (), c, connected_layers_without_booleans, m_hit_test_queue);
+              determine_interactions (c->bbox (), c, connected_layers_without_booleans, trees_without_booleans, m_hit_test_queue);
             } else {
               db::Polygon box_poly (c->shape ().box ());
               box_poly.transform (db::ICplxTrans (c->trans ()));
-              determine_interactions (box_poly, c, connected_layers_without_booleans, m_hit_test_queue);
+              determine_interactions (box_poly, c, connected_layers_without_booleans, trees_without_booleans, m_hit_test_queue);
             }
 
           } else if (c->shape ().is_polygon () || c->shape ().is_path ()) {
             db::Polygon p;
             c->shape ().polygon (p);
             p.transform (db::ICplxTrans (c->trans ()));
-            determine_interactions (p, c, connected_layers_without_booleans, m_hit_test_queue);
+            determine_interactions (p, c, connected_layers_without_booleans, trees_without_booleans, m_hit_test_queue);
           }
 
         } else if (! new_seeds.empty ()) {
-          determine_interactions (new_seeds, combined_box, connected_layers_without_booleans, m_hit_test_queue, true);
+          determine_interactions (new_seeds, combined_box, connected_layers_without_booleans, trees_without_booleans, m_hit_test_queue, true);
         }
 
       }
@@ -1156,12 +1546,12 @@ NetTracer::trace (const db::Layout &layout, const db::Cell &cell, const NetTrace
 }
 
 void 
-NetTracer::evaluate_text (const db::RecursiveShapeIterator &iter)
+NetTracer::evaluate_text (const NetTracerShape &shape, unsigned int depth)
 {
-  if (iter.shape ().is_text ()) {
-    if (m_name.empty () || m_name_hier_depth < 0 || m_name_hier_depth > int (iter.depth ())) {
-      m_name = iter.shape ().text_string ();
-      m_name_hier_depth = int (iter.depth ());
+  if (shape.shape ().is_text ()) {
+    if (m_name.empty () || m_name_hier_depth < 0 || m_name_hier_depth > int (depth)) {
+      m_name = shape.shape ().text_string ();
+      m_name_hier_depth = int (depth);
     }
   }
 }
@@ -1216,7 +1606,33 @@ NetTracer::deliver_shape (const NetTracerShape &net_shape, const NetTracerShape
 }
 
 void
-NetTracer::determine_interactions (const std::vector<const NetTracerShape *> &seeds, const db::Box &combined_box, const std::set<unsigned int> &layers, std::set <std::pair<NetTracerShape, const NetTracerShape *> > &delivery, bool do_seed_assignment)
+NetTracer::resolve_seed_trees (const NetTracerData &data)
+{
+  //  the layers connected to each seed layer (including the via layers) are resolved into 
+  //  index trees once, so the queries don't need to look up the layers
+  std::set<unsigned int> seed_layers = data.log_layers ();
+  for (std::set<unsigned int>::const_iterator l = seed_layers.begin (); l != seed_layers.end (); ++l) {
+    NetTracerSeedTrees &st = m_seed_trees [*l];
+    m_index.trees (data.connections (*l), st.connected);
+    const std::pair <std::set <unsigned int>, std::set <unsigned int> > &bb = data.requires_booleans (*l);
+    m_index.trees (bb.first, st.without_booleans);
+    m_index.trees (bb.second, st.with_booleans);
+  }
+}
+
+const NetTracerSeedTrees *
+NetTracer::seed_trees (unsigned int seed_layer) const
+{
+  if (! m_use_index || ! m_index.is_valid ()) {
+    return 0;
+  }
+
+  std::map <unsigned int, NetTracerSeedTrees>::const_iterator st = m_seed_trees.find (seed_layer);
+  return st != m_seed_trees.end () ? &st->second : 0;
+}
+
+void
+NetTracer::determine_interactions (const std::vector<const NetTracerShape *> &seeds, const db::Box &combined_box, const std::set<unsigned int> &layers, const NetTracerIndexTrees *trees, std::set <std::pair<NetTracerShape, const NetTracerShape *> > &delivery, bool do_seed_assignment)
 {
   bool extract_full_graph = m_stop_shape.is_valid ();
 
@@ -1226,16 +1642,16 @@ NetTracer::determine_interactions (const std::vector<const NetTracerShape *> &se
   }
   seed_tree.sort (HitTestDataBoxConverter ());
 
-  db::RecursiveShapeIterator net_shapes (layout (), cell (), layers, combined_box);
+  NetShapeIterator net_shapes (layout (), cell (), trees, layers, combined_box);
   while (! net_shapes.at_end ()) {
 
-    NetTracerShape net_shape (net_shapes.trans (), net_shapes.shape (), net_shapes.layer (), net_shapes.cell_index ());
+    const NetTracerShape &net_shape = net_shapes.shape ();
 
     for (HitTestDataBoxTree::touching_iterator s = seed_tree.begin_touching (net_shape.bbox (), HitTestDataBoxConverter ()); ! s.at_end (); ++s) {
 
       const NetTracerShape *seed = *s;
 
-      evaluate_text (net_shapes);
+      evaluate_text (net_shape, net_shapes.depth ());
 
       bool interact = false;
 
@@ -1271,14 +1687,14 @@ NetTracer::determine_interactions (const std::vector<const NetTracerShape *> &se
 }
 
 void
-NetTracer::determine_interactions (const db::Box &seed, const NetTracerShape *shape, const std::set<unsigned int> &layers, std::set <std::pair<NetTracerShape, const NetTracerShape *> > &delivery)
+NetTracer::determine_interactions (const db::Box &seed, const NetTracerShape *shape, const std::set<unsigned int> &layers, const NetTracerIndexTrees *trees, std::set <std::pair<NetTracerShape, const NetTracerShape *> > &delivery)
 {
-  db::RecursiveShapeIterator net_shapes (layout (), cell (), layers, seed);
+  NetShapeIterator net_shapes (layout (), cell (), trees, layers, seed);
   while (! net_shapes.at_end ()) {
 
-    NetTracerShape net_shape (net_shapes.trans (), net_shapes.shape (), net_shapes.layer (), net_shapes.cell_index ());
+    const NetTracerShape &net_shape = net_shapes.shape ();
 
-    evaluate_text (net_shapes);
+    evaluate_text (net_shape, net_shapes.depth ());
 
     if (interacts (seed, net_shape)) {
       delivery.insert (std::make_pair (net_shape, shape));
@@ -1290,7 +1706,7 @@ NetTracer::determine_interactions (const db::Box &seed, const NetTracerShape *sh
 }
 
 void
-NetTracer::determine_interactions (const db::Polygon &seed, const NetTracerShape *shape, const std::set<unsigned int> &layers, std::set <std::pair<NetTracerShape, const NetTracerShape *> > &delivery)
+NetTracer::determine_interactions (const db::Polygon &seed, const NetTracerShape *shape, const std::set<unsigned int> &layers, const NetTracerIndexTrees *trees, std::set <std::pair<NetTracerShape, const NetTracerShape *> > &delivery)
 {
   int area_ratio = 2;
 
@@ -1300,17 +1716,17 @@ NetTracer::determine_interactions (const db::Polygon &seed, const NetTracerShape
   if (poly_area == box_area && seed.vertices () == 4) {
 
     //  The polygon is a box
-    determine_interactions (seed.box (), shape, layers, delivery);
+    determine_interactions (seed.box (), shape, layers, trees, delivery);
 
   } else if (poly_area + 1 >= box_area / area_ratio) {
 
     //  The polygon is sufficiently "dense", so it can be used as it is.
-    db::RecursiveShapeIterator net_shapes (layout (), cell (), layers, seed.box ());
+    NetShapeIterator net_shapes (layout (), cell (), trees, layers, seed.box ());
     while (! net_shapes.at_end ()) {
 
-      NetTracerShape net_shape (net_shapes.trans (), net_shapes.shape (), net_shapes.layer (), net_shapes.cell_index ());
+      const NetTracerShape &net_shape = net_shapes.shape ();
 
-      evaluate_text (net_shapes);
+      evaluate_text (net_shape, net_shapes.depth ());
 
       if (interacts (seed, net_shape)) {
         delivery.insert (std::make_pair (net_shape, shape));
@@ -1327,7 +1743,7 @@ NetTracer::determine_interactions (const db::Polygon &seed, const NetTracerShape
     db::split_polygon (seed, polygons);
 
     for (std::vector<db::Polygon>::const_iterator p = polygons.begin (); p != polygons.end (); ++p) {
-      determine_interactions (*p, shape, layers, delivery);
+      determine_interactions (*p, shape, layers, trees, delivery);
     }
 
   }
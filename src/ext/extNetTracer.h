@@ -32,9 +32,12 @@
 #include <list>
 
 #include "dbEdgeProcessor.h"
+#include "dbBoxTree.h"
 #include "layCellView.h"
 #include "tlProgress.h"
 #include "tlFixedVector.h"
+#include "tlObject.h"
+#include "gsiObject.h"
 
 namespace db
 {
@@ -534,6 +537,11 @@ public:
    */
   const std::set<unsigned int> &log_connections (unsigned int from_layer) const;
 
+  /**
+   *  @brief Returns all logical layers involved in connections
+   */
+  std::set<unsigned int> log_layers () const;
+
   /**
    *  @brief Returns the connected original layers split into the ones requiring booleans and the ones which don't
    *  The result pair will contain the ones which do not require booleans in the first element, and the ones which
@@ -556,6 +564,13 @@ public:
     return m_symbols;
   }
 
+  /**
+   *  @brief Returns all original layers which are involved in connections
+   *
+   *  These are the layers the net tracer will look up shapes on.
+   */
+  std::set<unsigned int> original_layers () const;
+
   /**
    *  @brief Returns true, if no connection is defined.
    */
@@ -578,6 +593,138 @@ private:
   void add_layers (unsigned int a, unsigned int b);
 };
 
+/**
+ *  @brief An entry of the net tracer index: a flattened shape and the hierarchy depth it was found at
+ */
+struct NetTracerIndexEntry
+{
+  NetTracerIndexEntry (const NetTracerShape &s, unsigned int d)
+    : shape (s), depth (d)
+  {
+    //  .. nothing yet ..
+  }
+
+  NetTracerShape shape;
+  unsigned int depth;
+};
+
+/**
+ *  @brief A box converter for the index entries
+ */
+struct NetTracerIndexEntryBoxConverter
+{
+  db::Box operator() (const NetTracerIndexEntry &e) const
+  {
+    return e.shape.bbox ();
+  }
+
+  typedef db::simple_bbox_tag complexity;
+};
+
+typedef db::unstable_box_tree<db::Box, NetTracerIndexEntry, NetTracerIndexEntryBoxConverter> NetTracerIndexTree;
+
+/**
+ *  @brief A list of index trees, i.e. the trees for a set of layers
+ */
+typedef std::vector<const NetTracerIndexTree *> NetTracerIndexTrees;
+
+/**
+ *  @brief The index trees of the layers connected to a seed layer
+ *
+ *  "connected" are the trees of all connected layers. "without_booleans" and "with_booleans"
+ *  split these into the ones which can be taken directly and the ones which are input to
+ *  boolean operations (see NetTracerData::requires_booleans).
+ */
+struct NetTracerSeedTrees
+{
+  NetTracerIndexTrees connected;
+  NetTracerIndexTrees without_booleans;
+  NetTracerIndexTrees with_booleans;
+};
+
+/**
+ *  @brief A connectivity index for the net tracer
+ *
+ *  The index holds the flattened shapes of a cell's layers in one box tree per layer.
+ *  Building the index is expensive, but once it is available, the net tracer can
+ *  look up the interacting shapes from the index instead of running hierarchical
+ *  shape queries. Hence the index pays off when many nets are traced on the same layout.
+ *
+ *  The index is built on a certain layout, cell and set of layers. It listens to the
+ *  layout's change events and becomes invalid when the layout is modified or cleared
+ *  (this includes the destruction of the layout). Copies of the index are empty.
+ */
+class EXT_PUBLIC NetTracerIndex
+  : public tl::Object
+{
+public:
+  /**
+   *  @brief Creates an empty index
+   */
+  NetTracerIndex ();
+
+  /**
+   *  @brief Copy constructor (creates an empty index)
+   */
+  NetTracerIndex (const NetTracerIndex &other);
+
+  /**
+   *  @brief Assignment (clears the index)
+   */
+  NetTracerIndex &operator= (const NetTracerIndex &other);
+
+  /**
+   *  @brief Builds the index for the given layers of the given cell
+   *
+   *  The layers are processed in parallel using the given number of threads. With
+   *  0 threads, the index is built synchronously.
+   */
+  void build (const db::Layout &layout, const db::Cell &cell, const std::set<unsigned int> &layers, int threads = 0);
+
+  /**
+   *  @brief Clears the index
+   */
+  void clear ();
+
+  /**
+   *  @brief Returns true, if the index is valid for the given layout, cell and layers
+   */
+  bool covers (const db::Layout &layout, const db::Cell &cell, const std::set<unsigned int> &layers) const;
+
+  /**
+   *  @brief Returns true, if the index is valid
+   */
+  bool is_valid () const
+  {
+    return mp_layout != 0;
+  }
+
+  /**
+   *  @brief Gets the tree for the given layer
+   *
+   *  The layer must be one of the layers the index was built for.
+   */
+  const NetTracerIndexTree &tree (unsigned int layer) const;
+
+  /**
+   *  @brief Gets the trees for the given layers
+   */
+  void trees (const std::set<unsigned int> &layers, NetTracerIndexTrees &trees) const;
+
+  /**
+   *  @brief Gets the total number of shapes in the index
+   */
+  size_t size () const;
+
+private:
+  const db::Layout *mp_layout;
+  db::cell_index_type m_cell_index;
+  std::map<unsigned int, NetTracerIndexTree> m_trees;
+
+  void layout_changed ();
+  void layout_status_changed (gsi::ObjectBase::StatusEventType type);
+};
+
 /**
  *  @brief The net tracer
  *
@@ -653,9 +800,61 @@ public:
 
   /**
    *  @brief Clear the data found so far.
+   *
+   *  This includes the net's name. The connectivity index is kept.
    */
   void clear ();
 
+  /**
+   *  @brief Enables or disables the connectivity index
+   *
+   *  If enabled, the net tracer builds a connectivity index (see NetTracerIndex) on the first
+   *  trace and reuses it for subsequent traces on the same layout and cell. This is the preferred
+   *  mode when many nets need to be traced. The index is rebuilt automatically if the layout
+   *  changes or other layers are required. The index is enabled by default.
+   */
+  void set_use_index (bool f);
+
+  /**
+   *  @brief Gets a value indicating whether the connectivity index is enabled
+   */
+  bool use_index () const
+  {
+    return m_use_index;
+  }
+
+  /**
+   *  @brief Sets the number of threads used for building the index
+   */
+  void set_index_threads (int n)
+  {
+    m_index_threads = n;
+  }
+
+  /**
+   *  @brief Gets the number of threads used for building the index
+   */
+  int index_threads () const
+  {
+    return m_index_threads;
+  }
+
+  /**
+   *  @brief Gets the connectivity index
+   */
+  const NetTracerIndex &index () const
+  {
+    return m_index;
+  }
+
+  /**
+   *  @brief Drops the connectivity index
+   */
+  void clear_index ()
+  {
+    m_index.clear ();
+  }
+
   /**
    *  @brief Get a name for the net
    *
@@ -698,11 +897,18 @@ private:
   NetTracerShape m_stop_shape; 
   NetTracerShape m_start_shape;
   db::EdgeProcessor m_ep;
+  bool m_use_index;
+  int m_index_threads;
+  NetTracerIndex m_index;
+  std::map <unsigned int, NetTracerSeedTrees> m_seed_trees;
+
+  void determine_interactions (const db::Box &seed, const NetTracerShape *shape, const std::set<unsigned int> &layers, const NetTracerIndexTrees *trees, std::set <std::pair<NetTracerShape, const NetTracerShape *> > &delivery);
+  void determine_interactions (const db::Polygon &seed, const NetTracerShape *shape, const std::set<unsigned int> &layers, const NetTracerIndexTrees *trees, std::set <std::pair<NetTracerShape, const NetTracerShape *> > &delivery);
+  void determine_interactions (const std::vector<const NetTracerShape *> &seeds, const db::Box &combined_box, const std::set<unsigned int> &layers, const NetTracerIndexTrees *trees, std::set <std::pair<NetTracerShape, const NetTracerShape *> > &delivery, bool do_seed_assignment = true);
+  void evaluate_text (const NetTracerShape &shape, unsigned int depth);
+  void resolve_seed_trees (const NetTracerData &data);
+  const NetTracerSeedTrees *seed_trees (unsigned int seed_layer) const;
 
-  void determine_interactions (const db::Box &seed, const NetTracerShape *shape, const std::set<unsigned int> &layers, std::set <std::pair<NetTracerShape, const NetTracerShape *> > &delivery);
-  void determine_interactions (const db::Polygon &seed, const NetTracerShape *shape, const std::set<unsigned int> &layers, std::set <std::pair<NetTracerShape, const NetTracerShape *> > &delivery);
-  void determine_interactions (const std::vector<const NetTracerShape *> &seeds, const db::Box &combined_box, const std::set<unsigned int> &layers, std::set <std::pair<NetTracerShape, const NetTracerShape *> > &delivery, bool do_seed_assignment = true);
-  void evaluate_text (const db::RecursiveShapeIterator &iter);
   const NetTracerShape *deliver_shape (const NetTracerShape &shape, const NetTracerShape *adjacent);
   void compute_results_for_next_iteration (const std::vector <const NetTracerShape *> &new_seeds, unsigned int seed_layer, const std::set<unsigned int> &output_layers, std::set <std::pair<NetTracerShape, const NetTracerShape *> > &current, std::set <std::pair<NetTracerShape, const NetTracerShape *> > &output, const NetTracerData &data);
 };
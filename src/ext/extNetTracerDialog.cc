@@ -383,7 +383,10 @@ NetTracerDialog::do_trace (const db::DBox &start_search_box, const db::DBox &sto
 
   }
 
-  NetTracer net_tracer;
+  //  the tracer is kept, so its connectivity index is reused by the next traces on the same layout
+  NetTracer &net_tracer = m_net_tracer;
+  net_tracer.clear ();
+  net_tracer.set_index_threads (view ()->drawing_workers ());
 
   //  and trace
   try {
@@ -104,6 +104,7 @@ private:
   std::string m_export_cell_name;
   lay::FileDialog *mp_export_file_dialog;
   std::string m_export_file_name;
+  NetTracer m_net_tracer;
 
   void update_highlights ();
   void adjust_view ();
@@ -24,6 +24,7 @@
 #include "extNetTracerIO.h"
 #include "extNetTracerDialog.h"
 #include "extNetTracerConfig.h"
+#include "extNetExtractor.h"
 
 #include "layConverters.h"
 
@@ -380,6 +381,38 @@ gsi::Class<ext::NetTracer> decl_NetTracer ("NetTracer",
     "@brief Returns a value indicating whether the net is incomplete\n"
     "A net may be incomplete if the extraction has been stopped by the user for example. "
     "This attribute is useful only after the extraction has been performed."
+  ) +
+  gsi::method ("use_index=", &ext::NetTracer::set_use_index, gsi::arg ("flag"),
+    "@brief Enables or disables the connectivity index\n"
+    "If the index is enabled, the net tracer flattens the shapes of the layers involved once on the first extraction "
+    "and reuses this index for subsequent extractions on the same layout and cell. This speeds up the extraction of many nets "
+    "considerably. The index is rebuilt automatically if the layout is modified. Disabling the index releases it. "
+    "The index is enabled by default. Disabling it is recommended when only a single net is traced on a huge layout.\n"
+    "\n"
+    "This attribute has been introduced in version 0.25."
+  ) +
+  gsi::method ("use_index?", &ext::NetTracer::use_index,
+    "@brief Returns a value indicating whether the connectivity index is enabled\n"
+    "See \\use_index= for details.\n"
+    "\n"
+    "This attribute has been introduced in version 0.25."
+  ) +
+  gsi::method ("index_threads=", &ext::NetTracer::set_index_threads, gsi::arg ("n"),
+    "@brief Sets the number of threads used for building the connectivity index\n"
+    "With 0 threads (the default), the index is built in the calling thread.\n"
+    "\n"
+    "This attribute has been introduced in version 0.25."
+  ) +
+  gsi::method ("index_threads", &ext::NetTracer::index_threads,
+    "@brief Gets the number of threads used for building the connectivity index\n"
+    "\n"
+    "This attribute has been introduced in version 0.25."
+  ) +
+  gsi::method ("clear_index", &ext::NetTracer::clear_index,
+    "@brief Releases the connectivity index\n"
+    "The index will be rebuilt on the next extraction if it is enabled.\n"
+    "\n"
+    "This method has been introduced in version 0.25."
   ),
   "@brief The net tracer feature\n"
   "\n"
@@ -412,5 +445,126 @@ gsi::Class<ext::NetTracer> decl_NetTracer ("NetTracer",
   "This class has been introduced in version 0.25."
 );
 
+static void extract1 (ext::NetExtractor *extractor, const ext::NetTracerTechnologyComponent &tech, const db::Layout &layout, const db::Cell &cell)
+{
+  ext::NetTracerData tracer_data = tech.get_tracer_data (layout);
+  extractor->extract (layout, cell, tracer_data);
+}
+
+static void extract1_tn (ext::NetExtractor *extractor, const std::string &tech, const db::Layout &layout, const db::Cell &cell)
+{
+  ext::NetTracerData tracer_data = get_tracer_data_from_tech (tech, layout);
+  extractor->extract (layout, cell, tracer_data);
+}
+
+static void extract1_cv (ext::NetExtractor *extractor, const lay::CellViewRef &cv)
+{
+  ext::NetTracerData tracer_data = get_tracer_data_from_cv (cv);
+  extractor->extract (cv->layout (), *cv.cell (), tracer_data);
+}
+
+gsi::Class<ext::ExtractedNet> decl_ExtractedNet ("ExtractedNet",
+  gsi::method ("name", &ext::ExtractedNet::name,
+    "@brief Gets the name of the net\n"
+    "The name is taken from the label closest to the top of the hierarchy. If the net does not have labels, the name is empty."
+  ) +
+  gsi::method ("labels", &ext::ExtractedNet::labels,
+    "@brief Gets the labels of the net\n"
+    "This is the sorted list of distinct texts attached to the net. A net with more than one label indicates a short."
+  ) +
+  gsi::method ("bbox", &ext::ExtractedNet::bbox,
+    "@brief Gets the bounding box of the net in the coordinate system of the top cell"
+  ) +
+  gsi::iterator ("each_element", &ext::ExtractedNet::begin, &ext::ExtractedNet::end,
+    "@brief Iterates over the elements of the net\n"
+    "The elements are delivered as \\NetElement objects. Elements of computed layers are cut at the tile boundaries."
+  ) +
+  gsi::method ("num_elements", &ext::ExtractedNet::size,
+    "@brief Returns the number of elements of the net"
+  ),
+  "@brief A net delivered by the \\NetExtractor full-chip net extraction\n"
+  "\n"
+  "This class has been introduced in version 0.25."
+);
+
+gsi::Class<ext::NetExtractor> decl_NetExtractor ("NetExtractor",
+  gsi::method_ext ("extract", &extract1, gsi::arg ("tech"), gsi::arg ("layout"), gsi::arg ("cell"),
+    "@brief Extracts all nets of the given cell\n"
+    "\n"
+    "@param tech The technology definition\n"
+    "@param layout The layout on which to run the extraction\n"
+    "@param cell The cell on which to run the extraction (child cells will be included)\n"
+  ) +
+  gsi::method_ext ("extract", &extract1_tn, gsi::arg ("tech"), gsi::arg ("layout"), gsi::arg ("cell"),
+    "@brief Extracts all nets of the given cell taking a predefined technology\n"
+    "This method behaves identical as the version with a technology object, except that it will look for a technology "
+    "with the given name to obtain the extraction setup."
+  ) +
+  gsi::method_ext ("extract", &extract1_cv, gsi::arg ("cellview"),
+    "@brief Extracts all nets from a cell view\n"
+    "This method behaves identical as the version with a technology, layout and cell object, except that it will take these "
+    "from the cellview specified."
+  ) +
+  gsi::method ("tile_size=", &ext::NetExtractor::set_tile_size, gsi::arg ("size"),
+    "@brief Sets the tile size in micrometer units\n"
+    "The extraction is performed in tiles of this size which are processed in parallel. 0 disables tiling. "
+    "The default tile size is 1000 micrometers."
+  ) +
+  gsi::method ("tile_size", &ext::NetExtractor::tile_size,
+    "@brief Gets the tile size in micrometer units\n"
+  ) +
+  gsi::method ("threads=", &ext::NetExtractor::set_threads, gsi::arg ("n"),
+    "@brief Sets the number of threads used for processing the tiles\n"
+    "With 0 threads (the default), the tiles are processed in the calling thread."
+  ) +
+  gsi::method ("threads", &ext::NetExtractor::threads,
+    "@brief Gets the number of threads used for processing the tiles\n"
+  ) +
+  gsi::iterator ("each_net", &ext::NetExtractor::begin, &ext::NetExtractor::end,
+    "@brief Iterates over the nets found during extraction\n"
+    "The nets are sorted by the lower-left corner of their bounding box."
+  ) +
+  gsi::method ("num_nets", &ext::NetExtractor::size,
+    "@brief Returns the number of nets found during extraction\n"
+  ) +
+  gsi::method ("net", &ext::NetExtractor::net, gsi::arg ("index"),
+    "@brief Gets the net with the given index\n"
+  ) +
+  gsi::method ("nets_with_label", &ext::NetExtractor::nets_with_label, gsi::arg ("label"),
+    "@brief Gets the indexes of the nets carrying the given label\n"
+    "More than one net for a label indicates an open."
+  ) +
+  gsi::method ("clear", &ext::NetExtractor::clear,
+    "@brief Clears the nets from the last extraction\n"
+  ),
+  "@brief The full-chip net extraction feature\n"
+  "\n"
+  "While the \\NetTracer follows one net from a seed point, the net extractor delivers all nets of a cell at once. "
+  "It uses the same technology definition as the net tracer. Shapes not participating in a connection are not considered. "
+  "The nets are delivered as \\ExtractedNet objects.\n"
+  "\n"
+  "Here is some sample code which reports shorts (nets with more than one label) and opens (labels on more than one net):\n"
+  "\n"
+  "@code\n"
+  "ly = RBA::CellView::active.layout\n"
+  "\n"
+  "tech = RBA::NetTracerTechnology::new\n"
+  "tech.connection(\"1/0\", \"2/0\", \"3/0\")\n"
+  "\n"
+  "extractor = RBA::NetExtractor::new\n"
+  "extractor.threads = 4\n"
+  "extractor.extract(tech, ly, ly.top_cell)\n"
+  "\n"
+  "extractor.each_net do |n|\n"
+  "  n.labels.size > 1 && puts(\"Short: \" + n.labels.join(\", \"))\n"
+  "  n.labels.each do |l|\n"
+  "    extractor.nets_with_label(l).size > 1 && puts(\"Open: \" + l)\n"
+  "  end\n"
+  "end\n"
+  "@/code\n"
+  "\n"
+  "This class has been introduced in version 0.25."
+);
+
 }
 
@@ -0,0 +1,1132 @@
+
+/*
+
+  KLayout Layout Viewer
+  Copyright (C) 2006-2017 Matthias Koefferlein
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+
+#include "extXOREngine.h"
+
+#include "dbBoxScanner.h"
+#include "dbClip.h"
+#include "dbContentHash.h"
+#include "dbRecursiveShapeIterator.h"
+#include "dbShapeProcessor.h"
+#include "rdb.h"
+#include "tlLog.h"
+#include "tlProgress.h"
+#include "tlThreadedWorkers.h"
+#include "tlTimer.h"
+
+#include <QMutex>
+#include <QObject>
+
+#include <limits>
+#include <algorithm>
+
+namespace ext
+{
+
+// --------------------------------------------------------------------------------
+//  Box merging
+
+/**
+ *  @brief A box scanner receiver which joins interacting boxes into clusters
+ */
+class BoxClusterReceiver
+  : public db::box_scanner_receiver<db::Box, size_t>
+{
+public:
+  BoxClusterReceiver (size_t n)
+    : m_parent (n), m_joined (false)
+  {
+    for (size_t i = 0; i < n; ++i) {
+      m_parent [i] = i;
+    }
+  }
+
+  void add (const db::Box *, size_t p1, const db::Box *, size_t p2)
+  {
+    size_t r1 = root (p1), r2 = root (p2);
+    if (r1 != r2) {
+      m_parent [std::max (r1, r2)] = std::min (r1, r2);
+      m_joined = true;
+    }
+  }
+
+  size_t root (size_t i)
+  {
+    while (m_parent [i] != i) {
+      m_parent [i] = m_parent [m_parent [i]];
+      i = m_parent [i];
+    }
+    return i;
+  }
+
+  bool joined () const
+  {
+    return m_joined;
+  }
+
+private:
+  std::vector<size_t> m_parent;
+  bool m_joined;
+};
+
+/**
+ *  @brief Joins overlapping or touching boxes until the boxes are disjoint
+ */
+static void
+merge_boxes (std::vector<db::Box> &boxes)
+{
+  std::vector<db::Box>::iterator w = boxes.begin ();
+  for (std::vector<db::Box>::const_iterator b = boxes.begin (); b != boxes.end (); ++b) {
+    if (! b->empty ()) {
+      *w++ = *b;
+    }
+  }
+  boxes.erase (w, boxes.end ());
+
+  //  joining boxes may make the joined boxes interact with others, hence we iterate
+  while (boxes.size () > 1) {
+
+    db::box_scanner<db::Box, size_t> scanner;
+    scanner.reserve (boxes.size ());
+    for (size_t i = 0; i < boxes.size (); ++i) {
+      scanner.insert (&boxes [i], i);
+    }
+
+    BoxClusterReceiver rec (boxes.size ());
+    scanner.process (rec, 1 /*touching*/, db::box_convert<db::Box> ());
+
+    if (! rec.joined ()) {
+      break;
+    }
+
+    std::vector<db::Box> merged;
+    std::vector<size_t> cluster_index (boxes.size (), std::numeric_limits<size_t>::max ());
+    for (size_t i = 0; i < boxes.size (); ++i) {
+      size_t r = rec.root (i);
+      if (cluster_index [r] == std::numeric_limits<size_t>::max ()) {
+        cluster_index [r] = merged.size ();
+        merged.push_back (boxes [i]);
+      } else {
+        merged [cluster_index [r]] += boxes [i];
+      }
+    }
+
+    boxes.swap (merged);
+
+  }
+}
+
+/**
+ *  @brief Converts a box into a different database unit
+ */
+static db::Box
+box_to_dbu (const db::Box &box, double from_dbu, double to_dbu)
+{
+  if (box.empty () || fabs (from_dbu - to_dbu) < 1e-10) {
+    return box;
+  } else {
+    //  enlarge by one unit to compensate rounding
+    return db::Box (db::DBox (box) * (from_dbu / to_dbu)).enlarged (db::Vector (1, 1));
+  }
+}
+
+// --------------------------------------------------------------------------------
+//  Cell pairs and content hashes
+
+/**
+ *  @brief Describes a pair of matching cells from layout A and B
+ */
+struct CellPair
+{
+  CellPair (db::cell_index_type _a, db::cell_index_type _b)
+    : a (_a), b (_b), insts_equal (false)
+  {
+    //  .. nothing yet ..
+  }
+
+  db::cell_index_type a, b;
+  //  true, if the instances are identical
+  bool insts_equal;
+  //  per layer: true, if the shapes of the cells are identical
+  std::vector<char> shapes_equal;
+  //  per layer: true, if the whole subtrees are identical
+  std::vector<char> subtree_equal;
+  //  per layer: the zones in which the subtrees differ (coordinate system of cell A)
+  std::vector<std::vector<db::Box> > zones;
+};
+
+typedef std::vector<std::pair<std::vector<unsigned int>, std::vector<unsigned int> > > layer_list;
+
+/**
+ *  @brief Computes the order-independent hash of the polygon-type shapes of a cell on the given layers
+ */
+static uint64_t
+hash_shapes (const db::Cell &cell, const std::vector<unsigned int> &layers)
+{
+  uint64_t h = 0;
+  for (std::vector<unsigned int>::const_iterator l = layers.begin (); l != layers.end (); ++l) {
+    for (db::ShapeIterator s = cell.shapes (*l).begin (db::ShapeIterator::Polygons | db::ShapeIterator::Paths | db::ShapeIterator::Boxes); ! s.at_end (); ++s) {
+      db::Polygon poly;
+      s->polygon (poly);
+      h += db::polygon_content_hash (poly);
+    }
+  }
+  return h;
+}
+
+/**
+ *  @brief Computes the order-independent hash of the instances of a cell
+ *
+ *  If a cell index map is given, the child cells are mapped through this map. If
+ *  a child cell is not found in the map, "unmatched" is set to true.
+ */
+static uint64_t
+hash_insts (const db::Cell &cell, const std::map<db::cell_index_type, db::cell_index_type> *cell_map, bool &unmatched)
+{
+  uint64_t h = 0;
+  unmatched = false;
+
+  for (db::Cell::const_iterator i = cell.begin (); ! i.at_end (); ++i) {
+
+    const db::CellInstArray &inst = i->cell_inst ();
+
+    db::cell_index_type ci = inst.object ().cell_index ();
+    if (cell_map) {
+      std::map<db::cell_index_type, db::cell_index_type>::const_iterator cm = cell_map->find (ci);
+      if (cm == cell_map->end ()) {
+        unmatched = true;
+        continue;
+      }
+      ci = cm->second;
+    }
+
+    db::ContentHash ih;
+    ih.add (uint64_t (ci));
+    ih.add (inst.complex_trans ());
+
+    db::Vector a, b;
+    unsigned long na = 1, nb = 1;
+    if (inst.is_regular_array (a, b, na, nb)) {
+      ih.add (a);
+      ih.add (b);
+      ih.add (uint64_t (na));
+      ih.add (uint64_t (nb));
+    } else if (inst.size () > 1) {
+      for (db::CellInstArray::iterator m = inst.begin (); ! m.at_end (); ++m) {
+        ih.add (inst.complex_trans (*m));
+      }
+    }
+
+    h += ih.value ();
+
+  }
+
+  return h;
+}
+
+//  The number of cell pairs hashed in one task
+const size_t pairs_per_task = 16;
+
+/**
+ *  @brief A job computing the content hashes of the cell pairs and comparing them
+ */
+class CellPairHashJob
+  : public tl::JobBase
+{
+public:
+  CellPairHashJob (int nworkers, const db::Layout &a, const db::Layout &b, const layer_list &layers, const std::map<db::cell_index_type, db::cell_index_type> &b2a, std::vector<CellPair> &pairs)
+    : tl::JobBase (nworkers), mp_a (&a), mp_b (&b), mp_layers (&layers), mp_b2a (&b2a), mp_pairs (&pairs), m_done (0)
+  {
+    //  .. nothing yet ..
+  }
+
+  void run (tl::RelativeProgress *progress)
+  {
+    m_done = 0;
+    for (size_t i = 0; i < mp_pairs->size (); i += pairs_per_task) {
+      schedule (new CellPairHashTask (i, std::min (mp_pairs->size (), i + pairs_per_task)));
+    }
+
+    try {
+
+      start ();
+      while (is_running ()) {
+        //  This may throw an exception, if the cancel button has been pressed.
+        if (progress) {
+          progress->set (done ());
+        }
+        wait (100);
+      }
+
+    } catch (tl::BreakException &ex) {
+      terminate ();
+      throw ex;
+    } catch (tl::Exception &ex) {
+      terminate ();
+      throw ex;
+    }
+
+    if (has_error ()) {
+      throw tl::Exception (tl::to_string (QObject::tr ("Errors occured during processing. First error message says:\n")) + error_messages ().front ());
+    }
+  }
+
+  void process (size_t from, size_t to)
+  {
+    for (size_t i = from; i < to; ++i) {
+
+      CellPair &p = (*mp_pairs) [i];
+      const db::Cell &cell_a = mp_a->cell (p.a);
+      const db::Cell &cell_b = mp_b->cell (p.b);
+
+      //  NOTE: the child cells of A are hashed by their own index, the ones of B are mapped to
+      //  the index of the corresponding cell in A. Children of A without a partner never
+      //  appear in the instances of B, so they make the hashes differ.
+      bool unmatched_a = false, unmatched_b = false;
+      uint64_t ih_a = hash_insts (cell_a, 0, unmatched_a);
+      uint64_t ih_b = hash_insts (cell_b, mp_b2a, unmatched_b);
+      p.insts_equal = (! unmatched_b && ih_a == ih_b);
+
+      p.shapes_equal.resize (mp_layers->size (), false);
+      for (size_t l = 0; l < mp_layers->size (); ++l) {
+        p.shapes_equal [l] = (hash_shapes (cell_a, (*mp_layers) [l].first) == hash_shapes (cell_b, (*mp_layers) [l].second));
+      }
+
+    }
+
+    QMutexLocker locker (&m_mutex);
+    m_done += to - from;
+  }
+
+  size_t done ()
+  {
+    QMutexLocker locker (&m_mutex);
+    return m_done;
+  }
+
+  virtual tl::Worker *create_worker ();
+
+private:
+  class CellPairHashTask
+    : public tl::Task
+  {
+  public:
+    CellPairHashTask (size_t from, size_t to)
+      : m_from (from), m_to (to)
+    {
+      //  .. nothing yet ..
+    }
+
+    size_t from () const
+    {
+      return m_from;
+    }
+
+    size_t to () const
+    {
+      return m_to;
+    }
+
+  private:
+    size_t m_from, m_to;
+  };
+
+  friend class CellPairHashWorker;
+
+  const db::Layout *mp_a, *mp_b;
+  const layer_list *mp_layers;
+  const std::map<db::cell_index_type, db::cell_index_type> *mp_b2a;
+  std::vector<CellPair> *mp_pairs;
+  size_t m_done;
+  QMutex m_mutex;
+};
+
+class CellPairHashWorker
+  : public tl::Worker
+{
+public:
+  CellPairHashWorker (CellPairHashJob *job)
+    : tl::Worker (), mp_job (job)
+  {
+    //  .. nothing yet ..
+  }
+
+  void perform_task (tl::Task *task)
+  {
+    CellPairHashJob::CellPairHashTask *hash_task = dynamic_cast<CellPairHashJob::CellPairHashTask *> (task);
+    if (hash_task) {
+      mp_job->process (hash_task->from (), hash_task->to ());
+    }
+  }
+
+private:
+  CellPairHashJob *mp_job;
+};
+
+tl::Worker *
+CellPairHashJob::create_worker ()
+{
+  return new CellPairHashWorker (this);
+}
+
+/**
+ *  @brief Gets the bounding box of an instance on the given layers
+ */
+static db::Box
+inst_bbox (const db::CellInstArray &inst, const db::Layout &layout, const std::vector<unsigned int> &layers)
+{
+  db::Box box;
+  for (std::vector<unsigned int>::const_iterator l = layers.begin (); l != layers.end (); ++l) {
+    box += inst.bbox (db::box_convert<db::CellInst> (layout, *l));
+  }
+  return box;
+}
+
+/**
+ *  @brief Adds the zones of a child cell, transformed into the parent by each member of the instance
+ */
+static void
+add_child_zones (std::vector<db::Box> &zones, const db::CellInstArray &inst, const std::vector<db::Box> &child_zones)
+{
+  for (db::CellInstArray::iterator m = inst.begin (); ! m.at_end (); ++m) {
+    db::ICplxTrans t = inst.complex_trans (*m);
+    bool needs_rounding = (! t.is_ortho () || t.is_mag ());
+    for (std::vector<db::Box>::const_iterator z = child_zones.begin (); z != child_zones.end (); ++z) {
+      db::Box zt = z->transformed (t);
+      if (needs_rounding) {
+        zt.enlarge (db::Vector (1, 1));
+      }
+      zones.push_back (zt);
+    }
+  }
+}
+
+/**
+ *  @brief Computes the zones of a cell pair on one layer
+ *
+ *  The zones of the child pairs must have been computed already.
+ */
+static void
+compute_pair_zones (CellPair &p, size_t layer, const db::Layout &a, const db::Layout &b, const layer_list &layers, const std::vector<CellPair> &pairs, const std::map<db::cell_index_type, size_t> &pair_for_a, const std::map<db::cell_index_type, db::cell_index_type> &b2a)
+{
+  std::vector<db::Box> &zones = p.zones [layer];
+  const std::vector<unsigned int> &la = layers [layer].first;
+  const std::vector<unsigned int> &lb = layers [layer].second;
+
+  const db::Cell &cell_a = a.cell (p.a);
+  const db::Cell &cell_b = b.cell (p.b);
+
+  //  shapes not present in both cells
+
+  if (! p.shapes_equal [layer]) {
+
+    std::vector<db::Polygon> pa, pb;
+    for (std::vector<unsigned int>::const_iterator l = la.begin (); l != la.end (); ++l) {
+      for (db::ShapeIterator s = cell_a.shapes (*l).begin (db::ShapeIterator::Polygons | db::ShapeIterator::Paths | db::ShapeIterator::Boxes); ! s.at_end (); ++s) {
+        pa.push_back (db::Polygon ());
+        s->polygon (pa.back ());
+      }
+    }
+    for (std::vector<unsigned int>::const_iterator l = lb.begin (); l != lb.end (); ++l) {
+      for (db::ShapeIterator s = cell_b.shapes (*l).begin (db::ShapeIterator::Polygons | db::ShapeIterator::Paths | db::ShapeIterator::Boxes); ! s.at_end (); ++s) {
+        pb.push_back (db::Polygon ());
+        s->polygon (pb.back ());
+      }
+    }
+
+    std::sort (pa.begin (), pa.end ());
+    std::sort (pb.begin (), pb.end ());
+
+    std::vector<db::Polygon>::const_iterator ia = pa.begin (), ib = pb.begin ();
+    while (ia != pa.end () || ib != pb.end ()) {
+      if (ib == pb.end () || (ia != pa.end () && *ia < *ib)) {
+        zones.push_back (ia->box ());
+        ++ia;
+      } else if (ia == pa.end () || *ib < *ia) {
+        zones.push_back (ib->box ());
+        ++ib;
+      } else {
+        ++ia;
+        ++ib;
+      }
+    }
+
+  }
+
+  //  instances: the ones not present in both cells and the ones of child pairs with differences
+
+  std::vector<db::CellInstArray> insts_a;
+  for (db::Cell::const_iterator i = cell_a.begin (); ! i.at_end (); ++i) {
+    insts_a.push_back (i->cell_inst ());
+  }
+
+  //  instances of B, with the child cells mapped to A (first) and the original one (second)
+  std::vector<std::pair<db::CellInstArray, db::CellInstArray> > insts_b;
+  for (db::Cell::const_iterator i = cell_b.begin (); ! i.at_end (); ++i) {
+    std::map<db::cell_index_type, db::cell_index_type>::const_iterator cm = b2a.find (i->cell_index ());
+    if (cm == b2a.end ()) {
+      zones.push_back (inst_bbox (i->cell_inst (), b, lb));
+    } else {
+      insts_b.push_back (std::make_pair (i->cell_inst (), i->cell_inst ()));
+      insts_b.back ().first.object () = db::CellInst (cm->second);
+    }
+  }
+
+  std::sort (insts_a.begin (), insts_a.end ());
+  std::sort (insts_b.begin (), insts_b.end ());
+
+  std::vector<db::CellInstArray>::const_iterator ia = insts_a.begin ();
+  std::vector<std::pair<db::CellInstArray, db::CellInstArray> >::const_iterator ib = insts_b.begin ();
+  while (ia != insts_a.end () || ib != insts_b.end ()) {
+
+    if (ib == insts_b.end () || (ia != insts_a.end () && *ia < ib->first)) {
+      zones.push_back (inst_bbox (*ia, a, la));
+      ++ia;
+    } else if (ia == insts_a.end () || ib->first < *ia) {
+      zones.push_back (inst_bbox (ib->second, b, lb));
+      ++ib;
+    } else {
+
+      std::map<db::cell_index_type, size_t>::const_iterator cp = pair_for_a.find (ia->object ().cell_index ());
+      tl_assert (cp != pair_for_a.end ());
+
+      const CellPair &child = pairs [cp->second];
+      if (! child.subtree_equal [layer]) {
+        add_child_zones (zones, *ia, child.zones [layer]);
+      }
+
+      ++ia;
+      ++ib;
+
+    }
+
+  }
+
+  merge_boxes (zones);
+}
+
+// --------------------------------------------------------------------------------
+//  The XOR job
+
+class XOREngineJob
+  : public tl::JobBase
+{
+public:
+  XOREngineJob (int nworkers, const db::Layout &a, const db::Cell &cell_a, const db::Layout &b, const db::Cell &cell_b, const layer_list &layers, double dbu, db::BooleanOp::BoolOp op, db::Coord tolerance, XORReceiver &receiver)
+    : tl::JobBase (nworkers),
+      mp_a (&a), mp_cell_a (&cell_a), mp_b (&b), mp_cell_b (&cell_b), mp_layers (&layers),
+      m_dbu (dbu), m_op (op), m_tolerance (tolerance), mp_receiver (&receiver), m_done (0)
+  {
+    //  .. nothing yet ..
+  }
+
+  void run (tl::RelativeProgress *progress)
+  {
+    m_done = 0;
+
+    try {
+
+      start ();
+      while (is_running ()) {
+        //  This may throw an exception, if the cancel button has been pressed.
+        if (progress) {
+          progress->set (done ());
+        }
+        wait (100);
+      }
+
+    } catch (tl::BreakException &ex) {
+      terminate ();
+      throw ex;
+    } catch (tl::Exception &ex) {
+      terminate ();
+      throw ex;
+    }
+
+    if (has_error ()) {
+      throw tl::Exception (tl::to_string (QObject::tr ("Errors occured during processing. First error message says:\n")) + error_messages ().front ());
+    }
+  }
+
+  void process (unsigned int layer, const db::Box &clip_box);
+
+  size_t done ()
+  {
+    QMutexLocker locker (&m_mutex);
+    return m_done;
+  }
+
+  virtual tl::Worker *create_worker ();
+
+  class XOREngineTask
+    : public tl::Task
+  {
+  public:
+    XOREngineTask (unsigned int layer, const db::Box &clip_box)
+      : m_layer (layer), m_clip_box (clip_box)
+    {
+      //  .. nothing yet ..
+    }
+
+    unsigned int layer () const
+    {
+      return m_layer;
+    }
+
+    const db::Box &clip_box () const
+    {
+      return m_clip_box;
+    }
+
+  private:
+    unsigned int m_layer;
+    db::Box m_clip_box;
+  };
+
+private:
+  const db::Layout *mp_a;
+  const db::Cell *mp_cell_a;
+  const db::Layout *mp_b;
+  const db::Cell *mp_cell_b;
+  const layer_list *mp_layers;
+  double m_dbu;
+  db::BooleanOp::BoolOp m_op;
+  db::Coord m_tolerance;
+  XORReceiver *mp_receiver;
+  size_t m_done;
+  QMutex m_mutex;
+
+  void merge_input (db::ShapeProcessor &sp, const db::Layout &layout, const db::Cell &cell, const std::vector<unsigned int> &layers, const db::Box &region, db::Shapes &out);
+};
+
+void
+XOREngineJob::merge_input (db::ShapeProcessor &sp, const db::Layout &layout, const db::Cell &cell, const std::vector<unsigned int> &layers, const db::Box &region, db::Shapes &out)
+{
+  if (layers.empty ()) {
+    return;
+  }
+
+  sp.clear ();
+
+  db::CplxTrans dbu_scale (layout.dbu () / m_dbu);
+  size_t n = 0;
+  db::RecursiveShapeIterator s (layout, cell, layers, box_to_dbu (region, m_dbu, layout.dbu ()));
+  s.shape_flags (db::ShapeIterator::Polygons | db::ShapeIterator::Paths | db::ShapeIterator::Boxes);
+  for ( ; ! s.at_end (); ++s, ++n) {
+    sp.insert (s.shape (), dbu_scale * s.trans (), n);
+  }
+
+  db::MergeOp op (0);
+  db::ShapeGenerator sg (out, true /*clear shapes*/);
+  db::PolygonGenerator pg (sg, false /*don't resolve holes*/, false /*no min. coherence*/);
+  sp.process (pg, op);
+}
+
+void
+XOREngineJob::process (unsigned int layer, const db::Box &clip_box)
+{
+  db::ShapeProcessor sp;
+
+  db::Layout helper;
+  helper.dbu (m_dbu);
+  db::Cell &helper_cell = helper.cell (helper.add_cell ());
+  helper.insert_layer (0);
+  helper.insert_layer (1);
+  helper.insert_layer (2);
+
+  //  enlarge the input region by half the tolerance, so the sizing sees the shapes around the clip box
+  db::Coord enlargement = m_tolerance > 0 ? (m_tolerance + 1) / 2 : 0;
+  db::Box region = clip_box.enlarged (db::Vector (enlargement, enlargement));
+
+  merge_input (sp, *mp_a, *mp_cell_a, (*mp_layers) [layer].first, region, helper_cell.shapes (0));
+  merge_input (sp, *mp_b, *mp_cell_b, (*mp_layers) [layer].second, region, helper_cell.shapes (1));
+
+  sp.boolean (helper, helper_cell, 0, helper, helper_cell, 1, helper_cell.shapes (2), m_op, true, false, true);
+
+  if (m_tolerance > 0) {
+    sp.size (helper, helper_cell, 2, helper_cell.shapes (2), -((m_tolerance + 1) / 2), (unsigned int) 2, false);
+    sp.size (helper, helper_cell, 2, helper_cell.shapes (2), ((m_tolerance + 1) / 2), (unsigned int) 2, false);
+  }
+
+  std::vector<db::Polygon> clipped;
+  for (db::ShapeIterator s = helper_cell.shapes (2).begin (db::ShapeIterator::All); ! s.at_end (); ++s) {
+    db::Polygon poly;
+    s->polygon (poly);
+    clip_poly (poly, clip_box, clipped, false /*don't resolve holes*/);
+  }
+
+  QMutexLocker locker (&m_mutex);
+
+  for (std::vector<db::Polygon>::const_iterator p = clipped.begin (); p != clipped.end (); ++p) {
+    mp_receiver->add_polygon (layer, *p);
+  }
+
+  ++m_done;
+}
+
+class XOREngineWorker
+  : public tl::Worker
+{
+public:
+  XOREngineWorker (XOREngineJob *job)
+    : tl::Worker (), mp_job (job)
+  {
+    //  .. nothing yet ..
+  }
+
+  void perform_task (tl::Task *task)
+  {
+    XOREngineJob::XOREngineTask *xor_task = dynamic_cast<XOREngineJob::XOREngineTask *> (task);
+    if (xor_task) {
+      mp_job->process (xor_task->layer (), xor_task->clip_box ());
+    }
+  }
+
+private:
+  XOREngineJob *mp_job;
+};
+
+tl::Worker *
+XOREngineJob::create_worker ()
+{
+  return new XOREngineWorker (this);
+}
+
+// --------------------------------------------------------------------------------
+//  Receivers for layout and report database output
+
+/**
+ *  @brief A receiver collecting the polygons per layer
+ */
+class CollectingXORReceiver
+  : public XORReceiver
+{
+public:
+  CollectingXORReceiver (unsigned int layers)
+    : m_polygons (layers)
+  {
+    //  .. nothing yet ..
+  }
+
+  void add_polygon (unsigned int layer_index, const db::Polygon &polygon)
+  {
+    m_polygons [layer_index].push_back (polygon);
+  }
+
+  const std::vector<db::Polygon> &polygons (unsigned int layer_index) const
+  {
+    return m_polygons [layer_index];
+  }
+
+private:
+  std::vector<std::vector<db::Polygon> > m_polygons;
+};
+
+/**
+ *  @brief A receiver producing report database items
+ */
+class RdbXORReceiver
+  : public XORReceiver
+{
+public:
+  RdbXORReceiver (rdb::Database &rdb, rdb::Cell *cell, const std::vector<rdb::Category *> &categories, double dbu)
+    : mp_rdb (&rdb), mp_cell (cell), m_categories (categories), m_dbu (dbu)
+  {
+    //  .. nothing yet ..
+  }
+
+  void add_polygon (unsigned int layer_index, const db::Polygon &polygon)
+  {
+    rdb::Item *item = mp_rdb->create_item (mp_cell->id (), m_categories [layer_index]->id ());
+    item->values ().add (new rdb::Value <db::DPolygon> (polygon.transformed (db::CplxTrans (m_dbu))));
+  }
+
+private:
+  rdb::Database *mp_rdb;
+  rdb::Cell *mp_cell;
+  std::vector<rdb::Category *> m_categories;
+  double m_dbu;
+};
+
+// --------------------------------------------------------------------------------
+//  XOREngine implementation
+
+//  More zones than this per layer are replaced by their bounding box (processed in tiles)
+const size_t max_zones_per_layer = 100000;
+
+XOREngine::XOREngine ()
+  : m_op (db::BooleanOp::Xor), m_tolerance (0.0), m_tile_size (0.0), m_threads (0), m_hierarchical (true), m_dbu (0.001)
+{
+  //  .. nothing yet ..
+}
+
+void
+XOREngine::add_layer (const db::LayerProperties &lp)
+{
+  m_layers.push_back (LayerSpec ());
+  m_layers.back ().lp = lp;
+  m_layers.back ().explicit_layers = false;
+}
+
+void
+XOREngine::add_layer (const db::LayerProperties &lp, const std::vector<unsigned int> &la, const std::vector<unsigned int> &lb)
+{
+  m_layers.push_back (LayerSpec ());
+  m_layers.back ().lp = lp;
+  m_layers.back ().explicit_layers = true;
+  m_layers.back ().la = la;
+  m_layers.back ().lb = lb;
+}
+
+void
+XOREngine::clear_layers ()
+{
+  m_layers.clear ();
+  m_zones.clear ();
+}
+
+const std::vector<db::Box> &
+XOREngine::zones (unsigned int layer_index) const
+{
+  tl_assert (layer_index < m_zones.size ());
+  return m_zones [layer_index];
+}
+
+void
+XOREngine::resolve_layers (const db::Layout &a, const db::Layout &b)
+{
+  if (m_layers.empty ()) {
+
+    std::map<db::LayerProperties, std::pair<std::vector<unsigned int>, std::vector<unsigned int> >, db::LPLogicalLessFunc> layers;
+
+    for (db::Layout::layer_iterator la = a.begin_layers (); la != a.end_layers (); ++la) {
+      layers [*(*la).second].first.push_back ((*la).first);
+    }
+    for (db::Layout::layer_iterator lb = b.begin_layers (); lb != b.end_layers (); ++lb) {
+      layers [*(*lb).second].second.push_back ((*lb).first);
+    }
+
+    for (std::map<db::LayerProperties, std::pair<std::vector<unsigned int>, std::vector<unsigned int> >, db::LPLogicalLessFunc>::const_iterator l = layers.begin (); l != layers.end (); ++l) {
+      add_layer (l->first, l->second.first, l->second.second);
+    }
+
+  } else {
+
+    for (std::vector<LayerSpec>::iterator l = m_layers.begin (); l != m_layers.end (); ++l) {
+      if (! l->explicit_layers) {
+        l->la.clear ();
+        for (db::Layout::layer_iterator la = a.begin_layers (); la != a.end_layers (); ++la) {
+          if ((*la).second->log_equal (l->lp)) {
+            l->la.push_back ((*la).first);
+          }
+        }
+        l->lb.clear ();
+        for (db::Layout::layer_iterator lb = b.begin_layers (); lb != b.end_layers (); ++lb) {
+          if ((*lb).second->log_equal (l->lp)) {
+            l->lb.push_back ((*lb).first);
+          }
+        }
+      }
+    }
+
+  }
+}
+
+void
+XOREngine::compute_zones (const db::Layout &a, db::cell_index_type top_a, const db::Layout &b, db::cell_index_type top_b)
+{
+  tl::SelfTimer timer (tl::verbosity () >= 11, "XOR engine: computing zones");
+
+  //  NOTE: basically we should take the common denominator rather than the minimum of the layout's DBU's.
+  //  But this could be a very small number resulting in coordinate overflow issues.
+  m_dbu = std::min (a.dbu (), b.dbu ());
+
+  resolve_layers (a, b);
+
+  a.update ();
+  b.update ();
+
+  m_zones.clear ();
+  m_zones.resize (m_layers.size ());
+
+  if (m_hierarchical && fabs (a.dbu () - b.dbu ()) < 1e-10) {
+    compute_hierarchical_zones (a, top_a, b, top_b);
+  } else {
+    compute_flat_zones (a, top_a, b, top_b);
+  }
+
+  for (std::vector<std::vector<db::Box> >::iterator z = m_zones.begin (); z != m_zones.end (); ++z) {
+    if (z->size () > max_zones_per_layer) {
+      db::Box bbox;
+      for (std::vector<db::Box>::const_iterator b = z->begin (); b != z->end (); ++b) {
+        bbox += *b;
+      }
+      z->clear ();
+      z->push_back (bbox);
+    } else {
+      //  gives a deterministic processing order
+      std::sort (z->begin (), z->end ());
+    }
+  }
+
+  if (tl::verbosity () >= 20) {
+    for (size_t l = 0; l < m_layers.size (); ++l) {
+      tl::info << "XOR engine: " << m_zones [l].size () << " zone(s) on layer " << m_layers [l].lp.to_string ();
+    }
+  }
+}
+
+void
+XOREngine::compute_flat_zones (const db::Layout &a, db::cell_index_type top_a, const db::Layout &b, db::cell_index_type top_b)
+{
+  for (size_t l = 0; l < m_layers.size (); ++l) {
+
+    db::Box box;
+    for (std::vector<unsigned int>::const_iterator i = m_layers [l].la.begin (); i != m_layers [l].la.end (); ++i) {
+      box += box_to_dbu (a.cell (top_a).bbox (*i), a.dbu (), m_dbu);
+    }
+    for (std::vector<unsigned int>::const_iterator i = m_layers [l].lb.begin (); i != m_layers [l].lb.end (); ++i) {
+      box += box_to_dbu (b.cell (top_b).bbox (*i), b.dbu (), m_dbu);
+    }
+
+    if (! box.empty ()) {
+      m_zones [l].push_back (box);
+    }
+
+  }
+}
+
+void
+XOREngine::compute_hierarchical_zones (const db::Layout &a, db::cell_index_type top_a, const db::Layout &b, db::cell_index_type top_b)
+{
+  layer_list layers;
+  for (std::vector<LayerSpec>::const_iterator l = m_layers.begin (); l != m_layers.end (); ++l) {
+    layers.push_back (std::make_pair (l->la, l->lb));
+  }
+
+  //  match the cells by name - the top cells always match
+
+  std::set<db::cell_index_type> called_a, called_b;
+  a.cell (top_a).collect_called_cells (called_a);
+  b.cell (top_b).collect_called_cells (called_b);
+
+  std::map<std::string, db::cell_index_type> cells_b;
+  for (std::set<db::cell_index_type>::const_iterator c = called_b.begin (); c != called_b.end (); ++c) {
+    if (*c != top_b) {
+      cells_b.insert (std::make_pair (std::string (b.cell_name (*c)), *c));
+    }
+  }
+
+  std::vector<CellPair> pairs;
+  std::map<db::cell_index_type, size_t> pair_for_a;
+  std::map<db::cell_index_type, db::cell_index_type> b2a;
+
+  pairs.push_back (CellPair (top_a, top_b));
+  pair_for_a.insert (std::make_pair (top_a, size_t (0)));
+  b2a.insert (std::make_pair (top_b, top_a));
+
+  for (std::set<db::cell_index_type>::const_iterator c = called_a.begin (); c != called_a.end (); ++c) {
+    if (*c != top_a) {
+      std::map<std::string, db::cell_index_type>::const_iterator cb = cells_b.find (std::string (a.cell_name (*c)));
+      if (cb != cells_b.end ()) {
+        pair_for_a.insert (std::make_pair (*c, pairs.size ()));
+        b2a.insert (std::make_pair (cb->second, *c));
+        pairs.push_back (CellPair (*c, cb->second));
+      }
+    }
+  }
+
+  //  compute the content hashes
+
+  {
+    tl::RelativeProgress progress (tl::to_string (QObject::tr ("Hashing cells")), pairs.size (), 1);
+    CellPairHashJob job (m_threads, a, b, layers, b2a, pairs);
+    job.run (&progress);
+  }
+
+  //  determine the identical subtrees and the zones bottom-up
+
+  for (db::Layout::bottom_up_const_iterator c = a.begin_bottom_up (); c != a.end_bottom_up (); ++c) {
+
+    std::map<db::cell_index_type, size_t>::const_iterator pi = pair_for_a.find (*c);
+    if (pi == pair_for_a.end ()) {
+      continue;
+    }
+
+    CellPair &p = pairs [pi->second];
+    const db::Cell &cell_a = a.cell (p.a);
+
+    p.subtree_equal.resize (layers.size (), false);
+    p.zones.resize (layers.size ());
+
+    for (size_t l = 0; l < layers.size (); ++l) {
+
+      bool eq = p.insts_equal && p.shapes_equal [l];
+      for (db::Cell::child_cell_iterator cc = cell_a.begin_child_cells (); eq && ! cc.at_end (); ++cc) {
+        std::map<db::cell_index_type, size_t>::const_iterator cp = pair_for_a.find (*cc);
+        eq = (cp != pair_for_a.end () && pairs [cp->second].subtree_equal [l]);
+      }
+
+      p.subtree_equal [l] = eq;
+      if (! eq) {
+        compute_pair_zones (p, l, a, b, layers, pairs, pair_for_a, b2a);
+      }
+
+    }
+
+  }
+
+  m_zones.clear ();
+  m_zones.resize (layers.size ());
+  for (size_t l = 0; l < layers.size (); ++l) {
+    if (! pairs.front ().subtree_equal [l]) {
+      m_zones [l].swap (pairs.front ().zones [l]);
+    }
+  }
+}
+
+void
+XOREngine::run (const db::Layout &a, db::cell_index_type top_a, const db::Layout &b, db::cell_index_type top_b, XORReceiver &receiver)
+{
+  compute_zones (a, top_a, b, top_b);
+
+  tl::SelfTimer timer (tl::verbosity () >= 11, "XOR engine: processing zones");
+
+  layer_list layers;
+  for (std::vector<LayerSpec>::const_iterator l = m_layers.begin (); l != m_layers.end (); ++l) {
+    layers.push_back (std::make_pair (l->la, l->lb));
+  }
+
+  db::Coord tolerance = db::coord_traits<db::Coord>::rounded (m_tolerance / m_dbu);
+
+  XOREngineJob job (m_threads, a, a.cell (top_a), b, b.cell (top_b), layers, m_dbu, m_op, tolerance, receiver);
+
+  size_t todo_count = 0;
+
+  for (unsigned int l = 0; l < (unsigned int) m_zones.size (); ++l) {
+
+    for (std::vector<db::Box>::const_iterator z = m_zones [l].begin (); z != m_zones [l].end (); ++z) {
+
+      size_t ntiles_w = 1, ntiles_h = 1;
+      if (m_tile_size > 0.0) {
+        ntiles_w = std::max (size_t (1), size_t (floor (z->width () * m_dbu / m_tile_size + 0.5)));
+        ntiles_h = std::max (size_t (1), size_t (floor (z->height () * m_dbu / m_tile_size + 0.5)));
+      }
+
+      db::Coord tile_width = z->width () / ntiles_w;
+      db::Coord tile_height = z->height () / ntiles_h;
+
+      for (size_t nw = 0; nw < ntiles_w; ++nw) {
+        for (size_t nh = 0; nh < ntiles_h; ++nh) {
+
+          db::Box clip_box (z->left () + nw * tile_width,
+                            z->bottom () + nh * tile_height,
+                            (nw == ntiles_w - 1) ? z->right () : z->left () + (nw + 1) * tile_width,
+                            (nh == ntiles_h - 1) ? z->top () : z->bottom () + (nh + 1) * tile_height);
+
+          job.schedule (new XOREngineJob::XOREngineTask (l, clip_box));
+          ++todo_count;
+
+        }
+      }
+
+    }
+
+  }
+
+  if (todo_count > 0) {
+    tl::RelativeProgress progress (tl::to_string (QObject::tr ("Computing XOR")), todo_count, 1);
+    job.run (&progress);
+  }
+}
+
+void
+XOREngine::run (const db::Layout &a, db::cell_index_type top_a, const db::Layout &b, db::cell_index_type top_b, db::Layout &out, db::cell_index_type out_cell)
+{
+  //  NOTE: the results are collected first, because the output layout may be one of the inputs
+  resolve_layers (a, b);
+  CollectingXORReceiver receiver ((unsigned int) m_layers.size ());
+  run (a, top_a, b, top_b, receiver);
+
+  db::ICplxTrans scale (m_dbu / out.dbu ());
+
+  for (unsigned int l = 0; l < (unsigned int) m_layers.size (); ++l) {
+
+    const std::vector<db::Polygon> &polygons = receiver.polygons (l);
+    if (polygons.empty ()) {
+      continue;
+    }
+
+    int out_layer = -1;
+    for (db::Layout::layer_iterator lo = out.begin_layers (); lo != out.end_layers () && out_layer < 0; ++lo) {
+      if ((*lo).second->log_equal (m_layers [l].lp)) {
+        out_layer = int ((*lo).first);
+      }
+    }
+    if (out_layer < 0) {
+      out_layer = int (out.insert_layer (m_layers [l].lp));
+    }
+
+    db::Shapes &shapes = out.cell (out_cell).shapes ((unsigned int) out_layer);
+    for (std::vector<db::Polygon>::const_iterator p = polygons.begin (); p != polygons.end (); ++p) {
+      shapes.insert (p->transformed (scale));
+    }
+
+  }
+}
+
+void
+XOREngine::run (const db::Layout &a, db::cell_index_type top_a, const db::Layout &b, db::cell_index_type top_b, rdb::Database &rdb)
+{
+  resolve_layers (a, b);
+
+  std::string op_name;
+  if (m_op == db::BooleanOp::ANotB) {
+    op_name = "ANOTB";
+  } else if (m_op == db::BooleanOp::BNotA) {
+    op_name = "BNOTA";
+  } else {
+    op_name = "XOR";
+  }
+
+  std::string top_cell_name = a.cell_name (top_a);
+  if (rdb.top_cell_name ().empty ()) {
+    rdb.set_top_cell_name (top_cell_name);
+  }
+  rdb::Cell *rdb_cell = rdb.create_cell (top_cell_name);
+
+  rdb::Category *cat = rdb.create_category (op_name);
+
+  std::vector<rdb::Category *> layer_categories;
+  for (std::vector<LayerSpec>::const_iterator l = m_layers.begin (); l != m_layers.end (); ++l) {
+    rdb::Category *layercat = rdb.create_category (cat, l->lp.to_string ());
+    layercat->set_description ("Results for layer " + l->lp.to_string ());
+    layer_categories.push_back (layercat);
+  }
+
+  RdbXORReceiver receiver (rdb, rdb_cell, layer_categories, std::min (a.dbu (), b.dbu ()));
+  run (a, top_a, b, top_b, receiver);
+}
+
+}
+
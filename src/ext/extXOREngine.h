@@ -0,0 +1,288 @@
+
+/*
+
+  KLayout Layout Viewer
+  Copyright (C) 2006-2017 Matthias Koefferlein
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+
+
+#ifndef HDR_extXOREngine
+#define HDR_extXOREngine
+
+#include "extCommon.h"
+
+#include <vector>
+
+#include "dbEdgeProcessor.h"
+#include "dbLayerProperties.h"
+#include "dbLayout.h"
+
+namespace rdb
+{
+  class Database;
+}
+
+namespace ext
+{
+
+/**
+ *  @brief The receiver for the results of the XOR engine
+ */
+class EXT_PUBLIC XORReceiver
+{
+public:
+  XORReceiver () { }
+  virtual ~XORReceiver () { }
+
+  /**
+   *  @brief Delivers a result polygon
+   *
+   *  "layer_index" is the index of the layer in the engine's layer list. The polygon is given
+   *  in units of the engine's database unit and in the coordinate system of the top cells.
+   *  This method is called from the worker threads, but the calls are serialized.
+   */
+  virtual void add_polygon (unsigned int layer_index, const db::Polygon &polygon) = 0;
+};
+
+/**
+ *  @brief A hierarchical XOR engine
+ *
+ *  The engine computes the XOR (or A NOT B, B NOT A) between two cells of two layouts.
+ *  Instead of processing the whole area flat, it first identifies the zones in which
+ *  the layouts can differ at all:
+ *
+ *  The cells of both layouts are matched by name (the top cells are always matched).
+ *  For each pair of cells, content hashes of the shapes on each layer and of the
+ *  instances are computed in parallel. From these, the pairs whose subtrees are identical
+ *  are determined bottom-up. These do not contribute to the XOR. For the other pairs,
+ *  the zones are formed from the shapes which are not present in both cells, the instances
+ *  which are not present in both cells and the zones of the child cells, transformed into
+ *  the parent. The zones of the top cells are merged into disjoint boxes.
+ *
+ *  Outside the zones, both layouts are identical. The XOR is computed flat inside the
+ *  zones only. Zones larger than the tile size are split into tiles. The zones
+ *  can only be derived hierarchically if both layouts use the same database unit.
+ *  Otherwise or in non-hierarchical mode, the bounding box of both top cells is
+ *  used as the zone.
+ */
+class EXT_PUBLIC XOREngine
+{
+public:
+  /**
+   *  @brief Constructor
+   */
+  XOREngine ();
+
+  /**
+   *  @brief Sets the operation (Xor, ANotB or BNotA)
+   */
+  void set_op (db::BooleanOp::BoolOp op)
+  {
+    m_op = op;
+  }
+
+  /**
+   *  @brief Gets the operation
+   */
+  db::BooleanOp::BoolOp op () const
+  {
+    return m_op;
+  }
+
+  /**
+   *  @brief Sets the tolerance in micrometer units
+   *
+   *  Differences narrower than the tolerance are not reported.
+   */
+  void set_tolerance (double t)
+  {
+    m_tolerance = t;
+  }
+
+  /**
+   *  @brief Gets the tolerance
+   */
+  double tolerance () const
+  {
+    return m_tolerance;
+  }
+
+  /**
+   *  @brief Sets the tile size in micrometer units
+   *
+   *  Zones larger than the tile size are processed in tiles. 0 disables tiling.
+   */
+  void set_tile_size (double ts)
+  {
+    m_tile_size = ts;
+  }
+
+  /**
+   *  @brief Gets the tile size
+   */
+  double tile_size () const
+  {
+    return m_tile_size;
+  }
+
+  /**
+   *  @brief Sets the number of threads to use (0 for synchronous operation)
+   */
+  void set_threads (int n)
+  {
+    m_threads = n;
+  }
+
+  /**
+   *  @brief Gets the number of threads
+   */
+  int threads () const
+  {
+    return m_threads;
+  }
+
+  /**
+   *  @brief Enables or disables the hierarchical mode
+   *
+   *  In non-hierarchical mode, the whole area is processed in tiles.
+   *  The hierarchical mode is enabled by default.
+   */
+  void set_hierarchical (bool h)
+  {
+    m_hierarchical = h;
+  }
+
+  /**
+   *  @brief Gets a value indicating whether the hierarchical mode is enabled
+   */
+  bool hierarchical () const
+  {
+    return m_hierarchical;
+  }
+
+  /**
+   *  @brief Adds a layer
+   *
+   *  The layers of both layouts matching the given layer properties are compared.
+   *  If no layers are added, all layers of both layouts are compared.
+   */
+  void add_layer (const db::LayerProperties &lp);
+
+  /**
+   *  @brief Adds a layer with explicit layer indexes
+   *
+   *  "la" and "lb" are the layers of layout A and B. Each list may be empty or contain
+   *  several layers which are combined.
+   */
+  void add_layer (const db::LayerProperties &lp, const std::vector<unsigned int> &la, const std::vector<unsigned int> &lb);
+
+  /**
+   *  @brief Clears the layers
+   */
+  void clear_layers ();
+
+  /**
+   *  @brief Gets the number of layers
+   */
+  unsigned int layers () const
+  {
+    return (unsigned int) m_layers.size ();
+  }
+
+  /**
+   *  @brief Gets the properties of the layer with the given index
+   */
+  const db::LayerProperties &layer (unsigned int index) const
+  {
+    return m_layers [index].lp;
+  }
+
+  /**
+   *  @brief Computes the zones in which the layouts differ
+   *
+   *  After this method has been called, the zones are available through "zones" and the
+   *  database unit of the zones through "dbu". If no layers have been added, this method
+   *  will add all layers of both layouts.
+   */
+  void compute_zones (const db::Layout &a, db::cell_index_type top_a, const db::Layout &b, db::cell_index_type top_b);
+
+  /**
+   *  @brief Gets the zones for the layer with the given index
+   *
+   *  The zones are given in units of the database unit reported by "dbu" and in the
+   *  coordinate system of the top cells. The zones are disjoint.
+   */
+  const std::vector<db::Box> &zones (unsigned int layer_index) const;
+
+  /**
+   *  @brief Gets the database unit the results are computed in
+   *
+   *  This is the smaller database unit of both layouts.
+   */
+  double dbu () const
+  {
+    return m_dbu;
+  }
+
+  /**
+   *  @brief Computes the zones and runs the operation in the zones, delivering the results to the given receiver
+   */
+  void run (const db::Layout &a, db::cell_index_type top_a, const db::Layout &b, db::cell_index_type top_b, XORReceiver &receiver);
+
+  /**
+   *  @brief Runs the operation and delivers the results to the given cell of a layout
+   *
+   *  The results are put on layers with the same properties as the input layers. Layers
+   *  are created if required.
+   */
+  void run (const db::Layout &a, db::cell_index_type top_a, const db::Layout &b, db::cell_index_type top_b, db::Layout &out, db::cell_index_type out_cell);
+
+  /**
+   *  @brief Runs the operation and delivers the results to a report database
+   *
+   *  One category is created per layer, together with a cell named after top cell A.
+   */
+  void run (const db::Layout &a, db::cell_index_type top_a, const db::Layout &b, db::cell_index_type top_b, rdb::Database &rdb);
+
+private:
+  struct LayerSpec
+  {
+    db::LayerProperties lp;
+    bool explicit_layers;
+    std::vector<unsigned int> la, lb;
+  };
+
+  db::BooleanOp::BoolOp m_op;
+  double m_tolerance;
+  double m_tile_size;
+  int m_threads;
+  bool m_hierarchical;
+  std::vector<LayerSpec> m_layers;
+  std::vector<std::vector<db::Box> > m_zones;
+  double m_dbu;
+
+  void resolve_layers (const db::Layout &a, const db::Layout &b);
+  void compute_flat_zones (const db::Layout &a, db::cell_index_type top_a, const db::Layout &b, db::cell_index_type top_b);
+  void compute_hierarchical_zones (const db::Layout &a, db::cell_index_type top_a, const db::Layout &b, db::cell_index_type top_b);
+};
+
+}
+
+#endif
+
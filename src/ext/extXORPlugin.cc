@@ -23,8 +23,12 @@
 
 
 #include "extXORToolDialog.h"
+#include "extXOREngine.h"
 
 #include "layPlugin.h"
+#include "rdb.h"
+
+#include "gsiDecl.h"
 
 namespace ext
 {
@@ -84,6 +88,7 @@ public:
     options.push_back (std::pair<std::string, std::string> (cfg_xor_summarize, "false"));
     options.push_back (std::pair<std::string, std::string> (cfg_xor_tolerances, ""));
     options.push_back (std::pair<std::string, std::string> (cfg_xor_tiling, ""));
+    options.push_back (std::pair<std::string, std::string> (cfg_xor_use_zones, "true"));
     options.push_back (std::pair<std::string, std::string> (cfg_xor_region_mode, "all"));
   }
 
@@ -119,3 +124,143 @@ static tl::RegisteredClass<lay::PluginDeclaration> config_decl (new ext::XORPlug
 
 }
 
+// -----------------------------------------------------------------------------------
+//  GSI binding
+
+namespace gsi
+{
+
+static int xor_mode_xor () { return int (db::BooleanOp::Xor); }
+static int xor_mode_anotb () { return int (db::BooleanOp::ANotB); }
+static int xor_mode_bnota () { return int (db::BooleanOp::BNotA); }
+
+static void set_op (ext::XOREngine *engine, int op)
+{
+  if (op != int (db::BooleanOp::Xor) && op != int (db::BooleanOp::ANotB) && op != int (db::BooleanOp::BNotA)) {
+    throw tl::Exception (tl::to_string (QObject::tr ("Invalid mode for XOR engine (must be ModeXor, ModeANotB or ModeBNotA)")));
+  }
+  engine->set_op (db::BooleanOp::BoolOp (op));
+}
+
+static int get_op (const ext::XOREngine *engine)
+{
+  return int (engine->op ());
+}
+
+static void add_layer (ext::XOREngine *engine, const db::LayerProperties &lp)
+{
+  engine->add_layer (lp);
+}
+
+static void run_to_layout (ext::XOREngine *engine, const db::Layout &a, db::cell_index_type top_a, const db::Layout &b, db::cell_index_type top_b, db::Layout &out, db::cell_index_type out_cell)
+{
+  engine->run (a, top_a, b, top_b, out, out_cell);
+}
+
+static void run_to_rdb (ext::XOREngine *engine, const db::Layout &a, db::cell_index_type top_a, const db::Layout &b, db::cell_index_type top_b, rdb::Database &rdb)
+{
+  engine->run (a, top_a, b, top_b, rdb);
+}
+
+gsi::Class<ext::XOREngine> decl_XOREngine ("XOREngine",
+  gsi::method ("ModeXor", &xor_mode_xor, "@brief The mode value for the XOR operation") +
+  gsi::method ("ModeANotB", &xor_mode_anotb, "@brief The mode value for the A NOT B operation") +
+  gsi::method ("ModeBNotA", &xor_mode_bnota, "@brief The mode value for the B NOT A operation") +
+  gsi::method_ext ("mode=", &set_op, gsi::arg ("mode"),
+    "@brief Sets the operation\n"
+    "The mode is one of \\ModeXor (the default), \\ModeANotB or \\ModeBNotA."
+  ) +
+  gsi::method_ext ("mode", &get_op,
+    "@brief Gets the operation\n"
+    "See \\mode= for details."
+  ) +
+  gsi::method ("tolerance=", &ext::XOREngine::set_tolerance, gsi::arg ("t"),
+    "@brief Sets the tolerance in micrometer units\n"
+    "Differences narrower than the tolerance are not reported."
+  ) +
+  gsi::method ("tolerance", &ext::XOREngine::tolerance,
+    "@brief Gets the tolerance in micrometer units\n"
+  ) +
+  gsi::method ("tile_size=", &ext::XOREngine::set_tile_size, gsi::arg ("s"),
+    "@brief Sets the tile size in micrometer units\n"
+    "Zones larger than the tile size are processed in tiles. 0 (the default) disables tiling."
+  ) +
+  gsi::method ("tile_size", &ext::XOREngine::tile_size,
+    "@brief Gets the tile size in micrometer units\n"
+  ) +
+  gsi::method ("threads=", &ext::XOREngine::set_threads, gsi::arg ("n"),
+    "@brief Sets the number of threads to use\n"
+    "With 0 threads (the default), the operation is performed in the calling thread."
+  ) +
+  gsi::method ("threads", &ext::XOREngine::threads,
+    "@brief Gets the number of threads to use\n"
+  ) +
+  gsi::method ("hierarchical=", &ext::XOREngine::set_hierarchical, gsi::arg ("h"),
+    "@brief Enables or disables the hierarchical mode\n"
+    "In hierarchical mode (the default), identical subtrees are skipped and the operation is performed "
+    "in the zones in which the layouts differ only. In non-hierarchical mode, the whole area is processed."
+  ) +
+  gsi::method ("hierarchical?", &ext::XOREngine::hierarchical,
+    "@brief Gets a value indicating whether the hierarchical mode is enabled\n"
+  ) +
+  gsi::method_ext ("add_layer", &add_layer, gsi::arg ("layer"),
+    "@brief Adds a layer to compare\n"
+    "The layers of both layouts matching the given layer info are compared. "
+    "If no layer is added, all layers of both layouts are compared."
+  ) +
+  gsi::method ("clear_layers", &ext::XOREngine::clear_layers,
+    "@brief Clears the layers\n"
+  ) +
+  gsi::method ("layers", &ext::XOREngine::layers,
+    "@brief Gets the number of layers\n"
+    "If no layers have been added, this number is available after \\compute_zones or \\run."
+  ) +
+  gsi::method ("layer", &ext::XOREngine::layer, gsi::arg ("index"),
+    "@brief Gets the layer info of the layer with the given index\n"
+  ) +
+  gsi::method ("compute_zones", &ext::XOREngine::compute_zones, gsi::arg ("layout_a"), gsi::arg ("cell_a"), gsi::arg ("layout_b"), gsi::arg ("cell_b"),
+    "@brief Computes the zones in which the layouts differ\n"
+    "After this method has been called, the zones are available through \\zones."
+  ) +
+  gsi::method ("zones", &ext::XOREngine::zones, gsi::arg ("index"),
+    "@brief Gets the zones for the layer with the given index\n"
+    "The zones are given in units of \\dbu and in the coordinate system of the top cells. "
+    "Outside the zones, both layouts are identical on this layer."
+  ) +
+  gsi::method ("dbu", &ext::XOREngine::dbu,
+    "@brief Gets the database unit the zones and results are computed in\n"
+    "This is the smaller database unit of both layouts."
+  ) +
+  gsi::method_ext ("run", &run_to_layout, gsi::arg ("layout_a"), gsi::arg ("cell_a"), gsi::arg ("layout_b"), gsi::arg ("cell_b"), gsi::arg ("output"), gsi::arg ("output_cell"),
+    "@brief Runs the operation and puts the results into the given layout\n"
+    "The results are put into the cell with index \"output_cell\" on layers with the same layer info as the input layers. "
+    "The output layout may be one of the input layouts."
+  ) +
+  gsi::method_ext ("run", &run_to_rdb, gsi::arg ("layout_a"), gsi::arg ("cell_a"), gsi::arg ("layout_b"), gsi::arg ("cell_b"), gsi::arg ("rdb"),
+    "@brief Runs the operation and puts the results into the given report database\n"
+    "One category is created for the operation with one sub-category per layer."
+  ),
+  "@brief A hierarchical XOR engine\n"
+  "\n"
+  "This engine is the batch counterpart of the XOR tool. It compares two cells of two layouts. Instead of processing "
+  "the whole area, it matches the cells of both layouts by name and identifies the subtrees which are identical through "
+  "content hashes. Only the zones in which the layouts differ are processed.\n"
+  "\n"
+  "@code\n"
+  "a = RBA::Layout::new\n"
+  "a.read(\"a.gds\")\n"
+  "b = RBA::Layout::new\n"
+  "b.read(\"b.gds\")\n"
+  "\n"
+  "engine = RBA::XOREngine::new\n"
+  "engine.threads = 4\n"
+  "rdb = RBA::ReportDatabase::new(\"XOR\")\n"
+  "engine.run(a, a.top_cell.cell_index, b, b.top_cell.cell_index, rdb)\n"
+  "rdb.save(\"xor.lyrdb\")\n"
+  "@/code\n"
+  "\n"
+  "This class has been introduced in version 0.25.\n"
+);
+
+}
+
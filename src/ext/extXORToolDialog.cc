@@ -22,6 +22,7 @@
 
 
 #include "extXORToolDialog.h"
+#include "extXOREngine.h"
 #include "antService.h"
 #include "rdb.h"
 #include "dbShapeProcessor.h"
@@ -55,6 +56,7 @@ std::string cfg_xor_summarize ("xor-summarize");
 std::string cfg_xor_tolerances ("xor-tolerances");
 std::string cfg_xor_tiling ("xor-tiling");
 std::string cfg_xor_region_mode ("xor-region-mode");
+std::string cfg_xor_use_zones ("xor-use-zones");
 
 //  Note: this enum must match with the order of the combo box entries in the 
 //  dialog implementation
@@ -250,6 +252,11 @@ XORToolDialog::exec_dialog (lay::LayoutView *view)
     mp_ui->tiling->setText (tl::to_qstring (tiling));
   }
 
+  bool use_zones = true;
+  if (config_root->config_get (cfg_xor_use_zones, use_zones)) {
+    mp_ui->zones_cb->setChecked (use_zones);
+  }
+
   int ret = QDialog::exec ();
 
   if (ret) {
@@ -325,6 +332,7 @@ BEGIN_PROTECTED
   config_root->config_set (cfg_xor_summarize, mp_ui->summarize_cb->isChecked ());
   config_root->config_set (cfg_xor_tolerances, tl::to_string (mp_ui->tolerances->text ()));
   config_root->config_set (cfg_xor_tiling, tl::to_string (mp_ui->tiling->text ()));
+  config_root->config_set (cfg_xor_use_zones, mp_ui->zones_cb->isChecked ());
   config_root->config_end ();
 
   QDialog::accept ();
@@ -1018,6 +1026,21 @@ XORToolDialog::run_xor ()
     boxes.push_back (overall_box);
   }
 
+  //  Determine the zones in which the layouts differ. Only these zones need to be processed.
+  bool use_zones = mp_ui->zones_cb->isChecked ();
+
+  XOREngine zone_finder;
+  if (use_zones) {
+
+    zone_finder.set_threads (nworkers);
+    for (std::map<db::LayerProperties, std::pair<std::vector<unsigned int>, std::vector<unsigned int> >, db::LPLogicalLessFunc>::const_iterator l = layers.begin (); l != layers.end (); ++l) {
+      zone_finder.add_layer (l->first, l->second.first, l->second.second);
+    }
+
+    zone_finder.compute_zones (cva->layout (), cva.cell_index (), cvb->layout (), cvb.cell_index ());
+
+  }
+
   bool was_cancelled = false;
   for (int mode = 0; mode < 3 && ! was_cancelled; ++mode) {
 
@@ -1181,96 +1204,117 @@ XORToolDialog::run_xor ()
     }
     XORJob job (nworkers, output_mode, op, el_handling, dbu, cva, cvb, tolerances, sub_categories, layer_categories, sub_cells, sub_output_layers, rdb, rdb_cell);
 
-    for (std::vector<db::DBox>::const_iterator box = boxes.begin (); box != boxes.end (); ++box) {
+    for (std::vector<db::DBox>::const_iterator b = boxes.begin (); b != boxes.end (); ++b) {
 
-      //  compute the tiles if required
-      db::Box box_a, box_b, box_out;
-      db::Coord box_width_a = 0, box_height_a = 0, box_width_out = 0;
-      db::Coord box_width_b = 0, box_height_b = 0, box_height_out = 0;
+      unsigned int layer_index = 0;
+      for (std::map<db::LayerProperties, std::pair<std::vector<unsigned int>, std::vector<unsigned int> >, db::LPLogicalLessFunc>::const_iterator l = layers.begin (); l != layers.end (); ++l, ++layer_index) {
 
-      size_t ntiles_w = 1, ntiles_h = 1;
-      if (box->empty ()) {
+        //  Restrict the box to the zones in which the layouts differ on this layer. Layers
+        //  missing in one layout are processed as a whole.
+        std::vector<db::DBox> sub_boxes;
+        if (use_zones && ! l->second.first.empty () && ! l->second.second.empty ()) {
+          const std::vector<db::Box> &zones = zone_finder.zones (layer_index);
+          for (std::vector<db::Box>::const_iterator z = zones.begin (); z != zones.end (); ++z) {
+            db::DBox zb = (db::DBox (*z) * zone_finder.dbu ()) & *b;
+            if (! zb.empty ()) {
+              sub_boxes.push_back (zb);
+            }
+          }
+        } else {
+          sub_boxes.push_back (*b);
+        }
 
-        ntiles_w = ntiles_h = 0;
+        for (std::vector<db::DBox>::const_iterator box = sub_boxes.begin (); box != sub_boxes.end (); ++box) {
 
-      } else if (tile_size > 0.0) {
+          //  compute the tiles if required
+          db::Box box_a, box_b, box_out;
+          db::Coord box_width_a = 0, box_height_a = 0, box_width_out = 0;
+          db::Coord box_width_b = 0, box_height_b = 0, box_height_out = 0;
 
-        box_a = db::Box (*box * (1.0 / cva->layout ().dbu ()));
-        box_b = db::Box (*box * (1.0 / cvb->layout ().dbu ()));
-        box_out = db::Box (*box * (1.0 / dbu));
+          size_t ntiles_w = 1, ntiles_h = 1;
+          if (box->empty ()) {
 
-        ntiles_w = std::max (size_t (1), size_t (floor (box->width () / tile_size + 0.5)));
-        ntiles_h = std::max (size_t (1), size_t (floor (box->height () / tile_size + 0.5)));
+            ntiles_w = ntiles_h = 0;
 
-        box_width_a  = box_a.width () / ntiles_w;
-        box_height_a = box_a.height () / ntiles_h;
+          } else if (tile_size > 0.0) {
 
-        box_width_b  = box_b.width () / ntiles_w;
-        box_height_b = box_b.height () / ntiles_h;
+            box_a = db::Box (*box * (1.0 / cva->layout ().dbu ()));
+            box_b = db::Box (*box * (1.0 / cvb->layout ().dbu ()));
+            box_out = db::Box (*box * (1.0 / dbu));
 
-        box_width_out  = box_out.width () / ntiles_w;
-        box_height_out = box_out.height () / ntiles_h;
+            ntiles_w = std::max (size_t (1), size_t (floor (box->width () / tile_size + 0.5)));
+            ntiles_h = std::max (size_t (1), size_t (floor (box->height () / tile_size + 0.5)));
 
-      } else {
+            box_width_a  = box_a.width () / ntiles_w;
+            box_height_a = box_a.height () / ntiles_h;
 
-        box_a = db::Box (*box * (1.0 / cva->layout ().dbu ()));
-        box_b = db::Box (*box * (1.0 / cvb->layout ().dbu ()));
-        box_out = db::Box (*box * (1.0 / dbu));
+            box_width_b  = box_b.width () / ntiles_w;
+            box_height_b = box_b.height () / ntiles_h;
 
-      }
+            box_width_out  = box_out.width () / ntiles_w;
+            box_height_out = box_out.height () / ntiles_h;
 
-      //  Enlarge the tiles by half the maximum tolerance
-      db::Coord tile_enlargement = 0;
-      for (std::vector <db::Coord>::iterator t = tolerances.begin (); t != tolerances.end (); ++t) {
-        db::Coord enlargement = (*t + 1) / 2; // round up
-        if (enlargement > tile_enlargement) {
-          tile_enlargement = enlargement;
-        }
-      }
+          } else {
 
-      db::Coord tile_enlargement_a = db::coord_traits<db::Coord>::rounded_up (tile_enlargement * dbu / cva->layout ().dbu ());
-      db::Coord tile_enlargement_b = db::coord_traits<db::Coord>::rounded_up (tile_enlargement * dbu / cvb->layout ().dbu ());
+            box_a = db::Box (*box * (1.0 / cva->layout ().dbu ()));
+            box_b = db::Box (*box * (1.0 / cvb->layout ().dbu ()));
+            box_out = db::Box (*box * (1.0 / dbu));
 
-      if (ntiles_w > 1 || ntiles_h > 1 || region_mode != RMAll /*enforces clip*/) {
-        job.has_tiles (true);
-      }
+          }
 
-      //  create the XOR tasks
-      for (size_t nw = 0; nw < ntiles_w; ++nw) {
+          //  Enlarge the tiles by half the maximum tolerance
+          db::Coord tile_enlargement = 0;
+          for (std::vector <db::Coord>::iterator t = tolerances.begin (); t != tolerances.end (); ++t) {
+            db::Coord enlargement = (*t + 1) / 2; // round up
+            if (enlargement > tile_enlargement) {
+              tile_enlargement = enlargement;
+            }
+          }
 
-        for (size_t nh = 0; nh < ntiles_h; ++nh) {
+          db::Coord tile_enlargement_a = db::coord_traits<db::Coord>::rounded_up (tile_enlargement * dbu / cva->layout ().dbu ());
+          db::Coord tile_enlargement_b = db::coord_traits<db::Coord>::rounded_up (tile_enlargement * dbu / cvb->layout ().dbu ());
+
+          if (ntiles_w > 1 || ntiles_h > 1 || region_mode != RMAll || use_zones /*enforces clip*/) {
+            job.has_tiles (true);
+          }
 
-          db::Box clip_box (box_out.left () + nw * box_width_out, 
-                            box_out.bottom () + nh * box_height_out,
-                            (nw == ntiles_w - 1) ? box_out.right () : box_out.left () + (nw + 1) * box_width_out,
-                            (nh == ntiles_h - 1) ? box_out.top () : box_out.bottom () + (nh + 1) * box_height_out);
+          //  create the XOR tasks
+          for (size_t nw = 0; nw < ntiles_w; ++nw) {
 
-          db::Box region_a (box_a.left () + nw * box_width_a, 
-                            box_a.bottom () + nh * box_height_a,
-                            (nw == ntiles_w - 1) ? box_a.right () : box_a.left () + (nw + 1) * box_width_a,
-                            (nh == ntiles_h - 1) ? box_a.top () : box_a.bottom () + (nh + 1) * box_height_a);
+            for (size_t nh = 0; nh < ntiles_h; ++nh) {
 
-          db::Box region_b (box_b.left () + nw * box_width_b, 
-                            box_b.bottom () + nh * box_height_b,
-                            (nw == ntiles_w - 1) ? box_b.right () : box_b.left () + (nw + 1) * box_width_b,
-                            (nh == ntiles_h - 1) ? box_b.top () : box_b.bottom () + (nh + 1) * box_height_b);
+              db::Box clip_box (box_out.left () + nw * box_width_out, 
+                                box_out.bottom () + nh * box_height_out,
+                                (nw == ntiles_w - 1) ? box_out.right () : box_out.left () + (nw + 1) * box_width_out,
+                                (nh == ntiles_h - 1) ? box_out.top () : box_out.bottom () + (nh + 1) * box_height_out);
 
-          region_a.enlarge (db::Vector (tile_enlargement_a, tile_enlargement_a));
-          region_b.enlarge (db::Vector (tile_enlargement_b, tile_enlargement_b));
+              db::Box region_a (box_a.left () + nw * box_width_a, 
+                                box_a.bottom () + nh * box_height_a,
+                                (nw == ntiles_w - 1) ? box_a.right () : box_a.left () + (nw + 1) * box_width_a,
+                                (nh == ntiles_h - 1) ? box_a.top () : box_a.bottom () + (nh + 1) * box_height_a);
 
-          std::string tile_desc = tl::sprintf ("%d/%d,%d/%d", nw + 1, ntiles_w, nh + 1, ntiles_h);
+              db::Box region_b (box_b.left () + nw * box_width_b, 
+                                box_b.bottom () + nh * box_height_b,
+                                (nw == ntiles_w - 1) ? box_b.right () : box_b.left () + (nw + 1) * box_width_b,
+                                (nh == ntiles_h - 1) ? box_b.top () : box_b.bottom () + (nh + 1) * box_height_b);
+
+              region_a.enlarge (db::Vector (tile_enlargement_a, tile_enlargement_a));
+              region_b.enlarge (db::Vector (tile_enlargement_b, tile_enlargement_b));
+
+              std::string tile_desc = tl::sprintf ("%d/%d,%d/%d", nw + 1, ntiles_w, nh + 1, ntiles_h);
+
+              job.schedule (new XORTask (tile_desc, clip_box, region_a, region_b, layer_index, l->first, l->second.first, l->second.second));
+
+            }
 
-          unsigned int layer_index = 0;
-          for (std::map<db::LayerProperties, std::pair<std::vector<unsigned int>, std::vector<unsigned int> >, db::LPLogicalLessFunc>::const_iterator l = layers.begin (); l != layers.end (); ++l, ++layer_index) {
-            job.schedule (new XORTask (tile_desc, clip_box, region_a, region_b, layer_index, l->first, l->second.first, l->second.second));
           }
 
+          todo_count += ntiles_w * ntiles_h * tolerances.size ();
+
         }
 
       }
 
-      todo_count += ntiles_w * ntiles_h * tolerances.size () * layers.size ();
-
     }
 
     bool was_cancelled = false;
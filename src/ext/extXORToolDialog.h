@@ -51,6 +51,7 @@ extern std::string cfg_xor_summarize;
 extern std::string cfg_xor_tolerances;
 extern std::string cfg_xor_tiling;
 extern std::string cfg_xor_region_mode;
+extern std::string cfg_xor_use_zones;
 
 class XORToolDialog
   : public QDialog
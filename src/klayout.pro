@@ -5,6 +5,7 @@ TEMPLATE = subdirs
 
 SUBDIRS = \
   klayout_main \
+  klayout_render \
   unit_tests \
   tl \
   gsi \
@@ -72,6 +73,7 @@ ut.depends += lay ext lib
 plugins.depends += lay ext lib ut
 
 klayout_main.depends += lay ext lib plugins
+klayout_render.depends += laybasic
 unit_tests.depends += ut plugins
 
 RESOURCES += \
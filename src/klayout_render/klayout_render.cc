@@ -0,0 +1,283 @@
+
+/*
+
+  KLayout Layout Viewer
+  Copyright (C) 2006-2017 Matthias Koefferlein
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+
+#include "layHeadlessRenderer.h"
+#include "layLayerProperties.h"
+#include "dbLayout.h"
+#include "dbReader.h"
+#include "tlStream.h"
+#include "tlXMLParser.h"
+#include "tlString.h"
+#include "tlLog.h"
+#include "tlException.h"
+#include "tlInternational.h"
+#include "tlStaticObjects.h"
+#include "tlTimer.h"
+
+#include <QThread>
+
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+
+/**
+ *  @brief A batch renderer for layout snapshots
+ *
+ *  This program renders a layout into PNG images without a GUI. It does not create a
+ *  QApplication and does not set up a LayoutView. The snapshots are rendered in parallel.
+ *
+ *  Usage: klayout_render [options] <layout file> [<viewport spec> ...]
+ *
+ *  A viewport spec is "x1,y1,x2,y2:file.png" with the coordinates given in micrometer units.
+ */
+
+static void
+print_usage ()
+{
+  std::cout
+    << "Usage: klayout_render [options] <layout file> [<viewport spec> ...]" << std::endl
+    << std::endl
+    << "A viewport spec is 'x1,y1,x2,y2:file.png' with the box given in micrometer units." << std::endl
+    << "'*' instead of the box renders the whole cell ('*:file.png')." << std::endl
+    << std::endl
+    << "Options:" << std::endl
+    << "  -l <file>       Use the given layer properties file (.lyp)" << std::endl
+    << "  -c <cell>       Use the given cell as the top cell" << std::endl
+    << "  -v <file>       Read viewport specs from the given file (one per line)" << std::endl
+    << "  -s <w>x<h>      Image size in pixels (default: 800x600)" << std::endl
+    << "  -b <color>      Background color as #rrggbb (default: #ffffff)" << std::endl
+    << "  -t <threads>    Number of rendering threads (default: number of cores)" << std::endl
+    << "  -m <levels>     Number of hierarchy levels to draw (default: all)" << std::endl
+    << "  -d <level>      Verbosity level" << std::endl
+    << "  --no-texts      Don't draw texts" << std::endl
+    << "  --no-lod        Don't use level-of-detail rasters for small cells" << std::endl
+    << "  -h              Show this help" << std::endl;
+}
+
+static void
+parse_viewport (const std::string &spec, const db::DBox &cell_box, unsigned int w, unsigned int h, std::vector<lay::HeadlessSnapshot> &snapshots)
+{
+  size_t colon = spec.rfind (':');
+  if (colon == std::string::npos || colon + 1 >= spec.size ()) {
+    throw tl::Exception (tl::to_string (QObject::tr ("Invalid viewport specification (expected 'x1,y1,x2,y2:file.png'): ")) + spec);
+  }
+
+  std::string box_spec (spec, 0, colon);
+  std::string path (spec, colon + 1);
+
+  db::DBox box;
+  if (tl::trim (box_spec) == "*") {
+    box = cell_box;
+  } else {
+    double x1 = 0.0, y1 = 0.0, x2 = 0.0, y2 = 0.0;
+    tl::Extractor ex (box_spec.c_str ());
+    ex.read (x1).expect (",").read (y1).expect (",").read (x2).expect (",").read (y2).expect_end ();
+    box = db::DBox (x1, y1, x2, y2);
+  }
+
+  snapshots.push_back (lay::HeadlessSnapshot (box, w, h, path));
+}
+
+static lay::color_t
+parse_color (const std::string &s)
+{
+  tl::Extractor ex (s.c_str ());
+  ex.test ("#");
+
+  const char *cp = ex.skip ();
+  char *end = 0;
+  unsigned long c = strtoul (cp, &end, 16);
+  if (end != cp + 6 || *end) {
+    throw tl::Exception (tl::to_string (QObject::tr ("Invalid color (expected '#rrggbb'): ")) + s);
+  }
+
+  return 0xff000000 | lay::color_t (c);
+}
+
+static int
+klayout_render (int argc, char **argv)
+{
+  std::string layout_file, lyp_file, cell_name;
+  std::vector<std::string> viewport_specs;
+  unsigned int width = 800, height = 600;
+  lay::color_t background = 0xffffffff;
+  int threads = QThread::idealThreadCount ();
+  int max_levels = -1;
+  bool texts = true, lod = true;
+
+  for (int i = 1; i < argc; ++i) {
+
+    std::string a = argv [i];
+
+    if (a == "-h" || a == "--help") {
+      print_usage ();
+      return 0;
+    } else if (a == "--no-texts") {
+      texts = false;
+    } else if (a == "--no-lod") {
+      lod = false;
+    } else if (a.size () == 2 && a [0] == '-' && std::string ("lcvsbtmd").find (a [1]) != std::string::npos) {
+
+      if (i + 1 >= argc) {
+        throw tl::Exception (tl::to_string (QObject::tr ("Option %s requires an argument")), a);
+      }
+      std::string v = argv [++i];
+
+      if (a == "-l") {
+        lyp_file = v;
+      } else if (a == "-c") {
+        cell_name = v;
+      } else if (a == "-v") {
+        tl::InputStream is (v);
+        tl::TextInputStream text (is);
+        while (! text.at_end ()) {
+          std::string l = tl::trim (text.get_line ());
+          if (! l.empty () && l [0] != '#') {
+            viewport_specs.push_back (l);
+          }
+        }
+      } else if (a == "-s") {
+        tl::Extractor ex (v.c_str ());
+        ex.read (width).expect ("x").read (height).expect_end ();
+      } else if (a == "-b") {
+        background = parse_color (v);
+      } else if (a == "-t") {
+        tl::from_string (v, threads);
+      } else if (a == "-m") {
+        tl::from_string (v, max_levels);
+      } else if (a == "-d") {
+        int level = 0;
+        tl::from_string (v, level);
+        tl::verbosity (level);
+      }
+
+    } else if (! a.empty () && a [0] == '-') {
+      throw tl::Exception (tl::to_string (QObject::tr ("Unknown option: %s")), a);
+    } else if (layout_file.empty ()) {
+      layout_file = a;
+    } else {
+      viewport_specs.push_back (a);
+    }
+
+  }
+
+  if (layout_file.empty ()) {
+    print_usage ();
+    return 1;
+  }
+
+  db::Manager manager;
+  db::Layout layout (&manager);
+
+  {
+    tl::SelfTimer timer (tl::verbosity () >= 11, tl::to_string (QObject::tr ("Reading layout")));
+    tl::InputStream stream (layout_file);
+    db::Reader reader (stream);
+    reader.read (layout);
+  }
+
+  db::cell_index_type top_cell = 0;
+  if (! cell_name.empty ()) {
+    std::pair<bool, db::cell_index_type> cbn = layout.cell_by_name (cell_name.c_str ());
+    if (! cbn.first) {
+      throw tl::Exception (tl::to_string (QObject::tr ("Not a valid cell name: %s")), cell_name);
+    }
+    top_cell = cbn.second;
+  } else {
+    db::Layout::top_down_const_iterator t = layout.begin_top_down ();
+    if (t == layout.end_top_cells ()) {
+      throw tl::Exception (tl::to_string (QObject::tr ("The layout does not have a top cell")));
+    }
+    top_cell = *t;
+    if (++t != layout.end_top_cells ()) {
+      throw tl::Exception (tl::to_string (QObject::tr ("The layout has multiple top cells - use -c to specify one")));
+    }
+  }
+
+  lay::HeadlessRenderer renderer (layout, top_cell);
+  renderer.set_background_color (background);
+  renderer.set_text_visible (texts);
+  renderer.set_use_lod (lod);
+  renderer.set_threads (threads);
+  if (max_levels >= 0) {
+    renderer.set_max_hier_levels (max_levels);
+  }
+
+  if (! lyp_file.empty ()) {
+
+    std::vector<lay::LayerPropertiesList> props;
+    try {
+      tl::XMLFileSource in (lyp_file);
+      props.push_back (lay::LayerPropertiesList ());
+      props.back ().load (in);
+    } catch (...) {
+      //  multi-tab layer properties files: use the first tab
+      props.clear ();
+      tl::XMLFileSource in (lyp_file);
+      lay::LayerPropertiesList::load (in, props);
+    }
+
+    if (! props.empty ()) {
+      renderer.set_layer_properties (props.front ());
+    }
+
+  }
+
+  db::DBox cell_box = db::DBox (layout.cell (top_cell).bbox ()) * layout.dbu ();
+
+  std::vector<lay::HeadlessSnapshot> snapshots;
+  for (std::vector<std::string>::const_iterator s = viewport_specs.begin (); s != viewport_specs.end (); ++s) {
+    parse_viewport (*s, cell_box, width, height, snapshots);
+  }
+
+  {
+    tl::SelfTimer timer (tl::verbosity () >= 10, tl::sprintf (tl::to_string (QObject::tr ("Rendering %d snapshot(s) with %d thread(s)")), int (snapshots.size ()), threads));
+    renderer.render_all (snapshots);
+  }
+
+  return 0;
+}
+
+int
+main (int argc, char **argv)
+{
+  int ret = 0;
+
+  try {
+    ret = klayout_render (argc, argv);
+  } catch (tl::Exception &ex) {
+    tl::error << ex.msg ();
+    ret = 1;
+  } catch (std::exception &ex) {
+    tl::error << ex.what ();
+    ret = 1;
+  } catch (...) {
+    tl::error << tl::to_string (QObject::tr ("ERROR: unspecific error"));
+    ret = 1;
+  }
+
+  tl::StaticObjects::cleanup ();
+
+  return ret;
+}
+
@@ -0,0 +1,23 @@
+
+DESTDIR = $$OUT_PWD/..
+
+include($$PWD/../klayout.pri)
+
+TEMPLATE = app
+
+TARGET = klayout_render
+
+HEADERS = \
+
+SOURCES = \
+  klayout_render.cc \
+
+INCLUDEPATH += ../tl ../gsi ../db ../rdb ../laybasic
+DEPENDPATH += ../tl ../gsi ../db ../rdb ../laybasic
+LIBS += -L$$DESTDIR -lklayout_tl -lklayout_gsi -lklayout_db -lklayout_rdb -lklayout_laybasic
+
+# Note: this accounts for UI-generated headers placed into the output folders in
+# shadow builds:
+INCLUDEPATH += $$DESTDIR/laybasic
+DEPENDPATH += $$DESTDIR/laybasic
+
@@ -22,10 +22,13 @@
 
 
 #include "layBitmap.h"
+#include "layBitmapKernels.h"
 #include "layBitmapRenderer.h"
 #include "layFixedFont.h"
 #include "tlAlgorithm.h"
 
+#include <string.h>
+
 namespace lay {
 
 Bitmap::Bitmap ()
@@ -220,14 +223,11 @@ Bitmap::merge (const lay::Bitmap *from, int dx, int dy)
       uint32_t *sl_to = scanline (n + dy);
 
       if (! s1) {
-        for (unsigned int i = 0; i < m; ++i) {
-          *sl_to++ |= *sl_from++;
-        }
+        bitmap_or (sl_to, sl_from, m);
       } else if (m) {
-        for (unsigned int i = 1; i < m; ++i) {
-          *sl_to++ |= (sl_from[1] << s2) | (sl_from[0] >> s1);
-          ++sl_from;
-        }
+        bitmap_or_shifted (sl_to, sl_from, m - 1, s1);
+        sl_to += m - 1;
+        sl_from += m - 1;
         if (mm > m - 1) {
           *sl_to++ |= (sl_from[0] >> s1);
         }
@@ -254,15 +254,12 @@ Bitmap::merge (const lay::Bitmap *from, int dx, int dy)
       uint32_t *sl_to = scanline (n + dy) + mo;
 
       if (! s1) {
-        for (unsigned int i = 0; i < m; ++i) {
-          *sl_to++ |= *sl_from++;
-        }
+        bitmap_or (sl_to, sl_from, m);
       } else if (m) {
         *sl_to++ |= (sl_from[0] << s1);
-        for (unsigned int i = 1; i < m; ++i) {
-          *sl_to++ |= (sl_from[0] >> s2) | (sl_from[1] << s1);
-          ++sl_from;
-        }
+        bitmap_or_shifted (sl_to, sl_from, m - 1, s2);
+        sl_to += m - 1;
+        sl_from += m - 1;
         if (mm > m) {
           *sl_to++ |= (sl_from[0] >> s2);
         }
@@ -343,8 +340,6 @@ static const uint32_t masks [32] = {
   0x0fffffff, 0x1fffffff, 0x3fffffff, 0x7fffffff
 };
 
-static const uint32_t all_ones = 0xffffffff;
-
 void 
 Bitmap::fill (unsigned int y, unsigned int x1, unsigned int x2)
 {
@@ -361,9 +356,10 @@ Bitmap::fill (unsigned int y, unsigned int x1, unsigned int x2)
   } else if (b > 0) {
 
     *sl++ |= ~masks [x1 % 32];
-    while (b > 1) {
-      *sl++ |= all_ones;
-      b--;
+    if (b > 1) {
+      //  memset is a vectorized span fill already
+      memset (sl, 0xff, (b - 1) * sizeof (uint32_t));
+      sl += b - 1;
     }
 
     unsigned int m = masks [x2 % 32];
@@ -376,6 +372,80 @@ Bitmap::fill (unsigned int y, unsigned int x1, unsigned int x2)
   }
 }
 
+void 
+Bitmap::merge (const lay::Bitmap *from, unsigned int x1, unsigned int y1, unsigned int x2, unsigned int y2)
+{
+  if (! from) {
+    return;
+  }
+
+  x2 = std::min (x2, std::min (width (), from->width ()));
+  y2 = std::min (y2, std::min (height (), from->height ()));
+  if (x1 >= x2 || y1 >= y2) {
+    return;
+  }
+
+  unsigned int b1 = x1 / 32;
+  unsigned int b2 = (x2 - 1) / 32;
+  uint32_t m1 = ~masks [x1 % 32];
+  uint32_t m2 = (x2 % 32) ? masks [x2 % 32] : ~uint32_t (0);
+
+  for (unsigned int y = y1; y < y2; ++y) {
+
+    if (from->is_scanline_empty (y)) {
+      continue;
+    }
+
+    const uint32_t *sl_from = from->scanline (y);
+    uint32_t *sl_to = scanline (y);
+
+    if (b1 == b2) {
+      sl_to [b1] |= sl_from [b1] & m1 & m2;
+    } else {
+      sl_to [b1] |= sl_from [b1] & m1;
+      bitmap_or (sl_to + b1 + 1, sl_from + b1 + 1, b2 - b1 - 1);
+      sl_to [b2] |= sl_from [b2] & m2;
+    }
+
+  }
+}
+
+void 
+Bitmap::clear (unsigned int y, unsigned int x1, unsigned int x2)
+{
+  //  nothing to do on empty scanlines
+  if (m_scanlines.empty () || m_scanlines [y] == 0) {
+    return;
+  }
+
+  unsigned int b1 = x1 / 32;
+
+  uint32_t *sl = m_scanlines [y];
+  sl += b1;
+
+  unsigned int b = x2 / 32 - b1;
+  if (b == 0) {
+
+    *sl &= ~(masks [x2 % 32] & ~masks [x1 % 32]);
+
+  } else if (b > 0) {
+
+    *sl++ &= masks [x1 % 32];
+    if (b > 1) {
+      memset (sl, 0, (b - 1) * sizeof (uint32_t));
+      sl += b - 1;
+    }
+
+    unsigned int m = masks [x2 % 32];
+    //  Hint: if x2==width and width%32==0, sl must not be accessed. This is guaranteed by
+    //  checking if m != 0.
+    if (m) {
+      *sl &= ~m;
+    }
+
+  }
+}
+
 struct PosCompareF 
 {
   bool operator() (const RenderEdge &a, const RenderEdge &b) const
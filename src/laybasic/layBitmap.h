@@ -246,6 +246,19 @@ public:
    */
   void fill (unsigned int y, unsigned int x1, unsigned int x2);
 
+  /**
+   *  @brief Clear method
+   *
+   *  Clears a line at scanline y, starting from x1 and ending
+   *  with x2 (exclusive). This is the inverse of "fill" and the
+   *  same restrictions apply for x1 and x2.
+   *
+   *  @param y The scanline
+   *  @param x1 The start coordinate
+   *  @param x2 The end coordinate
+   */
+  void clear (unsigned int y, unsigned int x1, unsigned int x2);
+
   /**
    *  @brief Merges the "from" bitmap into this
    *
@@ -254,6 +267,14 @@ public:
    */
   void merge (const lay::Bitmap *from, int dx, int dy);
 
+  /**
+   *  @brief Merges a part of the "from" bitmap into this
+   *
+   *  Only the pixels from column x1 to x2 (exclusive) and from row y1 to y2 (exclusive) 
+   *  are copied. No displacement is applied.
+   */
+  void merge (const lay::Bitmap *from, unsigned int x1, unsigned int y1, unsigned int x2, unsigned int y2);
+
   /**  
    *  @brief Test whether the bitmap is empty
    */
@@ -0,0 +1,380 @@
+
+/*
+
+  KLayout Layout Viewer
+  Copyright (C) 2006-2017 Matthias Koefferlein
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+
+
+#include "layBitmapKernels.h"
+
+//  SSE2 is part of every x86_64 CPU and is available at compile time.
+//  AVX2 kernels are compiled through function-specific target attributes and
+//  are selected at runtime if the CPU supports them.
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define LAY_BITMAP_KERNELS_SSE2
+#  include <emmintrin.h>
+#endif
+
+#if defined(LAY_BITMAP_KERNELS_SSE2) && (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#  define LAY_BITMAP_KERNELS_AVX2
+#  include <immintrin.h>
+#  define LAY_TARGET_AVX2 __attribute__ ((target ("avx2")))
+#endif
+
+namespace lay
+{
+
+// ----------------------------------------------------------------------------------------------
+//  Scalar implementation
+
+static void
+or_scalar (uint32_t *to, const uint32_t *from, unsigned int n)
+{
+  for (unsigned int i = 0; i < n; ++i) {
+    *to++ |= *from++;
+  }
+}
+
+static void
+or_shifted_scalar (uint32_t *to, const uint32_t *from, unsigned int n, unsigned int s)
+{
+  unsigned int s2 = 32 - s;
+  for (unsigned int i = 0; i < n; ++i) {
+    *to++ |= (from[0] >> s) | (from[1] << s2);
+    ++from;
+  }
+}
+
+static void
+and_pattern_scalar (uint32_t *to, const uint32_t *from, const uint32_t *pattern, unsigned int stride, unsigned int n)
+{
+  const uint32_t *p = pattern;
+  for (unsigned int i = 0; i < n; ++i) {
+    *to++ = *from++ & *p++;
+    if (p == pattern + stride) {
+      p = pattern;
+    }
+  }
+}
+
+static void
+expand_colors_scalar (lay::color_t *y, lay::color_t *z, uint32_t bits, lay::color_t ormask, lay::color_t andmask)
+{
+  uint32_t m = 1;
+  for (unsigned int k = 0; k < 32; ++k, m <<= 1) {
+    if ((bits & m) != 0) {
+      y [k] |= ormask & z [k];
+      z [k] &= andmask;
+    }
+  }
+}
+
+// ----------------------------------------------------------------------------------------------
+//  SSE2 implementation
+
+#if defined(LAY_BITMAP_KERNELS_SSE2)
+
+static void
+or_sse2 (uint32_t *to, const uint32_t *from, unsigned int n)
+{
+  unsigned int i = 0;
+  for ( ; i + 4 <= n; i += 4) {
+    __m128i a = _mm_loadu_si128 ((const __m128i *) (from + i));
+    __m128i b = _mm_loadu_si128 ((const __m128i *) (to + i));
+    _mm_storeu_si128 ((__m128i *) (to + i), _mm_or_si128 (a, b));
+  }
+  or_scalar (to + i, from + i, n - i);
+}
+
+static void
+or_shifted_sse2 (uint32_t *to, const uint32_t *from, unsigned int n, unsigned int s)
+{
+  __m128i sr = _mm_cvtsi32_si128 (int (s));
+  __m128i sl = _mm_cvtsi32_si128 (int (32 - s));
+
+  unsigned int i = 0;
+  for ( ; i + 4 <= n; i += 4) {
+    __m128i a = _mm_loadu_si128 ((const __m128i *) (from + i));
+    __m128i b = _mm_loadu_si128 ((const __m128i *) (from + i + 1));
+    __m128i t = _mm_loadu_si128 ((const __m128i *) (to + i));
+    __m128i r = _mm_or_si128 (_mm_srl_epi32 (a, sr), _mm_sll_epi32 (b, sl));
+    _mm_storeu_si128 ((__m128i *) (to + i), _mm_or_si128 (t, r));
+  }
+  or_shifted_scalar (to + i, from + i, n - i, s);
+}
+
+static void
+and_pattern_sse2 (uint32_t *to, const uint32_t *from, const uint32_t *pattern, unsigned int stride, unsigned int n)
+{
+  //  the vector implementation requires the pattern to repeat within a vector
+  if (4 % stride != 0) {
+    and_pattern_scalar (to, from, pattern, stride, n);
+    return;
+  }
+
+  __m128i p = _mm_set_epi32 (int (pattern [3 % stride]), int (pattern [2 % stride]), int (pattern [1 % stride]), int (pattern [0]));
+
+  unsigned int i = 0;
+  for ( ; i + 4 <= n; i += 4) {
+    __m128i a = _mm_loadu_si128 ((const __m128i *) (from + i));
+    _mm_storeu_si128 ((__m128i *) (to + i), _mm_and_si128 (a, p));
+  }
+  and_pattern_scalar (to + i, from + i, pattern, stride, n - i);
+}
+
+static void
+expand_colors_sse2 (lay::color_t *y, lay::color_t *z, uint32_t bits, lay::color_t ormask, lay::color_t andmask)
+{
+  const __m128i vbits = _mm_set1_epi32 (int (bits));
+  const __m128i vor = _mm_set1_epi32 (int (ormask));
+  const __m128i vand = _mm_set1_epi32 (int (andmask));
+
+  __m128i sel = _mm_set_epi32 (8, 4, 2, 1);
+
+  for (unsigned int k = 0; k < 32; k += 4, sel = _mm_slli_epi32 (sel, 4)) {
+
+    if (((bits >> k) & 0xf) == 0) {
+      continue;
+    }
+
+    //  m is all ones for the pixels whose bit is set
+    __m128i m = _mm_cmpeq_epi32 (_mm_and_si128 (vbits, sel), sel);
+
+    __m128i vy = _mm_loadu_si128 ((const __m128i *) (y + k));
+    __m128i vz = _mm_loadu_si128 ((const __m128i *) (z + k));
+    vy = _mm_or_si128 (vy, _mm_and_si128 (m, _mm_and_si128 (vor, vz)));
+    vz = _mm_or_si128 (_mm_and_si128 (m, _mm_and_si128 (vz, vand)), _mm_andnot_si128 (m, vz));
+    _mm_storeu_si128 ((__m128i *) (y + k), vy);
+    _mm_storeu_si128 ((__m128i *) (z + k), vz);
+
+  }
+}
+
+#endif
+
+// ----------------------------------------------------------------------------------------------
+//  AVX2 implementation
+
+#if defined(LAY_BITMAP_KERNELS_AVX2)
+
+LAY_TARGET_AVX2 static void
+or_avx2 (uint32_t *to, const uint32_t *from, unsigned int n)
+{
+  unsigned int i = 0;
+  for ( ; i + 8 <= n; i += 8) {
+    __m256i a = _mm256_loadu_si256 ((const __m256i *) (from + i));
+    __m256i b = _mm256_loadu_si256 ((const __m256i *) (to + i));
+    _mm256_storeu_si256 ((__m256i *) (to + i), _mm256_or_si256 (a, b));
+  }
+  or_sse2 (to + i, from + i, n - i);
+}
+
+LAY_TARGET_AVX2 static void
+or_shifted_avx2 (uint32_t *to, const uint32_t *from, unsigned int n, unsigned int s)
+{
+  __m128i sr = _mm_cvtsi32_si128 (int (s));
+  __m128i sl = _mm_cvtsi32_si128 (int (32 - s));
+
+  unsigned int i = 0;
+  for ( ; i + 8 <= n; i += 8) {
+    __m256i a = _mm256_loadu_si256 ((const __m256i *) (from + i));
+    __m256i b = _mm256_loadu_si256 ((const __m256i *) (from + i + 1));
+    __m256i t = _mm256_loadu_si256 ((const __m256i *) (to + i));
+    __m256i r = _mm256_or_si256 (_mm256_srl_epi32 (a, sr), _mm256_sll_epi32 (b, sl));
+    _mm256_storeu_si256 ((__m256i *) (to + i), _mm256_or_si256 (t, r));
+  }
+  or_shifted_sse2 (to + i, from + i, n - i, s);
+}
+
+LAY_TARGET_AVX2 static void
+and_pattern_avx2 (uint32_t *to, const uint32_t *from, const uint32_t *pattern, unsigned int stride, unsigned int n)
+{
+  //  the vector implementation requires the pattern to repeat within a vector
+  if (8 % stride != 0) {
+    and_pattern_scalar (to, from, pattern, stride, n);
+    return;
+  }
+
+  __m256i p = _mm256_set_epi32 (int (pattern [7 % stride]), int (pattern [6 % stride]), int (pattern [5 % stride]), int (pattern [4 % stride]),
+                                int (pattern [3 % stride]), int (pattern [2 % stride]), int (pattern [1 % stride]), int (pattern [0]));
+
+  unsigned int i = 0;
+  for ( ; i + 8 <= n; i += 8) {
+    __m256i a = _mm256_loadu_si256 ((const __m256i *) (from + i));
+    _mm256_storeu_si256 ((__m256i *) (to + i), _mm256_and_si256 (a, p));
+  }
+  and_pattern_scalar (to + i, from + i, pattern, stride, n - i);
+}
+
+LAY_TARGET_AVX2 static void
+expand_colors_avx2 (lay::color_t *y, lay::color_t *z, uint32_t bits, lay::color_t ormask, lay::color_t andmask)
+{
+  const __m256i vbits = _mm256_set1_epi32 (int (bits));
+  const __m256i vor = _mm256_set1_epi32 (int (ormask));
+  const __m256i vand = _mm256_set1_epi32 (int (andmask));
+
+  __m256i sel = _mm256_set_epi32 (128, 64, 32, 16, 8, 4, 2, 1);
+
+  for (unsigned int k = 0; k < 32; k += 8, sel = _mm256_slli_epi32 (sel, 8)) {
+
+    if (((bits >> k) & 0xff) == 0) {
+      continue;
+    }
+
+    //  m is all ones for the pixels whose bit is set
+    __m256i m = _mm256_cmpeq_epi32 (_mm256_and_si256 (vbits, sel), sel);
+
+    __m256i vy = _mm256_loadu_si256 ((const __m256i *) (y + k));
+    __m256i vz = _mm256_loadu_si256 ((const __m256i *) (z + k));
+    vy = _mm256_or_si256 (vy, _mm256_and_si256 (m, _mm256_and_si256 (vor, vz)));
+    vz = _mm256_or_si256 (_mm256_and_si256 (m, _mm256_and_si256 (vz, vand)), _mm256_andnot_si256 (m, vz));
+    _mm256_storeu_si256 ((__m256i *) (y + k), vy);
+    _mm256_storeu_si256 ((__m256i *) (z + k), vz);
+
+  }
+}
+
+#endif
+
+// ----------------------------------------------------------------------------------------------
+//  Kernel selection
+
+namespace
+{
+
+struct BitmapKernels
+{
+  void (*or_words) (uint32_t *, const uint32_t *, unsigned int);
+  void (*or_shifted) (uint32_t *, const uint32_t *, unsigned int, unsigned int);
+  void (*and_pattern) (uint32_t *, const uint32_t *, const uint32_t *, unsigned int, unsigned int);
+  void (*expand_colors) (lay::color_t *, lay::color_t *, uint32_t, lay::color_t, lay::color_t);
+};
+
+}
+
+static const BitmapKernels kernels_scalar = { &or_scalar, &or_shifted_scalar, &and_pattern_scalar, &expand_colors_scalar };
+#if defined(LAY_BITMAP_KERNELS_SSE2)
+static const BitmapKernels kernels_sse2 = { &or_sse2, &or_shifted_sse2, &and_pattern_sse2, &expand_colors_sse2 };
+#endif
+#if defined(LAY_BITMAP_KERNELS_AVX2)
+static const BitmapKernels kernels_avx2 = { &or_avx2, &or_shifted_avx2, &and_pattern_avx2, &expand_colors_avx2 };
+#endif
+
+static BitmapKernelSet s_kernel_set = BKS_Scalar;
+static const BitmapKernels *sp_kernels = 0;
+
+BitmapKernelSet
+best_bitmap_kernel_set ()
+{
+#if defined(LAY_BITMAP_KERNELS_AVX2)
+  __builtin_cpu_init ();
+  if (__builtin_cpu_supports ("avx2")) {
+    return BKS_AVX2;
+  }
+#endif
+#if defined(LAY_BITMAP_KERNELS_SSE2)
+  return BKS_SSE2;
+#else
+  return BKS_Scalar;
+#endif
+}
+
+void
+set_bitmap_kernel_set (BitmapKernelSet ks)
+{
+  BitmapKernelSet best = best_bitmap_kernel_set ();
+  if (int (ks) > int (best)) {
+    ks = best;
+  }
+
+  s_kernel_set = ks;
+
+#if defined(LAY_BITMAP_KERNELS_AVX2)
+  if (ks == BKS_AVX2) {
+    sp_kernels = &kernels_avx2;
+    return;
+  }
+#endif
+#if defined(LAY_BITMAP_KERNELS_SSE2)
+  if (ks == BKS_SSE2) {
+    sp_kernels = &kernels_sse2;
+    return;
+  }
+#endif
+  sp_kernels = &kernels_scalar;
+}
+
+static inline const BitmapKernels *
+kernels ()
+{
+  //  Hint: concurrent initialization is harmless as all threads will select the same kernels
+  if (! sp_kernels) {
+    set_bitmap_kernel_set (best_bitmap_kernel_set ());
+  }
+  return sp_kernels;
+}
+
+BitmapKernelSet
+bitmap_kernel_set ()
+{
+  kernels ();
+  return s_kernel_set;
+}
+
+const char *
+bitmap_kernel_set_name (BitmapKernelSet ks)
+{
+  if (ks == BKS_AVX2) {
+    return "AVX2";
+  } else if (ks == BKS_SSE2) {
+    return "SSE2";
+  } else {
+    return "scalar";
+  }
+}
+
+void
+bitmap_or (uint32_t *to, const uint32_t *from, unsigned int n)
+{
+  kernels ()->or_words (to, from, n);
+}
+
+void
+bitmap_or_shifted (uint32_t *to, const uint32_t *from, unsigned int n, unsigned int s)
+{
+  kernels ()->or_shifted (to, from, n, s);
+}
+
+void
+bitmap_and_pattern (uint32_t *to, const uint32_t *from, const uint32_t *pattern, unsigned int stride, unsigned int n)
+{
+  kernels ()->and_pattern (to, from, pattern, stride, n);
+}
+
+void
+bitmap_expand_colors (lay::color_t *y, lay::color_t *z, uint32_t bits, lay::color_t ormask, lay::color_t andmask)
+{
+  kernels ()->expand_colors (y, z, bits, ormask, andmask);
+}
+
+}
+
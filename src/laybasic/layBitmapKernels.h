@@ -0,0 +1,101 @@
+
+/*
+
+  KLayout Layout Viewer
+  Copyright (C) 2006-2017 Matthias Koefferlein
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+
+
+#ifndef HDR_layBitmapKernels
+#define HDR_layBitmapKernels
+
+#include "laybasicCommon.h"
+#include "layViewOp.h"
+
+#include <stdint.h>
+
+namespace lay
+{
+
+/**
+ *  @brief The instruction sets for the bitmap kernels
+ */
+enum BitmapKernelSet
+{
+  BKS_Scalar = 0,
+  BKS_SSE2 = 1,
+  BKS_AVX2 = 2
+};
+
+/**
+ *  @brief Gets the best instruction set available on this machine
+ */
+LAYBASIC_PUBLIC BitmapKernelSet best_bitmap_kernel_set ();
+
+/**
+ *  @brief Gets the instruction set currently used by the bitmap kernels
+ *
+ *  Initially, this is the best instruction set available.
+ */
+LAYBASIC_PUBLIC BitmapKernelSet bitmap_kernel_set ();
+
+/**
+ *  @brief Selects the instruction set used by the bitmap kernels
+ *
+ *  This method is provided for testing and benchmarking. If the instruction set is not
+ *  available, the best available one below is taken. This method must not be called while
+ *  the kernels are in use by other threads.
+ */
+LAYBASIC_PUBLIC void set_bitmap_kernel_set (BitmapKernelSet ks);
+
+/**
+ *  @brief Gets the name of an instruction set
+ */
+LAYBASIC_PUBLIC const char *bitmap_kernel_set_name (BitmapKernelSet ks);
+
+/**
+ *  @brief OR-combines n words: to[i] |= from[i]
+ */
+LAYBASIC_PUBLIC void bitmap_or (uint32_t *to, const uint32_t *from, unsigned int n);
+
+/**
+ *  @brief OR-combines n words with a bit shift across word boundaries
+ *
+ *  This function computes to[i] |= (from[i] >> s) | (from[i + 1] << (32 - s)) for i from 0 to n - 1.
+ *  Hence it reads n + 1 words from "from". s must be between 1 and 31.
+ */
+LAYBASIC_PUBLIC void bitmap_or_shifted (uint32_t *to, const uint32_t *from, unsigned int n, unsigned int s);
+
+/**
+ *  @brief Masks n words with a periodic pattern: to[i] = from[i] & pattern[i % stride]
+ */
+LAYBASIC_PUBLIC void bitmap_and_pattern (uint32_t *to, const uint32_t *from, const uint32_t *pattern, unsigned int stride, unsigned int n);
+
+/**
+ *  @brief Expands the bits of a word into color modifications for 32 pixels
+ *
+ *  For every bit k set in "bits", this function computes
+ *  y[k] |= ormask & z[k] and z[k] &= andmask.
+ */
+LAYBASIC_PUBLIC void bitmap_expand_colors (lay::color_t *y, lay::color_t *z, uint32_t bits, lay::color_t ormask, lay::color_t andmask);
+
+}
+
+#endif
+
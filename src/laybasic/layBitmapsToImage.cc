@@ -23,10 +23,12 @@
 
 #include "layBitmapsToImage.h"
 #include "layBitmap.h"
+#include "layBitmapKernels.h"
 #include "layDitherPattern.h"
 #include "layLineStyles.h"
 #include "tlTimer.h"
 #include "tlAssert.h"
+#include "tlPixelBuffer.h"
 
 #include <QMutex>
 #include <QImage>
@@ -38,20 +40,7 @@ static void
 render_scanline_std (const uint32_t *dp, unsigned int ds, const lay::Bitmap *pbitmap, unsigned int y, unsigned int w, unsigned int /*h*/, uint32_t *data)
 {
   const uint32_t *ps = pbitmap->scanline (y);
-  const uint32_t *dm = dp;
-
-  unsigned int x = w;
-  while (x >= lay::wordlen) {
-    *data++ = *ps++ & *dm++;
-    if (dm == dp + ds) {
-      dm = dp;
-    }
-    x -= lay::wordlen;
-  }
-
-  if (x > 0) {
-    *data = *ps & *dm;
-  }
+  bitmap_and_pattern (data, ps, dp, ds, (w + lay::wordlen - 1) / lay::wordlen);
 }
 
 static void
@@ -417,12 +406,25 @@ static void create_precursor_bitmaps (const std::vector<lay::ViewOp> &view_ops_i
   }
 }
 
+static inline lay::color_t *
+image_scan_line (QImage *pimage, unsigned int y)
+{
+  return (lay::color_t *) pimage->scanLine (y);
+}
+
+static inline lay::color_t *
+image_scan_line (tl::PixelBuffer *pimage, unsigned int y)
+{
+  return (lay::color_t *) pimage->scan_line (y);
+}
+
+template <class Image>
 static void 
 bitmaps_to_image_rgb (const std::vector<lay::ViewOp> &view_ops_in, 
                       const std::vector<lay::Bitmap *> &pbitmaps_in,
                       const lay::DitherPattern &dp,
                       const lay::LineStyles &ls,
-                      QImage *pimage, unsigned int width, unsigned int height,
+                      Image *pimage, unsigned int width, unsigned int height,
                       bool use_bitmap_index,
                       QMutex *mutex)
 {
@@ -576,7 +578,7 @@ bitmaps_to_image_rgb (const std::vector<lay::ViewOp> &view_ops_in,
 
     if (masks.size () > 0) {
 
-      lay::color_t *pt = (lay::color_t *) pimage->scanLine (height - 1 - y);
+      lay::color_t *pt = image_scan_line (pimage, height - 1 - y);
       uint32_t *dptr_end = dptr; 
 
       unsigned int i = 0;
@@ -604,13 +606,8 @@ bitmaps_to_image_rgb (const std::vector<lay::ViewOp> &view_ops_in,
         for (int j = masks.size () - 1; j >= 0; --j) {
           uint32_t d = *dptr;
           if (d != 0) {
-            uint32_t m = 1;
-            for (unsigned int k = 0; k < 32 && x + k < width; ++k, m <<= 1) {
-              if ((d & m) != 0) { 
-                y [k] |= masks [j].first & z [k];
-                z [k] &= masks [j].second;
-              }
-            }
+            //  Hint: pixels beyond the width are computed too, but not transferred
+            bitmap_expand_colors (y, z, d, masks [j].first, masks [j].second);
           }
           dptr -= nwords;
         }
@@ -801,17 +798,16 @@ bitmaps_to_image_mono (const std::vector<lay::ViewOp> &view_ops_in,
         dptr = dptr_end - nwords + i;
         for (int j = masks.size () - 1; j >= 0; --j) {
           uint32_t d = *dptr;
+          if (x + 32 > width) {
+            d &= (uint32_t (1) << (width - x)) - 1;
+          }
           if (d != 0) {
-            uint32_t m = 1;
-            for (unsigned int k = 0; k < 32 && x + k < width; ++k, m <<= 1) {
-              if ((d & m) != 0) { 
-                if (masks [j].first & needed_bits) {
-                  y |= (z & m);
-                }
-                if (! (masks [j].second & needed_bits)) {
-                  z &= ~m;
-                }
-              }
+            //  the pixels are independent, so all 32 of them can be handled at once
+            if (masks [j].first & needed_bits) {
+              y |= (z & d);
+            }
+            if (! (masks [j].second & needed_bits)) {
+              z &= ~d;
             }
           }
           dptr -= nwords;
@@ -846,6 +842,18 @@ bitmaps_to_image (const std::vector<lay::ViewOp> &view_ops_in,
   }
 }
 
+void 
+bitmaps_to_image (const std::vector<lay::ViewOp> &view_ops_in, 
+                  const std::vector<lay::Bitmap *> &pbitmaps_in,
+                  const lay::DitherPattern &dp, 
+                  const lay::LineStyles &ls,
+                  tl::PixelBuffer *pimage, unsigned int width, unsigned int height,
+                  bool use_bitmap_index,
+                  QMutex *mutex)
+{
+  bitmaps_to_image_rgb (view_ops_in, pbitmaps_in, dp, ls, pimage, width, height, use_bitmap_index, mutex);
+}
+
 void
 bitmap_to_bitmap (const lay::ViewOp &view_op, const lay::Bitmap &bitmap,
                   unsigned char *data,
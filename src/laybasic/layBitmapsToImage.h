@@ -31,6 +31,11 @@
 class QMutex;
 class QImage;
 
+namespace tl
+{
+  class PixelBuffer;
+}
+
 namespace lay
 {
 
@@ -62,6 +67,22 @@ bitmaps_to_image (const std::vector <lay::ViewOp> &view_ops,
                   bool use_bitmap_index,
                   QMutex *mutex);
 
+/**
+ *  @brief This function converts the given set of bitmaps to a tl::PixelBuffer
+ *
+ *  This version is identical to the QImage version, but renders into a
+ *  pixel buffer which does not require a GUI toolkit. The pixel buffer must
+ *  be initialized to the given width and height.
+ */
+LAYBASIC_PUBLIC void
+bitmaps_to_image (const std::vector <lay::ViewOp> &view_ops, 
+                  const std::vector <lay::Bitmap *> &pbitmaps,
+                  const lay::DitherPattern &dp, 
+                  const lay::LineStyles &ls,
+                  tl::PixelBuffer *pimage, unsigned int width, unsigned int height,
+                  bool use_bitmap_index,
+                  QMutex *mutex);
+
 /**
  *  @brief Convert a lay::Bitmap to a unsigned char * data field to be passed to QBitmap
  *
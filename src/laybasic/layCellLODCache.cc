@@ -0,0 +1,571 @@
+
+/*
+
+  KLayout Layout Viewer
+  Copyright (C) 2006-2017 Matthias Koefferlein
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+
+
+#include "layCellLODCache.h"
+#include "layBitmap.h"
+#include "layBitmapRenderer.h"
+#include "dbShapes.h"
+#include "tlLog.h"
+#include "tlTimer.h"
+
+#include <math.h>
+#include <algorithm>
+
+namespace lay
+{
+
+// -------------------------------------------------------------
+//  CellLOD implementation
+
+const unsigned int CellLOD::base_size;
+
+CellLOD::CellLOD (const db::Box &bbox)
+  : m_bbox (bbox)
+{
+  //  the scale is chosen such that the longer side of the box spans base_size pixels
+  double bw = bbox.width (), bh = bbox.height ();
+  double s = 1.0;
+  if (bw > 0.0 || bh > 0.0) {
+    s = double (base_size - 1) / std::max (bw, bh);
+  }
+
+  unsigned int w = std::min (base_size, (unsigned int) (floor (bw * s + 0.5)) + 1);
+  unsigned int h = std::min (base_size, (unsigned int) (floor (bh * s + 0.5)) + 1);
+
+  m_raster_trans = db::CplxTrans (s, 0.0, false, db::DVector (-bbox.left () * s, -bbox.bottom () * s));
+
+  unsigned int offset = 0;
+  while (true) {
+    m_dims.push_back (std::make_pair (w, h));
+    m_offsets.push_back (offset);
+    offset += h;
+    if (w == 1 && h == 1) {
+      break;
+    }
+    w = (w + 1) / 2;
+    h = (h + 1) / 2;
+  }
+
+  for (unsigned int p = 0; p < (unsigned int) Planes; ++p) {
+    m_data [p].resize (offset, 0);
+  }
+}
+
+/**
+ *  @brief OR-combines adjacent pairs of bits: bit i of the result is bit 2*i | bit 2*i+1 of the input
+ */
+static inline uint32_t
+reduce_bits (uint32_t w)
+{
+  uint32_t r = 0;
+  for (unsigned int i = 0; w != 0; ++i, w >>= 2) {
+    if ((w & 3) != 0) {
+      r |= (uint32_t (1) << i);
+    }
+  }
+  return r;
+}
+
+void
+CellLOD::set_base (const lay::Bitmap *fill, const lay::Bitmap *frame, const lay::Bitmap *vertex)
+{
+  const lay::Bitmap *bitmaps [] = { fill, frame, vertex };
+
+  for (unsigned int p = 0; p < (unsigned int) Planes; ++p) {
+
+    std::vector<uint32_t> &data = m_data [p];
+
+    const lay::Bitmap *bm = bitmaps [p];
+    for (unsigned int y = 0; y < height (0); ++y) {
+      data [y] = (bm && ! bm->is_scanline_empty (y)) ? bm->scanline (y) [0] : 0;
+    }
+
+    for (unsigned int l = 1; l < levels (); ++l) {
+      const uint32_t *from = &data [m_offsets [l - 1]];
+      uint32_t *to = &data [m_offsets [l]];
+      unsigned int hf = height (l - 1);
+      for (unsigned int y = 0; y < height (l); ++y) {
+        uint32_t w = from [y * 2];
+        if (y * 2 + 1 < hf) {
+          w |= from [y * 2 + 1];
+        }
+        to [y] = reduce_bits (w);
+      }
+    }
+
+  }
+}
+
+void
+CellLOD::blit (const db::CplxTrans &trans, lay::Bitmap *fill, lay::Bitmap *frame, lay::Bitmap *vertex) const
+{
+  lay::Bitmap *bitmaps [] = { fill, frame, vertex };
+
+  const lay::Bitmap *any = fill ? fill : (frame ? frame : vertex);
+  if (! any) {
+    return;
+  }
+
+  db::DBox tb = trans * m_bbox;
+
+  int x1 = int (ceil (tb.left () - 1e-6));
+  int x2 = int (floor (tb.right () + 1e-6));
+  int y1 = int (ceil (tb.bottom () - 1e-6));
+  int y2 = int (floor (tb.top () + 1e-6));
+
+  if (x1 > x2 || y1 > y2) {
+
+    //  the footprint does not cover a pixel center: draw a single dot like the renderer does for small boxes
+    db::DPoint c = tb.center ();
+    int x = int (floor (c.x () + 0.5)), y = int (floor (c.y () + 0.5));
+    if (x >= 0 && x < int (any->width ()) && y >= 0 && y < int (any->height ())) {
+      if (frame) {
+        frame->fill ((unsigned int) y, (unsigned int) x, (unsigned int) x + 1);
+      }
+      if (vertex) {
+        vertex->fill ((unsigned int) y, (unsigned int) x, (unsigned int) x + 1);
+      }
+    }
+    return;
+
+  }
+
+  x1 = std::max (x1, 0);
+  y1 = std::max (y1, 0);
+  x2 = std::min (x2, int (any->width ()) - 1);
+  y2 = std::min (y2, int (any->height ()) - 1);
+  if (x1 > x2 || y1 > y2) {
+    return;
+  }
+
+  //  select the level: one pixel of the level must not be smaller than one target pixel
+  double k = m_raster_trans.mag () / trans.mag ();
+  unsigned int level = 0;
+  while (level + 1 < levels () && double (1 << level) < k - 1e-6) {
+    ++level;
+  }
+
+  int lw = int (width (level)), lh = int (height (level));
+  double ls = 1.0 / double (1 << level);
+
+  //  target pixel -> base raster pixel
+  db::DCplxTrans ti = db::DCplxTrans (m_raster_trans) * db::DCplxTrans (trans).inverted ();
+
+  //  a slightly shrunk pixel avoids picking neighbours because of rounding
+  const double eps = 1e-3;
+
+  for (int y = y1; y <= y2; ++y) {
+
+    int run_start [Planes] = { -1, -1, -1 };
+
+    for (int x = x1; x <= x2 + 1; ++x) {
+
+      bool set [Planes] = { false, false, false };
+
+      if (x <= x2) {
+
+        //  a pixel of the level is set in the target if it overlaps the target pixel: this way, no
+        //  set pixel gets lost. Since a level pixel is not smaller than a target pixel, these are
+        //  two pixels at most in each direction.
+        db::DBox bp = ti * db::DBox (x - 0.5 + eps, y - 0.5 + eps, x + 0.5 - eps, y + 0.5 - eps);
+
+        int ix1 = std::max (0, int (floor ((bp.left () + 0.5) * ls)));
+        int ix2 = std::min (lw - 1, int (floor ((bp.right () + 0.5) * ls)));
+        int iy1 = std::max (0, int (floor ((bp.bottom () + 0.5) * ls)));
+        int iy2 = std::min (lh - 1, int (floor ((bp.top () + 0.5) * ls)));
+
+        if (ix1 <= ix2 && iy1 <= iy2) {
+          uint32_t mask = ((uint32_t (2) << ix2) - 1) & ~((uint32_t (1) << ix1) - 1);
+          for (unsigned int p = 0; p < (unsigned int) Planes; ++p) {
+            for (int iy = iy1; iy <= iy2 && ! set [p]; ++iy) {
+              set [p] = (row (plane_type (p), level, (unsigned int) iy) & mask) != 0;
+            }
+          }
+        }
+
+      }
+
+      //  collect runs of set pixels and draw them as spans
+      for (unsigned int p = 0; p < (unsigned int) Planes; ++p) {
+        if (set [p]) {
+          if (run_start [p] < 0) {
+            run_start [p] = x;
+          }
+        } else if (run_start [p] >= 0) {
+          if (bitmaps [p]) {
+            bitmaps [p]->fill ((unsigned int) y, (unsigned int) run_start [p], (unsigned int) x);
+          }
+          run_start [p] = -1;
+        }
+      }
+
+    }
+
+  }
+}
+
+size_t
+CellLOD::memory () const
+{
+  size_t mem = sizeof (*this);
+  for (unsigned int p = 0; p < (unsigned int) Planes; ++p) {
+    mem += m_data [p].capacity () * sizeof (uint32_t);
+  }
+  mem += m_dims.capacity () * sizeof (m_dims [0]) + m_offsets.capacity () * sizeof (m_offsets [0]);
+  return mem;
+}
+
+// -------------------------------------------------------------
+//  The background builder
+
+namespace
+{
+
+class CellLODBuildTask
+  : public tl::Task
+{
+public:
+  CellLODBuildTask (unsigned int layer)
+    : m_layer (layer)
+  {
+    //  .. nothing yet ..
+  }
+
+  unsigned int layer () const
+  {
+    return m_layer;
+  }
+
+private:
+  unsigned int m_layer;
+};
+
+}
+
+class CellLODBuilder
+  : public tl::JobBase
+{
+public:
+  CellLODBuilder (CellLODCache *cache, const db::Layout *layout)
+    : tl::JobBase (1), mp_cache (cache), mp_layout (layout)
+  {
+    //  .. nothing yet ..
+  }
+
+  CellLODCache *cache () const
+  {
+    return mp_cache;
+  }
+
+  const db::Layout *layout () const
+  {
+    return mp_layout;
+  }
+
+  virtual tl::Worker *create_worker ();
+
+private:
+  CellLODCache *mp_cache;
+  const db::Layout *mp_layout;
+};
+
+namespace
+{
+
+class CellLODBuildWorker
+  : public tl::Worker
+{
+public:
+  CellLODBuildWorker (CellLODBuilder *builder)
+    : tl::Worker (), mp_builder (builder)
+  {
+    //  .. nothing yet ..
+  }
+
+  void perform_task (tl::Task *task)
+  {
+    CellLODBuildTask *build_task = dynamic_cast <CellLODBuildTask *> (task);
+    if (! build_task) {
+      return;
+    }
+
+    const db::Layout *layout = mp_builder->layout ();
+    CellLODCache *cache = mp_builder->cache ();
+    unsigned int layer = build_task->layer ();
+
+    tl::SelfTimer timer (tl::verbosity () >= 41, tl::sprintf ("Building LOD rasters for layer %d", layer));
+
+    //  children first, so the rasters of the child cells are available when the parents are built
+    for (db::Layout::bottom_up_const_iterator c = layout->begin_bottom_up (); c != layout->end_bottom_up (); ++c) {
+
+      checkpoint ();
+
+      const db::Cell &cell = layout->cell (*c);
+      if (! cell.is_top () && ! cell.bbox (layer).empty ()) {
+        if (! cache->lod (*c, layer) && (! cache->is_valid () || cache->memory () > cache->memory_limit ())) {
+          break;
+        }
+      }
+
+    }
+  }
+
+private:
+  CellLODBuilder *mp_builder;
+};
+
+}
+
+tl::Worker *
+CellLODBuilder::create_worker ()
+{
+  return new CellLODBuildWorker (this);
+}
+
+// -------------------------------------------------------------
+//  CellLODCache implementation
+
+CellLODCache::CellLODCache (db::Layout *layout)
+  : mp_layout (layout), m_valid (0), m_memory (0), m_memory_limit (64 * 1024 * 1024), m_generation (0), m_build_generation (0)
+{
+  //  these events are issued before the layout is modified, so the builder is stopped before it could see the change
+  layout->hier_changed_event.add (this, &CellLODCache::invalidate);
+  layout->bboxes_changed_any_event.add (this, &CellLODCache::invalidate);
+}
+
+CellLODCache::~CellLODCache ()
+{
+  m_valid.fetchAndStoreOrdered (0);
+  if (mp_builder.get ()) {
+    mp_builder->terminate ();
+  }
+  mp_builder.reset (0);
+
+  collect_garbage ();
+  for (lod_map_t::iterator l = m_lods.begin (); l != m_lods.end (); ++l) {
+    delete l->second;
+  }
+  m_lods.clear ();
+}
+
+void
+CellLODCache::stop_build ()
+{
+  if (mp_builder.get ()) {
+    mp_builder->stop ();
+  }
+}
+
+void
+CellLODCache::invalidate ()
+{
+  //  clearing the flag first makes builds in progress terminate early
+  m_valid.fetchAndStoreOrdered (0);
+
+  stop_build ();
+
+  QMutexLocker locker (&m_lock);
+
+  //  Other threads (i.e. redraw workers) may still use the rasters until they are stopped.
+  //  Hence they are deleted later.
+  for (lod_map_t::iterator l = m_lods.begin (); l != m_lods.end (); ++l) {
+    m_garbage.push_back (l->second);
+  }
+  m_lods.clear ();
+  m_memory = 0;
+  ++m_generation;
+}
+
+void
+CellLODCache::collect_garbage ()
+{
+  QMutexLocker locker (&m_lock);
+
+  for (std::vector<CellLOD *>::iterator g = m_garbage.begin (); g != m_garbage.end (); ++g) {
+    delete *g;
+  }
+  m_garbage.clear ();
+}
+
+void
+CellLODCache::start_build ()
+{
+  if (mp_layout->under_construction () || mp_layout->hier_dirty () || mp_layout->bboxes_dirty ()) {
+    return;
+  }
+
+  if (is_valid () && m_build_generation == m_generation) {
+    //  already built or building
+    return;
+  }
+
+  //  Since every invalidation stops the builder and the redraw threads,
+  //  nobody refers to the discarded rasters any longer.
+  stop_build ();
+  collect_garbage ();
+
+  m_build_generation = m_generation;
+  m_valid.fetchAndStoreOrdered (1);
+
+  if (! mp_builder.get ()) {
+    mp_builder.reset (new CellLODBuilder (this, mp_layout));
+  }
+
+  for (db::Layout::layer_iterator l = mp_layout->begin_layers (); l != mp_layout->end_layers (); ++l) {
+    mp_builder->schedule (new CellLODBuildTask ((*l).first));
+  }
+
+  mp_builder->start ();
+}
+
+const CellLOD *
+CellLODCache::lod (db::cell_index_type ci, unsigned int layer, bool build)
+{
+  unsigned int generation = 0;
+
+  {
+    QMutexLocker locker (&m_lock);
+
+    if (! is_valid ()) {
+      return 0;
+    }
+
+    lod_map_t::const_iterator l = m_lods.find (std::make_pair (ci, layer));
+    if (l != m_lods.end ()) {
+      return l->second;
+    }
+
+    if (! build || m_memory > m_memory_limit) {
+      return 0;
+    }
+
+    generation = m_generation;
+  }
+
+  return build_lod (ci, layer, generation);
+}
+
+CellLOD *
+CellLODCache::build_lod (db::cell_index_type ci, unsigned int layer, unsigned int generation)
+{
+  const db::Cell &cell = mp_layout->cell (ci);
+
+  db::Box bbox = cell.bbox (layer);
+  if (bbox.empty ()) {
+    return 0;
+  }
+
+  std::auto_ptr<CellLOD> new_lod (new CellLOD (bbox));
+
+  unsigned int w = new_lod->width (0), h = new_lod->height (0);
+  const db::CplxTrans &rt = new_lod->raster_trans ();
+
+  lay::Bitmap fill (w, h, 1.0), frame (w, h, 1.0), vertex (w, h, 1.0);
+  lay::BitmapRenderer r (w, h, 1.0);
+
+  //  draw the shapes of this cell
+  size_t n = 0;
+  for (db::ShapeIterator shape = cell.shapes (layer).begin (db::ShapeIterator::Boxes | db::ShapeIterator::Polygons | db::ShapeIterator::Edges | db::ShapeIterator::Paths); ! shape.at_end (); ++shape) {
+    if (++n % 1000 == 0 && ! is_valid ()) {
+      return 0;
+    }
+    r.draw (*shape, rt, &fill, &frame, &vertex, 0);
+  }
+
+  //  draw the child cells from their rasters
+  db::box_convert <db::CellInst> bc (*mp_layout, layer);
+
+  for (db::Cell::const_iterator inst = cell.begin (); ! inst.at_end (); ++inst) {
+
+    if (! is_valid ()) {
+      return 0;
+    }
+
+    const db::CellInstArray &cell_inst = inst->cell_inst ();
+
+    db::cell_index_type child_ci = cell_inst.object ().cell_index ();
+    db::Box child_box = mp_layout->cell (child_ci).bbox (layer);
+    if (child_box.empty ()) {
+      continue;
+    }
+
+    //  dense arrays of small instances are drawn as a box (like the redraw thread does)
+    db::Vector a, b;
+    unsigned long amax = 0, bmax = 0;
+    if (cell_inst.is_regular_array (a, b, amax, bmax)) {
+
+      db::DBox inst_box;
+      if (cell_inst.is_complex ()) {
+        inst_box = rt * (cell_inst.complex_trans () * child_box);
+      } else {
+        inst_box = rt * child_box;
+      }
+
+      if (((a.x () == 0 && b.y () == 0) || (a.y () == 0 && b.x () == 0)) &&
+          inst_box.width () < 1.5 && inst_box.height () < 1.5 &&
+          (amax <= 1 || rt.ctrans (a.length ()) < 1.5) &&
+          (bmax <= 1 || rt.ctrans (b.length ()) < 1.5)) {
+        db::Box array_box = cell_inst.bbox (bc);
+        r.draw (array_box, rt, &frame, &frame, 0, 0);
+        r.draw (array_box, rt, &vertex, &vertex, 0, 0);
+        continue;
+      }
+
+    }
+
+    const CellLOD *child_lod = lod (child_ci, layer, true);
+    if (! child_lod) {
+      //  invalidated or out of memory
+      return 0;
+    }
+
+    for (db::CellInstArray::iterator p = cell_inst.begin (); ! p.at_end (); ++p) {
+      child_lod->blit (rt * cell_inst.complex_trans (*p), &fill, &frame, &vertex);
+    }
+
+  }
+
+  new_lod->set_base (&fill, &frame, &vertex);
+
+  QMutexLocker locker (&m_lock);
+
+  if (! is_valid () || generation != m_generation) {
+    //  the layout has changed in the meantime
+    return 0;
+  }
+
+  //  another thread may have built the same raster in the meantime
+  lod_map_t::const_iterator l = m_lods.find (std::make_pair (ci, layer));
+  if (l != m_lods.end ()) {
+    return l->second;
+  }
+
+  m_memory += new_lod->memory ();
+  CellLOD *res = new_lod.release ();
+  m_lods.insert (std::make_pair (std::make_pair (ci, layer), res));
+  return res;
+}
+
+}
+
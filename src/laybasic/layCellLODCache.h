@@ -0,0 +1,278 @@
+
+/*
+
+  KLayout Layout Viewer
+  Copyright (C) 2006-2017 Matthias Koefferlein
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+
+
+#ifndef HDR_layCellLODCache
+#define HDR_layCellLODCache
+
+#include "laybasicCommon.h"
+
+#include "dbLayout.h"
+#include "dbTrans.h"
+#include "dbBox.h"
+#include "tlObject.h"
+#include "tlThreadedWorkers.h"
+
+#include <QMutex>
+#include <QAtomicInt>
+
+#include <map>
+#include <vector>
+#include <memory>
+#include <stdint.h>
+
+namespace lay
+{
+
+class Bitmap;
+
+/**
+ *  @brief A level-of-detail summary raster of one cell on one layer
+ *
+ *  This object holds a coverage pyramid for the cell's layer bounding box:
+ *  level 0 is a raster of at most base_size x base_size pixels, each further
+ *  level halves the resolution by OR-combining 2x2 pixels of the previous
+ *  level. For every level, there are three planes: the fill, the frame and the
+ *  vertex plane, corresponding to the planes the renderer draws into.
+ *  A pixel is set, if the renderer would set any pixel of the corresponding area
+ *  when drawing the cell (including its child cells) at base resolution.
+ */
+class LAYBASIC_PUBLIC CellLOD
+{
+public:
+  /**
+   *  @brief The maximum width and height of the base level raster
+   *
+   *  One row of the raster is stored in one 32 bit word, hence this value must not be larger than 32.
+   */
+  static const unsigned int base_size = 32;
+
+  /**
+   *  @brief The planes of a level
+   */
+  enum plane_type { Fill = 0, Frame = 1, Vertex = 2, Planes = 3 };
+
+  /**
+   *  @brief Creates an empty LOD raster for the given box
+   */
+  CellLOD (const db::Box &bbox);
+
+  /**
+   *  @brief Gets the box the raster covers
+   */
+  const db::Box &bbox () const
+  {
+    return m_bbox;
+  }
+
+  /**
+   *  @brief Gets the transformation from database units to base level pixels
+   *
+   *  Pixel centers are located at integer coordinates.
+   */
+  const db::CplxTrans &raster_trans () const
+  {
+    return m_raster_trans;
+  }
+
+  /**
+   *  @brief Gets the number of levels
+   */
+  unsigned int levels () const
+  {
+    return (unsigned int) m_dims.size ();
+  }
+
+  /**
+   *  @brief Gets the width of the given level in pixels
+   */
+  unsigned int width (unsigned int level) const
+  {
+    return m_dims [level].first;
+  }
+
+  /**
+   *  @brief Gets the height of the given level in pixels
+   */
+  unsigned int height (unsigned int level) const
+  {
+    return m_dims [level].second;
+  }
+
+  /**
+   *  @brief Gets a row of the given plane and level
+   *
+   *  Bit x of the word corresponds to pixel x of row y.
+   */
+  uint32_t row (plane_type p, unsigned int level, unsigned int y) const
+  {
+    return m_data [p][m_offsets [level] + y];
+  }
+
+  /**
+   *  @brief Sets the base level from the given bitmaps
+   *
+   *  The bitmaps must have the size of the base level. Null pointers are taken as empty bitmaps.
+   *  This method will also compute the reduced levels.
+   */
+  void set_base (const lay::Bitmap *fill, const lay::Bitmap *frame, const lay::Bitmap *vertex);
+
+  /**
+   *  @brief Draws the LOD raster into the given bitmaps
+   *
+   *  "trans" is the transformation from database units to target pixels. The level is
+   *  chosen such that one pixel of the level is not smaller than one target pixel, so
+   *  no set pixel of the level is lost. If the footprint does not cover any pixel center,
+   *  a single pixel is drawn on the frame and vertex planes.
+   *  Null pointers for the bitmaps are allowed.
+   */
+  void blit (const db::CplxTrans &trans, lay::Bitmap *fill, lay::Bitmap *frame, lay::Bitmap *vertex) const;
+
+  /**
+   *  @brief Gets the memory used by this object in bytes (approximately)
+   */
+  size_t memory () const;
+
+private:
+  db::Box m_bbox;
+  db::CplxTrans m_raster_trans;
+  std::vector<std::pair<unsigned int, unsigned int> > m_dims;
+  std::vector<unsigned int> m_offsets;
+  std::vector<uint32_t> m_data [Planes];
+};
+
+class CellLODBuilder;
+
+/**
+ *  @brief A persistent cache of level-of-detail rasters for the cells of a layout
+ *
+ *  The cache provides CellLOD objects for a cell and a layer. The rasters are built on
+ *  demand or in the background (see start_build). Building a raster requires the
+ *  rasters of the child cells, so they are built bottom-up.
+ *
+ *  The cache attaches to the layout's change events and is invalidated as soon as
+ *  the hierarchy or the shapes change. After an invalidation, the cache does not deliver
+ *  any rasters until "start_build" is called again for the updated layout.
+ *  Rasters delivered by "lod" stay valid until the next call of "start_build"
+ *  following an invalidation.
+ *
+ *  The cache is thread safe: "lod" may be called from multiple threads at the same time.
+ */
+class LAYBASIC_PUBLIC CellLODCache
+  : public tl::Object
+{
+public:
+  /**
+   *  @brief Creates a cache for the given layout
+   */
+  CellLODCache (db::Layout *layout);
+
+  /**
+   *  @brief Destructor
+   */
+  ~CellLODCache ();
+
+  /**
+   *  @brief Gets the LOD raster for the given cell and layer
+   *
+   *  If "build" is true, the raster is built if it is not present yet.
+   *  Returns 0 if the cache is not valid currently, the cell is empty on this layer,
+   *  or the memory limit is exceeded.
+   */
+  const CellLOD *lod (db::cell_index_type ci, unsigned int layer, bool build = true);
+
+  /**
+   *  @brief Validates the cache and starts building the rasters in the background
+   *
+   *  This method must be called from the main thread when the layout is in a consistent state
+   *  (i.e. after db::Layout::update). It does nothing if the layout is not.
+   *  The rasters are built for all cells which are not top cells.
+   */
+  void start_build ();
+
+  /**
+   *  @brief Stops the background build
+   */
+  void stop_build ();
+
+  /**
+   *  @brief Invalidates the cache
+   *
+   *  This method is called when the layout changes.
+   */
+  void invalidate ();
+
+  /**
+   *  @brief Gets a value indicating whether the cache delivers rasters
+   */
+  bool is_valid () const
+  {
+    return m_valid.fetchAndAddAcquire (0) != 0;
+  }
+
+  /**
+   *  @brief Sets the memory limit in bytes
+   *
+   *  No more rasters are built once the memory used exceeds this limit.
+   */
+  void set_memory_limit (size_t limit)
+  {
+    m_memory_limit = limit;
+  }
+
+  /**
+   *  @brief Gets the memory limit
+   */
+  size_t memory_limit () const
+  {
+    return m_memory_limit;
+  }
+
+  /**
+   *  @brief Gets the memory currently used by the rasters
+   */
+  size_t memory () const
+  {
+    return m_memory;
+  }
+
+private:
+  typedef std::map<std::pair<db::cell_index_type, unsigned int>, CellLOD *> lod_map_t;
+
+  const db::Layout *mp_layout;
+  lod_map_t m_lods;
+  std::vector<CellLOD *> m_garbage;
+  QMutex m_lock;
+  mutable QAtomicInt m_valid;
+  size_t m_memory, m_memory_limit;
+  unsigned int m_generation, m_build_generation;
+  std::auto_ptr<CellLODBuilder> mp_builder;
+
+  CellLOD *build_lod (db::cell_index_type ci, unsigned int layer, unsigned int generation);
+  void collect_garbage ();
+};
+
+}
+
+#endif
+
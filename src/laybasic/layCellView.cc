@@ -54,6 +54,7 @@ filename_for_caption (const std::string &fn)
 
 LayoutHandle::LayoutHandle (db::Layout *layout, const std::string &filename)
   : mp_layout (layout),
+    mp_lod_cache (new lay::CellLODCache (layout)),
     m_ref_count (0),
     m_filename (filename),
     m_dirty (false),
@@ -61,6 +62,9 @@ LayoutHandle::LayoutHandle (db::Layout *layout, const std::string &filename)
 {
   file_watcher ().add_file (m_filename);
 
+  //  record the regions of changes, so the views can redraw these regions only
+  mp_layout->set_record_changes (true);
+
   if (! m_filename.empty ()) {
     rename (filename_for_caption (m_filename));
   } else {
@@ -95,6 +99,10 @@ LayoutHandle::~LayoutHandle ()
     tl::info << "Deleted layout " << name ();
   }
 
+  //  the cache's background builder needs to be stopped before the layout goes away
+  delete mp_lod_cache;
+  mp_lod_cache = 0;
+
   delete mp_layout;
   mp_layout = 0;
 
@@ -273,6 +281,9 @@ LayoutHandle::save_as (const std::string &fn, tl::OutputStream::OutputStreamMode
   try {
 
     {
+      //  The file may be the source of lazy cells - these need to be loaded before the file is overwritten
+      mp_layout->load_lazy_cells (fn);
+
       //  The write needs to be finished before the file watcher gets the new modification time
       db::Writer writer (options);
       tl::OutputStream stream (fn, om);
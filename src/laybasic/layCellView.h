@@ -32,6 +32,7 @@
 #include "tlObject.h"
 #include "tlFileSystemWatcher.h"
 #include "layTechnology.h"
+#include "layCellLODCache.h"
 #include "dbLayout.h"
 #include "dbMetaInfo.h"
 #include "dbReader.h"
@@ -95,6 +96,16 @@ public:
    */
   db::Layout &layout () const;
 
+  /**
+   *  @brief Gets the level-of-detail raster cache for the layout
+   *
+   *  The cache is used by the redraw thread to draw cells which are small on the screen.
+   */
+  lay::CellLODCache &lod_cache () const
+  {
+    return *mp_lod_cache;
+  }
+
   /**
    *  @brief Sets the file name associated with this handle
    */
@@ -288,6 +299,7 @@ public:
 
 private:
   db::Layout *mp_layout;
+  lay::CellLODCache *mp_lod_cache;
   int m_ref_count;
   std::string m_name;
   std::string m_filename;
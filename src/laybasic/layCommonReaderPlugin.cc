@@ -107,7 +107,8 @@ public:
       tl::make_member (&db::CommonReaderOptions::create_other_layers, "create-other-layers") +
       tl::make_member (&db::CommonReaderOptions::layer_map, "layer-map") +
       tl::make_member (&db::CommonReaderOptions::enable_properties, "enable-properties") +
-      tl::make_member (&db::CommonReaderOptions::enable_text_objects, "enable-text-objects")
+      tl::make_member (&db::CommonReaderOptions::enable_text_objects, "enable-text-objects") +
+      tl::make_member (&db::CommonReaderOptions::lazy_loading, "lazy-loading")
     );
   }
 };
@@ -164,6 +165,16 @@ static void set_properties_enabled (db::LoadLayoutOptions *options, bool l)
   options->get_options<db::CommonReaderOptions> ().enable_properties = l;
 }
 
+static bool get_lazy_loading (const db::LoadLayoutOptions *options)
+{
+  return options->get_options<db::CommonReaderOptions> ().lazy_loading;
+}
+
+static void set_lazy_loading (db::LoadLayoutOptions *options, bool l)
+{
+  options->get_options<db::CommonReaderOptions> ().lazy_loading = l;
+}
+
 //  extend lay::LoadLayoutOptions with the Common options 
 static
 gsi::ClassExt<db::LoadLayoutOptions> common_reader_options (
@@ -226,6 +237,26 @@ gsi::ClassExt<db::LoadLayoutOptions> common_reader_options (
     "@param enabled True, if properties should be read."
     "\n"
     "Starting with version 0.25 this option only applies to GDS2 and OASIS format. Other formats provide their own configuration."
+  ) +
+  gsi::method_ext ("lazy_loading?", &get_lazy_loading,
+    "@brief Gets a value indicating whether the shapes of the cells are loaded on demand\n"
+    "See \\lazy_loading= for details.\n"
+    "\n"
+    "This method has been introduced in version 0.25."
+  ) +
+  gsi::method_ext ("lazy_loading=", &set_lazy_loading, gsi::arg ("enabled"),
+    "@brief Specifies whether the shapes of the cells shall be loaded on demand\n"
+    "@param enabled True, if the shapes should be loaded on demand.\n"
+    "\n"
+    "In lazy loading mode, the reader keeps the cell hierarchy and the bounding boxes only. "
+    "The shapes of a cell are read from the file when they are accessed for the first time. "
+    "Hence the memory required grows with the number of cells visited. The file must not be "
+    "changed or removed while the layout is in use.\n"
+    "\n"
+    "Lazy loading is available for uncompressed GDS2 files. In all other cases, the "
+    "shapes are read directly.\n"
+    "\n"
+    "This method has been introduced in version 0.25."
   ),
   ""
 );
@@ -278,6 +278,16 @@ static double get_gds2_user_units (const db::SaveLayoutOptions *options)
   return options->get_options<db::GDS2WriterOptions> ().user_units;
 }
 
+static void set_gds2_write_threads (db::SaveLayoutOptions *options, unsigned int n)
+{
+  options->get_options<db::GDS2WriterOptions> ().threads = n;
+}
+
+static unsigned int get_gds2_write_threads (const db::SaveLayoutOptions *options)
+{
+  return options->get_options<db::GDS2WriterOptions> ().threads;
+}
+
 //  extend lay::SaveLayoutOptions with the GDS2 options 
 static
 gsi::ClassExt<db::SaveLayoutOptions> gds2_writer_options (
@@ -296,6 +306,22 @@ gsi::ClassExt<db::SaveLayoutOptions> gds2_writer_options (
     "See \\gds2_max_vertex_count= method for a description of the maximum vertex count."
     "\nThis property has been added in version 0.18.\n"
   ) +
+  gsi::method_ext ("gds2_write_threads=", &set_gds2_write_threads,
+    "@brief Sets the number of threads used for encoding the cells\n"
+    "@args n\n"
+    "If this value is non-zero, the cells are encoded into memory by the given number of threads "
+    "and written in the original order. The resulting file is the same as without threads. "
+    "A value of 0 (the default) means that the cells are written by the writing thread. "
+    "This setting is not effective for the GDS2 text format.\n"
+    "\n"
+    "This method has been introduced in version 0.25."
+  ) +
+  gsi::method_ext ("gds2_write_threads", &get_gds2_write_threads,
+    "@brief Gets the number of threads used for encoding the cells\n"
+    "See \\gds2_write_threads= method for a description of this property."
+    "\n"
+    "This method has been introduced in version 0.25."
+  ) +
   gsi::method_ext ("gds2_multi_xy_records=", &set_gds2_multi_xy_records,
     "@brief Use multiple XY records in BOUNDARY elements for unlimited large polygons\n"
     "@args flag\n"
@@ -0,0 +1,553 @@
+
+/*
+
+  KLayout Layout Viewer
+  Copyright (C) 2006-2017 Matthias Koefferlein
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+
+
+#include "layHeadlessRenderer.h"
+#include "layCellLODCache.h"
+#include "layBitmap.h"
+#include "layBitmapRenderer.h"
+#include "layBitmapsToImage.h"
+#include "layColorPalette.h"
+#include "layStipplePalette.h"
+#include "layViewport.h"
+#include "dbLayout.h"
+#include "tlPixelBuffer.h"
+#include "tlThreadedWorkers.h"
+#include "tlStream.h"
+#include "tlTimer.h"
+#include "tlLog.h"
+#include "tlInternational.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace lay
+{
+
+// -------------------------------------------------------------
+//  The multi-threaded snapshot job
+
+namespace
+{
+
+class HeadlessRenderTask
+  : public tl::Task
+{
+public:
+  HeadlessRenderTask (const lay::HeadlessSnapshot *snapshot)
+    : mp_snapshot (snapshot)
+  {
+    //  .. nothing yet ..
+  }
+
+  const lay::HeadlessSnapshot &snapshot () const
+  {
+    return *mp_snapshot;
+  }
+
+private:
+  const lay::HeadlessSnapshot *mp_snapshot;
+};
+
+class HeadlessRenderJob
+  : public tl::JobBase
+{
+public:
+  HeadlessRenderJob (int nworkers, const lay::HeadlessRenderer *renderer)
+    : tl::JobBase (nworkers), mp_renderer (renderer)
+  {
+    //  .. nothing yet ..
+  }
+
+  const lay::HeadlessRenderer *renderer () const
+  {
+    return mp_renderer;
+  }
+
+  virtual tl::Worker *create_worker ();
+
+private:
+  const lay::HeadlessRenderer *mp_renderer;
+};
+
+class HeadlessRenderWorker
+  : public tl::Worker
+{
+public:
+  HeadlessRenderWorker (HeadlessRenderJob *job)
+    : tl::Worker (), mp_job (job)
+  {
+    //  .. nothing yet ..
+  }
+
+  void perform_task (tl::Task *task)
+  {
+    HeadlessRenderTask *render_task = dynamic_cast <HeadlessRenderTask *> (task);
+    if (render_task) {
+      checkpoint ();
+      mp_job->renderer ()->render (render_task->snapshot ());
+    }
+  }
+
+private:
+  HeadlessRenderJob *mp_job;
+};
+
+tl::Worker *
+HeadlessRenderJob::create_worker ()
+{
+  return new HeadlessRenderWorker (this);
+}
+
+}
+
+// -------------------------------------------------------------
+//  HeadlessRenderer implementation
+
+HeadlessRenderer::HeadlessRenderer (db::Layout &layout, db::cell_index_type top_cell)
+  : mp_layout (&layout), m_top_cell (top_cell),
+    m_background (0xffffffff), m_text_visible (true), m_default_text_size (0.1),
+    m_max_hier_levels (std::numeric_limits<int>::max ()), m_use_lod (true), m_threads (1)
+{
+  set_default_layer_properties ();
+}
+
+HeadlessRenderer::~HeadlessRenderer ()
+{
+  //  .. nothing yet ..
+}
+
+void
+HeadlessRenderer::set_layer_properties (const lay::LayerPropertiesList &props)
+{
+  m_props = props;
+}
+
+void
+HeadlessRenderer::set_default_layer_properties ()
+{
+  std::vector<std::pair<db::LayerProperties, unsigned int> > layers;
+  for (unsigned int i = 0; i < mp_layout->layers (); ++i) {
+    if (mp_layout->is_valid_layer (i)) {
+      layers.push_back (std::make_pair (mp_layout->get_properties (i), i));
+    }
+  }
+
+  std::sort (layers.begin (), layers.end ());
+
+  lay::ColorPalette palette = lay::ColorPalette::default_palette ();
+  lay::StipplePalette stipple_palette = lay::StipplePalette::default_palette ();
+
+  m_props = lay::LayerPropertiesList ();
+
+  for (std::vector<std::pair<db::LayerProperties, unsigned int> >::const_iterator l = layers.begin (); l != layers.end (); ++l) {
+
+    lay::LayerPropertiesNode p;
+    if (l->first.is_null ()) {
+      p.set_source (lay::ParsedLayerSource (int (l->second), -1));
+    } else {
+      p.set_source (lay::ParsedLayerSource (l->first, -1));
+    }
+
+    //  same as LayoutView::init_layer_properties
+    lay::color_t c = 0;
+    if (palette.luminous_colors () > 0) {
+      c = palette.luminous_color_by_index (p.source (true /*real*/).color_index ());
+    }
+
+    p.set_dither_pattern (stipple_palette.standard_stipple_by_index (l - layers.begin ()));
+    p.set_fill_color (c);
+    p.set_frame_color (c);
+    p.set_fill_brightness (0);
+    p.set_frame_brightness (0);
+    p.set_transparent (false);
+    p.set_visible (true);
+    p.set_width (1);
+    p.set_animation (0);
+    p.set_marked (false);
+
+    m_props.push_back (p);
+
+  }
+}
+
+void
+HeadlessRenderer::prepare ()
+{
+  mp_layout->update ();
+
+  m_layers.clear ();
+
+  bool bright_background = (((m_background >> 8) & 0xff) > 128);
+
+  unsigned int ilayer = 0;
+  for (LayerPropertiesConstIterator lp = m_props.begin_const_recursive (); ! lp.at_end (); ++lp, ++ilayer) {
+
+    const lay::LayerPropertiesNode *l = &*lp;
+    if (l->has_children () || ! l->visible (true /*real*/)) {
+      continue;
+    }
+
+    //  look up the layer: without a view, the source is not realized against the layout,
+    //  so we do the lookup here
+    const lay::ParsedLayerSource &source = l->source (true /*real*/);
+    if (source.special_purpose () != lay::ParsedLayerSource::SP_None) {
+      continue;
+    }
+
+    int layer_index = source.layer_index ();
+    if (layer_index < 0 && ! source.is_wildcard_layer ()) {
+      for (unsigned int i = 0; i < mp_layout->layers () && layer_index < 0; ++i) {
+        if (mp_layout->is_valid_layer (i) && source.match (mp_layout->get_properties (i))) {
+          layer_index = int (i);
+        }
+      }
+    }
+
+    if (layer_index < 0 || ! mp_layout->is_valid_layer ((unsigned int) layer_index)) {
+      continue;
+    }
+
+    m_layers.push_back (LayerInfo ());
+    LayerInfo &info = m_layers.back ();
+
+    info.layer = (unsigned int) layer_index;
+    info.trans = source.trans ();
+    if (info.trans.empty ()) {
+      info.trans.push_back (db::DCplxTrans ());
+    }
+
+    //  the view operands are built the same way than LayoutView::set_view_ops does for the current level planes
+
+    lay::ViewOp::Mode mode = lay::ViewOp::Copy;
+    if (l->transparent (true /*real*/)) {
+      if (bright_background) {
+        mode = lay::ViewOp::And;
+      } else {
+        mode = lay::ViewOp::Or;
+      }
+    }
+
+    lay::color_t fill_color = l->eff_fill_color (true /*real*/);
+    lay::color_t frame_color = l->eff_frame_color (true /*real*/);
+
+    int lw = l->width (true /*real*/);
+    if (lw < 0) {
+      //  default line width is 1 for leafs
+      lw = 1;
+    }
+
+    info.ops [0] = lay::ViewOp (fill_color, mode, 0, l->dither_pattern (true /*real*/), ilayer);
+    info.ops [1] = lay::ViewOp (frame_color, mode, l->line_style (true /*real*/), 0, 0, lay::ViewOp::Rect, lw);
+    if (m_text_visible) {
+      info.ops [2] = lay::ViewOp (frame_color, mode, 0, 0, 0);
+    } else {
+      info.ops [2] = lay::ViewOp (0, lay::ViewOp::Or, 0, 0, 0);
+    }
+    info.ops [3] = lay::ViewOp (frame_color, mode, 0, 0, 0, lay::ViewOp::Cross, l->marked (true /*real*/) ? 9 /*mark size*/ : 0);
+
+    //  collect the cells which need to be visited for drawing the texts
+    if (m_text_visible) {
+      const db::Layout &layout = *mp_layout;
+      info.text_cells.resize (layout.cells (), false);
+      for (db::Layout::bottom_up_const_iterator c = layout.begin_bottom_up (); c != layout.end_bottom_up (); ++c) {
+        const db::Cell &cell = layout.cell (*c);
+        //  lazy cells are not loaded here, so they are assumed to have texts
+        bool has_texts = cell.is_lazy () || ! cell.shapes (info.layer).begin (db::ShapeIterator::Texts).at_end ();
+        for (db::Cell::child_cell_iterator cc = cell.begin_child_cells (); ! cc.at_end () && ! has_texts; ++cc) {
+          has_texts = info.text_cells [*cc];
+        }
+        info.text_cells [*c] = has_texts;
+      }
+    }
+
+  }
+
+  if (m_use_lod) {
+    if (! mp_lod_cache.get ()) {
+      mp_lod_cache.reset (new lay::CellLODCache (mp_layout));
+    }
+    mp_lod_cache->start_build ();
+  } else {
+    mp_lod_cache.reset (0);
+  }
+}
+
+void
+HeadlessRenderer::render (const db::DBox &box, tl::PixelBuffer &image) const
+{
+  unsigned int width = image.width (), height = image.height ();
+
+  image.fill (m_background);
+
+  if (! mp_layout->is_valid_cell_index (m_top_cell) || m_layers.empty () || width == 0 || height == 0) {
+    return;
+  }
+
+  lay::Viewport vp (width, height, box);
+
+  lay::BitmapRenderer r (width, height, 1.0);
+  r.draw_texts (m_text_visible);
+  r.draw_properties (false);
+  r.draw_description_property (false);
+  r.default_text_size (db::Coord (m_default_text_size / mp_layout->dbu ()));
+  r.set_font (db::DefaultFont);
+  r.apply_text_trans (true);
+
+  std::vector<lay::Bitmap> bitmaps;
+  bitmaps.reserve (m_layers.size () * 4);
+
+  std::vector<lay::ViewOp> view_ops;
+  view_ops.reserve (m_layers.size () * 4);
+
+  const db::Cell &top_cell = mp_layout->cell (m_top_cell);
+
+  for (std::vector<LayerInfo>::const_iterator l = m_layers.begin (); l != m_layers.end (); ++l) {
+
+    for (unsigned int i = 0; i < 4; ++i) {
+      bitmaps.push_back (lay::Bitmap (width, height, 1.0));
+      view_ops.push_back (l->ops [i]);
+    }
+
+    lay::Bitmap *planes = &bitmaps [bitmaps.size () - 4];
+
+    for (std::vector<db::DCplxTrans>::const_iterator t = l->trans.begin (); t != l->trans.end (); ++t) {
+
+      db::CplxTrans trans = vp.trans () * *t * db::CplxTrans (mp_layout->dbu ());
+
+      //  the search region is the viewport plus one pixel of slack, clipped to the cell's bbox
+      //  to avoid problems with very large viewports
+      db::Coord lim = std::numeric_limits<db::Coord>::max ();
+      db::DBox world (trans * db::Box (db::Point (-lim, -lim), db::Point (lim, lim)));
+      db::Box region = db::Box (trans.inverted () * (world & db::DBox (-1.0, -1.0, width + 1.0, height + 1.0)));
+      region &= top_cell.bbox ();
+
+      if (! region.empty ()) {
+        draw_layer (l->layer, m_top_cell, trans, region, 0, r, &planes [0], &planes [1], &planes [3], &planes [2]);
+        if (m_text_visible) {
+          draw_text_layer (*l, m_top_cell, trans, region, 0, r, &planes [0], &planes [1], &planes [3], &planes [2]);
+        }
+      }
+
+    }
+
+  }
+
+  std::vector<lay::Bitmap *> pbitmaps;
+  pbitmaps.reserve (bitmaps.size ());
+  for (std::vector<lay::Bitmap>::iterator b = bitmaps.begin (); b != bitmaps.end (); ++b) {
+    pbitmaps.push_back (b.operator-> ());
+  }
+
+  lay::bitmaps_to_image (view_ops, pbitmaps, m_props.dither_pattern (), m_props.line_styles (), &image, width, height, false, 0);
+}
+
+void
+HeadlessRenderer::render (const lay::HeadlessSnapshot &snapshot) const
+{
+  tl::SelfTimer timer (tl::verbosity () >= 21, tl::to_string (QObject::tr ("Rendering snapshot ")) + snapshot.path);
+
+  tl::PixelBuffer image (snapshot.width, snapshot.height);
+  render (snapshot.box, image);
+
+  tl::OutputStream os (snapshot.path, tl::OutputStream::OM_Plain);
+  image.write_png (os);
+}
+
+void
+HeadlessRenderer::render_all (const std::vector<lay::HeadlessSnapshot> &snapshots)
+{
+  tl::SelfTimer timer (tl::verbosity () >= 11, tl::to_string (QObject::tr ("Rendering snapshots")));
+
+  prepare ();
+
+  HeadlessRenderJob job (m_threads, this);
+  for (std::vector<lay::HeadlessSnapshot>::const_iterator s = snapshots.begin (); s != snapshots.end (); ++s) {
+    job.schedule (new HeadlessRenderTask (s.operator-> ()));
+  }
+
+  try {
+    job.start ();
+    job.wait ();
+  } catch (...) {
+    job.terminate ();
+    throw;
+  }
+
+  if (job.has_error ()) {
+    throw tl::Exception (tl::to_string (QObject::tr ("Errors occured during rendering. First error message says:\n")) + job.error_messages ().front ());
+  }
+}
+
+void
+HeadlessRenderer::draw_layer (unsigned int layer, db::cell_index_type ci, const db::CplxTrans &trans, const db::Box &vp, int level, lay::Renderer &r,
+                              lay::CanvasPlane *fill, lay::CanvasPlane *frame, lay::CanvasPlane *vertex, lay::CanvasPlane *text) const
+{
+  const db::Cell &cell = mp_layout->cell (ci);
+
+  db::Box bbox = cell.bbox (layer);
+  if (bbox.empty () || vp.empty ()) {
+    return;
+  }
+
+  //  optimize very small cells: paint the bbox
+  db::DBox dbbox = trans * bbox;
+  if ((dbbox.width () < 2.5 && dbbox.height () < 1.5) ||
+      (dbbox.width () < 1.5 && dbbox.height () < 2.5)) {
+    r.draw (dbbox, 0, frame, vertex, 0);
+    return;
+  }
+
+  //  small cells are drawn from the level-of-detail raster if all of their levels are drawn
+  if (mp_lod_cache.get () && level > 0 &&
+      std::max (dbbox.width (), dbbox.height ()) < double (lay::CellLOD::base_size) &&
+      m_max_hier_levels - level > int (cell.hierarchy_levels ())) {
+    if (const lay::CellLOD *lod = mp_lod_cache->lod (ci, layer)) {
+      lod->blit (trans, dynamic_cast<lay::Bitmap *> (fill), dynamic_cast<lay::Bitmap *> (frame), dynamic_cast<lay::Bitmap *> (vertex));
+      return;
+    }
+  }
+
+  //  draw the shapes of this level
+  if (level < m_max_hier_levels) {
+
+    //  texts are drawn separately (see draw_text_layer)
+    unsigned int flags = db::ShapeIterator::Boxes | db::ShapeIterator::Polygons | db::ShapeIterator::Edges | db::ShapeIterator::Paths;
+
+    for (db::ShapeIterator shape = cell.shapes (layer).begin_touching (vp, flags); ! shape.at_end (); ++shape) {
+      r.draw (*shape, trans, fill, frame, vertex, text);
+    }
+
+  }
+
+  //  dive down into the hierarchy ..
+  if (level + 1 < m_max_hier_levels) {
+
+    db::box_convert <db::CellInst> bc (*mp_layout, layer);
+
+    for (db::Cell::touching_iterator inst = cell.begin_touching (vp); ! inst.at_end (); ++inst) {
+
+      const db::CellInstArray &cell_inst = inst->cell_inst ();
+
+      db::cell_index_type new_ci = cell_inst.object ().cell_index ();
+      db::Box new_cell_box = mp_layout->cell (new_ci).bbox (layer);
+      if (new_cell_box.empty ()) {
+        continue;
+      }
+
+      db::Vector a, b;
+      unsigned long amax = 0, bmax = 0;
+      bool simplify = false;
+
+      if (cell_inst.is_regular_array (a, b, amax, bmax)) {
+
+        db::DBox inst_box;
+        if (cell_inst.is_complex ()) {
+          inst_box = trans * (cell_inst.complex_trans () * new_cell_box);
+        } else {
+          inst_box = trans * new_cell_box;
+        }
+
+        if (((a.x () == 0 && b.y () == 0) || (a.y () == 0 && b.x () == 0)) &&
+            inst_box.width () < 1.5 && inst_box.height () < 1.5 &&
+            (amax <= 1 || trans.ctrans (a.length ()) < 1.5) &&
+            (bmax <= 1 || trans.ctrans (b.length ()) < 1.5)) {
+          simplify = true;
+        }
+
+      }
+
+      if (simplify) {
+
+        //  The array can be simplified ..
+        db::Box array_box = cell_inst.bbox (bc);
+        r.draw (array_box, trans, frame, frame, 0, 0);
+        r.draw (array_box, trans, vertex, vertex, 0, 0);
+
+      } else {
+
+        for (db::CellInstArray::iterator p = cell_inst.begin_touching (vp, bc); ! p.at_end (); ++p) {
+          db::ICplxTrans t (cell_inst.complex_trans (*p));
+          db::Box new_vp = db::Box (t.inverted () * vp);
+          draw_layer (layer, new_ci, trans * t, new_vp, level + 1, r, fill, frame, vertex, text);
+        }
+
+      }
+
+    }
+
+  }
+}
+
+void
+HeadlessRenderer::draw_text_layer (const LayerInfo &info, db::cell_index_type ci, const db::CplxTrans &trans, const db::Box &vp, int level, lay::Renderer &r,
+                                   lay::CanvasPlane *fill, lay::CanvasPlane *frame, lay::CanvasPlane *vertex, lay::CanvasPlane *text) const
+{
+  //  Texts are drawn independently from the shortcuts taken for small cells: neither the
+  //  bounding box of a tiny cell nor the level-of-detail raster shows the texts.
+  //  Only cells with texts somewhere in their subtree are visited.
+
+  if (ci >= info.text_cells.size () || ! info.text_cells [ci]) {
+    return;
+  }
+
+  unsigned int layer = info.layer;
+  const db::Cell &cell = mp_layout->cell (ci);
+
+  db::Box bbox = cell.bbox (layer);
+  if (bbox.empty () || vp.empty () || ! bbox.touches (vp)) {
+    return;
+  }
+
+  if (level < m_max_hier_levels) {
+    for (db::ShapeIterator shape = cell.shapes (layer).begin_touching (vp, db::ShapeIterator::Texts); ! shape.at_end (); ++shape) {
+      r.draw (*shape, trans, fill, frame, vertex, text);
+    }
+  }
+
+  if (level + 1 < m_max_hier_levels) {
+
+    db::box_convert <db::CellInst> bc (*mp_layout, layer);
+
+    for (db::Cell::touching_iterator inst = cell.begin_touching (vp); ! inst.at_end (); ++inst) {
+
+      const db::CellInstArray &cell_inst = inst->cell_inst ();
+
+      db::cell_index_type new_ci = cell_inst.object ().cell_index ();
+      if (! info.text_cells [new_ci]) {
+        continue;
+      }
+
+      for (db::CellInstArray::iterator p = cell_inst.begin_touching (vp, bc); ! p.at_end (); ++p) {
+        db::ICplxTrans t (cell_inst.complex_trans (*p));
+        db::Box new_vp = db::Box (t.inverted () * vp);
+        draw_text_layer (info, new_ci, trans * t, new_vp, level + 1, r, fill, frame, vertex, text);
+      }
+
+    }
+
+  }
+}
+
+}
+
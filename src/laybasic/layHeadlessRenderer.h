@@ -0,0 +1,307 @@
+
+/*
+
+  KLayout Layout Viewer
+  Copyright (C) 2006-2017 Matthias Koefferlein
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+
+
+#ifndef HDR_layHeadlessRenderer
+#define HDR_layHeadlessRenderer
+
+#include "laybasicCommon.h"
+
+#include "layLayerProperties.h"
+#include "layViewOp.h"
+#include "dbLayout.h"
+#include "dbBox.h"
+#include "dbTrans.h"
+
+#include <vector>
+#include <string>
+#include <memory>
+
+namespace tl
+{
+  class PixelBuffer;
+}
+
+namespace lay
+{
+
+class CellLODCache;
+class Renderer;
+class CanvasPlane;
+
+/**
+ *  @brief Describes one snapshot to produce by the headless renderer
+ */
+struct LAYBASIC_PUBLIC HeadlessSnapshot
+{
+  HeadlessSnapshot ()
+    : width (0), height (0)
+  { }
+
+  HeadlessSnapshot (const db::DBox &b, unsigned int w, unsigned int h, const std::string &p)
+    : box (b), width (w), height (h), path (p)
+  { }
+
+  /**
+   *  @brief The area to show in micrometer units
+   *
+   *  The box is fitted into the image in the same way a LayoutView does it.
+   */
+  db::DBox box;
+
+  /**
+   *  @brief The width and height of the image in pixels
+   */
+  unsigned int width, height;
+
+  /**
+   *  @brief The path of the PNG file to produce
+   */
+  std::string path;
+};
+
+/**
+ *  @brief A renderer for layout snapshots which does not require a LayoutView
+ *
+ *  This object renders a cell of a layout with a given set of layer properties into
+ *  tl::PixelBuffer images using the same bitmap pipeline the LayoutView uses
+ *  (lay::BitmapRenderer and lay::bitmaps_to_image). It does not need any widget, canvas
+ *  or QApplication and is intended for batch generation of screenshots.
+ *
+ *  Since the renderer does not modify the layout, multiple snapshots can be rendered
+ *  concurrently. "render_all" does so using a pool of worker threads.
+ *
+ *  The layer properties are used without a view: the layers are looked up by
+ *  layer index or by layer/datatype and name. Property selectors and hierarchy level
+ *  selections in the layer sources are ignored. Animated layers are drawn
+ *  in their static state.
+ */
+class LAYBASIC_PUBLIC HeadlessRenderer
+{
+public:
+  /**
+   *  @brief Creates a renderer for the given layout and top cell
+   *
+   *  The layout must not be modified while the renderer is used.
+   *  Initially, default layer properties are set up for all layers of the layout.
+   */
+  HeadlessRenderer (db::Layout &layout, db::cell_index_type top_cell);
+
+  /**
+   *  @brief Destructor
+   */
+  ~HeadlessRenderer ();
+
+  /**
+   *  @brief Sets the layer properties
+   *
+   *  The source specifications are looked up in the layout. Cellview indexes are ignored.
+   */
+  void set_layer_properties (const lay::LayerPropertiesList &props);
+
+  /**
+   *  @brief Sets up default layer properties for all layers of the layout
+   *
+   *  The colors and stipples are taken from the default palettes like the LayoutView does
+   *  when no layer properties file is given.
+   */
+  void set_default_layer_properties ();
+
+  /**
+   *  @brief Gets the layer properties
+   */
+  const lay::LayerPropertiesList &layer_properties () const
+  {
+    return m_props;
+  }
+
+  /**
+   *  @brief Sets the background color
+   */
+  void set_background_color (lay::color_t c)
+  {
+    m_background = c;
+  }
+
+  /**
+   *  @brief Gets the background color
+   */
+  lay::color_t background_color () const
+  {
+    return m_background;
+  }
+
+  /**
+   *  @brief Sets a value indicating whether texts are drawn
+   */
+  void set_text_visible (bool f)
+  {
+    m_text_visible = f;
+  }
+
+  /**
+   *  @brief Gets a value indicating whether texts are drawn
+   */
+  bool text_visible () const
+  {
+    return m_text_visible;
+  }
+
+  /**
+   *  @brief Sets the default text size in micrometer units
+   */
+  void set_default_text_size (double sz)
+  {
+    m_default_text_size = sz;
+  }
+
+  /**
+   *  @brief Gets the default text size
+   */
+  double default_text_size () const
+  {
+    return m_default_text_size;
+  }
+
+  /**
+   *  @brief Sets the number of hierarchy levels to draw
+   *
+   *  Level 0 is the top cell. The default is to draw all levels.
+   */
+  void set_max_hier_levels (int l)
+  {
+    m_max_hier_levels = l;
+  }
+
+  /**
+   *  @brief Gets the number of hierarchy levels to draw
+   */
+  int max_hier_levels () const
+  {
+    return m_max_hier_levels;
+  }
+
+  /**
+   *  @brief Sets a value indicating whether small cells are drawn from level-of-detail rasters
+   *
+   *  This is the same approximation the LayoutView uses when bitmap caching is enabled.
+   *  It is enabled by default.
+   */
+  void set_use_lod (bool f)
+  {
+    m_use_lod = f;
+  }
+
+  /**
+   *  @brief Gets a value indicating whether small cells are drawn from level-of-detail rasters
+   */
+  bool use_lod () const
+  {
+    return m_use_lod;
+  }
+
+  /**
+   *  @brief Sets the number of threads used by "render_all"
+   *
+   *  A value of 0 means synchronous operation.
+   */
+  void set_threads (int n)
+  {
+    m_threads = n;
+  }
+
+  /**
+   *  @brief Gets the number of threads used by "render_all"
+   */
+  int threads () const
+  {
+    return m_threads;
+  }
+
+  /**
+   *  @brief Renders the given area into the given image
+   *
+   *  The image must be initialized to the desired size. "box" is the area to show
+   *  in micrometer units. This method can be called from multiple threads at the
+   *  same time once "prepare" has been called.
+   */
+  void render (const db::DBox &box, tl::PixelBuffer &image) const;
+
+  /**
+   *  @brief Renders the given snapshot and writes it to a PNG file
+   *
+   *  The same threading rules than for "render" apply.
+   */
+  void render (const lay::HeadlessSnapshot &snapshot) const;
+
+  /**
+   *  @brief Renders all given snapshots using the configured number of threads
+   *
+   *  This method calls "prepare" before it starts rendering. If one of the snapshots
+   *  cannot be produced, an exception is thrown after all other snapshots have been rendered.
+   */
+  void render_all (const std::vector<lay::HeadlessSnapshot> &snapshots);
+
+  /**
+   *  @brief Prepares the layout for rendering
+   *
+   *  This method must be called from a single thread before "render" is used. It updates
+   *  the layout and resolves the layer properties.
+   */
+  void prepare ();
+
+private:
+  struct LayerInfo
+  {
+    LayerInfo ()
+      : layer (0)
+    { }
+
+    unsigned int layer;
+    std::vector<db::DCplxTrans> trans;
+    lay::ViewOp ops [4];
+    std::vector<bool> text_cells;  //  per cell: true if the cell or one of its children has texts on the layer
+  };
+
+  db::Layout *mp_layout;
+  db::cell_index_type m_top_cell;
+  lay::LayerPropertiesList m_props;
+  lay::color_t m_background;
+  bool m_text_visible;
+  double m_default_text_size;
+  int m_max_hier_levels;
+  bool m_use_lod;
+  int m_threads;
+  std::vector<LayerInfo> m_layers;
+  std::auto_ptr<lay::CellLODCache> mp_lod_cache;
+
+  void draw_layer (unsigned int layer, db::cell_index_type ci, const db::CplxTrans &trans, const db::Box &vp, int level, lay::Renderer &r,
+                   lay::CanvasPlane *fill, lay::CanvasPlane *frame, lay::CanvasPlane *vertex, lay::CanvasPlane *text) const;
+  void draw_text_layer (const LayerInfo &info, db::cell_index_type ci, const db::CplxTrans &trans, const db::Box &vp, int level, lay::Renderer &r,
+                        lay::CanvasPlane *fill, lay::CanvasPlane *frame, lay::CanvasPlane *vertex, lay::CanvasPlane *text) const;
+};
+
+}
+
+#endif
+
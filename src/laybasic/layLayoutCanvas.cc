@@ -40,6 +40,7 @@
 #include "layBitmapsToImage.h"
 
 #include <sstream>
+#include <algorithm>
 
 namespace lay
 {
@@ -331,6 +332,7 @@ LayoutCanvas::LayoutCanvas (QWidget *parent, lay::LayoutView *view, const char *
     m_need_redraw (false),
     m_redraw_clearing (false),
     m_redraw_force_update (true),
+    m_redraw_incremental (false),
     m_update_image (true),
     m_do_update_image_dm (this, &LayoutCanvas::do_update_image),
     m_do_end_of_drawing_dm (this, &LayoutCanvas::do_end_of_drawing),
@@ -493,6 +495,7 @@ LayoutCanvas::prepare_drawing ()
       }
 
       mp_redraw_thread->commit (m_layers, m_viewport_l, 1.0 / double (m_oversampling));
+      update_change_serials ();
 
       if (tl::verbosity () >= 20) {
         tl::info << "Restored image from cache";
@@ -544,9 +547,16 @@ LayoutCanvas::prepare_drawing ()
       if (m_redraw_clearing) {
         mp_redraw_thread->start (mp_view->synchronous () ? 0 : mp_view->drawing_workers (), m_layers, m_viewport_l, 1.0 / double (m_oversampling), m_redraw_force_update);
       } else {
-        mp_redraw_thread->restart (m_need_redraw_layer);
+        std::vector<db::DBox> regions;
+        if (m_redraw_incremental && changed_regions (m_need_redraw_layer, regions)) {
+          mp_redraw_thread->restart (m_need_redraw_layer, regions);
+        } else {
+          mp_redraw_thread->restart (m_need_redraw_layer);
+        }
       }
 
+      update_change_serials ();
+
     }
 
     //  for short draw jobs, the drawing is already done now. For others display the busy cursor.
@@ -1126,6 +1136,18 @@ LayoutCanvas::redraw_new (std::vector<lay::RedrawLayerInfo> &layers)
 
 void
 LayoutCanvas::redraw_selected (const std::vector<int> &layers)
+{
+  do_redraw_selected (layers, false);
+}
+
+void
+LayoutCanvas::redraw_changed (const std::vector<int> &layers)
+{
+  do_redraw_selected (layers, true);
+}
+
+void
+LayoutCanvas::do_redraw_selected (const std::vector<int> &layers, bool incremental)
 {
   stop_redraw ();
 
@@ -1133,16 +1155,227 @@ LayoutCanvas::redraw_selected (const std::vector<int> &layers)
 
   if (! m_need_redraw) {
     m_redraw_clearing = false;
+    m_redraw_incremental = true;
     m_need_redraw_layer.clear ();
   }
 
   m_need_redraw = true;
-  m_need_redraw_layer = layers;
+  if (! incremental) {
+    m_redraw_incremental = false;
+  }
+
+  //  collect the layers: there may be multiple requests before the redraw happens
+  for (std::vector<int>::const_iterator l = layers.begin (); l != layers.end (); ++l) {
+    if (std::find (m_need_redraw_layer.begin (), m_need_redraw_layer.end (), *l) == m_need_redraw_layer.end ()) {
+      m_need_redraw_layer.push_back (*l);
+    }
+  }
+
   m_redraw_force_update = true;
 
   update (); // produces a paintEvent()
 }
 
+namespace
+{
+
+/**
+ *  @brief Maps the changes of one cell into the coordinate system of the context cell
+ *
+ *  The changes are given by the change boxes and a footprint which encloses the 
+ *  boxes and the cell's content on the layer. For instances which appear small on the 
+ *  screen, the footprint is taken instead of the individual boxes.
+ */
+struct ChangedRegionsMapper
+{
+  //  below this size in pixels, an instance's footprint is taken
+  static const double small_footprint;
+  //  the maximum number of regions before we redraw everything
+  static const size_t max_regions = 256;
+  //  the maximum number of instances to visit
+  static const size_t max_instances = 10000;
+
+  ChangedRegionsMapper (const db::Layout &layout, unsigned int layer, db::cell_index_type target, const std::vector<db::Box> &boxes, const db::Box &footprint, const db::Box &search_box, const db::DCplxTrans &pixel_trans)
+    : mp_layout (&layout), m_layer (layer), m_target (target), mp_boxes (&boxes), m_footprint (footprint), m_search_box (search_box), m_pixel_trans (pixel_trans), m_instances (0)
+  {
+    layout.cell (target).collect_caller_cells (m_callers);
+  }
+
+  bool map (db::cell_index_type ci, const db::ICplxTrans &t, std::vector<db::Box> &regions)
+  {
+    if (ci == m_target) {
+
+      db::Box fp = t * m_footprint;
+      if (! fp.touches (m_search_box)) {
+        return true;
+      }
+
+      db::DBox fp_pixels = m_pixel_trans * db::DBox (fp);
+      if (std::max (fp_pixels.width (), fp_pixels.height ()) < small_footprint) {
+        regions.push_back (fp);
+      } else {
+        for (std::vector<db::Box>::const_iterator b = mp_boxes->begin (); b != mp_boxes->end (); ++b) {
+          db::Box tb = t * *b;
+          if (tb.touches (m_search_box)) {
+            regions.push_back (tb);
+          }
+        }
+      }
+
+      return regions.size () <= max_regions;
+
+    }
+
+    const db::Cell &cell = mp_layout->cell (ci);
+    db::Box s = t.inverted () * m_search_box;
+    db::box_convert <db::CellInst> bc (*mp_layout, m_layer);
+
+    for (db::Cell::touching_iterator inst = cell.begin_touching (s); ! inst.at_end (); ++inst) {
+
+      const db::CellInstArray &cell_inst = inst->cell_inst ();
+      db::cell_index_type cci = cell_inst.object ().cell_index ();
+      if (cci != m_target && m_callers.find (cci) == m_callers.end ()) {
+        continue;
+      }
+
+      for (db::CellInstArray::iterator a = cell_inst.begin_touching (s, bc); ! a.at_end (); ++a) {
+        if (++m_instances > max_instances || ! map (cci, t * cell_inst.complex_trans (*a), regions)) {
+          return false;
+        }
+      }
+
+    }
+
+    return true;
+  }
+
+private:
+  const db::Layout *mp_layout;
+  unsigned int m_layer;
+  db::cell_index_type m_target;
+  const std::vector<db::Box> *mp_boxes;
+  db::Box m_footprint, m_search_box;
+  db::DCplxTrans m_pixel_trans;
+  std::set<db::cell_index_type> m_callers;
+  size_t m_instances;
+};
+
+const double ChangedRegionsMapper::small_footprint = 32.0;
+
+}
+
+bool
+LayoutCanvas::changed_regions (const std::vector<int> &layers, std::vector<db::DBox> &regions)
+{
+  regions.clear ();
+
+  //  Regional redraw is not supported if hierarchy levels above the cell are drawn
+  if (mp_view->get_min_hier_levels () < 0) {
+    return false;
+  }
+
+  std::map<unsigned int, std::vector<db::LayoutChangeRegion> > changes_per_cv;
+
+  for (std::vector<int>::const_iterator l = layers.begin (); l != layers.end (); ++l) {
+
+    if (*l < 0 || *l >= int (m_layers.size ())) {
+      return false;
+    }
+
+    const lay::RedrawLayerInfo &li = m_layers [*l];
+    if (li.layer_index < 0 || li.cellview_index < 0 || li.hier_levels.has_from_level ()) {
+      return false;
+    }
+
+    unsigned int cv_index = (unsigned int) li.cellview_index;
+    unsigned int layer = (unsigned int) li.layer_index;
+
+    const lay::CellView &cv = mp_view->cellview (cv_index);
+    if (! cv.is_valid () || cv_index >= m_change_serials.size ()) {
+      //  nothing to draw
+      continue;
+    }
+
+    db::Layout &layout = cv->layout ();
+    if (layout.under_construction () || (layout.manager () && layout.manager ()->transacting ())) {
+      return false;
+    }
+
+    std::map<unsigned int, std::vector<db::LayoutChangeRegion> >::iterator c = changes_per_cv.find (cv_index);
+    if (c == changes_per_cv.end ()) {
+      layout.update ();
+      c = changes_per_cv.insert (std::make_pair (cv_index, std::vector<db::LayoutChangeRegion> ())).first;
+      if (! layout.changed_regions (m_change_serials [cv_index], c->second)) {
+        return false;
+      }
+    }
+
+    //  collect the change boxes per cell
+    std::map<db::cell_index_type, std::vector<db::Box> > boxes_per_cell;
+    for (std::vector<db::LayoutChangeRegion>::const_iterator r = c->second.begin (); r != c->second.end (); ++r) {
+      if (r->layer == layer && layout.is_valid_cell_index (r->cell_index)) {
+        if (r->box == db::Box::world ()) {
+          return false;
+        }
+        boxes_per_cell [r->cell_index].push_back (r->box);
+      }
+    }
+
+    for (std::map<db::cell_index_type, std::vector<db::Box> >::const_iterator b = boxes_per_cell.begin (); b != boxes_per_cell.end (); ++b) {
+
+      db::Box footprint;
+      for (std::vector<db::Box>::const_iterator bb = b->second.begin (); bb != b->second.end (); ++bb) {
+        footprint += *bb;
+      }
+
+      const db::Cell &cell = layout.cell (b->first);
+
+      //  If something was removed from a child cell's boundary, the instance bounding boxes
+      //  may not tell us any longer, where the child cell was visible.
+      if (b->first != cv.ctx_cell_index () && ! footprint.inside (cell.bbox (layer))) {
+        return false;
+      }
+
+      footprint += cell.bbox (layer);
+
+      for (std::vector<db::DCplxTrans>::const_iterator t = li.trans.begin (); t != li.trans.end (); ++t) {
+
+        db::DCplxTrans tt = *t * db::DCplxTrans (layout.dbu ());
+        db::Box search_box = db::Box (tt.inverted () * m_viewport_l.box ());
+
+        std::vector<db::Box> cell_regions;
+        ChangedRegionsMapper mapper (layout, layer, b->first, b->second, footprint, search_box, m_viewport_l.trans () * tt);
+        if (! mapper.map (cv.ctx_cell_index (), db::ICplxTrans (), cell_regions)) {
+          return false;
+        }
+
+        for (std::vector<db::Box>::const_iterator r = cell_regions.begin (); r != cell_regions.end (); ++r) {
+          regions.push_back (tt * db::DBox (*r));
+        }
+
+        if (regions.size () > ChangedRegionsMapper::max_regions) {
+          return false;
+        }
+
+      }
+
+    }
+
+  }
+
+  return true;
+}
+
+void
+LayoutCanvas::update_change_serials ()
+{
+  m_change_serials.clear ();
+  for (unsigned int i = 0; i < mp_view->cellviews (); ++i) {
+    const lay::CellView &cv = mp_view->cellview (i);
+    m_change_serials.push_back (cv.is_valid () ? cv->layout ().change_serial () : 0);
+  }
+}
+
 void
 LayoutCanvas::change_visibility (const std::vector <bool> &visible)
 {
@@ -1159,6 +1392,8 @@ LayoutCanvas::change_visibility (const std::vector <bool> &visible)
 
   m_need_redraw = true;
   m_need_redraw_layer.clear ();
+  //  newly visible layers need to be drawn entirely
+  m_redraw_incremental = false;
 
   update (); // produces a paintEvent()
 }
@@ -242,6 +242,14 @@ public:
    */
   void redraw_selected (const std::vector<int> &layers);
 
+  /**
+   *  @brief Issue a redraw request on selected layers after the layout has changed
+   *
+   *  Other than redraw_selected, this method will only redraw the regions affected by 
+   *  the changes if the layout provides a change log and the previous drawing is complete.
+   */
+  void redraw_changed (const std::vector<int> &layers);
+
   /**
    *  @brief Set the oversampling factor
    *
@@ -367,8 +375,10 @@ private:
   bool m_need_redraw;
   bool m_redraw_clearing;
   bool m_redraw_force_update;
+  bool m_redraw_incremental;
   bool m_update_image;
   std::vector<int> m_need_redraw_layer;
+  std::vector<size_t> m_change_serials;
   std::vector<lay::RedrawLayerInfo> m_layers;
 
   lay::RedrawThread *mp_redraw_thread;
@@ -393,6 +403,9 @@ private:
   void do_update_image ();
   void do_end_of_drawing ();
   void do_redraw_all (bool force_redraw = true);
+  void do_redraw_selected (const std::vector<int> &layers, bool incremental);
+  bool changed_regions (const std::vector<int> &layers, std::vector<db::DBox> &regions);
+  void update_change_serials ();
 
   void prepare_drawing ();
 };
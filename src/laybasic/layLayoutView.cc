@@ -242,6 +242,28 @@ const int timer_interval = 500;
 
 static LayoutView *ms_current = 0;
 
+/**
+ *  @brief Updates the layout using the given number of threads
+ *
+ *  The thread count applies to this update only. Later updates, for example after
+ *  edits, use the layout's own setting again.
+ */
+static void
+update_with_threads (db::Layout &layout, unsigned int threads)
+{
+  unsigned int update_threads = layout.update_threads ();
+  layout.set_update_threads (threads);
+
+  try {
+    layout.update ();
+  } catch (...) {
+    layout.set_update_threads (update_threads);
+    throw;
+  }
+
+  layout.set_update_threads (update_threads);
+}
+
 LayoutView::LayoutView (db::Manager *manager, bool editable, lay::PluginRoot *root, QWidget *parent, const char *name, unsigned int options)
   : QFrame (parent), 
     lay::Plugin (root), 
@@ -2097,13 +2119,18 @@ LayoutView::signal_bboxes_from_layer_changed (unsigned int cv_index, unsigned in
 
   } else {
 
-    //  redraw only the layers required for redrawing
+    //  redraw only the layers required for redrawing and only the regions which have changed
+    std::vector<int> layers;
     for (std::vector<lay::RedrawLayerInfo>::const_iterator l = mp_canvas->get_redraw_layers ().begin (); l != mp_canvas->get_redraw_layers ().end (); ++l) {
       if (l->cellview_index == int (cv_index) && (layer_index == std::numeric_limits<unsigned int>::max () || l->layer_index == int (layer_index))) {
-        redraw_layer ((unsigned int) (l - mp_canvas->get_redraw_layers ().begin ()));
+        layers.push_back (int (l - mp_canvas->get_redraw_layers ().begin ()));
       }
     }
 
+    if (! layers.empty ()) {
+      mp_canvas->redraw_changed (layers);
+    }
+
     //  forward this event to our observers
     geom_changed_event ();
 
@@ -2816,10 +2843,17 @@ LayoutView::reload_layout (unsigned int cv_index)
 
     //  sort the layout explicitly here. Otherwise it would be done
     //  implicitly at some other time. This may throw an exception
-    //  if the operation was cancelled.
+    //  if the operation was cancelled. The drawing workers are employed for sorting too.
     {
       tl::SelfTimer timer (tl::verbosity () >= 11, tl::to_string (QObject::tr ("Sorting")));
-      cv->layout ().update ();
+      update_with_threads (cv->layout (), synchronous () ? 0 : (unsigned int) m_drawing_workers);
+    }
+
+    //  layouts in viewer mode are read mostly, so we pack the shapes. Editable layouts
+    //  are not packed since the first modification of a layer would unpack it again.
+    if (! cv->layout ().is_editable ()) {
+      tl::SelfTimer timer (tl::verbosity () >= 11, tl::to_string (QObject::tr ("Packing")));
+      cv->layout ().pack_shapes ();
     }
 
     //  print the memory statistics now.
@@ -3037,10 +3071,17 @@ LayoutView::load_layout (const std::string &filename, const db::LoadLayoutOption
 
     //  sort the layout explicitly here. Otherwise it would be done
     //  implicitly at some other time. This may throw an exception
-    //  if the operation was cancelled.
+    //  if the operation was cancelled. The drawing workers are employed for sorting too.
     {
       tl::SelfTimer timer (tl::verbosity () >= 11, tl::to_string (QObject::tr ("Sorting")));
-      cv->layout ().update ();
+      update_with_threads (cv->layout (), synchronous () ? 0 : (unsigned int) m_drawing_workers);
+    }
+
+    //  layouts in viewer mode are read mostly, so we pack the shapes. Editable layouts
+    //  are not packed since the first modification of a layer would unpack it again.
+    if (! cv->layout ().is_editable ()) {
+      tl::SelfTimer timer (tl::verbosity () >= 11, tl::to_string (QObject::tr ("Packing")));
+      cv->layout ().pack_shapes ();
     }
 
     //  print the memory statistics now.
@@ -60,6 +60,38 @@ public:
 
 static tl::RegisteredClass<lay::PluginDeclaration> plugin_decl (new lay::OASISReaderPluginDeclaration (), 10000, "OASISReader");
 
+// ---------------------------------------------------------------
+//  gsi Implementation of specific methods
+
+static void set_oasis_read_threads (db::LoadLayoutOptions *options, unsigned int n)
+{
+  options->get_options<db::OASISReaderOptions> ().threads = n;
+}
+
+static unsigned int get_oasis_read_threads (const db::LoadLayoutOptions *options)
+{
+  return options->get_options<db::OASISReaderOptions> ().threads;
+}
+
+//  extend lay::LoadLayoutOptions with the OASIS options 
+static
+gsi::ClassExt<db::LoadLayoutOptions> oasis_reader_options (
+  gsi::method_ext ("oasis_read_threads=", &set_oasis_read_threads,
+    "@brief Sets the number of threads to use for decoding the cells of an OASIS file\n"
+    "If a value larger than 0 is given, the cells of a strict-mode OASIS file with cell offsets (S_CELL_OFFSET properties) "
+    "are decoded by the given number of threads in parallel. The resulting layout is the same than the one obtained with a single thread. "
+    "Files which don't fulfil these requirements and files which cannot be mapped into memory (i.e. compressed files) are read "
+    "single-threaded. The default is 0 (single-threaded).\n"
+    "\nThis property has been added in version 0.25.\n"
+  ) +
+  gsi::method_ext ("oasis_read_threads", &get_oasis_read_threads,
+    "@brief Gets the number of threads to use for decoding the cells of an OASIS file\n"
+    "See \\oasis_read_threads= method for a description of this property."
+    "\nThis property has been added in version 0.25.\n"
+  ),
+  ""
+);
+
 }
 
 
@@ -197,6 +197,16 @@ static bool get_oasis_write_cblocks (const db::SaveLayoutOptions *options)
   return options->get_options<db::OASISWriterOptions> ().write_cblocks;
 }
 
+static void set_oasis_write_threads (db::SaveLayoutOptions *options, unsigned int n)
+{
+  options->get_options<db::OASISWriterOptions> ().threads = n;
+}
+
+static unsigned int get_oasis_write_threads (const db::SaveLayoutOptions *options)
+{
+  return options->get_options<db::OASISWriterOptions> ().threads;
+}
+
 static void set_oasis_strict_mode (db::SaveLayoutOptions *options, bool f)
 {
   options->get_options<db::OASISWriterOptions> ().strict_mode = f;
@@ -228,6 +238,21 @@ gsi::ClassExt<db::SaveLayoutOptions> oasis_writer_options (
   gsi::method_ext ("oasis_write_cblocks?", &get_oasis_write_cblocks,
     "@brief Gets a value indicating whether to write compressed CBLOCKS per cell\n"
   ) +
+  gsi::method_ext ("oasis_write_threads=", &set_oasis_write_threads,
+    "@brief Sets the number of threads used for encoding the cells and compressing the CBLOCKs\n"
+    "@args n\n"
+    "If this value is non-zero, the cells are encoded and the CBLOCKs are compressed by the given number of threads while "
+    "the writer continues with the next cells. The resulting file is the same as without threads. "
+    "A value of 0 (the default) means that everything is done in the writing thread.\n"
+    "\n"
+    "This method has been introduced in version 0.25."
+  ) +
+  gsi::method_ext ("oasis_write_threads", &get_oasis_write_threads,
+    "@brief Gets the number of threads used for encoding the cells and compressing the CBLOCKs\n"
+    "See \\oasis_write_threads= method for a description of this property."
+    "\n"
+    "This method has been introduced in version 0.25."
+  ) +
   gsi::method_ext ("oasis_strict_mode=", &set_oasis_strict_mode,
     "@brief Sets a value indicating whether to write strict-mode OASIS files\n"
     "@args flag\n"
@@ -32,6 +32,8 @@
 #include "dbShape.h"
 
 #include <memory>
+#include <algorithm>
+#include <cmath>
 
 namespace lay 
 {
@@ -80,7 +82,48 @@ RedrawThread::task_finished (int task_id)
   } else if (task_id == draw_boxes_queue_entry) {
     m_boxes_already_drawn = true;
   } else if (task_id >= 0 && task_id < int (m_layers.size ())) {
-    m_layers [task_id].enabled = false;
+    //  a layer drawn in tiles is finished when the last tile is finished
+    m_tiles_lock.lock ();
+    if (task_id < int (m_tiles_pending.size ()) && m_tiles_pending [task_id] > 1) {
+      --m_tiles_pending [task_id];
+    } else {
+      m_layers [task_id].enabled = false;
+    }
+    m_tiles_lock.unlock ();
+  }
+}
+
+void
+RedrawThread::make_tiles (int nlayers_to_draw, std::vector<db::Box> &tiles) const
+{
+  tiles.clear ();
+
+  //  Split the canvas into tiles if there are fewer layers to draw than workers. Tiles are
+  //  only used if the whole canvas is redrawn. Each worker should receive about two tasks 
+  //  for a better load balance.
+  if (nlayers_to_draw <= 0 || nlayers_to_draw >= num_workers () || ! mp_canvas->supports_tiles ()) {
+    return;
+  }
+  if (m_redraw_regions.size () != 1 || m_redraw_regions.front () != db::Box (db::Point (0, 0), db::Point (m_width, m_height))) {
+    return;
+  }
+
+  int ntiles = (2 * num_workers () + nlayers_to_draw - 1) / nlayers_to_draw;
+
+  //  choose the tile grid such that the tiles are roughly square
+  int nx = std::max (1, int (floor (sqrt (double (ntiles) * m_width / std::max (1, m_height)) + 0.5)));
+  nx = std::min (nx, std::max (1, m_width / min_tile_size));
+  int ny = std::min ((ntiles + nx - 1) / nx, std::max (1, m_height / min_tile_size));
+
+  if (nx * ny <= 1) {
+    return;
+  }
+
+  tiles.reserve (nx * ny);
+  for (int iy = 0; iy < ny; ++iy) {
+    for (int ix = 0; ix < nx; ++ix) {
+      tiles.push_back (db::Box ((m_width * ix) / nx, (m_height * iy) / ny, (m_width * (ix + 1)) / nx, (m_height * (iy + 1)) / ny));
+    }
   }
 }
 
@@ -185,7 +228,7 @@ RedrawThread::start (int workers, const std::vector <lay::RedrawLayerInfo> &laye
   m_last_center = new_region.center ();
 
   std::vector<int> restart;
-  do_start (true, shift_vector, &layers, restart, workers);
+  do_start (true, shift_vector, &layers, restart, 0, workers);
 }
 
 void  
@@ -195,7 +238,46 @@ RedrawThread::restart (const std::vector<int> &restart)
   m_redraw_regions.push_back (db::Box (db::Point (0, 0), db::Point (m_width, m_height)));
   m_valid_region = m_stored_region = db::DBox ();
 
-  do_start (false, 0, 0, restart, -1);
+  do_start (false, 0, 0, restart, 0, -1);
+}
+
+void  
+RedrawThread::restart (const std::vector<int> &restart, const std::vector<db::DBox> &regions)
+{
+  //  Redrawing regions requires a complete image of the other parts: if the previous
+  //  drawing was interrupted, redraw the full canvas.
+  bool complete = m_boxes_already_drawn && m_custom_already_drawn;
+  for (int i = 0; i < m_nlayers && complete; ++i) {
+    if (m_layers [i].visible && m_layers [i].enabled) {
+      complete = false;
+    }
+  }
+
+  if (! complete) {
+    RedrawThread::restart (restart);
+    return;
+  }
+
+  db::Box full (db::Point (0, 0), db::Point (m_width, m_height));
+
+  std::vector<db::Box> clear_regions;
+  clear_regions.reserve (regions.size ());
+  m_redraw_regions.clear ();
+  m_redraw_regions.reserve (regions.size ());
+
+  for (std::vector<db::DBox>::const_iterator r = regions.begin (); r != regions.end (); ++r) {
+    //  the pixels touched by a shape may extend a little beyond its box 
+    db::Box rr = db::Box ((m_vp_trans * *r).enlarged (db::DVector (1.0, 1.0))) & full;
+    if (! rr.empty ()) {
+      clear_regions.push_back (rr);
+      //  the drawing region is a little larger, so shapes adjacent to the cleared ones are redrawn
+      m_redraw_regions.push_back (rr.enlarged (db::Vector (2, 2)));
+    }
+  }
+
+  m_valid_region = m_stored_region = db::DBox ();
+
+  do_start (false, 0, 0, restart, &clear_regions, -1);
 }
 
 void  
@@ -207,7 +289,7 @@ RedrawThread::change_visibility (const std::vector<bool> &visibility)
 }
 
 void 
-RedrawThread::do_start (bool clear, const db::Vector *shift_vector, const std::vector <lay::RedrawLayerInfo> *layers, const std::vector<int> &restart, int nworkers)
+RedrawThread::do_start (bool clear, const db::Vector *shift_vector, const std::vector <lay::RedrawLayerInfo> *layers, const std::vector<int> &restart, const std::vector<db::Box> *clear_regions, int nworkers)
 {
   // change the number of workers if required.
   if (nworkers >= 0 && nworkers != num_workers ()) {
@@ -243,6 +325,10 @@ RedrawThread::do_start (bool clear, const db::Vector *shift_vector, const std::v
         //  attach to the layout object to receive change notifications to stop the redraw thread
         cv->layout ().hier_changed_event.add (this, &RedrawThread::layout_changed);
         cv->layout ().bboxes_changed_any_event.add (this, &RedrawThread::layout_changed);
+        //  start building the level-of-detail rasters in the background
+        if (mp_view->bitmap_caching ()) {
+          cv->lod_cache ().start_build ();
+        }
       }
     }
     mp_view->annotation_shapes ().update ();
@@ -264,7 +350,7 @@ RedrawThread::do_start (bool clear, const db::Vector *shift_vector, const std::v
 
       if (clear) {
 
-        mp_canvas->prepare (m_nlayers * planes_per_layer + special_planes_before + special_planes_after, m_width, m_height, m_resolution, shift_vector, 0, mp_view->drawings ());
+        mp_canvas->prepare (m_nlayers * planes_per_layer + special_planes_before + special_planes_after, m_width, m_height, m_resolution, shift_vector, 0, 0, mp_view->drawings ());
         m_boxes_already_drawn = false;
         m_custom_already_drawn = false;
 
@@ -284,7 +370,7 @@ RedrawThread::do_start (bool clear, const db::Vector *shift_vector, const std::v
           }
         }
 
-        mp_canvas->prepare (m_nlayers * planes_per_layer + special_planes_before + special_planes_after, m_width, m_height, m_resolution, shift_vector, &planes_to_init, mp_view->drawings ());
+        mp_canvas->prepare (m_nlayers * planes_per_layer + special_planes_before + special_planes_after, m_width, m_height, m_resolution, shift_vector, &planes_to_init, clear_regions, mp_view->drawings ());
 
         for (std::vector<int>::const_iterator l = restart.begin (); l != restart.end (); ++l) {
           if (*l >= 0 && *l < int (m_layers.size ())) {
@@ -306,9 +392,36 @@ RedrawThread::do_start (bool clear, const db::Vector *shift_vector, const std::v
         schedule (new RedrawThreadTask (draw_custom_queue_entry));
       }
 
+      int nlayers_to_draw = 0;
       for (int i = 0; i < m_nlayers; ++i) {
         if (m_layers [i].visible && m_layers [i].enabled) {
-          schedule (new RedrawThreadTask (i));
+          ++nlayers_to_draw;
+        }
+      }
+
+      //  layers may be drawn in screen tiles to employ more workers
+      std::vector<db::Box> tiles;
+      make_tiles (nlayers_to_draw, tiles);
+
+      m_tiles_lock.lock ();
+      m_tiles_pending.clear ();
+      m_tiles_pending.resize (m_nlayers, 0);
+      for (int i = 0; i < m_nlayers && ! tiles.empty (); ++i) {
+        if (m_layers [i].visible && m_layers [i].enabled) {
+          m_tiles_pending [i] = int (tiles.size ());
+        }
+      }
+      m_tiles_lock.unlock ();
+
+      for (int i = 0; i < m_nlayers; ++i) {
+        if (m_layers [i].visible && m_layers [i].enabled) {
+          if (tiles.empty ()) {
+            schedule (new RedrawThreadTask (i));
+          } else {
+            for (std::vector<db::Box>::const_iterator t = tiles.begin (); t != tiles.end (); ++t) {
+              schedule (new RedrawThreadTask (i, *t));
+            }
+          }
         }
       }
 
@@ -318,7 +431,7 @@ RedrawThread::do_start (bool clear, const db::Vector *shift_vector, const std::v
       }
 
     } else {
-      mp_canvas->prepare (1, m_width, m_height, m_resolution, 0, 0, mp_view->drawings ());
+      mp_canvas->prepare (1, m_width, m_height, m_resolution, 0, 0, 0, mp_view->drawings ());
     }
 
   }
@@ -50,6 +50,9 @@ class Viewport;
 //  update (snapshot) interval in ms
 const int update_interval = 500;
 
+//  the minimum width or height of a screen tile in pixels
+const int min_tile_size = 128;
+
 class RedrawThread 
   : public tl::Object,
     public tl::JobBase
@@ -61,6 +64,7 @@ public:
   void commit (const std::vector <lay::RedrawLayerInfo> &layers, const lay::Viewport &vp, double resolution);
   void start (int workers, const std::vector <lay::RedrawLayerInfo> &layers, const lay::Viewport &vp, double resolution, bool force_redraw);
   void restart (const std::vector<int> &restart);
+  void restart (const std::vector<int> &restart, const std::vector<db::DBox> &regions);
   void wakeup_checked ();
   void wakeup ();
 
@@ -91,8 +95,9 @@ protected:
 
 private:
   void start ();
-  void do_start (bool clear, const db::Vector *shift_vector, const std::vector <lay::RedrawLayerInfo> *layers, const std::vector<int> &restart, int workers);
+  void do_start (bool clear, const db::Vector *shift_vector, const std::vector <lay::RedrawLayerInfo> *layers, const std::vector<int> &restart, const std::vector<db::Box> *clear_regions, int workers);
   void done ();
+  void make_tiles (int nlayers_to_draw, std::vector<db::Box> &tiles) const;
 
   void layout_changed ();
 
@@ -106,6 +111,8 @@ private:
   int m_nlayers;
   bool m_boxes_already_drawn;
   bool m_custom_already_drawn;
+  std::vector<int> m_tiles_pending;
+  QMutex m_tiles_lock;
 
   db::DCplxTrans m_vp_trans;
   int m_width, m_height;
@@ -244,9 +244,9 @@ shift_bitmap (const lay::Bitmap *from, lay::Bitmap *to, int dx, int dy)
 }
 
 void 
-BitmapRedrawThreadCanvas::prepare (unsigned int nlayers, unsigned int width, unsigned int height, double resolution, const db::Vector *shift_vector, const std::vector<int> *planes, const lay::Drawings *drawings)
+BitmapRedrawThreadCanvas::prepare (unsigned int nlayers, unsigned int width, unsigned int height, double resolution, const db::Vector *shift_vector, const std::vector<int> *planes, const std::vector<db::Box> *regions, const lay::Drawings *drawings)
 {
-  RedrawThreadCanvas::prepare (nlayers, width, height, resolution, shift_vector, planes, drawings);
+  RedrawThreadCanvas::prepare (nlayers, width, height, resolution, shift_vector, planes, regions, drawings);
 
   lock ();
 
@@ -293,7 +293,27 @@ BitmapRedrawThreadCanvas::prepare (unsigned int nlayers, unsigned int width, uns
         }
 
       } else if (size_t (*l) < mp_plane_buffers.size ()) {
-        mp_plane_buffers[*l]->clear ();
+
+        lay::Bitmap *bitmap = mp_plane_buffers[*l];
+
+        if (! regions) {
+          bitmap->clear ();
+        } else {
+
+          //  clear only the given regions
+          for (std::vector<db::Box>::const_iterator r = regions->begin (); r != regions->end (); ++r) {
+
+            db::Box rr = *r & db::Box (0, 0, int (width) - 1, int (height) - 1);
+            if (! rr.empty ()) {
+              for (int y = rr.bottom (); y <= rr.top (); ++y) {
+                bitmap->clear ((unsigned int) y, (unsigned int) rr.left (), (unsigned int) rr.right () + 1);
+              }
+            }
+
+          }
+
+        }
+
       }
 
     }
@@ -369,6 +389,22 @@ BitmapRedrawThreadCanvas::create_drawing_plane ()
   return new lay::Bitmap(m_width, m_height, resolution ());
 }
 
+void 
+BitmapRedrawThreadCanvas::merge_plane (unsigned int n, const lay::CanvasPlane *plane, const db::Box &clip)
+{ 
+  if (clip.empty () || clip.right () <= 0 || clip.top () <= 0) {
+    return;
+  }
+
+  lock ();
+  if (n < mp_plane_buffers.size ()) {
+    const lay::Bitmap *bitmap = dynamic_cast<const lay::Bitmap *> (plane);
+    tl_assert (bitmap != 0);
+    mp_plane_buffers [n]->merge (bitmap, (unsigned int) std::max (0, clip.left ()), (unsigned int) std::max (0, clip.bottom ()), (unsigned int) clip.right (), (unsigned int) clip.top ()); 
+  }
+  unlock ();
+}
+
 void 
 BitmapRedrawThreadCanvas::initialize_plane (lay::CanvasPlane *plane, unsigned int n)
 {
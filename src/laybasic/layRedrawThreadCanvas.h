@@ -93,10 +93,11 @@ public:
    *  @param height The height of the canvas
    *  @param shifting The shift vector by which the original image should be shifted to form the background or 0 if no shifting is required
    *  @param layers The set of plane indexes to initialize (if null, all planes are initialized). A negative value initializes the drawing planes.
+   *  @param regions If not null, only these regions (in pixel units) of the given planes are initialized. The drawing planes are always initialized entirely.
    *  @param resolution The resolution in which the image is drawn
    *  @param drawings The custom drawing interface which is responsible to draw user objects
    */
-  virtual void prepare (unsigned int /*nlayers*/, unsigned int width, unsigned int height, double resolution, const db::Vector * /*shift_vector*/, const std::vector<int> * /*planes*/, const lay::Drawings * /*drawings*/) 
+  virtual void prepare (unsigned int /*nlayers*/, unsigned int width, unsigned int height, double resolution, const db::Vector * /*shift_vector*/, const std::vector<int> * /*planes*/, const std::vector<db::Box> * /*regions*/, const lay::Drawings * /*drawings*/) 
   {
     m_resolution = resolution;
     m_width = width;
@@ -186,6 +187,29 @@ public:
    */
   virtual lay::Renderer *create_renderer () = 0;
 
+  /**
+   *  @brief Returns true, if the canvas supports drawing in tiles
+   *
+   *  If tiles are supported, the redraw thread may split the drawing of a layer into
+   *  screen tiles. The planes drawn for each tile are merged into the canvas planes 
+   *  with merge_plane.
+   */
+  virtual bool supports_tiles () const
+  {
+    return false;
+  }
+
+  /**
+   *  @brief Merge a plane into the plane with index n
+   *
+   *  This method is called from the redraw thread. The content of the given plane
+   *  inside the clip box (in pixel units) is added to the plane with index n.
+   */
+  virtual void merge_plane (unsigned int /*n*/, const lay::CanvasPlane * /*plane*/, const db::Box & /*clip*/) 
+  {
+    //  .. nothing yet ..
+  }
+
 private:
   QMutex m_mutex;
   double m_resolution;
@@ -274,7 +298,7 @@ public:
    *  This method is called from RedrawThread::start (), not from the
    *  redraw thread.
    */
-  virtual void prepare (unsigned int nlayers, unsigned int width, unsigned int height, double resolution, const db::Vector *shift_vector, const std::vector<int> *planes, const lay::Drawings *drawings);
+  virtual void prepare (unsigned int nlayers, unsigned int width, unsigned int height, double resolution, const db::Vector *shift_vector, const std::vector<int> *planes, const std::vector<db::Box> *regions, const lay::Drawings *drawings);
   
   /**
    *  @brief Test a plane with the given index for emptiness
@@ -319,6 +343,19 @@ public:
     return new lay::BitmapRenderer (m_width, m_height, resolution ()); 
   }
 
+  /**
+   *  @brief Returns true, if the canvas supports drawing in tiles
+   */
+  virtual bool supports_tiles () const
+  {
+    return true;
+  }
+
+  /**
+   *  @brief Merge a plane into the plane with index n
+   */
+  virtual void merge_plane (unsigned int n, const lay::CanvasPlane *plane, const db::Box &clip);
+
   /**
    *  @brief Transfer the content to an QImage 
    */
@@ -30,6 +30,9 @@ namespace lay
 //  time delay until the first snapshot is taken
 const int first_snapshot_delay = 20;
 
+//  cells smaller than this (in pixels) are drawn from the level-of-detail rasters
+const double lod_threshold = double (CellLOD::base_size);
+
 // -------------------------------------------------------------
 //  RedrawThreadWorker implementation 
 
@@ -37,6 +40,7 @@ RedrawThreadWorker::RedrawThreadWorker (RedrawThread *redraw_thread)
   : mp_redraw_thread (redraw_thread)
 {
   mp_layout = 0;
+  mp_lod_cache = 0;
   mp_cell_var_cache = 0;
   m_cache_hits = 0;
   m_cache_misses = 0;
@@ -69,6 +73,7 @@ RedrawThreadWorker::RedrawThreadWorker (RedrawThread *redraw_thread)
   mp_prop_sel = 0;
   m_inv_prop_sel = false;
   m_clock = tl::Clock::current ();
+  m_tiled = false;
 
   for (unsigned int i = 0; i < sizeof (m_planes) / sizeof (m_planes[0]); ++i) {
     m_planes[i] = 0;
@@ -93,6 +98,11 @@ RedrawThreadWorker::perform_task (tl::Task *task)
     return;
   }
 
+  //  clean up after a tile task which has been interrupted
+  if (m_tiled) {
+    end_tile ();
+  }
+
   m_cell_cache.clear ();
   m_mi_cache.clear ();
   m_mi_text_cache.clear ();
@@ -106,6 +116,11 @@ RedrawThreadWorker::perform_task (tl::Task *task)
 
     //  draw a layer
 
+    //  if a tile is given, draw the shapes inside this tile only and merge the planes into the canvas planes
+    if (! redraw_thread_task->tile ().empty ()) {
+      begin_tile (redraw_thread_task->tile ());
+    }
+
     //  HINT: the order in which the planes are delivered (the index stored in the first member of the pair below)
     //  must correspond with the order by which the ViewOp's are created inside LayoutView::set_view_ops
     m_buffers.clear ();
@@ -113,17 +128,17 @@ RedrawThreadWorker::perform_task (tl::Task *task)
 
       //  context level planes
       unsigned int i1 = task_id * (planes_per_layer / 3) + special_planes_before + i;
-      mp_canvas->initialize_plane (m_planes[i], i1); 
+      initialize_plane (m_planes[i], i1); 
       m_buffers.push_back (std::make_pair (i1, m_planes [i]));
 
       //  child level planes (if used)
       unsigned int i2 = (task_id + m_nlayers) * (planes_per_layer / 3) + special_planes_before + i;
-      mp_canvas->initialize_plane (m_planes [i + planes_per_layer / 3], i2); 
+      initialize_plane (m_planes [i + planes_per_layer / 3], i2); 
       m_buffers.push_back (std::make_pair (i2, m_planes [i + planes_per_layer / 3]));
 
       //  current level planes
       unsigned int i3 = (task_id + m_nlayers * 2) * (planes_per_layer / 3) + special_planes_before + i;
-      mp_canvas->initialize_plane (m_planes [i + 2 * (planes_per_layer / 3)], i3); 
+      initialize_plane (m_planes [i + 2 * (planes_per_layer / 3)], i3); 
       m_buffers.push_back (std::make_pair (i3, m_planes [i + 2 * (planes_per_layer / 3)]));
 
     }
@@ -138,7 +153,7 @@ RedrawThreadWorker::perform_task (tl::Task *task)
     }
 
     std::vector<db::Box> text_redraw_regions = m_redraw_region;
-    if (! text_planes_empty) {
+    if (! text_planes_empty && ! m_tiled) {
       //  if there are non-empty text planes, redraw the whole area for texts
       text_redraw_regions.clear ();
       text_redraw_regions.push_back(db::Box(0, 0, mp_canvas->canvas_width (), mp_canvas->canvas_height ()));
@@ -180,6 +195,14 @@ RedrawThreadWorker::perform_task (tl::Task *task)
           mp_prop_sel = 0;
         }
 
+        //  the level-of-detail rasters represent the plain cells: they are not used if
+        //  the drawing is modified by hidden cells, property selection or special modes
+        mp_lod_cache = 0;
+        if (m_bitmap_caching && ! m_xfill && ! mp_prop_sel && m_abstract_mode_width <= 0.0 &&
+            (m_cv_index >= int (m_hidden_cells.size ()) || m_hidden_cells [m_cv_index].empty ())) {
+          mp_lod_cache = &cv->lod_cache ();
+        }
+
         if (li.layer_index >= 0) {
 
           m_layer = li.layer_index;
@@ -227,6 +250,7 @@ RedrawThreadWorker::perform_task (tl::Task *task)
 
         mp_prop_sel = 0;
         m_inv_prop_sel = false;
+        mp_lod_cache = 0;
 
       }
 
@@ -453,6 +477,12 @@ RedrawThreadWorker::perform_task (tl::Task *task)
 
   m_cell_cache.clear ();
 
+  if (m_tiled) {
+    end_tile ();
+    //  show the finished tile early
+    mp_redraw_thread->wakeup_checked ();
+  }
+
   mp_redraw_thread->task_finished (task_id);
 }
 
@@ -474,7 +504,11 @@ RedrawThreadWorker::finish ()
 void
 RedrawThreadWorker::setup (LayoutView *view, RedrawThreadCanvas *canvas, const std::vector<db::Box> &redraw_region, const db::DCplxTrans &vp_trans)
 {
-  m_redraw_region = redraw_region;
+  if (m_tiled) {
+    end_tile ();
+  }
+
+  m_redraw_region = m_canvas_redraw_region = redraw_region;
   m_vp_trans = vp_trans;
 
   mp_canvas = canvas;
@@ -545,10 +579,63 @@ void
 RedrawThreadWorker::transfer ()
 {
   for (std::vector<std::pair<unsigned int, lay::CanvasPlane *> >::iterator b = m_buffers.begin (); b != m_buffers.end (); ++b) {
-    mp_canvas->set_plane (b->first, b->second);
+    if (m_tiled) {
+      //  drawing is additive, so a partially drawn tile can be merged multiple times.
+      //  Only the tile plus a border of one pixel is merged - the shapes around are drawn by the
+      //  neighbouring tiles. Texts are not clipped as the glyphs may extend far beyond their anchor.
+      db::Box clip;
+      if ((b->first - special_planes_before) % (planes_per_layer / 3) == 2) {
+        clip = db::Box (0, 0, mp_canvas->canvas_width (), mp_canvas->canvas_height ());
+      } else {
+        clip = m_tile.enlarged (db::Vector (1, 1));
+      }
+      mp_canvas->merge_plane (b->first, b->second, clip);
+    } else {
+      mp_canvas->set_plane (b->first, b->second);
+    }
+  }
+}
+
+void
+RedrawThreadWorker::initialize_plane (lay::CanvasPlane *plane, unsigned int n)
+{
+  if (m_tiled) {
+    //  tile planes start empty and are merged into the canvas plane
+    plane->clear ();
+  } else {
+    mp_canvas->initialize_plane (plane, n);
+  }
+}
+
+void
+RedrawThreadWorker::begin_tile (const db::Box &tile)
+{
+  tl_assert (! m_tiled);
+  m_tiled = true;
+  m_tile = tile;
+
+  //  The pixels touched by a shape may extend a little beyond its box. Hence the drawing
+  //  region is a little larger than the tile, so the pixels merged (the tile plus one pixel)
+  //  do not depend on the tiling.
+  db::Box tile_region = tile.enlarged (db::Vector (2, 2));
+
+  m_redraw_region.clear ();
+  for (std::vector<db::Box>::const_iterator r = m_canvas_redraw_region.begin (); r != m_canvas_redraw_region.end (); ++r) {
+    db::Box rr = *r & tile_region;
+    if (! rr.empty ()) {
+      m_redraw_region.push_back (rr);
+    }
   }
 }
 
+void
+RedrawThreadWorker::end_tile ()
+{
+  tl_assert (m_tiled);
+  m_tiled = false;
+  m_redraw_region = m_canvas_redraw_region;
+}
+
 void 
 RedrawThreadWorker::test_snapshot (const UpdateSnapshotCallback *update_snapshot)
 {
@@ -1804,6 +1891,11 @@ RedrawThreadWorker::draw_layer (int from_level, int to_level, db::cell_index_typ
         mp_renderer->draw (dbbox, 0, frame, vertex, 0);
       } 
 
+    } else if (const lay::CellLOD *lod = small_cell_lod (ci, dbbox, level, to_level, fill)) {
+
+      //  small cells are drawn from the level-of-detail raster
+      lod->blit (trans, dynamic_cast<lay::Bitmap *> (fill), dynamic_cast<lay::Bitmap *> (frame), dynamic_cast<lay::Bitmap *> (vertex));
+
     } else {
 
       //  create a set of boxes to look into
@@ -1890,6 +1982,26 @@ RedrawThreadWorker::draw_layer (int from_level, int to_level, db::cell_index_typ
   }
 }
 
+const lay::CellLOD *
+RedrawThreadWorker::small_cell_lod (db::cell_index_type ci, const db::DBox &dbbox, int level, int to_level, lay::CanvasPlane *fill)
+{
+  if (! mp_lod_cache || level <= 0 || std::max (dbbox.width (), dbbox.height ()) >= lod_threshold) {
+    return 0;
+  }
+
+  //  the rasters are drawn into bitmaps only
+  if (! dynamic_cast<lay::Bitmap *> (fill)) {
+    return 0;
+  }
+
+  //  the rasters comprise all levels below the cell
+  if (to_level - level <= int (mp_layout->cell (ci).hierarchy_levels ())) {
+    return 0;
+  }
+
+  return mp_lod_cache->lod (ci, m_layer);
+}
+
 void
 RedrawThreadWorker::draw_layer (bool drawing_context, db::cell_index_type ci, const db::CplxTrans &trans, const db::Box &vp, int level)
 {
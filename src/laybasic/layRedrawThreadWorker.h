@@ -26,6 +26,7 @@
 
 #include "dbLayout.h"
 #include "layLayoutView.h"
+#include "layCellLODCache.h"
 #include "tlThreadedWorkers.h"
 #include "tlTimer.h"
 
@@ -79,13 +80,29 @@ public:
     : m_id (id)
   { }
 
+  /**
+   *  @brief Creates a task drawing a layer inside a screen tile only
+   *
+   *  The tile is given in canvas pixel coordinates. An empty tile means
+   *  the whole canvas.
+   */
+  RedrawThreadTask (int id, const db::Box &tile)
+    : m_id (id), m_tile (tile)
+  { }
+
   int id () const
   {
     return m_id;
   }
 
+  const db::Box &tile () const
+  {
+    return m_tile;
+  }
+
 private:
   int m_id;
+  db::Box m_tile;
 };
 
 /**
@@ -187,6 +204,9 @@ private:
   void draw_cell_shapes (const db::CplxTrans &trans, const db::Cell &cell, const db::Box &vp, lay::CanvasPlane *fill, lay::CanvasPlane *frame, lay::CanvasPlane *vertex, lay::CanvasPlane *text);
   void test_snapshot (const UpdateSnapshotCallback *update_snapshot);
   void transfer ();
+  void initialize_plane (lay::CanvasPlane *plane, unsigned int n);
+  void begin_tile (const db::Box &tile);
+  void end_tile ();
   void iterate_variants (const std::vector <db::Box> &redraw_regions, db::cell_index_type ci, db::CplxTrans trans, void (RedrawThreadWorker::*what) (bool, db::cell_index_type ci, const db::CplxTrans &, const db::Box &, int level));
   void iterate_variants_rec (const std::vector <db::Box> &redraw_regions, db::cell_index_type ci, const db::CplxTrans &trans, int level, void (RedrawThreadWorker::*what) (bool, db::cell_index_type ci, const db::CplxTrans &, const db::Box &, int level), bool spread);
   bool cell_var_cached (db::cell_index_type ci, const db::CplxTrans &trans);
@@ -195,12 +215,16 @@ private:
   bool any_shapes (db::cell_index_type cell_index, unsigned int levels);
   bool any_text_shapes (db::cell_index_type cell_index, unsigned int levels);
   bool any_cell_box (db::cell_index_type cell_index, unsigned int levels);
+  const lay::CellLOD *small_cell_lod (db::cell_index_type ci, const db::DBox &dbbox, int level, int to_level, lay::CanvasPlane *fill);
 
   RedrawThread *mp_redraw_thread;
   std::vector <db::Box> m_redraw_region;
   std::vector <lay::Drawing *> mp_drawings;
   lay::RedrawThreadCanvas *mp_canvas;
   lay::CanvasPlane *m_planes[planes_per_layer];
+  bool m_tiled;
+  db::Box m_tile;
+  std::vector <db::Box> m_canvas_redraw_region;
 
   std::vector<db::Box> m_vv;
   int m_from_level, m_to_level;
@@ -230,6 +254,7 @@ private:
   std::vector <std::set <lay::LayoutView::cell_index_type> > m_hidden_cells;
   std::vector <lay::CellView> m_cellviews;
   const db::Layout *mp_layout;
+  lay::CellLODCache *mp_lod_cache;
   int m_cv_index;
   unsigned int m_layer;
   int m_nlayers;
@@ -92,6 +92,7 @@ SOURCES = \
   layAbstractMenuProvider.cc \
   layAnnotationShapes.cc \
   layBitmap.cc \
+  layBitmapKernels.cc \
   layBitmapRenderer.cc \
   layBitmapsToImage.cc \
   layBookmarkList.cc \
@@ -102,6 +103,7 @@ SOURCES = \
   layBrowserPanel.cc \
   layBrowseShapesForm.cc \
   layCanvasPlane.cc \
+  layCellLODCache.cc \
   layCellSelectionForm.cc \
   layCellTreeModel.cc \
   layCellView.cc \
@@ -126,6 +128,7 @@ SOURCES = \
   layGDS2ReaderPlugin.cc \
   layGDS2WriterPlugin.cc \
   layGridNet.cc \
+  layHeadlessRenderer.cc \
   layHierarchyControlPanel.cc \
   layLayerControlPanel.cc \
   layLayerMappingWidget.cc \
@@ -186,6 +189,7 @@ HEADERS = \
   layAbstractMenuProvider.h \
   layAnnotationShapes.h \
   layBitmap.h \
+  layBitmapKernels.h \
   layBitmapRenderer.h \
   layBitmapsToImage.h \
   layBookmarkList.h \
@@ -196,6 +200,7 @@ HEADERS = \
   layBrowserPanel.h \
   layBrowseShapesForm.h \
   layCanvasPlane.h \
+  layCellLODCache.h \
   layCellSelectionForm.h \
   layCellTreeModel.h \
   layCellView.h \
@@ -220,6 +225,7 @@ HEADERS = \
   layGDS2ReaderPlugin.h \
   layGDS2WriterPlugin.h \
   layGridNet.h \
+  layHeadlessRenderer.h \
   layHierarchyControlPanel.h \
   layLayerControlPanel.h \
   layLayerMappingWidget.h \
@@ -29,6 +29,7 @@ SOURCES = \
   tlInternational.cc \
   tlLog.cc \
   tlObject.cc \
+  tlPixelBuffer.cc \
   tlProgress.cc \
   tlScriptError.cc \
   tlStaticObjects.cc \
@@ -64,6 +65,7 @@ HEADERS = \
   tlLog.h \
   tlObject.h \
   tlObjectCollection.h \
+  tlPixelBuffer.h \
   tlProgress.h \
   tlReuseVector.h \
   tlScriptError.h \
@@ -26,22 +26,58 @@
 #include "tlAssert.h"
 
 #include <algorithm>
+#include <vector>
+#include <string.h>
 
 #include <zlib.h>
 
 namespace tl
 {
 
+// ------------------------------------------------------------------------
+//  BitStream implementation
+
+void
+BitStream::fill ()
+{
+  //  read as many bytes as fit into the bit buffer
+  unsigned int n = (64 - m_nbits) / 8;
+  if (n == 0) {
+    return;
+  }
+
+  const char *b = mp_input->get (n, true /*bypass_deflate*/);
+  if (b) {
+    for (unsigned int i = 0; i < n; ++i) {
+      m_bits |= (unsigned long long) (unsigned char) b [i] << m_nbits;
+      m_nbits += 8;
+    }
+  } else {
+    //  close to the end of the stream: take what is available
+    while (n-- > 0 && (b = mp_input->get (1, true /*bypass_deflate*/)) != 0) {
+      m_bits |= (unsigned long long) (unsigned char) *b << m_nbits;
+      m_nbits += 8;
+    }
+  }
+}
+
 // ------------------------------------------------------------------------
 //  The Huffmann decoder core
 
 /**
  *  @brief The decoder for Huffmann codes
  *
- *  The decoder keeps a Huffmann code tree and decodes a value from a bit stream
- *  using this tree. 
- *  As specified by RFC1951, the code tree is constructed from a list of code lengths
+ *  The decoder keeps a lookup table and decodes a value from a bit stream
+ *  using this table. 
+ *  As specified by RFC1951, the codes are constructed from a list of code lengths
  *  vs. value alone.
+ *
+ *  The table is indexed with the next bits of the stream. Codes up to the 
+ *  root size are resolved by a single lookup. Longer codes are resolved with a 
+ *  second lookup into a sub-table. The table entries hold the value in the upper
+ *  16 bits and the code length in the lower bits. Entries pointing to sub-tables
+ *  hold the offset of the sub-table in the upper 16 bits, the link flag and the 
+ *  number of bits for the sub-table index.
  */
 class HuffmannDecoder
 {
@@ -49,29 +85,12 @@ public:
   /**
    *  @brief Constructor
    *  
-   *  Creates an empty code tree.
+   *  Creates an empty decoder.
    */
   HuffmannDecoder ()
+    : m_root_bits (0)
   {
-    mp_codes = 0;
-    mp_bitmasks = 0;
-    m_max_bits = 0;
-    m_num_codes = 0;
-  }
-
-  /**
-   *  @brief Destructor
-   */
-  ~HuffmannDecoder ()
-  {
-    if (mp_codes) {
-      delete [] mp_codes;
-    }
-    mp_codes = 0;
-    if (mp_bitmasks) {
-      delete [] mp_bitmasks;
-    }
-    mp_bitmasks = 0;
+    m_table.push_back (0);
   }
 
   /**
@@ -82,8 +101,6 @@ public:
    */
   void fill_fixed_table_length ()
   {
-    reserve (9);
-
     unsigned short lengths [288];
     for (unsigned int i = 0; i < 144; ++i) {
       lengths[i] = 8;
@@ -109,8 +126,6 @@ public:
    */
   void fill_fixed_table_dist ()
   {
-    reserve (5);
-
     unsigned short lengths [32];
     for (unsigned int i = 0; i < 32; ++i) {
       lengths[i] = 5;
@@ -119,9 +134,9 @@ public:
   }
 
   /**
-   *  @brief Initialize the code tree from a list of lengths
+   *  @brief Initialize the lookup table from a list of lengths
    *
-   *  This method initializes the code tree from a list of lengths, given 
+   *  This method initializes the table from a list of lengths, given 
    *  by the sequence [begin_lengths, end_lengths). The codes are assumed to 
    *  range from 0 to distance(begin_lengths, end_lengths).
    *  See RFC1951 for a description about the procedure.
@@ -129,10 +144,9 @@ public:
   template <class Iter>
   void init_codes (Iter begin_lengths, Iter end_lengths)
   {
-    const unsigned int MAX_BITS = 16;
-    unsigned short bl_count[MAX_BITS + 1];
-    unsigned short bitmasks[MAX_BITS + 1];
-    unsigned short next_code[MAX_BITS + 1];
+    const unsigned int MAX_BITS = 15;
+    unsigned int bl_count[MAX_BITS + 1];
+    unsigned int next_code[MAX_BITS + 1];
     unsigned int max_bits = 0;
 
     for (unsigned int bits = 0; bits <= MAX_BITS; bits++) {
@@ -140,35 +154,63 @@ public:
     }
 
     for (Iter l = begin_lengths; l != end_lengths; ++l) {
-      tl_assert (*l < MAX_BITS);
+      tl_assert (*l <= MAX_BITS);
       if (*l > 0) {
         ++bl_count [*l];
+        max_bits = std::max (max_bits, (unsigned int) *l);
       }
     }
 
     unsigned int code = 0;
     for (unsigned int bits = 1; bits <= MAX_BITS; bits++) {
-      if (bl_count[bits - 1] > 0) {
-        max_bits = bits - 1;
-      }
       code = (code + bl_count[bits - 1]) << 1;
       next_code[bits] = code;
     }
 
-    for (unsigned int bits = 0; bits <= max_bits; bits++) {
-      bitmasks [bits] = ((1 << bits) - 1) << (max_bits - bits);
-    }
+    m_root_bits = max_bits < root_bits ? max_bits : root_bits;
+    unsigned int sub_bits = max_bits - m_root_bits;
 
-    reserve (max_bits);
+    m_table.clear ();
+    m_table.resize (size_t (1) << m_root_bits, 0);
 
-    unsigned short symbol = 0;
+    unsigned int symbol = 0;
     for (Iter l = begin_lengths; l != end_lengths; ++l, ++symbol) {
-      if (*l > 0) {
-        unsigned int code = next_code [*l]++;
-        code <<= (max_bits - *l);
-        mp_codes [code] = symbol;
-        mp_bitmasks [code] = bitmasks [*l];
-      } 
+
+      unsigned int len = *l;
+      if (len == 0) {
+        continue;
+      }
+
+      //  the codes are stored most significant bit first, hence the table index is the reversed code
+      unsigned int c = next_code [len]++;
+      unsigned int rev = 0;
+      for (unsigned int i = 0; i < len; ++i) {
+        rev = (rev << 1) | ((c >> i) & 1);
+      }
+
+      if (len <= m_root_bits) {
+
+        for (unsigned int i = rev; i < (1u << m_root_bits); i += (1u << len)) {
+          m_table [i] = (symbol << 16) | len;
+        }
+
+      } else {
+
+        unsigned int root_index = rev & ((1u << m_root_bits) - 1);
+        if ((m_table [root_index] & link_flag) == 0) {
+          unsigned int offset = (unsigned int) m_table.size ();
+          m_table.resize (m_table.size () + (size_t (1) << sub_bits), 0);
+          m_table [root_index] = (offset << 16) | link_flag | sub_bits;
+        }
+
+        unsigned int offset = m_table [root_index] >> 16;
+        unsigned int sub_len = len - m_root_bits;
+        for (unsigned int i = rev >> m_root_bits; i < (1u << sub_bits); i += (1u << sub_len)) {
+          m_table [offset + i] = (symbol << 16) | sub_len;
+        }
+
+      }
+
     }
   }
 
@@ -176,50 +218,61 @@ public:
    *  @brief Decode the next value from a bit stream
    *
    *  This method takes the next value from the bit stream decoding the bits with
-   *  the code tree currently loaded.
+   *  the code table currently loaded.
    */
-  unsigned short decode (BitStream &s) const
+  unsigned int decode (BitStream &s) const
   {
-    tl_assert (mp_codes != 0);
-
-    unsigned int m = m_num_codes / 2;
-    
-    unsigned int c = 0;
-    do {
-      if (s.get_bit ()) {
-        c |= m;
-      }
-      m >>= 1;
-    } while ((mp_bitmasks [c] & m) != 0);
+    unsigned int e = m_table [s.peek_bits (m_root_bits)];
+
+    if ((e & link_flag) != 0) {
+      s.skip_bits (m_root_bits);
+      e = m_table [(e >> 16) + s.peek_bits (e & length_mask)];
+    }
+
+    unsigned int len = e & length_mask;
+    if (len == 0) {
+      throw tl::Exception (tl::to_string (QObject::tr ("Invalid Huffmann code (DEFLATE implementation)")));
+    }
 
-    return mp_codes [c];
+    s.skip_bits (len);
+    return e >> 16;
   }
 
 private:
-  unsigned short *mp_codes, *mp_bitmasks;
-  unsigned int m_num_codes, m_max_bits;
+  static const unsigned int root_bits = 9;
+  static const unsigned int link_flag = 0x20;
+  static const unsigned int length_mask = 0x1f;
 
-  void reserve (unsigned int max_bits)
-  {
-    m_num_codes = 1 << max_bits;
-    if (max_bits > m_max_bits) {
-      m_max_bits = max_bits;
-      if (mp_codes) {
-        delete [] mp_codes;
-      }
-      mp_codes = new unsigned short [m_num_codes];
-      if (mp_bitmasks) {
-        delete [] mp_bitmasks;
-      }
-      mp_bitmasks = new unsigned short [m_num_codes];
-    }
-  }
+  std::vector<unsigned int> m_table;
+  unsigned int m_root_bits;
 };
 
 
 // ------------------------------------------------------------------------
 //  InflateFilter implementation
 
+//  Base values and extra bits for length codes 257 to 285 (RFC1951)
+static const unsigned short length_base [] = {
+  3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 
+  35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+
+static const unsigned char length_extra [] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+  3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+//  Base values and extra bits for distance codes 0 to 29 (RFC1951)
+static const unsigned short dist_base [] = {
+  1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 
+  257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+
+static const unsigned char dist_extra [] = {
+  0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+  7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
 InflateFilter::InflateFilter (tl::InputStream &input)
   : m_input (input), 
     m_b_insert (0), m_b_read (0), m_at_end (false),
@@ -293,102 +346,84 @@ InflateFilter::put_byte (char b)
 }
 
 void 
-InflateFilter::put_byte_dist (unsigned int d) 
+InflateFilter::copy_dist (unsigned int d, unsigned int length) 
 {
-  put_byte (m_buffer [(m_b_insert - d) % sizeof (m_buffer)]);
+  const unsigned int mask = sizeof (m_buffer) - 1;
+  unsigned int from = (m_b_insert - d) & mask;
+
+  if (d >= length && from + length <= sizeof (m_buffer) && m_b_insert + length <= sizeof (m_buffer)) {
+
+    //  fast path: no overlap and no wrap
+    memcpy (m_buffer + m_b_insert, m_buffer + from, length);
+    m_b_insert = (m_b_insert + length) & mask;
+
+  } else {
+
+    //  overlapping copy (e.g. repetitions of the last bytes) or wrapping at the end of the buffer
+    while (length-- > 0) {
+      m_buffer [m_b_insert] = m_buffer [from];
+      m_b_insert = (m_b_insert + 1) & mask;
+      from = (from + 1) & mask;
+    }
+
+  }
 }
 
 bool 
 InflateFilter::process ()
 {
-  while (true) {
+  //  decode until the buffer is half filled (get delivers up to half of the buffer)
+  const unsigned int fill_limit = sizeof (m_buffer) / 2;
 
-    bool new_block = false;
+  bool any = false;
 
-    if (m_uncompressed_length == 0) {
-
-      m_uncompressed_length = -1;
-      new_block = true;
+  while (true) {
 
-    } else if (m_uncompressed_length > 0) {
+    if (m_uncompressed_length > 0) {
 
       put_byte (m_input.get_byte ());
       --m_uncompressed_length;
+      any = true;
 
-    } else {
+    } else if (m_uncompressed_length < 0) {
 
       unsigned int l = mp_lit_decoder->decode (m_input);
       if (l < 256) {
 
         put_byte (char (l));
+        any = true;
 
       } else if (l == 256) {
 
-        new_block = true;
+        //  end of block
+        m_uncompressed_length = 0;
 
-      } else {
+      } else if (l <= 285) {
 
-        unsigned int length = 0;
-        if (l < 265) {
-          length = l - 254;
-        } else if (l < 269) {
-          length = (l - 265) * 2 + 11 + m_input.get_bits (1);
-        } else if (l < 273) {
-          length = (l - 269) * 4 + 19 + m_input.get_bits (2);
-        } else if (l < 277) {
-          length = (l - 273) * 8 + 35 + m_input.get_bits (3);
-        } else if (l < 281) {
-          length = (l - 277) * 16 + 67 + m_input.get_bits (4);
-        } else if (l < 285) {
-          length = (l - 281) * 32 + 131 + m_input.get_bits (5);
-        } else {
-          length = 258;
-        }
+        unsigned int length = length_base [l - 257] + m_input.get_bits (length_extra [l - 257]);
 
         unsigned int d = mp_dist_decoder->decode (m_input);
-        unsigned int dist = 0;
-        if (d < 4) {
-          dist = d + 1;
-        } else if (d < 6) {
-          dist = (d - 4) * 2 + 5 + m_input.get_bits (1);
-        } else if (d < 8) {
-          dist = (d - 6) * 4 + 9 + m_input.get_bits (2);
-        } else if (d < 10) {
-          dist = (d - 8) * 8 + 17 + m_input.get_bits (3);
-        } else if (d < 12) {
-          dist = (d - 10) * 16 + 33 + m_input.get_bits (4);
-        } else if (d < 14) {
-          dist = (d - 12) * 32 + 65 + m_input.get_bits (5);
-        } else if (d < 16) {
-          dist = (d - 14) * 64 + 129 + m_input.get_bits (6);
-        } else if (d < 18) {
-          dist = (d - 16) * 128 + 257 + m_input.get_bits (7);
-        } else if (d < 20) {
-          dist = (d - 18) * 256 + 513 + m_input.get_bits (8);
-        } else if (d < 22) {
-          dist = (d - 20) * 512 + 1025 + m_input.get_bits (9);
-        } else if (d < 24) {
-          dist = (d - 22) * 1024 + 2049 + m_input.get_bits (10);
-        } else if (d < 26) {
-          dist = (d - 24) * 2048 + 4097 + m_input.get_bits (11);
-        } else if (d < 28) {
-          dist = (d - 26) * 4096 + 8193 + m_input.get_bits (12);
-        } else {
-          dist = (d - 28) * 8192 + 16385 + m_input.get_bits (13);
+        if (d >= sizeof (dist_base) / sizeof (dist_base [0])) {
+          throw tl::Exception (tl::to_string (QObject::tr ("Invalid distance code: %d (DEFLATE implementation)")), d);
         }
 
-        while (length-- > 0) {
-          put_byte_dist (dist);
-        }
+        unsigned int dist = dist_base [d] + m_input.get_bits (dist_extra [d]);
 
+        copy_dist (dist, length);
+        any = true;
+
+      } else {
+        throw tl::Exception (tl::to_string (QObject::tr ("Invalid length code: %d (DEFLATE implementation)")), l);
       }
 
     }
 
-    if (new_block) {
+    if (m_uncompressed_length == 0) {
 
       if (m_last_block) {
-        return false;
+        //  end of the compressed data: return the bytes read ahead to the input stream
+        m_input.release ();
+        return any;
       }
 
       //  read new block header
@@ -403,6 +438,8 @@ InflateFilter::process ()
         m_input.get_bits (16);
 
       } else if (t == 1 || t == 2) {
+
+        m_uncompressed_length = -1;
         
         if (t == 1) {
 
@@ -437,7 +474,7 @@ InflateFilter::process ()
 
           for (unsigned int i = 0; i < nlengths; ) {
 
-            unsigned short l = ldecoder.decode (m_input);
+            unsigned int l = ldecoder.decode (m_input);
             if (l < 16) {
               lengths [i++] = l;
             } else if (l == 16) {
@@ -475,7 +512,7 @@ InflateFilter::process ()
         throw tl::Exception (tl::to_string (QObject::tr ("Invalid compression type: %d")), t);
       }
 
-    } else {
+    } else if (any && (m_b_insert + sizeof (m_buffer) - m_b_read) % sizeof (m_buffer) >= fill_limit) {
       return true;
     }
 
@@ -486,7 +523,7 @@ InflateFilter::process ()
 //  DeflateFilter implementation
 //  This implementation is based on the zlib
 
-DeflateFilter::DeflateFilter (tl::OutputStream &output)
+DeflateFilter::DeflateFilter (tl::OutputStream &output, int level)
   : m_finished (false), mp_output (&output), m_uc (0), m_cc (0)
 {
   mp_stream = new z_stream ();
@@ -498,7 +535,7 @@ DeflateFilter::DeflateFilter (tl::OutputStream &output)
   mp_stream->next_out = (Byte *)m_buffer;
   mp_stream->avail_out = sizeof (m_buffer);
 
-  int err = deflateInit2 (mp_stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15 /* == raw deflate data*/, 8 /* == default memory level */, Z_DEFAULT_STRATEGY);
+  int err = deflateInit2 (mp_stream, level < 0 ? Z_DEFAULT_COMPRESSION : std::min (level, 9), Z_DEFLATED, -15 /* == raw deflate data*/, 8 /* == default memory level */, Z_DEFAULT_STRATEGY);
   tl_assert (err == Z_OK);
 }
 
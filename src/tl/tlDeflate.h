@@ -43,6 +43,10 @@ class HuffmannDecoder;
  *  This filter reads bytes from a tl::Stream and delivers bits, taken from
  *  these bytes. The bits are delivered in the order specified by the DEFLATE
  *  format specification (least significant bit first).
+ *
+ *  The bits are buffered in a 64 bit word which is filled with multiple bytes
+ *  at once. Hence the stream is read ahead by a few bytes. "release" puts
+ *  back the bytes not consumed.
  */
 class TL_PUBLIC BitStream
 {
@@ -54,7 +58,7 @@ public:
    */
   BitStream (tl::InputStream &input)
     : mp_input (&input),
-      m_mask (0), m_byte (0)
+      m_bits (0), m_nbits (0)
   {
     // ...
   }
@@ -62,17 +66,13 @@ public:
   /**
    *  @brief Get a byte
    *
-   *  This method simply passes the byte.
+   *  This method skips the bits up to the next byte boundary and delivers the next byte.
    *  The method expects the next byte to be available.
    */
   unsigned char get_byte ()
   {
-    m_mask = 0;
-    const char *c = mp_input->get (1, true /*bypass_deflate*/);
-    if (c == 0) {
-      throw tl::Exception (tl::to_string (QObject::tr ("Unexpected end of file (DEFLATE implementation)")));
-    }
-    return *c;
+    skip_to_byte ();
+    return (unsigned char) get_bits (8);
   }
 
   /**
@@ -83,13 +83,7 @@ public:
    */
   bool get_bit ()
   {
-    if (m_mask == 0) {
-      m_byte = get_byte ();
-      m_mask = 0x01;
-    } 
-    bool b = ((m_byte & m_mask) != 0);
-    m_mask <<= 1;
-    return b;
+    return get_bits (1) != 0;
   }
 
   /**
@@ -97,32 +91,76 @@ public:
    *
    *  This method gets the next n bits and delivers them as a single unsigned int,
    *  packing the first bit into the least signification bit. This is the specification
-   *  for reading multiple bit values except Huffmann codes.
+   *  for reading multiple bit values except Huffmann codes. n must not be larger than 32.
    */
   unsigned int get_bits (unsigned int n)
   {
-    //  KLUDGE: take directly from the byte for performance.
-    unsigned int r = 0;
-    unsigned int m = 1;
-    while (n-- > 0) {
-      r |= get_bit () ? m : 0;
-      m <<= 1;
+    if (m_nbits < n) {
+      fill ();
+      if (m_nbits < n) {
+        throw tl::Exception (tl::to_string (QObject::tr ("Unexpected end of file (DEFLATE implementation)")));
+      }
     }
+    unsigned int r = (unsigned int) (m_bits & ((1ull << n) - 1));
+    m_bits >>= n;
+    m_nbits -= n;
     return r;
   }
 
+  /**
+   *  @brief Peeks at the next n bits without consuming them
+   *
+   *  Bits beyond the end of the stream are delivered as zero. n must not be larger than 32.
+   */
+  unsigned int peek_bits (unsigned int n)
+  {
+    if (m_nbits < n) {
+      fill ();
+    }
+    return (unsigned int) (m_bits & ((1ull << n) - 1));
+  }
+
+  /**
+   *  @brief Consumes n bits which have been obtained with peek_bits before
+   */
+  void skip_bits (unsigned int n)
+  {
+    if (m_nbits < n) {
+      throw tl::Exception (tl::to_string (QObject::tr ("Unexpected end of file (DEFLATE implementation)")));
+    }
+    m_bits >>= n;
+    m_nbits -= n;
+  }
+
   /**
    *  @brief Skip the next bits up to the next byte boundary
    */
   void skip_to_byte ()
   {
-    m_mask = 0;
+    unsigned int n = m_nbits % 8;
+    m_bits >>= n;
+    m_nbits -= n;
+  }
+
+  /**
+   *  @brief Puts back the bytes read ahead but not consumed into the input stream
+   */
+  void release ()
+  {
+    skip_to_byte ();
+    if (m_nbits > 0) {
+      mp_input->unget (m_nbits / 8, true /*bypass_inflate*/);
+    }
+    m_bits = 0;
+    m_nbits = 0;
   }
 
 private:
   tl::InputStream *mp_input;
-  unsigned char m_mask;
-  unsigned char m_byte;
+  unsigned long long m_bits;
+  unsigned int m_nbits;
+
+  void fill ();
 };
 
 
@@ -138,8 +176,11 @@ class TL_PUBLIC DeflateFilter
 public:
   /**
    *  @brief Constructor: creates a filter in front of the output stream
+   *
+   *  "level" is the compression level from 0 (no compression) to 9 (best compression).
+   *  -1 selects the default level which is a good compromise between speed and size.
    */
-  DeflateFilter (tl::OutputStream &output);
+  DeflateFilter (tl::OutputStream &output, int level = -1);
 
   /**
    *  @brief Destructor
@@ -243,7 +284,7 @@ private:
   HuffmannDecoder *mp_lit_decoder, *mp_dist_decoder;
 
   void put_byte (char b);
-  void put_byte_dist (unsigned int d);
+  void copy_dist (unsigned int d, unsigned int length);
   bool process ();
 
 };
@@ -0,0 +1,254 @@
+
+/*
+
+  KLayout Layout Viewer
+  Copyright (C) 2006-2017 Matthias Koefferlein
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+
+#include "tlPixelBuffer.h"
+#include "tlException.h"
+#include "tlInternational.h"
+
+#include <algorithm>
+#include <string.h>
+
+#include <zlib.h>
+
+namespace tl
+{
+
+// ------------------------------------------------------------------------
+//  PixelBuffer implementation
+
+PixelBuffer::PixelBuffer ()
+  : m_width (0), m_height (0), m_transparent (false)
+{
+  //  .. nothing yet ..
+}
+
+PixelBuffer::PixelBuffer (unsigned int w, unsigned int h)
+  : m_width (w), m_height (h), m_transparent (false)
+{
+  m_data.resize (size_t (w) * size_t (h));
+}
+
+void
+PixelBuffer::fill (color_t c)
+{
+  std::fill (m_data.begin (), m_data.end (), c);
+}
+
+// ------------------------------------------------------------------------
+//  PNG writer implementation
+
+namespace
+{
+
+/**
+ *  @brief A helper class to write the PNG chunks
+ *
+ *  The IDAT chunks are produced from the deflate output buffer as it fills up.
+ */
+class PNGWriter
+{
+public:
+  PNGWriter (tl::OutputStream &os, int level)
+    : m_os (os), m_buffer (65536)
+  {
+    memset (&m_zs, 0, sizeof (m_zs));
+    if (deflateInit (&m_zs, level) != Z_OK) {
+      throw tl::Exception (tl::to_string (QObject::tr ("Unable to initialize compression for PNG stream")));
+    }
+    m_zs.next_out = &m_buffer [0];
+    m_zs.avail_out = (uInt) m_buffer.size ();
+  }
+
+  ~PNGWriter ()
+  {
+    deflateEnd (&m_zs);
+  }
+
+  void write_chunk (const char *type, const unsigned char *data, size_t n)
+  {
+    unsigned char hdr [8];
+    put_uint32 (hdr, (uint32_t) n);
+    memcpy (hdr + 4, type, 4);
+    m_os.put ((const char *) hdr, sizeof (hdr));
+    if (n > 0) {
+      m_os.put ((const char *) data, n);
+    }
+
+    uLong crc = crc32 (0L, Z_NULL, 0);
+    crc = crc32 (crc, (const Bytef *) type, 4);
+    if (n > 0) {
+      crc = crc32 (crc, (const Bytef *) data, (uInt) n);
+    }
+
+    unsigned char crc_bytes [4];
+    put_uint32 (crc_bytes, (uint32_t) crc);
+    m_os.put ((const char *) crc_bytes, sizeof (crc_bytes));
+  }
+
+  void compress (const unsigned char *data, size_t n, bool finish)
+  {
+    m_zs.next_in = (Bytef *) data;
+    m_zs.avail_in = (uInt) n;
+
+    while (true) {
+
+      int ret = deflate (&m_zs, finish ? Z_FINISH : Z_NO_FLUSH);
+      if (ret == Z_STREAM_ERROR) {
+        throw tl::Exception (tl::to_string (QObject::tr ("Compression error while writing PNG stream")));
+      }
+
+      if (finish && ret == Z_STREAM_END) {
+        break;
+      } else if (m_zs.avail_out == 0) {
+        flush_idat ();
+      } else if (! finish && m_zs.avail_in == 0) {
+        break;
+      }
+
+    }
+
+    if (finish) {
+      flush_idat ();
+    }
+  }
+
+  static void put_uint32 (unsigned char *b, uint32_t v)
+  {
+    b [0] = (unsigned char) (v >> 24);
+    b [1] = (unsigned char) (v >> 16);
+    b [2] = (unsigned char) (v >> 8);
+    b [3] = (unsigned char) v;
+  }
+
+private:
+  tl::OutputStream &m_os;
+  z_stream m_zs;
+  std::vector<unsigned char> m_buffer;
+
+  void flush_idat ()
+  {
+    size_t n = m_buffer.size () - m_zs.avail_out;
+    if (n > 0) {
+      write_chunk ("IDAT", &m_buffer [0], n);
+    }
+    m_zs.next_out = &m_buffer [0];
+    m_zs.avail_out = (uInt) m_buffer.size ();
+  }
+};
+
+/**
+ *  @brief Computes the PNG filter cost of a filtered line (sum of absolute values of the signed bytes)
+ */
+static unsigned long
+filter_cost (const unsigned char *b, size_t n)
+{
+  unsigned long c = 0;
+  for (size_t i = 0; i < n; ++i) {
+    c += b [i] < 128 ? b [i] : 256 - b [i];
+  }
+  return c;
+}
+
+}
+
+void
+PixelBuffer::write_png (tl::OutputStream &output, int level) const
+{
+  //  PNG does not allow empty images
+  if (m_width == 0 || m_height == 0) {
+    throw tl::Exception (tl::to_string (QObject::tr ("Cannot write an empty image to PNG stream")));
+  }
+
+  static const unsigned char signature [] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+  output.put ((const char *) signature, sizeof (signature));
+
+  PNGWriter writer (output, level);
+
+  unsigned int bpp = m_transparent ? 4 : 3;
+
+  unsigned char ihdr [13];
+  PNGWriter::put_uint32 (ihdr, m_width);
+  PNGWriter::put_uint32 (ihdr + 4, m_height);
+  ihdr [8] = 8;                         //  bit depth
+  ihdr [9] = m_transparent ? 6 : 2;     //  color type: RGBA or RGB
+  ihdr [10] = 0;                        //  compression method
+  ihdr [11] = 0;                        //  filter method
+  ihdr [12] = 0;                        //  no interlace
+  writer.write_chunk ("IHDR", ihdr, sizeof (ihdr));
+
+  size_t n = size_t (m_width) * bpp;
+
+  //  raw lines (previous and current) and the filtered candidates, each with the filter type byte in front
+  std::vector<unsigned char> prev (n, 0), raw (n, 0);
+  std::vector<unsigned char> none (n + 1), sub (n + 1), up (n + 1);
+  none [0] = 0;
+  sub [0] = 1;
+  up [0] = 2;
+
+  for (unsigned int y = 0; y < m_height; ++y) {
+
+    const color_t *sl = scan_line (y);
+    unsigned char *r = &raw [0];
+    for (unsigned int x = 0; x < m_width; ++x) {
+      color_t c = sl [x];
+      *r++ = (unsigned char) (c >> 16);
+      *r++ = (unsigned char) (c >> 8);
+      *r++ = (unsigned char) c;
+      if (bpp == 4) {
+        *r++ = (unsigned char) (c >> 24);
+      }
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+      none [i + 1] = raw [i];
+      sub [i + 1] = (unsigned char) (raw [i] - (i >= bpp ? raw [i - bpp] : 0));
+      up [i + 1] = (unsigned char) (raw [i] - prev [i]);
+    }
+
+    //  select the filter with the minimum sum of absolute differences
+    const std::vector<unsigned char> *best = &none;
+    unsigned long best_cost = filter_cost (&none [1], n);
+    unsigned long c = filter_cost (&sub [1], n);
+    if (c < best_cost) {
+      best = &sub;
+      best_cost = c;
+    }
+    c = filter_cost (&up [1], n);
+    if (c < best_cost) {
+      best = &up;
+      best_cost = c;
+    }
+
+    writer.compress (&(*best) [0], n + 1, false);
+
+    prev.swap (raw);
+
+  }
+
+  writer.compress (0, 0, true);
+
+  writer.write_chunk ("IEND", 0, 0);
+}
+
+}
+
@@ -0,0 +1,146 @@
+
+/*
+
+  KLayout Layout Viewer
+  Copyright (C) 2006-2017 Matthias Koefferlein
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+
+
+#ifndef HDR_tlPixelBuffer
+#define HDR_tlPixelBuffer
+
+#include "tlCommon.h"
+#include "tlStream.h"
+
+#include <vector>
+#include <stdint.h>
+
+namespace tl
+{
+
+/**
+ *  @brief The pixel type of the pixel buffer
+ *
+ *  The format is 0xAARRGGBB. For non-transparent buffers, the alpha channel is ignored.
+ */
+typedef uint32_t color_t;
+
+/**
+ *  @brief An image buffer of 32 bit pixels which does not require any GUI toolkit
+ *
+ *  This buffer is used as a drawing target for batch rendering and
+ *  can be written to a PNG stream without QImage. The layout of the scan lines
+ *  is the same than that of QImage with format RGB32 or ARGB32: scan line 0 is the
+ *  top line of the image.
+ */
+class TL_PUBLIC PixelBuffer
+{
+public:
+  /**
+   *  @brief Creates an empty buffer
+   */
+  PixelBuffer ();
+
+  /**
+   *  @brief Creates a buffer with the given width and height
+   *
+   *  The pixels are not initialized.
+   */
+  PixelBuffer (unsigned int w, unsigned int h);
+
+  /**
+   *  @brief Gets the width of the buffer
+   */
+  unsigned int width () const
+  {
+    return m_width;
+  }
+
+  /**
+   *  @brief Gets the height of the buffer
+   */
+  unsigned int height () const
+  {
+    return m_height;
+  }
+
+  /**
+   *  @brief Sets a value indicating whether the alpha channel is significant
+   */
+  void set_transparent (bool f)
+  {
+    m_transparent = f;
+  }
+
+  /**
+   *  @brief Gets a value indicating whether the alpha channel is significant
+   */
+  bool transparent () const
+  {
+    return m_transparent;
+  }
+
+  /**
+   *  @brief Fills the buffer with the given color
+   */
+  void fill (color_t c);
+
+  /**
+   *  @brief Gets the scan line with the given index
+   */
+  color_t *scan_line (unsigned int n)
+  {
+    return &m_data [0] + size_t (n) * m_width;
+  }
+
+  /**
+   *  @brief Gets the scan line with the given index (const version)
+   */
+  const color_t *scan_line (unsigned int n) const
+  {
+    return &m_data [0] + size_t (n) * m_width;
+  }
+
+  /**
+   *  @brief Gets the pixel at the given position
+   */
+  color_t pixel (unsigned int x, unsigned int y) const
+  {
+    return scan_line (y) [x];
+  }
+
+  /**
+   *  @brief Writes the buffer as a PNG image to the given stream
+   *
+   *  The image is written with 8 bit RGB or RGBA (if transparent) color type.
+   *  "level" is the zlib compression level (0 to 9 or -1 for the default).
+   *  Empty images cannot be written and an exception is thrown for them.
+   */
+  void write_png (tl::OutputStream &output, int level = -1) const;
+
+private:
+  unsigned int m_width, m_height;
+  bool m_transparent;
+  std::vector<color_t> m_data;
+};
+
+}
+
+#endif
+
@@ -28,8 +28,12 @@
 #include <sys/stat.h>
 #include <stdio.h>
 #include <errno.h>
+#include <limits>
 #ifdef _WIN32 
 #  include <io.h>
+#else
+#  include <unistd.h>
+#  include <sys/mman.h>
 #endif
 
 #include "tlStream.h"
@@ -230,6 +234,88 @@ private:
   int m_fd;
 };
 
+#if !defined(_WIN32)
+
+/**
+ *  @brief A memory-mapped input file delegate
+ *
+ *  Implements the reader for plain (uncompressed) local files by mapping
+ *  the file into memory. InputStream will deliver the data directly from
+ *  the mapped block (see mapped_data).
+ *
+ *  The file must not be truncated while it is mapped: accessing the pages 
+ *  beyond the new end of the file raises SIGBUS. source_modified () checks
+ *  the file against the state it had when it was mapped.
+ */
+class InputMappedFile
+  : public InputStreamBase
+{
+public:
+  /**
+   *  @brief Open and map a file with the given path
+   *
+   *  This constructor does not throw. If the file cannot be opened or
+   *  mapped (i.e. because it is not a regular file or because it is 
+   *  gzip-compressed), is_mapped () will return false. 
+   *
+   *  @param path The (relative) path of the file to open
+   */
+  InputMappedFile (const std::string &path);
+
+  /**
+   *  @brief Unmap and close the file
+   */
+  virtual ~InputMappedFile ();
+
+  /**
+   *  @brief Returns true, if the file could be mapped
+   */
+  bool is_mapped () const
+  {
+    return mp_data != 0;
+  }
+
+  /**
+   *  @brief Read from the file 
+   *
+   *  This method is provided for completeness - usually InputStream will
+   *  take the data from the mapped block directly.
+   */
+  virtual size_t read (char *b, size_t n);
+
+  virtual void reset ();
+
+  virtual std::string source () const
+  {
+    return m_source;
+  }
+
+  virtual std::string absolute_path () const;
+
+  virtual std::string filename () const;
+
+  virtual const char *mapped_data (size_t &length)
+  {
+    length = m_length;
+    return mp_data;
+  }
+
+  virtual bool source_modified () const;
+
+private:
+  std::string m_source;
+  const char *mp_data;
+  size_t m_length, m_pos;
+  dev_t m_dev;
+  ino_t m_ino;
+  off_t m_size;
+  time_t m_mtime;
+
+  void unmap ();
+};
+
+#endif
+
 /**
  *  @brief A simple pipe input delegate
  *
@@ -303,16 +389,37 @@ private:
 // ---------------------------------------------------------------
 //  InputStream implementation
 
+/**
+ *  @brief Creates the delegate for a local file
+ *
+ *  Plain files are mapped into memory if possible. Compressed files and
+ *  files which cannot be mapped are read through zlib.
+ */
+static InputStreamBase *
+create_file_delegate (const std::string &path)
+{
+#if !defined(_WIN32)
+  InputMappedFile *mf = new InputMappedFile (path);
+  if (mf->is_mapped ()) {
+    return mf;
+  }
+  delete mf;
+#endif
+  return new InputZLibFile (path);
+}
+
 InputStream::InputStream (InputStreamBase &delegate)
-  : m_pos (0), mp_bptr (0), mp_delegate (&delegate), m_owns_delegate (false), mp_inflate (0)
+  : m_pos (0), mp_bptr (0), mp_delegate (&delegate), m_owns_delegate (false), mp_mapped (0), m_mapped_len (0), mp_inflate (0)
 { 
   m_bcap = 4096; // initial buffer capacity
   m_blen = 0;
   mp_buffer = new char [m_bcap];
+
+  init_mapped ();
 }
 
 InputStream::InputStream (const std::string &abstract_path)
-  : m_pos (0), mp_bptr (0), mp_delegate (0), m_owns_delegate (false), mp_inflate (0)
+  : m_pos (0), mp_bptr (0), mp_delegate (0), m_owns_delegate (false), mp_mapped (0), m_mapped_len (0), mp_inflate (0)
 { 
   m_bcap = 4096; // initial buffer capacity
   m_blen = 0;
@@ -327,12 +434,27 @@ InputStream::InputStream (const std::string &abstract_path)
 #endif
   } else if (ex.test ("file:")) {
     QUrl url (tl::to_qstring (abstract_path));
-    mp_delegate = new InputZLibFile (tl::to_string (url.toLocalFile ()));
+    mp_delegate = create_file_delegate (tl::to_string (url.toLocalFile ()));
   } else {
-    mp_delegate = new InputZLibFile (abstract_path);
+    mp_delegate = create_file_delegate (abstract_path);
   }
 
   m_owns_delegate = true;
+
+  init_mapped ();
+}
+
+void
+InputStream::init_mapped ()
+{
+  size_t length = 0;
+  const char *data = mp_delegate->mapped_data (length);
+  if (data) {
+    mp_mapped = data;
+    m_mapped_len = length;
+    mp_bptr = data;
+    m_blen = length;
+  }
 }
 
 std::string InputStream::absolute_path (const std::string &abstract_path)
@@ -387,28 +509,32 @@ InputStream::get (size_t n, bool bypass_inflate)
     }
   } 
 
-  if (m_blen < n) {
+  //  NOTE: in mapped mode, m_blen is the remaining size of the memory block
+  if (m_blen < n && ! mp_mapped) {
+
+    //  keep some of the bytes already read, so they can be put back with unget
+    size_t h = mp_bptr ? std::min (max_unget_history, size_t (mp_bptr - mp_buffer)) : 0;
 
     //  to keep move activity low, allocate twice as much as required
-    if (m_bcap < n * 2) {
+    if (m_bcap < (n + h) * 2) {
 
-      while (m_bcap < n) {
+      while (m_bcap < n + h) {
         m_bcap *= 2;
       }
 
       char *buffer = new char [m_bcap];
-      if (m_blen > 0) {
-        memcpy (buffer, mp_bptr, m_blen);
+      if (m_blen + h > 0) {
+        memcpy (buffer, mp_bptr - h, m_blen + h);
       }
       delete [] mp_buffer;
       mp_buffer = buffer;
 
-    } else if (m_blen > 0) {
-      memmove (mp_buffer, mp_bptr, m_blen);
+    } else if (m_blen + h > 0) {
+      memmove (mp_buffer, mp_bptr - h, m_blen + h);
     }
 
-    m_blen += mp_delegate->read (mp_buffer + m_blen, m_bcap - m_blen); 
-    mp_bptr = mp_buffer;
+    m_blen += mp_delegate->read (mp_buffer + h + m_blen, m_bcap - h - m_blen); 
+    mp_bptr = mp_buffer + h;
 
   }
 
@@ -424,9 +550,9 @@ InputStream::get (size_t n, bool bypass_inflate)
 }
 
 void
-InputStream::unget (size_t n)
+InputStream::unget (size_t n, bool bypass_inflate)
 {
-  if (mp_inflate) {
+  if (mp_inflate && ! bypass_inflate) {
     mp_inflate->unget (n);
   } else {
     mp_bptr -= n;
@@ -484,6 +610,13 @@ InputStream::reset ()
     mp_inflate = 0;
   } 
 
+  if (mp_mapped) {
+    mp_bptr = mp_mapped;
+    m_blen = m_mapped_len;
+    m_pos = 0;
+    return;
+  }
+
   //  optimize for a reset in the first m_bcap bytes
   //  -> this reduces the reset calls on mp_delegate which may not support this
   if (m_pos < m_bcap) {
@@ -674,6 +807,115 @@ InputFile::filename () const
   return tl::to_string (QFileInfo (tl::to_qstring (m_source)).fileName ());
 }
 
+// ---------------------------------------------------------------
+//  InputMappedFile implementation
+
+#if !defined(_WIN32)
+
+InputMappedFile::InputMappedFile (const std::string &path)
+  : mp_data (0), m_length (0), m_pos (0), m_dev (0), m_ino (0), m_size (0), m_mtime (0)
+{
+  m_source = path;
+
+  int fd = open (tl::string_to_system (path).c_str (), O_RDONLY);
+  if (fd < 0) {
+    //  not mapped - the zlib reader will report the error
+    return;
+  }
+
+  struct stat st;
+  if (fstat (fd, &st) == 0 && S_ISREG (st.st_mode) && st.st_size > 0 && (unsigned long long) st.st_size <= (unsigned long long) std::numeric_limits<size_t>::max ()) {
+
+    //  remember the state of the file, so modifications can be detected later
+    m_dev = st.st_dev;
+    m_ino = st.st_ino;
+    m_size = st.st_size;
+    m_mtime = st.st_mtime;
+
+    size_t length = size_t (st.st_size);
+    void *data = mmap (0, length, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    if (data != MAP_FAILED) {
+
+      mp_data = (const char *) data;
+      m_length = length;
+
+      //  gzip-compressed files are read through zlib
+      if (m_length >= 2 && (unsigned char) mp_data [0] == 0x1f && (unsigned char) mp_data [1] == 0x8b) {
+        unmap ();
+      } else {
+#if defined(MADV_SEQUENTIAL)
+        //  the readers consume the data front to back
+        madvise (data, length, MADV_SEQUENTIAL);
+#endif
+      }
+
+    }
+
+  }
+
+  //  the mapping stays valid after the file descriptor was closed
+  close (fd);
+}
+
+InputMappedFile::~InputMappedFile ()
+{
+  unmap ();
+}
+
+void
+InputMappedFile::unmap ()
+{
+  if (mp_data) {
+    munmap ((void *) mp_data, m_length);
+    mp_data = 0;
+    m_length = 0;
+  }
+}
+
+bool
+InputMappedFile::source_modified () const
+{
+  struct stat st;
+  if (stat (tl::string_to_system (m_source).c_str (), &st) != 0) {
+    return true;
+  }
+
+  return st.st_dev != m_dev || st.st_ino != m_ino || st.st_size != m_size || st.st_mtime != m_mtime;
+}
+
+size_t 
+InputMappedFile::read (char *b, size_t n)
+{
+  tl_assert (mp_data != 0);
+  if (m_pos + n > m_length) {
+    n = m_length - m_pos;
+  }
+  memcpy (b, mp_data + m_pos, n);
+  m_pos += n;
+  return n;
+}
+
+void 
+InputMappedFile::reset ()
+{
+  m_pos = 0;
+}
+
+std::string
+InputMappedFile::absolute_path () const
+{
+  return tl::to_string (QFileInfo (tl::to_qstring (m_source)).absoluteFilePath ());
+}
+
+std::string
+InputMappedFile::filename () const
+{
+  return tl::to_string (QFileInfo (tl::to_qstring (m_source)).fileName ());
+}
+
+#endif
+
 // ---------------------------------------------------------------
 //  InputZLibFile implementation
 
@@ -96,6 +96,40 @@ public:
    *  @brief Gets the filename part of the source
    */
   virtual std::string filename () const = 0;
+
+  /**
+   *  @brief Gets the data of the source as a contiguous memory block if available
+   *
+   *  Delegates which can provide their whole content as one memory block
+   *  (i.e. memory-mapped files) return a pointer to the beginning of the block
+   *  and deliver the size of the block in "length". InputStream will then deliver
+   *  the data directly from that block rather than copying it into its buffer.
+   *  The block must stay valid as long as the delegate lives.
+   *
+   *  The default implementation returns 0, meaning the data needs to be read
+   *  through read ().
+   */
+  virtual const char *mapped_data (size_t & /*length*/)
+  {
+    return 0;
+  }
+
+  /**
+   *  @brief Returns true, if the source has been modified since it was opened
+   *
+   *  Memory-mapped files report a change in size or modification time here.
+   *  If a mapped file is truncated by another process, accessing the memory 
+   *  block beyond the new end will crash the program (SIGBUS). So users which
+   *  keep a mapped block for a longer time should check the source before 
+   *  accessing the block. The check does not lock the file, so it is no 
+   *  protection against concurrent modifications.
+   *
+   *  The default implementation returns false.
+   */
+  virtual bool source_modified () const
+  {
+    return false;
+  }
 };
 
 // ---------------------------------------------------------------------------------
@@ -150,6 +184,12 @@ public:
     return "data";
   }
 
+  virtual const char *mapped_data (size_t &length)
+  {
+    length = m_length;
+    return mp_data;
+  }
+
 private:
   const char *mp_data;
   size_t m_length, m_pos;
@@ -157,6 +197,11 @@ private:
 
 // ---------------------------------------------------------------------------------
 
+/**
+ *  @brief The number of bytes InputStream keeps for putting them back with unget
+ */
+const size_t max_unget_history = 16;
+
 /**
  *  @brief An input stream abstraction class
  *
@@ -164,6 +209,9 @@ private:
  *  the capability to read a block of n bytes into a buffer.
  *  This object provides unget capabilities and buffering.
  *  The actual stream access is delegated to another object.
+ *  If the delegate provides its data as a memory block (see 
+ *  InputStreamBase::mapped_data), get () will return pointers into
+ *  this block without copying the data.
  */
 
 class TL_PUBLIC InputStream
@@ -214,9 +262,12 @@ public:
    *  @brief Undo a previous get call
    *  
    *  This call puts back the bytes read by a previous get call.
-   *  Only one call can be made undone.
+   *  Only one call can be made undone. With "bypass_inflate" set to true,
+   *  the bytes are put back into the raw stream even if inline deflating is enabled.
+   *  In that mode, up to max_unget_history bytes can be put back, even if they
+   *  have been read by multiple get calls.
    */
-  void unget (size_t n);
+  void unget (size_t n, bool bypass_inflate = false);
 
   /**
    *  @brief Reads all remaining bytes into the string
@@ -260,6 +311,51 @@ public:
     return m_blen;
   }
 
+  /**
+   *  @brief Returns true, if the stream delivers the data directly from a memory block
+   *
+   *  This is the case for memory-mapped files and memory streams.
+   */
+  bool is_mapped () const
+  {
+    return mp_mapped != 0;
+  }
+
+  /**
+   *  @brief Gets the memory block the stream delivers the data from
+   *
+   *  This method returns 0 if the stream is not mapped. Otherwise it returns the
+   *  beginning of the block and the length of the block in "length".
+   *  The block can be used to read the data independently from this stream, i.e.
+   *  with an InputMemoryStream.
+   */
+  const char *mapped_block (size_t &length) const
+  {
+    length = m_mapped_len;
+    return mp_mapped;
+  }
+
+  /**
+   *  @brief Returns true, if the source has been modified since the stream was opened
+   *
+   *  See InputStreamBase::source_modified for details. A mapped block (see mapped_block)
+   *  must not be accessed any longer if the source has been modified.
+   */
+  bool source_modified () const
+  {
+    return mp_delegate && mp_delegate->source_modified ();
+  }
+
+  /**
+   *  @brief Returns true, if the stream is currently inflating a compressed block
+   *
+   *  While inflating, pos () does not deliver the position of the next uncompressed byte.
+   */
+  bool is_inflating () const
+  {
+    return mp_inflate != 0;
+  }
+
   /**
    *  @brief Get the source specification (the file name)
    *
@@ -311,16 +407,22 @@ private:
   char *mp_buffer;
   size_t m_bcap;
   size_t m_blen;
-  char *mp_bptr;
+  const char *mp_bptr;
   InputStreamBase *mp_delegate;
   bool m_owns_delegate;
 
+  //  direct access to the delegate's memory block
+  const char *mp_mapped;
+  size_t m_mapped_len;
+
   //  inflate support 
   InflateFilter *mp_inflate;
 
   //  No copying currently
   InputStream (const InputStream &);
   InputStream &operator= (const InputStream &);
+
+  void init_mapped ();
 };
 
 // ---------------------------------------------------------------------------------
@@ -505,6 +607,14 @@ public:
     m_buffer.clear ();
   }
 
+  /**
+   *  @brief Swaps the contents with another memory stream
+   */
+  void swap (OutputMemoryStream &other)
+  {
+    m_buffer.swap (other.m_buffer);
+  }
+
 private:
   std::vector<char> m_buffer;
 };
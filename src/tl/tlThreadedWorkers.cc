@@ -25,6 +25,9 @@
 #include "tlLog.h"
 #include "tlProgress.h"
 #include "tlAssert.h"
+#include "tlStaticObjects.h"
+
+#include <QTime>
 
 #include <memory>
 #include <stdio.h>
@@ -39,23 +42,8 @@ namespace tl
 const size_t max_errors = 100;
 
 // -----------------------------------------------------------------------------
-//  Some special tasks and exceptions
-
-class ExitTask : public Task 
-{
-public:
-  ExitTask ()
-  { }
-};
-
-class StartTask : public Task 
-{
-public:
-  StartTask ()
-  { }
-};
+//  Some special exceptions
 
-struct WorkerTerminatedException { };
 struct TaskTerminatedException { };
 
 // -----------------------------------------------------------------------------
@@ -160,16 +148,366 @@ TaskList::put_front (Task *task)
 }
 
 // -----------------------------------------------------------------------------
-//  tl::JobBase implementation
+//  tl::WorkerProgressAdaptor definition
 
-JobBase::JobBase (int nworkers)
-  : m_nworkers (nworkers), m_idle_workers (0), m_stopping (false), m_running (false)
+/**
+ *  @brief A progress adaptor that will create a thread-specific progress environment
+ *
+ *  Currently the main focus is on providing a "cancel" condition.
+ *  One adaptor is installed per pool thread. It forwards to the worker which is
+ *  currently running on that thread.
+ */
+class TL_PUBLIC WorkerProgressAdaptor : public tl::ProgressAdaptor
+{
+public:
+  WorkerProgressAdaptor (PoolThread *thread);
+  
+  virtual void register_object (Progress *progress);
+  virtual void unregister_object (Progress *progress);
+  virtual void trigger (Progress *progress);
+  virtual void yield (Progress *progress);
+
+private:
+  PoolThread *mp_thread;
+};
+
+// -----------------------------------------------------------------------------
+//  tl::PoolThread definition
+
+/**
+ *  @brief A thread of the thread pool
+ */
+class PoolThread : public QThread
+{
+public:
+  PoolThread (ThreadPool *pool, int index)
+    : mp_pool (pool), m_index (index), mp_current_worker (0)
+  {
+    //  .. nothing yet ..
+  }
+
+  /**
+   *  @brief Gets the pool thread the caller is running in or 0 if the caller is not running in a pool thread
+   */
+  static PoolThread *current ()
+  {
+    return dynamic_cast<PoolThread *> (QThread::currentThread ());
+  }
+
+  ThreadPool *pool () const
+  {
+    return mp_pool;
+  }
+
+  int index () const
+  {
+    return m_index;
+  }
+
+  Worker *current_worker () const
+  {
+    return mp_current_worker;
+  }
+
+  void set_current_worker (Worker *worker)
+  {
+    mp_current_worker = worker;
+  }
+
+protected:
+  virtual void run ()
+  {
+    WorkerProgressAdaptor progress_adaptor (this);
+    mp_pool->thread_main (m_index);
+  }
+
+private:
+  ThreadPool *mp_pool;
+  int m_index;
+  Worker *mp_current_worker;
+};
+
+// -----------------------------------------------------------------------------
+//  tl::WorkerProgressAdaptor implementation
+
+WorkerProgressAdaptor::WorkerProgressAdaptor (PoolThread *thread)
+  : mp_thread (thread)
+{
+  // .. nothing yet .. 
+}
+  
+void WorkerProgressAdaptor::register_object (Progress * /*progress*/)
+{
+  // .. nothing yet .. 
+}
+
+void WorkerProgressAdaptor::unregister_object (Progress * /*progress*/)
+{
+  // .. nothing yet .. 
+}
+
+void WorkerProgressAdaptor::trigger (Progress * /*progress*/)
+{
+  // .. nothing yet .. 
+}
+
+void WorkerProgressAdaptor::yield (Progress * /*progress*/)
+{
+  //  throw an exception if the job is aborted.
+  Worker *worker = mp_thread->current_worker ();
+  if (worker) {
+    worker->checkpoint ();
+  }
+}
+
+// -----------------------------------------------------------------------------
+//  tl::ThreadPool implementation
+
+static ThreadPool *sp_thread_pool = 0;
+static QMutex s_thread_pool_lock;
+
+ThreadPool *
+ThreadPool::instance ()
+{
+  QMutexLocker locker (&s_thread_pool_lock);
+  if (! sp_thread_pool) {
+    sp_thread_pool = new ThreadPool ();
+    tl::StaticObjects::reg (&sp_thread_pool);
+  }
+  return sp_thread_pool;
+}
+
+ThreadPool::ThreadPool ()
+  : m_pending (0), m_next_queue (0), m_exiting (false)
+{
+  //  .. nothing yet ..
+}
+
+ThreadPool::~ThreadPool ()
+{
+  m_lock.lock ();
+  m_exiting = true;
+  m_work_available.wakeAll ();
+  m_lock.unlock ();
+
+  for (std::vector<PoolThread *>::const_iterator t = m_threads.begin (); t != m_threads.end (); ++t) {
+    (*t)->wait ();
+    delete *t;
+  }
+  m_threads.clear ();
+
+  for (std::vector<std::deque<Item *> >::const_iterator q = m_queues.begin (); q != m_queues.end (); ++q) {
+    for (std::deque<Item *>::const_iterator i = q->begin (); i != q->end (); ++i) {
+      delete *i;
+    }
+  }
+  m_queues.clear ();
+}
+
+void
+ThreadPool::reserve (int nthreads)
+{
+  QMutexLocker locker (&m_lock);
+
+  while (int (m_threads.size ()) < nthreads) {
+    m_queues.push_back (std::deque<Item *> ());
+    m_threads.push_back (new PoolThread (this, int (m_threads.size ())));
+    m_threads.back ()->start ();
+  }
+}
+
+int
+ThreadPool::threads ()
 {
-  if (nworkers > 0) {
-    mp_per_worker_task_lists = new TaskList[nworkers];
+  QMutexLocker locker (&m_lock);
+  return int (m_threads.size ());
+}
+
+bool
+ThreadPool::is_pool_thread ()
+{
+  return PoolThread::current () != 0;
+}
+
+void
+ThreadPool::submit (Item *item)
+{
+  QMutexLocker locker (&m_lock);
+
+  if (m_threads.empty ()) {
+    m_queues.push_back (std::deque<Item *> ());
+    m_threads.push_back (new PoolThread (this, 0));
+    m_threads.back ()->start ();
+  }
+
+  //  items submitted from a pool thread go into this thread's queue, others are distributed
+  PoolThread *current = PoolThread::current ();
+  size_t q = 0;
+  if (current && current->pool () == this) {
+    q = size_t (current->index ());
   } else {
-    mp_per_worker_task_lists = 0;
+    q = m_next_queue++ % m_queues.size ();
+  }
+
+  m_queues [q].push_back (item);
+  ++m_pending;
+
+  m_work_available.wakeOne ();
+}
+
+ThreadPool::Item *
+ThreadPool::take (int index)
+{
+  //  NOTE: this method is called with the lock held
+
+  //  take the most recent item from the own queue
+  if (index >= 0 && ! m_queues [index].empty ()) {
+    Item *item = m_queues [index].back ();
+    m_queues [index].pop_back ();
+    --m_pending;
+    return item;
+  }
+
+  //  steal the oldest item from the other queues
+  size_t n = m_queues.size ();
+  size_t from = index >= 0 ? size_t (index) + 1 : 0;
+  for (size_t i = 0; i < n; ++i) {
+    std::deque<Item *> &q = m_queues [(from + i) % n];
+    if (! q.empty ()) {
+      Item *item = q.front ();
+      q.pop_front ();
+      --m_pending;
+      return item;
+    }
+  }
+
+  return 0;
+}
+
+bool
+ThreadPool::help ()
+{
+  PoolThread *current = PoolThread::current ();
+
+  m_lock.lock ();
+  Item *item = 0;
+  if (! m_exiting && m_pending > 0) {
+    item = take (current && current->pool () == this ? current->index () : -1);
+  }
+  m_lock.unlock ();
+
+  if (! item) {
+    return false;
+  }
+
+  item->run ();
+  delete item;
+
+  return true;
+}
+
+void
+ThreadPool::cancel (const void *owner, std::vector<Item *> &items)
+{
+  QMutexLocker locker (&m_lock);
+
+  for (std::vector<std::deque<Item *> >::iterator q = m_queues.begin (); q != m_queues.end (); ++q) {
+    std::deque<Item *>::iterator iw = q->begin ();
+    for (std::deque<Item *>::iterator i = q->begin (); i != q->end (); ++i) {
+      if ((*i)->owner () == owner) {
+        items.push_back (*i);
+        --m_pending;
+      } else {
+        *iw++ = *i;
+      }
+    }
+    q->erase (iw, q->end ());
+  }
+}
+
+void
+ThreadPool::thread_main (int index)
+{
+  while (true) {
+
+    Item *item = 0;
+
+    m_lock.lock ();
+    while (m_pending == 0 && ! m_exiting) {
+      m_work_available.wait (&m_lock);
+    }
+    if (! m_exiting) {
+      item = take (index);
+    }
+    m_lock.unlock ();
+
+    if (! item) {
+      //  stops the thread
+      break;
+    }
+
+    item->run ();
+    delete item;
+
+  }
+}
+
+// -----------------------------------------------------------------------------
+//  tl::WorkerTaskQueue definition
+
+/**
+ *  @brief The task queue of a worker
+ */
+class WorkerTaskQueue
+{
+public:
+  QMutex lock;
+  TaskList tasks;
+};
+
+// -----------------------------------------------------------------------------
+//  tl::WorkerActivation definition
+
+/**
+ *  @brief A pool item which runs a worker until no more tasks are available
+ */
+class WorkerActivation
+  : public ThreadPool::Item
+{
+public:
+  WorkerActivation (JobBase *job, int worker)
+    : mp_job (job), m_worker (worker)
+  {
+    //  .. nothing yet ..
   }
+
+  virtual void run ()
+  {
+    mp_job->run_worker (m_worker);
+  }
+
+  virtual const void *owner () const
+  {
+    return mp_job;
+  }
+
+  int worker () const
+  {
+    return m_worker;
+  }
+
+private:
+  JobBase *mp_job;
+  int m_worker;
+};
+
+// -----------------------------------------------------------------------------
+//  tl::JobBase implementation
+
+JobBase::JobBase (int nworkers)
+  : m_nworkers (nworkers), m_active_workers (0), m_next_queue (0), m_stopping (false), m_running (false)
+{
+  create_queues ();
 }
 
 JobBase::~JobBase ()
@@ -180,9 +518,22 @@ JobBase::~JobBase ()
     (*(m_bosses.begin ()))->unregister_job (this);
   }
 
-  if (mp_per_worker_task_lists) {
-    delete[] mp_per_worker_task_lists;
-    mp_per_worker_task_lists = 0;
+  for (std::vector<WorkerTaskQueue *>::const_iterator q = m_queues.begin (); q != m_queues.end (); ++q) {
+    delete *q;
+  }
+  m_queues.clear ();
+}
+
+void
+JobBase::create_queues ()
+{
+  for (std::vector<WorkerTaskQueue *>::const_iterator q = m_queues.begin (); q != m_queues.end (); ++q) {
+    delete *q;
+  }
+  m_queues.clear ();
+
+  for (int i = 0; i < m_nworkers; ++i) {
+    m_queues.push_back (new WorkerTaskQueue ());
   }
 }
 
@@ -226,17 +577,9 @@ JobBase::set_num_workers (int nworkers)
   terminate ();
 
   m_nworkers = nworkers;
-  m_idle_workers = 0;
-
-  if (mp_per_worker_task_lists) {
-    delete[] mp_per_worker_task_lists;
-  }
+  m_active_workers = 0;
 
-  if (nworkers > 0) {
-    mp_per_worker_task_lists = new TaskList[nworkers];
-  } else {
-    mp_per_worker_task_lists = 0;
-  }
+  create_queues ();
 }
 
 void 
@@ -249,29 +592,40 @@ JobBase::start ()
   tl_assert (! m_running);
 
   m_running = true;
-  
-  //  Add a start task for each worker
-  //  This serves as a synchronization measure such that each task gets called once and
-  //  the empty queue detection works properly.
-  for (int i = 0; i < m_nworkers; ++i) {
-    mp_per_worker_task_lists[i].put_front (new StartTask ());
-  }
 
-  m_task_available_condition.wakeAll ();
+  if (m_nworkers > 0) {
 
-  while (m_nworkers > int (mp_workers.size ())) {
-    mp_workers.push_back (create_worker ());
-    mp_workers.back ()->start (this, int (mp_workers.size ()) - 1);
-  }
+    ThreadPool::instance ()->reserve (m_nworkers);
+
+    while (m_nworkers > int (mp_workers.size ())) {
+      mp_workers.push_back (create_worker ());
+      mp_workers.back ()->attach (this, int (mp_workers.size ()) - 1);
+    }
+
+    for (int i = 0; i < int (mp_workers.size ()); ++i) {
+      setup_worker (mp_workers [i]);
+      mp_workers [i]->reset_stop_request ();
+    }
+
+    //  Distribute the tasks scheduled so far over the workers' queues
+    for (int i = 0; ! m_task_list.is_empty (); i = (i + 1) % m_nworkers) {
+      QMutexLocker locker (&m_queues [i]->lock);
+      m_queues [i]->tasks.put (m_task_list.fetch ());
+    }
+
+    m_next_queue = 0;
+
+    //  Activate all workers. This also makes sure the job finishes properly if there
+    //  are no tasks at all.
+    for (int i = 0; i < m_nworkers; ++i) {
+      activate (i);
+    }
 
-  for (int i = 0; i < int (mp_workers.size ()); ++i) {
-    setup_worker (mp_workers [i]);
-    mp_workers [i]->reset_stop_request ();
   }
 
   m_lock.unlock ();
 
-  if (mp_workers.empty ()) {
+  if (m_nworkers <= 0) {
 
     //  synchronous case: create a temporary worker and 
     //  perform the tasks in the order they were delivered
@@ -285,9 +639,6 @@ JobBase::start ()
       } catch (TaskTerminatedException) {
         //  Stop the thread.
         break;
-      } catch (WorkerTerminatedException) {
-        //  Stop the thread.
-        break;
       } catch (tl::Exception &ex) {
         log_error (ex.msg ());
       } catch (std::exception &ex) {
@@ -320,6 +671,37 @@ JobBase::is_running ()
 bool 
 JobBase::wait (long timeout) 
 {
+  if (ThreadPool::is_pool_thread ()) {
+
+    //  Called from a pool thread (i.e. from a task of another job): execute pending pool items
+    //  while waiting. Otherwise the workers of this job may not find a free thread.
+    QTime timer;
+    timer.start ();
+
+    while (true) {
+
+      m_lock.lock ();
+      bool running = (m_nworkers > 0 && m_running);
+      m_lock.unlock ();
+
+      if (! running) {
+        return true;
+      } else if (timeout >= 0 && timer.elapsed () >= timeout) {
+        return false;
+      }
+
+      if (! ThreadPool::instance ()->help ()) {
+        m_lock.lock ();
+        if (m_running) {
+          m_queue_empty_condition.wait (&m_lock, 10);
+        }
+        m_lock.unlock ();
+      }
+
+    }
+
+  }
+
   //  return value will be false if the wait timed out
   bool status = true;
 
@@ -348,30 +730,46 @@ JobBase::stop ()
     delete m_task_list.fetch ();
   }
 
-  if (! mp_workers.empty ()) {
-
-    bool any_working = false;
-
-    //  Add a stop task for each worker which is not idle
-    for (int i = 0; i < int (mp_workers.size ()); ++i) {
-      if (! mp_workers[i]->is_idle ()) {
-        mp_workers [i]->stop_request ();
-        any_working = true;
-      }
+  clear_queues ();
+
+  //  Cancel the activations which have not been started yet: their workers
+  //  become idle immediately.
+  std::vector<ThreadPool::Item *> cancelled;
+  ThreadPool::instance ()->cancel (this, cancelled);
+  for (std::vector<ThreadPool::Item *>::const_iterator i = cancelled.begin (); i != cancelled.end (); ++i) {
+    WorkerActivation *activation = dynamic_cast<WorkerActivation *> (*i);
+    if (activation) {
+      mp_workers [activation->worker ()]->set_idle (true);
+      --m_active_workers;
     }
+    delete *i;
+  }
 
-    if (any_working) {
+  if (! cancelled.empty () && m_active_workers == 0) {
+    m_queue_empty_condition.wakeAll ();
+  }
 
-      //  signal that we have new tasks
-      m_task_available_condition.wakeAll ();
+  //  Request a stop from all workers which are active
+  for (int i = 0; i < int (mp_workers.size ()); ++i) {
+    if (! mp_workers[i]->is_idle ()) {
+      mp_workers [i]->stop_request ();
+    }
+  }
 
-      //  Wait for the stop tasks being processed ...
+  //  Wait until all workers have finished. Within a pool thread, execute pending 
+  //  pool items while waiting, so the workers are not blocked.
+  bool in_pool_thread = ThreadPool::is_pool_thread ();
+  while (m_active_workers > 0) {
+    if (in_pool_thread) {
+      m_lock.unlock ();
+      bool helped = ThreadPool::instance ()->help ();
+      m_lock.lock ();
+      if (! helped && m_active_workers > 0) {
+        m_queue_empty_condition.wait (&m_lock, 10);
+      }
+    } else {
       m_queue_empty_condition.wait (&m_lock);
-
     }
-
-    //  Unless new tasks are scheduled, we can be sure that now all workers
-    //  are idle.
   }
 
   m_stopping = false;
@@ -387,169 +785,175 @@ JobBase::terminate ()
 {
   stop ();
 
-  if (! mp_workers.empty ()) {
-
-    m_lock.lock ();
-
-    //  Add a stop task for each worker and request a stop
-    for (int i = 0; i < int (mp_workers.size ()); ++i) {
-      mp_workers [i]->stop_request ();
-      mp_per_worker_task_lists[i].put (new ExitTask ());
-    }
-
-    //  signal that we have new tasks
-    m_task_available_condition.wakeAll ();
-
-    //  Unless new tasks are scheduled, we can be sure that now all workers
-    //  are terminating.
-
-    m_lock.unlock ();
-
-    //  Wait for the threads to complete
-    for (int i = 0; i < int (mp_workers.size ()); ++i) {
-      mp_workers [i]->wait ();
-    }
+  m_lock.lock ();
 
-    for (std::vector <Worker *>::iterator w = mp_workers.begin (); w != mp_workers.end (); ++w) {
-      delete (*w);
-    }
+  for (std::vector <Worker *>::iterator w = mp_workers.begin (); w != mp_workers.end (); ++w) {
+    delete (*w);
+  }
 
-    mp_workers.clear ();
+  mp_workers.clear ();
 
-  }
+  m_lock.unlock ();
 }
 
 void 
 JobBase::schedule (Task *task)
 {
-  m_lock.lock ();
+  QMutexLocker locker (&m_lock);
 
-  //  Don't allow tasks to be scheduled while stopping or exiting (waiting for m_queue_empty_condition)
+  //  Don't allow tasks to be scheduled while stopping (waiting for the workers to finish)
   if (m_stopping) {
-    m_lock.unlock ();
     throw TaskTerminatedException ();
   }
 
-  //  Add the task to the task queue
-  m_task_list.put (task);
+  if (! m_running || m_nworkers <= 0) {
+    //  Not started yet or synchronous operation: collect the tasks in the job's task list
+    m_task_list.put (task);
+    return;
+  }
+
+  //  Tasks scheduled from within a task of this job go into the queue of the worker
+  //  executing this task. Others are distributed over the workers' queues.
+  int w = 0;
+  PoolThread *thread = PoolThread::current ();
+  if (thread && thread->current_worker () && thread->current_worker ()->mp_job == this) {
+    w = thread->current_worker ()->worker_index ();
+  } else {
+    w = int (m_next_queue++ % size_t (m_nworkers));
+  }
 
-  if (m_running) {
-    m_task_available_condition.wakeAll ();
+  {
+    QMutexLocker queue_locker (&m_queues [w]->lock);
+    m_queues [w]->tasks.put (task);
   }
 
-  m_lock.unlock ();
+  //  Activate an idle worker, preferably the one owning the queue
+  if (mp_workers [w]->is_idle ()) {
+    activate (w);
+  } else {
+    for (int i = 0; i < m_nworkers; ++i) {
+      if (mp_workers [i]->is_idle ()) {
+        activate (i);
+        break;
+      }
+    }
+  }
 }
 
-Task *
-JobBase::get_task (int worker)
+void
+JobBase::activate (int worker)
 {
-  while (true) {
-
-    m_lock.lock ();
+  //  NOTE: this method is called with the lock held
+  mp_workers [worker]->set_idle (false);
+  ++m_active_workers;
+  ThreadPool::instance ()->submit (new WorkerActivation (this, worker));
+}
 
-    //  wait for new relevant entries in the task queue
-    while (m_task_list.is_empty () && mp_per_worker_task_lists [worker].is_empty ()) {
+void
+JobBase::run_worker (int worker)
+{
+  PoolThread *thread = PoolThread::current ();
 
-      //  if the queue is empty, mark this worker as idle.
-      ++m_idle_workers;
+  //  make the worker the current one for this thread (for the progress adaptor)
+  Worker *prev_worker = 0;
+  if (thread) {
+    prev_worker = thread->current_worker ();
+    thread->set_current_worker (mp_workers [worker]);
+  }
 
-      //  signal empty queue if all workers are waiting
-      if (m_idle_workers == m_nworkers) {
-        if (! m_stopping) {
-          finished ();
-        }
-        m_running = false;
-        m_queue_empty_condition.wakeAll ();
-      }
+  mp_workers [worker]->run ();
 
-      //  wait until we receive a task
-      while (m_task_list.is_empty () && mp_per_worker_task_lists [worker].is_empty ()) {
-        mp_workers [worker]->set_idle (true);
-        m_task_available_condition.wait (&m_lock);
-        mp_workers [worker]->set_idle (false);
-      }
-
-      --m_idle_workers;
+  if (thread) {
+    thread->set_current_worker (prev_worker);
+  }
+}
 
-    } 
+Task *
+JobBase::fetch_task (int worker)
+{
+  //  Take the next task from the worker's own queue
+  {
+    WorkerTaskQueue *q = m_queues [worker];
+    QMutexLocker locker (&q->lock);
+    if (! q->tasks.is_empty ()) {
+      return q->tasks.fetch ();
+    }
+  }
 
-    Task *task = 0;
-    if (! mp_per_worker_task_lists [worker].is_empty ()) {
-      task = mp_per_worker_task_lists [worker].fetch ();
-    } else if (! m_task_list.is_empty ()) {
-      task = m_task_list.fetch ();
+  //  Otherwise steal one from the other workers' queues
+  for (int i = 1; i < m_nworkers; ++i) {
+    WorkerTaskQueue *q = m_queues [(worker + i) % m_nworkers];
+    QMutexLocker locker (&q->lock);
+    if (! q->tasks.is_empty ()) {
+      return q->tasks.fetch ();
     }
+  }
 
-    m_lock.unlock ();
+  return 0;
+}
 
-    if (dynamic_cast <ExitTask *> (task) != 0) {
-      delete task;
-      //  stops the thread
-      throw WorkerTerminatedException ();
-    } else if (dynamic_cast <StartTask *> (task) != 0) {
-      delete task;
-      //  dummy task for synchronization - wait for new tasks to arrive.
-    } else if (task) {
-      return task;
+bool
+JobBase::has_queued_tasks ()
+{
+  for (std::vector<WorkerTaskQueue *>::const_iterator q = m_queues.begin (); q != m_queues.end (); ++q) {
+    QMutexLocker locker (&(*q)->lock);
+    if (! (*q)->tasks.is_empty ()) {
+      return true;
     }
-
   }
+  return false;
 }
 
-// -----------------------------------------------------------------------------
-//  tl::WorkerProgressAdaptor definition and implementation
+void
+JobBase::clear_queues ()
+{
+  for (std::vector<WorkerTaskQueue *>::const_iterator q = m_queues.begin (); q != m_queues.end (); ++q) {
+    QMutexLocker locker (&(*q)->lock);
+    while (! (*q)->tasks.is_empty ()) {
+      delete (*q)->tasks.fetch ();
+    }
+  }
+}
 
-/**
- *  @brief A progress adaptor that will create a thread-specific progress environment
- *
- *  Currently the main focus is on providing a "cancel" condition.
- */
-class TL_PUBLIC WorkerProgressAdaptor : public tl::ProgressAdaptor
+Task *
+JobBase::get_task (int worker)
 {
-public:
-  WorkerProgressAdaptor (Worker *worker);
-  
-  virtual void register_object (Progress *progress);
-  virtual void unregister_object (Progress *progress);
-  virtual void trigger (Progress *progress);
-  virtual void yield (Progress *progress);
+  while (true) {
 
-private:
-  Worker *mp_worker;
-};
+    Task *task = fetch_task (worker);
+    if (task) {
+      return task;
+    }
 
-WorkerProgressAdaptor::WorkerProgressAdaptor (Worker *worker)
-  : mp_worker (worker)
-{
-  // .. nothing yet .. 
-}
-  
-void WorkerProgressAdaptor::register_object (Progress * /*progress*/)
-{
-  // .. nothing yet .. 
-}
+    QMutexLocker locker (&m_lock);
 
-void WorkerProgressAdaptor::unregister_object (Progress * /*progress*/)
-{
-  // .. nothing yet .. 
-}
+    //  tasks may have been scheduled in the meantime
+    if (has_queued_tasks ()) {
+      continue;
+    }
 
-void WorkerProgressAdaptor::trigger (Progress * /*progress*/)
-{
-  // .. nothing yet .. 
-}
+    //  no more tasks: the worker becomes idle and releases the pool thread
+    mp_workers [worker]->set_idle (true);
 
-void WorkerProgressAdaptor::yield (Progress * /*progress*/)
-{
-  //  throw an exception if the job is aborted.
-  mp_worker->checkpoint ();
+    //  signal empty queue if all workers are idle
+    if (--m_active_workers == 0) {
+      if (! m_stopping) {
+        finished ();
+      }
+      m_running = false;
+      m_queue_empty_condition.wakeAll ();
+    }
+
+    return 0;
+
+  }
 }
 
 // -----------------------------------------------------------------------------
 //  tl::Worker implementation
 
 Worker::Worker ()
-  : mp_job (0), m_worker_index (-1), m_stop_requested (false), m_is_idle (false)
+  : mp_job (0), m_worker_index (-1), m_stop_requested (false), m_is_idle (true)
 {
   // .. nothing yet ..
 }
@@ -560,11 +964,10 @@ Worker::~Worker ()
 }
 
 void 
-Worker::start (JobBase *job, int worker_index)
+Worker::attach (JobBase *job, int worker_index)
 {
   mp_job = job;
   m_worker_index = worker_index;
-  QThread::start ();
 }
 
 void 
@@ -578,18 +981,17 @@ Worker::checkpoint ()
 void  
 Worker::run ()
 {
-  WorkerProgressAdaptor progress_adaptor (this);
-
   while (true)
   {
     try {
       std::auto_ptr<Task> task (mp_job->get_task (m_worker_index));
+      if (! task.get ()) {
+        //  no more tasks: release the thread
+        break;
+      }
       perform_task (task.get ());
     } catch (TaskTerminatedException) {
       //  .. try again
-    } catch (WorkerTerminatedException) {
-      //  Stop the thread.
-      break;
     } catch (tl::Exception &ex) {
       mp_job->log_error (ex.msg ());
     } catch (std::exception &ex) {
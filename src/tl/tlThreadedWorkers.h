@@ -32,6 +32,7 @@
 
 #include <set>
 #include <vector>
+#include <deque>
 
 namespace tl
 {
@@ -53,13 +54,129 @@ namespace tl
  *      stopped, restarted or terminated. A job is initialized in the main thread and
  *      sets up the threads which actually do the job (workers). 
  *      A job may be associated with multiple boss instances.
- *  3.) Workers: a job can be split into multiple tasks which are executed by the workers. A worker is
- *      a thread which receives tasks through a task queue.
+ *  3.) Workers: a job can be split into multiple tasks which are executed by the workers. A worker
+ *      receives tasks through a task queue.
+ *
+ *  The workers are not threads by themselves. Instead, the workers of all jobs are run on the 
+ *  threads of a process-wide thread pool (tl::ThreadPool). Each worker has a task queue of its
+ *  own. A worker takes the tasks from its own queue first and steals tasks from the queues of 
+ *  the other workers of the same job when its own queue is empty. When no more tasks are available,
+ *  the worker returns the pool thread it was running on.
  */
 
 class Boss;
 class Worker;
 class Task;
+class PoolThread;
+class WorkerTaskQueue;
+class WorkerActivation;
+
+/**
+ *  @brief The process-wide thread pool
+ *
+ *  The thread pool provides the threads on which the workers of all jobs are run. 
+ *  Threads are created on demand and are kept for later use. Hence, short jobs do not 
+ *  pay for the thread startup.
+ *
+ *  The pool executes items (ThreadPool::Item objects). Each pool thread has a queue of pending 
+ *  items. Items submitted from a pool thread are put into the queue of that thread, other items
+ *  are distributed over the queues. A thread takes the most recent item from its own queue and
+ *  steals the oldest items from the queues of the other threads when its own queue is empty.
+ */
+class TL_PUBLIC ThreadPool
+{
+public:
+  /**
+   *  @brief An item to be executed by the pool
+   */
+  class TL_PUBLIC Item
+  {
+  public:
+    Item () { }
+    virtual ~Item () { }
+
+    /**
+     *  @brief Executes the item
+     *
+     *  This method is called from one of the pool threads. It should not throw exceptions.
+     */
+    virtual void run () = 0;
+
+    /**
+     *  @brief Gets the object on behalf of which the item is executed
+     *
+     *  The owner is used to identify the items when they are cancelled (see "cancel").
+     */
+    virtual const void *owner () const { return 0; }
+  };
+
+  /**
+   *  @brief Gets the singleton instance of the pool
+   */
+  static ThreadPool *instance ();
+
+  /**
+   *  @brief Destructor
+   *
+   *  The destructor will wait for all threads to finish.
+   */
+  ~ThreadPool ();
+
+  /**
+   *  @brief Submits an item for execution
+   *
+   *  The pool takes over ownership of the item. The item is deleted after it has been executed.
+   */
+  void submit (Item *item);
+
+  /**
+   *  @brief Makes sure the pool has at least the given number of threads
+   */
+  void reserve (int nthreads);
+
+  /**
+   *  @brief Gets the number of threads in the pool
+   */
+  int threads ();
+
+  /**
+   *  @brief Executes one pending item in the calling thread
+   *
+   *  This method can be used by a pool thread waiting for other items to complete. It will
+   *  return false if no item was pending.
+   */
+  bool help ();
+
+  /**
+   *  @brief Removes the items of the given owner which have not been started yet
+   *
+   *  The removed items are delivered in "items". The caller takes over ownership of them.
+   */
+  void cancel (const void *owner, std::vector<Item *> &items);
+
+  /**
+   *  @brief Returns true, if the calling thread is a pool thread
+   */
+  static bool is_pool_thread ();
+
+private:
+  friend class PoolThread;
+
+  QMutex m_lock;
+  QWaitCondition m_work_available;
+  std::vector<PoolThread *> m_threads;
+  std::vector<std::deque<Item *> > m_queues;
+  size_t m_pending;
+  size_t m_next_queue;
+  bool m_exiting;
+
+  ThreadPool ();
+  ThreadPool (const ThreadPool &);
+  ThreadPool &operator= (const ThreadPool &);
+
+  Item *take (int index);
+  void thread_main (int index);
+};
 
 /**
  *  @brief A task list
@@ -158,10 +275,11 @@ public:
    *
    *  This does not trigger the actual operation yet. It should be done separately before
    *  \start is called. However, it is possible to schedule jobs while the job is running and
-   *  even from within other tasks.
-   *  It is guaranteed that the order of processing of the tasks is maintained. However, 
+   *  even from within other tasks. Tasks scheduled from within a task go into the queue of the
+   *  worker executing this task. Other tasks are distributed over the workers' queues.
+   *  The tasks are taken from the queues in the order they have been scheduled. However, 
    *  it is not guaranteed that previous tasks have been processed already because they
-   *  might be send to a different thread.
+   *  might be executed by a different worker.
    */
   void schedule (Task *task);
 
@@ -174,15 +292,18 @@ public:
    *  @brief Wait for the termination of the job
    *
    *  If the job already has terminated, this method does nothing.
+   *  If called from a pool thread (i.e. from within a task of another job), this method will
+   *  execute pending items of the thread pool while waiting. This way, nested jobs do not
+   *  block the pool.
    */
   bool wait (long timeout = -1);
 
   /**
-   *  @brief Terminate all threads in this job.
+   *  @brief Terminate the job and release the workers
    *
    *  After the job has been terminated, it can be started again using \start.
    *  The difference between \stop and \terminate is that \terminate will 
-   *  stop the threads. 
+   *  delete the workers. 
    */
   void terminate ();
 
@@ -258,17 +379,18 @@ protected:
 private:
   friend class Worker;
   friend class Boss;
+  friend class WorkerActivation;
 
   TaskList m_task_list;
-  TaskList *mp_per_worker_task_lists;
+  std::vector<WorkerTaskQueue *> m_queues;
 
   int m_nworkers;
-  int m_idle_workers;
+  int m_active_workers;
+  size_t m_next_queue;
   bool m_stopping;
   bool m_running;
 
   QMutex m_lock;
-  QWaitCondition m_task_available_condition;
   QWaitCondition m_queue_empty_condition;
 
   std::vector<Worker *> mp_workers;
@@ -277,6 +399,12 @@ private:
   std::vector<std::string> m_error_messages;
 
   Task *get_task (int for_worker);
+  Task *fetch_task (int for_worker);
+  bool has_queued_tasks ();
+  void clear_queues ();
+  void create_queues ();
+  void activate (int worker);
+  void run_worker (int worker);
   void log_error (const std::string &s);
 };
 
@@ -307,12 +435,13 @@ protected:
 /**
  *  @brief A worker 
  *
- *  The worker is the thread doing the actual work. A worker must be reimplemented to
+ *  The worker is the object doing the actual work. A worker must be reimplemented to
  *  provide the operation implementation by implementing "perform_task".
  *  A worker is provided with a sequence of tasks with define the operations that the
- *  worker is supposed to perform.
+ *  worker is supposed to perform. The worker is executed on one of the threads of the 
+ *  thread pool. A worker is never executed on more than one thread at the same time.
  */
-class TL_PUBLIC Worker : protected QThread
+class TL_PUBLIC Worker
 {
 public:
   friend class JobBase;
@@ -365,7 +494,7 @@ protected:
   }
   
   /**
-   *  @brief Returns true, if the worker is waiting for a task
+   *  @brief Returns true, if the worker is waiting for a task (not active)
    */
   bool is_idle () const
   {
@@ -381,10 +510,10 @@ protected:
   }
 
 private:
-  virtual void run ();
+  void run ();
   void stop_request ();
   void reset_stop_request ();
-  void start (JobBase *job, int worker_index);
+  void attach (JobBase *job, int worker_index);
 
   JobBase *mp_job;
   int m_worker_index;
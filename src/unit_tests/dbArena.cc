@@ -0,0 +1,181 @@
+
+/*
+
+  KLayout Layout Viewer
+  Copyright (C) 2006-2017 Matthias Koefferlein
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+
+#include "dbArena.h"
+#include "dbLayout.h"
+#include "tlThreadedWorkers.h"
+#include "utHead.h"
+
+#include <vector>
+
+TEST(1)
+{
+  db::Arena arena (1024);
+
+  EXPECT_EQ (arena.used (), size_t (0));
+  EXPECT_EQ (arena.chunks (), size_t (0));
+
+  std::vector<char *> blocks;
+  for (int i = 0; i < 100; ++i) {
+    char *b = (char *) arena.allocate (i % 17 + 1);
+    EXPECT_EQ (((size_t) b & 7) == 0, true);
+    for (int j = 0; j < i % 17 + 1; ++j) {
+      b [j] = char (i);
+    }
+    blocks.push_back (b);
+  }
+
+  EXPECT_EQ (arena.used () > 100, true);
+  EXPECT_EQ (arena.reserved () >= arena.used (), true);
+  size_t chunks = arena.chunks ();
+  EXPECT_EQ (chunks > 1, true);
+
+  for (int i = 0; i < 100; ++i) {
+    for (int j = 0; j < i % 17 + 1; ++j) {
+      EXPECT_EQ (int (blocks [i][j]), i);
+    }
+  }
+
+  //  a large block gets a chunk of its own
+  void *large = arena.allocate (10000);
+  EXPECT_EQ (arena.chunks (), chunks + 1);
+  db::Arena::free (large);
+  EXPECT_EQ (arena.chunks (), chunks);
+
+  //  chunks are released when their last block is freed - the current chunk is kept
+  for (std::vector<char *>::const_iterator b = blocks.begin (); b != blocks.end (); ++b) {
+    db::Arena::free (*b);
+  }
+  EXPECT_EQ (arena.used (), size_t (0));
+  EXPECT_EQ (arena.chunks (), size_t (1));
+
+  db::Arena::free (0);
+}
+
+TEST(2)
+{
+  //  blocks may outlive the arena
+  void *b1, *b2;
+
+  {
+    db::Arena arena (1024);
+    b1 = arena.allocate (100);
+    b2 = arena.allocate (200);
+    db::Arena::free (b1);
+  }
+
+  db::Arena::free (b2);
+}
+
+TEST(3)
+{
+  db::Layout layout;
+  db::Cell &top = layout.cell (layout.add_cell ("TOP"));
+  unsigned int l1 = layout.insert_layer (db::LayerProperties (1, 0));
+
+  for (int i = 0; i < 1000; ++i) {
+    db::Point pts[] = { db::Point (0, 0), db::Point (100, 300), db::Point (200, 0) };
+    db::Polygon poly;
+    poly.assign_hull (&pts[0], &pts[sizeof (pts) / sizeof (pts[0])]);
+    top.shapes (l1).insert (poly.moved (db::Vector (i * 500, 0)));
+  }
+
+  EXPECT_EQ (layout.use_arena (), true);
+  EXPECT_EQ (layout.arena ().used (), size_t (0));
+
+  layout.pack_shapes ();
+  EXPECT_EQ (layout.arena ().used () >= 3000 * sizeof (db::Point), true);
+
+  db::Layout copy (layout);
+  EXPECT_EQ (copy.arena ().used (), size_t (0));
+
+  //  editing releases the packed buffer
+  top.shapes (l1).insert (db::Polygon (db::Box (0, 0, 100, 100)));
+  EXPECT_EQ (layout.arena ().used (), size_t (0));
+  EXPECT_EQ (top.shapes (l1).size (), size_t (1001));
+  EXPECT_EQ (copy.cell (top.cell_index ()).shapes (l1).size (), size_t (1000));
+
+  layout.pack_shapes ();
+
+  //  the packed shapes may outlive the layout's arena
+  db::Shapes shapes;
+  shapes.swap (top.shapes (l1));
+  layout.clear ();
+  EXPECT_EQ (shapes.size (), size_t (1001));
+  EXPECT_EQ (shapes.bbox ().to_string (), "(0,0;499700,300)");
+}
+
+namespace
+{
+
+class ArenaTask : public tl::Task
+{
+public:
+  ArenaTask (db::Arena *arena, std::vector<void *> *blocks) : mp_arena (arena), mp_blocks (blocks) { }
+  db::Arena *mp_arena;
+  std::vector<void *> *mp_blocks;
+};
+
+class ArenaWorker : public tl::Worker
+{
+public:
+  ArenaWorker () : tl::Worker () { }
+
+protected:
+  void perform_task (tl::Task *task)
+  {
+    ArenaTask *t = dynamic_cast<ArenaTask *> (task);
+    if (t) {
+      //  frees the blocks of another thread while allocating new ones
+      for (std::vector<void *>::const_iterator b = t->mp_blocks->begin (); b != t->mp_blocks->end (); ++b) {
+        db::Arena::free (*b);
+        db::Arena::free (t->mp_arena->allocate (size_t (b - t->mp_blocks->begin ()) % 100 + 1));
+      }
+    }
+  }
+};
+
+}
+
+TEST(4)
+{
+  //  allocating and freeing from multiple threads
+  db::Arena arena (4096);
+
+  std::vector<std::vector<void *> > blocks (8);
+  for (size_t i = 0; i < blocks.size (); ++i) {
+    for (size_t j = 0; j < 10000; ++j) {
+      blocks [i].push_back (arena.allocate (j % 50 + 1));
+    }
+  }
+
+  tl::Job<ArenaWorker> job (4);
+  for (size_t i = 0; i < blocks.size (); ++i) {
+    job.schedule (new ArenaTask (&arena, &blocks [i]));
+  }
+  job.start ();
+  job.wait ();
+
+  EXPECT_EQ (arena.used (), size_t (0));
+  EXPECT_EQ (arena.chunks () <= size_t (1), true);
+}
@@ -555,6 +555,111 @@ TEST(11)
   // run_test11(_this, 10000, 2, 10000);
 }
 
+struct BoxScannerTestRecorder3
+{
+  void finish (const db::Box *, size_t p) 
+  {
+    finished.push_back (p);
+  }
+
+  void add (const db::Box * /*b1*/, size_t p1, const db::Box * /*b2*/, size_t p2)
+  {
+    interactions.push_back (std::make_pair (std::min (p1, p2), std::max (p1, p2)));
+  }
+
+  std::vector<size_t> finished;
+  std::vector<std::pair<size_t, size_t> > interactions;
+};
+
+void run_test12 (ut::TestBase *_this, size_t n, size_t bands, db::Coord spread, db::Coord enl)
+{
+  std::vector<db::Box> bb;
+  for (size_t i = 0; i < n; ++i) {
+    db::Coord x = rand () % spread;
+    db::Coord y = rand () % spread;
+    bb.push_back (db::Box (x, y, x + 100, y + 100 + rand () % 200));
+  }
+  //  empty boxes don't interact
+  bb.push_back (db::Box ());
+
+  db::box_convert<db::Box> bc;
+
+  db::box_scanner<db::Box, size_t> bs;
+  for (std::vector<db::Box>::const_iterator b = bb.begin (); b != bb.end (); ++b) {
+    bs.insert (&*b, b - bb.begin ());
+  }
+
+  BoxScannerTestRecorder3 ref;
+  bs.process (ref, enl, bc);
+
+  db::partitioned_box_scanner<db::Box, size_t> pbs;
+  for (std::vector<db::Box>::const_iterator b = bb.begin (); b != bb.end (); ++b) {
+    pbs.insert (&*b, b - bb.begin ());
+  }
+
+  pbs.partition (bands, enl, bc);
+  EXPECT_EQ (pbs.bands () <= bands, true);
+  EXPECT_EQ (pbs.bands () > 0, true);
+
+  //  each band delivers to a receiver of its own
+  BoxScannerTestRecorder3 all;
+  for (size_t i = 0; i < pbs.bands (); ++i) {
+    BoxScannerTestRecorder3 tr;
+    pbs.process_band (i, tr, enl, bc);
+    all.finished.insert (all.finished.end (), tr.finished.begin (), tr.finished.end ());
+    all.interactions.insert (all.interactions.end (), tr.interactions.begin (), tr.interactions.end ());
+  }
+
+  //  each interaction and each object is reported exactly once
+  std::sort (ref.finished.begin (), ref.finished.end ());
+  std::sort (all.finished.begin (), all.finished.end ());
+  EXPECT_EQ (all.finished == ref.finished, true);
+  EXPECT_EQ (all.finished.size (), bb.size ());
+
+  std::sort (ref.interactions.begin (), ref.interactions.end ());
+  std::sort (all.interactions.begin (), all.interactions.end ());
+  EXPECT_EQ (all.interactions.size (), ref.interactions.size ());
+  EXPECT_EQ (all.interactions == ref.interactions, true);
+}
+
+TEST(12)
+{
+  run_test12 (_this, 1000, 1, 1000, 1);
+  run_test12 (_this, 1000, 4, 1000, 1);
+  run_test12 (_this, 1000, 16, 1000, 0);
+  run_test12 (_this, 1000, 16, 1000, 50);
+  run_test12 (_this, 1000, 7, 10000, 500);
+  run_test12 (_this, 10, 16, 100, 1);
+}
+
+TEST(12a)
+{
+  db::partitioned_box_scanner<db::Box, size_t> pbs;
+
+  std::vector<db::Box> bb;
+  bb.push_back (db::Box (0, 0, 100, 100));
+  bb.push_back (db::Box (0, 110, 100, 210));
+  bb.push_back (db::Box (0, 220, 100, 320));
+  bb.push_back (db::Box (0, 330, 100, 430));
+  for (std::vector<db::Box>::const_iterator b = bb.begin (); b != bb.end (); ++b) {
+    pbs.insert (&*b, b - bb.begin ());
+  }
+
+  db::box_convert<db::Box> bc;
+  pbs.partition (4, 20, bc);
+  EXPECT_EQ (pbs.bands (), size_t (4));
+
+  std::string s;
+  for (size_t i = 0; i < pbs.bands (); ++i) {
+    BoxScannerTestRecorder tr;
+    pbs.process_band (i, tr, 20, bc);
+    s += "[" + tr.str + "]";
+  }
+
+  //  the interactions are reported by the band holding the upper box
+  EXPECT_EQ (s, "[<0>][(0-1)<1>][(1-2)<2>][(2-3)<3>]");
+}
+
 
 #include "tlStream.h"
 #include "dbReader.h"
@@ -2126,6 +2126,103 @@ TEST(46)
   EXPECT_EQ (out[5].to_string (), "(150,250;300,500;613,250)");
 }
 
+//  Multi-threaded mode: results need to be identical to the single-threaded mode
+TEST(50)
+{
+  std::vector<db::Polygon> a, b;
+
+  for (unsigned int i = 0; i < 4000; ++i) {
+
+    db::Coord x = rand () % 20000, y = rand () % 20000;
+    db::Coord w = 1 + rand () % 300, h = 1 + rand () % 300;
+
+    db::Point pts[] = {
+      db::Point (x, y),
+      db::Point (x + w, y + rand () % 50),
+      db::Point (x + w - rand () % 40, y + h),
+      db::Point (x + rand () % 60, y + h - rand () % 30)
+    };
+
+    db::Polygon p;
+    if (i % 2 == 0) {
+      p = db::Polygon (db::Box (x, y, x + w, y + h));
+    } else {
+      p.assign_hull (&pts[0], &pts[sizeof(pts) / sizeof(pts[0])]);
+    }
+    (i < 2000 ? a : b).push_back (p);
+
+  }
+
+  db::EdgeProcessor ep_st;
+  db::EdgeProcessor ep_mt;
+  ep_mt.set_threads (4);
+  EXPECT_EQ (ep_mt.threads (), size_t (4));
+
+  std::vector<db::Polygon> out_st, out_mt;
+
+  ep_st.merge (a, out_st, 0, true, true);
+  ep_mt.merge (a, out_mt, 0, true, true);
+  EXPECT_EQ (out_st.size () > 0, true);
+  EXPECT_EQ (out_mt == out_st, true);
+
+  ep_st.merge (a, out_st, 1, false, false);
+  ep_mt.merge (a, out_mt, 1, false, false);
+  EXPECT_EQ (out_mt == out_st, true);
+
+  ep_st.boolean (a, b, out_st, db::BooleanOp::And, true, true);
+  ep_mt.boolean (a, b, out_mt, db::BooleanOp::And, true, true);
+  EXPECT_EQ (out_st.size () > 0, true);
+  EXPECT_EQ (out_mt == out_st, true);
+
+  ep_st.boolean (a, b, out_st, db::BooleanOp::ANotB, false, false);
+  ep_mt.boolean (a, b, out_mt, db::BooleanOp::ANotB, false, false);
+  EXPECT_EQ (out_mt == out_st, true);
+
+  ep_st.boolean (a, b, out_st, db::BooleanOp::Xor, true, false);
+  ep_mt.boolean (a, b, out_mt, db::BooleanOp::Xor, true, false);
+  EXPECT_EQ (out_mt == out_st, true);
+
+  ep_st.size (a, 30, 20, out_st, 2, true, true);
+  ep_mt.size (a, 30, 20, out_mt, 2, true, true);
+  EXPECT_EQ (out_mt == out_st, true);
+
+  ep_st.simple_merge (b, out_st, false, true, 0);
+  ep_mt.simple_merge (b, out_mt, false, true, 0);
+  EXPECT_EQ (out_mt == out_st, true);
+
+  std::vector<db::Edge> edges_st, edges_mt;
+
+  ep_st.boolean (a, b, edges_st, db::BooleanOp::Or);
+  ep_mt.boolean (a, b, edges_mt, db::BooleanOp::Or);
+  EXPECT_EQ (edges_st.size () > 0, true);
+  EXPECT_EQ (edges_mt == edges_st, true);
+
+  //  Edges vs. polygons
+  ep_st.clear ();
+  ep_mt.clear ();
+  for (std::vector<db::Polygon>::const_iterator p = a.begin (); p != a.end (); ++p) {
+    ep_st.insert (*p, 0);
+    ep_mt.insert (*p, 0);
+  }
+  for (std::vector<db::Polygon>::const_iterator p = b.begin (); p != b.end (); ++p) {
+    for (db::Polygon::polygon_edge_iterator e = p->begin_edge (); ! e.at_end (); ++e) {
+      ep_st.insert (*e, 1);
+      ep_mt.insert (*e, 1);
+    }
+  }
+
+  db::EdgeContainer ec_st (edges_st);
+  db::EdgePolygonOp op_st (false, true);
+  ep_st.process (ec_st, op_st);
+
+  db::EdgeContainer ec_mt (edges_mt);
+  db::EdgePolygonOp op_mt (false, true);
+  ep_mt.process (ec_mt, op_mt);
+
+  EXPECT_EQ (edges_st.size () > 0, true);
+  EXPECT_EQ (edges_mt == edges_st, true);
+}
+
 // # 880
 TEST(100)
 {
@@ -24,6 +24,10 @@
 
 #include "dbGDS2Reader.h"
 #include "dbLayoutDiff.h"
+#include "dbLazyCellLoader.h"
+#include "dbGDS2Writer.h"
+#include "dbSaveLayoutOptions.h"
+#include "tlThreadedWorkers.h"
 #include "utHead.h"
 
 #include <iostream>
@@ -347,3 +351,352 @@ TEST(2)
   }
 }
 
+
+//  lazy loading
+TEST(3) 
+{
+  std::string tmp_file = _this->tmp_file ("tmp_lazy.gds");
+  {
+    tl::OutputStream os (tmp_file, tl::OutputStream::OM_Plain);
+    os.put ((const char *) data, sizeof (data));
+  }
+
+  db::Layout layout;
+  {
+    tl::InputStream file (tmp_file);
+    db::GDS2Reader reader (file);
+    reader.read (layout);
+  }
+
+  db::LoadLayoutOptions options;
+  options.get_options<db::CommonReaderOptions> ().lazy_loading = true;
+
+  db::Layout layout_lazy;
+  {
+    tl::InputStream file (tmp_file);
+    db::GDS2Reader reader (file);
+    reader.read (layout_lazy, options);
+  }
+
+  EXPECT_EQ (layout_lazy.lazy_cell_loader () != 0, true);
+  EXPECT_EQ (layout_lazy.cells (), layout.cells ());
+  EXPECT_EQ (layout_lazy.layers (), layout.layers ());
+
+  size_t nlazy = 0;
+  for (db::Layout::const_iterator c = layout_lazy.begin (); c != layout_lazy.end (); ++c) {
+    if (c->is_lazy ()) {
+      ++nlazy;
+    }
+  }
+  EXPECT_EQ (nlazy, size_t (3));
+
+  //  the bounding boxes are available without loading the shapes
+  for (db::Layout::const_iterator c = layout_lazy.begin (); c != layout_lazy.end (); ++c) {
+    const db::Cell &ref_cell = layout.cell (c->cell_index ());
+    EXPECT_EQ (c->bbox ().to_string (), ref_cell.bbox ().to_string ());
+    for (unsigned int l = 0; l < layout.layers (); ++l) {
+      EXPECT_EQ (c->bbox (l).to_string (), ref_cell.bbox (l).to_string ());
+    }
+    EXPECT_EQ (c->is_lazy (), true);
+    EXPECT_EQ (c->empty (), false);
+  }
+  EXPECT_EQ (layout_lazy.lazy_cell_loader ()->loaded_cells (), size_t (0));
+
+  //  accessing the shapes loads a cell - this is not reported as a change
+  layout_lazy.set_record_changes (true);
+  size_t serial = layout_lazy.change_serial ();
+  std::vector<db::LayoutChangeRegion> regions;
+
+  const db::Cell &trans = layout_lazy.cell (0);
+  EXPECT_EQ (trans.shapes (0).size (), layout.cell (0).shapes (0).size ());
+  EXPECT_EQ (trans.is_lazy (), false);
+  EXPECT_EQ (layout_lazy.changed_regions (serial, regions), true);
+  EXPECT_EQ (regions.size (), size_t (0));
+  EXPECT_EQ (layout_lazy.change_serial (), serial);
+  layout_lazy.set_record_changes (false);
+  EXPECT_EQ (layout_lazy.cell (1).is_lazy (), true);
+  EXPECT_EQ (layout_lazy.lazy_cell_loader ()->loaded_cells (), size_t (1));
+
+  //  the comparison loads all cells
+  bool equal = db::compare_layouts (layout_lazy, layout, db::layout_diff::f_verbose, 0);
+  EXPECT_EQ (equal, true);
+  EXPECT_EQ (layout_lazy.lazy_cell_loader ()->loaded_cells (), size_t (3));
+
+  //  copies are not lazy
+  db::Layout layout_lazy2;
+  {
+    tl::InputStream file (tmp_file);
+    db::GDS2Reader reader (file);
+    reader.read (layout_lazy2, options);
+  }
+
+  db::Layout layout_copy;
+  layout_copy = layout_lazy2;
+  EXPECT_EQ (layout_copy.lazy_cell_loader () == 0, true);
+  equal = db::compare_layouts (layout_copy, layout, db::layout_diff::f_verbose, 0);
+  EXPECT_EQ (equal, true);
+
+  //  memory streams can't be mapped again: no lazy loading
+  tl::InputMemoryStream im ((const char *) data, sizeof (data));
+  db::Layout layout_mem;
+  {
+    tl::InputStream file (im);
+    db::GDS2Reader reader (file);
+    reader.read (layout_mem, options);
+  }
+  EXPECT_EQ (layout_mem.lazy_cell_loader () == 0, true);
+  equal = db::compare_layouts (layout_mem, layout, db::layout_diff::f_verbose, 0);
+  EXPECT_EQ (equal, true);
+
+  //  overwriting the source file: the cells are loaded before and the file is released
+  db::Layout layout_lazy3;
+  {
+    tl::InputStream file (tmp_file);
+    db::GDS2Reader reader (file);
+    reader.read (layout_lazy3, options);
+  }
+
+  EXPECT_EQ (layout_lazy3.lazy_cell_loader ()->reads_from (tmp_file), true);
+  layout_lazy3.load_lazy_cells (tmp_file);
+  EXPECT_EQ (layout_lazy3.lazy_cell_loader ()->reads_from (tmp_file), false);
+  EXPECT_EQ (layout_lazy3.lazy_cell_loader ()->loaded_cells (), size_t (3));
+
+  {
+    tl::OutputStream os (tmp_file, tl::OutputStream::OM_Plain);
+    db::GDS2Writer writer;
+    writer.write (layout_lazy3, os, db::SaveLayoutOptions ());
+  }
+
+  equal = db::compare_layouts (layout_lazy3, layout, db::layout_diff::f_verbose, 0);
+  EXPECT_EQ (equal, true);
+}
+
+class LazyLoadTask
+  : public tl::Task
+{
+public:
+  LazyLoadTask (const db::Cell *cell, size_t *count) : mp_cell (cell), mp_count (count) { }
+  const db::Cell *mp_cell;
+  size_t *mp_count;
+};
+
+class LazyLoadWorker
+  : public tl::Worker
+{
+public:
+  LazyLoadWorker () : tl::Worker () { }
+
+protected:
+  void perform_task (tl::Task *task)
+  {
+    LazyLoadTask *load_task = dynamic_cast<LazyLoadTask *> (task);
+    if (load_task) {
+      size_t n = 0;
+      for (unsigned int l = 0; l < load_task->mp_cell->layers (); ++l) {
+        n += load_task->mp_cell->shapes (l).size ();
+      }
+      *load_task->mp_count = n;
+    }
+  }
+};
+
+//  lazy loading from multiple threads
+TEST(4)
+{
+  std::string tmp_file = _this->tmp_file ("tmp_lazy_mt.gds");
+  {
+    tl::OutputStream os (tmp_file, tl::OutputStream::OM_Plain);
+    os.put ((const char *) data, sizeof (data));
+  }
+
+  db::Layout layout;
+  {
+    tl::InputStream file (tmp_file);
+    db::GDS2Reader reader (file);
+    reader.read (layout);
+  }
+
+  db::LoadLayoutOptions options;
+  options.get_options<db::CommonReaderOptions> ().lazy_loading = true;
+
+  for (int i = 0; i < 10; ++i) {
+
+    db::Layout layout_lazy;
+    {
+      tl::InputStream file (tmp_file);
+      db::GDS2Reader reader (file);
+      reader.read (layout_lazy, options);
+    }
+
+    layout_lazy.update ();
+
+    //  every cell is accessed by several tasks at the same time
+    std::vector<size_t> counts (layout_lazy.cells () * 4, 0);
+    tl::Job<LazyLoadWorker> job (4);
+    size_t n = 0;
+    for (int k = 0; k < 4; ++k) {
+      for (db::Layout::const_iterator c = layout_lazy.begin (); c != layout_lazy.end (); ++c) {
+        job.schedule (new LazyLoadTask (&*c, &counts [n++]));
+      }
+    }
+
+    job.start ();
+    job.wait ();
+
+    n = 0;
+    for (int k = 0; k < 4; ++k) {
+      for (db::Layout::const_iterator c = layout_lazy.begin (); c != layout_lazy.end (); ++c) {
+        const db::Cell &ref_cell = layout.cell (c->cell_index ());
+        size_t nref = 0;
+        for (unsigned int l = 0; l < ref_cell.layers (); ++l) {
+          nref += ref_cell.shapes (l).size ();
+        }
+        EXPECT_EQ (counts [n++], nref);
+      }
+    }
+
+    //  all cells are loaded now and the file is released
+    EXPECT_EQ (layout_lazy.lazy_cell_loader ()->loaded_cells (), size_t (3));
+    EXPECT_EQ (layout_lazy.lazy_cell_loader ()->reads_from (tmp_file), false);
+
+    bool equal = db::compare_layouts (layout_lazy, layout, db::layout_diff::f_verbose, 0);
+    EXPECT_EQ (equal, true);
+
+  }
+}
+
+//  packing: not done by the reader, but lazily loaded cells are packed once the layout is packed
+TEST(5)
+{
+  std::string tmp_file = _this->tmp_file ("tmp_lazy_packed.gds");
+  {
+    tl::OutputStream os (tmp_file, tl::OutputStream::OM_Plain);
+    os.put ((const char *) data, sizeof (data));
+  }
+
+  db::Layout layout (false);
+  {
+    tl::InputStream file (tmp_file);
+    db::GDS2Reader reader (file);
+    reader.read (layout);
+  }
+
+  EXPECT_EQ (layout.shapes_packed (), false);
+
+  db::LoadLayoutOptions options;
+  options.get_options<db::CommonReaderOptions> ().lazy_loading = true;
+
+  db::Layout layout_lazy (false);
+  {
+    tl::InputStream file (tmp_file);
+    db::GDS2Reader reader (file);
+    reader.read (layout_lazy, options);
+  }
+
+  EXPECT_EQ (layout_lazy.shapes_packed (), false);
+  layout_lazy.pack_shapes ();
+  EXPECT_EQ (layout_lazy.shapes_packed (), true);
+  EXPECT_EQ (layout_lazy.lazy_cell_loader ()->loaded_cells (), size_t (0));
+
+  //  the comparison loads all cells
+  bool equal = db::compare_layouts (layout_lazy, layout, db::layout_diff::f_verbose, 0);
+  EXPECT_EQ (equal, true);
+  EXPECT_EQ (layout_lazy.lazy_cell_loader ()->loaded_cells (), size_t (3));
+
+  layout_lazy.clear ();
+  EXPECT_EQ (layout_lazy.shapes_packed (), false);
+}
+
+//  clearing lazy cells
+TEST(6)
+{
+  std::string tmp_file = _this->tmp_file ("tmp_lazy_clear.gds");
+  {
+    tl::OutputStream os (tmp_file, tl::OutputStream::OM_Plain);
+    os.put ((const char *) data, sizeof (data));
+  }
+
+  db::Layout layout;
+  {
+    tl::InputStream file (tmp_file);
+    db::GDS2Reader reader (file);
+    reader.read (layout);
+  }
+
+  db::LoadLayoutOptions options;
+  options.get_options<db::CommonReaderOptions> ().lazy_loading = true;
+
+  db::Manager m;
+  db::Layout layout_lazy (&m);
+  {
+    tl::InputStream file (tmp_file);
+    db::GDS2Reader reader (file);
+    reader.read (layout_lazy, options);
+  }
+
+  //  clearing inside a transaction loads the shapes, so the clear can be undone
+  m.transaction ("clear");
+  layout_lazy.cell (0).clear_shapes ();
+  m.commit ();
+  EXPECT_EQ (layout_lazy.cell (0).is_lazy (), false);
+  EXPECT_EQ (layout_lazy.lazy_cell_loader ()->loaded_cells (), size_t (1));
+
+  m.undo ();
+  bool equal = db::compare_layouts (layout_lazy, layout, db::layout_diff::f_verbose, 0);
+  EXPECT_EQ (equal, true);
+
+  //  outside a transaction, the shapes not loaded yet are dropped
+  db::Layout layout_lazy2;
+  {
+    tl::InputStream file (tmp_file);
+    db::GDS2Reader reader (file);
+    reader.read (layout_lazy2, options);
+  }
+
+  for (db::Layout::iterator c = layout_lazy2.begin (); c != layout_lazy2.end (); ++c) {
+    c->clear_shapes ();
+    EXPECT_EQ (c->is_lazy (), false);
+  }
+  EXPECT_EQ (layout_lazy2.lazy_cell_loader ()->loaded_cells (), size_t (0));
+  //  nothing is pending any longer, so the source file is released
+  EXPECT_EQ (layout_lazy2.lazy_cell_loader ()->reads_from (tmp_file), false);
+}
+
+//  lazy loading from a file truncated after reading
+TEST(7)
+{
+  std::string tmp_file = _this->tmp_file ("tmp_lazy_truncated.gds");
+  {
+    tl::OutputStream os (tmp_file, tl::OutputStream::OM_Plain);
+    os.put ((const char *) data, sizeof (data));
+  }
+
+  db::LoadLayoutOptions options;
+  options.get_options<db::CommonReaderOptions> ().lazy_loading = true;
+
+  db::Layout layout_lazy;
+  {
+    tl::InputStream file (tmp_file);
+    db::GDS2Reader reader (file);
+    reader.read (layout_lazy, options);
+  }
+
+  EXPECT_EQ (layout_lazy.lazy_cell_loader () != 0, true);
+  EXPECT_EQ (layout_lazy.cell (0).is_lazy (), true);
+
+  {
+    tl::OutputStream os (tmp_file, tl::OutputStream::OM_Plain);
+    os.put ((const char *) data, 16);
+  }
+
+  //  loading fails with an exception rather than reading the truncated mapping
+  std::string msg;
+  try {
+    layout_lazy.lazy_cell_loader ()->load (layout_lazy, 0);
+  } catch (tl::Exception &ex) {
+    msg = ex.msg ();
+  }
+  EXPECT_EQ (msg.find ("File has been modified") == 0, true);
+  EXPECT_EQ (layout_lazy.cell (0).is_lazy (), false);
+  EXPECT_EQ (layout_lazy.lazy_cell_loader ()->loaded_cells (), size_t (0));
+}
@@ -75,6 +75,29 @@ void run_test (ut::TestBase *_this, const char *file, const char *file_ref)
   if (! equal) {
     _this->raise (tl::sprintf ("Compare failed - see %s vs %s\n", tmp_file, file_ref));
   }
+
+  //  encoding the cells in separate threads must not change the output
+  std::string tmp_file_st = _this->tmp_file ("tmp_st.gds");
+  std::string tmp_file_mt = _this->tmp_file ("tmp_mt.gds");
+
+  for (unsigned int threads = 0; threads <= 4; threads += 4) {
+    tl::OutputStream stream (threads > 0 ? tmp_file_mt : tmp_file_st);
+    db::GDS2Writer writer;
+    db::SaveLayoutOptions options;
+    db::GDS2WriterOptions gds2_options;
+    gds2_options.write_timestamps = false;
+    gds2_options.threads = threads;
+    options.set_options (gds2_options);
+    writer.write (layout_org, stream, options);
+  }
+
+  {
+    tl::InputStream stream_st (tmp_file_st);
+    tl::InputStream stream_mt (tmp_file_mt);
+    if (stream_st.read_all () != stream_mt.read_all ()) {
+      _this->raise (tl::sprintf ("Files differ (multi-threaded write) - see %s vs %s\n", tmp_file_st, tmp_file_mt));
+    }
+  }
 }
 
 TEST(1)
@@ -202,3 +202,196 @@ TEST(1)
   EXPECT_EQ (ex, true);
 }
 
+
+static void build_update_test_layout (db::Layout &g)
+{
+  unsigned int l1 = g.insert_layer (db::LayerProperties (1, 0));
+  unsigned int l2 = g.insert_layer (db::LayerProperties (2, 0));
+
+  unsigned int seed = 17;
+
+  std::vector<db::cell_index_type> leafs;
+  for (int i = 0; i < 40; ++i) {
+    db::Cell &c = g.cell (g.add_cell ());
+    leafs.push_back (c.cell_index ());
+    for (int j = 0; j < 50; ++j) {
+      seed = seed * 1103515245 + 12345;
+      db::Coord x = db::Coord ((seed >> 8) % 10000), y = db::Coord ((seed >> 4) % 10000);
+      c.shapes ((j % 3) == 0 ? l2 : l1).insert (db::Box (x, y, x + 100 + j, y + 50 + i));
+      if ((j % 7) == 0) {
+        db::Point pts[] = { db::Point (x, y), db::Point (x + 500, y), db::Point (x + 500, y + 200 * (j % 4)) };
+        db::Path path (pts, pts + sizeof (pts) / sizeof (pts [0]), 20);
+        if (g.is_editable ()) {
+          c.shapes (l1).insert (path);
+        } else {
+          c.shapes (l1).insert (db::PathRef (path, g.shape_repository ()));
+        }
+      }
+    }
+  }
+
+  std::vector<db::cell_index_type> mids;
+  for (int i = 0; i < 10; ++i) {
+    db::Cell &c = g.cell (g.add_cell ());
+    mids.push_back (c.cell_index ());
+    for (int j = 0; j < 8; ++j) {
+      db::cell_index_type ci = leafs [(i * 3 + j * 5) % leafs.size ()];
+      if ((j % 2) == 0) {
+        c.insert (db::CellInstArray (db::CellInst (ci), db::Trans (j % 8, db::Vector (j * 1000, i * 500))));
+      } else {
+        c.insert (db::CellInstArray (db::CellInst (ci), db::Trans (db::Vector (i * 100, j * 1000)), db::Vector (12000, 0), db::Vector (0, 11000), 3, 2));
+      }
+    }
+    if (i > 0) {
+      c.insert (db::CellInstArray (db::CellInst (mids [i - 1]), db::Trans (db::Vector (-50000, 0))));
+    }
+  }
+
+  db::Cell &top = g.cell (g.add_cell ("TOP"));
+  for (int i = 0; i < 10; ++i) {
+    top.insert (db::CellInstArray (db::CellInst (mids [i]), db::Trans (db::Vector (i * 100000, 0))));
+  }
+  top.insert (db::CellInstArray (db::CellInst (leafs [0]), db::Trans ()));
+}
+
+static std::string update_test_dump (const db::Layout &g)
+{
+  std::string r;
+  db::Box search (-1000000, -1000000, 1000000, 1000000);
+
+  for (db::Layout::const_iterator c = g.begin (); c != g.end (); ++c) {
+
+    r += "cell " + tl::to_string (c->cell_index ()) + " " + c->bbox ().to_string () + " levels=" + tl::to_string (c->hierarchy_levels ()) + "\n";
+
+    for (unsigned int l = 0; l < g.layers (); ++l) {
+      r += "  bbox " + tl::to_string (l) + " " + c->bbox (l).to_string () + "\n";
+      for (db::Shapes::shape_iterator s = c->shapes (l).begin_touching (search, db::ShapeIterator::All); ! s.at_end (); ++s) {
+        r += "  " + s->to_string () + "\n";
+      }
+    }
+
+    for (db::Cell::touching_iterator i = c->begin_touching (search); ! i.at_end (); ++i) {
+      r += "  " + i->to_string () + "\n";
+    }
+
+  }
+
+  return r;
+}
+
+//  Parallel update
+TEST(2)
+{
+  for (unsigned int e = 0; e < 2; ++e) {
+
+    db::Layout g (e != 0);
+    build_update_test_layout (g);
+
+    db::Layout gp (e != 0);
+    gp.set_update_threads (4);
+    build_update_test_layout (gp);
+
+    g.update ();
+    gp.update ();
+
+    std::string ref = update_test_dump (g);
+    EXPECT_EQ (update_test_dump (gp), ref);
+
+    //  changes on the leaf level propagate to the parents
+    db::cell_index_type ci = g.begin_bottom_up () [0];
+    g.cell (ci).shapes (0).insert (db::Box (-200000, -1000, 0, 0));
+    gp.cell (ci).shapes (0).insert (db::Box (-200000, -1000, 0, 0));
+
+    g.update ();
+    gp.update ();
+
+    std::string ref2 = update_test_dump (g);
+    EXPECT_EQ (ref2 != ref, true);
+    EXPECT_EQ (update_test_dump (gp), ref2);
+
+  }
+}
+
+static std::string change_regions_to_string (const db::Layout &g, size_t since)
+{
+  std::vector<db::LayoutChangeRegion> regions;
+  if (! g.changed_regions (since, regions)) {
+    return "(unknown)";
+  }
+
+  std::string r;
+  for (std::vector<db::LayoutChangeRegion>::const_iterator i = regions.begin (); i != regions.end (); ++i) {
+    if (! r.empty ()) {
+      r += ";";
+    }
+    r += tl::to_string (i->cell_index) + "/" + tl::to_string (i->layer) + ":" + i->box.to_string ();
+  }
+  return r;
+}
+
+//  Change regions
+TEST(3)
+{
+  db::Layout g (true);
+  unsigned int l1 = g.insert_layer (db::LayerProperties (1, 0));
+  unsigned int l2 = g.insert_layer (db::LayerProperties (2, 0));
+  db::Cell &c1 (g.cell (g.add_cell ()));
+  db::Cell &c2 (g.cell (g.add_cell ()));
+  c1.shapes (l1).insert (db::Box (0, 0, 100, 100));
+  g.update ();
+
+  //  not recording
+  size_t s0 = g.change_serial ();
+  c1.shapes (l1).insert (db::Box (0, 0, 10, 10));
+  EXPECT_EQ (change_regions_to_string (g, s0), "(unknown)");
+
+  g.set_record_changes (true);
+  g.update ();
+
+  size_t s1 = g.change_serial ();
+  EXPECT_EQ (change_regions_to_string (g, s1), "");
+
+  db::Shape s = c1.shapes (l1).insert (db::Box (200, 0, 300, 100));
+  c2.shapes (l2).insert (db::Polygon (db::Box (-10, -20, 10, 20)));
+
+  //  every layer changed reports the change
+  EXPECT_EQ (g.bboxes_dirty (l1), true);
+  EXPECT_EQ (g.bboxes_dirty (l2), true);
+
+  size_t s2 = g.change_serial ();
+  c1.shapes (l1).replace (s, db::Box (400, 0, 500, 100));
+
+  EXPECT_EQ (change_regions_to_string (g, s1), "0/0:(200,0;300,100);1/1:(-10,-20;10,20);0/0:(200,0;300,100);0/0:(400,0;500,100)");
+  EXPECT_EQ (change_regions_to_string (g, s2), "0/0:(200,0;300,100);0/0:(400,0;500,100)");
+
+  g.update ();
+  EXPECT_EQ (g.bboxes_dirty (l1), false);
+
+  //  clearing reports the layer's bounding box
+  size_t s3 = g.change_serial ();
+  c1.clear (l1);
+  EXPECT_EQ (change_regions_to_string (g, s3), "0/0:(0,0;500,100)");
+
+  //  changes under construction are not recorded individually
+  size_t s4 = g.change_serial ();
+  g.start_changes ();
+  c2.shapes (l1).insert (db::Box (0, 0, 10, 10));
+  g.end_changes ();
+  EXPECT_EQ (change_regions_to_string (g, s4), "(unknown)");
+  EXPECT_EQ (change_regions_to_string (g, g.change_serial ()), "");
+
+  //  swapping shape containers does not report a region
+  size_t s5 = g.change_serial ();
+  c2.swap (l1, l2);
+  EXPECT_EQ (change_regions_to_string (g, s5), "(unknown)");
+
+  //  the layer is reported correctly after the containers have been rearranged
+  unsigned int l3 = g.insert_layer (db::LayerProperties (3, 0));
+  c2.shapes (l3).insert (db::Box (0, 0, 10, 10));
+  g.update ();
+  size_t s6 = g.change_serial ();
+  c2.shapes (l2).insert (db::Box (0, 0, 20, 20));
+  c2.shapes (l3).insert (db::Box (0, 0, 30, 30));
+  c2.shapes (l1).insert (db::Box (0, 0, 40, 40));
+  EXPECT_EQ (change_regions_to_string (g, s6), "1/1:(0,0;20,20);1/2:(0,0;30,30);1/0:(0,0;40,40)");
+}
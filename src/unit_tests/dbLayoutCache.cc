@@ -0,0 +1,192 @@
+
+/*
+
+  KLayout Layout Viewer
+  Copyright (C) 2006-2017 Matthias Koefferlein
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+
+#include "dbLayoutCache.h"
+#include "dbLayoutDiff.h"
+#include "dbReader.h"
+#include "dbGDS2Writer.h"
+#include "dbCommonReader.h"
+#include "dbLayout.h"
+#include "utHead.h"
+
+static void read_layout (db::Layout &layout, const std::string &fn, const db::LoadLayoutOptions &options = db::LoadLayoutOptions ())
+{
+  tl::InputStream stream (fn);
+  db::Reader reader (stream);
+  reader.read (layout, options);
+}
+
+static bool has_shape_arrays (const db::Layout &layout)
+{
+  for (db::Layout::const_iterator c = layout.begin (); c != layout.end (); ++c) {
+    for (unsigned int l = 0; l < layout.layers (); ++l) {
+      if (layout.is_valid_layer (l)) {
+        for (db::ShapeIterator s = c->shapes (l).begin (db::ShapeIterator::All); ! s.at_end (); ++s) {
+          if (s.in_array ()) {
+            return true;
+          }
+        }
+      }
+    }
+  }
+  return false;
+}
+
+//  Round trip through the cache format
+TEST(1)
+{
+  const char *files[] = { "t3.1.oas", "t4.1.oas", "t5.1.oas", "t6.1.oas", "t7.1.oas", "t8.1.oas", "t10.1.oas", "t11.1.oas", "t12.1.oas" };
+
+  bool any_arrays = false;
+
+  for (unsigned int e = 0; e < 2; ++e) {
+
+    for (size_t i = 0; i < sizeof (files) / sizeof (files [0]); ++i) {
+
+      std::string fn (ut::testsrc ());
+      fn += "/testdata/oasis/";
+      fn += files [i];
+
+      db::Manager m;
+      db::Layout layout (e != 0, &m);
+      read_layout (layout, fn);
+
+      db::LayerMap lm;
+      for (unsigned int l = 0; l < layout.layers (); ++l) {
+        if (layout.is_valid_layer (l)) {
+          lm.map (layout.get_properties (l), l);
+        }
+      }
+
+      std::string tmp_file = _this->tmp_file ("tmp.klc");
+      {
+        tl::OutputStream os (tmp_file, tl::OutputStream::OM_Plain);
+        db::LayoutCache::write (os, layout, lm, fn);
+      }
+
+      db::Layout layout_cached (e != 0, &m);
+      db::LayerMap lm_cached;
+      {
+        tl::InputStream is (tmp_file);
+        EXPECT_EQ (db::LayoutCache::read (is, layout_cached, lm_cached, fn), true);
+      }
+
+      bool equal = db::compare_layouts (layout_cached, layout, db::layout_diff::f_verbose, 0);
+      if (! equal) {
+        _this->raise (tl::sprintf ("Compare failed for %s (editable=%d)", files [i], int (e)));
+      }
+      EXPECT_EQ (lm_cached.to_string (), lm.to_string ());
+
+      if (has_shape_arrays (layout)) {
+        EXPECT_EQ (has_shape_arrays (layout_cached), true);
+        any_arrays = true;
+      }
+
+      //  a different stamp does not deliver a layout
+      db::Layout layout_other (e != 0, &m);
+      {
+        tl::InputStream is (tmp_file);
+        EXPECT_EQ (db::LayoutCache::read (is, layout_other, lm_cached, fn + "x"), false);
+      }
+      EXPECT_EQ (layout_other.cells (), size_t (0));
+
+    }
+
+  }
+
+  EXPECT_EQ (any_arrays, true);
+}
+
+//  Cache hits and invalidation through db::Reader
+TEST(2)
+{
+  db::Layout layout_org;
+  {
+    std::string fn (ut::testsrc ());
+    fn += "/testdata/oasis/t11.1.oas";
+    read_layout (layout_org, fn);
+  }
+
+  std::string tmp_file = _this->tmp_file ("tmp_cached.gds");
+  {
+    tl::OutputStream stream (tmp_file);
+    db::GDS2Writer writer;
+    writer.write (layout_org, stream, db::SaveLayoutOptions ());
+  }
+
+  //  the cache is enabled through the reader options
+  db::LoadLayoutOptions cached;
+  cached.get_options<db::CommonReaderOptions> ().layout_cache_dir = _this->tmp_file ("layout_cache");
+
+  db::LoadLayoutOptions uncached;
+  uncached.get_options<db::CommonReaderOptions> ().layout_cache_dir = std::string ();
+
+  size_t hits = db::LayoutCache::hits ();
+
+  //  first read: cache miss, populates the cache
+  db::Layout layout1;
+  read_layout (layout1, tmp_file, cached);
+  EXPECT_EQ (db::LayoutCache::hits (), hits);
+
+  //  second read: taken from the cache
+  db::Layout layout2;
+  read_layout (layout2, tmp_file, cached);
+  EXPECT_EQ (db::LayoutCache::hits (), hits + 1);
+  EXPECT_EQ (db::compare_layouts (layout2, layout1, db::layout_diff::f_verbose, 0), true);
+
+  //  without a cache directory, the cache is not used
+  db::Layout layout2u;
+  read_layout (layout2u, tmp_file, uncached);
+  EXPECT_EQ (db::LayoutCache::hits (), hits + 1);
+
+  //  different options: different cache entry
+  db::LoadLayoutOptions options (cached);
+  options.get_options<db::CommonReaderOptions> ().enable_text_objects = false;
+  db::Layout layout3;
+  read_layout (layout3, tmp_file, options);
+  EXPECT_EQ (db::LayoutCache::hits (), hits + 1);
+
+  //  a changed file invalidates the cache entry
+  db::cell_index_type top = layout_org.add_cell ("NEW_TOP");
+  layout_org.cell (top).shapes (layout_org.insert_layer (db::LayerProperties (100, 0))).insert (db::Box (0, 0, 1000, 2000));
+  {
+    tl::OutputStream stream (tmp_file);
+    db::GDS2Writer writer;
+    writer.write (layout_org, stream, db::SaveLayoutOptions ());
+  }
+
+  db::Layout layout4;
+  read_layout (layout4, tmp_file, cached);
+  EXPECT_EQ (db::LayoutCache::hits (), hits + 1);
+  EXPECT_EQ (layout4.cell_by_name ("NEW_TOP").first, true);
+
+  db::Layout layout5;
+  read_layout (layout5, tmp_file, cached);
+  EXPECT_EQ (db::LayoutCache::hits (), hits + 2);
+  EXPECT_EQ (db::compare_layouts (layout5, layout4, db::layout_diff::f_verbose, 0), true);
+
+  //  no temporary files are left behind
+  QDir cache_dir (tl::to_qstring (_this->tmp_file ("layout_cache")));
+  EXPECT_EQ (cache_dir.entryList (QStringList () << "*.tmp", QDir::Files).size (), 0);
+}
+
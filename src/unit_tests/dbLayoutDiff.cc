@@ -1466,4 +1466,202 @@ TEST(7)
   EXPECT_EQ (r.text (), "");
 }
 
+static db::properties_id_type 
+make_prop_id (db::Layout &l, const char *name, int value)
+{
+  db::PropertiesRepository::properties_set ps;
+  ps.insert (std::make_pair (l.properties_repository ().prop_name_id (tl::Variant (name)), tl::Variant (value)));
+  return l.properties_repository ().properties_id (ps);
+}
+
+static void 
+make_layout_for_hash_test (db::Layout &l, bool reverse_props, unsigned int changes)
+{
+  l.insert_layer (0);
+  l.set_properties (0, db::LayerProperties (1, 0));
+  l.insert_layer (1);
+  l.set_properties (1, db::LayerProperties (2, 0));
+
+  //  the property ids differ between the layouts, but the property sets are the same
+  db::properties_id_type pa, pb;
+  if (reverse_props) {
+    pb = make_prop_id (l, "B", 2);
+    pa = make_prop_id (l, "A", 1);
+  } else {
+    pa = make_prop_id (l, "A", 1);
+    pb = make_prop_id (l, "B", 2);
+  }
+
+  db::Cell &top = l.cell (l.add_cell ("TOP"));
+
+  for (int i = 0; i < 100; ++i) {
+
+    db::Cell &c = l.cell (l.add_cell (("C" + tl::to_string (i)).c_str ()));
+
+    std::string text = "T" + tl::to_string (i);
+    if (i == 42 && (changes & 1) != 0) {
+      text = "X42";
+    }
+
+    db::properties_id_type pp = pb;
+    if (i == 7 && (changes & 2) != 0) {
+      pp = make_prop_id (l, "B", 3);
+    }
+
+    db::properties_id_type pi = (i % 2) ? pa : pb;
+    if (i == 13 && (changes & 4) != 0) {
+      pi = make_prop_id (l, "A", 3);
+    }
+
+    c.shapes (0).insert (db::BoxWithProperties (db::Box (0, 0, 100 + i, 200), pa));
+    c.shapes (0).insert (db::Polygon (db::Box (-i, -i, 50, 50)));
+    c.shapes (1).insert (db::Text (text, db::Trans (db::Vector (i, 10))));
+    c.shapes (1).insert (db::PolygonWithProperties (db::Polygon (db::Box (10, 20, 30, 40 + i)), pp));
+
+    top.insert (db::CellInstArrayWithProperties (db::CellInstArray (db::CellInst (c.cell_index ()), db::Trans (db::Vector (i * 1000, 0))), pi));
+    top.insert (db::CellInstArray (db::CellInst (c.cell_index ()), db::Trans (db::Vector (i * 1000, 1000)), db::Vector (0, 500), db::Vector (300, 0), 2, 3));
+
+  }
+}
+
+//  Content hashes: unchanged cells are skipped, changed cells are reported
+TEST(8) 
+{
+  db::Layout g;
+  make_layout_for_hash_test (g, false, 0);
+
+  TestDifferenceReceiver r;
+  bool eq;
+
+  {
+    db::Layout h;
+    make_layout_for_hash_test (h, true, 0);
+
+    r.clear ();
+    eq = db::compare_layouts (g, h, 0, 0, r); 
+
+    EXPECT_EQ (eq, true);
+    EXPECT_EQ (r.text (), "");
+  }
+
+  {
+    //  a text string changes
+    db::Layout h;
+    make_layout_for_hash_test (h, true, 1);
+
+    r.clear ();
+    eq = db::compare_layouts (g, h, 0, 0, r); 
+
+    EXPECT_EQ (eq, false);
+    EXPECT_EQ (r.text (), "layout_diff: texts differ for layer 2/0 in cell C42\n");
+  }
+
+  {
+    //  a property value of a shape changes
+    db::Layout h;
+    make_layout_for_hash_test (h, true, 2);
+
+    r.clear ();
+    eq = db::compare_layouts (g, h, 0, 0, r); 
+
+    EXPECT_EQ (eq, false);
+    EXPECT_EQ (r.text (), "layout_diff: polygons differ for layer 2/0 in cell C7\n");
+  }
 
+  {
+    //  a property value of an instance changes
+    db::Layout h;
+    make_layout_for_hash_test (h, true, 4);
+
+    r.clear ();
+    eq = db::compare_layouts (g, h, 0, 0, r); 
+
+    EXPECT_EQ (eq, false);
+    EXPECT_EQ (r.text (), "layout_diff: instances differ in cell TOP\n");
+  }
+
+  {
+    //  all changes, properties are not compared
+    db::Layout h;
+    make_layout_for_hash_test (h, true, 1 | 2 | 4);
+
+    r.clear ();
+    eq = db::compare_layouts (g, h, 0, 0, r); 
+
+    EXPECT_EQ (eq, false);
+    EXPECT_EQ (r.text (), 
+      "layout_diff: texts differ for layer 2/0 in cell C42\n"
+      "layout_diff: polygons differ for layer 2/0 in cell C7\n"
+      "layout_diff: instances differ in cell TOP\n"
+    );
+
+    r.clear ();
+    eq = db::compare_layouts (g, h, db::layout_diff::f_no_properties, 0, r); 
+
+    EXPECT_EQ (eq, false);
+    EXPECT_EQ (r.text (), "layout_diff: texts differ for layer 2/0 in cell C42\n");
+  }
+}
+
+
+static void 
+make_layout_for_hash_test2 (db::Layout &l, const tl::Variant &value, double mag)
+{
+  l.insert_layer (0);
+  l.set_properties (0, db::LayerProperties (1, 0));
+
+  db::PropertiesRepository::properties_set ps;
+  ps.insert (std::make_pair (l.properties_repository ().prop_name_id (tl::Variant ("A")), value));
+  db::properties_id_type pa = l.properties_repository ().properties_id (ps);
+
+  db::Cell &top = l.cell (l.add_cell ("TOP"));
+  db::Cell &c = l.cell (l.add_cell ("C"));
+
+  c.shapes (0).insert (db::BoxWithProperties (db::Box (0, 0, 100, 200), pa));
+  top.insert (db::CellInstArray (db::CellInst (c.cell_index ()), db::ICplxTrans (mag, 0.0, false, db::Vector (0, 0))));
+}
+
+//  Content hashes are at least as strict as the compare
+TEST(9) 
+{
+  db::Layout g;
+  make_layout_for_hash_test2 (g, tl::Variant (1), 1.0);
+
+  TestDifferenceReceiver r;
+  bool eq;
+
+  {
+    db::Layout h;
+    make_layout_for_hash_test2 (h, tl::Variant (1), 1.0);
+
+    r.clear ();
+    eq = db::compare_layouts (g, h, 0, 0, r); 
+
+    EXPECT_EQ (eq, true);
+    EXPECT_EQ (r.text (), "");
+  }
+
+  {
+    //  a string is not a number
+    db::Layout h;
+    make_layout_for_hash_test2 (h, tl::Variant ("1"), 1.0);
+
+    r.clear ();
+    eq = db::compare_layouts (g, h, 0, 0, r); 
+
+    EXPECT_EQ (eq, false);
+    EXPECT_EQ (r.text (), "layout_diff: boxes differ for layer 1/0 in cell C\n");
+  }
+
+  {
+    //  a small magnification difference which is still beyond the compare's epsilon
+    db::Layout h;
+    make_layout_for_hash_test2 (h, tl::Variant (1), 1.0 + 1e-8);
+
+    r.clear ();
+    eq = db::compare_layouts (g, h, 0, 0, r); 
+
+    EXPECT_EQ (eq, false);
+    EXPECT_EQ (r.text (), "layout_diff: instances differ in cell TOP\n");
+  }
+}
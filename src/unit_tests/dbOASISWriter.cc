@@ -79,6 +79,27 @@ void run_test (ut::TestBase *_this, const char *file, bool scaling_test, int com
       _this->raise (tl::sprintf ("Compare failed - see %s vs %s\n", fn, tmp_file));
     }
 
+    //  encoding the cells in separate threads must not change the output
+    std::string tmp_file_mt = _this->tmp_file ("tmp_1mt.oas");
+
+    {
+      tl::OutputStream stream (tmp_file_mt);
+      db::OASISWriter writer;
+      db::SaveLayoutOptions options;
+      db::OASISWriterOptions oasis_options;
+      oasis_options.threads = 4;
+      options.set_options (oasis_options);
+      writer.write (layout, stream, options);
+    }
+
+    {
+      tl::InputStream stream_st (tmp_file);
+      tl::InputStream stream_mt (tmp_file_mt);
+      if (stream_st.read_all () != stream_mt.read_all ()) {
+        _this->raise (tl::sprintf ("Files differ (multi-threaded write) - see %s vs %s\n", tmp_file, tmp_file_mt));
+      }
+    }
+
   }
 
   {
@@ -234,6 +255,51 @@ void run_test (ut::TestBase *_this, const char *file, bool scaling_test, int com
       _this->raise (tl::sprintf ("Compare failed - see %s vs %s\n", fn, tmp_file));
     }
 
+    //  the same file read with parallel cell decoding
+    db::Layout layout3 (&m);
+
+    {
+      tl::InputStream stream3 (tmp_file);
+      db::Reader reader3 (stream3);
+      db::LoadLayoutOptions options;
+      db::OASISReaderOptions oasis_options;
+      oasis_options.expect_strict_mode = 1;
+      oasis_options.threads = 4;
+      options.set_options (oasis_options);
+      reader3.set_warnings_as_errors (true);
+      reader3.read (layout3, options);
+    }
+
+    CHECKPOINT ();
+    equal = db::compare_layouts (layout, layout3, db::layout_diff::f_verbose | db::layout_diff::f_flatten_array_insts, 0);
+    if (! equal) {
+      _this->raise (tl::sprintf ("Compare failed (multi-threaded read) - see %s vs %s\n", fn, tmp_file));
+    }
+
+    //  encoding the cells and compressing the CBLOCKs in separate threads must not change the output
+    std::string tmp_file_mt = _this->tmp_file ("tmp_4mt.oas");
+
+    {
+      tl::OutputStream stream (tmp_file_mt);
+      db::OASISWriter writer;
+      db::SaveLayoutOptions options;
+      db::OASISWriterOptions oasis_options;
+      oasis_options.write_cblocks = true;
+      oasis_options.strict_mode = true;
+      oasis_options.write_std_properties = 2;
+      oasis_options.threads = 4;
+      options.set_options (oasis_options);
+      writer.write (layout, stream, options);
+    }
+
+    {
+      tl::InputStream stream_st (tmp_file);
+      tl::InputStream stream_mt (tmp_file_mt);
+      if (stream_st.read_all () != stream_mt.read_all ()) {
+        _this->raise (tl::sprintf ("Files differ (multi-threaded write) - see %s vs %s\n", tmp_file, tmp_file_mt));
+      }
+    }
+
   }
 
   if (scaling_test) {
@@ -687,3 +687,49 @@ TEST(5)
   EXPECT_EQ (selected_boxes.size () > 100, true);
   EXPECT_EQ (db::compare_layouts (boxes2layout (selected_boxes), boxes2layout (selected_boxes2), db::layout_diff::f_verbose, 0, 100 /*max diff lines*/), true);
 }
+
+//  sparse layers: instances are selected by the bounding boxes on the selected layers
+TEST(6)
+{
+  db::Manager m;
+  db::Layout g (&m);
+  g.insert_layer (0);
+  g.insert_layer (1);
+
+  db::Cell &c0 (g.cell (g.add_cell ()));
+  db::Cell &c1 (g.cell (g.add_cell ()));
+  db::Cell &c2 (g.cell (g.add_cell ()));
+
+  c1.shapes (0).insert (db::Box (0, 0, 100, 100));
+  c1.shapes (1).insert (db::Box (1000, 1000, 1100, 1100));
+  c2.shapes (1).insert (db::Box (0, 0, 10, 10));
+
+  c0.insert (db::CellInstArray (db::CellInst (c1.cell_index ()), db::Trans ()));
+  c0.insert (db::CellInstArray (db::CellInst (c1.cell_index ()), db::Trans (db::Vector (5000, 0))));
+  c0.insert (db::CellInstArray (db::CellInst (c2.cell_index ()), db::Trans (db::Vector (1000, 1000))));
+
+  std::vector<unsigned int> l0;
+  l0.push_back (0);
+  std::vector<unsigned int> l01;
+  l01.push_back (0);
+  l01.push_back (1);
+
+  db::RecursiveShapeIterator i1 (g, c0, l0, db::Box (900, 900, 1200, 1200));
+  EXPECT_EQ (collect (i1, g, true), "");
+
+  db::RecursiveShapeIterator i2 (g, c0, l01, db::Box (900, 900, 1200, 1200));
+  EXPECT_EQ (collect (i2, g, true), "[$2](1000,1000;1100,1100)*1/[$3](1000,1000;1010,1010)*1");
+
+  db::RecursiveShapeIterator i3 (g, c0, l01, db::Box (5050, 50, 5060, 60));
+  EXPECT_EQ (collect (i3, g, true), "[$2](5000,0;5100,100)*0");
+
+  db::Region r;
+  r.insert (db::Box (900, 900, 1200, 1200));
+  r.insert (db::Box (5050, 50, 5060, 60));
+
+  db::RecursiveShapeIterator i4 (g, c0, l0, r);
+  EXPECT_EQ (collect (i4, g, true), "[$2](5000,0;5100,100)*0");
+
+  db::RecursiveShapeIterator i5 (g, c0, l01, r);
+  EXPECT_EQ (collect (i5, g, true), "[$2](1000,1000;1100,1100)*1/[$2](5000,0;5100,100)*0/[$3](1000,1000;1010,1010)*1");
+}
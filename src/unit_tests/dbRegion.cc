@@ -27,6 +27,7 @@
 #include "dbBoxScanner.h"
 
 #include <cstdio>
+#include <limits>
 
 TEST(1) 
 {
@@ -1169,3 +1170,151 @@ TEST(29)
   EXPECT_EQ (b.perimeter (), 8000000000.0);
 }
 
+
+TEST(30) 
+{
+  //  deep regions: hierarchical booleans and sizing vs. flat ones
+  db::Layout ly;
+  unsigned int l1 = ly.insert_layer (db::LayerProperties (1, 0));
+  unsigned int l2 = ly.insert_layer (db::LayerProperties (2, 0));
+
+  db::cell_index_type top = ly.add_cell ("TOP");
+  db::cell_index_type c1 = ly.add_cell ("C1");
+  db::cell_index_type c2 = ly.add_cell ("C2");
+
+  ly.cell (c2).shapes (l1).insert (db::Box (0, 0, 100, 100));
+  ly.cell (c2).shapes (l2).insert (db::Box (50, 50, 150, 150));
+  ly.cell (c1).shapes (l2).insert (db::Box (-20, -20, 30, 30));
+  ly.cell (c1).insert (db::CellInstArray (db::CellInst (c2), db::Trans (db::Vector (0, 0))));
+  ly.cell (c1).insert (db::CellInstArray (db::CellInst (c2), db::Trans (db::Trans::r90, db::Vector (400, 0))));
+
+  ly.cell (top).shapes (l1).insert (db::Box (200, -50, 400, 20));
+  ly.cell (top).insert (db::CellInstArray (db::CellInst (c1), db::Trans (), db::Vector (120, 0), db::Vector (0, 500), 5, 2));
+  ly.cell (top).insert (db::CellInstArray (db::CellInst (c2), db::Trans (db::Trans::m45, db::Vector (0, 1500))));
+
+  db::DeepShapeStore dss;
+  db::Region a (db::RecursiveShapeIterator (ly, ly.cell (top), l1), dss);
+  db::Region b (db::RecursiveShapeIterator (ly, ly.cell (top), l2), dss);
+  db::Region fa (db::RecursiveShapeIterator (ly, ly.cell (top), l1));
+  db::Region fb (db::RecursiveShapeIterator (ly, ly.cell (top), l2));
+
+  EXPECT_EQ (a.is_deep (), true);
+  EXPECT_EQ (b.is_deep (), true);
+  EXPECT_EQ (fa.is_deep (), false);
+  EXPECT_EQ (a.bbox ().to_string (), fa.bbox ().to_string ());
+
+  db::Region r;
+
+  r = a & b;
+  EXPECT_EQ (r.is_deep (), true);
+  EXPECT_EQ ((r ^ (fa & fb)).to_string (), "");
+
+  r = a - b;
+  EXPECT_EQ (r.is_deep (), true);
+  EXPECT_EQ ((r ^ (fa - fb)).to_string (), "");
+
+  r = b - a;
+  EXPECT_EQ (r.is_deep (), true);
+  EXPECT_EQ ((r ^ (fb - fa)).to_string (), "");
+
+  r = a ^ b;
+  EXPECT_EQ (r.is_deep (), true);
+  EXPECT_EQ ((r ^ (fa ^ fb)).to_string (), "");
+
+  r = a | b;
+  EXPECT_EQ (r.is_deep (), true);
+  EXPECT_EQ ((r ^ (fa | fb)).to_string (), "");
+
+  r = a.sized (30);
+  EXPECT_EQ (r.is_deep (), true);
+  EXPECT_EQ ((r ^ fa.sized (30)).to_string (), "");
+
+  r = (a + b).sized (-20);
+  EXPECT_EQ (r.is_deep (), true);
+  EXPECT_EQ ((r ^ (fa + fb).sized (-20)).to_string (), "");
+
+  r = a.sized (40, 40, 0);
+  EXPECT_EQ (r.is_deep (), true);
+  EXPECT_EQ ((r ^ fa.sized (40, 40, 0)).to_string (), "");
+
+  //  anisotropic sizing is not invariant against rotation, hence it is done flat
+  r = a.sized (40, 25, 0);
+  EXPECT_EQ (r.is_deep (), false);
+  EXPECT_EQ ((r ^ fa.sized (40, 25, 0)).to_string (), "");
+
+  r = (a.sized (20) - b).sized (-10);
+  EXPECT_EQ (r.is_deep (), true);
+  EXPECT_EQ ((r ^ (fa.sized (20) - fb).sized (-10)).to_string (), "");
+
+  //  deep regions from different stores or incompatible iterators are flat or computed flat
+  db::Region ad (db::RecursiveShapeIterator (ly, ly.cell (top), l1, db::Box (0, 0, 1000, 1000)), dss);
+  EXPECT_EQ (ad.is_deep (), false);
+
+  db::DeepShapeStore dss2;
+  db::Region b2 (db::RecursiveShapeIterator (ly, ly.cell (top), l2), dss2);
+  r = a & b2;
+  EXPECT_EQ (r.is_deep (), false);
+  EXPECT_EQ ((r ^ (fa & fb)).to_string (), "");
+}
+
+static std::string all_edge_pairs (const db::EdgePairs &ep)
+{
+  return ep.to_string (std::numeric_limits<size_t>::max ());
+}
+
+TEST(31) 
+{
+  //  multi-threaded checks deliver the same results in the same order as single-threaded ones
+  db::Region a, b;
+  for (int i = 0; i < 2000; ++i) {
+    db::Coord x = rand () % 20000;
+    db::Coord y = rand () % 20000;
+    a.insert (db::Box (x, y, x + 50 + rand () % 200, y + 50 + rand () % 200));
+    x = rand () % 20000;
+    y = rand () % 20000;
+    b.insert (db::Box (x, y, x + 50 + rand () % 200, y + 50 + rand () % 200));
+  }
+
+  db::Region amt (a), bmt (b);
+  amt.set_threads (4);
+  bmt.set_threads (4);
+
+  std::string s;
+
+  s = all_edge_pairs (a.width_check (120));
+  EXPECT_EQ (s.empty (), false);
+  EXPECT_EQ (all_edge_pairs (amt.width_check (120)), s);
+
+  s = all_edge_pairs (a.space_check (80));
+  EXPECT_EQ (s.empty (), false);
+  EXPECT_EQ (all_edge_pairs (amt.space_check (80)), s);
+  EXPECT_EQ (all_edge_pairs (amt.space_check (80, true, db::Projection)), all_edge_pairs (a.space_check (80, true, db::Projection)));
+
+  s = all_edge_pairs (a.notch_check (100));
+  EXPECT_EQ (all_edge_pairs (amt.notch_check (100)), s);
+
+  s = all_edge_pairs (a.isolated_check (100, false, db::Square));
+  EXPECT_EQ (all_edge_pairs (amt.isolated_check (100, false, db::Square)), s);
+
+  s = all_edge_pairs (a.separation_check (b, 60));
+  EXPECT_EQ (s.empty (), false);
+  EXPECT_EQ (all_edge_pairs (amt.separation_check (bmt, 60)), s);
+
+  s = all_edge_pairs (a.enclosing_check (b, 40));
+  EXPECT_EQ (s.empty (), false);
+  EXPECT_EQ (all_edge_pairs (amt.enclosing_check (bmt, 40)), s);
+
+  s = all_edge_pairs (a.overlap_check (b, 40));
+  EXPECT_EQ (all_edge_pairs (amt.overlap_check (bmt, 40)), s);
+
+  //  degenerated cases
+  db::Region e;
+  e.set_threads (4);
+  EXPECT_EQ (e.space_check (100).to_string (), "");
+  EXPECT_EQ (e.width_check (100).to_string (), "");
+
+  db::Region r (db::Box (0, 0, 100, 100));
+  r.insert (db::Box (150, 0, 250, 100));
+  r.set_threads (4);
+  EXPECT_EQ (all_edge_pairs (r.space_check (100)), "(100,100;100,0)/(150,0;150,100)");
+}
@@ -27,6 +27,9 @@
 #include "utHead.h"
 #include "dbOASISReader.h"
 #include "dbStatic.h"
+#include "tlString.h"
+
+#include <algorithm>
 
 
 TEST(1) 
@@ -3264,3 +3267,118 @@ TEST(22)
   EXPECT_EQ (shapes.find (*s).to_string (), "null");
 }
 
+
+static std::string shapes_to_string (const db::Shapes &shapes)
+{
+  std::vector<std::string> sl;
+  for (db::Shapes::shape_iterator s = shapes.begin (db::ShapeIterator::All); ! s.at_end (); ++s) {
+    sl.push_back (s->to_string ());
+  }
+  std::sort (sl.begin (), sl.end ());
+  return tl::join (sl, ";");
+}
+
+//  packed layers
+TEST(23)
+{
+  db::Polygon hole;
+  db::Point pts[] = { db::Point (0, 0), db::Point (0, 1000), db::Point (1000, 1000), db::Point (1000, 0) };
+  hole.assign_hull (&pts[0], &pts[sizeof (pts) / sizeof (pts[0])]);
+  db::Point hpts[] = { db::Point (100, 100), db::Point (200, 100), db::Point (150, 200) };
+  hole.insert_hole (&hpts[0], &hpts[sizeof (hpts) / sizeof (hpts[0])]);
+
+  db::layer<db::Polygon, db::unstable_layer_tag> l;
+  for (int i = 0; i < 100; ++i) {
+    l.insert (hole.moved (db::Vector (i * 2000, (i % 7) * 1500)));
+    l.insert (db::Polygon (db::Box (i * 100, -500, i * 100 + 50, -100)));
+  }
+  l.insert (db::Polygon ());
+
+  std::vector<std::string> sl;
+  for (db::layer<db::Polygon, db::unstable_layer_tag>::iterator p = l.begin (); p != l.end (); ++p) {
+    sl.push_back (p->to_string ());
+  }
+  std::sort (sl.begin (), sl.end ());
+
+  EXPECT_EQ (l.is_packed (), false);
+  l.pack ();
+  EXPECT_EQ (l.is_packed (), true);
+
+  std::vector<std::string> slp;
+  for (db::layer<db::Polygon, db::unstable_layer_tag>::iterator p = l.begin (); p != l.end (); ++p) {
+    slp.push_back (p->to_string ());
+  }
+  std::sort (slp.begin (), slp.end ());
+  EXPECT_EQ (tl::join (slp, ";"), tl::join (sl, ";"));
+
+  //  copies are not packed
+  db::layer<db::Polygon, db::unstable_layer_tag> lc (l);
+  EXPECT_EQ (lc.is_packed (), false);
+  EXPECT_EQ (lc.size (), l.size ());
+
+  //  the first edit unpacks
+  l.insert (hole);
+  EXPECT_EQ (l.is_packed (), false);
+  l.erase (l.begin () + (l.size () - 1));
+
+  slp.clear ();
+  for (db::layer<db::Polygon, db::unstable_layer_tag>::iterator p = l.begin (); p != l.end (); ++p) {
+    slp.push_back (p->to_string ());
+  }
+  std::sort (slp.begin (), slp.end ());
+  EXPECT_EQ (tl::join (slp, ";"), tl::join (sl, ";"));
+
+  l.pack ();
+  EXPECT_EQ (l.is_packed (), true);
+  l.clear ();
+  EXPECT_EQ (l.is_packed (), false);
+  EXPECT_EQ (l.size (), size_t (0));
+}
+
+TEST(24)
+{
+  for (int editable = 0; editable < 2; ++editable) {
+
+    db::Shapes shapes (editable != 0);
+
+    for (int i = 0; i < 50; ++i) {
+      db::Point pts[] = { db::Point (0, 0), db::Point (100, 300), db::Point (200, 0) };
+      db::Polygon poly;
+      poly.assign_hull (&pts[0], &pts[sizeof (pts) / sizeof (pts[0])]);
+      shapes.insert (poly.moved (db::Vector (i * 500, 0)));
+      shapes.insert (db::PolygonWithProperties (poly.moved (db::Vector (0, i * 500)), 17));
+      db::SimplePolygon spoly;
+      spoly.assign_hull (&pts[0], &pts[sizeof (pts) / sizeof (pts[0])]);
+      shapes.insert (spoly.moved (db::Vector (i * 500, i * 500)));
+      shapes.insert (db::Box (i * 10, 0, i * 10 + 5, 1000));
+    }
+
+    std::string s = shapes_to_string (shapes);
+    shapes.pack ();
+    EXPECT_EQ (shapes_to_string (shapes), s);
+
+    db::Shapes copy (editable != 0);
+    copy = shapes;
+    EXPECT_EQ (shapes_to_string (copy), s);
+
+    //  editing unpacks the layers
+    if (editable) {
+      db::Shapes::shape_iterator first = shapes.begin (db::ShapeIterator::Polygons);
+      db::Polygon p0;
+      first->polygon (p0);
+      shapes.erase_shape (*first);
+      shapes.insert (p0);
+      EXPECT_EQ (shapes_to_string (shapes), s);
+    }
+
+    shapes.insert (db::Polygon (db::Box (0, 0, 100, 100)));
+    copy.insert (db::Polygon (db::Box (0, 0, 100, 100)));
+    s = shapes_to_string (copy);
+    EXPECT_EQ (shapes_to_string (shapes), s);
+    EXPECT_EQ (shapes.size (), size_t (201));
+
+    shapes.clear ();
+    EXPECT_EQ (shapes_to_string (copy), s);
+
+  }
+}
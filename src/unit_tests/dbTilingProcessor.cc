@@ -385,3 +385,72 @@ TEST(4)
 
 }
 
+
+TEST(5)
+{
+  //  adaptive mode: a dense cluster next to a sparse area
+
+  db::Layout ly;
+  unsigned int l1 = ly.insert_layer (db::LayerProperties (1, 0));
+  unsigned int l2 = ly.insert_layer (db::LayerProperties (2, 0));
+  unsigned int o1 = ly.insert_layer (db::LayerProperties (10, 0));
+  unsigned int q1 = ly.insert_layer (db::LayerProperties (20, 0));
+  db::cell_index_type top = ly.add_cell ("TOP");
+
+  for (size_t i = 0; i < 20000; ++i) {
+    db::Coord x = get_rand () % 1000000;
+    db::Coord y = get_rand () % 1000000;
+    ly.cell (top).shapes (i < 18000 ? l1 : l2).insert (db::Box (x, y, x + 2000, y + 2000));
+    x = get_rand () % 10000000;
+    y = get_rand () % 10000000;
+    ly.cell (top).shapes (i < 1000 ? l1 : l2).insert (db::Box (x, y, x + 10000, y + 10000));
+  }
+
+  db::TilingProcessor tp;
+  tp.input ("i1", db::RecursiveShapeIterator (ly, ly.cell (top), l1));
+  tp.input ("i2", db::RecursiveShapeIterator (ly, ly.cell (top), l2));
+  tp.output ("o1", ly, top, o1);
+  tp.queue ("_output(o1, i1 ^ i2)");
+  tp.tile_size (2000, 2000);
+  tp.tile_border (5, 5);
+
+  EXPECT_EQ (tp.adaptive (), false);
+  tp.execute ("test");
+  size_t ntiles = tp.tile_statistics ().size ();
+  EXPECT_EQ (ntiles > size_t (1), true);
+
+  ly.swap_layers (o1, q1);
+
+  tp.set_adaptive (true);
+  tp.set_threads (2);
+  tp.execute ("test");
+
+  //  the hot tile is split
+  EXPECT_EQ (tp.tile_statistics ().size () > ntiles, true);
+
+  size_t max_cost = 0;
+  for (std::vector<db::TilingProcessor::TileStatistics>::const_iterator t = tp.tile_statistics ().begin (); t != tp.tile_statistics ().end (); ++t) {
+    max_cost = std::max (max_cost, t->cost);
+  }
+  EXPECT_EQ (max_cost > 0, true);
+  EXPECT_EQ (max_cost < 20000, true);
+
+  //  the sub-tiles keep the indexes of the original tile and are told apart by the sub-index
+  std::set<std::pair<std::pair<size_t, size_t>, size_t> > tile_ids;
+  bool any_sub_tile = false;
+  for (std::vector<db::TilingProcessor::TileStatistics>::const_iterator t = tp.tile_statistics ().begin (); t != tp.tile_statistics ().end (); ++t) {
+    tile_ids.insert (std::make_pair (std::make_pair (t->ix, t->iy), t->sub_index));
+    if (t->sub_index > 0) {
+      any_sub_tile = true;
+    }
+  }
+  EXPECT_EQ (tile_ids.size (), tp.tile_statistics ().size ());
+  EXPECT_EQ (any_sub_tile, true);
+
+  db::ShapeProcessor sp;
+
+  EXPECT_EQ (ly.cell (top).shapes (o1).empty (), false);
+  db::Shapes x1;
+  sp.boolean (ly, ly.cell (top), o1, ly, ly.cell (top), q1, x1, db::BooleanOp::Xor, true);
+  EXPECT_EQ (x1.empty (), true);
+}
@@ -0,0 +1,202 @@
+
+/*
+
+  KLayout Layout Viewer
+  Copyright (C) 2006-2017 Matthias Koefferlein
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+
+#include "utHead.h"
+
+#include "extNetExtractor.h"
+#include "dbReader.h"
+
+static int layer_for (const db::Layout &layout, const db::LayerProperties &lp)
+{
+  for (db::Layout::layer_iterator l = layout.begin_layers (); l != layout.end_layers (); ++l) {
+    if ((*l).second->log_equal (lp)) {
+      return int ((*l).first);
+    }
+  }
+  return -1;
+}
+
+static unsigned int computed_layer (ext::NetTracerData &data, int a, ext::NetTracerLayerExpression::Operator op, int b)
+{
+  ext::NetTracerLayerExpression *expr = new ext::NetTracerLayerExpression (a);
+  expr->merge (op, new ext::NetTracerLayerExpression (b));
+  return data.register_logical_layer (expr, 0);
+}
+
+static void read_layout (db::Layout &layout, const std::string &file)
+{
+  std::string fn (ut::testsrc ());
+  fn += "/testdata/net_tracer/";
+  fn += file;
+  tl::InputStream stream (fn);
+  db::Reader reader (stream);
+  reader.read (layout);
+}
+
+static std::string nets_to_string (const ext::NetExtractor &extractor, bool with_size = true)
+{
+  std::string s;
+  for (ext::NetExtractor::iterator n = extractor.begin (); n != extractor.end (); ++n) {
+    if (! s.empty ()) {
+      s += ";";
+    }
+    s += n->name () + "[";
+    for (std::vector<std::string>::const_iterator l = n->labels ().begin (); l != n->labels ().end (); ++l) {
+      if (l != n->labels ().begin ()) {
+        s += ",";
+      }
+      s += *l;
+    }
+    s += "]";
+    if (with_size) {
+      s += ":" + tl::to_string (n->size ());
+    }
+  }
+  return s;
+}
+
+TEST(1)
+{
+  db::Layout layout;
+  read_layout (layout, "t1.oas.gz");
+  const db::Cell &cell = layout.cell (*layout.begin_top_down ());
+
+  ext::NetTracerData data;
+  data.add_connection (ext::NetTracerConnection (layer_for (layout, db::LayerProperties (1, 0)), layer_for (layout, db::LayerProperties (2, 0)), layer_for (layout, db::LayerProperties (3, 0))));
+
+  ext::NetExtractor extractor;
+  extractor.extract (layout, cell, data);
+  EXPECT_EQ (nets_to_string (extractor), "THE_NAME[THE_NAME]:14");
+
+  //  the net is the same as the one delivered by the net tracer
+  ext::NetTracer tracer;
+  tracer.trace (layout, cell, db::Point (7000, 1500), layer_for (layout, db::LayerProperties (1, 0)), data);
+  EXPECT_EQ (tracer.size (), extractor.net (0).size ());
+  EXPECT_EQ (tracer.name (), extractor.net (0).name ());
+
+  //  tiled and multi-threaded
+  ext::NetExtractor tiled;
+  tiled.set_tile_size (2.0);
+  tiled.set_threads (2);
+  tiled.extract (layout, cell, data);
+  EXPECT_EQ (nets_to_string (tiled), "THE_NAME[THE_NAME]:14");
+}
+
+TEST(2)
+{
+  //  computed layers
+  db::Layout layout;
+  read_layout (layout, "t9.oas.gz");
+  const db::Cell &cell = layout.cell (*layout.begin_top_down ());
+
+  ext::NetTracerData data;
+
+  ext::NetTracerLayerExpression *a = new ext::NetTracerLayerExpression (layer_for (layout, db::LayerProperties (8, 0)));
+  a->merge (ext::NetTracerLayerExpression::OPNot, new ext::NetTracerLayerExpression (layer_for (layout, db::LayerProperties (12, 0))));
+  a->merge (ext::NetTracerLayerExpression::OPOr, new ext::NetTracerLayerExpression (layer_for (layout, db::LayerProperties (7, 0))));
+  unsigned int b = data.register_logical_layer (a, "b");
+  unsigned int c = computed_layer (data, layer_for (layout, db::LayerProperties (15, 0)), ext::NetTracerLayerExpression::OPAnd, layer_for (layout, db::LayerProperties (26, 0)));
+
+  data.add_connection (ext::NetTracerConnection (b, layer_for (layout, db::LayerProperties (7, 0))));
+  data.add_connection (ext::NetTracerConnection (b, c, layer_for (layout, db::LayerProperties (9, 0))));
+
+  ext::NetExtractor extractor;
+  extractor.extract (layout, cell, data);
+  std::string nets = nets_to_string (extractor, false);
+  EXPECT_EQ (nets, "[];A[A,D];C[C];B[B];E[E]");
+
+  EXPECT_EQ (extractor.nets_with_label ("A").size (), size_t (1));
+  EXPECT_EQ (extractor.nets_with_label ("A").front (), size_t (1));
+  EXPECT_EQ (extractor.nets_with_label ("X").size (), size_t (0));
+
+  //  the computed shapes are cut at the tile boundaries and joined again
+  for (int threads = 0; threads < 3; threads += 2) {
+    ext::NetExtractor tiled;
+    tiled.set_tile_size (0.7);
+    tiled.set_threads (threads);
+    tiled.extract (layout, cell, data);
+    EXPECT_EQ (nets_to_string (tiled, false), nets);
+  }
+}
+
+TEST(3)
+{
+  //  a computed conductor spanning many tiles, cut into two nets by a layer
+  db::Layout layout;
+  unsigned int l1 = layout.insert_layer (db::LayerProperties (1, 0));
+  unsigned int l2 = layout.insert_layer (db::LayerProperties (2, 0));
+  unsigned int l3 = layout.insert_layer (db::LayerProperties (3, 0));
+
+  db::Cell &top = layout.cell (layout.add_cell ("TOP"));
+  db::Cell &pad = layout.cell (layout.add_cell ("PAD"));
+
+  pad.shapes (l1).insert (db::Box (0, 0, 1000, 1000));
+  top.insert (db::CellInstArray (db::CellInst (pad.cell_index ()), db::Trans ()));
+  top.insert (db::CellInstArray (db::CellInst (pad.cell_index ()), db::Trans (db::Vector (29000, 0))));
+  top.shapes (l1).insert (db::Text ("A", db::Trans (db::Vector (500, 500))));
+  top.shapes (l1).insert (db::Text ("B", db::Trans (db::Vector (29500, 500))));
+  top.shapes (l2).insert (db::Box (0, 200, 30000, 800));
+  top.shapes (l3).insert (db::Box (14000, 0, 15000, 1000));
+
+  ext::NetTracerData data;
+  data.add_connection (ext::NetTracerConnection (l1, computed_layer (data, l2, ext::NetTracerLayerExpression::OPNot, l3)));
+
+  ext::NetExtractor extractor;
+  extractor.set_tile_size (0);
+  extractor.extract (layout, top, data);
+  EXPECT_EQ (nets_to_string (extractor), "A[A]:3;B[B]:3");
+
+  extractor.set_tile_size (1.0);
+  extractor.set_threads (2);
+  extractor.extract (layout, top, data);
+  EXPECT_EQ (nets_to_string (extractor, false), "A[A];B[B]");
+
+  //  without the cut, both pads are shorted
+  layout.clear_layer (l3);
+
+  extractor.extract (layout, top, data);
+  EXPECT_EQ (nets_to_string (extractor, false), "A[A,B]");
+  EXPECT_EQ (extractor.nets_with_label ("B").size (), size_t (1));
+
+  extractor.set_tile_size (0);
+  extractor.extract (layout, top, data);
+  EXPECT_EQ (nets_to_string (extractor), "A[A,B]:5");
+
+  //  invalid indexes are reported as errors
+  bool error = false;
+  try {
+    extractor.net (1);
+  } catch (tl::Exception &) {
+    error = true;
+  }
+  EXPECT_EQ (error, true);
+
+  //  very small tile sizes are clamped
+  extractor.set_tile_size (1e-6);
+  extractor.extract (layout, top, data);
+  EXPECT_EQ (nets_to_string (extractor, false), "A[A,B]");
+
+  extractor.clear ();
+  EXPECT_EQ (extractor.size (), size_t (0));
+}
+
@@ -89,7 +89,7 @@ static ext::Net trace (ext::NetTracer &tracer, const db::Layout &layout, const d
   return ext::Net (tracer, db::ICplxTrans (), layout, cell.cell_index (), std::string (), std::string (), tracer_data);
 }
 
-void run_test (ut::TestBase *_this, const std::string &file, const ext::NetTracerTechnologyComponent &tc, const db::LayerProperties &lp_start, const db::Point &p_start, const std::string &file_au, const char *net_name = 0)
+void run_test (ut::TestBase *_this, const std::string &file, const ext::NetTracerTechnologyComponent &tc, const db::LayerProperties &lp_start, const db::Point &p_start, const std::string &file_au, const char *net_name = 0, bool use_index = false)
 {
   db::Manager m;
 
@@ -106,6 +106,7 @@ void run_test (ut::TestBase *_this, const std::string &file, const ext::NetTrace
   const db::Cell &cell = layout_org.cell (*layout_org.begin_top_down ());
 
   ext::NetTracer tracer;
+  tracer.set_use_index (use_index);
   ext::Net net = trace (tracer, layout_org, cell, tc, layer_for (layout_org, lp_start), p_start);
 
   if (net_name) {
@@ -123,7 +124,7 @@ void run_test (ut::TestBase *_this, const std::string &file, const ext::NetTrace
   _this->compare_layouts (layout_net, fn, ut::WriteOAS);
 }
 
-void run_test2 (ut::TestBase *_this, const std::string &file, const ext::NetTracerTechnologyComponent &tc, const db::LayerProperties &lp_start, const db::Point &p_start, const db::LayerProperties &lp_stop, const db::Point &p_stop, const std::string &file_au, const char *net_name = 0)
+void run_test2 (ut::TestBase *_this, const std::string &file, const ext::NetTracerTechnologyComponent &tc, const db::LayerProperties &lp_start, const db::Point &p_start, const db::LayerProperties &lp_stop, const db::Point &p_stop, const std::string &file_au, const char *net_name = 0, bool use_index = false)
 {
   db::Manager m;
 
@@ -140,6 +141,7 @@ void run_test2 (ut::TestBase *_this, const std::string &file, const ext::NetTrac
   const db::Cell &cell = layout_org.cell (*layout_org.begin_top_down ());
 
   ext::NetTracer tracer;
+  tracer.set_use_index (use_index);
   ext::Net net = trace (tracer, layout_org, cell, tc, layer_for (layout_org, lp_start), p_start, layer_for (layout_org, lp_stop), p_stop);
 
   if (net_name) {
@@ -375,3 +377,83 @@ TEST(9)
   run_test (_this, file, tc, db::LayerProperties (8, 0), db::Point (3000, 6800), file_au, "A");
 }
 
+//  same results with the connectivity index
+TEST(10)
+{
+  ext::NetTracerTechnologyComponent tc;
+  tc.add (connection ("1/0", "2/0", "3/0"));
+
+  run_test (_this, "t1.oas.gz", tc, db::LayerProperties (1, 0), db::Point (7000, 1500), "t1_net.oas.gz", "THE_NAME", true);
+  run_test (_this, "t1.oas.gz", tc, db::LayerProperties (1, 0), db::Point (7000, 15000), "t1b_net.oas.gz", 0, true);
+  run_test2 (_this, "t2.oas.gz", tc, db::LayerProperties (1, 0), db::Point (7000, 1500), db::LayerProperties (3, 0), db::Point (4000, -20000), "t2_net.oas.gz", "THE_NAME", true);
+
+  ext::NetTracerTechnologyComponent tc9;
+  tc9.add_symbol (symbol ("a", "8-12"));
+  tc9.add_symbol (symbol ("b", "a+7"));
+  tc9.add_symbol (symbol ("c", "15*26"));
+  tc9.add (connection ("b", "7"));
+  tc9.add (connection ("b", "c", "9"));
+
+  run_test (_this, "t9.oas.gz", tc9, db::LayerProperties (8, 0), db::Point (3000, 6800), "t9_net.oas.gz", "A", true);
+}
+
+//  the connectivity index is reused for subsequent traces and invalidated by layout changes
+TEST(11)
+{
+  db::Manager m;
+
+  db::Layout layout (&m);
+  {
+    std::string fn (ut::testsrc ());
+    fn += "/testdata/net_tracer/t1.oas.gz";
+    tl::InputStream stream (fn);
+    db::Reader reader (stream);
+    reader.read (layout);
+  }
+
+  const db::Cell &cell = layout.cell (*layout.begin_top_down ());
+
+  ext::NetTracerTechnologyComponent tc;
+  tc.add (connection ("1/0", "2/0", "3/0"));
+
+  ext::NetTracer tracer;
+  EXPECT_EQ (tracer.use_index (), true);
+  tracer.set_index_threads (2);
+
+  ext::NetTracer tracer_flat;
+  tracer_flat.set_use_index (false);
+
+  trace (tracer, layout, cell, tc, layer_for (layout, db::LayerProperties (1, 0)), db::Point (7000, 1500));
+  trace (tracer_flat, layout, cell, tc, layer_for (layout, db::LayerProperties (1, 0)), db::Point (7000, 1500));
+  EXPECT_EQ (tracer.index ().is_valid (), true);
+  EXPECT_EQ (tracer.size (), tracer_flat.size ());
+  EXPECT_EQ (tracer.name (), "THE_NAME");
+
+  size_t index_size = tracer.index ().size ();
+
+  trace (tracer, layout, cell, tc, layer_for (layout, db::LayerProperties (1, 0)), db::Point (7000, 15000));
+  EXPECT_EQ (tracer.index ().is_valid (), true);
+  EXPECT_EQ (tracer.index ().size (), index_size);
+  EXPECT_EQ (tracer.size (), size_t (0));
+
+  //  clearing the tracer keeps the index, but resets the net's name
+  tracer.clear ();
+  EXPECT_EQ (tracer.name (), "");
+  EXPECT_EQ (tracer.index ().is_valid (), true);
+
+  layout.cell (cell.cell_index ()).shapes ((unsigned int) layer_for (layout, db::LayerProperties (1, 0))).insert (db::Box (6900, 1500, 7100, 15000));
+  EXPECT_EQ (tracer.index ().is_valid (), false);
+
+  trace (tracer, layout, cell, tc, layer_for (layout, db::LayerProperties (1, 0)), db::Point (7000, 15000));
+  trace (tracer_flat, layout, cell, tc, layer_for (layout, db::LayerProperties (1, 0)), db::Point (7000, 15000));
+  EXPECT_EQ (tracer.index ().is_valid (), true);
+  EXPECT_EQ (tracer.index ().size (), index_size + 1);
+  EXPECT_EQ (tracer.size (), tracer_flat.size ());
+
+  //  the destruction of the layout invalidates the index
+  db::Layout *copy = new db::Layout (layout);
+  trace (tracer, *copy, copy->cell (cell.cell_index ()), tc, layer_for (*copy, db::LayerProperties (1, 0)), db::Point (7000, 15000));
+  EXPECT_EQ (tracer.index ().is_valid (), true);
+  delete copy;
+  EXPECT_EQ (tracer.index ().is_valid (), false);
+}
@@ -0,0 +1,173 @@
+
+/*
+
+  KLayout Layout Viewer
+  Copyright (C) 2006-2017 Matthias Koefferlein
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+
+#include "utHead.h"
+
+#include "extXOREngine.h"
+#include "dbRegion.h"
+
+/**
+ *  @brief Creates a test layout: a top cell with an array of a leaf cell and a single instance of a second cell
+ *
+ *  "eco_shape" adds a box to the second cell, "extra_inst" adds another instance of the leaf cell.
+ */
+static void make_layout (db::Layout &layout, bool eco_shape, bool extra_inst)
+{
+  unsigned int l1 = layout.insert_layer (db::LayerProperties (1, 0));
+  unsigned int l2 = layout.insert_layer (db::LayerProperties (2, 0));
+
+  db::Cell &top = layout.cell (layout.add_cell ("TOP"));
+  db::Cell &leaf = layout.cell (layout.add_cell ("LEAF"));
+  db::Cell &block = layout.cell (layout.add_cell ("BLOCK"));
+
+  leaf.shapes (l1).insert (db::Box (0, 0, 100, 100));
+  leaf.shapes (l2).insert (db::Box (0, 0, 500, 50));
+
+  block.shapes (l1).insert (db::Box (0, 0, 1000, 1000));
+  if (eco_shape) {
+    block.shapes (l1).insert (db::Box (1200, 200, 1300, 300));
+  }
+
+  top.insert (db::CellInstArray (db::CellInst (leaf.cell_index ()), db::Trans (), db::Vector (1000, 0), db::Vector (0, 1000), 10, 10));
+  top.insert (db::CellInstArray (db::CellInst (block.cell_index ()), db::Trans (db::Vector (20000, 0))));
+  if (extra_inst) {
+    top.insert (db::CellInstArray (db::CellInst (leaf.cell_index ()), db::Trans (db::Vector (50000, 50000))));
+  }
+}
+
+static db::Region xor_region (ext::XOREngine &engine, const db::Layout &a, const db::Layout &b, const db::LayerProperties &lp)
+{
+  db::Layout out;
+  db::cell_index_type out_cell = out.add_cell ("XOR");
+  engine.run (a, a.cell_by_name ("TOP").second, b, b.cell_by_name ("TOP").second, out, out_cell);
+
+  db::Region r;
+  for (db::Layout::layer_iterator l = out.begin_layers (); l != out.end_layers (); ++l) {
+    if ((*l).second->log_equal (lp)) {
+      for (db::ShapeIterator s = out.cell (out_cell).shapes ((*l).first).begin (db::ShapeIterator::All); ! s.at_end (); ++s) {
+        r.insert (*s);
+      }
+    }
+  }
+  return r;
+}
+
+static std::string zones_to_string (const ext::XOREngine &engine, unsigned int layer)
+{
+  std::string s;
+  const std::vector<db::Box> &zones = engine.zones (layer);
+  for (std::vector<db::Box>::const_iterator z = zones.begin (); z != zones.end (); ++z) {
+    if (! s.empty ()) {
+      s += ";";
+    }
+    s += z->to_string ();
+  }
+  return s;
+}
+
+TEST(1)
+{
+  //  identical layouts: no zones
+  db::Layout a, b;
+  make_layout (a, false, false);
+  make_layout (b, false, false);
+
+  ext::XOREngine engine;
+  engine.compute_zones (a, a.cell_by_name ("TOP").second, b, b.cell_by_name ("TOP").second);
+
+  EXPECT_EQ (engine.layers (), (unsigned int) 2);
+  EXPECT_EQ (engine.layer (0).to_string (), "1/0");
+  EXPECT_EQ (engine.layer (1).to_string (), "2/0");
+  EXPECT_EQ (zones_to_string (engine, 0), "");
+  EXPECT_EQ (zones_to_string (engine, 1), "");
+
+  EXPECT_EQ (xor_region (engine, a, b, db::LayerProperties (1, 0)).to_string (), "");
+}
+
+TEST(2)
+{
+  //  a shape added to a cell: the zone is confined to this shape
+  db::Layout a, b;
+  make_layout (a, false, false);
+  make_layout (b, true, false);
+
+  ext::XOREngine engine;
+  engine.compute_zones (a, a.cell_by_name ("TOP").second, b, b.cell_by_name ("TOP").second);
+
+  EXPECT_EQ (zones_to_string (engine, 0), "(21200,200;21300,300)");
+  EXPECT_EQ (zones_to_string (engine, 1), "");
+
+  db::Region r = xor_region (engine, a, b, db::LayerProperties (1, 0));
+  EXPECT_EQ (r.to_string (), "(21200,200;21200,300;21300,300;21300,200)");
+
+  //  the flat mode gives the same result
+  ext::XOREngine flat_engine;
+  flat_engine.set_hierarchical (false);
+  flat_engine.set_tile_size (7.0);
+  EXPECT_EQ ((xor_region (flat_engine, a, b, db::LayerProperties (1, 0)) ^ r).empty (), true);
+  EXPECT_EQ (xor_region (flat_engine, a, b, db::LayerProperties (2, 0)).empty (), true);
+}
+
+TEST(3)
+{
+  //  an instance added: the zones cover the instance on all layers
+  db::Layout a, b;
+  make_layout (a, false, false);
+  make_layout (b, false, true);
+
+  ext::XOREngine engine;
+  engine.set_threads (2);
+  engine.add_layer (db::LayerProperties (2, 0));
+  engine.compute_zones (a, a.cell_by_name ("TOP").second, b, b.cell_by_name ("TOP").second);
+
+  EXPECT_EQ (engine.layers (), (unsigned int) 1);
+  EXPECT_EQ (zones_to_string (engine, 0), "(50000,50000;50500,50050)");
+
+  db::Region r = xor_region (engine, a, b, db::LayerProperties (2, 0));
+  EXPECT_EQ (r.to_string (), "(50000,50000;50000,50050;50500,50050;50500,50000)");
+
+  //  B NOT A reports the instance too, A NOT B does not
+  engine.set_op (db::BooleanOp::ANotB);
+  EXPECT_EQ (xor_region (engine, a, b, db::LayerProperties (2, 0)).to_string (), "");
+  engine.set_op (db::BooleanOp::BNotA);
+  EXPECT_EQ (xor_region (engine, a, b, db::LayerProperties (2, 0)).to_string (), r.to_string ());
+}
+
+TEST(4)
+{
+  //  both changes and a tolerance: the narrow shape of the new instance on layer 2/0 is not reported
+  db::Layout a, b;
+  make_layout (a, false, false);
+  make_layout (b, true, true);
+
+  ext::XOREngine engine;
+  engine.compute_zones (a, a.cell_by_name ("TOP").second, b, b.cell_by_name ("TOP").second);
+
+  EXPECT_EQ (zones_to_string (engine, 0), "(21200,200;21300,300);(50000,50000;50100,50100)");
+  EXPECT_EQ (zones_to_string (engine, 1), "(50000,50000;50500,50050)");
+
+  engine.set_tolerance (0.08);
+  EXPECT_EQ (xor_region (engine, a, b, db::LayerProperties (1, 0)).to_string (), "(21200,200;21200,300;21300,300;21300,200);(50000,50000;50000,50100;50100,50100;50100,50000)");
+  EXPECT_EQ (xor_region (engine, a, b, db::LayerProperties (2, 0)).to_string (), "");
+}
+
@@ -203,3 +203,49 @@ TEST(2)
 
 }
 
+TEST(3) 
+{
+  lay::Bitmap b1 (40, 4, 1.0);
+  b1.fill (1, 0, 40);
+  b1.fill (2, 0, 40);
+
+  b1.clear (1, 3, 36);
+  b1.clear (2, 30, 34);
+  b1.clear (3, 0, 40);
+  EXPECT_EQ (to_string (b1), "----------------------------------------\n"
+                             "##############################----######\n"
+                             "###---------------------------------####\n"
+                             "----------------------------------------\n");
+
+  b1.clear (2, 0, 32);
+  EXPECT_EQ (to_string (b1), "----------------------------------------\n"
+                             "----------------------------------######\n"
+                             "###---------------------------------####\n"
+                             "----------------------------------------\n");
+}
+
+
+TEST(4) 
+{
+  lay::Bitmap b2 (70, 3, 1.0);
+  b2.fill (0, 0, 70);
+  b2.fill (1, 0, 70);
+  b2.fill (2, 0, 70);
+
+  lay::Bitmap b1 (70, 3, 1.0);
+  b1.merge (&b2, 2, 1, 5, 2);
+  EXPECT_EQ (to_string (b1), "----------------------------------------------------------------------\n"
+                             "--###-----------------------------------------------------------------\n"
+                             "----------------------------------------------------------------------\n");
+
+  b1.merge (&b2, 30, 0, 66, 1);
+  EXPECT_EQ (to_string (b1), "----------------------------------------------------------------------\n"
+                             "--###-----------------------------------------------------------------\n"
+                             "------------------------------####################################----\n");
+
+  //  clipped at the bitmap's boundaries
+  b1.merge (&b2, 64, 2, 100, 10);
+  EXPECT_EQ (to_string (b1), "----------------------------------------------------------------######\n"
+                             "--###-----------------------------------------------------------------\n"
+                             "------------------------------####################################----\n");
+}
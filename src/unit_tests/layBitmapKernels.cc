@@ -0,0 +1,307 @@
+
+/*
+
+  KLayout Layout Viewer
+  Copyright (C) 2006-2017 Matthias Koefferlein
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+
+
+
+#include "layBitmapKernels.h"
+#include "layBitmap.h"
+#include "tlTimer.h"
+#include "utHead.h"
+
+#include <vector>
+#include <stdlib.h>
+
+static uint32_t 
+rnd32 ()
+{
+  return (uint32_t (rand () & 0xffff) << 16) ^ uint32_t (rand () & 0xffff);
+}
+
+static std::vector<uint32_t> 
+random_words (unsigned int n)
+{
+  std::vector<uint32_t> v;
+  v.reserve (n);
+  for (unsigned int i = 0; i < n; ++i) {
+    v.push_back (rnd32 ());
+  }
+  return v;
+}
+
+static std::vector<uint32_t> 
+bitmap_words (const lay::Bitmap &bm)
+{
+  std::vector<uint32_t> v;
+  for (unsigned int i = 0; i < bm.height (); ++i) {
+    if (! bm.is_scanline_empty (i)) {
+      const uint32_t *sl = bm.scanline (i);
+      v.insert (v.end (), sl, sl + (bm.width () + 31) / 32);
+    } else {
+      v.insert (v.end (), size_t ((bm.width () + 31) / 32), uint32_t (0));
+    }
+  }
+  return v;
+}
+
+//  restores the best kernel set when the test is left
+struct KernelSetRestore
+{
+  ~KernelSetRestore ()
+  {
+    lay::set_bitmap_kernel_set (lay::best_bitmap_kernel_set ());
+  }
+};
+
+//  All kernel sets deliver the same results as the scalar implementation
+TEST(1) 
+{
+  KernelSetRestore ksr;
+  srand (1);
+
+  for (int iks = int (lay::BKS_Scalar); iks <= int (lay::best_bitmap_kernel_set ()); ++iks) {
+
+    lay::BitmapKernelSet ks = lay::BitmapKernelSet (iks);
+
+    for (unsigned int n = 0; n < 70; ++n) {
+
+      std::vector<uint32_t> from = random_words (n + 1);
+      std::vector<uint32_t> to = random_words (n + 1);
+
+      //  bitmap_or
+      std::vector<uint32_t> r1 (to), r2 (to);
+      lay::set_bitmap_kernel_set (lay::BKS_Scalar);
+      lay::bitmap_or (&r1[0], &from[0], n);
+      lay::set_bitmap_kernel_set (ks);
+      lay::bitmap_or (&r2[0], &from[0], n);
+      EXPECT_EQ (r1 == r2, true);
+
+      //  bitmap_or_shifted
+      for (unsigned int s = 1; s < 32; s += 5) {
+        std::vector<uint32_t> r1 (to), r2 (to);
+        lay::set_bitmap_kernel_set (lay::BKS_Scalar);
+        lay::bitmap_or_shifted (&r1[0], &from[0], n, s);
+        lay::set_bitmap_kernel_set (ks);
+        lay::bitmap_or_shifted (&r2[0], &from[0], n, s);
+        EXPECT_EQ (r1 == r2, true);
+      }
+
+      //  bitmap_and_pattern
+      for (unsigned int stride = 1; stride <= 8; ++stride) {
+        std::vector<uint32_t> pattern = random_words (stride);
+        std::vector<uint32_t> r1 (to), r2 (to);
+        lay::set_bitmap_kernel_set (lay::BKS_Scalar);
+        lay::bitmap_and_pattern (&r1[0], &from[0], &pattern[0], stride, n);
+        lay::set_bitmap_kernel_set (ks);
+        lay::bitmap_and_pattern (&r2[0], &from[0], &pattern[0], stride, n);
+        EXPECT_EQ (r1 == r2, true);
+      }
+
+    }
+
+    //  bitmap_expand_colors
+    for (unsigned int i = 0; i < 100; ++i) {
+
+      std::vector<uint32_t> y = random_words (32), z = random_words (32);
+      uint32_t bits = rnd32 ();
+      if (i % 4 == 1) {
+        bits &= 0xf0f000ff;
+      } else if (i % 4 == 2) {
+        bits = ~uint32_t (0);
+      } else if (i % 4 == 3) {
+        bits = 0;
+      }
+      lay::color_t ormask = rnd32 (), andmask = rnd32 ();
+
+      std::vector<uint32_t> y1 (y), z1 (z), y2 (y), z2 (z);
+      lay::set_bitmap_kernel_set (lay::BKS_Scalar);
+      lay::bitmap_expand_colors (&y1[0], &z1[0], bits, ormask, andmask);
+      lay::set_bitmap_kernel_set (ks);
+      lay::bitmap_expand_colors (&y2[0], &z2[0], bits, ormask, andmask);
+      EXPECT_EQ (y1 == y2, true);
+      EXPECT_EQ (z1 == z2, true);
+
+    }
+
+  }
+}
+
+//  Bitmap::merge delivers the same results with all kernel sets
+TEST(2) 
+{
+  KernelSetRestore ksr;
+  srand (2);
+
+  lay::Bitmap from (301, 40, 1.0);
+  for (unsigned int i = 0; i < 200; ++i) {
+    unsigned int y = rand () % 40, x1 = rand () % 301, x2 = rand () % 301;
+    from.fill (y, std::min (x1, x2), std::max (x1, x2) + 1);
+  }
+
+  int dxs[] = { -97, -64, -33, -5, 0, 1, 17, 32, 63, 130 };
+  int dys[] = { -7, 0, 3 };
+
+  for (unsigned int i = 0; i < sizeof (dxs) / sizeof (dxs[0]); ++i) {
+    for (unsigned int j = 0; j < sizeof (dys) / sizeof (dys[0]); ++j) {
+
+      lay::Bitmap to1 (290, 45, 1.0), to2 (290, 45, 1.0);
+      to1.fill (10, 5, 100);
+      to2.fill (10, 5, 100);
+
+      lay::set_bitmap_kernel_set (lay::BKS_Scalar);
+      to1.merge (&from, dxs[i], dys[j]);
+      lay::set_bitmap_kernel_set (lay::best_bitmap_kernel_set ());
+      to2.merge (&from, dxs[i], dys[j]);
+
+      EXPECT_EQ (bitmap_words (to1) == bitmap_words (to2), true);
+
+    }
+  }
+}
+
+//  All kernel sets deliver the same results as the scalar implementation on odd widths and unaligned buffers
+TEST(3) 
+{
+  KernelSetRestore ksr;
+  srand (3);
+
+  //  the buffers carry guard words before and after the operation's range which must not be touched
+  const unsigned int guard = 4;
+
+  for (int iks = int (lay::BKS_Scalar); iks <= int (lay::best_bitmap_kernel_set ()); ++iks) {
+
+    lay::BitmapKernelSet ks = lay::BitmapKernelSet (iks);
+
+    for (unsigned int n = 1; n < 70; n += 2) {
+
+      std::vector<uint32_t> from = random_words (n + 1 + 2 * guard);
+      std::vector<uint32_t> to = random_words (n + 1 + 2 * guard);
+
+      for (unsigned int oto = 0; oto < guard; ++oto) {
+        for (unsigned int ofrom = 0; ofrom < guard; ++ofrom) {
+
+          //  bitmap_or
+          std::vector<uint32_t> r1 (to), r2 (to);
+          lay::set_bitmap_kernel_set (lay::BKS_Scalar);
+          lay::bitmap_or (&r1[oto], &from[ofrom], n);
+          lay::set_bitmap_kernel_set (ks);
+          lay::bitmap_or (&r2[oto], &from[ofrom], n);
+          EXPECT_EQ (r1 == r2, true);
+
+          //  bitmap_or_shifted
+          for (unsigned int s = 1; s < 32; s += 3) {
+            std::vector<uint32_t> r1 (to), r2 (to);
+            lay::set_bitmap_kernel_set (lay::BKS_Scalar);
+            lay::bitmap_or_shifted (&r1[oto], &from[ofrom], n, s);
+            lay::set_bitmap_kernel_set (ks);
+            lay::bitmap_or_shifted (&r2[oto], &from[ofrom], n, s);
+            EXPECT_EQ (r1 == r2, true);
+          }
+
+          //  bitmap_and_pattern
+          for (unsigned int stride = 1; stride <= 5; stride += 2) {
+            std::vector<uint32_t> pattern = random_words (stride);
+            std::vector<uint32_t> r1 (to), r2 (to);
+            lay::set_bitmap_kernel_set (lay::BKS_Scalar);
+            lay::bitmap_and_pattern (&r1[oto], &from[ofrom], &pattern[0], stride, n);
+            lay::set_bitmap_kernel_set (ks);
+            lay::bitmap_and_pattern (&r2[oto], &from[ofrom], &pattern[0], stride, n);
+            EXPECT_EQ (r1 == r2, true);
+          }
+
+        }
+      }
+
+    }
+
+    //  bitmap_expand_colors on unaligned color buffers
+    for (unsigned int offset = 0; offset < guard; ++offset) {
+
+      std::vector<uint32_t> y = random_words (32 + guard), z = random_words (32 + guard);
+      uint32_t bits = rnd32 ();
+      lay::color_t ormask = rnd32 (), andmask = rnd32 ();
+
+      std::vector<uint32_t> y1 (y), z1 (z), y2 (y), z2 (z);
+      lay::set_bitmap_kernel_set (lay::BKS_Scalar);
+      lay::bitmap_expand_colors (&y1[offset], &z1[offset], bits, ormask, andmask);
+      lay::set_bitmap_kernel_set (ks);
+      lay::bitmap_expand_colors (&y2[offset], &z2[offset], bits, ormask, andmask);
+      EXPECT_EQ (y1 == y2, true);
+      EXPECT_EQ (z1 == z2, true);
+
+    }
+
+  }
+}
+
+//  Micro-benchmark of the kernels
+TEST(4) 
+{
+  KernelSetRestore ksr;
+  srand (3);
+
+  const unsigned int n = 64;  //  2048 pixels per scanline
+  const unsigned int rep = 200000;
+
+  std::vector<uint32_t> from = random_words (n + 1);
+  std::vector<uint32_t> pattern = random_words (4);
+  std::vector<uint32_t> y = random_words (32), z = random_words (32);
+
+  for (int iks = int (lay::BKS_Scalar); iks <= int (lay::best_bitmap_kernel_set ()); ++iks) {
+
+    lay::BitmapKernelSet ks = lay::BitmapKernelSet (iks);
+    lay::set_bitmap_kernel_set (ks);
+    EXPECT_EQ (lay::bitmap_kernel_set () == ks, true);
+
+    std::vector<uint32_t> to (n + 1, 0);
+
+    {
+      tl::SelfTimer timer (std::string ("bitmap_or (") + lay::bitmap_kernel_set_name (ks) + ")");
+      for (unsigned int i = 0; i < rep; ++i) {
+        lay::bitmap_or (&to[0], &from[0], n);
+      }
+    }
+
+    {
+      tl::SelfTimer timer (std::string ("bitmap_or_shifted (") + lay::bitmap_kernel_set_name (ks) + ")");
+      for (unsigned int i = 0; i < rep; ++i) {
+        lay::bitmap_or_shifted (&to[0], &from[0], n, 1 + i % 31);
+      }
+    }
+
+    {
+      tl::SelfTimer timer (std::string ("bitmap_and_pattern (") + lay::bitmap_kernel_set_name (ks) + ")");
+      for (unsigned int i = 0; i < rep; ++i) {
+        lay::bitmap_and_pattern (&to[0], &from[0], &pattern[0], 4, n);
+      }
+    }
+
+    {
+      tl::SelfTimer timer (std::string ("bitmap_expand_colors (") + lay::bitmap_kernel_set_name (ks) + ")");
+      for (unsigned int i = 0; i < rep; ++i) {
+        lay::bitmap_expand_colors (&y[0], &z[0], from[i % n], pattern[0], pattern[1]);
+      }
+    }
+
+  }
+}
+
@@ -0,0 +1,208 @@
+
+/*
+
+  KLayout Layout Viewer
+  Copyright (C) 2006-2017 Matthias Koefferlein
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+
+
+
+#include "layCellLODCache.h"
+#include "layBitmap.h"
+#include "dbLayout.h"
+#include "utHead.h"
+
+static std::string 
+to_string (const lay::Bitmap &bm)
+{
+  std::string r;
+
+  for (unsigned int j = bm.height (); j > 0; --j) {
+    std::string s;
+    for (unsigned int k = 0; k < bm.width (); ++k) {
+      s += (! bm.is_scanline_empty (j - 1) && (bm.scanline (j - 1)[k / 32] & (1 << (k % 32))) != 0) ? "#" : "-";
+    }
+    r += s;
+    r += "\n";
+  }
+
+  return r;
+}
+
+static std::string 
+lod_to_string (const lay::CellLOD *lod, const db::CplxTrans &trans, unsigned int w, unsigned int h)
+{
+  if (! lod) {
+    return "(null)";
+  }
+
+  lay::Bitmap fill (w, h, 1.0);
+  lod->blit (trans, &fill, 0, 0);
+  return to_string (fill);
+}
+
+static void 
+make_layout (db::Layout &ly, unsigned int &l1, db::cell_index_type &a, db::cell_index_type &top)
+{
+  l1 = ly.insert_layer (db::LayerProperties (1, 0));
+
+  a = ly.add_cell ("A");
+  ly.cell (a).shapes (l1).insert (db::Box (0, 0, 1000, 1000));
+
+  top = ly.add_cell ("TOP");
+  ly.cell (top).insert (db::CellInstArray (db::CellInst (a), db::Trans (db::Vector (0, 0))));
+  ly.cell (top).insert (db::CellInstArray (db::CellInst (a), db::Trans (db::Vector (3000, 1000))));
+
+  ly.update ();
+}
+
+//  Basic rasters and pyramid levels
+TEST(1) 
+{
+  db::Layout ly;
+  unsigned int l1;
+  db::cell_index_type a, top;
+  make_layout (ly, l1, a, top);
+
+  lay::CellLODCache cache (&ly);
+  EXPECT_EQ (cache.is_valid (), false);
+  EXPECT_EQ (cache.lod (a, l1) == 0, true);
+
+  cache.start_build ();
+  EXPECT_EQ (cache.is_valid (), true);
+
+  const lay::CellLOD *lod = cache.lod (a, l1);
+  EXPECT_EQ (lod != 0, true);
+  EXPECT_EQ (lod->bbox ().to_string (), "(0,0;1000,1000)");
+  EXPECT_EQ (lod->width (0), 32u);
+  EXPECT_EQ (lod->height (0), 32u);
+  EXPECT_EQ (lod->levels (), 6u);
+  EXPECT_EQ (lod->width (5), 1u);
+  EXPECT_EQ (lod->row (lay::CellLOD::Frame, 0, 0), 0xffffffffu);
+  EXPECT_EQ (lod->row (lay::CellLOD::Frame, 0, 1), 0x80000001u);
+  EXPECT_EQ (lod->row (lay::CellLOD::Fill, 3, 2), 0xfu);
+  EXPECT_EQ (lod->row (lay::CellLOD::Frame, 5, 0), 1u);
+
+  //  the same object is delivered again
+  EXPECT_EQ (cache.lod (a, l1) == lod, true);
+
+  EXPECT_EQ (lod_to_string (lod, db::CplxTrans (0.004, 0.0, false, db::DVector (1, 2)), 8, 8),
+    "--------\n"
+    "-#####--\n"
+    "-#####--\n"
+    "-#####--\n"
+    "-#####--\n"
+    "-#####--\n"
+    "--------\n"
+    "--------\n"
+  );
+
+  //  a footprint without a pixel center gives a dot on the frame plane
+  lay::Bitmap fill (4, 4, 1.0), frame (4, 4, 1.0);
+  lod->blit (db::CplxTrans (0.0002, 0.0, false, db::DVector (1.2, 2.2)), &fill, &frame, 0);
+  EXPECT_EQ (to_string (fill), "----\n----\n----\n----\n");
+  EXPECT_EQ (to_string (frame), "----\n-#--\n----\n----\n");
+
+  //  the top cell's raster is composed of the child cell's rasters
+  const lay::CellLOD *top_lod = cache.lod (top, l1);
+  EXPECT_EQ (top_lod != 0, true);
+  EXPECT_EQ (top_lod->bbox ().to_string (), "(0,0;4000,2000)");
+  EXPECT_EQ (lod_to_string (top_lod, db::CplxTrans (0.002), 9, 5),
+    "------###\n"
+    "------###\n"
+    "###---###\n"
+    "###------\n"
+    "###------\n"
+  );
+
+  //  rotated
+  EXPECT_EQ (lod_to_string (top_lod, db::CplxTrans (0.002, 90.0, false, db::DVector (4, 0)), 5, 9),
+    "###--\n"
+    "###--\n"
+    "###--\n"
+    "-----\n"
+    "-----\n"
+    "-----\n"
+    "--###\n"
+    "--###\n"
+    "--###\n"
+  );
+
+  cache.stop_build ();
+}
+
+//  Invalidation on layout changes
+TEST(2) 
+{
+  db::Layout ly;
+  unsigned int l1;
+  db::cell_index_type a, top;
+  make_layout (ly, l1, a, top);
+
+  lay::CellLODCache cache (&ly);
+  cache.start_build ();
+  EXPECT_EQ (cache.lod (a, l1) != 0, true);
+
+  ly.cell (a).shapes (l1).insert (db::Box (0, 0, 2000, 500));
+  EXPECT_EQ (cache.is_valid (), false);
+  EXPECT_EQ (cache.lod (a, l1) == 0, true);
+
+  //  not updated yet: the cache stays invalid
+  cache.start_build ();
+  EXPECT_EQ (cache.is_valid (), false);
+
+  ly.update ();
+  cache.start_build ();
+  EXPECT_EQ (cache.is_valid (), true);
+
+  const lay::CellLOD *lod = cache.lod (a, l1);
+  EXPECT_EQ (lod != 0, true);
+  EXPECT_EQ (lod->bbox ().to_string (), "(0,0;2000,1000)");
+  EXPECT_EQ (lod->width (0), 32u);
+  EXPECT_EQ (lod->height (0), 17u);
+
+  //  hierarchy changes invalidate the cache too
+  ly.cell (top).insert (db::CellInstArray (db::CellInst (a), db::Trans (db::Vector (-5000, 0))));
+  EXPECT_EQ (cache.is_valid (), false);
+  ly.update ();
+  cache.start_build ();
+  EXPECT_EQ (cache.lod (top, l1)->bbox ().to_string (), "(-5000,0;5000,2000)");
+
+  cache.stop_build ();
+}
+
+//  Memory limit
+TEST(3) 
+{
+  db::Layout ly;
+  unsigned int l1;
+  db::cell_index_type a, top;
+  make_layout (ly, l1, a, top);
+
+  lay::CellLODCache cache (&ly);
+  cache.set_memory_limit (0);
+  cache.start_build ();
+  cache.stop_build ();
+
+  //  the first raster is built, but no more
+  EXPECT_EQ (cache.lod (a, l1) != 0, true);
+  EXPECT_EQ (cache.memory () > 0, true);
+  EXPECT_EQ (cache.lod (top, l1) == 0, true);
+}
+
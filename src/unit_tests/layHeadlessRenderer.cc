@@ -0,0 +1,215 @@
+
+/*
+
+  KLayout Layout Viewer
+  Copyright (C) 2006-2017 Matthias Koefferlein
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+
+#include "layHeadlessRenderer.h"
+#include "layLayerProperties.h"
+#include "tlPixelBuffer.h"
+#include "tlStream.h"
+#include "dbLayout.h"
+#include "utHead.h"
+
+static const tl::color_t bg = 0xff000000;
+
+static void
+make_props (lay::LayerPropertiesList &props, const char *source, lay::color_t fill, lay::color_t frame)
+{
+  lay::LayerPropertiesNode p;
+  p.set_source (source);
+  p.set_fill_color (fill);
+  p.set_frame_color (frame);
+  p.set_dither_pattern (0);
+  p.set_width (1);
+  props.push_back (p);
+}
+
+//  finds the first pixel in the given row which is not background
+static int
+first_pixel (const tl::PixelBuffer &img, unsigned int y)
+{
+  for (unsigned int x = 0; x < img.width (); ++x) {
+    if (img.pixel (x, y) != bg) {
+      return int (x);
+    }
+  }
+  return -1;
+}
+
+TEST(1)
+{
+  db::Manager m;
+  db::Layout layout (&m);
+  layout.dbu (0.001);
+
+  unsigned int l1 = layout.insert_layer (db::LayerProperties (1, 0));
+  unsigned int l2 = layout.insert_layer (db::LayerProperties (2, 0));
+  db::cell_index_type top = layout.add_cell ("TOP");
+  layout.cell (top).shapes (l1).insert (db::Box (0, 0, 1000, 1000));
+  layout.cell (top).shapes (l2).insert (db::Box (2000, 0, 3000, 1000));
+
+  lay::HeadlessRenderer renderer (layout, top);
+  renderer.set_background_color (bg);
+
+  lay::LayerPropertiesList props;
+  make_props (props, "1/0", 0xff0000, 0x00ff00);
+  renderer.set_layer_properties (props);
+  renderer.prepare ();
+
+  //  30x30 pixels for 3x3 um: the square covers x and y from 10 to 20
+  tl::PixelBuffer img (30, 30);
+  renderer.render (db::DBox (-1.0, -1.0, 2.0, 2.0), img);
+
+  EXPECT_EQ (tl::to_string (img.pixel (15, 15) & 0xffffff), "16711680");
+  EXPECT_EQ (img.pixel (2, 2), bg);
+  EXPECT_EQ (img.pixel (27, 15), bg);
+
+  int x = first_pixel (img, 15);
+  EXPECT_EQ (x >= 9 && x <= 11, true);
+  EXPECT_EQ (tl::to_string (img.pixel (x, 15) & 0xffffff), "65280");
+
+  //  layer 2/0 is not listed, hence not drawn
+  tl::PixelBuffer img2 (30, 30);
+  renderer.render (db::DBox (1.5, -1.0, 4.5, 2.0), img2);
+  EXPECT_EQ (first_pixel (img2, 15), -1);
+
+  //  default layer properties: both layers are drawn
+  renderer.set_default_layer_properties ();
+  renderer.prepare ();
+
+  tl::PixelBuffer img3 (40, 30);
+  renderer.render (db::DBox (-0.5, -1.0, 3.5, 2.0), img3);
+  EXPECT_EQ (first_pixel (img3, 15), 5);
+  EXPECT_EQ (img3.pixel (20, 15), bg);
+  EXPECT_EQ (img3.pixel (25, 15) != bg, true);
+}
+
+TEST(2)
+{
+  //  a hierarchical layout with an array of small cells
+  db::Manager m;
+  db::Layout layout (&m);
+  layout.dbu (0.001);
+
+  unsigned int l1 = layout.insert_layer (db::LayerProperties (1, 0));
+  db::cell_index_type top = layout.add_cell ("TOP");
+  db::cell_index_type a = layout.add_cell ("A");
+  db::cell_index_type b = layout.add_cell ("B");
+
+  layout.cell (b).shapes (l1).insert (db::Box (0, 0, 100, 100));
+  layout.cell (b).shapes (l1).insert (db::Box (200, 0, 300, 300));
+  layout.cell (a).insert (db::CellInstArray (db::CellInst (b), db::Trans (), db::Vector (400, 0), db::Vector (0, 400), 5, 5));
+  layout.cell (top).insert (db::CellInstArray (db::CellInst (a), db::Trans (), db::Vector (3000, 0), db::Vector (0, 3000), 10, 10));
+
+  lay::LayerPropertiesList props;
+  make_props (props, "1/0", 0x8080ff, 0xffffff);
+
+  //  render the snapshots in parallel
+  std::vector<lay::HeadlessSnapshot> snapshots;
+  for (unsigned int i = 0; i < 8; ++i) {
+    double d = i * 0.7;
+    snapshots.push_back (lay::HeadlessSnapshot (db::DBox (d, d, d + 30.0 - i * 3.0, d + 30.0 - i * 3.0), 200, 150, _this->tmp_file ("snapshot" + tl::to_string (i) + ".png")));
+  }
+
+  lay::HeadlessRenderer renderer (layout, top);
+  renderer.set_background_color (bg);
+  renderer.set_layer_properties (props);
+  renderer.set_threads (4);
+  renderer.render_all (snapshots);
+
+  renderer.set_threads (0);
+  renderer.prepare ();
+
+  for (std::vector<lay::HeadlessSnapshot>::const_iterator s = snapshots.begin (); s != snapshots.end (); ++s) {
+
+    tl::PixelBuffer img (s->width, s->height);
+    renderer.render (s->box, img);
+
+    tl::OutputMemoryStream mem;
+    {
+      tl::OutputStream os (mem);
+      img.write_png (os);
+    }
+
+    //  the files are identical to the ones rendered in parallel
+    tl::InputStream is (s->path);
+    std::string data = is.read_all ();
+    EXPECT_EQ (data == std::string (mem.data (), mem.size ()), true);
+
+    bool any = false;
+    for (unsigned int y = 0; y < img.height () && ! any; ++y) {
+      any = (first_pixel (img, y) >= 0);
+    }
+    EXPECT_EQ (any, true);
+
+  }
+}
+
+
+TEST(3)
+{
+  //  texts inside cells which are too small to be drawn in detail
+  db::Manager m;
+  db::Layout layout (&m);
+  layout.dbu (0.001);
+
+  unsigned int l1 = layout.insert_layer (db::LayerProperties (1, 0));
+  db::cell_index_type top = layout.add_cell ("TOP");
+  db::cell_index_type a = layout.add_cell ("A");
+
+  layout.cell (a).shapes (l1).insert (db::Box (0, 0, 10, 10));
+  layout.cell (a).shapes (l1).insert (db::Text ("X", db::Trans (db::Vector (5, 5))));
+  layout.cell (top).insert (db::CellInstArray (db::CellInst (a), db::Trans (db::Vector (5000, 5000))));
+
+  lay::LayerPropertiesList props;
+  make_props (props, "1/0", 0x8080ff, 0xffffff);
+
+  lay::HeadlessRenderer renderer (layout, top);
+  renderer.set_background_color (bg);
+  renderer.set_layer_properties (props);
+
+  //  100x100 pixels for 20x20 um: cell A is much smaller than a pixel
+  renderer.set_text_visible (false);
+  renderer.prepare ();
+  tl::PixelBuffer img1 (100, 100);
+  renderer.render (db::DBox (-5.0, -5.0, 15.0, 15.0), img1);
+
+  renderer.set_text_visible (true);
+  renderer.prepare ();
+  tl::PixelBuffer img2 (100, 100);
+  renderer.render (db::DBox (-5.0, -5.0, 15.0, 15.0), img2);
+
+  size_t n1 = 0, n2 = 0;
+  for (unsigned int y = 0; y < 100; ++y) {
+    for (unsigned int x = 0; x < 100; ++x) {
+      if (img1.pixel (x, y) != bg) {
+        ++n1;
+      }
+      if (img2.pixel (x, y) != bg) {
+        ++n2;
+      }
+    }
+  }
+
+  //  the text adds pixels
+  EXPECT_EQ (n1 > 0, true);
+  EXPECT_EQ (n2 > n1, true);
+}
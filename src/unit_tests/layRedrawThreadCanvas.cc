@@ -0,0 +1,129 @@
+
+/*
+
+  KLayout Layout Viewer
+  Copyright (C) 2006-2017 Matthias Koefferlein
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+
+#include "layRedrawThreadCanvas.h"
+#include "layBitmapRenderer.h"
+#include "layBitmap.h"
+#include "layDrawing.h"
+#include "dbPolygon.h"
+#include "utHead.h"
+
+#include <stdlib.h>
+
+namespace
+{
+
+class NoDrawings
+  : public lay::Drawings
+{
+public:
+  void update_drawings () { }
+};
+
+}
+
+static std::string 
+to_string (const lay::Bitmap &bm)
+{
+  std::string r;
+
+  for (unsigned int j = bm.height (); j > 0; --j) {
+    std::string s;
+    for (unsigned int k = 0; k < bm.width (); ++k) {
+      s += (bm.scanline (j - 1)[k / 32] & (1 << (k % 32))) != 0 ? "#" : "-";
+    }
+    r += s;
+    r += "\n";
+  }
+
+  return r;
+}
+
+//  draws the polygons touching the region (in pixel units) like the redraw thread worker does
+static void 
+draw (const std::vector<db::Polygon> &polygons, const db::CplxTrans &trans, const db::Box &region, lay::Bitmap &fill, lay::Bitmap &frame)
+{
+  lay::BitmapRenderer renderer (fill.width (), fill.height (), 1.0);
+  for (std::vector<db::Polygon>::const_iterator p = polygons.begin (); p != polygons.end (); ++p) {
+    if ((trans * p->box ()).touches (db::DBox (region))) {
+      renderer.draw (*p, trans, &fill, &frame, 0, 0);
+    }
+  }
+}
+
+//  tiled drawing gives the same result than untiled drawing
+TEST(1)
+{
+  const unsigned int w = 203, h = 117;
+  db::CplxTrans trans (0.01);
+
+  std::vector<db::Polygon> polygons;
+  srand (17);
+  for (unsigned int i = 0; i < 200; ++i) {
+
+    db::Coord x = rand () % (w * 100), y = rand () % (h * 100);
+    db::Coord dx = rand () % 2500 + 10, dy = rand () % 2500 + 10;
+
+    if (i % 2 == 0) {
+      polygons.push_back (db::Polygon (db::Box (x, y, x + dx, y + dy)));
+    } else {
+      db::Point pts[] = { db::Point (x, y), db::Point (x + dx, y + dy / 3), db::Point (x + dx / 2, y + dy) };
+      db::Polygon poly;
+      poly.assign_hull (pts, pts + sizeof (pts) / sizeof (pts [0]));
+      polygons.push_back (poly);
+    }
+
+  }
+
+  db::Box canvas_box (0, 0, w, h);
+
+  lay::Bitmap fill (w, h, 1.0), frame (w, h, 1.0);
+  draw (polygons, trans, canvas_box, fill, frame);
+  EXPECT_EQ (fill.empty (), false);
+
+  NoDrawings drawings;
+  lay::BitmapRedrawThreadCanvas canvas;
+  canvas.prepare (2, w, h, 1.0, 0, 0, 0, &drawings);
+
+  const unsigned int nx = 3, ny = 4;
+  for (unsigned int ix = 0; ix < nx; ++ix) {
+    for (unsigned int iy = 0; iy < ny; ++iy) {
+
+      db::Box tile ((w * ix) / nx, (h * iy) / ny, (w * (ix + 1)) / nx, (h * (iy + 1)) / ny);
+
+      lay::Bitmap tile_fill (w, h, 1.0), tile_frame (w, h, 1.0);
+      draw (polygons, trans, tile.enlarged (db::Vector (2, 2)) & canvas_box, tile_fill, tile_frame);
+
+      canvas.merge_plane (0, &tile_fill, tile.enlarged (db::Vector (1, 1)));
+      canvas.merge_plane (1, &tile_frame, tile.enlarged (db::Vector (1, 1)));
+
+    }
+  }
+
+  lay::Bitmap tiled_fill (w, h, 1.0), tiled_frame (w, h, 1.0);
+  canvas.initialize_plane (&tiled_fill, 0);
+  canvas.initialize_plane (&tiled_frame, 1);
+
+  EXPECT_EQ (to_string (tiled_fill), to_string (fill));
+  EXPECT_EQ (to_string (tiled_frame), to_string (frame));
+}
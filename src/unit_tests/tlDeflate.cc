@@ -23,9 +23,11 @@
 
 #include "tlStream.h"
 #include "tlDeflate.h"
+#include "tlTimer.h"
+#include "tlLog.h"
 #include "utHead.h"
 
-#include "zlib.h"
+#include <algorithm>
 
 TEST(1) 
 {
@@ -118,3 +120,528 @@ TEST(3)
   delete[] hello;
 }
 
+
+static std::string test_text (size_t n)
+{
+  static const char *words[] = { "CELL", "BOX", "POLYGON", "PATH", "TEXT", "LAYER", "DATATYPE", " ", " ", "\n", "0", "1", "42", "1000", "-250" };
+
+  std::string s;
+  s.reserve (n);
+  size_t r = 1;
+  while (s.size () < n) {
+    r *= 12361;
+    r ^= (r >> 8);
+    s += words [r % (sizeof (words) / sizeof (words [0]))];
+  }
+  s.resize (n);
+  return s;
+}
+
+static std::string deflate_string (const std::string &s, int level = -1)
+{
+  tl::OutputStringStream oss;
+  tl::OutputStream os (oss);
+  tl::DeflateFilter fg (os, level);
+  fg.put (s.c_str (), s.size ());
+  fg.flush ();
+  return oss.string ();
+}
+
+static std::string read_string (tl::InputStream &is, size_t n)
+{
+  std::string out;
+  while (out.size () < n) {
+    size_t chunk = std::min (n - out.size (), size_t (4096));
+    const char *b = is.get (chunk);
+    if (! b) {
+      break;
+    }
+    out.append (b, chunk);
+  }
+  return out;
+}
+
+static std::string inflate_string (tl::InputStream &is, size_t n)
+{
+  std::string out;
+  out.reserve (n);
+  tl::InflateFilter f (is);
+  while (out.size () < n) {
+    size_t chunk = std::min (n - out.size (), size_t (4096));
+    out.append (f.get (chunk), chunk);
+  }
+  EXPECT_EQ (f.at_end (), true);
+  return out;
+}
+
+//  Compression levels
+TEST(4)
+{
+  std::string text = test_text (200000);
+
+  std::string d0 = deflate_string (text, 0);
+  std::string d1 = deflate_string (text, 1);
+  std::string d9 = deflate_string (text, 9);
+
+  EXPECT_EQ (d0.size () > text.size (), true);
+  EXPECT_EQ (d1.size () < text.size () / 2, true);
+  EXPECT_EQ (d9.size () <= d1.size (), true);
+
+  const std::string *dd[] = { &d0, &d1, &d9 };
+  for (size_t i = 0; i < sizeof (dd) / sizeof (dd [0]); ++i) {
+    tl::InputMemoryStream ims (dd [i]->c_str (), dd [i]->size ());
+    tl::InputStream is (ims);
+    EXPECT_EQ (inflate_string (is, text.size ()) == text, true);
+  }
+}
+
+//  The raw stream continues right after the deflated data
+TEST(5)
+{
+  std::string text = test_text (100000);
+  std::string data = deflate_string (text) + "REST";
+
+  //  memory-mapped
+  {
+    tl::InputMemoryStream ims (data.c_str (), data.size ());
+    tl::InputStream is (ims);
+    is.inflate ();
+    EXPECT_EQ (read_string (is, text.size ()) == text, true);
+    EXPECT_EQ (is.read_all (), "REST");
+  }
+
+  //  buffered
+  std::string path = _this->tmp_file ("deflated.gz");
+  {
+    tl::OutputStream os (path, tl::OutputStream::OM_Zlib);
+    os.put (data.c_str (), data.size ());
+  }
+
+  {
+    tl::InputStream is (path);
+    EXPECT_EQ (is.is_mapped (), false);
+    is.inflate ();
+    EXPECT_EQ (read_string (is, text.size ()) == text, true);
+    EXPECT_EQ (is.read_all (), "REST");
+  }
+}
+
+// ------------------------------------------------------------------------
+//  The previous InflateFilter implementation (bitwise Huffmann decoding and 
+//  bytewise bit reading) as the reference for the throughput benchmark
+
+namespace
+{
+
+class LegacyBitStream
+{
+public:
+  LegacyBitStream (tl::InputStream &input)
+    : mp_input (&input), m_mask (0), m_byte (0)
+  { }
+
+  unsigned char get_byte ()
+  {
+    m_mask = 0;
+    const char *c = mp_input->get (1, true /*bypass_deflate*/);
+    if (c == 0) {
+      throw tl::Exception ("Unexpected end of file (legacy DEFLATE implementation)");
+    }
+    return *c;
+  }
+
+  bool get_bit ()
+  {
+    if (m_mask == 0) {
+      m_byte = get_byte ();
+      m_mask = 0x01;
+    } 
+    bool b = ((m_byte & m_mask) != 0);
+    m_mask <<= 1;
+    return b;
+  }
+
+  unsigned int get_bits (unsigned int n)
+  {
+    unsigned int r = 0;
+    unsigned int m = 1;
+    while (n-- > 0) {
+      r |= get_bit () ? m : 0;
+      m <<= 1;
+    }
+    return r;
+  }
+
+  void skip_to_byte ()
+  {
+    m_mask = 0;
+  }
+
+private:
+  tl::InputStream *mp_input;
+  unsigned char m_mask;
+  unsigned char m_byte;
+};
+
+class LegacyHuffmannDecoder
+{
+public:
+  LegacyHuffmannDecoder ()
+    : mp_codes (0), mp_bitmasks (0), m_num_codes (0), m_max_bits (0)
+  { }
+
+  ~LegacyHuffmannDecoder ()
+  {
+    delete [] mp_codes;
+    delete [] mp_bitmasks;
+  }
+
+  void fill_fixed_table_length ()
+  {
+    reserve (9);
+
+    unsigned short lengths [288];
+    for (unsigned int i = 0; i < 288; ++i) {
+      lengths [i] = (i < 144 ? 8 : (i < 256 ? 9 : (i < 280 ? 7 : 8)));
+    }
+    init_codes (lengths, lengths + sizeof (lengths) / sizeof (lengths [0]));
+  }
+
+  void fill_fixed_table_dist ()
+  {
+    reserve (5);
+
+    unsigned short lengths [32];
+    for (unsigned int i = 0; i < 32; ++i) {
+      lengths [i] = 5;
+    }
+    init_codes (lengths, lengths + sizeof (lengths) / sizeof (lengths [0]));
+  }
+
+  template <class Iter>
+  void init_codes (Iter begin_lengths, Iter end_lengths)
+  {
+    const unsigned int MAX_BITS = 16;
+    unsigned short bl_count [MAX_BITS + 1];
+    unsigned short bitmasks [MAX_BITS + 1];
+    unsigned short next_code [MAX_BITS + 1];
+    unsigned int max_bits = 0;
+
+    for (unsigned int bits = 0; bits <= MAX_BITS; bits++) {
+      bl_count [bits] = 0;
+    }
+
+    for (Iter l = begin_lengths; l != end_lengths; ++l) {
+      if (*l > 0) {
+        ++bl_count [*l];
+      }
+    }
+
+    unsigned int code = 0;
+    for (unsigned int bits = 1; bits <= MAX_BITS; bits++) {
+      if (bl_count [bits - 1] > 0) {
+        max_bits = bits - 1;
+      }
+      code = (code + bl_count [bits - 1]) << 1;
+      next_code [bits] = code;
+    }
+
+    for (unsigned int bits = 0; bits <= max_bits; bits++) {
+      bitmasks [bits] = ((1 << bits) - 1) << (max_bits - bits);
+    }
+
+    reserve (max_bits);
+
+    unsigned short symbol = 0;
+    for (Iter l = begin_lengths; l != end_lengths; ++l, ++symbol) {
+      if (*l > 0) {
+        unsigned int code = next_code [*l]++;
+        code <<= (max_bits - *l);
+        mp_codes [code] = symbol;
+        mp_bitmasks [code] = bitmasks [*l];
+      } 
+    }
+  }
+
+  unsigned short decode (LegacyBitStream &s) const
+  {
+    unsigned int m = m_num_codes / 2;
+    
+    unsigned int c = 0;
+    do {
+      if (s.get_bit ()) {
+        c |= m;
+      }
+      m >>= 1;
+    } while ((mp_bitmasks [c] & m) != 0);
+
+    return mp_codes [c];
+  }
+
+private:
+  unsigned short *mp_codes, *mp_bitmasks;
+  unsigned int m_num_codes, m_max_bits;
+
+  void reserve (unsigned int max_bits)
+  {
+    m_num_codes = 1 << max_bits;
+    if (max_bits > m_max_bits) {
+      m_max_bits = max_bits;
+      delete [] mp_codes;
+      mp_codes = new unsigned short [m_num_codes];
+      delete [] mp_bitmasks;
+      mp_bitmasks = new unsigned short [m_num_codes];
+    }
+  }
+};
+
+class LegacyInflateFilter
+{
+public:
+  LegacyInflateFilter (tl::InputStream &input)
+    : m_input (input), m_b_insert (0), m_b_read (0), m_last_block (false), m_uncompressed_length (0)
+  {
+    for (size_t i = 0; i < sizeof (m_buffer) / sizeof (m_buffer [0]); ++i) {
+      m_buffer [i] = 0;
+    }
+  }
+
+  const char *get (size_t n)
+  {
+    while ((m_b_insert + sizeof (m_buffer) - m_b_read) % sizeof (m_buffer) < n) {
+      if (! process ()) {
+        throw tl::Exception ("Unexpected end of file (legacy DEFLATE implementation)");
+      }
+    }
+
+    if (m_b_read + n >= sizeof (m_buffer)) {
+      std::rotate (m_buffer, m_buffer + m_b_read, m_buffer + sizeof (m_buffer));
+      m_b_insert = (m_b_insert - m_b_read + sizeof (m_buffer)) % sizeof (m_buffer);
+      m_b_read = 0;
+    }
+
+    const char *r = m_buffer + m_b_read;
+    m_b_read = (m_b_read + n) % sizeof (m_buffer);
+    return r;
+  }
+
+private:
+  LegacyBitStream m_input;
+  char m_buffer [65536];
+  size_t m_b_insert, m_b_read;
+  bool m_last_block;
+  int m_uncompressed_length;
+  LegacyHuffmannDecoder m_lit_decoder, m_dist_decoder;
+
+  void put_byte (char b) 
+  {
+    m_buffer [m_b_insert] = b;
+    m_b_insert = (m_b_insert + 1) % sizeof (m_buffer);
+  }
+
+  void put_byte_dist (unsigned int d) 
+  {
+    put_byte (m_buffer [(m_b_insert - d) % sizeof (m_buffer)]);
+  }
+
+  bool process ()
+  {
+    while (true) {
+
+      bool new_block = false;
+
+      if (m_uncompressed_length == 0) {
+
+        m_uncompressed_length = -1;
+        new_block = true;
+
+      } else if (m_uncompressed_length > 0) {
+
+        put_byte (m_input.get_byte ());
+        --m_uncompressed_length;
+
+      } else {
+
+        unsigned int l = m_lit_decoder.decode (m_input);
+        if (l < 256) {
+
+          put_byte (char (l));
+
+        } else if (l == 256) {
+
+          new_block = true;
+
+        } else {
+
+          unsigned int length = 0;
+          if (l < 265) {
+            length = l - 254;
+          } else if (l < 269) {
+            length = (l - 265) * 2 + 11 + m_input.get_bits (1);
+          } else if (l < 273) {
+            length = (l - 269) * 4 + 19 + m_input.get_bits (2);
+          } else if (l < 277) {
+            length = (l - 273) * 8 + 35 + m_input.get_bits (3);
+          } else if (l < 281) {
+            length = (l - 277) * 16 + 67 + m_input.get_bits (4);
+          } else if (l < 285) {
+            length = (l - 281) * 32 + 131 + m_input.get_bits (5);
+          } else {
+            length = 258;
+          }
+
+          unsigned int d = m_dist_decoder.decode (m_input);
+          unsigned int dist = 0;
+          if (d < 4) {
+            dist = d + 1;
+          } else if (d < 6) {
+            dist = (d - 4) * 2 + 5 + m_input.get_bits (1);
+          } else if (d < 8) {
+            dist = (d - 6) * 4 + 9 + m_input.get_bits (2);
+          } else if (d < 10) {
+            dist = (d - 8) * 8 + 17 + m_input.get_bits (3);
+          } else if (d < 12) {
+            dist = (d - 10) * 16 + 33 + m_input.get_bits (4);
+          } else if (d < 14) {
+            dist = (d - 12) * 32 + 65 + m_input.get_bits (5);
+          } else if (d < 16) {
+            dist = (d - 14) * 64 + 129 + m_input.get_bits (6);
+          } else if (d < 18) {
+            dist = (d - 16) * 128 + 257 + m_input.get_bits (7);
+          } else if (d < 20) {
+            dist = (d - 18) * 256 + 513 + m_input.get_bits (8);
+          } else if (d < 22) {
+            dist = (d - 20) * 512 + 1025 + m_input.get_bits (9);
+          } else if (d < 24) {
+            dist = (d - 22) * 1024 + 2049 + m_input.get_bits (10);
+          } else if (d < 26) {
+            dist = (d - 24) * 2048 + 4097 + m_input.get_bits (11);
+          } else if (d < 28) {
+            dist = (d - 26) * 4096 + 8193 + m_input.get_bits (12);
+          } else {
+            dist = (d - 28) * 8192 + 16385 + m_input.get_bits (13);
+          }
+
+          while (length-- > 0) {
+            put_byte_dist (dist);
+          }
+
+        }
+
+      }
+
+      if (new_block) {
+
+        if (m_last_block) {
+          return false;
+        }
+
+        m_last_block = m_input.get_bit ();
+        unsigned int t = m_input.get_bits (2);
+
+        if (t == 0) {
+
+          m_input.skip_to_byte ();
+          m_uncompressed_length = m_input.get_bits (16);
+          m_input.get_bits (16);
+
+        } else if (t == 1) {
+
+          m_lit_decoder.fill_fixed_table_length ();
+          m_dist_decoder.fill_fixed_table_dist ();
+
+        } else if (t == 2) {
+
+          unsigned int hlit = m_input.get_bits (5) + 257;
+          unsigned int hdist = m_input.get_bits (5) + 1;
+          unsigned int hclen = m_input.get_bits (4) + 4;
+
+          unsigned int hclengths [19];
+          for (unsigned int i = 0; i < 19; ++i) {
+            hclengths [i] = 0;
+          }
+
+          static const unsigned int hclen_order [] = {
+            16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+          };
+          for (unsigned int i = 0; i < hclen; ++i) {
+            hclengths [hclen_order [i]] = m_input.get_bits (3);
+          }
+
+          LegacyHuffmannDecoder ldecoder;
+          ldecoder.init_codes (hclengths, hclengths + 19);
+
+          unsigned int lengths [286 + 32];
+          unsigned int nlengths = hlit + hdist;
+
+          for (unsigned int i = 0; i < nlengths; ) {
+            unsigned short l = ldecoder.decode (m_input);
+            if (l < 16) {
+              lengths [i++] = l;
+            } else if (l == 16) {
+              unsigned int n = m_input.get_bits (2) + 3;
+              l = lengths [i - 1];
+              while (n-- > 0) {
+                lengths [i++] = l;
+              }
+            } else {
+              unsigned int n = (l == 17 ? m_input.get_bits (3) + 3 : m_input.get_bits (7) + 11);
+              while (n-- > 0) {
+                lengths [i++] = 0;
+              }
+            }
+          }
+
+          m_lit_decoder.init_codes (lengths, lengths + hlit);
+          m_dist_decoder.init_codes (lengths + hlit, lengths + nlengths);
+
+        } else {
+          throw tl::Exception ("Invalid compression type (legacy DEFLATE implementation)");
+        }
+
+      } else {
+        return true;
+      }
+
+    }
+  }
+};
+
+}
+
+//  Throughput benchmark against the previous implementation
+TEST(6)
+{
+  std::string text = test_text (16 * 1024 * 1024);
+  std::string deflated = deflate_string (text);
+
+  double mb = double (text.size ()) / (1024.0 * 1024.0);
+
+  tl::Timer timer;
+  timer.start ();
+
+  tl::InputMemoryStream ims (deflated.c_str (), deflated.size ());
+  tl::InputStream is (ims);
+  std::string out = inflate_string (is, text.size ());
+
+  timer.stop ();
+  EXPECT_EQ (out == text, true);
+  tl::info << "InflateFilter: " << tl::sprintf ("%.1f", mb / std::max (1e-6, timer.sec_wall ())) << " MB/s";
+
+  timer.start ();
+
+  tl::InputMemoryStream ims_legacy (deflated.c_str (), deflated.size ());
+  tl::InputStream is_legacy (ims_legacy);
+  LegacyInflateFilter legacy (is_legacy);
+
+  std::string legacy_out;
+  legacy_out.reserve (text.size ());
+  while (legacy_out.size () < text.size ()) {
+    size_t chunk = std::min (text.size () - legacy_out.size (), size_t (4096));
+    legacy_out.append (legacy.get (chunk), chunk);
+  }
+
+  timer.stop ();
+  EXPECT_EQ (legacy_out == text, true);
+  tl::info << "Previous InflateFilter: " << tl::sprintf ("%.1f", mb / std::max (1e-6, timer.sec_wall ())) << " MB/s";
+}
@@ -0,0 +1,228 @@
+
+/*
+
+  KLayout Layout Viewer
+  Copyright (C) 2006-2017 Matthias Koefferlein
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+
+#include "tlPixelBuffer.h"
+#include "tlStream.h"
+#include "utHead.h"
+
+#include <zlib.h>
+
+namespace
+{
+
+static uint32_t get_uint32 (const unsigned char *b)
+{
+  return (uint32_t (b [0]) << 24) | (uint32_t (b [1]) << 16) | (uint32_t (b [2]) << 8) | uint32_t (b [3]);
+}
+
+/**
+ *  @brief Decodes the chunks of a PNG stream, checks the CRCs and delivers the IHDR and the inflated IDAT data
+ */
+static bool decode_png (const std::string &png, std::string &ihdr, std::string &raw, std::vector<std::string> &chunks)
+{
+  static const char signature [] = "\x89PNG\r\n\x1a\n";
+  if (png.size () < 8 || std::string (png, 0, 8) != std::string (signature, 8)) {
+    return false;
+  }
+
+  std::string idat;
+  size_t pos = 8;
+  while (pos + 12 <= png.size ()) {
+
+    const unsigned char *b = (const unsigned char *) png.c_str () + pos;
+    uint32_t n = get_uint32 (b);
+    if (pos + 12 + n > png.size ()) {
+      return false;
+    }
+
+    std::string type (png, pos + 4, 4);
+    uLong crc = crc32 (0L, Z_NULL, 0);
+    crc = crc32 (crc, b + 4, n + 4);
+    if (uint32_t (crc) != get_uint32 (b + 8 + n)) {
+      return false;
+    }
+
+    chunks.push_back (type);
+    if (type == "IHDR") {
+      ihdr = std::string (png, pos + 8, n);
+    } else if (type == "IDAT") {
+      idat += std::string (png, pos + 8, n);
+    }
+
+    pos += 12 + n;
+
+  }
+
+  std::vector<char> buffer (1 << 20);
+  uLongf len = (uLongf) buffer.size ();
+  if (uncompress ((Bytef *) &buffer [0], &len, (const Bytef *) idat.c_str (), (uLong) idat.size ()) != Z_OK) {
+    return false;
+  }
+  raw = std::string (&buffer [0], len);
+
+  return pos == png.size ();
+}
+
+/**
+ *  @brief Reverts the PNG filters and delivers the pixel bytes line by line
+ */
+static std::vector<std::string> unfilter (const std::string &raw, unsigned int w, unsigned int h, unsigned int bpp)
+{
+  std::vector<std::string> lines;
+  std::string prev (w * bpp, '\0');
+  const unsigned char *r = (const unsigned char *) raw.c_str ();
+  for (unsigned int y = 0; y < h; ++y) {
+    unsigned char f = *r++;
+    std::string l (w * bpp, '\0');
+    for (unsigned int i = 0; i < w * bpp; ++i) {
+      unsigned char a = i >= bpp ? (unsigned char) l [i - bpp] : 0;
+      unsigned char b = (unsigned char) prev [i];
+      unsigned char d = r [i];
+      if (f == 1) {
+        d += a;
+      } else if (f == 2) {
+        d += b;
+      }
+      l [i] = (char) d;
+    }
+    r += w * bpp;
+    lines.push_back (l);
+    prev = l;
+  }
+  return lines;
+}
+
+}
+
+TEST(1)
+{
+  tl::PixelBuffer img (7, 5);
+  EXPECT_EQ (img.width (), (unsigned int) 7);
+  EXPECT_EQ (img.height (), (unsigned int) 5);
+
+  img.fill (0xff102030);
+  EXPECT_EQ (img.pixel (0, 0), (tl::color_t) 0xff102030);
+  EXPECT_EQ (img.pixel (6, 4), (tl::color_t) 0xff102030);
+
+  img.scan_line (1) [2] = 0xffff0000;
+  img.scan_line (4) [6] = 0xff00ff00;
+  EXPECT_EQ (img.pixel (2, 1), (tl::color_t) 0xffff0000);
+  EXPECT_EQ (img.pixel (6, 4), (tl::color_t) 0xff00ff00);
+
+  tl::OutputMemoryStream mem;
+  {
+    tl::OutputStream os (mem);
+    img.write_png (os);
+  }
+
+  std::string png (mem.data (), mem.size ());
+  std::string ihdr, raw;
+  std::vector<std::string> chunks;
+  EXPECT_EQ (decode_png (png, ihdr, raw, chunks), true);
+
+  EXPECT_EQ (chunks.front (), "IHDR");
+  EXPECT_EQ (chunks.back (), "IEND");
+  EXPECT_EQ (ihdr.size (), size_t (13));
+  EXPECT_EQ (get_uint32 ((const unsigned char *) ihdr.c_str ()), (uint32_t) 7);
+  EXPECT_EQ (get_uint32 ((const unsigned char *) ihdr.c_str () + 4), (uint32_t) 5);
+  EXPECT_EQ (int (ihdr [8]), 8);
+  EXPECT_EQ (int (ihdr [9]), 2);
+
+  EXPECT_EQ (raw.size (), size_t (5 * (7 * 3 + 1)));
+
+  std::vector<std::string> lines = unfilter (raw, 7, 5, 3);
+  for (unsigned int y = 0; y < 5; ++y) {
+    for (unsigned int x = 0; x < 7; ++x) {
+      tl::color_t c = img.pixel (x, y);
+      EXPECT_EQ ((unsigned char) lines [y][x * 3], (unsigned char) (c >> 16));
+      EXPECT_EQ ((unsigned char) lines [y][x * 3 + 1], (unsigned char) (c >> 8));
+      EXPECT_EQ ((unsigned char) lines [y][x * 3 + 2], (unsigned char) c);
+    }
+  }
+}
+
+TEST(2)
+{
+  //  transparent, large enough to produce multiple IDAT chunks
+  unsigned int w = 400, h = 300;
+  tl::PixelBuffer img (w, h);
+  img.set_transparent (true);
+
+  unsigned int seed = 17;
+  for (unsigned int y = 0; y < h; ++y) {
+    tl::color_t *sl = img.scan_line (y);
+    for (unsigned int x = 0; x < w; ++x) {
+      seed = seed * 1103515245 + 12345;
+      sl [x] = seed;
+    }
+  }
+
+  tl::OutputMemoryStream mem;
+  {
+    tl::OutputStream os (mem);
+    img.write_png (os, 1);
+  }
+
+  std::string png (mem.data (), mem.size ());
+  std::string ihdr, raw;
+  std::vector<std::string> chunks;
+  EXPECT_EQ (decode_png (png, ihdr, raw, chunks), true);
+
+  EXPECT_EQ (chunks.size () > 3, true);
+  EXPECT_EQ (int (ihdr [9]), 6);
+  EXPECT_EQ (raw.size (), size_t (h * (w * 4 + 1)));
+
+  std::vector<std::string> lines = unfilter (raw, w, h, 4);
+  bool equal = true;
+  for (unsigned int y = 0; y < h; ++y) {
+    for (unsigned int x = 0; x < w; ++x) {
+      tl::color_t c = img.pixel (x, y);
+      const unsigned char *p = (const unsigned char *) lines [y].c_str () + x * 4;
+      if (p [0] != (unsigned char) (c >> 16) || p [1] != (unsigned char) (c >> 8) || p [2] != (unsigned char) c || p [3] != (unsigned char) (c >> 24)) {
+        equal = false;
+      }
+    }
+  }
+  EXPECT_EQ (equal, true);
+}
+
+
+TEST(3)
+{
+  //  empty images are rejected
+  for (unsigned int i = 0; i < 3; ++i) {
+
+    tl::PixelBuffer img (i == 1 ? 10 : 0, i == 2 ? 10 : 0);
+
+    tl::OutputMemoryStream mem;
+    bool error = false;
+    try {
+      tl::OutputStream os (mem);
+      img.write_png (os);
+    } catch (tl::Exception &) {
+      error = true;
+    }
+    EXPECT_EQ (error, true);
+
+  }
+}
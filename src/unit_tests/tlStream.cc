@@ -0,0 +1,145 @@
+
+/*
+
+  KLayout Layout Viewer
+  Copyright (C) 2006-2017 Matthias Koefferlein
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+
+#include "tlStream.h"
+#include "utHead.h"
+
+static std::string test_data (size_t n)
+{
+  std::string s;
+  for (size_t i = 0; i < n; ++i) {
+    s += char ((i * 7 + i / 251) & 0xff);
+  }
+  return s;
+}
+
+static void write_file (const std::string &path, const std::string &data, tl::OutputStream::OutputStreamMode om)
+{
+  tl::OutputStream os (path, om);
+  os.put (data.c_str (), data.size ());
+}
+
+//  plain files are mapped
+TEST(1)
+{
+  std::string data = test_data (100000);
+  std::string path = _this->tmp_file ("plain.bin");
+  write_file (path, data, tl::OutputStream::OM_Plain);
+
+  tl::InputStream is (path);
+#if !defined(_WIN32)
+  EXPECT_EQ (is.is_mapped (), true);
+#endif
+
+  const char *b = is.get (10);
+  EXPECT_EQ (b != 0, true);
+  EXPECT_EQ (std::string (b, 10), data.substr (0, 10));
+  EXPECT_EQ (is.pos (), size_t (10));
+
+  is.unget (4);
+  EXPECT_EQ (is.pos (), size_t (6));
+
+  b = is.get (50000);
+  EXPECT_EQ (b != 0, true);
+  EXPECT_EQ (std::string (b, 50000), data.substr (6, 50000));
+
+  EXPECT_EQ (is.read_all (), data.substr (50006));
+  EXPECT_EQ (is.get (1) == 0, true);
+
+  is.reset ();
+  EXPECT_EQ (is.pos (), size_t (0));
+  EXPECT_EQ (is.read_all (), data);
+}
+
+//  compressed files are not mapped but read through zlib
+TEST(2)
+{
+  std::string data = test_data (100000);
+  std::string path = _this->tmp_file ("compressed.bin.gz");
+  write_file (path, data, tl::OutputStream::OM_Zlib);
+
+  tl::InputStream is (path);
+  EXPECT_EQ (is.is_mapped (), false);
+
+  const char *b = is.get (10);
+  EXPECT_EQ (b != 0, true);
+  EXPECT_EQ (std::string (b, 10), data.substr (0, 10));
+
+  EXPECT_EQ (is.read_all (), data.substr (10));
+
+  is.reset ();
+  EXPECT_EQ (is.read_all (), data);
+}
+
+//  memory streams are delivered directly
+TEST(3)
+{
+  std::string data = test_data (1000);
+
+  tl::InputMemoryStream ims (data.c_str (), data.size ());
+  tl::InputStream is (ims);
+  EXPECT_EQ (is.is_mapped (), true);
+
+  const char *b = is.get (100);
+  EXPECT_EQ (b == data.c_str (), true);
+  b = is.get (900);
+  EXPECT_EQ (b == data.c_str () + 100, true);
+  EXPECT_EQ (is.get (1) == 0, true);
+
+  is.reset ();
+  EXPECT_EQ (is.read_all (100), data.substr (0, 100));
+}
+
+//  empty files
+TEST(4)
+{
+  std::string path = _this->tmp_file ("empty.bin");
+  write_file (path, std::string (), tl::OutputStream::OM_Plain);
+
+  tl::InputStream is (path);
+  EXPECT_EQ (is.get (1) == 0, true);
+  EXPECT_EQ (is.read_all (), "");
+}
+
+//  modifications of a mapped file are detected
+TEST(5)
+{
+  std::string data = test_data (10000);
+  std::string path = _this->tmp_file ("modified.bin");
+  write_file (path, data, tl::OutputStream::OM_Plain);
+
+  tl::InputStream is (path);
+  EXPECT_EQ (is.source_modified (), false);
+  EXPECT_EQ (is.read_all (100), data.substr (0, 100));
+
+#if !defined(_WIN32)
+  //  truncating the file 
+  write_file (path, data.substr (0, 100), tl::OutputStream::OM_Plain);
+  EXPECT_EQ (is.source_modified (), true);
+#endif
+
+  //  a stream opened on the new file is not modified
+  tl::InputStream is2 (path);
+  EXPECT_EQ (is2.source_modified (), false);
+  EXPECT_EQ (is2.read_all (), data.substr (0, 100));
+}
@@ -27,6 +27,7 @@
 #include "utHead.h"
 
 #include <stdio.h>
+#include <algorithm>
 
 #if defined(WIN32)
 #include <windows.h>
@@ -642,3 +643,170 @@ TEST(29)
   }
 }
 
+
+class NestedJobTask : public tl::Task
+{
+public:
+  NestedJobTask (int m, int n) : m_m (m), m_n (n) { }
+  int m_m, m_n;
+};
+
+class NestedJobWorker : public tl::Worker
+{
+public:
+  NestedJobWorker () : tl::Worker () { }
+
+protected:
+  void perform_task(tl::Task *task) 
+  { 
+    NestedJobTask *nested_task = dynamic_cast<NestedJobTask *> (task);
+    if (nested_task) {
+      //  runs a job from within a task - the pool threads must not block on this
+      MyJob job (4);
+      for (int i = 0; i < nested_task->m_m; ++i) {
+        job.schedule (new MyTask (nested_task->m_n));
+      }
+      job.start ();
+      job.wait ();
+    }
+  }
+};
+
+TEST(30) 
+{
+  tl::SelfTimer timer ("4 threads with nested jobs of 4 threads each");
+  tl::Job<NestedJobWorker> job (4);
+
+  for (int l = 0; l < 20; ++l) {
+
+    s_sum[0].reset ();
+    s_sum[1].reset ();
+    s_sum[2].reset ();
+    s_sum[3].reset ();
+
+    for (int i = 0; i < 20; ++i) {
+      job.schedule (new NestedJobTask (10, 100));
+    }
+
+    job.start ();
+    job.wait ();
+    EXPECT_EQ (job.is_running (), false);
+
+    EXPECT_EQ (s_sum[0].sum () + s_sum[1].sum() + s_sum[2].sum() + s_sum[3].sum (), 20000);
+
+  }
+}
+
+TEST(31) 
+{
+  //  the threads are taken from the pool and are not created per job
+  MyJob job (4);
+  job.start ();
+  job.wait ();
+
+  int nthreads = tl::ThreadPool::instance ()->threads ();
+  EXPECT_EQ (nthreads >= 4, true);
+
+  for (int l = 0; l < 10; ++l) {
+    MyJob job2 (4);
+    for (int i = 0; i < 10; ++i) {
+      job2.schedule (new MyTask (100));
+    }
+    job2.start ();
+    job2.wait ();
+  }
+
+  EXPECT_EQ (tl::ThreadPool::instance ()->threads (), nthreads);
+}
+
+static QMutex s_block_lock;
+static bool s_blocked = false;
+static int s_blocking = 0;
+
+class BlockingWorker : public tl::Worker
+{
+public:
+  BlockingWorker () : tl::Worker () { }
+
+protected:
+  void perform_task (tl::Task *) 
+  { 
+    s_block_lock.lock ();
+    ++s_blocking;
+    s_block_lock.unlock ();
+
+    //  keeps the pool thread busy until released
+    while (true) {
+      s_block_lock.lock ();
+      bool blocked = s_blocked;
+      s_block_lock.unlock ();
+      if (! blocked) {
+        break;
+      }
+      usleep (1000);
+    }
+  }
+};
+
+TEST(32) 
+{
+  //  stopping a job whose workers are still waiting for a pool thread does not block
+  MyJob dummy (1);
+  dummy.start ();
+  dummy.wait ();
+
+  int nthreads = std::max (2, tl::ThreadPool::instance ()->threads ());
+
+  s_blocked = true;
+  s_blocking = 0;
+
+  tl::Job<BlockingWorker> blocker (nthreads);
+  for (int i = 0; i < nthreads; ++i) {
+    blocker.schedule (new MyTask (0));
+  }
+  blocker.start ();
+
+  //  wait until all pool threads are busy
+  while (true) {
+    s_block_lock.lock ();
+    bool all_busy = (s_blocking == nthreads);
+    s_block_lock.unlock ();
+    if (all_busy) {
+      break;
+    }
+    usleep (1000);
+  }
+
+  s_sum[0].reset ();
+  s_sum[1].reset ();
+  s_sum[2].reset ();
+  s_sum[3].reset ();
+
+  MyJob job (2);
+  for (int i = 0; i < 10; ++i) {
+    job.schedule (new MyTask (1));
+  }
+  job.start ();
+  EXPECT_EQ (job.is_running (), true);
+
+  job.stop ();
+  EXPECT_EQ (job.is_running (), false);
+
+  s_block_lock.lock ();
+  s_blocked = false;
+  s_block_lock.unlock ();
+
+  blocker.wait ();
+  EXPECT_EQ (blocker.is_running (), false);
+
+  //  none of the tasks has been executed
+  EXPECT_EQ (s_sum[0].sum () + s_sum[1].sum() + s_sum[2].sum() + s_sum[3].sum (), 0);
+
+  //  the job can be used again
+  for (int i = 0; i < 10; ++i) {
+    job.schedule (new MyTask (1));
+  }
+  job.start ();
+  job.wait ();
+  EXPECT_EQ (s_sum[0].sum () + s_sum[1].sum() + s_sum[2].sum() + s_sum[3].sum (), 10);
+}
@@ -12,6 +12,7 @@ HEADERS = \
   gsiTest.h
 
 SOURCES = \
+  dbArena.cc \
   dbArray.cc \
   dbBox.cc \
   dbBoxScanner.cc \
@@ -35,6 +36,7 @@ SOURCES = \
   dbLayer.cc \
   dbLayerMapping.cc \
   dbLayout.cc \
+  dbLayoutCache.cc \
   dbLayoutDiff.cc \
   dbLayoutQuery.cc \
   dbLibraries.cc \
@@ -63,14 +65,20 @@ SOURCES = \
   dbWriterTools.cc \
   extGerberImport.cc \
   extLEFDEFImport.cc \
+  extNetExtractor.cc \
   extNetTracer.cc \
+  extXOREngine.cc \
   gsiExpression.cc \
   imgObject.cc \
   layAnnotationShapes.cc \
   layBitmap.cc \
+  layBitmapKernels.cc \
   layBitmapsToImage.cc \
+  layCellLODCache.cc \
+  layHeadlessRenderer.cc \
   layLayerProperties.cc \
   layParsedLayerSource.cc \
+  layRedrawThreadCanvas.cc \
   layRenderer.cc \
   pya.cc \
   rba.cc \
@@ -87,8 +95,10 @@ SOURCES = \
   tlIntervalSet.cc \
   tlKDTree.cc \
   tlObject.cc \
+  tlPixelBuffer.cc \
   tlReuseVector.cc \
   tlStableVector.cc \
+  tlStream.cc \
   tlString.cc \
   tlThreadedWorkers.cc \
   tlUtils.cc \